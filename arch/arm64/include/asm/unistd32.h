@@ -903,6 +903,10 @@ __SYSCALL(__NR_landlock_add_rule, sys_landlock_add_rule)
 __SYSCALL(__NR_landlock_restrict_self, sys_landlock_restrict_self)
 #define __NR_process_mrelease 448
 __SYSCALL(__NR_process_mrelease, sys_process_mrelease)
+#define __NR_futex_waitv 449
+__SYSCALL(__NR_futex_waitv, sys_futex_waitv)
+#define __NR_membarrier_cpus 450
+__SYSCALL(__NR_membarrier_cpus, sys_membarrier_cpus)
 
 /*
  * Please add new compat syscalls above this comment and update
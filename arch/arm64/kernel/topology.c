@@ -108,6 +108,16 @@ int __init parse_acpi_topology(void)
 
 		i = acpi_find_last_cache_level(cpu);
 
+		/*
+		 * An L2 below the last level cache is shared by the
+		 * cores of a cluster.
+		 */
+		if (i > 2) {
+			cache_id = find_acpi_cpu_cache_topology(cpu, 2);
+			if (cache_id > 0)
+				cpu_topology[cpu].cluster_id = cache_id;
+		}
+
 		if (i > 0) {
 			/*
 			 * this is the only part of cpu_topology that has
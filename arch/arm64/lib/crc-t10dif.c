@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Accelerated CRC-T10DIF for library callers, using arm64 NEON and Crypto
+ * Extensions instructions
+ *
+ * Copyright (C) 2016 - 2017 Linaro Ltd <ard.biesheuvel@linaro.org>
+ */
+
+#include <linux/cpufeature.h>
+#include <linux/crc-t10dif.h>
+#include <linux/init.h>
+#include <linux/jump_label.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/sizes.h>
+
+#include <asm/neon.h>
+#include <asm/simd.h>
+
+#define CRC_T10DIF_PMULL_CHUNK_SIZE	16U
+
+asmlinkage u16 crc_t10dif_pmull_p8(u16 init_crc, const u8 *buf, size_t len);
+asmlinkage u16 crc_t10dif_pmull_p64(u16 init_crc, const u8 *buf, size_t len);
+
+static __ro_after_init DEFINE_STATIC_KEY_FALSE(have_asimd);
+static __ro_after_init DEFINE_STATIC_KEY_FALSE(have_pmull);
+
+u16 crc_t10dif_arch(u16 crc, const u8 *data, size_t length)
+{
+	if (length < CRC_T10DIF_PMULL_CHUNK_SIZE ||
+	    !static_branch_likely(&have_asimd) || !may_use_simd())
+		return crc_t10dif_generic(crc, data, length);
+
+	do {
+		size_t chunk = length;
+
+		/* Bound the time spent with preemption disabled */
+		if (chunk > SZ_4K + CRC_T10DIF_PMULL_CHUNK_SIZE)
+			chunk = SZ_4K;
+
+		kernel_neon_begin();
+		if (static_branch_likely(&have_pmull))
+			crc = crc_t10dif_pmull_p64(crc, data, chunk);
+		else
+			crc = crc_t10dif_pmull_p8(crc, data, chunk);
+		kernel_neon_end();
+		data += chunk;
+		length -= chunk;
+	} while (length);
+
+	return crc;
+}
+EXPORT_SYMBOL(crc_t10dif_arch);
+
+static int __init crc_t10dif_arm64_init(void)
+{
+	if (cpu_have_named_feature(ASIMD)) {
+		static_branch_enable(&have_asimd);
+		if (cpu_have_named_feature(PMULL))
+			static_branch_enable(&have_pmull);
+	}
+	return 0;
+}
+arch_initcall(crc_t10dif_arm64_init);
+
+MODULE_DESCRIPTION("CRC-T10DIF using arm64 NEON and Crypto Extensions");
+MODULE_LICENSE("GPL v2");
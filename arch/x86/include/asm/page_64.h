@@ -54,6 +54,10 @@ static inline void clear_page(void *page)
 			   : "cc", "memory", "rax", "rcx");
 }
 
+/* Zero a page with non-temporal stores, bypassing the cache */
+void clear_page_nocache(void *page);
+#define __HAVE_ARCH_CLEAR_PAGE_NOCACHE
+
 void copy_page(void *to, void *from);
 
 #ifdef CONFIG_X86_5LEVEL
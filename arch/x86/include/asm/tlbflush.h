@@ -198,7 +198,7 @@ struct flush_tlb_info {
 	 *
 	 * - Fully flush all mms whose tlb_gens have been updated.  .mm
 	 *   will be NULL, .end will be TLB_FLUSH_ALL, and .new_tlb_gen
-	 *   will be zero.
+	 *   will be TLB_GENERATION_INVALID.
 	 */
 	struct mm_struct	*mm;
 	unsigned long		start;
@@ -239,6 +239,9 @@ static inline void flush_tlb_page(struct vm_area_struct *vma, unsigned long a)
 	flush_tlb_mm_range(vma->vm_mm, a, a + PAGE_SIZE, PAGE_SHIFT, false);
 }
 
+/* inc_mm_tlb_gen() never returns 0: no flush is ever for generation 0 */
+#define TLB_GENERATION_INVALID	0
+
 static inline u64 inc_mm_tlb_gen(struct mm_struct *mm)
 {
 	/*
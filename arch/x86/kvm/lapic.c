@@ -603,6 +603,67 @@ int kvm_apic_set_irq(struct kvm_vcpu *vcpu, struct kvm_lapic_irq *irq,
 			irq->level, irq->trig_mode, dest_map);
 }
 
+/*
+ * While an IPI is delivered to several vCPUs, the posted-interrupt
+ * notifications for the ones that are in guest mode are collected here
+ * and sent with a single send_IPI_mask(), which lets the host APIC driver
+ * coalesce them (one ICR write per x2APIC cluster) instead of writing
+ * the ICR once per destination.
+ */
+struct kvm_pi_notify_batch {
+	bool active;
+	struct cpumask cpus;
+};
+
+static DEFINE_PER_CPU(struct kvm_pi_notify_batch, kvm_pi_notify_batch);
+
+static bool kvm_pi_notify_batch_begin(void)
+{
+	struct kvm_pi_notify_batch *batch;
+
+	preempt_disable();
+	batch = this_cpu_ptr(&kvm_pi_notify_batch);
+	if (batch->active) {
+		preempt_enable();
+		return false;
+	}
+	batch->active = true;
+	return true;
+}
+
+static void kvm_pi_notify_batch_end(bool begun)
+{
+	struct kvm_pi_notify_batch *batch;
+
+	if (!begun)
+		return;
+
+	batch = this_cpu_ptr(&kvm_pi_notify_batch);
+	batch->active = false;
+	if (!cpumask_empty(&batch->cpus)) {
+		apic->send_IPI_mask(&batch->cpus, POSTED_INTR_VECTOR);
+		cpumask_clear(&batch->cpus);
+	}
+	preempt_enable();
+}
+
+/*
+ * Called by the vendor code instead of sending the notification vector to
+ * @cpu right away.  Returns false if no batch is open and the caller must
+ * send it itself.
+ */
+bool kvm_lapic_defer_pi_notification(int cpu)
+{
+	struct kvm_pi_notify_batch *batch = this_cpu_ptr(&kvm_pi_notify_batch);
+
+	if (!batch->active)
+		return false;
+
+	__cpumask_set_cpu(cpu, &batch->cpus);
+	return true;
+}
+EXPORT_SYMBOL_GPL(kvm_lapic_defer_pi_notification);
+
 static int __pv_send_ipi(unsigned long *ipi_bitmap, struct kvm_apic_map *map,
 			 struct kvm_lapic_irq *irq, u32 min)
 {
@@ -630,6 +691,7 @@ int kvm_pv_send_ipi(struct kvm *kvm, unsigned long ipi_bitmap_low,
 	struct kvm_apic_map *map;
 	struct kvm_lapic_irq irq = {0};
 	int cluster_size = op_64_bit ? 64 : 32;
+	bool batched;
 	int count;
 
 	if (icr & (APIC_DEST_MASK | APIC_SHORT_MASK))
@@ -645,9 +707,11 @@ int kvm_pv_send_ipi(struct kvm *kvm, unsigned long ipi_bitmap_low,
 
 	count = -EOPNOTSUPP;
 	if (likely(map)) {
+		batched = kvm_pi_notify_batch_begin();
 		count = __pv_send_ipi(&ipi_bitmap_low, map, &irq, min);
 		min += cluster_size;
 		count += __pv_send_ipi(&ipi_bitmap_high, map, &irq, min);
+		kvm_pi_notify_batch_end(batched);
 	}
 
 	rcu_read_unlock();
@@ -1002,12 +1066,18 @@ bool kvm_irq_delivery_to_apic_fast(struct kvm *kvm, struct kvm_lapic *src,
 
 	ret = kvm_apic_map_get_dest_lapic(kvm, &src, irq, map, &dst, &bitmap);
 	if (ret) {
+		bool batched = false;
+
+		if (bitmap & (bitmap - 1))
+			batched = kvm_pi_notify_batch_begin();
+
 		*r = 0;
 		for_each_set_bit(i, &bitmap, 16) {
 			if (!dst[i])
 				continue;
 			*r += kvm_apic_set_irq(dst[i]->vcpu, irq, dest_map);
 		}
+		kvm_pi_notify_batch_end(batched);
 	}
 
 	rcu_read_unlock();
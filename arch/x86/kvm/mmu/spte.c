@@ -198,6 +198,55 @@ u64 make_nonleaf_spte(u64 *child_pt, bool ad_disabled)
 	return spte;
 }
 
+/*
+ * Construct a huge SPTE at @level from a present leaf SPTE mapping part of
+ * the same range, for recovering a huge mapping in place.  The caller has
+ * checked that the host maps the whole range with a huge page, so the
+ * huge page's address is the small SPTE's with the low bits cleared.
+ */
+u64 make_huge_spte(u64 small_spte, int level)
+{
+	u64 huge_spte;
+
+	if (WARN_ON_ONCE(!is_shadow_present_pte(small_spte) ||
+			 level == PG_LEVEL_4K))
+		return 0;
+
+	huge_spte = small_spte | PT_PAGE_SIZE_MASK;
+	huge_spte &= KVM_HPAGE_MASK(level) | ~PAGE_MASK;
+
+	if (is_nx_huge_page_enabled()) {
+		huge_spte &= ~shadow_x_mask;
+		huge_spte |= shadow_nx_mask;
+	}
+
+	return huge_spte;
+}
+
+/*
+ * Construct the SPTE for the @index'th child of a huge SPTE being split
+ * into a page table of the next level down.  The child maps the same
+ * memory with the same permissions.
+ */
+u64 make_huge_page_split_spte(u64 huge_spte, int huge_level, int index)
+{
+	int child_level = huge_level - 1;
+	u64 child_spte;
+
+	if (WARN_ON_ONCE(!is_shadow_present_pte(huge_spte) ||
+			 !is_large_pte(huge_spte)))
+		return 0;
+
+	child_spte = huge_spte;
+	child_spte |= ((u64)index * KVM_PAGES_PER_HPAGE(child_level)) <<
+		      PAGE_SHIFT;
+
+	if (child_level == PG_LEVEL_4K)
+		child_spte &= ~PT_PAGE_SIZE_MASK;
+
+	return child_spte;
+}
+
 u64 kvm_mmu_changed_pte_notifier_make_spte(u64 old_spte, kvm_pfn_t new_pfn)
 {
 	u64 new_spte;
@@ -344,6 +344,8 @@ int make_spte(struct kvm_vcpu *vcpu, unsigned int pte_access, int level,
 		     bool can_unsync, bool host_writable, bool ad_disabled,
 		     u64 *new_spte);
 u64 make_nonleaf_spte(u64 *child_pt, bool ad_disabled);
+u64 make_huge_spte(u64 small_spte, int level);
+u64 make_huge_page_split_spte(u64 huge_spte, int huge_level, int index);
 u64 make_mmio_spte(struct kvm_vcpu *vcpu, u64 gfn, unsigned int access);
 u64 mark_spte_for_access_track(u64 spte);
 u64 kvm_mmu_changed_pte_notifier_make_spte(u64 old_spte, kvm_pfn_t new_pfn);
@@ -1412,46 +1412,93 @@ void kvm_tdp_mmu_clear_dirty_pt_masked(struct kvm *kvm,
 }
 
 /*
- * Clear leaf entries which could be replaced by large mappings, for
- * GFNs within the slot.
+ * Build the huge SPTE that could replace the non-leaf SPTE at @parent from
+ * the first present leaf below it.  Returns false if there is none.
  */
-static bool zap_collapsible_spte_range(struct kvm *kvm,
-				       struct kvm_mmu_page *root,
-				       const struct kvm_memory_slot *slot,
-				       bool flush)
+static bool tdp_mmu_make_huge_spte(struct tdp_iter *parent, u64 *huge_spte)
+{
+	tdp_ptep_t pt = spte_to_child_pt(parent->old_spte, parent->level);
+	gfn_t start = parent->gfn;
+	gfn_t end = start + KVM_PAGES_PER_HPAGE(parent->level);
+	struct tdp_iter iter;
+
+	for_each_tdp_pte(iter, rcu_dereference(pt), parent->level - 1,
+			 start, end) {
+		if (!is_shadow_present_pte(iter.old_spte) ||
+		    !is_last_spte(iter.old_spte, iter.level))
+			continue;
+
+		*huge_spte = make_huge_spte(iter.old_spte, parent->level);
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * Replace non-leaf SPTEs whose range the host maps with a huge page by a
+ * huge SPTE, freeing the page tables below them, for GFNs within the slot.
+ */
+static bool recover_huge_pages_range(struct kvm *kvm,
+				     struct kvm_mmu_page *root,
+				     const struct kvm_memory_slot *slot,
+				     bool flush)
 {
 	gfn_t start = slot->base_gfn;
 	gfn_t end = start + slot->npages;
+	struct kvm_mmu_page *child;
 	struct tdp_iter iter;
-	kvm_pfn_t pfn;
+	u64 huge_spte;
 
 	rcu_read_lock();
 
-	tdp_root_for_each_pte(iter, root, start, end) {
+	for_each_tdp_pte_min_level(iter, root->spt, root->role.level,
+				   PG_LEVEL_2M, start, end) {
 retry:
 		if (tdp_mmu_iter_cond_resched(kvm, &iter, flush, true)) {
 			flush = false;
 			continue;
 		}
 
-		if (!is_shadow_present_pte(iter.old_spte) ||
-		    !is_last_spte(iter.old_spte, iter.level))
+		if (iter.level > KVM_MAX_HUGEPAGE_LEVEL ||
+		    !is_shadow_present_pte(iter.old_spte) ||
+		    is_last_spte(iter.old_spte, iter.level))
 			continue;
 
-		pfn = spte_to_pfn(iter.old_spte);
-		if (kvm_is_reserved_pfn(pfn) ||
-		    iter.level >= kvm_mmu_max_mapping_level(kvm, slot, iter.gfn,
-							    pfn, PG_LEVEL_NUM))
+		if (iter.gfn < start ||
+		    iter.gfn + KVM_PAGES_PER_HPAGE(iter.level) > end)
 			continue;
 
-		if (!tdp_mmu_zap_spte_atomic(kvm, &iter)) {
-			/*
-			 * The iter must explicitly re-read the SPTE because
-			 * the atomic cmpxchg failed.
-			 */
+		/* Left to the NX huge page recovery thread. */
+		child = sptep_to_sp(rcu_dereference(
+				spte_to_child_pt(iter.old_spte, iter.level)));
+		if (child->lpage_disallowed)
+			continue;
+
+		/*
+		 * The host may be about to change what some of the range is
+		 * backed by; the leaves below will be zapped if so.
+		 */
+		if (kvm->mmu_notifier_count)
+			continue;
+
+		if (!tdp_mmu_make_huge_spte(&iter, &huge_spte))
+			continue;
+
+		if (kvm_is_reserved_pfn(spte_to_pfn(huge_spte)) ||
+		    kvm_mmu_max_mapping_level(kvm, slot, iter.gfn,
+					      spte_to_pfn(huge_spte),
+					      iter.level) < iter.level)
+			continue;
+
+		if (!tdp_mmu_set_spte_atomic_no_dirty_log(kvm, &iter,
+							  huge_spte)) {
 			iter.old_spte = READ_ONCE(*rcu_dereference(iter.sptep));
 			goto retry;
 		}
+
+		/* Don't walk into the page table that was just freed. */
+		iter.old_spte = huge_spte;
 		flush = true;
 	}
 
@@ -1461,23 +1508,160 @@ static bool zap_collapsible_spte_range(struct kvm *kvm,
 }
 
 /*
- * Clear non-leaf entries (and free associated page tables) which could
- * be replaced by large mappings, for GFNs within the slot.
+ * Recover huge mappings that were split into smaller ones, e.g. while dirty
+ * logging was enabled, without zapping them and waiting for the vCPUs to
+ * fault them back in.
  */
-bool kvm_tdp_mmu_zap_collapsible_sptes(struct kvm *kvm,
-				       const struct kvm_memory_slot *slot,
-				       bool flush)
+bool kvm_tdp_mmu_recover_huge_pages(struct kvm *kvm,
+				    const struct kvm_memory_slot *slot,
+				    bool flush)
 {
 	struct kvm_mmu_page *root;
 
 	lockdep_assert_held_read(&kvm->mmu_lock);
 
+	if (kvm_slot_dirty_track_enabled(slot))
+		return flush;
+
 	for_each_tdp_mmu_root_yield_safe(kvm, root, slot->as_id, true)
-		flush = zap_collapsible_spte_range(kvm, root, slot, flush);
+		flush = recover_huge_pages_range(kvm, root, slot, flush);
 
 	return flush;
 }
 
+static struct kvm_mmu_page *tdp_mmu_alloc_sp_for_split(gfp_t gfp)
+{
+	struct kvm_mmu_page *sp;
+
+	gfp |= __GFP_ZERO;
+
+	sp = kmem_cache_alloc(mmu_page_header_cache, gfp);
+	if (!sp)
+		return NULL;
+
+	sp->spt = (void *)__get_free_page(gfp);
+	if (!sp->spt) {
+		kmem_cache_free(mmu_page_header_cache, sp);
+		return NULL;
+	}
+
+	return sp;
+}
+
+/*
+ * Replace the huge SPTE at @iter by a page table mapping the same memory
+ * with SPTEs of the next level down.  Returns false if the SPTE changed
+ * under us, in which case @sp is left for the caller to reuse.
+ */
+static bool tdp_mmu_split_huge_page(struct kvm *kvm, struct tdp_iter *iter,
+				    struct kvm_mmu_page *sp)
+{
+	const u64 huge_spte = iter->old_spte;
+	const int level = iter->level;
+	u64 child_spte;
+	int i;
+
+	sp->role = sptep_to_sp(rcu_dereference(iter->sptep))->role;
+	sp->role.level = level - 1;
+	sp->gfn = iter->gfn;
+	sp->tdp_mmu_page = true;
+	set_page_private(virt_to_page(sp->spt), (unsigned long)sp);
+
+	for (i = 0; i < PT64_ENT_PER_PAGE; i++)
+		sp->spt[i] = make_huge_page_split_spte(huge_spte, level, i);
+
+	child_spte = make_nonleaf_spte(sp->spt, !shadow_accessed_mask);
+	if (!tdp_mmu_set_spte_atomic_no_dirty_log(kvm, iter, child_spte))
+		return false;
+
+	/* Walk into the new page table next. */
+	iter->old_spte = child_spte;
+
+	tdp_mmu_link_page(kvm, sp, false);
+	kvm_update_page_stats(kvm, level - 1, PT64_ENT_PER_PAGE);
+	trace_kvm_mmu_get_page(sp, true);
+
+	return true;
+}
+
+static int split_huge_pages_range(struct kvm *kvm, struct kvm_mmu_page *root,
+				  gfn_t start, gfn_t end, int target_level)
+{
+	struct kvm_mmu_page *sp = NULL;
+	struct tdp_iter iter;
+	int ret = 0;
+
+	rcu_read_lock();
+
+	for_each_tdp_pte_min_level(iter, root->spt, root->role.level,
+				   target_level + 1, start, end) {
+retry:
+		if (tdp_mmu_iter_cond_resched(kvm, &iter, false, true))
+			continue;
+
+		if (!is_shadow_present_pte(iter.old_spte) ||
+		    !is_large_pte(iter.old_spte))
+			continue;
+
+		if (!sp) {
+			sp = tdp_mmu_alloc_sp_for_split(GFP_NOWAIT |
+							__GFP_ACCOUNT);
+		}
+		if (!sp) {
+			/* Drop the lock to allocate, then start over. */
+			rcu_read_unlock();
+			read_unlock(&kvm->mmu_lock);
+			sp = tdp_mmu_alloc_sp_for_split(GFP_KERNEL_ACCOUNT);
+			read_lock(&kvm->mmu_lock);
+			rcu_read_lock();
+
+			if (!sp) {
+				ret = -ENOMEM;
+				break;
+			}
+
+			tdp_iter_restart(&iter);
+			continue;
+		}
+
+		if (!tdp_mmu_split_huge_page(kvm, &iter, sp)) {
+			iter.old_spte = READ_ONCE(*rcu_dereference(iter.sptep));
+			goto retry;
+		}
+		sp = NULL;
+	}
+
+	rcu_read_unlock();
+
+	if (sp)
+		tdp_mmu_free_sp(sp);
+
+	return ret;
+}
+
+/*
+ * Split huge pages in [start, end) down to @target_level ahead of time,
+ * e.g. when dirty logging is enabled, rather than have the vCPUs zap and
+ * refault them one write at a time.  No TLB flush is needed: the new
+ * SPTEs map exactly what the huge ones did.
+ */
+void kvm_tdp_mmu_try_split_huge_pages(struct kvm *kvm,
+				      const struct kvm_memory_slot *slot,
+				      gfn_t start, gfn_t end, int target_level)
+{
+	struct kvm_mmu_page *root;
+
+	lockdep_assert_held_read(&kvm->mmu_lock);
+
+	for_each_tdp_mmu_root_yield_safe(kvm, root, slot->as_id, true) {
+		if (split_huge_pages_range(kvm, root, start, end,
+					   target_level)) {
+			kvm_tdp_mmu_put_root(kvm, root, true);
+			break;
+		}
+	}
+}
+
 /*
  * Removes write access on the last level SPTE mapping this GFN and unsets the
  * MMU-writable bit to ensure future writes continue to be intercepted.
@@ -3957,7 +3957,12 @@ static inline bool kvm_vcpu_trigger_posted_interrupt(struct kvm_vcpu *vcpu,
 		 * a blocked vcpu here does not wait for any requested
 		 * interrupts in PIR, and sending a notification event
 		 * which has no effect is safe here.
+		 *
+		 * The same holds if the notification is deferred until
+		 * the end of a multi-destination IPI.
 		 */
+		if (!nested && kvm_lapic_defer_pi_notification(vcpu->cpu))
+			return true;
 
 		apic->send_IPI_mask(get_cpu_mask(vcpu->cpu), pi_vec);
 		return true;
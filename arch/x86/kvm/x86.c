@@ -1962,8 +1962,12 @@ static int handle_fastpath_set_x2apic_icr_irqoff(struct kvm_vcpu *vcpu, u64 data
 	if (!lapic_in_kernel(vcpu) || !apic_x2apic_mode(vcpu->arch.apic))
 		return 1;
 
+	/*
+	 * Logical destinations are taken too: x2APIC cluster mode is how
+	 * guests send multi-destination IPIs (TLB shootdowns, RCU), which
+	 * are then delivered with a single batch of notifications.
+	 */
 	if (((data & APIC_SHORT_MASK) == APIC_DEST_NOSHORT) &&
-		((data & APIC_DEST_MASK) == APIC_DEST_PHYSICAL) &&
 		((data & APIC_MODE_MASK) == APIC_DM_FIXED) &&
 		((u32)(data >> 32) != X2APIC_BROADCAST)) {
 
@@ -11633,7 +11637,8 @@ static void kvm_mmu_slot_apply_flags(struct kvm *kvm,
 		 *
 		 * Scan sptes if dirty logging has been stopped, dropping those
 		 * which can be collapsed into a single large-page spte.  Later
-		 * page faults will create the large-page sptes.
+		 * page faults will create the large-page sptes.  The TDP MMU
+		 * instead installs the large-page sptes in place.
 		 */
 		kvm_mmu_zap_collapsible_sptes(kvm, new);
 	} else {
@@ -11644,6 +11649,12 @@ static void kvm_mmu_slot_apply_flags(struct kvm *kvm,
 		if (kvm_dirty_log_manual_protect_and_init_set(kvm))
 			return;
 
+		/*
+		 * Split large sptes now rather than have every vCPU fault
+		 * on them as soon as it writes.
+		 */
+		kvm_mmu_slot_try_split_huge_pages(kvm, new, PG_LEVEL_4K);
+
 		if (kvm_x86_ops.cpu_dirty_log_size) {
 			kvm_mmu_slot_leaf_clear_dirty(kvm, new);
 			kvm_mmu_slot_remove_write_access(kvm, new, PG_LEVEL_2M);
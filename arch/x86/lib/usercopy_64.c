@@ -9,6 +9,22 @@
 #include <linux/export.h>
 #include <linux/uaccess.h>
 #include <linux/highmem.h>
+#include <linux/debugfs.h>
+
+/*
+ * Copies shorter than this don't use 'rep movsb' in
+ * copy_user_enhanced_fast_string(), unless the CPU has FSRM.  The best
+ * value depends on the microarchitecture, hence the debugfs knob.
+ */
+unsigned int copy_user_rep_threshold __read_mostly = 64;
+
+static int __init copy_user_debugfs_init(void)
+{
+	debugfs_create_u32("copy_user_rep_threshold", 0600, arch_debugfs_dir,
+			   &copy_user_rep_threshold);
+	return 0;
+}
+late_initcall(copy_user_debugfs_init);
 
 /*
  * Zero Userspace
@@ -116,6 +116,74 @@ int crypto_aead_decrypt(struct aead_request *req)
 }
 EXPORT_SYMBOL_GPL(crypto_aead_decrypt);
 
+static int crypto_aead_batch_result(unsigned int nr, const int *errs)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr; i++)
+		if (errs[i])
+			return errs[i];
+	return 0;
+}
+
+/* See crypto_skcipher_can_batch() */
+static bool crypto_aead_can_batch(struct crypto_aead *aead, bool enc)
+{
+	struct aead_alg *alg = crypto_aead_alg(aead);
+
+	if (IS_ENABLED(CONFIG_CRYPTO_STATS) ||
+	    crypto_aead_get_flags(aead) & CRYPTO_TFM_NEED_KEY)
+		return false;
+	return enc ? alg->encrypt_batch : alg->decrypt_batch;
+}
+
+int crypto_aead_encrypt_batch(struct aead_request **reqs, unsigned int nr,
+			      int *errs)
+{
+	struct crypto_aead *aead;
+	unsigned int i;
+
+	if (!nr)
+		return 0;
+
+	aead = crypto_aead_reqtfm(reqs[0]);
+	if (crypto_aead_can_batch(aead, true))
+		crypto_aead_alg(aead)->encrypt_batch(reqs, nr, errs);
+	else
+		for (i = 0; i < nr; i++)
+			errs[i] = crypto_aead_encrypt(reqs[i]);
+
+	return crypto_aead_batch_result(nr, errs);
+}
+EXPORT_SYMBOL_GPL(crypto_aead_encrypt_batch);
+
+int crypto_aead_decrypt_batch(struct aead_request **reqs, unsigned int nr,
+			      int *errs)
+{
+	struct crypto_aead *aead;
+	bool batch;
+	unsigned int i;
+
+	if (!nr)
+		return 0;
+
+	aead = crypto_aead_reqtfm(reqs[0]);
+	batch = crypto_aead_can_batch(aead, false);
+	/* Requests too short for a tag are rejected one by one */
+	for (i = 0; batch && i < nr; i++)
+		if (reqs[i]->cryptlen < crypto_aead_authsize(aead))
+			batch = false;
+
+	if (batch)
+		crypto_aead_alg(aead)->decrypt_batch(reqs, nr, errs);
+	else
+		for (i = 0; i < nr; i++)
+			errs[i] = crypto_aead_decrypt(reqs[i]);
+
+	return crypto_aead_batch_result(nr, errs);
+}
+EXPORT_SYMBOL_GPL(crypto_aead_decrypt_batch);
+
 static void crypto_aead_exit_tfm(struct crypto_tfm *tfm)
 {
 	struct crypto_aead *aead = __crypto_aead_cast(tfm);
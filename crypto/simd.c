@@ -101,6 +101,58 @@ static int simd_skcipher_decrypt(struct skcipher_request *req)
 	return crypto_skcipher_decrypt(subreq);
 }
 
+/*
+ * Batched requests are forwarded to the child in chunks of this size, so
+ * that the array of subrequests can live on the stack.
+ */
+#define SIMD_BATCH_CHUNK	16
+
+static struct crypto_skcipher *simd_skcipher_child(struct crypto_skcipher *tfm)
+{
+	struct simd_skcipher_ctx *ctx = crypto_skcipher_ctx(tfm);
+
+	if (!crypto_simd_usable() ||
+	    (in_atomic() && cryptd_skcipher_queued(ctx->cryptd_tfm)))
+		return &ctx->cryptd_tfm->base;
+	return cryptd_skcipher_child(ctx->cryptd_tfm);
+}
+
+static void simd_skcipher_crypt_batch(struct skcipher_request **reqs,
+				      unsigned int nr, int *errs, bool enc)
+{
+	struct crypto_skcipher *child;
+	struct skcipher_request *subreqs[SIMD_BATCH_CHUNK];
+	unsigned int i, n;
+
+	/* One decision for the whole batch keeps the requests in order. */
+	child = simd_skcipher_child(crypto_skcipher_reqtfm(reqs[0]));
+
+	for (; nr; reqs += n, errs += n, nr -= n) {
+		n = min_t(unsigned int, nr, SIMD_BATCH_CHUNK);
+		for (i = 0; i < n; i++) {
+			subreqs[i] = skcipher_request_ctx(reqs[i]);
+			*subreqs[i] = *reqs[i];
+			skcipher_request_set_tfm(subreqs[i], child);
+		}
+		if (enc)
+			crypto_skcipher_encrypt_batch(subreqs, n, errs);
+		else
+			crypto_skcipher_decrypt_batch(subreqs, n, errs);
+	}
+}
+
+static void simd_skcipher_encrypt_batch(struct skcipher_request **reqs,
+					unsigned int nr, int *errs)
+{
+	simd_skcipher_crypt_batch(reqs, nr, errs, true);
+}
+
+static void simd_skcipher_decrypt_batch(struct skcipher_request **reqs,
+					unsigned int nr, int *errs)
+{
+	simd_skcipher_crypt_batch(reqs, nr, errs, false);
+}
+
 static void simd_skcipher_exit(struct crypto_skcipher *tfm)
 {
 	struct simd_skcipher_ctx *ctx = crypto_skcipher_ctx(tfm);
@@ -190,6 +242,8 @@ struct simd_skcipher_alg *simd_skcipher_create_compat(const char *algname,
 	alg->setkey = simd_skcipher_setkey;
 	alg->encrypt = simd_skcipher_encrypt;
 	alg->decrypt = simd_skcipher_decrypt;
+	alg->encrypt_batch = simd_skcipher_encrypt_batch;
+	alg->decrypt_batch = simd_skcipher_decrypt_batch;
 
 	err = crypto_register_skcipher(alg);
 	if (err)
@@ -349,6 +403,51 @@ static int simd_aead_decrypt(struct aead_request *req)
 	return crypto_aead_decrypt(subreq);
 }
 
+static struct crypto_aead *simd_aead_child(struct crypto_aead *tfm)
+{
+	struct simd_aead_ctx *ctx = crypto_aead_ctx(tfm);
+
+	if (!crypto_simd_usable() ||
+	    (in_atomic() && cryptd_aead_queued(ctx->cryptd_tfm)))
+		return &ctx->cryptd_tfm->base;
+	return cryptd_aead_child(ctx->cryptd_tfm);
+}
+
+static void simd_aead_crypt_batch(struct aead_request **reqs, unsigned int nr,
+				  int *errs, bool enc)
+{
+	struct crypto_aead *child;
+	struct aead_request *subreqs[SIMD_BATCH_CHUNK];
+	unsigned int i, n;
+
+	child = simd_aead_child(crypto_aead_reqtfm(reqs[0]));
+
+	for (; nr; reqs += n, errs += n, nr -= n) {
+		n = min_t(unsigned int, nr, SIMD_BATCH_CHUNK);
+		for (i = 0; i < n; i++) {
+			subreqs[i] = aead_request_ctx(reqs[i]);
+			*subreqs[i] = *reqs[i];
+			aead_request_set_tfm(subreqs[i], child);
+		}
+		if (enc)
+			crypto_aead_encrypt_batch(subreqs, n, errs);
+		else
+			crypto_aead_decrypt_batch(subreqs, n, errs);
+	}
+}
+
+static void simd_aead_encrypt_batch(struct aead_request **reqs,
+				    unsigned int nr, int *errs)
+{
+	simd_aead_crypt_batch(reqs, nr, errs, true);
+}
+
+static void simd_aead_decrypt_batch(struct aead_request **reqs,
+				    unsigned int nr, int *errs)
+{
+	simd_aead_crypt_batch(reqs, nr, errs, false);
+}
+
 static void simd_aead_exit(struct crypto_aead *tfm)
 {
 	struct simd_aead_ctx *ctx = crypto_aead_ctx(tfm);
@@ -437,6 +536,8 @@ struct simd_aead_alg *simd_aead_create_compat(const char *algname,
 	alg->setauthsize = simd_aead_setauthsize;
 	alg->encrypt = simd_aead_encrypt;
 	alg->decrypt = simd_aead_decrypt;
+	alg->encrypt_batch = simd_aead_encrypt_batch;
+	alg->decrypt_batch = simd_aead_decrypt_batch;
 
 	err = crypto_register_aead(alg);
 	if (err)
@@ -650,6 +650,71 @@ int crypto_skcipher_decrypt(struct skcipher_request *req)
 }
 EXPORT_SYMBOL_GPL(crypto_skcipher_decrypt);
 
+static int crypto_skcipher_batch_result(unsigned int nr, const int *errs)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr; i++)
+		if (errs[i])
+			return errs[i];
+	return 0;
+}
+
+/*
+ * The batch hooks bypass the per-request statistics, which need each
+ * request's length sampled before it may complete, so CRYPTO_STATS
+ * kernels always take the per-request path.
+ */
+static bool crypto_skcipher_can_batch(struct crypto_skcipher *tfm, bool enc)
+{
+	struct skcipher_alg *alg = crypto_skcipher_alg(tfm);
+
+	if (IS_ENABLED(CONFIG_CRYPTO_STATS) ||
+	    crypto_skcipher_get_flags(tfm) & CRYPTO_TFM_NEED_KEY)
+		return false;
+	return enc ? alg->encrypt_batch : alg->decrypt_batch;
+}
+
+int crypto_skcipher_encrypt_batch(struct skcipher_request **reqs,
+				  unsigned int nr, int *errs)
+{
+	struct crypto_skcipher *tfm;
+	unsigned int i;
+
+	if (!nr)
+		return 0;
+
+	tfm = crypto_skcipher_reqtfm(reqs[0]);
+	if (crypto_skcipher_can_batch(tfm, true))
+		crypto_skcipher_alg(tfm)->encrypt_batch(reqs, nr, errs);
+	else
+		for (i = 0; i < nr; i++)
+			errs[i] = crypto_skcipher_encrypt(reqs[i]);
+
+	return crypto_skcipher_batch_result(nr, errs);
+}
+EXPORT_SYMBOL_GPL(crypto_skcipher_encrypt_batch);
+
+int crypto_skcipher_decrypt_batch(struct skcipher_request **reqs,
+				  unsigned int nr, int *errs)
+{
+	struct crypto_skcipher *tfm;
+	unsigned int i;
+
+	if (!nr)
+		return 0;
+
+	tfm = crypto_skcipher_reqtfm(reqs[0]);
+	if (crypto_skcipher_can_batch(tfm, false))
+		crypto_skcipher_alg(tfm)->decrypt_batch(reqs, nr, errs);
+	else
+		for (i = 0; i < nr; i++)
+			errs[i] = crypto_skcipher_decrypt(reqs[i]);
+
+	return crypto_skcipher_batch_result(nr, errs);
+}
+EXPORT_SYMBOL_GPL(crypto_skcipher_decrypt_batch);
+
 static void crypto_skcipher_exit_tfm(struct crypto_tfm *tfm)
 {
 	struct crypto_skcipher *skcipher = __crypto_skcipher_cast(tfm);
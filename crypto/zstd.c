@@ -19,9 +19,7 @@
 
 struct zstd_ctx {
 	ZSTD_CCtx *cctx;
-	ZSTD_DCtx *dctx;
 	void *cwksp;
-	void *dwksp;
 };
 
 static ZSTD_parameters zstd_params(void)
@@ -53,27 +51,10 @@ static int zstd_comp_init(struct zstd_ctx *ctx)
 	goto out;
 }
 
+/* Decompression contexts come from the shared per-CPU pool in lib/zstd */
 static int zstd_decomp_init(struct zstd_ctx *ctx)
 {
-	int ret = 0;
-	const size_t wksp_size = ZSTD_DCtxWorkspaceBound();
-
-	ctx->dwksp = vzalloc(wksp_size);
-	if (!ctx->dwksp) {
-		ret = -ENOMEM;
-		goto out;
-	}
-
-	ctx->dctx = ZSTD_initDCtx(ctx->dwksp, wksp_size);
-	if (!ctx->dctx) {
-		ret = -EINVAL;
-		goto out_free;
-	}
-out:
-	return ret;
-out_free:
-	vfree(ctx->dwksp);
-	goto out;
+	return zstd_dpool_register();
 }
 
 static void zstd_comp_exit(struct zstd_ctx *ctx)
@@ -85,9 +66,7 @@ static void zstd_comp_exit(struct zstd_ctx *ctx)
 
 static void zstd_decomp_exit(struct zstd_ctx *ctx)
 {
-	vfree(ctx->dwksp);
-	ctx->dwksp = NULL;
-	ctx->dctx = NULL;
+	zstd_dpool_unregister();
 }
 
 static int __zstd_init(void *ctx)
@@ -180,9 +159,8 @@ static int __zstd_decompress(const u8 *src, unsigned int slen,
 			     u8 *dst, unsigned int *dlen, void *ctx)
 {
 	size_t out_len;
-	struct zstd_ctx *zctx = ctx;
 
-	out_len = ZSTD_decompressDCtx(zctx->dctx, dst, *dlen, src, slen);
+	out_len = zstd_dpool_decompress(dst, *dlen, src, slen, NULL);
 	if (ZSTD_isError(out_len))
 		return -EINVAL;
 	*dlen = out_len;
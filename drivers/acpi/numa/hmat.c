@@ -677,6 +677,62 @@ static void hmat_register_target_initiators(struct memory_target *target)
 	}
 }
 
+/* Best read latency any CPU initiator sees to @target, 0 if unknown */
+static u32 hmat_target_read_latency(struct memory_target *target)
+{
+	struct memory_locality *loc = localities_types[READ_LATENCY];
+	struct memory_initiator *initiator;
+	u32 best = 0;
+
+	if (!loc)
+		return 0;
+
+	list_for_each_entry(initiator, &initiators, node) {
+		if (!initiator->has_cpu)
+			continue;
+		hmat_update_best(loc->hmat_loc->data_type,
+				 hmat_initiator_perf(target, initiator,
+						     loc->hmat_loc),
+				 &best);
+	}
+	return best;
+}
+
+/**
+ * hmat_node_is_slow - check whether a memory node is a tier below DRAM
+ * @nid: memory node, which may not be online yet
+ *
+ * Return: 1 if the best read latency of @nid is higher than that of every
+ * node with CPUs, 0 if not and -ENOENT if HMAT doesn't tell.
+ */
+int hmat_node_is_slow(int nid)
+{
+	struct memory_target *target, *t;
+	u32 latency, dram_latency = 0;
+	int ret = -ENOENT;
+
+	mutex_lock(&target_lock);
+	target = find_mem_target(node_to_pxm(nid));
+	latency = target ? hmat_target_read_latency(target) : 0;
+	if (!latency)
+		goto out;
+
+	list_for_each_entry(t, &targets, node) {
+		int t_nid = pxm_to_node(t->memory_pxm);
+
+		if (t == target || t_nid == NUMA_NO_NODE ||
+		    !node_state(t_nid, N_CPU))
+			continue;
+		dram_latency = max(dram_latency, hmat_target_read_latency(t));
+	}
+	if (dram_latency)
+		ret = latency > dram_latency;
+out:
+	mutex_unlock(&target_lock);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(hmat_node_is_slow);
+
 static void hmat_register_target_cache(struct memory_target *target)
 {
 	unsigned mem_nid = pxm_to_node(target->memory_pxm);
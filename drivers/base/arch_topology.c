@@ -852,6 +852,30 @@ static int __init parse_cluster(struct device_node *cluster, int depth)
 
 	return 0;
 }
+/*
+ * CPUs whose next-level-cache is the same node share their first cache
+ * outside the core, usually an L2, and are treated as a cluster.
+ */
+static void __init parse_dt_cluster_cache(void)
+{
+	struct device_node *cn, *cache;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		cn = of_get_cpu_node(cpu, NULL);
+		if (!cn)
+			continue;
+
+		cache = of_find_next_cache_node(cn);
+		of_node_put(cn);
+		if (!cache)
+			continue;
+
+		cpu_topology[cpu].cluster_id = cache->phandle;
+		of_node_put(cache);
+	}
+}
+
 /*
  * IAMROOT, 2022.12.10:
  * - 	cpus {
@@ -934,6 +958,7 @@ static int __init parse_dt_topology(void)
 	if (ret != 0)
 		goto out_map;
 
+	parse_dt_cluster_cache();
 	topology_normalize_cpu_scale();
 
 	/*
@@ -991,6 +1016,19 @@ const struct cpumask *cpu_coregroup_mask(int cpu)
 	return core_mask;
 }
 
+const struct cpumask *cpu_clustergroup_mask(int cpu)
+{
+	/*
+	 * Forbid cpu_clustergroup_mask() to span more or the same CPUs as
+	 * cpu_coregroup_mask().
+	 */
+	if (cpumask_subset(cpu_coregroup_mask(cpu),
+			   &cpu_topology[cpu].cluster_sibling))
+		return get_cpu_mask(cpu);
+
+	return &cpu_topology[cpu].cluster_sibling;
+}
+
 void update_siblings_masks(unsigned int cpuid)
 {
 	struct cpu_topology *cpu_topo, *cpuid_topo = &cpu_topology[cpuid];
@@ -1008,6 +1046,12 @@ void update_siblings_masks(unsigned int cpuid)
 		if (cpuid_topo->package_id != cpu_topo->package_id)
 			continue;
 
+		if (cpuid_topo->cluster_id == cpu_topo->cluster_id &&
+		    cpuid_topo->cluster_id != -1) {
+			cpumask_set_cpu(cpu, &cpuid_topo->cluster_sibling);
+			cpumask_set_cpu(cpuid, &cpu_topo->cluster_sibling);
+		}
+
 		cpumask_set_cpu(cpuid, &cpu_topo->core_sibling);
 		cpumask_set_cpu(cpu, &cpuid_topo->core_sibling);
 
@@ -1028,6 +1072,8 @@ static void clear_cpu_topology(int cpu)
 
 	cpumask_clear(&cpu_topo->core_sibling);
 	cpumask_set_cpu(cpu, &cpu_topo->core_sibling);
+	cpumask_clear(&cpu_topo->cluster_sibling);
+	cpumask_set_cpu(cpu, &cpu_topo->cluster_sibling);
 	cpumask_clear(&cpu_topo->thread_sibling);
 	cpumask_set_cpu(cpu, &cpu_topo->thread_sibling);
 }
@@ -1041,6 +1087,7 @@ void __init reset_cpu_topology(void)
 
 		cpu_topo->thread_id = -1;
 		cpu_topo->core_id = -1;
+		cpu_topo->cluster_id = -1;
 		cpu_topo->package_id = -1;
 		cpu_topo->llc_id = -1;
 
@@ -1056,6 +1103,8 @@ void remove_cpu_topology(unsigned int cpu)
 		cpumask_clear_cpu(cpu, topology_core_cpumask(sibling));
 	for_each_cpu(sibling, topology_sibling_cpumask(cpu))
 		cpumask_clear_cpu(cpu, topology_sibling_cpumask(sibling));
+	for_each_cpu(sibling, topology_cluster_cpumask(cpu))
+		cpumask_clear_cpu(cpu, topology_cluster_cpumask(sibling));
 	for_each_cpu(sibling, topology_llc_cpumask(cpu))
 		cpumask_clear_cpu(cpu, topology_llc_cpumask(sibling));
 
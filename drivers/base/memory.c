@@ -779,6 +779,142 @@ bool is_memblock_offlined(struct memory_block *mem)
 	return mem->state == MEM_OFFLINE;
 }
 
+/*
+ * Online @nr_blocks adjacent offline memory blocks starting at @block_id with
+ * a single online_pages() call.  The caller checked that they belong to the
+ * same node and memory group and that none of them carries its own memmap.
+ *
+ * Called under device_hotplug_lock.
+ */
+static int memory_blocks_online(unsigned long block_id,
+				unsigned long nr_blocks, int online_type)
+{
+	unsigned long nr_pages = PAGES_PER_SECTION * sections_per_block;
+	struct memory_block *mem;
+	unsigned long start_pfn, id;
+	struct zone *zone;
+	int ret;
+
+	mem = find_memory_block_by_id(block_id);
+	if (!mem)
+		return -EINVAL;
+
+	start_pfn = section_nr_to_pfn(mem->start_section_nr);
+	nr_pages *= nr_blocks;
+	zone = zone_for_pfn_range(online_type, mem->nid, mem->group,
+				  start_pfn, nr_pages);
+	ret = online_pages(start_pfn, nr_pages, zone, mem->group);
+	put_device(&mem->dev);
+	if (ret)
+		return ret;
+
+	/* What device_online() would have done for every block */
+	for (id = block_id; id < block_id + nr_blocks; id++) {
+		mem = find_memory_block_by_id(id);
+		device_lock(&mem->dev);
+		mem->state = MEM_ONLINE;
+		mem->dev.offline = false;
+		kobject_uevent(&mem->dev.kobj, KOBJ_ONLINE);
+		device_unlock(&mem->dev);
+		put_device(&mem->dev);
+	}
+
+	return 0;
+}
+
+static bool memory_block_batchable(struct memory_block *mem,
+				   struct memory_block *first)
+{
+	if (mem->state != MEM_OFFLINE || mem->nr_vmemmap_pages)
+		return false;
+
+	return !first || (mem->nid == first->nid && mem->group == first->group);
+}
+
+/*
+ * Batched onlining: writing "<start> <size> [online_type]", start and size in
+ * hex, onlines every offline memory block in that physical range.  Runs of
+ * blocks that can share one online_pages() call get their memmap initialized
+ * in parallel, the others are onlined one by one as if written to their
+ * "state" file.
+ */
+static ssize_t online_blocks_store(struct device *dev,
+				   struct device_attribute *attr,
+				   const char *buf, size_t count)
+{
+	unsigned long block_size = memory_block_size_bytes();
+	unsigned long end_id, run_id = 0, nr_run = 0, id;
+	struct memory_block *mem, *first = NULL;
+	char type[16] = "online";
+	int online_type, ret;
+	u64 start, size;
+
+	if (sscanf(buf, "%llx %llx %15s", &start, &size, type) < 2)
+		return -EINVAL;
+
+	online_type = mhp_online_type_from_str(type);
+	if (online_type < 0 || online_type == MMOP_OFFLINE)
+		return -EINVAL;
+
+	if (!size || !IS_ALIGNED(start | size, block_size))
+		return -EINVAL;
+
+	ret = lock_device_hotplug_sysfs();
+	if (ret)
+		return ret;
+
+	end_id = phys_to_block_id(start + size);
+	for (id = phys_to_block_id(start); id < end_id; id++) {
+		mem = find_memory_block_by_id(id);
+		if (!mem) {
+			ret = -EINVAL;
+			break;
+		}
+		/* memory blocks can't go away under device_hotplug_lock */
+		put_device(&mem->dev);
+
+		if (memory_block_batchable(mem, first)) {
+			if (!nr_run++) {
+				first = mem;
+				run_id = id;
+			}
+			continue;
+		}
+
+		if (nr_run) {
+			ret = memory_blocks_online(run_id, nr_run, online_type);
+			if (ret)
+				break;
+			nr_run = 0;
+			first = NULL;
+			if (memory_block_batchable(mem, NULL)) {
+				first = mem;
+				run_id = id;
+				nr_run = 1;
+				continue;
+			}
+		}
+
+		if (mem->state == MEM_OFFLINE) {
+			/* mem->online_type is protected by device_hotplug_lock */
+			mem->online_type = online_type;
+			ret = device_online(&mem->dev);
+			if (ret > 0)
+				ret = -EINVAL;
+			if (ret)
+				break;
+		}
+	}
+	if (!ret && nr_run)
+		ret = memory_blocks_online(run_id, nr_run, online_type);
+
+	unlock_device_hotplug();
+
+	return ret ? ret : count;
+}
+
+static DEVICE_ATTR_WO(online_blocks);
+
 static struct attribute *memory_root_attrs[] = {
 #ifdef CONFIG_ARCH_MEMORY_PROBE
 	&dev_attr_probe.attr,
@@ -791,6 +927,7 @@ static struct attribute *memory_root_attrs[] = {
 
 	&dev_attr_block_size_bytes.attr,
 	&dev_attr_auto_online_blocks.attr,
+	&dev_attr_online_blocks.attr,
 	NULL
 };
 
@@ -1038,6 +1038,7 @@ static struct node_attr node_state_attr[] = {
 	[N_CPU] = _NODE_ATTR(has_cpu, N_CPU),
 	[N_GENERIC_INITIATOR] = _NODE_ATTR(has_generic_initiator,
 					   N_GENERIC_INITIATOR),
+	[N_SLOW_MEMORY] = _NODE_ATTR(has_slow_memory, N_SLOW_MEMORY),
 };
 
 static struct attribute *node_state_attrs[] = {
@@ -1050,6 +1051,7 @@ static struct attribute *node_state_attrs[] = {
 	&node_state_attr[N_MEMORY].attr.attr,
 	&node_state_attr[N_CPU].attr.attr,
 	&node_state_attr[N_GENERIC_INITIATOR].attr.attr,
+	&node_state_attr[N_SLOW_MEMORY].attr.attr,
 	NULL
 };
 
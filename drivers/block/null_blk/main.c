@@ -9,6 +9,7 @@
 #include <linux/sched.h>
 #include <linux/fs.h>
 #include <linux/init.h>
+#include <linux/random.h>
 #include "null_blk.h"
 
 #define FREE_BATCH		16
@@ -367,6 +368,15 @@ NULLB_DEVICE_ATTR(zone_nr_conv, uint, NULL);
 NULLB_DEVICE_ATTR(zone_max_open, uint, NULL);
 NULLB_DEVICE_ATTR(zone_max_active, uint, NULL);
 NULLB_DEVICE_ATTR(virt_boundary, bool, NULL);
+NULLB_DEVICE_ATTR(latency_spread, uint, NULL);
+NULLB_DEVICE_ATTR(latency_slow_nsec, ulong, NULL);
+NULLB_DEVICE_ATTR(latency_slow_pct, uint, NULL);
+NULLB_DEVICE_ATTR(tail_nsec, ulong, NULL);
+NULLB_DEVICE_ATTR(tail_ppm, uint, NULL);
+NULLB_DEVICE_ATTR(sat_depth, uint, NULL);
+NULLB_DEVICE_ATTR(zone_wp_nsec, ulong, NULL);
+NULLB_DEVICE_ATTR(remote_completion, bool, NULL);
+NULLB_DEVICE_ATTR(completion_cpu, uint, NULL);
 
 static ssize_t nullb_device_power_show(struct config_item *item, char *page)
 {
@@ -488,6 +498,15 @@ static struct configfs_attribute *nullb_device_attrs[] = {
 	&nullb_device_attr_zone_max_open,
 	&nullb_device_attr_zone_max_active,
 	&nullb_device_attr_virt_boundary,
+	&nullb_device_attr_latency_spread,
+	&nullb_device_attr_latency_slow_nsec,
+	&nullb_device_attr_latency_slow_pct,
+	&nullb_device_attr_tail_nsec,
+	&nullb_device_attr_tail_ppm,
+	&nullb_device_attr_sat_depth,
+	&nullb_device_attr_zone_wp_nsec,
+	&nullb_device_attr_remote_completion,
+	&nullb_device_attr_completion_cpu,
 	NULL,
 };
 
@@ -660,6 +679,7 @@ static struct nullb_cmd *__alloc_cmd(struct nullb_queue *nq)
 		cmd->tag = tag;
 		cmd->error = BLK_STS_OK;
 		cmd->nq = nq;
+		cmd->zone_delay_nsec = 0;
 		if (nq->dev->irqmode == NULL_IRQ_TIMER) {
 			hrtimer_init(&cmd->timer, CLOCK_MONOTONIC,
 				     HRTIMER_MODE_REL);
@@ -710,16 +730,84 @@ static void end_cmd(struct nullb_cmd *cmd)
 	free_cmd(cmd);
 }
 
+static void null_cmd_end_remote(void *data)
+{
+	end_cmd(data);
+}
+
 static enum hrtimer_restart null_cmd_timer_expired(struct hrtimer *timer)
 {
-	end_cmd(container_of(timer, struct nullb_cmd, timer));
+	struct nullb_cmd *cmd = container_of(timer, struct nullb_cmd, timer);
+	struct nullb_device *dev = cmd->nq->dev;
+	unsigned int cpu = dev->completion_cpu;
+
+	if (cmd->inflight) {
+		atomic_dec(&dev->nullb->inflight);
+		cmd->inflight = false;
+	}
+
+	/* emulate a device interrupt that is steered to another CPU */
+	if (dev->remote_completion && cpu != smp_processor_id() &&
+	    cpu_online(cpu)) {
+		INIT_CSD(&cmd->csd, null_cmd_end_remote, cmd);
+		smp_call_function_single_async(cpu, &cmd->csd);
+	} else {
+		end_cmd(cmd);
+	}
 
 	return HRTIMER_NORESTART;
 }
 
+/* number of uniform factors multiplied for the log-normal approximation */
+#define NULL_LATENCY_FACTORS	4
+
+/*
+ * Draw the completion time of a timer-completed command:
+ *
+ * - latency_slow_pct percent of the commands take latency_slow_nsec
+ *   instead of completion_nsec, giving a bimodal distribution;
+ * - with latency_spread set, the time is multiplied by a few factors drawn
+ *   uniformly from [1 - spread, 1 + spread].  Their product is right-skewed
+ *   and close to log-normal, without needing floating point;
+ * - tail_ppm commands per million get tail_nsec added on top;
+ * - once more than sat_depth commands are outstanding, the device is
+ *   saturated and the time grows linearly with the queue depth;
+ * - zoned writes wait for earlier writes to the same zone, see
+ *   null_zone_write().
+ */
+static u64 null_cmd_latency(struct nullb_cmd *cmd)
+{
+	struct nullb_device *dev = cmd->nq->dev;
+	u64 nsec = dev->completion_nsec;
+	unsigned int spread = dev->latency_spread;
+	int i;
+
+	if (dev->latency_slow_pct &&
+	    prandom_u32_max(100) < dev->latency_slow_pct)
+		nsec = dev->latency_slow_nsec;
+
+	for (i = 0; spread && i < NULL_LATENCY_FACTORS; i++)
+		nsec = div_u64(nsec * (100 - spread +
+				       prandom_u32_max(2 * spread + 1)), 100);
+
+	if (dev->tail_ppm && prandom_u32_max(1000000) < dev->tail_ppm)
+		nsec += dev->tail_nsec;
+
+	if (dev->sat_depth) {
+		unsigned int inflight =
+			atomic_inc_return(&dev->nullb->inflight);
+
+		cmd->inflight = true;
+		if (inflight > dev->sat_depth)
+			nsec = div_u64(nsec * inflight, dev->sat_depth);
+	}
+
+	return nsec + cmd->zone_delay_nsec;
+}
+
 static void null_cmd_end_timer(struct nullb_cmd *cmd)
 {
-	ktime_t kt = cmd->nq->dev->completion_nsec;
+	ktime_t kt = null_cmd_latency(cmd);
 
 	hrtimer_start(&cmd->timer, kt, HRTIMER_MODE_REL);
 }
@@ -1491,6 +1579,7 @@ static blk_status_t null_queue_rq(struct blk_mq_hw_ctx *hctx,
 	cmd->rq = bd->rq;
 	cmd->error = BLK_STS_OK;
 	cmd->nq = nq;
+	cmd->zone_delay_nsec = 0;
 	cmd->fake_timeout = should_timeout_request(bd->rq);
 
 	blk_mq_start_request(bd->rq);
@@ -1757,6 +1846,14 @@ static int null_validate_conf(struct nullb_device *dev)
 
 	dev->queue_mode = min_t(unsigned int, dev->queue_mode, NULL_Q_MQ);
 	dev->irqmode = min_t(unsigned int, dev->irqmode, NULL_IRQ_TIMER);
+	dev->latency_spread = min_t(unsigned int, dev->latency_spread, 99);
+	dev->latency_slow_pct = min_t(unsigned int, dev->latency_slow_pct, 100);
+	dev->tail_ppm = min_t(unsigned int, dev->tail_ppm, 1000000);
+	if (dev->remote_completion && dev->completion_cpu >= nr_cpu_ids) {
+		pr_err("completion_cpu %u is not a valid CPU\n",
+		       dev->completion_cpu);
+		return -EINVAL;
+	}
 
 	/* Do memory allocation, so set blocking */
 	if (dev->memory_backed)
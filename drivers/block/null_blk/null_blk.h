@@ -22,7 +22,10 @@ struct nullb_cmd {
 	blk_status_t error;
 	struct nullb_queue *nq;
 	struct hrtimer timer;
+	call_single_data_t csd;
+	u64 zone_delay_nsec; /* write pointer serialization delay */
 	bool fake_timeout;
+	bool inflight; /* counted in nullb->inflight */
 };
 
 struct nullb_queue {
@@ -53,6 +56,7 @@ struct nullb_zone {
 	sector_t wp;
 	unsigned int len;
 	unsigned int capacity;
+	ktime_t wp_busy_until; /* completion time of the last write */
 };
 
 struct nullb_device {
@@ -79,6 +83,9 @@ struct nullb_device {
 	unsigned long cache_size; /* disk cache size in MB */
 	unsigned long zone_size; /* zone size in MB if device is zoned */
 	unsigned long zone_capacity; /* zone capacity in MB if device is zoned */
+	unsigned long latency_slow_nsec; /* completion time of the slow mode */
+	unsigned long tail_nsec; /* extra time added to tail spikes */
+	unsigned long zone_wp_nsec; /* time to advance a zone write pointer */
 	unsigned int zone_nr_conv; /* number of conventional zones */
 	unsigned int zone_max_open; /* max number of open zones */
 	unsigned int zone_max_active; /* max number of active zones */
@@ -91,6 +98,11 @@ struct nullb_device {
 	unsigned int hw_queue_depth; /* queue depth */
 	unsigned int index; /* index of the disk, only valid with a disk */
 	unsigned int mbps; /* Bandwidth throttle cap (in MB/s) */
+	unsigned int latency_spread; /* log-normal jitter, in % */
+	unsigned int latency_slow_pct; /* % of commands in the slow mode */
+	unsigned int tail_ppm; /* tail spikes per million commands */
+	unsigned int sat_depth; /* commands the device serves concurrently */
+	unsigned int completion_cpu; /* CPU to complete commands on */
 	bool blocking; /* blocking blk-mq device */
 	bool use_per_node_hctx; /* use per-node allocation for hardware context */
 	bool power; /* power on/off the device */
@@ -98,6 +110,7 @@ struct nullb_device {
 	bool discard; /* if support discard */
 	bool zoned; /* if device is zoned */
 	bool virt_boundary; /* virtual boundary on/off for the device */
+	bool remote_completion; /* complete on completion_cpu */
 };
 
 struct nullb {
@@ -110,6 +123,7 @@ struct nullb {
 	struct blk_mq_tag_set __tag_set;
 	unsigned int queue_depth;
 	atomic_long_t cur_bytes;
+	atomic_t inflight; /* timer commands, only counted with sat_depth */
 	struct hrtimer bw_timer;
 	unsigned long cache_flush_pos;
 	spinlock_t lock;
@@ -435,6 +435,19 @@ static blk_status_t null_zone_write(struct nullb_cmd *cmd, sector_t sector,
 	if (ret != BLK_STS_OK)
 		goto unlock;
 
+	/*
+	 * Writes to a zone are executed in write pointer order: a write only
+	 * completes zone_wp_nsec after the previous write to the same zone.
+	 */
+	if (dev->zone_wp_nsec) {
+		ktime_t now = ktime_get();
+
+		zone->wp_busy_until = ktime_add_ns(max(now, zone->wp_busy_until),
+						   dev->zone_wp_nsec);
+		cmd->zone_delay_nsec = ktime_to_ns(ktime_sub(zone->wp_busy_until,
+							     now));
+	}
+
 	zone->wp += nr_sectors;
 	if (zone->wp == zone->start + zone->capacity) {
 		null_lock_zone_res(dev);
@@ -327,6 +327,7 @@
 #include <linux/spinlock.h>
 #include <linux/kthread.h>
 #include <linux/percpu.h>
+#include <linux/local_lock.h>
 #include <linux/fips.h>
 #include <linux/ptrace.h>
 #include <linux/workqueue.h>
@@ -751,18 +752,30 @@ static int credit_entropy_bits_safe(struct entropy_store *r, int nbits)
 
 static DECLARE_WAIT_QUEUE_HEAD(crng_init_wait);
 
-#ifdef CONFIG_NUMA
 /*
- * Hack to deal with crazy userspace progams when they are all trying
- * to access /dev/urandom in parallel.  The programs are almost
- * certainly doing something terribly wrong, but we'll work around
- * their brain damage.
+ * Once the primary CRNG is seeded, each CPU generates from a key of its
+ * own, taken from the primary CRNG, rather than all of them contending on
+ * its lock.  Every extraction also makes the next key, which replaces the
+ * one just used ("fast key erasure"), so the output can't be recovered
+ * from a later copy of the state and there is no separate backtrack
+ * protection step.  The keys are taken again whenever the primary CRNG is
+ * reseeded, which bumps crng_generation.
  */
-static struct crng_state **crng_node_pool __read_mostly;
-#endif
+struct crng_pcpu {
+	__u32		key[CHACHA_KEY_SIZE / sizeof(__u32)];
+	unsigned long	generation;
+	local_lock_t	lock;
+};
+
+static DEFINE_PER_CPU(struct crng_pcpu, crngs) = {
+	.generation	= ULONG_MAX,
+	.lock		= INIT_LOCAL_LOCK(crngs.lock),
+};
+
+/* Protected by primary_crng.lock, never ULONG_MAX */
+static unsigned long crng_generation;
 
 static void invalidate_batched_entropy(void);
-static void numa_crng_init(void);
 
 static bool trust_cpu __ro_after_init = IS_ENABLED(CONFIG_RANDOM_TRUST_CPU);
 static int __init parse_trust_cpu(char *arg)
@@ -771,24 +784,6 @@ static int __init parse_trust_cpu(char *arg)
 }
 early_param("random.trust_cpu", parse_trust_cpu);
 
-static bool crng_init_try_arch(struct crng_state *crng)
-{
-	int		i;
-	bool		arch_init = true;
-	unsigned long	rv;
-
-	for (i = 4; i < 16; i++) {
-		if (!arch_get_random_seed_long(&rv) &&
-		    !arch_get_random_long(&rv)) {
-			rv = random_get_entropy();
-			arch_init = false;
-		}
-		crng->state[i] ^= rv;
-	}
-
-	return arch_init;
-}
-
 static bool __init crng_init_try_arch_early(struct crng_state *crng)
 {
 	int		i;
@@ -807,60 +802,18 @@ static bool __init crng_init_try_arch_early(struct crng_state *crng)
 	return arch_init;
 }
 
-static void __maybe_unused crng_initialize_secondary(struct crng_state *crng)
-{
-	chacha_init_consts(crng->state);
-	_get_random_bytes(&crng->state[4], sizeof(__u32) * 12);
-	crng_init_try_arch(crng);
-	crng->init_time = jiffies - CRNG_RESEED_INTERVAL - 1;
-}
-
 static void __init crng_initialize_primary(struct crng_state *crng)
 {
 	chacha_init_consts(crng->state);
 	_extract_entropy(&input_pool, &crng->state[4], sizeof(__u32) * 12, 0);
 	if (crng_init_try_arch_early(crng) && trust_cpu) {
 		invalidate_batched_entropy();
-		numa_crng_init();
 		crng_init = 2;
 		pr_notice("crng done (trusting CPU's manufacturer)\n");
 	}
 	crng->init_time = jiffies - CRNG_RESEED_INTERVAL - 1;
 }
 
-#ifdef CONFIG_NUMA
-static void do_numa_crng_init(struct work_struct *work)
-{
-	int i;
-	struct crng_state *crng;
-	struct crng_state **pool;
-
-	pool = kcalloc(nr_node_ids, sizeof(*pool), GFP_KERNEL|__GFP_NOFAIL);
-	for_each_online_node(i) {
-		crng = kmalloc_node(sizeof(struct crng_state),
-				    GFP_KERNEL | __GFP_NOFAIL, i);
-		spin_lock_init(&crng->lock);
-		crng_initialize_secondary(crng);
-		pool[i] = crng;
-	}
-	mb();
-	if (cmpxchg(&crng_node_pool, NULL, pool)) {
-		for_each_node(i)
-			kfree(pool[i]);
-		kfree(pool);
-	}
-}
-
-static DECLARE_WORK(numa_crng_init_work, do_numa_crng_init);
-
-static void numa_crng_init(void)
-{
-	schedule_work(&numa_crng_init_work);
-}
-#else
-static void numa_crng_init(void) {}
-#endif
-
 /*
  * crng_fast_load() can be called by code in the interrupt service
  * path.  So we can't afford to dilly-dally.
@@ -963,10 +916,14 @@ static void crng_reseed(struct crng_state *crng, struct entropy_store *r)
 	}
 	memzero_explicit(&buf, sizeof(buf));
 	crng->init_time = jiffies;
+	if (crng == &primary_crng) {
+		unsigned long gen = crng_generation + 1;
+
+		WRITE_ONCE(crng_generation, gen == ULONG_MAX ? 0 : gen);
+	}
 	spin_unlock_irqrestore(&crng->lock, flags);
 	if (crng == &primary_crng && crng_init < 2) {
 		invalidate_batched_entropy();
-		numa_crng_init();
 		crng_init = 2;
 		process_random_ready_list();
 		wake_up_interruptible(&crng_init_wait);
@@ -1003,17 +960,47 @@ static void _extract_crng(struct crng_state *crng,
 	spin_unlock_irqrestore(&crng->lock, flags);
 }
 
-static void extract_crng(__u8 out[CHACHA_BLOCK_SIZE])
+static void crng_pcpu_extract(__u8 out[CHACHA_BLOCK_SIZE])
 {
-	struct crng_state *crng = NULL;
+	__u8 buf[2 * CHACHA_BLOCK_SIZE] __aligned(4);
+	struct crng_pcpu *crng;
+	unsigned long flags, gen;
+	__u32 state[16];
 
-#ifdef CONFIG_NUMA
-	if (crng_node_pool)
-		crng = crng_node_pool[numa_node_id()];
-	if (crng == NULL)
-#endif
-		crng = &primary_crng;
-	_extract_crng(crng, out);
+	if (time_after(crng_global_init_time, primary_crng.init_time) ||
+	    time_after(jiffies, primary_crng.init_time + CRNG_RESEED_INTERVAL))
+		crng_reseed(&primary_crng, &input_pool);
+
+	local_lock_irqsave(&crngs.lock, flags);
+	crng = this_cpu_ptr(&crngs);
+	gen = READ_ONCE(crng_generation);
+	if (unlikely(crng->generation != gen)) {
+		_extract_crng(&primary_crng, buf);
+		memcpy(crng->key, buf, CHACHA_KEY_SIZE);
+		_crng_backtrack_protect(&primary_crng, buf, CHACHA_KEY_SIZE);
+		crng->generation = gen;
+	}
+
+	/* The key is never reused, so neither is the counter/nonce */
+	chacha_init_consts(state);
+	memcpy(&state[4], crng->key, CHACHA_KEY_SIZE);
+	memset(&state[12], 0, sizeof(__u32) * 4);
+	chacha20_block(state, buf);
+	chacha20_block(state, buf + CHACHA_BLOCK_SIZE);
+	memcpy(crng->key, buf, CHACHA_KEY_SIZE);
+	local_unlock_irqrestore(&crngs.lock, flags);
+
+	memcpy(out, buf + CHACHA_KEY_SIZE, CHACHA_BLOCK_SIZE);
+	memzero_explicit(state, sizeof(state));
+	memzero_explicit(buf, sizeof(buf));
+}
+
+static void extract_crng(__u8 out[CHACHA_BLOCK_SIZE])
+{
+	if (crng_ready())
+		crng_pcpu_extract(out);
+	else
+		_extract_crng(&primary_crng, out);
 }
 
 /*
@@ -1042,15 +1029,10 @@ static void _crng_backtrack_protect(struct crng_state *crng,
 
 static void crng_backtrack_protect(__u8 tmp[CHACHA_BLOCK_SIZE], int used)
 {
-	struct crng_state *crng = NULL;
-
-#ifdef CONFIG_NUMA
-	if (crng_node_pool)
-		crng = crng_node_pool[numa_node_id()];
-	if (crng == NULL)
-#endif
-		crng = &primary_crng;
-	_crng_backtrack_protect(crng, tmp, used);
+	/* The per-CPU keys have been replaced already */
+	if (crng_ready())
+		return;
+	_crng_backtrack_protect(&primary_crng, tmp, used);
 }
 
 static ssize_t extract_crng_user(void __user *buf, size_t nbytes)
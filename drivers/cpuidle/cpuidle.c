@@ -360,6 +360,7 @@ int cpuidle_enter_state(struct cpuidle_device *dev, struct cpuidle_driver *drv,
  */
 	if (entered_state >= 0) {
 		s64 diff, delay = drv->states[entered_state].exit_latency_ns;
+		bool miss = false;
 		int i;
 
 		/*
@@ -380,6 +381,7 @@ int cpuidle_enter_state(struct cpuidle_device *dev, struct cpuidle_driver *drv,
 
 				/* Shallower states are enabled, so update. */
 				dev->states_usage[entered_state].above++;
+				miss = true;
 				break;
 			}
 		} else if (diff > delay) {
@@ -391,12 +393,17 @@ int cpuidle_enter_state(struct cpuidle_device *dev, struct cpuidle_driver *drv,
 				 * Update if a deeper state would have been a
 				 * better match for the observed idle duration.
 				 */
-				if (diff - delay >= drv->states[i].target_residency_ns)
+				if (diff - delay >= drv->states[i].target_residency_ns) {
 					dev->states_usage[entered_state].below++;
+					miss = true;
+				}
 
 				break;
 			}
 		}
+
+		if (!miss)
+			dev->states_usage[entered_state].hits++;
 	} else {
 /*
  * IAMROOT, 2023.03.18:
@@ -99,9 +99,17 @@
  *      select the given idle state instead of the candidate one.
  *
  * 3. By default, select the candidate state.
+ *
+ * With %CONFIG_CPU_IDLE_GOV_TEO_IRQ, the time till the next interrupt predicted
+ * from the periodicity of the recent interrupts on the given CPU (see
+ * kernel/irq/timings.c) is used in place of the sleep length in the steps
+ * above when it is shorter, because such an interrupt is going to wake up the
+ * CPU before the closest timer.  The sleep length itself is still used for
+ * updating the metrics.
  */
 
 #include <linux/cpuidle.h>
+#include <linux/interrupt.h>
 #include <linux/jiffies.h>
 #include <linux/kernel.h>
 #include <linux/sched/clock.h>
@@ -241,6 +249,28 @@ static void teo_update(struct cpuidle_driver *drv, struct cpuidle_device *dev)
 	cpu_data->total += PULSE;
 }
 
+#ifdef CONFIG_CPU_IDLE_GOV_TEO_IRQ
+/**
+ * teo_irq_limit - Limit the idle duration by the next predicted interrupt.
+ * @now: Current time (local clock).
+ * @duration_ns: Time till the closest timer event.
+ */
+static s64 teo_irq_limit(u64 now, s64 duration_ns)
+{
+	u64 next_irq = irq_timings_next_event(now);
+
+	if (next_irq == U64_MAX)
+		return duration_ns;
+
+	return min_t(s64, duration_ns, next_irq - now);
+}
+#else
+static inline s64 teo_irq_limit(u64 now, s64 duration_ns)
+{
+	return duration_ns;
+}
+#endif
+
 static bool teo_time_ok(u64 interval_ns)
 {
 	return !tick_nohz_tick_stopped() || interval_ns >= TICK_NSEC;
@@ -309,6 +339,7 @@ static int teo_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
 
 	duration_ns = tick_nohz_get_sleep_length(&delta_tick);
 	cpu_data->sleep_length_ns = duration_ns;
+	duration_ns = teo_irq_limit(cpu_data->time_span_ns, duration_ns);
 
 	/* Check if there is any choice in the first place. */
 	if (drv->state_count < 2) {
@@ -528,6 +559,11 @@ static struct cpuidle_governor teo_governor = {
 
 static int __init teo_governor_init(void)
 {
+#ifdef CONFIG_CPU_IDLE_GOV_TEO_IRQ
+	/* Start collecting the interrupt statistics for teo_irq_limit(). */
+	irq_timings_enable();
+#endif
+
 	return cpuidle_register_governor(&teo_governor);
 }
 
@@ -11,6 +11,7 @@
 #include <linux/fs.h>
 #include <linux/mm.h>
 #include <linux/mman.h>
+#include <acpi/acpi_numa.h>
 #include "dax-private.h"
 #include "bus.h"
 
@@ -93,6 +94,15 @@ static int dev_dax_kmem_probe(struct dev_dax *dev_dax)
 		goto err_reg_mgid;
 	data->mgid = rc;
 
+	/*
+	 * Unless HMAT says the memory is as fast as DRAM, make it a lower
+	 * tier before it is onlined: allocations fall back to it only after
+	 * DRAM, and reclaim demotes to it.  Don't do that to a node that
+	 * already has other memory.
+	 */
+	if (!node_state(numa_node, N_MEMORY) && hmat_node_is_slow(numa_node))
+		node_set_state(numa_node, N_SLOW_MEMORY);
+
 	for (i = 0; i < dev_dax->nr_range; i++) {
 		struct resource *res;
 		struct range range;
@@ -150,6 +160,8 @@ static int dev_dax_kmem_probe(struct dev_dax *dev_dax)
 	return 0;
 
 err_request_mem:
+	if (!node_state(numa_node, N_MEMORY))
+		node_clear_state(numa_node, N_SLOW_MEMORY);
 	memory_group_unregister(data->mgid);
 err_reg_mgid:
 	kfree(data->res_name);
@@ -194,6 +206,8 @@ static void dev_dax_kmem_remove(struct dev_dax *dev_dax)
 	}
 
 	if (success >= dev_dax->nr_range) {
+		if (!node_state(dev_dax->target_node, N_MEMORY))
+			node_clear_state(dev_dax->target_node, N_SLOW_MEMORY);
 		memory_group_unregister(data->mgid);
 		kfree(data->res_name);
 		kfree(data);
@@ -48,6 +48,12 @@
  * write operations) or N shared fences (read operations).  The RCU
  * mechanism is used to protect read access to fences from locked
  * write-side updates.
+ *
+ * Readers walk the fences with dma_resv_for_each_fence_unlocked(), which
+ * holds a reference to one fence at a time instead of snapshotting the
+ * whole list.  Submissions touching many buffers can reserve slots and
+ * add their fence to all of them with dma_resv_reserve_shared_bulk() and
+ * dma_resv_add_shared_fence_bulk().
  */
 
 DEFINE_WD_CLASS(reservation_ww_class);
@@ -130,6 +136,41 @@ void dma_resv_fini(struct dma_resv *obj)
 }
 EXPORT_SYMBOL(dma_resv_fini);
 
+/*
+ * Move the signaled fences of @list behind the unsignaled ones and drop
+ * them, so that a full list can take new fences without being reallocated.
+ * Readers notice the reshuffle through the sequence count.
+ */
+static void dma_resv_list_prune(struct dma_resv *obj,
+				struct dma_resv_list *list)
+{
+	unsigned int i, j, count = list->shared_count;
+
+	write_seqcount_begin(&obj->seq);
+	for (i = 0, j = 0; i < count; ++i) {
+		struct dma_fence *fence, *tmp;
+
+		fence = rcu_dereference_protected(list->shared[i],
+						  dma_resv_held(obj));
+		if (dma_fence_is_signaled(fence))
+			continue;
+
+		if (i != j) {
+			tmp = rcu_dereference_protected(list->shared[j],
+							dma_resv_held(obj));
+			RCU_INIT_POINTER(list->shared[j], fence);
+			RCU_INIT_POINTER(list->shared[i], tmp);
+		}
+		j++;
+	}
+	list->shared_count = j;
+	write_seqcount_end(&obj->seq);
+
+	for (i = j; i < count; ++i)
+		dma_fence_put(rcu_dereference_protected(list->shared[i],
+							dma_resv_held(obj)));
+}
+
 /**
  * dma_resv_reserve_shared - Reserve space to add shared fences to
  * a dma_resv.
@@ -151,6 +192,11 @@ int dma_resv_reserve_shared(struct dma_resv *obj, unsigned int num_fences)
 
 	old = dma_resv_shared_list(obj);
 	if (old && old->shared_max) {
+		if ((old->shared_count + num_fences) <= old->shared_max)
+			return 0;
+
+		/* Try to make room before going for a bigger list */
+		dma_resv_list_prune(obj, old);
 		if ((old->shared_count + num_fences) <= old->shared_max)
 			return 0;
 		max = max(old->shared_count + num_fences, old->shared_max * 2);
@@ -207,6 +253,34 @@ int dma_resv_reserve_shared(struct dma_resv *obj, unsigned int num_fences)
 }
 EXPORT_SYMBOL(dma_resv_reserve_shared);
 
+/**
+ * dma_resv_reserve_shared_bulk - Reserve shared fence slots on many objects
+ * @objs: reservation objects, all locked
+ * @count: number of entries in @objs
+ * @num_fences: number of fences we want to add to each object
+ *
+ * Like dma_resv_reserve_shared() for each of @objs.  Should be called
+ * before dma_resv_add_shared_fence_bulk().
+ *
+ * RETURNS
+ * Zero for success, or -errno
+ */
+int dma_resv_reserve_shared_bulk(struct dma_resv **objs, unsigned int count,
+				 unsigned int num_fences)
+{
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < count; ++i) {
+		ret = dma_resv_reserve_shared(objs[i], num_fences);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL(dma_resv_reserve_shared_bulk);
+
 #ifdef CONFIG_DEBUG_MUTEXES
 /**
  * dma_resv_reset_shared_max - reset shared fences for debugging
@@ -229,22 +303,14 @@ void dma_resv_reset_shared_max(struct dma_resv *obj)
 EXPORT_SYMBOL(dma_resv_reset_shared_max);
 #endif
 
-/**
- * dma_resv_add_shared_fence - Add a fence to a shared slot
- * @obj: the reservation object
- * @fence: the shared fence to add
- *
- * Add a fence to a shared slot, obj->lock must be held, and
- * dma_resv_reserve_shared() has been called.
- */
-void dma_resv_add_shared_fence(struct dma_resv *obj, struct dma_fence *fence)
+/* Add @fence to a shared slot of @obj, consuming a reference to it */
+static void __dma_resv_add_shared_fence(struct dma_resv *obj,
+					struct dma_fence *fence)
 {
 	struct dma_resv_list *fobj;
 	struct dma_fence *old;
 	unsigned int i, count;
 
-	dma_fence_get(fence);
-
 	dma_resv_assert_held(obj);
 
 	fobj = dma_resv_shared_list(obj);
@@ -273,8 +339,46 @@ void dma_resv_add_shared_fence(struct dma_resv *obj, struct dma_fence *fence)
 	write_seqcount_end(&obj->seq);
 	dma_fence_put(old);
 }
+
+/**
+ * dma_resv_add_shared_fence - Add a fence to a shared slot
+ * @obj: the reservation object
+ * @fence: the shared fence to add
+ *
+ * Add a fence to a shared slot, obj->lock must be held, and
+ * dma_resv_reserve_shared() has been called.
+ */
+void dma_resv_add_shared_fence(struct dma_resv *obj, struct dma_fence *fence)
+{
+	dma_fence_get(fence);
+	__dma_resv_add_shared_fence(obj, fence);
+}
 EXPORT_SYMBOL(dma_resv_add_shared_fence);
 
+/**
+ * dma_resv_add_shared_fence_bulk - Add a fence to a shared slot of many objects
+ * @objs: reservation objects, all locked
+ * @count: number of entries in @objs
+ * @fence: the shared fence to add
+ *
+ * Add @fence to a shared slot of each of @objs, after
+ * dma_resv_reserve_shared_bulk() has been called.  The references for all
+ * the objects are taken at once.
+ */
+void dma_resv_add_shared_fence_bulk(struct dma_resv **objs, unsigned int count,
+				    struct dma_fence *fence)
+{
+	unsigned int i;
+
+	if (!count)
+		return;
+
+	refcount_add(count, &fence->refcount.refcount);
+	for (i = 0; i < count; ++i)
+		__dma_resv_add_shared_fence(objs[i], fence);
+}
+EXPORT_SYMBOL(dma_resv_add_shared_fence_bulk);
+
 /**
  * dma_resv_add_excl_fence - Add an exclusive fence.
  * @obj: the reservation object
@@ -322,62 +426,46 @@ EXPORT_SYMBOL(dma_resv_add_excl_fence);
  */
 int dma_resv_copy_fences(struct dma_resv *dst, struct dma_resv *src)
 {
-	struct dma_resv_list *src_list, *dst_list;
-	struct dma_fence *old, *new;
-	unsigned int i;
+	struct dma_resv_list *src_list, *dst_list = NULL;
+	struct dma_fence *old, *new = NULL, *f;
+	struct dma_resv_iter cursor;
 
 	dma_resv_assert_held(dst);
 
-	rcu_read_lock();
-	src_list = dma_resv_shared_list(src);
-
-retry:
-	if (src_list) {
-		unsigned int shared_count = src_list->shared_count;
-
-		rcu_read_unlock();
+	dma_resv_iter_begin(&cursor, src, DMA_RESV_USAGE_BOOKKEEP);
+	dma_resv_for_each_fence_unlocked(&cursor, f) {
 
-		dst_list = dma_resv_list_alloc(shared_count);
-		if (!dst_list)
-			return -ENOMEM;
+		if (dma_resv_iter_is_restarted(&cursor)) {
+			dma_resv_list_free(dst_list);
+			dma_fence_put(new);
 
-		rcu_read_lock();
-		src_list = dma_resv_shared_list(src);
-		if (!src_list || src_list->shared_count > shared_count) {
-			kfree(dst_list);
-			goto retry;
-		}
+			if (cursor.shared_count) {
+				unsigned int n = cursor.shared_count;
 
-		dst_list->shared_count = 0;
-		for (i = 0; i < src_list->shared_count; ++i) {
-			struct dma_fence __rcu **dst;
-			struct dma_fence *fence;
+				dst_list = dma_resv_list_alloc(n);
+				if (!dst_list) {
+					dma_resv_iter_end(&cursor);
+					return -ENOMEM;
+				}
 
-			fence = rcu_dereference(src_list->shared[i]);
-			if (test_bit(DMA_FENCE_FLAG_SIGNALED_BIT,
-				     &fence->flags))
-				continue;
+				dst_list->shared_count = 0;
 
-			if (!dma_fence_get_rcu(fence)) {
-				dma_resv_list_free(dst_list);
-				src_list = dma_resv_shared_list(src);
-				goto retry;
+			} else {
+				dst_list = NULL;
 			}
+			new = NULL;
+		}
 
-			if (dma_fence_is_signaled(fence)) {
-				dma_fence_put(fence);
-				continue;
-			}
+		dma_fence_get(f);
+		if (dma_resv_iter_is_exclusive(&cursor)) {
+			new = f;
+		} else {
+			unsigned int i = dst_list->shared_count++;
 
-			dst = &dst_list->shared[dst_list->shared_count++];
-			rcu_assign_pointer(*dst, fence);
+			RCU_INIT_POINTER(dst_list->shared[i], f);
 		}
-	} else {
-		dst_list = NULL;
 	}
-
-	new = dma_fence_get_rcu_safe(&src->fence_excl);
-	rcu_read_unlock();
+	dma_resv_iter_end(&cursor);
 
 	src_list = dma_resv_shared_list(dst);
 	old = dma_resv_excl_fence(dst);
@@ -513,94 +601,23 @@ long dma_resv_wait_timeout(struct dma_resv *obj, bool wait_all, bool intr,
 			   unsigned long timeout)
 {
 	long ret = timeout ? timeout : 1;
-	unsigned int seq, shared_count;
+	struct dma_resv_iter cursor;
 	struct dma_fence *fence;
-	int i;
-
-retry:
-	shared_count = 0;
-	seq = read_seqcount_begin(&obj->seq);
-	rcu_read_lock();
-	i = -1;
-
-	fence = dma_resv_excl_fence(obj);
-	if (fence && !test_bit(DMA_FENCE_FLAG_SIGNALED_BIT, &fence->flags)) {
-		if (!dma_fence_get_rcu(fence))
-			goto unlock_retry;
-
-		if (dma_fence_is_signaled(fence)) {
-			dma_fence_put(fence);
-			fence = NULL;
-		}
-
-	} else {
-		fence = NULL;
-	}
-
-	if (wait_all) {
-		struct dma_resv_list *fobj = dma_resv_shared_list(obj);
-
-		if (fobj)
-			shared_count = fobj->shared_count;
-
-		for (i = 0; !fence && i < shared_count; ++i) {
-			struct dma_fence *lfence;
 
-			lfence = rcu_dereference(fobj->shared[i]);
-			if (test_bit(DMA_FENCE_FLAG_SIGNALED_BIT,
-				     &lfence->flags))
-				continue;
-
-			if (!dma_fence_get_rcu(lfence))
-				goto unlock_retry;
-
-			if (dma_fence_is_signaled(lfence)) {
-				dma_fence_put(lfence);
-				continue;
-			}
-
-			fence = lfence;
+	dma_resv_iter_begin(&cursor, obj, wait_all ? DMA_RESV_USAGE_BOOKKEEP :
+				      DMA_RESV_USAGE_WRITE);
+	dma_resv_for_each_fence_unlocked(&cursor, fence) {
+		ret = dma_fence_wait_timeout(fence, intr, ret);
+		if (ret <= 0)
 			break;
-		}
 	}
+	dma_resv_iter_end(&cursor);
 
-	rcu_read_unlock();
-	if (fence) {
-		if (read_seqcount_retry(&obj->seq, seq)) {
-			dma_fence_put(fence);
-			goto retry;
-		}
-
-		ret = dma_fence_wait_timeout(fence, intr, ret);
-		dma_fence_put(fence);
-		if (ret > 0 && wait_all && (i + 1 < shared_count))
-			goto retry;
-	}
 	return ret;
-
-unlock_retry:
-	rcu_read_unlock();
-	goto retry;
 }
 EXPORT_SYMBOL_GPL(dma_resv_wait_timeout);
 
 
-static inline int dma_resv_test_signaled_single(struct dma_fence *passed_fence)
-{
-	struct dma_fence *fence, *lfence = passed_fence;
-	int ret = 1;
-
-	if (!test_bit(DMA_FENCE_FLAG_SIGNALED_BIT, &lfence->flags)) {
-		fence = dma_fence_get_rcu(lfence);
-		if (!fence)
-			return -1;
-
-		ret = !!dma_fence_is_signaled(fence);
-		dma_fence_put(fence);
-	}
-	return ret;
-}
-
 /**
  * dma_resv_test_signaled - Test if a reservation object's fences have been
  * signaled.
@@ -615,42 +632,19 @@ static inline int dma_resv_test_signaled_single(struct dma_fence *passed_fence)
  */
 bool dma_resv_test_signaled(struct dma_resv *obj, bool test_all)
 {
+	struct dma_resv_iter cursor;
 	struct dma_fence *fence;
-	unsigned int seq;
-	int ret;
-
-	rcu_read_lock();
-retry:
-	ret = true;
-	seq = read_seqcount_begin(&obj->seq);
-
-	if (test_all) {
-		struct dma_resv_list *fobj = dma_resv_shared_list(obj);
-		unsigned int i, shared_count;
-
-		shared_count = fobj ? fobj->shared_count : 0;
-		for (i = 0; i < shared_count; ++i) {
-			fence = rcu_dereference(fobj->shared[i]);
-			ret = dma_resv_test_signaled_single(fence);
-			if (ret < 0)
-				goto retry;
-			else if (!ret)
-				break;
-		}
+	bool ret = true;
+
+	/* The iterator only returns unsignaled fences */
+	dma_resv_iter_begin(&cursor, obj, test_all ? DMA_RESV_USAGE_BOOKKEEP :
+				      DMA_RESV_USAGE_WRITE);
+	dma_resv_for_each_fence_unlocked(&cursor, fence) {
+		ret = false;
+		break;
 	}
+	dma_resv_iter_end(&cursor);
 
-	fence = dma_resv_excl_fence(obj);
-	if (ret && fence) {
-		ret = dma_resv_test_signaled_single(fence);
-		if (ret < 0)
-			goto retry;
-
-	}
-
-	if (read_seqcount_retry(&obj->seq, seq))
-		goto retry;
-
-	rcu_read_unlock();
 	return ret;
 }
 EXPORT_SYMBOL_GPL(dma_resv_test_signaled);
@@ -45,6 +45,7 @@
 
 #include <net/neighbour.h>
 #include <net/sch_generic.h>
+#include <net/page_pool.h>
 
 #include <linux/atomic.h>
 
@@ -78,7 +79,8 @@ enum {
 	IPOIB_MIN_QUEUE_SIZE	  = 2,
 	IPOIB_CM_MAX_CONN_QP	  = 4096,
 
-	IPOIB_NUM_WC		  = 4,
+	IPOIB_NUM_WC		  = 16,
+	IPOIB_RX_POST_BATCH	  = 16,
 
 	IPOIB_MAX_PATH_REC_QUEUE  = 3,
 	IPOIB_MAX_MCAST_QUEUE	  = 64,
@@ -183,6 +185,7 @@ struct ipoib_mcast {
 
 struct ipoib_rx_buf {
 	struct sk_buff *skb;
+	struct page	*page;	/* instead of skb with rx_page_pool */
 	u64		mapping[IPOIB_UD_RX_SG];
 };
 
@@ -387,8 +390,14 @@ struct ipoib_dev_priv {
 	struct ib_ud_wr      tx_wr;
 	struct ib_wc	     send_wc[MAX_SEND_CQE];
 
-	struct ib_recv_wr    rx_wr;
-	struct ib_sge	     rx_sge[IPOIB_UD_RX_SG];
+	/* receives are reposted IPOIB_RX_POST_BATCH at a time */
+	struct ib_recv_wr    rx_wr[IPOIB_RX_POST_BATCH];
+	struct ib_sge	     rx_sge[IPOIB_RX_POST_BATCH];
+	unsigned int	     rx_wr_count;
+
+	/* NULL if receive buffers are plain skbs */
+	struct page_pool    *rx_page_pool;
+	unsigned int	     rx_page_order;
 
 	struct ib_wc ibwc[IPOIB_NUM_WC];
 
@@ -512,6 +521,8 @@ void ipoib_ib_dev_flush_heavy(struct work_struct *work);
 void ipoib_pkey_event(struct work_struct *work);
 void ipoib_ib_dev_cleanup(struct net_device *dev);
 
+void ipoib_rx_page_pool_init(struct ipoib_dev_priv *priv);
+void ipoib_rx_page_pool_cleanup(struct ipoib_dev_priv *priv);
 int ipoib_ib_dev_open_default(struct net_device *dev);
 int ipoib_ib_dev_open(struct net_device *dev);
 void ipoib_ib_dev_stop(struct net_device *dev);
@@ -98,33 +98,95 @@ static void ipoib_ud_dma_unmap_rx(struct ipoib_dev_priv *priv,
 			    DMA_FROM_DEVICE);
 }
 
-static int ipoib_ib_post_receive(struct net_device *dev, int id)
+/*
+ * Receive buffers from rx_page_pool start IPOIB_RX_HEADROOM into the page,
+ * which puts the IP header at the same 64 byte aligned offset as in skbs
+ * from dev_alloc_skb().
+ */
+#define IPOIB_RX_HEADROOM	(NET_SKB_PAD + IPOIB_PSEUDO_LEN)
+
+static void ipoib_ud_free_rx(struct ipoib_dev_priv *priv, int id)
+{
+	struct ipoib_rx_buf *rx_req = &priv->rx_ring[id];
+
+	if (rx_req->page) {
+		page_pool_put_full_page(priv->rx_page_pool, rx_req->page,
+					false);
+		rx_req->page = NULL;
+		return;
+	}
+
+	ipoib_ud_dma_unmap_rx(priv, rx_req->mapping);
+	dev_kfree_skb_any(rx_req->skb);
+	rx_req->skb = NULL;
+}
+
+/* Post the receives queued by ipoib_ib_post_receive() in one go */
+static int ipoib_ib_flush_receives(struct net_device *dev)
 {
 	struct ipoib_dev_priv *priv = ipoib_priv(dev);
+	unsigned int i, n = priv->rx_wr_count;
+	const struct ib_recv_wr *bad_wr = NULL;
 	int ret;
 
-	priv->rx_wr.wr_id   = id | IPOIB_OP_RECV;
-	priv->rx_sge[0].addr = priv->rx_ring[id].mapping[0];
-	priv->rx_sge[1].addr = priv->rx_ring[id].mapping[1];
-
+	if (!n)
+		return 0;
 
-	ret = ib_post_recv(priv->qp, &priv->rx_wr, NULL);
+	priv->rx_wr_count = 0;
+	priv->rx_wr[n - 1].next = NULL;
+	ret = ib_post_recv(priv->qp, priv->rx_wr, &bad_wr);
+	priv->rx_wr[n - 1].next = &priv->rx_wr[n];
 	if (unlikely(ret)) {
-		ipoib_warn(priv, "receive failed for buf %d (%d)\n", id, ret);
-		ipoib_ud_dma_unmap_rx(priv, priv->rx_ring[id].mapping);
-		dev_kfree_skb_any(priv->rx_ring[id].skb);
-		priv->rx_ring[id].skb = NULL;
+		i = bad_wr ? bad_wr - priv->rx_wr : 0;
+		ipoib_warn(priv, "receive failed for %u bufs (%d)\n", n - i,
+			   ret);
+		for (; i < n; i++)
+			ipoib_ud_free_rx(priv,
+					 priv->rx_wr[i].wr_id & ~IPOIB_OP_RECV);
 	}
 
 	return ret;
 }
 
+/*
+ * Queue buffer @id for receive, the WRs are handed to the HCA once
+ * IPOIB_RX_POST_BATCH of them have accumulated or when the caller is done
+ * with its completions and calls ipoib_ib_flush_receives().
+ */
+static int ipoib_ib_post_receive(struct net_device *dev, int id)
+{
+	struct ipoib_dev_priv *priv = ipoib_priv(dev);
+	unsigned int n = priv->rx_wr_count++;
+
+	priv->rx_wr[n].wr_id   = id | IPOIB_OP_RECV;
+	priv->rx_sge[n].addr = priv->rx_ring[id].mapping[0];
+
+	if (n + 1 < IPOIB_RX_POST_BATCH)
+		return 0;
+
+	return ipoib_ib_flush_receives(dev);
+}
+
+static bool ipoib_alloc_rx_page(struct ipoib_dev_priv *priv, int id)
+{
+	struct page *page;
+
+	page = page_pool_dev_alloc_pages(priv->rx_page_pool);
+	if (unlikely(!page))
+		return false;
+
+	priv->rx_ring[id].page = page;
+	priv->rx_ring[id].mapping[0] = page_pool_get_dma_addr(page) +
+				       IPOIB_RX_HEADROOM;
+	return true;
+}
+
 static struct sk_buff *ipoib_alloc_rx_skb(struct net_device *dev, int id)
 {
 	struct ipoib_dev_priv *priv = ipoib_priv(dev);
 	struct sk_buff *skb;
 	int buf_size;
-	u64 *mapping;
+	u64 addr;
 
 	buf_size = IPOIB_UD_BUF_SIZE(priv->max_ib_mtu);
 
@@ -138,12 +200,12 @@ static struct sk_buff *ipoib_alloc_rx_skb(struct net_device *dev, int id)
 	 */
 	skb_reserve(skb, sizeof(struct ipoib_pseudo_header));
 
-	mapping = priv->rx_ring[id].mapping;
-	mapping[0] = ib_dma_map_single(priv->ca, skb->data, buf_size,
-				       DMA_FROM_DEVICE);
-	if (unlikely(ib_dma_mapping_error(priv->ca, mapping[0])))
+	addr = ib_dma_map_single(priv->ca, skb->data, buf_size,
+				 DMA_FROM_DEVICE);
+	if (unlikely(ib_dma_mapping_error(priv->ca, addr)))
 		goto error;
 
+	priv->rx_ring[id].mapping[0] = addr;
 	priv->rx_ring[id].skb = skb;
 	return skb;
 error:
@@ -151,14 +213,92 @@ static struct sk_buff *ipoib_alloc_rx_skb(struct net_device *dev, int id)
 	return NULL;
 }
 
+/* On failure the buffer previously at @id, if any, is left in place */
+static bool ipoib_alloc_rx_buf(struct net_device *dev, int id)
+{
+	struct ipoib_dev_priv *priv = ipoib_priv(dev);
+
+	if (priv->rx_page_pool)
+		return ipoib_alloc_rx_page(priv, id);
+
+	return ipoib_alloc_rx_skb(dev, id);
+}
+
+/* Wrap the skb around a received page_pool page */
+static struct sk_buff *ipoib_build_rx_skb(struct ipoib_dev_priv *priv,
+					  struct page *page, u64 mapping,
+					  u32 len)
+{
+	struct sk_buff *skb;
+
+	ib_dma_sync_single_for_cpu(priv->ca, mapping, len, DMA_FROM_DEVICE);
+
+	skb = build_skb(page_address(page), PAGE_SIZE << priv->rx_page_order);
+	if (unlikely(!skb)) {
+		page_pool_recycle_direct(priv->rx_page_pool, page);
+		return NULL;
+	}
+
+	skb_reserve(skb, IPOIB_RX_HEADROOM);
+	skb_mark_for_recycle(skb);
+	return skb;
+}
+
+/*
+ * Receive into pages that stay DMA mapped and come back to the pool once
+ * the stack is done with the skb, rather than mapping a freshly allocated
+ * skb for every packet.  Devices without DMA mappings keep using skbs, as
+ * does everything if the pool can't be set up.
+ */
+void ipoib_rx_page_pool_init(struct ipoib_dev_priv *priv)
+{
+	struct device *dma_dev = ib_dma_pool_device(priv->ca);
+	unsigned int buf_size = IPOIB_UD_BUF_SIZE(priv->max_ib_mtu);
+	struct page_pool_params pp_params = {
+		.flags		= PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV,
+		.pool_size	= ipoib_recvq_size,
+		.dma_dir	= DMA_FROM_DEVICE,
+		.offset		= IPOIB_RX_HEADROOM,
+		.max_len	= buf_size,
+	};
+	struct page_pool *pool;
+	unsigned int len;
+
+	if (!dma_dev)
+		return;
+
+	len = SKB_DATA_ALIGN(IPOIB_RX_HEADROOM + buf_size) +
+	      SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+	pp_params.order = get_order(len);
+	pp_params.dev = dma_dev;
+	pp_params.nid = dev_to_node(dma_dev);
+
+	pool = page_pool_create(&pp_params);
+	if (IS_ERR(pool)) {
+		ipoib_warn(priv, "page pool creation failed (%ld), using skbs\n",
+			   PTR_ERR(pool));
+		return;
+	}
+
+	priv->rx_page_pool = pool;
+	priv->rx_page_order = pp_params.order;
+}
+
+void ipoib_rx_page_pool_cleanup(struct ipoib_dev_priv *priv)
+{
+	page_pool_destroy(priv->rx_page_pool);
+	priv->rx_page_pool = NULL;
+}
+
 static int ipoib_ib_post_receives(struct net_device *dev)
 {
 	struct ipoib_dev_priv *priv = ipoib_priv(dev);
 	int i;
 
 	for (i = 0; i < ipoib_recvq_size; ++i) {
-		if (!ipoib_alloc_rx_skb(dev, i)) {
+		if (!ipoib_alloc_rx_buf(dev, i)) {
 			ipoib_warn(priv, "failed to allocate receive buffer %d\n", i);
+			ipoib_ib_flush_receives(dev);
 			return -ENOMEM;
 		}
 		if (ipoib_ib_post_receive(dev, i)) {
@@ -167,6 +307,11 @@ static int ipoib_ib_post_receives(struct net_device *dev)
 		}
 	}
 
+	if (ipoib_ib_flush_receives(dev)) {
+		ipoib_warn(priv, "failed to post the last receive buffers\n");
+		return -EIO;
+	}
+
 	return 0;
 }
 
@@ -175,6 +320,7 @@ static void ipoib_ib_handle_rx_wc(struct net_device *dev, struct ib_wc *wc)
 	struct ipoib_dev_priv *priv = ipoib_priv(dev);
 	unsigned int wr_id = wc->wr_id & ~IPOIB_OP_RECV;
 	struct sk_buff *skb;
+	struct page *page;
 	u64 mapping[IPOIB_UD_RX_SG];
 	union ib_gid *dgid;
 	union ib_gid *sgid;
@@ -189,15 +335,14 @@ static void ipoib_ib_handle_rx_wc(struct net_device *dev, struct ib_wc *wc)
 	}
 
 	skb  = priv->rx_ring[wr_id].skb;
+	page = priv->rx_ring[wr_id].page;
 
 	if (unlikely(wc->status != IB_WC_SUCCESS)) {
 		if (wc->status != IB_WC_WR_FLUSH_ERR)
 			ipoib_warn(priv,
 				   "failed recv event (status=%d, wrid=%d vend_err %#x)\n",
 				   wc->status, wr_id, wc->vendor_err);
-		ipoib_ud_dma_unmap_rx(priv, priv->rx_ring[wr_id].mapping);
-		dev_kfree_skb_any(skb);
-		priv->rx_ring[wr_id].skb = NULL;
+		ipoib_ud_free_rx(priv, wr_id);
 		return;
 	}
 
@@ -208,7 +353,7 @@ static void ipoib_ib_handle_rx_wc(struct net_device *dev, struct ib_wc *wc)
 	 * If we can't allocate a new RX buffer, dump
 	 * this packet and reuse the old buffer.
 	 */
-	if (unlikely(!ipoib_alloc_rx_skb(dev, wr_id))) {
+	if (unlikely(!ipoib_alloc_rx_buf(dev, wr_id))) {
 		++dev->stats.rx_dropped;
 		goto repost;
 	}
@@ -216,7 +361,15 @@ static void ipoib_ib_handle_rx_wc(struct net_device *dev, struct ib_wc *wc)
 	ipoib_dbg_data(priv, "received %d bytes, SLID 0x%04x\n",
 		       wc->byte_len, wc->slid);
 
-	ipoib_ud_dma_unmap_rx(priv, mapping);
+	if (page) {
+		skb = ipoib_build_rx_skb(priv, page, mapping[0], wc->byte_len);
+		if (unlikely(!skb)) {
+			++dev->stats.rx_dropped;
+			goto repost;
+		}
+	} else {
+		ipoib_ud_dma_unmap_rx(priv, mapping);
+	}
 
 	skb_put(skb, wc->byte_len);
 
@@ -483,6 +636,8 @@ int ipoib_rx_poll(struct napi_struct *napi, int budget)
 			break;
 	}
 
+	ipoib_ib_flush_receives(dev);
+
 	if (done < budget) {
 		napi_complete(napi);
 		if (unlikely(ib_req_notify_cq(priv->recv_cq,
@@ -726,7 +881,7 @@ static int recvs_pending(struct net_device *dev)
 	int i;
 
 	for (i = 0; i < ipoib_recvq_size; ++i)
-		if (priv->rx_ring[i].skb)
+		if (priv->rx_ring[i].skb || priv->rx_ring[i].page)
 			++pending;
 
 	return pending;
@@ -817,12 +972,9 @@ int ipoib_ib_dev_stop_default(struct net_device *dev)
 				struct ipoib_rx_buf *rx_req;
 
 				rx_req = &priv->rx_ring[i];
-				if (!rx_req->skb)
+				if (!rx_req->skb && !rx_req->page)
 					continue;
-				ipoib_ud_dma_unmap_rx(priv,
-						      priv->rx_ring[i].mapping);
-				dev_kfree_skb_any(rx_req->skb);
-				rx_req->skb = NULL;
+				ipoib_ud_free_rx(priv, i);
 			}
 
 			goto timeout;
@@ -994,6 +1146,8 @@ void ipoib_drain_cq(struct net_device *dev)
 		}
 	} while (n == IPOIB_NUM_WC);
 
+	ipoib_ib_flush_receives(dev);
+
 	while (poll_tx(priv))
 		; /* nothing */
 
@@ -1686,6 +1686,7 @@ static void ipoib_dev_uninit_default(struct net_device *dev)
 
 	ipoib_cm_dev_cleanup(dev);
 
+	ipoib_rx_page_pool_cleanup(priv);
 	kfree(priv->rx_ring);
 	vfree(priv->tx_ring);
 
@@ -1706,6 +1707,8 @@ static int ipoib_dev_init_default(struct net_device *dev)
 	if (!priv->rx_ring)
 		goto out;
 
+	ipoib_rx_page_pool_init(priv);
+
 	priv->tx_ring = vzalloc(array_size(ipoib_sendq_size,
 					   sizeof(*priv->tx_ring)));
 	if (!priv->tx_ring) {
@@ -1733,6 +1736,7 @@ static int ipoib_dev_init_default(struct net_device *dev)
 	vfree(priv->tx_ring);
 
 out_rx_ring_cleanup:
+	ipoib_rx_page_pool_cleanup(priv);
 	kfree(priv->rx_ring);
 
 out:
@@ -225,13 +225,15 @@ int ipoib_transport_dev_init(struct net_device *dev, struct ib_device *ca)
 	priv->tx_wr.wr.sg_list		= priv->tx_sge;
 	priv->tx_wr.wr.send_flags	= IB_SEND_SIGNALED;
 
-	priv->rx_sge[0].lkey = priv->pd->local_dma_lkey;
+	for (i = 0; i < IPOIB_RX_POST_BATCH; ++i) {
+		priv->rx_sge[i].lkey = priv->pd->local_dma_lkey;
+		priv->rx_sge[i].length = IPOIB_UD_BUF_SIZE(priv->max_ib_mtu);
 
-	priv->rx_sge[0].length = IPOIB_UD_BUF_SIZE(priv->max_ib_mtu);
-	priv->rx_wr.num_sge = 1;
-
-	priv->rx_wr.next = NULL;
-	priv->rx_wr.sg_list = priv->rx_sge;
+		priv->rx_wr[i].num_sge = 1;
+		priv->rx_wr[i].sg_list = &priv->rx_sge[i];
+		priv->rx_wr[i].next = &priv->rx_wr[i + 1];
+	}
+	priv->rx_wr_count = 0;
 
 	if (init_attr.cap.max_send_sge > 1)
 		dev->features |= NETIF_F_SG;
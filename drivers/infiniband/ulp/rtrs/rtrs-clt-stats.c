@@ -180,8 +180,29 @@ void rtrs_clt_update_all_stats(struct rtrs_clt_io_req *req, int dir)
 
 	len = req->usr_len + req->data_len;
 	rtrs_clt_update_rdma_stats(stats, len, dir);
-	if (req->mp_policy == MP_POLICY_MIN_INFLIGHT)
+	if (rtrs_clt_mp_tracks_inflight(req->mp_policy))
 		atomic_inc(&stats->inflight);
+	if (req->mp_policy == MP_POLICY_P2C)
+		req->start_time = ktime_get();
+}
+
+/*
+ * Fold the latency of a completed IO into the path's moving average,
+ * weight 1/8.  Updates from different CPUs may race and lose a sample,
+ * which doesn't matter for path selection.
+ */
+void rtrs_clt_update_io_lat(struct rtrs_clt_io_req *req)
+{
+	struct rtrs_clt_sess *sess = to_clt_sess(req->con->c.sess);
+	struct rtrs_clt_stats *stats = sess->stats;
+	s64 lat = ktime_to_ns(ktime_sub(ktime_get(), req->start_time));
+	s64 avg = READ_ONCE(stats->io_lat_ewma_ns);
+
+	if (!avg)
+		avg = lat;
+	else
+		avg += (lat - avg) / 8;
+	WRITE_ONCE(stats->io_lat_ewma_ns, avg);
 }
 
 int rtrs_clt_init_stats(struct rtrs_clt_stats *stats)
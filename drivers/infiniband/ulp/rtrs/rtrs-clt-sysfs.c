@@ -104,6 +104,9 @@ static ssize_t mpath_policy_show(struct device *dev,
 	case MP_POLICY_MIN_LATENCY:
 		return sysfs_emit(page, "min-latency (ML: %d)\n",
 				  clt->mp_policy);
+	case MP_POLICY_P2C:
+		return sysfs_emit(page, "p2c (P2C: %d)\n",
+				  clt->mp_policy);
 	default:
 		return sysfs_emit(page, "Unknown (%d)\n", clt->mp_policy);
 	}
@@ -124,7 +127,8 @@ static ssize_t mpath_policy_store(struct device *dev,
 	ret = kstrtoint(buf, 10, &value);
 	if (!ret && (value == MP_POLICY_RR ||
 		     value == MP_POLICY_MIN_INFLIGHT ||
-		     value == MP_POLICY_MIN_LATENCY)) {
+		     value == MP_POLICY_MIN_LATENCY ||
+		     value == MP_POLICY_P2C)) {
 		clt->mp_policy = value;
 		return count;
 	}
@@ -143,6 +147,8 @@ static ssize_t mpath_policy_store(struct device *dev,
 	else if (!strncasecmp(buf, "min-latency", 11) ||
 		 (len == 2 && !strncasecmp(buf, "ml", 2)))
 		clt->mp_policy = MP_POLICY_MIN_LATENCY;
+	else if (!strncasecmp(buf, "p2c", 3))
+		clt->mp_policy = MP_POLICY_P2C;
 	else
 		return -EINVAL;
 
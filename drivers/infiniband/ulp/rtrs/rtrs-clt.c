@@ -438,7 +438,9 @@ static void complete_rdma_req(struct rtrs_clt_io_req *req, int errno,
 	}
 	if (!refcount_dec_and_test(&req->ref))
 		return;
-	if (req->mp_policy == MP_POLICY_MIN_INFLIGHT)
+	if (req->mp_policy == MP_POLICY_P2C && !errno)
+		rtrs_clt_update_io_lat(req);
+	if (rtrs_clt_mp_tracks_inflight(req->mp_policy))
 		atomic_dec(&sess->stats->inflight);
 
 	req->in_use = false;
@@ -895,6 +897,68 @@ static struct rtrs_clt_sess *get_next_path_min_latency(struct path_it *it)
 	return min_path;
 }
 
+static struct rtrs_clt_sess *p2c_sample(struct rtrs_clt *clt,
+					unsigned int idx)
+{
+	struct rtrs_clt_sess *sess = rcu_dereference(clt->paths_arr[idx]);
+
+	if (!sess || READ_ONCE(sess->state) != RTRS_CLT_CONNECTED ||
+	    !list_empty(raw_cpu_ptr(sess->mp_skip_entry)))
+		return NULL;
+
+	return sess;
+}
+
+/* Expected time for a new IO to go through @sess */
+static u64 p2c_cost(struct rtrs_clt_sess *sess)
+{
+	u64 lat = READ_ONCE(sess->stats->io_lat_ewma_ns) ?: 1;
+
+	return lat * (atomic_read(&sess->stats->inflight) + 1);
+}
+
+/**
+ * get_next_path_p2c() - Returns the better of two randomly chosen paths.
+ * @it:	the path pointer
+ *
+ * Related to @MP_POLICY_P2C
+ *
+ * Two distinct paths are sampled and the one with the lower product of
+ * inflight IOs and average IO completion latency is used, which keeps the
+ * cost per IO constant however many paths there are.  If neither sample is
+ * usable, e.g. when retrying after a failure, fall back to scanning all
+ * paths the way @MP_POLICY_MIN_INFLIGHT does.
+ *
+ * Locks:
+ *    rcu_read_lock() must be hold.
+ */
+static struct rtrs_clt_sess *get_next_path_p2c(struct path_it *it)
+{
+	struct rtrs_clt *clt = it->clt;
+	struct rtrs_clt_sess *a = NULL, *b = NULL, *pick;
+	unsigned int n, ia;
+
+	n = READ_ONCE(clt->paths_arr_num);
+	if (n) {
+		ia = prandom_u32_max(n);
+		a = p2c_sample(clt, ia);
+		if (n > 1)
+			b = p2c_sample(clt, (ia + 1 + prandom_u32_max(n - 1)) %
+					    n);
+	}
+
+	if (a && b)
+		pick = p2c_cost(a) <= p2c_cost(b) ? a : b;
+	else
+		pick = a ?: b;
+	if (!pick)
+		return get_next_path_min_inflight(it);
+
+	list_add(raw_cpu_ptr(pick->mp_skip_entry), &it->skip_list);
+
+	return pick;
+}
+
 static inline void path_it_init(struct path_it *it, struct rtrs_clt *clt)
 {
 	INIT_LIST_HEAD(&it->skip_list);
@@ -905,6 +969,8 @@ static inline void path_it_init(struct path_it *it, struct rtrs_clt *clt)
 		it->next_path = get_next_path_rr;
 	else if (clt->mp_policy == MP_POLICY_MIN_INFLIGHT)
 		it->next_path = get_next_path_min_inflight;
+	else if (clt->mp_policy == MP_POLICY_P2C)
+		it->next_path = get_next_path_p2c;
 	else
 		it->next_path = get_next_path_min_latency;
 }
@@ -913,7 +979,8 @@ static inline void path_it_deinit(struct path_it *it)
 {
 	struct list_head *skip, *tmp;
 	/*
-	 * The skip_list is used only for the MIN_INFLIGHT policy.
+	 * The skip_list is used only for the MIN_INFLIGHT, MIN_LATENCY and
+	 * P2C policies.
 	 * We need to remove paths from it, so that next IO can insert
 	 * paths (->mp_skip_entry) into a skip_list again.
 	 */
@@ -1155,7 +1222,7 @@ static int rtrs_clt_write_req(struct rtrs_clt_io_req *req)
 			    "Write request failed: error=%d path=%s [%s:%u]\n",
 			    ret, kobject_name(&sess->kobj), sess->hca_name,
 			    sess->hca_port);
-		if (req->mp_policy == MP_POLICY_MIN_INFLIGHT)
+		if (rtrs_clt_mp_tracks_inflight(req->mp_policy))
 			atomic_dec(&sess->stats->inflight);
 		if (req->sg_cnt)
 			ib_dma_unmap_sg(sess->s.dev->ib_dev, req->sglist,
@@ -1261,7 +1328,7 @@ static int rtrs_clt_read_req(struct rtrs_clt_io_req *req)
 			    "Read request failed: error=%d path=%s [%s:%u]\n",
 			    ret, kobject_name(&sess->kobj), sess->hca_name,
 			    sess->hca_port);
-		if (req->mp_policy == MP_POLICY_MIN_INFLIGHT)
+		if (rtrs_clt_mp_tracks_inflight(req->mp_policy))
 			atomic_dec(&sess->stats->inflight);
 		req->need_inv = false;
 		if (req->sg_cnt)
@@ -2206,6 +2273,26 @@ static inline bool xchg_sessions(struct rtrs_clt_sess __rcu **rcu_ppcpu_path,
 	return sess == cmpxchg(ppcpu_path, sess, next);
 }
 
+/* Fill the hole left by @sess with the last entry of the sample array */
+static void rtrs_clt_remove_path_from_sample_arr(struct rtrs_clt_sess *sess)
+{
+	struct rtrs_clt *clt = sess->clt;
+	unsigned int i, last = clt->paths_arr_num - 1;
+	struct rtrs_clt_sess *tail;
+
+	for (i = 0; i <= last; i++) {
+		if (rcu_access_pointer(clt->paths_arr[i]) != sess)
+			continue;
+
+		tail = rcu_dereference_protected(clt->paths_arr[last],
+				lockdep_is_held(&clt->paths_mutex));
+		rcu_assign_pointer(clt->paths_arr[i], tail);
+		RCU_INIT_POINTER(clt->paths_arr[last], NULL);
+		WRITE_ONCE(clt->paths_arr_num, last);
+		return;
+	}
+}
+
 static void rtrs_clt_remove_path_from_arr(struct rtrs_clt_sess *sess)
 {
 	struct rtrs_clt *clt = sess->clt;
@@ -2215,6 +2302,7 @@ static void rtrs_clt_remove_path_from_arr(struct rtrs_clt_sess *sess)
 
 	mutex_lock(&clt->paths_mutex);
 	list_del_rcu(&sess->s.entry);
+	rtrs_clt_remove_path_from_sample_arr(sess);
 
 	/* Make sure everybody observes path removal. */
 	synchronize_rcu();
@@ -2304,6 +2392,8 @@ static void rtrs_clt_add_path_to_arr(struct rtrs_clt_sess *sess)
 	clt->paths_num++;
 
 	list_add_tail_rcu(&sess->s.entry, &clt->paths_list);
+	rcu_assign_pointer(clt->paths_arr[clt->paths_arr_num], sess);
+	WRITE_ONCE(clt->paths_arr_num, clt->paths_arr_num + 1);
 	mutex_unlock(&clt->paths_mutex);
 }
 
@@ -2828,6 +2918,7 @@ struct rtrs_clt *rtrs_clt_open(struct rtrs_clt_ops *ops,
 			free_sess(sess);
 			goto close_all_sess;
 		}
+		RCU_INIT_POINTER(clt->paths_arr[clt->paths_arr_num++], sess);
 	}
 	err = alloc_permits(clt);
 	if (err)
@@ -30,8 +30,15 @@ enum rtrs_mp_policy {
 	MP_POLICY_RR,
 	MP_POLICY_MIN_INFLIGHT,
 	MP_POLICY_MIN_LATENCY,
+	MP_POLICY_P2C,
 };
 
+/* Policies which need the per path inflight count */
+static inline bool rtrs_clt_mp_tracks_inflight(enum rtrs_mp_policy policy)
+{
+	return policy == MP_POLICY_MIN_INFLIGHT || policy == MP_POLICY_P2C;
+}
+
 /* see Documentation/ABI/testing/sysfs-class-rtrs-client for details */
 struct rtrs_clt_stats_reconnects {
 	int successful_cnt;
@@ -66,6 +73,7 @@ struct rtrs_clt_stats {
 	struct rtrs_clt_stats_pcpu    __percpu	*pcpu_stats;
 	struct rtrs_clt_stats_reconnects	reconnects;
 	atomic_t				inflight;
+	u64					io_lat_ewma_ns;
 };
 
 struct rtrs_clt_con {
@@ -102,6 +110,7 @@ struct rtrs_clt_io_req {
 	void			*priv;
 	bool			in_use;
 	enum rtrs_mp_policy     mp_policy;
+	ktime_t			start_time; /* for MP_POLICY_P2C */
 	struct rtrs_clt_con	*con;
 	struct rtrs_sg_desc	*desc;
 	struct ib_sge		*sge;
@@ -158,6 +167,9 @@ struct rtrs_clt {
 	size_t			paths_num;
 	struct rtrs_clt_sess
 	__rcu * __percpu	*pcpu_path;
+	/* dense copy of paths_list for random sampling, under paths_mutex */
+	struct rtrs_clt_sess __rcu *paths_arr[MAX_PATHS_NUM];
+	unsigned int		paths_arr_num;
 	uuid_t			paths_uuid;
 	int			paths_up;
 	struct mutex		paths_mutex;
@@ -220,6 +232,7 @@ void rtrs_clt_inc_failover_cnt(struct rtrs_clt_stats *s);
 
 void rtrs_clt_update_wc_stats(struct rtrs_clt_con *con);
 void rtrs_clt_update_all_stats(struct rtrs_clt_io_req *req, int dir);
+void rtrs_clt_update_io_lat(struct rtrs_clt_io_req *req);
 
 int rtrs_clt_reset_rdma_lat_distr_stats(struct rtrs_clt_stats *stats,
 					 bool enable);
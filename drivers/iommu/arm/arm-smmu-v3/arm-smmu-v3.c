@@ -1861,6 +1861,28 @@ static void __arm_smmu_tlb_inv_range(struct arm_smmu_cmdq_ent *cmd,
 	if (!size)
 		return;
 
+	/*
+	 * Emitting one command per granule for a large range just fills
+	 * the queue that every other CPU is waiting on; drop the whole
+	 * context from the TLB instead.
+	 */
+	if (!(smmu->features & ARM_SMMU_FEAT_RANGE_INV) &&
+	    size >> ilog2(granule) > CMDQ_MAX_TLBI_OPS) {
+		switch (cmd->opcode) {
+		case CMDQ_OP_TLBI_NH_VA:
+			cmd->opcode = CMDQ_OP_TLBI_NH_ASID;
+			break;
+		case CMDQ_OP_TLBI_EL2_VA:
+			cmd->opcode = CMDQ_OP_TLBI_EL2_ASID;
+			break;
+		case CMDQ_OP_TLBI_S2_IPA:
+			cmd->opcode = CMDQ_OP_TLBI_S12_VMALL;
+			break;
+		}
+		arm_smmu_cmdq_issue_cmd_with_sync(smmu, cmd);
+		return;
+	}
+
 	if (smmu->features & ARM_SMMU_FEAT_RANGE_INV) {
 		/* Get the leaf page size */
 		tg = __ffs(smmu_domain->domain.pgsize_bitmap);
@@ -1959,6 +1981,18 @@ static void arm_smmu_tlb_inv_page_nosync(struct iommu_iotlb_gather *gather,
 	struct arm_smmu_domain *smmu_domain = cookie;
 	struct iommu_domain *domain = &smmu_domain->domain;
 
+	/*
+	 * With range invalidation, covering the gap between two disjoint
+	 * ranges costs a few more commands at most, which is much cheaper
+	 * than the CMD_SYNC round trip of flushing the gather early.
+	 */
+	if ((smmu_domain->smmu->features & ARM_SMMU_FEAT_RANGE_INV) &&
+	    (!gather->pgsize || gather->pgsize == granule)) {
+		gather->pgsize = granule;
+		iommu_iotlb_gather_add_range(gather, iova, granule);
+		return;
+	}
+
 	iommu_iotlb_gather_add_page(domain, gather, iova, granule);
 }
 
@@ -64,6 +64,25 @@ static int __init iommu_dma_forcedac_setup(char *str)
 }
 early_param("iommu.forcedac", iommu_dma_forcedac_setup);
 
+/*
+ * With iommu.dma_batch=N, strict DMA domains of trusted devices batch
+ * their IOTLB invalidations: one flush for every N unmaps, and no unmapped
+ * IOVA is left reachable for more than IOMMU_DMA_BATCH_TIMEOUT.
+ */
+#define IOMMU_DMA_BATCH_TIMEOUT	1	/* ms */
+static unsigned int iommu_dma_batch __read_mostly;
+
+static int __init iommu_dma_batch_setup(char *str)
+{
+	int ret = kstrtouint(str, 0, &iommu_dma_batch);
+
+	if (!ret && iommu_dma_batch)
+		pr_info("Batching up to %u IOTLB invalidations in strict mode\n",
+			iommu_dma_batch);
+	return ret;
+}
+early_param("iommu.dma_batch", iommu_dma_batch_setup);
+
 static void iommu_dma_entry_dtor(unsigned long data)
 {
 	struct page *freelist = (struct page *)data;
@@ -323,8 +342,11 @@ int iommu_dma_init_fq(struct iommu_domain *domain)
 	struct iommu_dma_cookie *cookie = domain->iova_cookie;
 	int ret;
 
-	if (cookie->fq_domain)
+	if (cookie->fq_domain) {
+		/* Switching a batched domain to lazy mode lifts the bounds */
+		iova_set_flush_queue_batch(&cookie->iovad, 0, IOVA_FQ_TIMEOUT);
 		return 0;
+	}
 
 	ret = init_iova_flush_queue(&cookie->iovad, iommu_dma_flush_iotlb_all,
 				    iommu_dma_entry_dtor);
@@ -397,6 +419,10 @@ static int iommu_dma_init_domain(struct iommu_domain *domain, dma_addr_t base,
 	/* If the FQ fails we can simply fall back to strict mode */
 	if (domain->type == IOMMU_DOMAIN_DMA_FQ && iommu_dma_init_fq(domain))
 		domain->type = IOMMU_DOMAIN_DMA;
+	else if (domain->type == IOMMU_DOMAIN_DMA && iommu_dma_batch &&
+		 !dev_is_untrusted(dev) && !iommu_dma_init_fq(domain))
+		iova_set_flush_queue_batch(iovad, iommu_dma_batch,
+					   IOMMU_DMA_BATCH_TIMEOUT);
 
 	return iova_reserve_iommu_regions(dev, domain);
 }
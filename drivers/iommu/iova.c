@@ -125,6 +125,9 @@ int init_iova_flush_queue(struct iova_domain *iovad,
 
 	timer_setup(&iovad->fq_timer, fq_flush_timeout, 0);
 	atomic_set(&iovad->fq_timer_on, 0);
+	iovad->fq_timeout = msecs_to_jiffies(IOVA_FQ_TIMEOUT);
+	iovad->fq_batch = 0;
+	atomic_set(&iovad->fq_pending, 0);
 
 	return 0;
 }
@@ -584,6 +587,7 @@ static void fq_ring_free(struct iova_domain *iovad, struct iova_fq *fq)
 
 static void iova_domain_flush(struct iova_domain *iovad)
 {
+	atomic_set(&iovad->fq_pending, 0);
 	atomic64_inc(&iovad->fq_flush_start_cnt);
 	iovad->flush_cb(iovad);
 	atomic64_inc(&iovad->fq_flush_finish_cnt);
@@ -670,13 +674,39 @@ void queue_iova(struct iova_domain *iovad,
 
 	spin_unlock_irqrestore(&fq->lock, flags);
 
+	/*
+	 * A bounded queue flushes as soon as enough unmaps have piled up
+	 * across all CPUs; the IOVAs are then released by the next
+	 * queue_iova() or the timer.
+	 */
+	if (iovad->fq_batch &&
+	    atomic_inc_return(&iovad->fq_pending) >= iovad->fq_batch)
+		iova_domain_flush(iovad);
+
 	/* Avoid false sharing as much as possible. */
 	if (!atomic_read(&iovad->fq_timer_on) &&
 	    !atomic_xchg(&iovad->fq_timer_on, 1))
-		mod_timer(&iovad->fq_timer,
-			  jiffies + msecs_to_jiffies(IOVA_FQ_TIMEOUT));
+		mod_timer(&iovad->fq_timer, jiffies + iovad->fq_timeout);
 }
 
+/**
+ * iova_set_flush_queue_batch - bound how long IOVAs stay in the flush queue
+ * @iovad: iova domain with a flush queue
+ * @batch: number of queued entries that triggers a flush, 0 for no limit
+ * @timeout_ms: longest time an entry stays queued
+ *
+ * This is for users that want most of the IOTLB flushes of strict mode
+ * batched, but with a much shorter window during which the device can
+ * still reach unmapped memory than the default queue allows.
+ */
+void iova_set_flush_queue_batch(struct iova_domain *iovad, unsigned int batch,
+				unsigned int timeout_ms)
+{
+	iovad->fq_batch = batch;
+	iovad->fq_timeout = max(msecs_to_jiffies(timeout_ms), 1UL);
+}
+EXPORT_SYMBOL_GPL(iova_set_flush_queue_batch);
+
 /**
  * put_iova_domain - destroys the iova domain
  * @iovad: - iova domain in question.
@@ -889,12 +919,15 @@ static void init_iova_rcaches(struct iova_domain *iovad)
 	struct iova_cpu_rcache *cpu_rcache;
 	struct iova_rcache *rcache;
 	unsigned int cpu;
-	int i;
+	int i, nid;
 
 	for (i = 0; i < IOVA_RANGE_CACHE_MAX_SIZE; ++i) {
 		rcache = &iovad->rcaches[i];
-		spin_lock_init(&rcache->lock);
-		rcache->depot_size = 0;
+		rcache->depots = kcalloc(nr_node_ids, sizeof(*rcache->depots),
+					 GFP_KERNEL);
+		WARN_ON(!rcache->depots);
+		for (nid = 0; rcache->depots && nid < nr_node_ids; nid++)
+			spin_lock_init(&rcache->depots[nid].lock);
 		rcache->cpu_rcaches = __alloc_percpu(sizeof(*cpu_rcache), cache_line_size());
 		if (WARN_ON(!rcache->cpu_rcaches))
 			continue;
@@ -907,6 +940,47 @@ static void init_iova_rcaches(struct iova_domain *iovad)
 	}
 }
 
+static struct iova_depot *iova_local_depot(struct iova_rcache *rcache)
+{
+	if (!rcache->depots)
+		return NULL;
+
+	return &rcache->depots[numa_node_id()];
+}
+
+/*
+ * Take a full magazine from the depot of the local node, or failing that
+ * from any other node's: a remote magazine is still much cheaper than an
+ * allocation from the rbtree.
+ */
+static struct iova_magazine *iova_depot_pop(struct iova_rcache *rcache)
+{
+	struct iova_magazine *mag = NULL;
+	struct iova_depot *depot;
+	int local, nid;
+
+	if (!rcache->depots)
+		return NULL;
+
+	local = numa_node_id();
+	for (nid = local; !mag; ) {
+		depot = &rcache->depots[nid];
+		if (READ_ONCE(depot->size)) {
+			spin_lock(&depot->lock);
+			if (depot->size > 0)
+				mag = depot->mags[--depot->size];
+			spin_unlock(&depot->lock);
+		}
+
+		if (++nid == nr_node_ids)
+			nid = 0;
+		if (nid == local)
+			break;
+	}
+
+	return mag;
+}
+
 /*
  * Try inserting IOVA range starting with 'iova_pfn' into 'rcache', and
  * return true on success.  Can fail if rcache is full and we can't free
@@ -934,14 +1008,19 @@ static bool __iova_rcache_insert(struct iova_domain *iovad,
 		struct iova_magazine *new_mag = iova_magazine_alloc(GFP_ATOMIC);
 
 		if (new_mag) {
-			spin_lock(&rcache->lock);
-			if (rcache->depot_size < MAX_GLOBAL_MAGS) {
-				rcache->depot[rcache->depot_size++] =
-						cpu_rcache->loaded;
+			struct iova_depot *depot = iova_local_depot(rcache);
+
+			if (depot) {
+				spin_lock(&depot->lock);
+				if (depot->size < MAX_GLOBAL_MAGS)
+					depot->mags[depot->size++] =
+							cpu_rcache->loaded;
+				else
+					mag_to_free = cpu_rcache->loaded;
+				spin_unlock(&depot->lock);
 			} else {
 				mag_to_free = cpu_rcache->loaded;
 			}
-			spin_unlock(&rcache->lock);
 
 			cpu_rcache->loaded = new_mag;
 			can_insert = true;
@@ -981,6 +1060,7 @@ static unsigned long __iova_rcache_get(struct iova_rcache *rcache,
 				       unsigned long limit_pfn)
 {
 	struct iova_cpu_rcache *cpu_rcache;
+	struct iova_magazine *mag;
 	unsigned long iova_pfn = 0;
 	bool has_pfn = false;
 	unsigned long flags;
@@ -994,13 +1074,12 @@ static unsigned long __iova_rcache_get(struct iova_rcache *rcache,
 		swap(cpu_rcache->prev, cpu_rcache->loaded);
 		has_pfn = true;
 	} else {
-		spin_lock(&rcache->lock);
-		if (rcache->depot_size > 0) {
+		mag = iova_depot_pop(rcache);
+		if (mag) {
 			iova_magazine_free(cpu_rcache->loaded);
-			cpu_rcache->loaded = rcache->depot[--rcache->depot_size];
+			cpu_rcache->loaded = mag;
 			has_pfn = true;
 		}
-		spin_unlock(&rcache->lock);
 	}
 
 	if (has_pfn)
@@ -1035,8 +1114,9 @@ static void free_iova_rcaches(struct iova_domain *iovad)
 {
 	struct iova_rcache *rcache;
 	struct iova_cpu_rcache *cpu_rcache;
+	struct iova_depot *depot;
 	unsigned int cpu;
-	int i, j;
+	int i, j, nid;
 
 	for (i = 0; i < IOVA_RANGE_CACHE_MAX_SIZE; ++i) {
 		rcache = &iovad->rcaches[i];
@@ -1046,8 +1126,14 @@ static void free_iova_rcaches(struct iova_domain *iovad)
 			iova_magazine_free(cpu_rcache->prev);
 		}
 		free_percpu(rcache->cpu_rcaches);
-		for (j = 0; j < rcache->depot_size; ++j)
-			iova_magazine_free(rcache->depot[j]);
+		if (!rcache->depots)
+			continue;
+		for (nid = 0; nid < nr_node_ids; nid++) {
+			depot = &rcache->depots[nid];
+			for (j = 0; j < depot->size; ++j)
+				iova_magazine_free(depot->mags[j]);
+		}
+		kfree(rcache->depots);
 	}
 }
 
@@ -1077,18 +1163,24 @@ static void free_cpu_cached_iovas(unsigned int cpu, struct iova_domain *iovad)
 static void free_global_cached_iovas(struct iova_domain *iovad)
 {
 	struct iova_rcache *rcache;
+	struct iova_depot *depot;
 	unsigned long flags;
-	int i, j;
+	int i, j, nid;
 
 	for (i = 0; i < IOVA_RANGE_CACHE_MAX_SIZE; ++i) {
 		rcache = &iovad->rcaches[i];
-		spin_lock_irqsave(&rcache->lock, flags);
-		for (j = 0; j < rcache->depot_size; ++j) {
-			iova_magazine_free_pfns(rcache->depot[j], iovad);
-			iova_magazine_free(rcache->depot[j]);
+		if (!rcache->depots)
+			continue;
+		for (nid = 0; nid < nr_node_ids; nid++) {
+			depot = &rcache->depots[nid];
+			spin_lock_irqsave(&depot->lock, flags);
+			for (j = 0; j < depot->size; ++j) {
+				iova_magazine_free_pfns(depot->mags[j], iovad);
+				iova_magazine_free(depot->mags[j]);
+			}
+			depot->size = 0;
+			spin_unlock_irqrestore(&depot->lock, flags);
 		}
-		rcache->depot_size = 0;
-		spin_unlock_irqrestore(&rcache->lock, flags);
 	}
 }
 MODULE_AUTHOR("Anil S Keshavamurthy <anil.s.keshavamurthy@intel.com>");
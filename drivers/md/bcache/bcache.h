@@ -375,6 +375,10 @@ struct cached_dev {
 	unsigned int		writeback_consider_fragment:1;
 	unsigned char		writeback_percent;
 	unsigned int		writeback_delay;
+	unsigned int		writeback_runs;
+	unsigned int		writeback_latency_target_us;
+	/* ewma of backing device write latency for writeback I/O */
+	unsigned long		writeback_latency_us;
 
 	uint64_t		writeback_rate_target;
 	int64_t			writeback_rate_proportional;
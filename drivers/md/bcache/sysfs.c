@@ -118,6 +118,9 @@ rw_attribute(writeback_percent);
 rw_attribute(writeback_delay);
 rw_attribute(writeback_rate);
 rw_attribute(writeback_consider_fragment);
+rw_attribute(writeback_runs);
+rw_attribute(writeback_latency_target_us);
+read_attribute(writeback_latency_us);
 
 rw_attribute(writeback_rate_update_seconds);
 rw_attribute(writeback_rate_i_term_inverse);
@@ -201,6 +204,9 @@ SHOW(__bch_cached_dev)
 	var_printf(writeback_consider_fragment,	"%i");
 	var_print(writeback_delay);
 	var_print(writeback_percent);
+	var_print(writeback_runs);
+	var_print(writeback_latency_target_us);
+	sysfs_print(writeback_latency_us, READ_ONCE(dc->writeback_latency_us));
 	sysfs_hprint(writeback_rate,
 		     wb ? atomic_long_read(&dc->writeback_rate.rate) << 9 : 0);
 	sysfs_printf(io_errors,		"%i", atomic_read(&dc->io_errors));
@@ -311,6 +317,10 @@ STORE(__cached_dev)
 	sysfs_strtoul_bool(writeback_running, dc->writeback_running);
 	sysfs_strtoul_bool(writeback_consider_fragment, dc->writeback_consider_fragment);
 	sysfs_strtoul_clamp(writeback_delay, dc->writeback_delay, 0, UINT_MAX);
+	sysfs_strtoul_clamp(writeback_runs, dc->writeback_runs,
+			    1, MAX_WRITEBACK_RUNS);
+	sysfs_strtoul_clamp(writeback_latency_target_us,
+			    dc->writeback_latency_target_us, 0, UINT_MAX);
 
 	sysfs_strtoul_clamp(writeback_percent, dc->writeback_percent,
 			    0, bch_cutoff_writeback);
@@ -516,6 +526,9 @@ static struct attribute *bch_cached_dev_files[] = {
 	&sysfs_writeback_percent,
 	&sysfs_writeback_rate,
 	&sysfs_writeback_consider_fragment,
+	&sysfs_writeback_runs,
+	&sysfs_writeback_latency_target_us,
+	&sysfs_writeback_latency_us,
 	&sysfs_writeback_rate_update_seconds,
 	&sysfs_writeback_rate_i_term_inverse,
 	&sysfs_writeback_rate_p_term_inverse,
@@ -280,10 +280,42 @@ static unsigned int writeback_delay(struct cached_dev *dc,
 	return bch_next_delay(&dc->writeback_rate, sectors);
 }
 
+/*
+ * While the backing device takes longer than writeback_latency_target_us to
+ * complete writeback writes, fall back to a single contiguous run per pass
+ * and stretch the delay between passes by the excess latency, so foreground
+ * I/O to the backing device is not starved.
+ */
+static bool writeback_over_latency(struct cached_dev *dc)
+{
+	return dc->writeback_latency_target_us &&
+	       READ_ONCE(dc->writeback_latency_us) >
+	       dc->writeback_latency_target_us;
+}
+
+static unsigned int writeback_runs(struct cached_dev *dc)
+{
+	return writeback_over_latency(dc) ? 1 : dc->writeback_runs;
+}
+
+static unsigned int writeback_latency_delay(struct cached_dev *dc)
+{
+	unsigned long excess;
+
+	if (test_bit(BCACHE_DEV_DETACHING, &dc->disk.flags) ||
+	    !writeback_over_latency(dc))
+		return 0;
+
+	excess = READ_ONCE(dc->writeback_latency_us) -
+		 dc->writeback_latency_target_us;
+	return usecs_to_jiffies(min_t(unsigned long, excess, USEC_PER_SEC));
+}
+
 struct dirty_io {
 	struct closure		cl;
 	struct cached_dev	*dc;
 	uint16_t		sequence;
+	u64			start_time;
 	struct bio		bio;
 };
 
@@ -356,6 +388,14 @@ static void dirty_endio(struct bio *bio)
 	if (bio->bi_status) {
 		SET_KEY_DIRTY(&w->key, false);
 		bch_count_backing_io_errors(io->dc, bio);
+	} else if (bio_op(bio) == REQ_OP_WRITE) {
+		struct cached_dev *dc = io->dc;
+		unsigned long lat = READ_ONCE(dc->writeback_latency_us);
+
+		/* racing updates may drop a sample, which is fine for an ewma */
+		ewma_add(lat, div_u64(ktime_get_ns() - io->start_time,
+				      NSEC_PER_USEC), 8, 0);
+		WRITE_ONCE(dc->writeback_latency_us, lat);
 	}
 
 	closure_put(&io->cl);
@@ -399,6 +439,7 @@ static void write_dirty(struct closure *cl)
 		io->bio.bi_iter.bi_sector = KEY_START(&w->key);
 		bio_set_dev(&io->bio, io->dc->bdev);
 		io->bio.bi_end_io	= dirty_endio;
+		io->start_time		= ktime_get_ns();
 
 		/* I/O request sent to backing device */
 		closure_bio_submit(io->dc->disk.c, &io->bio, cl);
@@ -435,9 +476,10 @@ static void read_dirty_submit(struct closure *cl)
 static void read_dirty(struct cached_dev *dc)
 {
 	unsigned int delay = 0;
-	struct keybuf_key *next, *keys[MAX_WRITEBACKS_IN_PASS], *w;
-	size_t size;
-	int nk, i;
+	struct keybuf_key *next, *w;
+	struct keybuf_key *keys[MAX_WRITEBACKS_IN_PASS * MAX_WRITEBACK_RUNS];
+	size_t size, run_size;
+	int nk, run_nk, runs, i;
 	struct dirty_io *io;
 	struct closure cl;
 	uint16_t sequence = 0;
@@ -458,42 +500,49 @@ static void read_dirty(struct cached_dev *dc)
 	       next) {
 		size = 0;
 		nk = 0;
+		run_size = 0;
+		run_nk = 0;
+		runs = writeback_runs(dc);
 
 		do {
 			BUG_ON(ptr_stale(dc->disk.c, &next->key, 0));
 
+			/*
+			 * Operations are only eligible to be combined
+			 * if they are contiguous.  A non-contiguous key
+			 * starts a new run; up to writeback_runs runs are
+			 * issued per pass, so that we can benefit from
+			 * backing device command queueing.
+			 */
+			if ((nk != 0) && bkey_cmp(&keys[nk-1]->key,
+						&START_KEY(&next->key))) {
+				if (!--runs)
+					break;
+				run_size = 0;
+				run_nk = 0;
+			}
+
 			/*
 			 * Don't combine too many operations, even if they
 			 * are all small.
 			 */
-			if (nk >= MAX_WRITEBACKS_IN_PASS)
+			if (run_nk >= MAX_WRITEBACKS_IN_PASS)
 				break;
 
 			/*
 			 * If the current operation is very large, don't
 			 * further combine operations.
 			 */
-			if (size >= MAX_WRITESIZE_IN_PASS)
-				break;
-
-			/*
-			 * Operations are only eligible to be combined
-			 * if they are contiguous.
-			 *
-			 * TODO: add a heuristic willing to fire a
-			 * certain amount of non-contiguous IO per pass,
-			 * so that we can benefit from backing device
-			 * command queueing.
-			 */
-			if ((nk != 0) && bkey_cmp(&keys[nk-1]->key,
-						&START_KEY(&next->key)))
+			if (run_size >= MAX_WRITESIZE_IN_PASS)
 				break;
 
+			run_size += KEY_SIZE(&next->key);
 			size += KEY_SIZE(&next->key);
+			run_nk++;
 			keys[nk++] = next;
 		} while ((next = bch_keybuf_next(&dc->writeback_keys)));
 
-		/* Now we have gathered a set of 1..5 keys to write back. */
+		/* Now we have gathered 1..5 keys per run to write back. */
 		for (i = 0; i < nk; i++) {
 			w = keys[i];
 
@@ -528,7 +577,7 @@ static void read_dirty(struct cached_dev *dc)
 			closure_call(&io->cl, read_dirty_submit, NULL, &cl);
 		}
 
-		delay = writeback_delay(dc, size);
+		delay = writeback_delay(dc, size) + writeback_latency_delay(dc);
 
 		while (!kthread_should_stop() &&
 		       !test_bit(CACHE_SET_IO_DISABLE, &dc->disk.c->flags) &&
@@ -1017,6 +1066,7 @@ void bch_cached_dev_writeback_init(struct cached_dev *dc)
 	dc->writeback_consider_fragment = true;
 	dc->writeback_percent		= 10;
 	dc->writeback_delay		= 30;
+	dc->writeback_runs		= DEFAULT_WRITEBACK_RUNS;
 	atomic_long_set(&dc->writeback_rate.rate, 1024);
 	dc->writeback_rate_minimum	= 8;
 
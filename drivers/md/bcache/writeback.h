@@ -10,6 +10,8 @@
 
 #define MAX_WRITEBACKS_IN_PASS  5
 #define MAX_WRITESIZE_IN_PASS   5000	/* *512b */
+#define MAX_WRITEBACK_RUNS	8	/* non-contiguous runs per pass */
+#define DEFAULT_WRITEBACK_RUNS	4
 
 #define WRITEBACK_RATE_UPDATE_SECS_MAX		60
 #define WRITEBACK_RATE_UPDATE_SECS_DEFAULT	5
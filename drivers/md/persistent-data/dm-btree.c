@@ -494,6 +494,131 @@ int dm_btree_lookup_next(struct dm_btree_info *info, dm_block_t root,
 
 EXPORT_SYMBOL_GPL(dm_btree_lookup_next);
 
+/*
+ * Returns the index one past the last of @keys[@k..@nr) that is covered by
+ * entry @i of internal node @n.
+ */
+static unsigned batch_span(struct btree_node *n, int i, const uint64_t *keys,
+			   unsigned k, unsigned nr)
+{
+	uint32_t nr_entries = le32_to_cpu(n->header.nr_entries);
+	uint64_t limit;
+
+	if (i + 1 >= nr_entries)
+		return nr;
+
+	limit = le64_to_cpu(n->keys[i + 1]);
+	for (k++; k < nr && keys[k] < limit; k++)
+		;
+	return k;
+}
+
+static int lookup_batch_node(struct dm_btree_info *info, dm_block_t block,
+			     const uint64_t *keys, unsigned nr,
+			     void *values_le, int *results)
+{
+	size_t value_size = info->value_type.size;
+	struct dm_block_manager *bm = dm_tm_get_bm(info->tm);
+	struct dm_block *node;
+	struct btree_node *n;
+	uint32_t flags, nr_entries;
+	unsigned k, end;
+	int i, r;
+
+	r = bn_read_lock(info, block, &node);
+	if (r)
+		return r;
+
+	n = dm_block_data(node);
+	flags = le32_to_cpu(n->header.flags);
+	nr_entries = le32_to_cpu(n->header.nr_entries);
+
+	if (flags & LEAF_NODE) {
+		for (k = 0; k < nr; k++) {
+			i = lower_bound(n, keys[k]);
+			if (i < 0 || i >= nr_entries ||
+			    le64_to_cpu(n->keys[i]) != keys[k]) {
+				results[k] = -ENODATA;
+				continue;
+			}
+
+			memcpy(values_le + k * value_size, value_ptr(n, i),
+			       value_size);
+			results[k] = 0;
+		}
+		goto out;
+	}
+
+	/*
+	 * Start reading every child the batch needs before waiting on the
+	 * first one.
+	 */
+	for (k = 0; k < nr; k = end) {
+		i = lower_bound(n, keys[k]);
+		if (i < 0) {
+			end = k + 1;
+			continue;
+		}
+		end = batch_span(n, i, keys, k, nr);
+		dm_bm_prefetch(bm, value64(n, i));
+	}
+
+	for (k = 0; k < nr; k = end) {
+		i = lower_bound(n, keys[k]);
+		if (i < 0 || i >= nr_entries) {
+			results[k] = -ENODATA;
+			end = k + 1;
+			continue;
+		}
+
+		end = batch_span(n, i, keys, k, nr);
+		r = lookup_batch_node(info, value64(n, i), keys + k, end - k,
+				      values_le + k * value_size, results + k);
+		if (r)
+			break;
+	}
+out:
+	dm_tm_unlock(info->tm, node);
+	return r;
+}
+
+int dm_btree_lookup_batch(struct dm_btree_info *info, dm_block_t root,
+			  uint64_t *keys, const uint64_t *bottom_keys,
+			  unsigned nr, void *values_le, int *results)
+{
+	unsigned level, k;
+	int r = 0;
+	uint64_t rkey;
+	__le64 internal_value_le;
+	struct ro_spine spine;
+
+	init_ro_spine(&spine, info);
+	for (level = 0; level < info->levels - 1u; level++) {
+		r = btree_lookup_raw(&spine, root, keys[level],
+				     lower_bound, &rkey,
+				     &internal_value_le, sizeof(uint64_t));
+		if (!r && rkey != keys[level])
+			r = -ENODATA;
+		if (r)
+			break;
+
+		root = le64_to_cpu(internal_value_le);
+	}
+	exit_ro_spine(&spine);
+
+	if (r == -ENODATA) {
+		for (k = 0; k < nr; k++)
+			results[k] = -ENODATA;
+		return 0;
+	}
+	if (r)
+		return r;
+
+	return lookup_batch_node(info, root, bottom_keys, nr, values_le,
+				 results);
+}
+EXPORT_SYMBOL_GPL(dm_btree_lookup_batch);
+
 /*----------------------------------------------------------------*/
 
 /*
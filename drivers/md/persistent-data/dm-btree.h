@@ -116,6 +116,22 @@ int dm_btree_lookup(struct dm_btree_info *info, dm_block_t root,
 int dm_btree_lookup_next(struct dm_btree_info *info, dm_block_t root,
 			 uint64_t *keys, uint64_t *rkey, void *value_le);
 
+/*
+ * Looks up many bottom level keys at once.  @keys holds the keys for the
+ * upper levels (info->levels - 1 of them) and @bottom_keys the @nr bottom
+ * level keys, sorted in ascending order.  Each node on the way is read
+ * only once, and all the children needed from a node are prefetched
+ * before the first is descended into, so cold metadata is read with
+ * concurrent rather than back to back I/O.
+ *
+ * The value for bottom_keys[i] is copied to values_le[i] and results[i]
+ * is set to 0 or -ENODATA.  Returns 0, or an error if a node couldn't be
+ * read, in which case the contents of @results are undefined.
+ */
+int dm_btree_lookup_batch(struct dm_btree_info *info, dm_block_t root,
+			  uint64_t *keys, const uint64_t *bottom_keys,
+			  unsigned nr, void *values_le, int *results);
+
 /*
  * Insertion (or overwrite an existing value).  O(ln(n))
  */
@@ -78,6 +78,7 @@
 #include <net/netns/generic.h>
 #include <net/pkt_sched.h>
 #include <linux/rculist.h>
+#include <linux/hash.h>
 #include <net/flow_dissector.h>
 #include <net/xfrm.h>
 #include <net/bonding.h>
@@ -117,6 +118,7 @@ static struct bond_params bonding_defaults;
 static int resend_igmp = BOND_DEFAULT_RESEND_IGMP;
 static int packets_per_slave = 1;
 static int lp_interval = BOND_ALB_DEFAULT_LP_INTERVAL;
+static int xmit_resilient_hash;
 
 module_param(max_bonds, int, 0);
 MODULE_PARM_DESC(max_bonds, "Max number of bonded devices");
@@ -197,6 +199,11 @@ module_param(lp_interval, uint, 0);
 MODULE_PARM_DESC(lp_interval, "The number of seconds between instances where "
 			      "the bonding driver sends learning packets to "
 			      "each slaves peer switch. The default is 1.");
+module_param(xmit_resilient_hash, int, 0644);
+MODULE_PARM_DESC(xmit_resilient_hash, "balance-xor, 802.3ad: only move the flows "
+				      "of a slave that goes away when the set of "
+				      "usable slaves changes; 0 for off (default), "
+				      "1 for on");
 
 /*----------------------------- Global variables ----------------------------*/
 
@@ -4784,11 +4791,40 @@ int bond_update_slave_arr(struct bonding *bond, struct slave *skipslave)
 	return ret;
 }
 
+/* Map a flow hash to one of @count usable slaves.  Taking the hash modulo
+ * the count remaps most flows whenever a slave comes or goes.  With
+ * xmit_resilient_hash every slave gets a per-flow score derived from its
+ * ifindex and the flow goes to the highest one (rendezvous hashing): a
+ * slave leaving the array only moves its own flows, and one joining only
+ * takes over its share.
+ */
+static struct slave *bond_xmit_hash_slave(struct bond_up_slave *slaves,
+					  unsigned int count, u32 hash)
+{
+	struct slave *slave, *best;
+	u32 score, best_score = 0;
+	unsigned int i;
+
+	if (!READ_ONCE(xmit_resilient_hash))
+		return slaves->arr[hash % count];
+
+	best = slaves->arr[0];
+	for (i = 0; i < count; i++) {
+		slave = slaves->arr[i];
+		score = hash_64(((u64)hash << 32) | slave->dev->ifindex, 32);
+		if (score >= best_score) {
+			best_score = score;
+			best = slave;
+		}
+	}
+
+	return best;
+}
+
 static struct slave *bond_xmit_3ad_xor_slave_get(struct bonding *bond,
 						 struct sk_buff *skb,
 						 struct bond_up_slave *slaves)
 {
-	struct slave *slave;
 	unsigned int count;
 	u32 hash;
 
@@ -4797,8 +4833,7 @@ static struct slave *bond_xmit_3ad_xor_slave_get(struct bonding *bond,
 	if (unlikely(!count))
 		return NULL;
 
-	slave = slaves->arr[hash % count];
-	return slave;
+	return bond_xmit_hash_slave(slaves, count, hash);
 }
 
 static struct slave *bond_xdp_xmit_3ad_xor_slave_get(struct bonding *bond,
@@ -4814,7 +4849,7 @@ static struct slave *bond_xdp_xmit_3ad_xor_slave_get(struct bonding *bond,
 	if (unlikely(!count))
 		return NULL;
 
-	return slaves->arr[hash % count];
+	return bond_xmit_hash_slave(slaves, count, hash);
 }
 
 /* Use this Xmit function for 3AD as well as XOR modes. The current
@@ -5016,7 +5051,7 @@ static struct net_device *__bond_sk_get_lower_dev(struct bonding *bond,
 		return NULL;
 
 	hash = bond_sk_hash_l34(sk);
-	slave = slaves->arr[hash % count];
+	slave = bond_xmit_hash_slave(slaves, count, hash);
 
 	return slave->dev;
 }
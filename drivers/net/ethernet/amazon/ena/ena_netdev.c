@@ -407,8 +407,8 @@ static int ena_xdp_execute(struct ena_ring *rx_ring, struct xdp_buff *xdp)
 		/* The XDP queues are shared between XDP_TX and XDP_REDIRECT */
 		spin_lock(&xdp_ring->xdp_tx_lock);
 
-		if (ena_xdp_xmit_frame(xdp_ring, rx_ring->netdev, xdpf,
-				       XDP_XMIT_FLUSH))
+		/* The doorbell is rung once per NAPI poll */
+		if (ena_xdp_xmit_frame(xdp_ring, rx_ring->netdev, xdpf, 0))
 			xdp_return_frame(xdpf);
 
 		spin_unlock(&xdp_ring->xdp_tx_lock);
@@ -905,6 +905,12 @@ static int ena_setup_rx_resources(struct ena_adapter *adapter,
 	for (i = 0; i < rx_ring->ring_size; i++)
 		rx_ring->free_ids[i] = i;
 
+	/* Pages are just not reused if this fails */
+	rx_ring->page_cache = kzalloc_node(sizeof(*rx_ring->page_cache),
+					   GFP_KERNEL, node);
+	memset(rx_ring->rx_len_hist, 0, sizeof(rx_ring->rx_len_hist));
+	rx_ring->rx_len_cnt = 0;
+
 	/* Reset rx statistics */
 	memset(&rx_ring->rx_stats, 0x0, sizeof(rx_ring->rx_stats));
 
@@ -931,6 +937,9 @@ static void ena_free_rx_resources(struct ena_adapter *adapter,
 
 	vfree(rx_ring->free_ids);
 	rx_ring->free_ids = NULL;
+
+	kfree(rx_ring->page_cache);
+	rx_ring->page_cache = NULL;
 }
 
 /* ena_setup_all_rx_resources - allocate I/O Rx queues resources for all queues
@@ -1004,6 +1013,85 @@ static struct page *ena_alloc_map_page(struct ena_ring *rx_ring,
 	return page;
 }
 
+/* Take back the oldest page handed up the stack, if the stack is done
+ * with it.  Pages are handed up in order, so the ones after it are not
+ * worth looking at.
+ */
+static struct page *ena_rx_page_cache_get(struct ena_ring *rx_ring,
+					  dma_addr_t *dma)
+{
+	struct ena_rx_page_cache *cache = rx_ring->page_cache;
+	struct page *page;
+	u32 idx;
+
+	if (!cache || cache->tail == cache->head)
+		return NULL;
+
+	idx = cache->tail & (ENA_RX_PAGE_CACHE_SIZE - 1);
+	page = cache->buf[idx].page;
+	if (page_ref_count(page) != 1)
+		return NULL;
+
+	cache->tail++;
+	*dma = cache->buf[idx].dma;
+	dma_sync_single_for_device(rx_ring->dev, *dma, ENA_PAGE_SIZE,
+				   DMA_BIDIRECTIONAL);
+	ena_increase_stat(&rx_ring->rx_stats.page_reuse, 1, &rx_ring->syncp);
+
+	return page;
+}
+
+static void ena_rx_page_cache_drain(struct ena_ring *rx_ring)
+{
+	struct ena_rx_page_cache *cache = rx_ring->page_cache;
+	u32 idx;
+
+	if (!cache)
+		return;
+
+	for (; cache->tail != cache->head; cache->tail++) {
+		idx = cache->tail & (ENA_RX_PAGE_CACHE_SIZE - 1);
+		dma_unmap_page(rx_ring->dev, cache->buf[idx].dma,
+			       ENA_PAGE_SIZE, DMA_BIDIRECTIONAL);
+		put_page(cache->buf[idx].page);
+	}
+}
+
+/* The stack takes over the page of @rx_info.  Keep it mapped, with a
+ * reference of our own, for ena_rx_page_cache_get() if there is room,
+ * otherwise unmap it.  The caller has synced it for the CPU.
+ */
+static void ena_rx_release_page(struct ena_ring *rx_ring,
+				struct ena_rx_buffer *rx_info)
+{
+	struct ena_rx_page_cache *cache = rx_ring->page_cache;
+	dma_addr_t dma = rx_info->ena_buf.paddr - rx_ring->rx_headroom;
+	struct page *page = rx_info->page;
+	u32 idx;
+
+	rx_info->page = NULL;
+
+	if (cache && cache->head - cache->tail < ENA_RX_PAGE_CACHE_SIZE &&
+	    !page_is_pfmemalloc(page) && page_to_nid(page) == numa_mem_id()) {
+		page_ref_inc(page);
+		idx = cache->head++ & (ENA_RX_PAGE_CACHE_SIZE - 1);
+		cache->buf[idx].page = page;
+		cache->buf[idx].dma = dma;
+		return;
+	}
+
+	dma_unmap_page_attrs(rx_ring->dev, dma, ENA_PAGE_SIZE,
+			     DMA_BIDIRECTIONAL, DMA_ATTR_SKIP_CPU_SYNC);
+}
+
+static void ena_rx_sync_for_cpu(struct ena_ring *rx_ring,
+				struct ena_rx_buffer *rx_info, u32 len)
+{
+	dma_sync_single_for_cpu(rx_ring->dev,
+				rx_info->ena_buf.paddr - rx_ring->rx_headroom,
+				rx_info->page_offset + len, DMA_BIDIRECTIONAL);
+}
+
 static int ena_alloc_rx_buffer(struct ena_ring *rx_ring,
 			       struct ena_rx_buffer *rx_info)
 {
@@ -1021,7 +1109,9 @@ static int ena_alloc_rx_buffer(struct ena_ring *rx_ring,
 		return 0;
 
 	/* We handle DMA here */
-	page = ena_alloc_map_page(rx_ring, &dma);
+	page = ena_rx_page_cache_get(rx_ring, &dma);
+	if (!page)
+		page = ena_alloc_map_page(rx_ring, &dma);
 	if (unlikely(IS_ERR(page)))
 		return PTR_ERR(page);
 
@@ -1129,6 +1219,8 @@ static void ena_free_rx_bufs(struct ena_adapter *adapter,
 		if (rx_info->page)
 			ena_free_rx_page(rx_ring, rx_info);
 	}
+
+	ena_rx_page_cache_drain(rx_ring);
 }
 
 /* ena_refill_all_rx_bufs - allocate all queues Rx buffers
@@ -1483,7 +1575,7 @@ static struct sk_buff *ena_rx_skb(struct ena_ring *rx_ring,
 		return skb;
 	}
 
-	ena_unmap_rx_buff(rx_ring, rx_info);
+	ena_rx_sync_for_cpu(rx_ring, rx_info, len);
 
 	skb = ena_alloc_skb(rx_ring, page_addr);
 	if (unlikely(!skb))
@@ -1499,7 +1591,7 @@ static struct sk_buff *ena_rx_skb(struct ena_ring *rx_ring,
 			  "RX skb updated. len %d. data_len %d\n",
 			  skb->len, skb->data_len);
 
-		rx_info->page = NULL;
+		ena_rx_release_page(rx_ring, rx_info);
 
 		rx_ring->free_ids[*next_to_clean] = req_id;
 		*next_to_clean =
@@ -1514,7 +1606,7 @@ static struct sk_buff *ena_rx_skb(struct ena_ring *rx_ring,
 
 		rx_info = &rx_ring->rx_buffer_info[req_id];
 
-		ena_unmap_rx_buff(rx_ring, rx_info);
+		ena_rx_sync_for_cpu(rx_ring, rx_info, len);
 
 		skb_add_rx_frag(skb, skb_shinfo(skb)->nr_frags, rx_info->page,
 				rx_info->page_offset, len, ENA_PAGE_SIZE);
@@ -1633,6 +1725,36 @@ static int ena_xdp_handle_buff(struct ena_ring *rx_ring, struct xdp_buff *xdp)
 
 	return ret;
 }
+/* Account a received packet of @len bytes and, once per window, set the
+ * ring's copybreak to the end of the highest histogram bucket that held
+ * at least 1/16 of the packets.  Only the sizes that are common get
+ * copied; the rarer ones in between go up in the page, which is cheap
+ * when it is recycled, and copied packets get skbs no bigger than needed.
+ */
+static void ena_rx_update_copybreak(struct ena_ring *rx_ring, u32 len)
+{
+	u32 max = READ_ONCE(rx_ring->adapter->rx_copybreak);
+	u32 copybreak = ENA_RX_COPYBREAK_MIN;
+	int i;
+
+	if (len <= max) {
+		i = len <= 64 ? 0 : ilog2(len - 1) - 5;
+		rx_ring->rx_len_hist[min(i, ENA_RX_LEN_BUCKETS - 1)]++;
+	}
+
+	if (++rx_ring->rx_len_cnt < ENA_RX_COPYBREAK_WINDOW)
+		return;
+
+	for (i = 0; i < ENA_RX_LEN_BUCKETS; i++) {
+		if (rx_ring->rx_len_hist[i] >= ENA_RX_COPYBREAK_WINDOW / 16)
+			copybreak = i == ENA_RX_LEN_BUCKETS - 1 ?
+				    max : max_t(u32, copybreak, 64 << i);
+		rx_ring->rx_len_hist[i] = 0;
+	}
+	rx_ring->rx_len_cnt = 0;
+	rx_ring->rx_copybreak = min(copybreak, max);
+}
+
 /* ena_clean_rx_irq - Cleanup RX irq
  * @rx_ring: RX ring to clean
  * @napi: napi handler
@@ -1718,7 +1840,7 @@ static int ena_clean_rx_irq(struct ena_ring *rx_ring, struct napi_struct *napi,
 				}
 			}
 			if (xdp_verdict != XDP_PASS) {
-				xdp_flags |= xdp_verdict;
+				xdp_flags |= BIT(xdp_verdict);
 				res_budget--;
 				continue;
 			}
@@ -1733,6 +1855,7 @@ static int ena_clean_rx_irq(struct ena_ring *rx_ring, struct napi_struct *napi,
 
 		if (rx_ring->ena_bufs[0].len <= rx_ring->rx_copybreak)
 			rx_copybreak_pkt++;
+		ena_rx_update_copybreak(rx_ring, rx_ring->ena_bufs[0].len);
 
 		total_len += skb->len;
 
@@ -1762,7 +1885,13 @@ static int ena_clean_rx_irq(struct ena_ring *rx_ring, struct napi_struct *napi,
 		ena_refill_rx_bufs(rx_ring, refill_required);
 	}
 
-	if (xdp_flags & XDP_REDIRECT)
+	if (xdp_flags & BIT(XDP_TX)) {
+		spin_lock(&rx_ring->xdp_ring->xdp_tx_lock);
+		ena_ring_tx_doorbell(rx_ring->xdp_ring);
+		spin_unlock(&rx_ring->xdp_ring->xdp_tx_lock);
+	}
+
+	if (xdp_flags & BIT(XDP_REDIRECT))
 		xdp_do_flush_map();
 
 	return work_done;
@@ -55,6 +55,19 @@
 #define ENA_TX_WAKEUP_THRESH		(MAX_SKB_FRAGS + 2)
 #define ENA_DEFAULT_RX_COPYBREAK	(256 - NET_IP_ALIGN)
 
+/* The RX copybreak in use is re-evaluated every ENA_RX_COPYBREAK_WINDOW
+ * packets from a histogram of packet lengths, with buckets ending at
+ * 64, 128, ... bytes and the last one at the configured copybreak.
+ */
+#define ENA_RX_COPYBREAK_WINDOW		1024
+#define ENA_RX_COPYBREAK_MIN		128
+#define ENA_RX_LEN_BUCKETS		5
+
+/* Pages handed up the stack that an RX ring keeps mapped, so that it can
+ * refill with them once the stack is done. Must be a power of 2.
+ */
+#define ENA_RX_PAGE_CACHE_SIZE		256
+
 #define ENA_MIN_MTU		128
 
 #define ENA_NAME_MAX_LEN	20
@@ -190,6 +203,15 @@ struct ena_rx_buffer {
 	struct ena_com_buf ena_buf;
 } ____cacheline_aligned;
 
+struct ena_rx_page_cache {
+	u32 head;
+	u32 tail;
+	struct {
+		struct page *page;
+		dma_addr_t dma;
+	} buf[ENA_RX_PAGE_CACHE_SIZE];
+};
+
 struct ena_stats_tx {
 	u64 cnt;
 	u64 bytes;
@@ -229,6 +251,7 @@ struct ena_stats_rx {
 	u64 xdp_tx;
 	u64 xdp_invalid;
 	u64 xdp_redirect;
+	u64 page_reuse;
 };
 
 struct ena_ring {
@@ -281,6 +304,9 @@ struct ena_ring {
 	enum ena_admin_placement_policy_type tx_mem_queue_type;
 
 	struct ena_com_rx_buf_info ena_bufs[ENA_PKT_MAX_BUFS];
+	struct ena_rx_page_cache *page_cache;
+	u16 rx_len_hist[ENA_RX_LEN_BUCKETS];
+	u16 rx_len_cnt;
 	u32  smoothed_interval;
 	u32  per_napi_packets;
 	u16 non_empty_napi_events;
@@ -14,6 +14,8 @@
 #include <linux/workqueue.h>
 #include <linux/refcount.h>
 #include <linux/xarray.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include "lib/fs_chains.h"
 #include "en/tc_ct.h"
@@ -56,6 +58,7 @@ struct mlx5_tc_ct_priv {
 	enum mlx5_flow_namespace_type ns_type;
 	struct mlx5_fs_chains *chains;
 	spinlock_t ht_lock; /* protects ft entries */
+	struct dentry *dbg_dir;
 };
 
 struct mlx5_ct_flow {
@@ -92,6 +95,12 @@ struct mlx5_ct_ft {
 	struct rhashtable ct_entries_ht;
 	struct mlx5_tc_ct_pre pre_ct;
 	struct mlx5_tc_ct_pre pre_ct_nat;
+	struct {
+		atomic64_t adds;
+		atomic64_t add_fails;
+		atomic64_t add_ns;
+		atomic64_t dels;
+	} stats;
 };
 
 struct mlx5_ct_tuple {
@@ -1159,15 +1168,28 @@ mlx5_tc_ct_block_flow_offload(enum tc_setup_type type, void *type_data,
 {
 	struct flow_cls_offload *f = type_data;
 	struct mlx5_ct_ft *ft = cb_priv;
+	u64 start;
+	int err;
 
 	if (type != TC_SETUP_CLSFLOWER)
 		return -EOPNOTSUPP;
 
 	switch (f->command) {
 	case FLOW_CLS_REPLACE:
-		return mlx5_tc_ct_block_flow_offload_add(ft, f);
+		start = ktime_get_ns();
+		err = mlx5_tc_ct_block_flow_offload_add(ft, f);
+		if (!err) {
+			atomic64_inc(&ft->stats.adds);
+			atomic64_add(ktime_get_ns() - start, &ft->stats.add_ns);
+		} else if (err != -EEXIST) {
+			atomic64_inc(&ft->stats.add_fails);
+		}
+		return err;
 	case FLOW_CLS_DESTROY:
-		return mlx5_tc_ct_block_flow_offload_del(ft, f);
+		err = mlx5_tc_ct_block_flow_offload_del(ft, f);
+		if (!err)
+			atomic64_inc(&ft->stats.dels);
+		return err;
 	case FLOW_CLS_STATS:
 		return mlx5_tc_ct_block_flow_offload_stats(ft, f);
 	default:
@@ -2060,6 +2082,37 @@ mlx5_tc_ct_init_check_support(struct mlx5e_priv *priv,
 	return 0;
 }
 
+/* Per zone: offloaded entries, adds, failed adds, dels, avg add time (ns) */
+static int mlx5_tc_ct_zones_show(struct seq_file *m, void *v)
+{
+	struct mlx5_tc_ct_priv *ct_priv = m->private;
+	struct rhashtable_iter iter;
+	struct mlx5_ct_ft *ft;
+	u64 adds;
+
+	mutex_lock(&ct_priv->control_lock);
+	rhashtable_walk_enter(&ct_priv->zone_ht, &iter);
+	rhashtable_walk_start(&iter);
+	while ((ft = rhashtable_walk_next(&iter))) {
+		if (IS_ERR(ft))
+			continue;
+
+		adds = atomic64_read(&ft->stats.adds);
+		seq_printf(m, "%u %u %lld %lld %lld %llu\n", ft->zone,
+			   atomic_read(&ft->ct_entries_ht.nelems), adds,
+			   atomic64_read(&ft->stats.add_fails),
+			   atomic64_read(&ft->stats.dels),
+			   adds ? div64_u64(atomic64_read(&ft->stats.add_ns),
+					    adds) : 0);
+	}
+	rhashtable_walk_stop(&iter);
+	rhashtable_walk_exit(&iter);
+	mutex_unlock(&ct_priv->control_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(mlx5_tc_ct_zones);
+
 #define INIT_ERR_PREFIX "tc ct offload init failed"
 
 struct mlx5_tc_ct_priv *
@@ -2131,6 +2184,11 @@ mlx5_tc_ct_init(struct mlx5e_priv *priv, struct mlx5_fs_chains *chains,
 	rhashtable_init(&ct_priv->ct_tuples_ht, &tuples_ht_params);
 	rhashtable_init(&ct_priv->ct_tuples_nat_ht, &tuples_nat_ht_params);
 
+	ct_priv->dbg_dir = debugfs_create_dir(ns_type == MLX5_FLOW_NAMESPACE_FDB ?
+					      "ct_fdb" : "ct_nic", dev->priv.dbg_root);
+	debugfs_create_file("zones", 0400, ct_priv->dbg_dir, ct_priv,
+			    &mlx5_tc_ct_zones_fops);
+
 	return ct_priv;
 
 err_ct_nat_tbl:
@@ -2157,6 +2215,7 @@ mlx5_tc_ct_clean(struct mlx5_tc_ct_priv *ct_priv)
 
 	chains = ct_priv->chains;
 
+	debugfs_remove_recursive(ct_priv->dbg_dir);
 	mlx5_chains_destroy_global_table(chains, ct_priv->ct_nat);
 	mlx5_chains_destroy_global_table(chains, ct_priv->ct);
 	mapping_destroy(ct_priv->zone_mapping);
@@ -123,14 +123,6 @@ static inline bool mlx5e_xdp_get_inline_state(struct mlx5e_xdpsq *sq, bool cur)
 	return cur;
 }
 
-static inline bool mlx5e_xdp_mpqwe_is_full(struct mlx5e_tx_mpwqe *session)
-{
-	if (session->inline_on)
-		return session->ds_count + MLX5E_XDP_INLINE_WQE_MAX_DS_CNT >
-		       MLX5E_TX_MPW_MAX_NUM_DS;
-	return mlx5e_tx_mpwqe_is_full(session);
-}
-
 struct mlx5e_xdp_wqe_info {
 	u8 num_wqebbs;
 	u8 num_pkts;
@@ -145,15 +137,21 @@ mlx5e_xdp_mpwqe_add_dseg(struct mlx5e_xdpsq *sq,
 	struct mlx5_wqe_data_seg *dseg =
 		(struct mlx5_wqe_data_seg *)session->wqe + session->ds_count;
 	u32 dma_len = xdptxd->len;
+	u16 ds_cnt;
 
 	session->pkt_count++;
 	session->bytes_count += dma_len;
 
-	if (session->inline_on && dma_len <= MLX5E_XDP_INLINE_WQE_SZ_THRSD) {
+	/* Frames too big to be inlined, or to be inlined in what is left of
+	 * the session, still go in it as a pointer: the session is only
+	 * complete once it has no room for a single data segment.
+	 */
+	ds_cnt = DIV_ROUND_UP(sizeof(struct mlx5_wqe_inline_seg) + dma_len,
+			      MLX5_SEND_WQE_DS);
+	if (session->inline_on && dma_len <= MLX5E_XDP_INLINE_WQE_SZ_THRSD &&
+	    session->ds_count + ds_cnt <= MLX5E_TX_MPW_MAX_NUM_DS) {
 		struct mlx5_wqe_inline_seg *inline_dseg =
 			(struct mlx5_wqe_inline_seg *)dseg;
-		u16 ds_len = sizeof(*inline_dseg) + dma_len;
-		u16 ds_cnt = DIV_ROUND_UP(ds_len, MLX5_SEND_WQE_DS);
 
 		inline_dseg->byte_count = cpu_to_be32(dma_len | MLX5_INLINE_SEG);
 		memcpy(inline_dseg->data, xdptxd->data, dma_len);
@@ -881,6 +881,14 @@ struct nvsp_message {
 #define RNDIS_PKT_ALIGN_DEFAULT 8
 
 #define NETVSC_XDP_HDRM 256
+#define NETVSC_XDP_POOL_SIZE 256
+
+/* Received packets longer than rx_copybreak are copied into page
+ * fragments behind a NETVSC_RX_HDR_LEN linear header, instead of one
+ * linear buffer that may need a high order allocation.
+ */
+#define NETVSC_RX_COPYBREAK_DEFAULT 2048
+#define NETVSC_RX_HDR_LEN 256
 
 #define NETVSC_MIN_OUT_MSG_SIZE (sizeof(struct vmpacket_descriptor) + \
 				 sizeof(struct nvsp_message))
@@ -1026,6 +1034,8 @@ struct net_device_context {
 	u8 duplex;
 	u32 speed;
 	u32 l4_hash; /* L4 hash settings */
+	u32 tx_max_pkt; /* aggregation limit, 0 to use the host's max_pkt */
+	u32 rx_copybreak;
 	struct netvsc_ethtool_stats eth_stats;
 
 	/* State to manage the associated VF interface. */
@@ -1059,6 +1069,7 @@ struct netvsc_channel {
 
 	struct bpf_prog __rcu *bpf_prog;
 	struct xdp_rxq_info xdp_rxq;
+	struct page_pool *page_pool; /* XDP buffers */
 
 	struct netvsc_stats tx_stats;
 	struct netvsc_stats rx_stats;
@@ -20,6 +20,7 @@
 #include <linux/vmalloc.h>
 #include <linux/rtnetlink.h>
 #include <linux/prefetch.h>
+#include <net/page_pool.h>
 
 #include <asm/sync_bitops.h>
 #include <asm/mshyperv.h>
@@ -159,6 +160,7 @@ static void free_netvsc_device(struct rcu_head *head)
 
 	for (i = 0; i < VRSS_CHANNEL_MAX; i++) {
 		xdp_rxq_info_unreg(&nvdev->chan_table[i].xdp_rxq);
+		page_pool_destroy(nvdev->chan_table[i].page_pool);
 		kfree(nvdev->chan_table[i].recv_buf);
 		vfree(nvdev->chan_table[i].mrc.slots);
 	}
@@ -1083,6 +1085,7 @@ int netvsc_send(struct net_device *ndev,
 	struct hv_netvsc_packet *msd_send = NULL, *cur_send = NULL;
 	struct sk_buff *msd_skb = NULL;
 	bool try_batch, xmit_more;
+	u32 max_pkt;
 
 	/* If device is rescinded, return error and packet will get dropped. */
 	if (unlikely(!net_device || net_device->destroy))
@@ -1104,7 +1107,9 @@ int netvsc_send(struct net_device *ndev,
 	if (msdp->pkt)
 		msd_len = msdp->pkt->total_data_buflen;
 
-	try_batch =  msd_len > 0 && msdp->count < net_device->max_pkt;
+	max_pkt = min_not_zero(READ_ONCE(ndev_ctx->tx_max_pkt),
+			       net_device->max_pkt);
+	try_batch =  msd_len > 0 && msdp->count < max_pkt;
 	if (try_batch && msd_len + pktlen + net_device->pkt_align <
 	    net_device->send_section_size) {
 		section_index = msdp->pkt->send_buf_index;
@@ -1622,6 +1627,10 @@ struct netvsc_device *netvsc_device_add(struct hv_device *device,
 
 	for (i = 0; i < VRSS_CHANNEL_MAX; i++) {
 		struct netvsc_channel *nvchan = &net_device->chan_table[i];
+		struct page_pool_params pp_params = {
+			.pool_size = NETVSC_XDP_POOL_SIZE,
+			.nid = NUMA_NO_NODE,
+		};
 
 		nvchan->channel = device->channel;
 		nvchan->net_device = net_device;
@@ -1635,8 +1644,17 @@ struct netvsc_device *netvsc_device_add(struct hv_device *device,
 			goto cleanup2;
 		}
 
+		nvchan->page_pool = page_pool_create(&pp_params);
+		if (IS_ERR(nvchan->page_pool)) {
+			ret = PTR_ERR(nvchan->page_pool);
+			nvchan->page_pool = NULL;
+			netdev_err(ndev, "page_pool_create fail: %d\n", ret);
+			goto cleanup2;
+		}
+
 		ret = xdp_rxq_info_reg_mem_model(&nvchan->xdp_rxq,
-						 MEM_TYPE_PAGE_SHARED, NULL);
+						 MEM_TYPE_PAGE_POOL,
+						 nvchan->page_pool);
 
 		if (ret) {
 			netdev_err(ndev, "xdp reg_mem_model fail: %d\n", ret);
@@ -14,6 +14,7 @@
 #include <linux/bpf_trace.h>
 #include <linux/kernel.h>
 #include <net/xdp.h>
+#include <net/page_pool.h>
 
 #include <linux/mutex.h>
 #include <linux/rtnetlink.h>
@@ -44,7 +45,7 @@ u32 netvsc_run_xdp(struct net_device *ndev, struct netvsc_channel *nvchan,
 	}
 
 	/* allocate page buffer for data */
-	page = alloc_page(GFP_ATOMIC);
+	page = page_pool_dev_alloc_pages(nvchan->page_pool);
 	if (!page) {
 		act = XDP_DROP;
 		goto out;
@@ -75,7 +76,7 @@ u32 netvsc_run_xdp(struct net_device *ndev, struct netvsc_channel *nvchan,
 	rcu_read_unlock();
 
 	if (page && act != XDP_PASS && act != XDP_TX) {
-		__free_page(page);
+		page_pool_recycle_direct(nvchan->page_pool, page);
 		xdp->data_hard_start = NULL;
 	}
 
@@ -34,6 +34,7 @@
 #include <net/pkt_sched.h>
 #include <net/checksum.h>
 #include <net/ip6_checksum.h>
+#include <net/page_pool.h>
 
 #include "hyperv_net.h"
 
@@ -827,10 +828,60 @@ static void netvsc_comp_ipcsum(struct sk_buff *skb)
 	iph->check = ip_fast_csum(iph, iph->ihl);
 }
 
+/* Copy @len bytes out of the receive buffer, from *@seg / *@off onwards */
+static void netvsc_copy_rsc(const struct nvsc_rsc *rsc, u32 *seg, u32 *off,
+			    void *to, u32 len)
+{
+	u32 n;
+
+	while (len) {
+		n = min(len, rsc->len[*seg] - *off);
+		memcpy(to, rsc->data[*seg] + *off, n);
+		to += n;
+		len -= n;
+		*off += n;
+		if (*off == rsc->len[*seg]) {
+			(*seg)++;
+			*off = 0;
+		}
+	}
+}
+
+static struct sk_buff *netvsc_alloc_frag_skb(struct napi_struct *napi,
+					     const struct nvsc_rsc *rsc)
+{
+	u32 hlen = min_t(u32, rsc->pktlen, NETVSC_RX_HDR_LEN);
+	u32 seg = 0, off = 0, rest, n;
+	struct sk_buff *skb;
+	struct page *page;
+
+	skb = napi_alloc_skb(napi, hlen);
+	if (!skb)
+		return NULL;
+
+	netvsc_copy_rsc(rsc, &seg, &off, skb_put(skb, hlen), hlen);
+
+	for (rest = rsc->pktlen - hlen; rest; rest -= n) {
+		n = min_t(u32, rest, PAGE_SIZE);
+		page = dev_alloc_page();
+		if (!page) {
+			kfree_skb(skb);
+			return NULL;
+		}
+
+		netvsc_copy_rsc(rsc, &seg, &off, page_address(page), n);
+		skb_add_rx_frag(skb, skb_shinfo(skb)->nr_frags, page, 0, n,
+				PAGE_SIZE);
+	}
+
+	return skb;
+}
+
 static struct sk_buff *netvsc_alloc_recv_skb(struct net_device *net,
 					     struct netvsc_channel *nvchan,
 					     struct xdp_buff *xdp)
 {
+	struct net_device_context *ndev_ctx = netdev_priv(net);
 	struct napi_struct *napi = &nvchan->napi;
 	const struct ndis_pkt_8021q_info *vlan = &nvchan->rsc.vlan;
 	const struct ndis_tcp_ip_checksum_info *csum_info =
@@ -839,6 +890,7 @@ static struct sk_buff *netvsc_alloc_recv_skb(struct net_device *net,
 	u8 ppi_flags = nvchan->rsc.ppi_flags;
 	struct sk_buff *skb;
 	void *xbuf = xdp->data_hard_start;
+	u32 pktlen = nvchan->rsc.pktlen;
 	int i;
 
 	if (xbuf) {
@@ -846,6 +898,8 @@ static struct sk_buff *netvsc_alloc_recv_skb(struct net_device *net,
 		unsigned int xlen = xdp->data_end - xdp->data;
 		unsigned int frag_size = xdp->frame_sz;
 
+		/* The stack frees the page, not the pool */
+		page_pool_release_page(nvchan->page_pool, virt_to_page(xbuf));
 		skb = build_skb(xbuf, frag_size);
 
 		if (!skb) {
@@ -856,8 +910,14 @@ static struct sk_buff *netvsc_alloc_recv_skb(struct net_device *net,
 		skb_reserve(skb, hdroom);
 		skb_put(skb, xlen);
 		skb->dev = napi->dev;
+	} else if (pktlen > READ_ONCE(ndev_ctx->rx_copybreak) &&
+		   pktlen - min_t(u32, pktlen, NETVSC_RX_HDR_LEN) <=
+		   MAX_SKB_FRAGS * PAGE_SIZE) {
+		skb = netvsc_alloc_frag_skb(napi, &nvchan->rsc);
+		if (!skb)
+			return NULL;
 	} else {
-		skb = napi_alloc_skb(napi, nvchan->rsc.pktlen);
+		skb = napi_alloc_skb(napi, pktlen);
 
 		if (!skb)
 			return NULL;
@@ -941,7 +1001,7 @@ int netvsc_recv_callback(struct net_device *net,
 		return NVSP_STAT_SUCCESS; /* consumed by XDP */
 	}
 
-	/* Allocate a skb - TODO direct I/O to pages? */
+	/* Allocate a skb, the receive buffer has to be handed back */
 	skb = netvsc_alloc_recv_skb(net, nvchan, &xdp);
 
 	if (unlikely(!skb)) {
@@ -2010,7 +2070,67 @@ static void netvsc_set_msglevel(struct net_device *ndev, u32 val)
 	ndev_ctx->msg_enable = val;
 }
 
+static int netvsc_get_coalesce(struct net_device *ndev,
+			       struct ethtool_coalesce *ec,
+			       struct kernel_ethtool_coalesce *kernel_coal,
+			       struct netlink_ext_ack *extack)
+{
+	struct net_device_context *ndev_ctx = netdev_priv(ndev);
+	struct netvsc_device *nvdev = rtnl_dereference(ndev_ctx->nvdev);
+
+	if (!nvdev)
+		return -ENODEV;
+
+	ec->tx_max_coalesced_frames = min_not_zero(ndev_ctx->tx_max_pkt,
+						   nvdev->max_pkt);
+	return 0;
+}
+
+/* Limit how many packets are aggregated in one send buffer section, down
+ * from what the host allows.  0 goes back to the host's limit.
+ */
+static int netvsc_set_coalesce(struct net_device *ndev,
+			       struct ethtool_coalesce *ec,
+			       struct kernel_ethtool_coalesce *kernel_coal,
+			       struct netlink_ext_ack *extack)
+{
+	struct net_device_context *ndev_ctx = netdev_priv(ndev);
+
+	WRITE_ONCE(ndev_ctx->tx_max_pkt, ec->tx_max_coalesced_frames);
+	return 0;
+}
+
+static int netvsc_get_tunable(struct net_device *ndev,
+			      const struct ethtool_tunable *tuna, void *data)
+{
+	struct net_device_context *ndev_ctx = netdev_priv(ndev);
+
+	switch (tuna->id) {
+	case ETHTOOL_RX_COPYBREAK:
+		*(u32 *)data = ndev_ctx->rx_copybreak;
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static int netvsc_set_tunable(struct net_device *ndev,
+			      const struct ethtool_tunable *tuna,
+			      const void *data)
+{
+	struct net_device_context *ndev_ctx = netdev_priv(ndev);
+
+	switch (tuna->id) {
+	case ETHTOOL_RX_COPYBREAK:
+		WRITE_ONCE(ndev_ctx->rx_copybreak, *(const u32 *)data);
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
 static const struct ethtool_ops ethtool_ops = {
+	.supported_coalesce_params = ETHTOOL_COALESCE_TX_MAX_FRAMES,
 	.get_drvinfo	= netvsc_get_drvinfo,
 	.get_regs_len	= netvsc_get_regs_len,
 	.get_regs	= netvsc_get_regs,
@@ -2033,6 +2153,10 @@ static const struct ethtool_ops ethtool_ops = {
 	.set_link_ksettings = netvsc_set_link_ksettings,
 	.get_ringparam	= netvsc_get_ringparam,
 	.set_ringparam	= netvsc_set_ringparam,
+	.get_coalesce	= netvsc_get_coalesce,
+	.set_coalesce	= netvsc_set_coalesce,
+	.get_tunable	= netvsc_get_tunable,
+	.set_tunable	= netvsc_set_tunable,
 };
 
 static const struct net_device_ops device_ops = {
@@ -2491,6 +2615,7 @@ static int netvsc_probe(struct hv_device *dev,
 	net_device_ctx = netdev_priv(net);
 	net_device_ctx->device_ctx = dev;
 	net_device_ctx->msg_enable = netif_msg_init(debug, default_msg);
+	net_device_ctx->rx_copybreak = NETVSC_RX_COPYBREAK_DEFAULT;
 	if (netif_msg_probe(net_device_ctx))
 		netdev_dbg(net, "netvsc msg_enable: %d\n",
 			   net_device_ctx->msg_enable);
@@ -50,6 +50,9 @@ void wg_packet_handshake_send_worker(struct work_struct *work);
 void wg_packet_tx_worker(struct work_struct *work);
 void wg_packet_encrypt_worker(struct work_struct *work);
 
+/* Packets the crypt workers take off the ring at a time */
+#define WG_CRYPT_BATCH 16
+
 enum packet_state {
 	PACKET_STATE_UNCRYPTED,
 	PACKET_STATE_CRYPTED,
@@ -207,6 +210,38 @@ static inline void wg_queue_enqueue_per_peer_rx(struct sk_buff *skb, enum packet
 	wg_peer_put(peer);
 }
 
+/* Same as the above for a batch of packets, kicking each peer's serial
+ * worker or NAPI once per run of packets of that peer rather than once per
+ * packet.
+ */
+static inline void wg_queue_enqueue_per_peer_batch(struct sk_buff **skbs,
+						   const enum packet_state *states,
+						   int n, bool rx)
+{
+	struct wg_peer *peer = NULL, *next;
+	int i;
+
+	for (i = 0; i <= n; ++i) {
+		next = i < n ? PACKET_PEER(skbs[i]) : NULL;
+		if (next != peer && peer) {
+			if (rx)
+				napi_schedule(&peer->napi);
+			else
+				queue_work_on(wg_cpumask_choose_online(&peer->serial_work_cpu,
+								       peer->internal_id),
+					      peer->device->packet_crypt_wq,
+					      &peer->transmit_packet_work);
+			wg_peer_put(peer);
+		}
+		if (i == n)
+			break;
+		/* As above, hold the peer before the first packet is released */
+		if (next != peer)
+			peer = wg_peer_get(next);
+		atomic_set_release(&PACKET_CB(skbs[i])->state, states[i]);
+	}
+}
+
 #ifdef DEBUG
 bool wg_packet_counter_selftest(void);
 #endif
@@ -500,13 +500,17 @@ void wg_packet_decrypt_worker(struct work_struct *work)
 {
 	struct crypt_queue *queue = container_of(work, struct multicore_worker,
 						 work)->ptr;
-	struct sk_buff *skb;
-
-	while ((skb = ptr_ring_consume_bh(&queue->ring)) != NULL) {
-		enum packet_state state =
-			likely(decrypt_packet(skb, PACKET_CB(skb)->keypair)) ?
-				PACKET_STATE_CRYPTED : PACKET_STATE_DEAD;
-		wg_queue_enqueue_per_peer_rx(skb, state);
+	enum packet_state states[WG_CRYPT_BATCH];
+	struct sk_buff *skbs[WG_CRYPT_BATCH];
+	int i, n;
+
+	while ((n = ptr_ring_consume_batched_bh(&queue->ring, (void **)skbs,
+						WG_CRYPT_BATCH)) > 0) {
+		for (i = 0; i < n; ++i)
+			states[i] = likely(decrypt_packet(skbs[i],
+						PACKET_CB(skbs[i])->keypair)) ?
+					PACKET_STATE_CRYPTED : PACKET_STATE_DEAD;
+		wg_queue_enqueue_per_peer_batch(skbs, states, n, true);
 		if (need_resched())
 			cond_resched();
 	}
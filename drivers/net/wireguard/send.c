@@ -288,21 +288,26 @@ void wg_packet_encrypt_worker(struct work_struct *work)
 {
 	struct crypt_queue *queue = container_of(work, struct multicore_worker,
 						 work)->ptr;
-	struct sk_buff *first, *skb, *next;
-
-	while ((first = ptr_ring_consume_bh(&queue->ring)) != NULL) {
-		enum packet_state state = PACKET_STATE_CRYPTED;
-
-		skb_list_walk_safe(first, skb, next) {
-			if (likely(encrypt_packet(skb,
-					PACKET_CB(first)->keypair))) {
-				wg_reset_packet(skb, true);
-			} else {
-				state = PACKET_STATE_DEAD;
-				break;
+	enum packet_state states[WG_CRYPT_BATCH];
+	struct sk_buff *firsts[WG_CRYPT_BATCH];
+	struct sk_buff *skb, *next;
+	int i, n;
+
+	while ((n = ptr_ring_consume_batched_bh(&queue->ring, (void **)firsts,
+						WG_CRYPT_BATCH)) > 0) {
+		for (i = 0; i < n; ++i) {
+			states[i] = PACKET_STATE_CRYPTED;
+			skb_list_walk_safe(firsts[i], skb, next) {
+				if (likely(encrypt_packet(skb,
+						PACKET_CB(firsts[i])->keypair))) {
+					wg_reset_packet(skb, true);
+				} else {
+					states[i] = PACKET_STATE_DEAD;
+					break;
+				}
 			}
 		}
-		wg_queue_enqueue_per_peer_tx(first, state);
+		wg_queue_enqueue_per_peer_batch(firsts, states, n, false);
 		if (need_resched())
 			cond_resched();
 	}
@@ -31,6 +31,26 @@
 #include "pfn.h"
 #include "nd.h"
 
+/*
+ * A single core doesn't get near the bandwidth of the DIMMs, so large bios
+ * can be copied by several CPUs of the device's node at once.
+ */
+static unsigned int parallel_copy_kb;
+module_param(parallel_copy_kb, uint, 0644);
+MODULE_PARM_DESC(parallel_copy_kb,
+		 "Split the copy of bios of at least this many KiB across CPUs (0: off)");
+
+/* including the submitting CPU */
+#define PMEM_MAX_COPY_CPUS 4
+
+struct pmem_copy_work {
+	struct work_struct	work;
+	struct pmem_device	*pmem;
+	struct bio		*bio;
+	struct bvec_iter	iter;
+	blk_status_t		status;
+};
+
 static struct device *to_dev(struct pmem_device *pmem)
 {
 	/*
@@ -190,14 +210,93 @@ static blk_status_t pmem_do_write(struct pmem_device *pmem,
 	return rc;
 }
 
+static blk_status_t pmem_do_bvec_iter(struct pmem_device *pmem,
+			struct bio *bio, struct bvec_iter start)
+{
+	blk_status_t rc = BLK_STS_OK;
+	struct bio_vec bvec;
+	struct bvec_iter iter;
+
+	__bio_for_each_segment(bvec, bio, iter, start) {
+		if (op_is_write(bio_op(bio)))
+			rc = pmem_do_write(pmem, bvec.bv_page, bvec.bv_offset,
+				iter.bi_sector, bvec.bv_len);
+		else
+			rc = pmem_do_read(pmem, bvec.bv_page, bvec.bv_offset,
+				iter.bi_sector, bvec.bv_len);
+		if (rc)
+			break;
+	}
+	return rc;
+}
+
+static void pmem_copy_workfn(struct work_struct *work)
+{
+	struct pmem_copy_work *w =
+		container_of(work, struct pmem_copy_work, work);
+
+	w->status = pmem_do_bvec_iter(w->pmem, w->bio, w->iter);
+}
+
+static unsigned int pmem_copy_cpus(struct bio *bio, int node)
+{
+	unsigned int size = bio->bi_iter.bi_size;
+	unsigned int nr;
+
+	if (!parallel_copy_kb || size < parallel_copy_kb * 1024ULL ||
+	    (bio->bi_opf & REQ_NOWAIT))
+		return 1;
+
+	nr = min_t(unsigned int, PMEM_MAX_COPY_CPUS, size >> PAGE_SHIFT);
+	if (node == NUMA_NO_NODE)
+		return min(nr, num_online_cpus());
+	return min(nr, cpumask_weight(cpumask_of_node(node)));
+}
+
+/*
+ * Copy the data of @bio, in page aligned chunks spread over up to
+ * PMEM_MAX_COPY_CPUS CPUs of the device's node for large bios.  The
+ * submitter copies the last chunk itself.
+ */
+static blk_status_t pmem_do_bio(struct pmem_device *pmem, struct bio *bio)
+{
+	struct pmem_copy_work works[PMEM_MAX_COPY_CPUS - 1];
+	int node = dev_to_node(to_dev(pmem));
+	struct bvec_iter iter = bio->bi_iter;
+	unsigned int nr, chunk, i;
+	blk_status_t rc;
+
+	nr = pmem_copy_cpus(bio, node);
+	if (nr <= 1)
+		return pmem_do_bvec_iter(pmem, bio, iter);
+
+	chunk = round_up(DIV_ROUND_UP(iter.bi_size, nr), PAGE_SIZE);
+	for (i = 0; iter.bi_size > chunk; i++) {
+		works[i].pmem = pmem;
+		works[i].bio = bio;
+		works[i].iter = iter;
+		works[i].iter.bi_size = chunk;
+		INIT_WORK_ONSTACK(&works[i].work, pmem_copy_workfn);
+		queue_work_node(node, system_unbound_wq, &works[i].work);
+		bio_advance_iter(bio, &iter, chunk);
+	}
+
+	rc = pmem_do_bvec_iter(pmem, bio, iter);
+	while (i--) {
+		flush_work(&works[i].work);
+		destroy_work_on_stack(&works[i].work);
+		if (!rc)
+			rc = works[i].status;
+	}
+	return rc;
+}
+
 static blk_qc_t pmem_submit_bio(struct bio *bio)
 {
 	int ret = 0;
 	blk_status_t rc = 0;
 	bool do_acct;
 	unsigned long start;
-	struct bio_vec bvec;
-	struct bvec_iter iter;
 	struct pmem_device *pmem = bio->bi_bdev->bd_disk->private_data;
 	struct nd_region *nd_region = to_region(pmem);
 
@@ -207,18 +306,9 @@ static blk_qc_t pmem_submit_bio(struct bio *bio)
 	do_acct = blk_queue_io_stat(bio->bi_bdev->bd_disk->queue);
 	if (do_acct)
 		start = bio_start_io_acct(bio);
-	bio_for_each_segment(bvec, bio, iter) {
-		if (op_is_write(bio_op(bio)))
-			rc = pmem_do_write(pmem, bvec.bv_page, bvec.bv_offset,
-				iter.bi_sector, bvec.bv_len);
-		else
-			rc = pmem_do_read(pmem, bvec.bv_page, bvec.bv_offset,
-				iter.bi_sector, bvec.bv_len);
-		if (rc) {
-			bio->bi_status = rc;
-			break;
-		}
-	}
+	rc = pmem_do_bio(pmem, bio);
+	if (rc)
+		bio->bi_status = rc;
 	if (do_acct)
 		bio_end_io_acct(bio, start);
 
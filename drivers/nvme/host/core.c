@@ -368,12 +368,14 @@ void nvme_complete_rq(struct request *req)
 
 	switch (nvme_decide_disposition(req)) {
 	case COMPLETE:
+		nvme_mpath_end_request(req);
 		nvme_end_req(req);
 		return;
 	case RETRY:
 		nvme_retry_req(req);
 		return;
 	case FAILOVER:
+		nvme_mpath_end_request(req);
 		nvme_failover_req(req);
 		return;
 	}
@@ -3210,6 +3212,8 @@ static struct attribute *nvme_ns_id_attrs[] = {
 #ifdef CONFIG_NVME_MULTIPATH
 	&dev_attr_ana_grpid.attr,
 	&dev_attr_ana_state.attr,
+	&dev_attr_queue_depth.attr,
+	&dev_attr_service_time.attr,
 #endif
 	NULL,
 };
@@ -3240,6 +3244,11 @@ static umode_t nvme_ns_id_attrs_are_visible(struct kobject *kobj,
 		if (!nvme_ctrl_use_ana(nvme_get_ns_from_dev(dev)->ctrl))
 			return 0;
 	}
+	if (a == &dev_attr_queue_depth.attr ||
+	    a == &dev_attr_service_time.attr) {
+		if (dev_to_disk(dev)->fops != &nvme_bdev_ops) /* per-path attr */
+			return 0;
+	}
 #endif
 	return a->mode;
 }
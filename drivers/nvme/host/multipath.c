@@ -270,6 +270,51 @@ static struct nvme_ns *nvme_round_robin_path(struct nvme_ns_head *head,
 	return found;
 }
 
+/*
+ * Pick the usable path with the lowest cost, preferring optimized paths.
+ * The cost is the number of requests in flight on the path, or for the
+ * service-time policy the expected time to drain them plus one more
+ * request, estimated from the path's average completion latency.
+ */
+static struct nvme_ns *nvme_least_loaded_path(struct nvme_ns_head *head,
+		bool service_time)
+{
+	struct nvme_ns *best_opt = NULL, *best_nonopt = NULL, *ns;
+	u64 min_opt = U64_MAX, min_nonopt = U64_MAX, cost;
+
+	list_for_each_entry_rcu(ns, &head->list, siblings) {
+		if (nvme_path_is_disabled(ns))
+			continue;
+
+		cost = atomic_read(&ns->nr_active);
+		if (service_time)
+			cost = (cost + 1) * READ_ONCE(ns->ewma_lat);
+
+		switch (ns->ana_state) {
+		case NVME_ANA_OPTIMIZED:
+			if (cost < min_opt) {
+				min_opt = cost;
+				best_opt = ns;
+			}
+			break;
+		case NVME_ANA_NONOPTIMIZED:
+			if (cost < min_nonopt) {
+				min_nonopt = cost;
+				best_nonopt = ns;
+			}
+			break;
+		default:
+			break;
+		}
+
+		/* an idle optimized path can't be beaten */
+		if (min_opt == 0)
+			break;
+	}
+
+	return best_opt ? best_opt : best_nonopt;
+}
+
 static inline bool nvme_path_is_optimized(struct nvme_ns *ns)
 {
 	return ns->ctrl->state == NVME_CTRL_LIVE &&
@@ -281,6 +326,15 @@ inline struct nvme_ns *nvme_find_path(struct nvme_ns_head *head)
 	int node = numa_node_id();
 	struct nvme_ns *ns;
 
+	switch (READ_ONCE(head->subsys->iopolicy)) {
+	case NVME_IOPOLICY_QD:
+		return nvme_least_loaded_path(head, false);
+	case NVME_IOPOLICY_ST:
+		return nvme_least_loaded_path(head, true);
+	default:
+		break;
+	}
+
 	ns = srcu_dereference(head->current_path[node], &head->srcu);
 	if (unlikely(!ns))
 		return __nvme_find_path(head, node);
@@ -685,6 +739,8 @@ void nvme_mpath_stop(struct nvme_ctrl *ctrl)
 static const char *nvme_iopolicy_names[] = {
 	[NVME_IOPOLICY_NUMA]	= "numa",
 	[NVME_IOPOLICY_RR]	= "round-robin",
+	[NVME_IOPOLICY_QD]	= "queue-depth",
+	[NVME_IOPOLICY_ST]	= "service-time",
 };
 
 static ssize_t nvme_subsys_iopolicy_show(struct device *dev,
@@ -732,6 +788,67 @@ static ssize_t ana_state_show(struct device *dev, struct device_attribute *attr,
 }
 DEVICE_ATTR_RO(ana_state);
 
+static ssize_t queue_depth_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct nvme_ns *ns = nvme_get_ns_from_dev(dev);
+
+	return sysfs_emit(buf, "%d\n", atomic_read(&ns->nr_active));
+}
+DEVICE_ATTR_RO(queue_depth);
+
+static ssize_t service_time_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct nvme_ns *ns = nvme_get_ns_from_dev(dev);
+
+	return sysfs_emit(buf, "%llu\n", READ_ONCE(ns->ewma_lat));
+}
+DEVICE_ATTR_RO(service_time);
+
+/* Weight of a new sample in the service time average is 1/2^shift. */
+#define NVME_EWMA_SHIFT		3
+
+void nvme_mpath_start_request(struct request *rq)
+{
+	struct nvme_ns *ns = rq->q->queuedata;
+	enum nvme_iopolicy policy = READ_ONCE(ns->head->subsys->iopolicy);
+
+	/* requeued requests are still accounted from the first attempt */
+	if (nvme_req(rq)->flags & NVME_MPATH_IO_STATS)
+		return;
+	if (policy != NVME_IOPOLICY_QD && policy != NVME_IOPOLICY_ST)
+		return;
+
+	nvme_req(rq)->flags |= NVME_MPATH_IO_STATS;
+	nvme_req(rq)->start_time = ktime_get_ns();
+	atomic_inc(&ns->nr_active);
+}
+EXPORT_SYMBOL_GPL(nvme_mpath_start_request);
+
+void nvme_mpath_end_request(struct request *rq)
+{
+	struct nvme_ns *ns = rq->q->queuedata;
+	u64 lat, avg;
+
+	if (!(nvme_req(rq)->flags & NVME_MPATH_IO_STATS))
+		return;
+	nvme_req(rq)->flags &= ~NVME_MPATH_IO_STATS;
+	atomic_dec(&ns->nr_active);
+
+	/*
+	 * Concurrent completions may race on the update and drop a sample,
+	 * which is harmless for a moving average.
+	 */
+	lat = ktime_get_ns() - nvme_req(rq)->start_time;
+	avg = READ_ONCE(ns->ewma_lat);
+	if (avg)
+		avg = avg - (avg >> NVME_EWMA_SHIFT) + (lat >> NVME_EWMA_SHIFT);
+	else
+		avg = lat;
+	WRITE_ONCE(ns->ewma_lat, avg);
+}
+
 static int nvme_lookup_ana_group_desc(struct nvme_ctrl *ctrl,
 		struct nvme_ana_group_desc *desc, void *data)
 {
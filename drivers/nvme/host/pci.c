@@ -10,10 +10,13 @@
 #include <linux/blkdev.h>
 #include <linux/blk-mq.h>
 #include <linux/blk-mq-pci.h>
+#include <linux/dim.h>
 #include <linux/dmi.h>
 #include <linux/init.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/irq_poll.h>
+#include <linux/llist.h>
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
@@ -60,6 +63,28 @@ MODULE_PARM_DESC(sgl_threshold,
 		"Use SGLs when average request segment size is larger or equal to "
 		"this size. Use 0 to disable SGLs.");
 
+static unsigned int prp_cache_pages = 16;
+module_param(prp_cache_pages, uint, 0444);
+MODULE_PARM_DESC(prp_cache_pages,
+		"Number of PRP/SGL list pages preallocated per I/O queue "
+		"(0 = always use the shared DMA pools)");
+
+static bool adaptive_irq;
+module_param(adaptive_irq, bool, 0444);
+MODULE_PARM_DESC(adaptive_irq,
+		"Switch interrupt driven I/O queues between plain interrupts, "
+		"coalesced interrupts and polling based on their completion rate");
+
+static unsigned char irq_coalesce_time = 1;
+module_param(irq_coalesce_time, byte, 0444);
+MODULE_PARM_DESC(irq_coalesce_time,
+		"Interrupt aggregation time in 100us units for adaptive_irq");
+
+static unsigned char irq_coalesce_thr = 7;
+module_param(irq_coalesce_thr, byte, 0444);
+MODULE_PARM_DESC(irq_coalesce_thr,
+		"Interrupt aggregation threshold (0's based) for adaptive_irq");
+
 #define NVME_PCI_MIN_QUEUE_SIZE 2
 #define NVME_PCI_MAX_QUEUE_SIZE 4095
 static int io_queue_depth_set(const char *val, const struct kernel_param *kp);
@@ -138,6 +163,8 @@ struct nvme_dev {
 	struct nvme_ctrl ctrl;
 	u32 last_ps;
 	bool hmb;
+	bool adaptive_irq;
+	bool irq_coalesce;
 
 	mempool_t *iod_mempool;
 
@@ -181,6 +208,24 @@ static inline struct nvme_dev *to_nvme_dev(struct nvme_ctrl *ctrl)
 	return container_of(ctrl, struct nvme_dev, ctrl);
 }
 
+/*
+ * A per-queue cache of preallocated, DMA mapped PRP/SGL list descriptors of
+ * a single size, carved out of one coherent allocation.  Completions return
+ * descriptors with a lockless llist_add() from whatever CPU they run on;
+ * llist_del_first() must not race with itself, so allocations serialise on
+ * alloc_lock, which is only shared by the CPUs submitting to this queue.
+ * When the cache runs dry the shared dev->prp_*_pool dma_pools are used.
+ */
+struct nvme_desc_cache {
+	spinlock_t alloc_lock;
+	struct llist_head free;
+	struct llist_node *nodes;
+	void *vaddr;
+	dma_addr_t dma_addr;
+	unsigned int size;
+	unsigned int nr;
+};
+
 /*
  * An NVM Express queue.  Each device has at least two (one for admin
  * commands and one for I/O commands).
@@ -208,11 +253,20 @@ struct nvme_queue {
 #define NVMEQ_SQ_CMB		1
 #define NVMEQ_DELETE_ERROR	2
 #define NVMEQ_POLLED		3
+#define NVMEQ_ADAPTIVE		4
+#define NVMEQ_IRQ_POLL		5
 	u32 *dbbuf_sq_db;
 	u32 *dbbuf_cq_db;
 	u32 *dbbuf_sq_ei;
 	u32 *dbbuf_cq_ei;
 	struct completion delete_done;
+	/* only used for adaptive_irq queues: */
+	struct dim dim;
+	struct irq_poll iop;
+	u8 irq_mode;
+	bool coalesced;
+	struct nvme_desc_cache small_descs ____cacheline_aligned_in_smp;
+	struct nvme_desc_cache page_descs;
 };
 
 /*
@@ -543,6 +597,109 @@ static inline bool nvme_pci_use_sgls(struct nvme_dev *dev, struct request *req)
 	return true;
 }
 
+static int nvme_desc_cache_init(struct nvme_dev *dev,
+		struct nvme_desc_cache *cache, unsigned int size, unsigned int nr)
+{
+	unsigned int i;
+
+	spin_lock_init(&cache->alloc_lock);
+	init_llist_head(&cache->free);
+	cache->size = size;
+	cache->nr = 0;
+	if (!nr)
+		return 0;
+
+	cache->nodes = kcalloc_node(nr, sizeof(*cache->nodes), GFP_KERNEL,
+				    dev_to_node(dev->dev));
+	if (!cache->nodes)
+		return -ENOMEM;
+	cache->vaddr = dma_alloc_coherent(dev->dev, nr * size,
+					  &cache->dma_addr, GFP_KERNEL);
+	if (!cache->vaddr) {
+		kfree(cache->nodes);
+		cache->nodes = NULL;
+		return -ENOMEM;
+	}
+
+	cache->nr = nr;
+	for (i = 0; i < nr; i++)
+		llist_add(&cache->nodes[i], &cache->free);
+	return 0;
+}
+
+static void nvme_desc_cache_destroy(struct nvme_dev *dev,
+		struct nvme_desc_cache *cache)
+{
+	if (!cache->nr)
+		return;
+	dma_free_coherent(dev->dev, cache->nr * cache->size, cache->vaddr,
+			  cache->dma_addr);
+	kfree(cache->nodes);
+	cache->nodes = NULL;
+	cache->nr = 0;
+}
+
+static void *nvme_desc_cache_alloc(struct nvme_desc_cache *cache,
+		dma_addr_t *dma_addr)
+{
+	struct llist_node *node;
+	unsigned long flags;
+	size_t offset;
+
+	if (llist_empty(&cache->free))
+		return NULL;
+
+	spin_lock_irqsave(&cache->alloc_lock, flags);
+	node = llist_del_first(&cache->free);
+	spin_unlock_irqrestore(&cache->alloc_lock, flags);
+	if (!node)
+		return NULL;
+
+	offset = (size_t)(node - cache->nodes) * cache->size;
+	*dma_addr = cache->dma_addr + offset;
+	return cache->vaddr + offset;
+}
+
+static bool nvme_desc_cache_free(struct nvme_desc_cache *cache, void *desc)
+{
+	size_t offset = desc - cache->vaddr;
+
+	if (!cache->nr || desc < cache->vaddr ||
+	    offset >= (size_t)cache->nr * cache->size)
+		return false;
+
+	llist_add(&cache->nodes[offset / cache->size], &cache->free);
+	return true;
+}
+
+static void *nvme_alloc_desc(struct nvme_queue *nvmeq, bool small,
+		dma_addr_t *dma_addr)
+{
+	struct nvme_dev *dev = nvmeq->dev;
+	void *desc;
+
+	desc = nvme_desc_cache_alloc(small ? &nvmeq->small_descs :
+					     &nvmeq->page_descs, dma_addr);
+	if (desc)
+		return desc;
+	return dma_pool_alloc(small ? dev->prp_small_pool : dev->prp_page_pool,
+			      GFP_ATOMIC, dma_addr);
+}
+
+static void nvme_free_desc(struct nvme_queue *nvmeq, bool small, void *desc,
+		dma_addr_t dma_addr)
+{
+	struct nvme_dev *dev = nvmeq->dev;
+
+	if (small) {
+		if (!nvme_desc_cache_free(&nvmeq->small_descs, desc))
+			dma_pool_free(dev->prp_small_pool, desc, dma_addr);
+	} else {
+		if (!nvme_desc_cache_free(&nvmeq->page_descs, desc))
+			dma_pool_free(dev->prp_page_pool, desc, dma_addr);
+	}
+}
+
 static void nvme_free_prps(struct nvme_dev *dev, struct request *req)
 {
 	const int last_prp = NVME_CTRL_PAGE_SIZE / sizeof(__le64) - 1;
@@ -554,7 +711,7 @@ static void nvme_free_prps(struct nvme_dev *dev, struct request *req)
 		__le64 *prp_list = nvme_pci_iod_list(req)[i];
 		dma_addr_t next_dma_addr = le64_to_cpu(prp_list[last_prp]);
 
-		dma_pool_free(dev->prp_page_pool, prp_list, dma_addr);
+		nvme_free_desc(iod->nvmeq, false, prp_list, dma_addr);
 		dma_addr = next_dma_addr;
 	}
 }
@@ -570,7 +727,7 @@ static void nvme_free_sgls(struct nvme_dev *dev, struct request *req)
 		struct nvme_sgl_desc *sg_list = nvme_pci_iod_list(req)[i];
 		dma_addr_t next_dma_addr = le64_to_cpu((sg_list[last_sg]).addr);
 
-		dma_pool_free(dev->prp_page_pool, sg_list, dma_addr);
+		nvme_free_desc(iod->nvmeq, false, sg_list, dma_addr);
 		dma_addr = next_dma_addr;
 	}
 }
@@ -600,8 +757,8 @@ static void nvme_unmap_data(struct nvme_dev *dev, struct request *req)
 
 	nvme_unmap_sg(dev, req);
 	if (iod->npages == 0)
-		dma_pool_free(dev->prp_small_pool, nvme_pci_iod_list(req)[0],
-			      iod->first_dma);
+		nvme_free_desc(iod->nvmeq, true, nvme_pci_iod_list(req)[0],
+			       iod->first_dma);
 	else if (iod->use_sgl)
 		nvme_free_sgls(dev, req);
 	else
@@ -627,7 +784,6 @@ static blk_status_t nvme_pci_setup_prps(struct nvme_dev *dev,
 		struct request *req, struct nvme_rw_command *cmnd)
 {
 	struct nvme_iod *iod = blk_mq_rq_to_pdu(req);
-	struct dma_pool *pool;
 	int length = blk_rq_payload_bytes(req);
 	struct scatterlist *sg = iod->sg;
 	int dma_len = sg_dma_len(sg);
@@ -659,15 +815,9 @@ static blk_status_t nvme_pci_setup_prps(struct nvme_dev *dev,
 	}
 
 	nprps = DIV_ROUND_UP(length, NVME_CTRL_PAGE_SIZE);
-	if (nprps <= (256 / 8)) {
-		pool = dev->prp_small_pool;
-		iod->npages = 0;
-	} else {
-		pool = dev->prp_page_pool;
-		iod->npages = 1;
-	}
+	iod->npages = nprps <= (256 / 8) ? 0 : 1;
 
-	prp_list = dma_pool_alloc(pool, GFP_ATOMIC, &prp_dma);
+	prp_list = nvme_alloc_desc(iod->nvmeq, !iod->npages, &prp_dma);
 	if (!prp_list) {
 		iod->first_dma = dma_addr;
 		iod->npages = -1;
@@ -679,7 +829,7 @@ static blk_status_t nvme_pci_setup_prps(struct nvme_dev *dev,
 	for (;;) {
 		if (i == NVME_CTRL_PAGE_SIZE >> 3) {
 			__le64 *old_prp_list = prp_list;
-			prp_list = dma_pool_alloc(pool, GFP_ATOMIC, &prp_dma);
+			prp_list = nvme_alloc_desc(iod->nvmeq, false, &prp_dma);
 			if (!prp_list)
 				goto free_prps;
 			list[iod->npages++] = prp_list;
@@ -740,7 +890,6 @@ static blk_status_t nvme_pci_setup_sgls(struct nvme_dev *dev,
 		struct request *req, struct nvme_rw_command *cmd, int entries)
 {
 	struct nvme_iod *iod = blk_mq_rq_to_pdu(req);
-	struct dma_pool *pool;
 	struct nvme_sgl_desc *sg_list;
 	struct scatterlist *sg = iod->sg;
 	dma_addr_t sgl_dma;
@@ -754,15 +903,9 @@ static blk_status_t nvme_pci_setup_sgls(struct nvme_dev *dev,
 		return BLK_STS_OK;
 	}
 
-	if (entries <= (256 / sizeof(struct nvme_sgl_desc))) {
-		pool = dev->prp_small_pool;
-		iod->npages = 0;
-	} else {
-		pool = dev->prp_page_pool;
-		iod->npages = 1;
-	}
+	iod->npages = entries <= (256 / sizeof(struct nvme_sgl_desc)) ? 0 : 1;
 
-	sg_list = dma_pool_alloc(pool, GFP_ATOMIC, &sgl_dma);
+	sg_list = nvme_alloc_desc(iod->nvmeq, !iod->npages, &sgl_dma);
 	if (!sg_list) {
 		iod->npages = -1;
 		return BLK_STS_RESOURCE;
@@ -778,7 +921,7 @@ static blk_status_t nvme_pci_setup_sgls(struct nvme_dev *dev,
 			struct nvme_sgl_desc *old_sg_desc = sg_list;
 			struct nvme_sgl_desc *link = &old_sg_desc[i - 1];
 
-			sg_list = dma_pool_alloc(pool, GFP_ATOMIC, &sgl_dma);
+			sg_list = nvme_alloc_desc(iod->nvmeq, false, &sgl_dma);
 			if (!sg_list)
 				goto free_sgls;
 
@@ -948,7 +1091,7 @@ static blk_status_t nvme_queue_rq(struct blk_mq_hw_ctx *hctx,
 			goto out_unmap_data;
 	}
 
-	blk_mq_start_request(req);
+	nvme_start_request(req);
 	nvme_submit_cmd(nvmeq, cmnd, bd->last);
 	return BLK_STS_OK;
 out_unmap_data:
@@ -1061,12 +1204,52 @@ static inline int nvme_process_cq(struct nvme_queue *nvmeq)
 static irqreturn_t nvme_irq(int irq, void *data)
 {
 	struct nvme_queue *nvmeq = data;
+	int found;
 
-	if (nvme_process_cq(nvmeq))
+	if (test_bit(NVMEQ_IRQ_POLL, &nvmeq->flags)) {
+		if (!nvme_cqe_pending(nvmeq))
+			return IRQ_NONE;
+		disable_irq_nosync(irq);
+		irq_poll_sched(&nvmeq->iop);
+		return IRQ_HANDLED;
+	}
+
+	found = nvme_process_cq(nvmeq);
+	if (test_bit(NVMEQ_ADAPTIVE, &nvmeq->flags))
+		rdma_dim(&nvmeq->dim, found);
+	if (found)
 		return IRQ_HANDLED;
 	return IRQ_NONE;
 }
 
+/*
+ * irq_poll handler for adaptive queues in polling mode.  The interrupt is
+ * left disabled while polling, which also keeps nvme_irq() from racing
+ * with us on the completion queue.
+ */
+static int nvme_irqpoll(struct irq_poll *iop, int budget)
+{
+	struct nvme_queue *nvmeq = container_of(iop, struct nvme_queue, iop);
+	struct pci_dev *pdev = to_pci_dev(nvmeq->dev->dev);
+	int found;
+
+	found = nvme_process_cq(nvmeq);
+	rdma_dim(&nvmeq->dim, found);
+
+	/*
+	 * Claim the whole budget for as long as completions keep arriving so
+	 * that irq_poll keeps us scheduled.  An empty pass, a switch away
+	 * from polling mode or irq_poll_disable() rearms the interrupt.
+	 */
+	if (found && test_bit(NVMEQ_IRQ_POLL, &nvmeq->flags) &&
+	    !test_bit(IRQ_POLL_F_DISABLE, &iop->state))
+		return budget;
+
+	irq_poll_complete(iop);
+	enable_irq(pci_irq_vector(pdev, nvmeq->cq_vector));
+	return min(found, budget - 1);
+}
+
 static irqreturn_t nvme_irq_check(int irq, void *data)
 {
 	struct nvme_queue *nvmeq = data;
@@ -1083,11 +1266,16 @@ static irqreturn_t nvme_irq_check(int irq, void *data)
 static void nvme_poll_irqdisable(struct nvme_queue *nvmeq)
 {
 	struct pci_dev *pdev = to_pci_dev(nvmeq->dev->dev);
+	bool adaptive = test_bit(NVMEQ_ADAPTIVE, &nvmeq->flags);
 
 	WARN_ON_ONCE(test_bit(NVMEQ_POLLED, &nvmeq->flags));
 
 	disable_irq(pci_irq_vector(pdev, nvmeq->cq_vector));
+	if (adaptive)
+		irq_poll_disable(&nvmeq->iop);
 	nvme_process_cq(nvmeq);
+	if (adaptive)
+		irq_poll_enable(&nvmeq->iop);
 	enable_irq(pci_irq_vector(pdev, nvmeq->cq_vector));
 }
 
@@ -1355,8 +1543,101 @@ static enum blk_eh_timer_return nvme_timeout(struct request *req, bool reserved)
 	return BLK_EH_RESET_TIMER;
 }
 
+/*
+ * Interrupt handling modes of an adaptive_irq queue.  Coalescing is
+ * configured controller wide by nvme_setup_io_queues() and switched per
+ * vector through the Interrupt Vector Configuration feature.  In polling
+ * mode an interrupt masks the vector and hands over to irq_poll, which
+ * keeps reaping completions until the queue goes idle.
+ */
+enum {
+	NVME_IRQ_MODE_PLAIN,
+	NVME_IRQ_MODE_COALESCED,
+	NVME_IRQ_MODE_POLL,
+};
+
+/* rdma_dim() profile index to mode, from least to most moderation */
+static const u8 nvme_dim_modes[RDMA_DIM_PARAMS_NUM_PROFILES] = {
+	NVME_IRQ_MODE_PLAIN,
+	NVME_IRQ_MODE_PLAIN,
+	NVME_IRQ_MODE_PLAIN,
+	NVME_IRQ_MODE_COALESCED,
+	NVME_IRQ_MODE_COALESCED,
+	NVME_IRQ_MODE_COALESCED,
+	NVME_IRQ_MODE_POLL,
+	NVME_IRQ_MODE_POLL,
+	NVME_IRQ_MODE_POLL,
+};
+
+#define NVME_IRQ_POLL_WEIGHT	64
+
+static int nvme_set_irq_mode(struct nvme_queue *nvmeq, u8 mode)
+{
+	struct nvme_dev *dev = nvmeq->dev;
+	bool coalesce = mode == NVME_IRQ_MODE_COALESCED && dev->irq_coalesce;
+	int ret;
+
+	if (coalesce != nvmeq->coalesced) {
+		ret = nvme_set_features(&dev->ctrl, NVME_FEAT_IRQ_CONFIG,
+				nvmeq->cq_vector |
+				(coalesce ? 0 : NVME_IRQ_CONFIG_CD),
+				NULL, 0, NULL);
+		if (ret)
+			return ret;
+		nvmeq->coalesced = coalesce;
+	}
+
+	if (mode == NVME_IRQ_MODE_POLL)
+		set_bit(NVMEQ_IRQ_POLL, &nvmeq->flags);
+	else
+		clear_bit(NVMEQ_IRQ_POLL, &nvmeq->flags);
+	nvmeq->irq_mode = mode;
+	return 0;
+}
+
+static void nvme_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct nvme_queue *nvmeq = dim->priv;
+	u8 mode = nvme_dim_modes[dim->profile_ix];
+
+	if (test_bit(NVMEQ_ADAPTIVE, &nvmeq->flags) && mode != nvmeq->irq_mode)
+		nvme_set_irq_mode(nvmeq, mode);
+	dim->state = DIM_START_MEASURE;
+}
+
+static void nvme_init_adaptive_irq(struct nvme_queue *nvmeq)
+{
+	struct nvme_dev *dev = nvmeq->dev;
+	struct dim *dim = &nvmeq->dim;
+
+	cancel_work_sync(&dim->work);
+	memset(&dim->prev_stats, 0, sizeof(dim->prev_stats));
+	dim->state = DIM_START_MEASURE;
+	dim->tune_state = DIM_GOING_RIGHT;
+	dim->profile_ix = RDMA_DIM_START_PROFILE;
+	dim->mode = DIM_CQ_PERIOD_MODE_START_FROM_CQE;
+	irq_poll_init(&nvmeq->iop, NVME_IRQ_POLL_WEIGHT, nvme_irqpoll);
+
+	/* Vectors coalesce by default once aggregation is configured. */
+	nvmeq->coalesced = dev->irq_coalesce;
+	if (nvme_set_irq_mode(nvmeq, NVME_IRQ_MODE_PLAIN)) {
+		dev_warn(dev->ctrl.device,
+			"interrupt vector configuration failed, disabling coalescing\n");
+		dev->irq_coalesce = false;
+		nvme_set_features(&dev->ctrl, NVME_FEAT_IRQ_COALESCE, 0,
+				  NULL, 0, NULL);
+		nvmeq->coalesced = false;
+		nvme_set_irq_mode(nvmeq, NVME_IRQ_MODE_PLAIN);
+	}
+	set_bit(NVMEQ_ADAPTIVE, &nvmeq->flags);
+}
+
 static void nvme_free_queue(struct nvme_queue *nvmeq)
 {
+	cancel_work_sync(&nvmeq->dim.work);
+	nvme_desc_cache_destroy(nvmeq->dev, &nvmeq->small_descs);
+	nvme_desc_cache_destroy(nvmeq->dev, &nvmeq->page_descs);
 	dma_free_coherent(nvmeq->dev->dev, CQ_SIZE(nvmeq),
 				(void *)nvmeq->cqes, nvmeq->cq_dma_addr);
 	if (!nvmeq->sq_cmds)
@@ -1396,6 +1677,13 @@ static int nvme_suspend_queue(struct nvme_queue *nvmeq)
 	nvmeq->dev->online_queues--;
 	if (!nvmeq->qid && nvmeq->dev->ctrl.admin_q)
 		blk_mq_quiesce_queue(nvmeq->dev->ctrl.admin_q);
+	if (test_and_clear_bit(NVMEQ_ADAPTIVE, &nvmeq->flags)) {
+		/* wait for a pending poll, which rearms the interrupt */
+		disable_irq(pci_irq_vector(to_pci_dev(nvmeq->dev->dev),
+					   nvmeq->cq_vector));
+		irq_poll_disable(&nvmeq->iop);
+		clear_bit(NVMEQ_IRQ_POLL, &nvmeq->flags);
+	}
 	if (!test_and_clear_bit(NVMEQ_POLLED, &nvmeq->flags))
 		pci_free_irq(to_pci_dev(nvmeq->dev->dev), nvmeq->cq_vector, nvmeq);
 	return 0;
@@ -1506,7 +1794,19 @@ static int nvme_alloc_queue(struct nvme_dev *dev, int qid, int depth)
 	if (nvme_alloc_sq_cmds(dev, nvmeq, qid))
 		goto free_cqdma;
 
+	/*
+	 * The descriptor caches are an optimisation only: if the coherent
+	 * allocation fails the queue falls back to the shared dma_pools.
+	 */
+	nvme_desc_cache_init(dev, &nvmeq->small_descs, 256,
+			     qid ? min_t(unsigned int, depth, prp_cache_pages *
+					 (NVME_CTRL_PAGE_SIZE / 256)) : 0);
+	nvme_desc_cache_init(dev, &nvmeq->page_descs, NVME_CTRL_PAGE_SIZE,
+			     qid ? min_t(unsigned int, depth, prp_cache_pages) : 0);
+
 	nvmeq->dev = dev;
+	INIT_WORK(&nvmeq->dim.work, nvme_dim_work);
+	nvmeq->dim.priv = nvmeq;
 	spin_lock_init(&nvmeq->sq_lock);
 	spin_lock_init(&nvmeq->cq_poll_lock);
 	nvmeq->cq_head = 0;
@@ -1603,6 +1903,8 @@ static int nvme_create_queue(struct nvme_queue *nvmeq, int qid, bool polled)
 		goto release_cq;
 
 	nvmeq->cq_vector = vector;
+	if (!polled && dev->adaptive_irq)
+		nvme_init_adaptive_irq(nvmeq);
 
 	result = nvme_setup_io_queues_trylock(dev);
 	if (result)
@@ -2333,6 +2635,16 @@ static int nvme_setup_io_queues(struct nvme_dev *dev)
 	set_bit(NVMEQ_ENABLED, &adminq->flags);
 	mutex_unlock(&dev->shutdown_lock);
 
+	/*
+	 * Adaptive interrupt moderation needs a vector per queue, since the
+	 * coalescing switch and polling both act on the whole vector.
+	 */
+	dev->adaptive_irq = adaptive_irq && dev->num_vecs > 1;
+	dev->irq_coalesce = dev->adaptive_irq &&
+		!nvme_set_features(&dev->ctrl, NVME_FEAT_IRQ_COALESCE,
+				   irq_coalesce_thr | irq_coalesce_time << 8,
+				   NULL, 0, NULL);
+
 	result = nvme_create_io_queues(dev);
 	if (result || dev->online_queues < 2)
 		return result;
@@ -30,6 +30,13 @@ static int so_priority;
 module_param(so_priority, int, 0644);
 MODULE_PARM_DESC(so_priority, "nvme tcp socket optimize priority");
 
+/*
+ * Number of requests io_work sends per pass before it turns to the receive
+ * side.  Sending several back to back lets MSG_MORE coalesce their PDUs
+ * into full segments.
+ */
+#define NVME_TCP_SEND_BUDGET	8
+
 enum nvme_tcp_send_state {
 	NVME_TCP_SEND_CMD_PDU = 0,
 	NVME_TCP_SEND_H2C_PDU,
@@ -63,6 +70,7 @@ enum nvme_tcp_queue_flags {
 	NVME_TCP_Q_ALLOCATED	= 0,
 	NVME_TCP_Q_LIVE		= 1,
 	NVME_TCP_Q_POLLING	= 2,
+	NVME_TCP_Q_IO_CPU_SET	= 3,
 };
 
 enum nvme_tcp_recv_state {
@@ -132,6 +140,9 @@ struct nvme_tcp_ctrl {
 	u32			io_queues[HCTX_MAX_TYPES];
 };
 
+/* number of I/O queues whose io_work is bound to each CPU */
+static atomic_t nvme_tcp_cpu_queues[NR_CPUS];
+
 static LIST_HEAD(nvme_tcp_ctrl_list);
 static DEFINE_MUTEX(nvme_tcp_ctrl_mutex);
 static struct workqueue_struct *nvme_tcp_wq;
@@ -1132,6 +1143,12 @@ static int nvme_tcp_try_recv(struct nvme_tcp_queue *queue)
 
 	rd_desc.arg.data = queue;
 	rd_desc.count = 1;
+	/*
+	 * read_sock() bypasses the recvmsg() path that normally records the
+	 * consuming CPU for RFS, so do it here to let (accelerated) RFS steer
+	 * the flow to io_cpu.
+	 */
+	sock_rps_record_flow(sk);
 	lock_sock(sk);
 	queue->nr_cqe = 0;
 	consumed = sock->ops->read_sock(sk, &rd_desc, nvme_tcp_recv_skb);
@@ -1139,6 +1156,20 @@ static int nvme_tcp_try_recv(struct nvme_tcp_queue *queue)
 	return consumed;
 }
 
+static int nvme_tcp_try_send_batch(struct nvme_tcp_queue *queue)
+{
+	int i, ret;
+
+	for (i = 0; i < NVME_TCP_SEND_BUDGET; i++) {
+		ret = nvme_tcp_try_send(queue);
+		if (ret < 0)
+			return ret;
+		if (!ret)
+			break;
+	}
+	return i;
+}
+
 static void nvme_tcp_io_work(struct work_struct *w)
 {
 	struct nvme_tcp_queue *queue =
@@ -1150,7 +1181,7 @@ static void nvme_tcp_io_work(struct work_struct *w)
 		int result;
 
 		if (mutex_trylock(&queue->send_mutex)) {
-			result = nvme_tcp_try_send(queue);
+			result = nvme_tcp_try_send_batch(queue);
 			mutex_unlock(&queue->send_mutex);
 			if (result > 0)
 				pending = true;
@@ -1399,6 +1430,51 @@ static void nvme_tcp_set_queue_io_cpu(struct nvme_tcp_queue *queue)
 	queue->io_cpu = cpumask_next_wrap(n - 1, cpu_online_mask, -1, false);
 }
 
+/*
+ * Once the tag set is mapped, move an I/O queue's io_work to one of the
+ * CPUs that submit to it, picking the one serving the fewest queues.  This
+ * keeps submission, transmit (through XPS) and, with RFS, receive
+ * processing on the CPUs and caches that issued the I/O.
+ */
+static void nvme_tcp_pin_queue_io_cpu(struct nvme_tcp_queue *queue)
+{
+	struct blk_mq_tag_set *set = &queue->ctrl->tag_set;
+	int qid = nvme_tcp_queue_id(queue) - 1;
+	int cpu, io_cpu = -1, min_queues = INT_MAX;
+	unsigned int *mq_map;
+	enum hctx_type type;
+
+	if (nvme_tcp_default_queue(queue))
+		type = HCTX_TYPE_DEFAULT;
+	else if (nvme_tcp_read_queue(queue))
+		type = HCTX_TYPE_READ;
+	else if (nvme_tcp_poll_queue(queue))
+		type = HCTX_TYPE_POLL;
+	else
+		return;
+
+	mq_map = set->map[type].mq_map;
+	if (!mq_map)
+		return;
+
+	for_each_online_cpu(cpu) {
+		int nr_queues = atomic_read(&nvme_tcp_cpu_queues[cpu]);
+
+		if (mq_map[cpu] != qid)
+			continue;
+		if (nr_queues < min_queues) {
+			min_queues = nr_queues;
+			io_cpu = cpu;
+		}
+	}
+	if (io_cpu < 0)
+		return;
+
+	queue->io_cpu = io_cpu;
+	atomic_inc(&nvme_tcp_cpu_queues[io_cpu]);
+	set_bit(NVME_TCP_Q_IO_CPU_SET, &queue->flags);
+}
+
 static int nvme_tcp_alloc_queue(struct nvme_ctrl *nctrl,
 		int qid, size_t queue_size)
 {
@@ -1571,6 +1647,8 @@ static void __nvme_tcp_stop_queue(struct nvme_tcp_queue *queue)
 	kernel_sock_shutdown(queue->sock, SHUT_RDWR);
 	nvme_tcp_restore_sock_calls(queue);
 	cancel_work_sync(&queue->io_work);
+	if (test_and_clear_bit(NVME_TCP_Q_IO_CPU_SET, &queue->flags))
+		atomic_dec(&nvme_tcp_cpu_queues[queue->io_cpu]);
 }
 
 static void nvme_tcp_stop_queue(struct nvme_ctrl *nctrl, int qid)
@@ -1589,6 +1667,9 @@ static int nvme_tcp_start_queue(struct nvme_ctrl *nctrl, int idx)
 	struct nvme_tcp_ctrl *ctrl = to_tcp_ctrl(nctrl);
 	int ret;
 
+	if (idx && !test_bit(NVME_TCP_Q_IO_CPU_SET, &ctrl->queues[idx].flags))
+		nvme_tcp_pin_queue_io_cpu(&ctrl->queues[idx]);
+
 	if (idx)
 		ret = nvmf_connect_io_queue(nctrl, idx);
 	else
@@ -2380,7 +2461,7 @@ static blk_status_t nvme_tcp_queue_rq(struct blk_mq_hw_ctx *hctx,
 	if (unlikely(ret))
 		return ret;
 
-	blk_mq_start_request(rq);
+	nvme_start_request(rq);
 
 	nvme_tcp_queue_request(req, true, bd->last);
 
@@ -5,6 +5,7 @@
  */
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 #include <linux/blkdev.h>
+#include <linux/kthread.h>
 #include <linux/module.h>
 #include "nvmet.h"
 
@@ -47,8 +48,76 @@ void nvmet_bdev_set_limits(struct block_device *bdev, struct nvme_id_ns *id)
 	id->nows = to0based(ql->io_opt / ql->logical_block_size);
 }
 
+/*
+ * Namespaces with use_poll set submit single-bio reads and writes with
+ * REQ_HIPRI and leave their completion to a per-namespace thread that polls
+ * the backing device's poll queues.  Completions are only signalled from
+ * the bio end_io handler, the thread completes the nvmet request once it
+ * has unlinked it, so the request can't be reused while on the list.
+ */
+static int nvmet_bdev_poll_thread(void *data)
+{
+	struct nvmet_ns *ns = data;
+	struct request_queue *q = bdev_get_queue(ns->bdev);
+	struct nvmet_req *req, *tmp;
+	LIST_HEAD(list);
+
+	while (!kthread_should_stop()) {
+		spin_lock_irq(&ns->poll_lock);
+		list_splice_tail_init(&ns->poll_list, &list);
+		spin_unlock_irq(&ns->poll_lock);
+
+		if (list_empty(&list)) {
+			wait_event_idle(ns->poll_wait, kthread_should_stop() ||
+					!list_empty_careful(&ns->poll_list));
+			continue;
+		}
+
+		list_for_each_entry_safe(req, tmp, &list, b.poll_entry) {
+			if (smp_load_acquire(&req->b.poll_done)) {
+				list_del(&req->b.poll_entry);
+				nvmet_req_complete(req, req->b.poll_status);
+				continue;
+			}
+			blk_poll(q, req->b.cookie, false);
+		}
+		cond_resched();
+	}
+
+	/* the namespace only goes away once all requests have completed */
+	WARN_ON_ONCE(!list_empty(&list) || !list_empty(&ns->poll_list));
+	return 0;
+}
+
+static void nvmet_bdev_ns_enable_poll(struct nvmet_ns *ns)
+{
+	struct task_struct *thread;
+
+	if (!test_bit(QUEUE_FLAG_POLL, &bdev_get_queue(ns->bdev)->queue_flags)) {
+		pr_warn("%s has no poll queues, not polling nsid %d\n",
+			ns->device_path, ns->nsid);
+		return;
+	}
+
+	spin_lock_init(&ns->poll_lock);
+	INIT_LIST_HEAD(&ns->poll_list);
+	init_waitqueue_head(&ns->poll_wait);
+	thread = kthread_run(nvmet_bdev_poll_thread, ns, "nvmet-poll/%d",
+			     ns->nsid);
+	if (IS_ERR(thread)) {
+		pr_warn("failed to start poll thread for nsid %d: %ld\n",
+			ns->nsid, PTR_ERR(thread));
+		return;
+	}
+	ns->poll_thread = thread;
+}
+
 void nvmet_bdev_ns_disable(struct nvmet_ns *ns)
 {
+	if (ns->poll_thread) {
+		kthread_stop(ns->poll_thread);
+		ns->poll_thread = NULL;
+	}
 	if (ns->bdev) {
 		blkdev_put(ns->bdev, FMODE_WRITE | FMODE_READ);
 		ns->bdev = NULL;
@@ -102,6 +171,8 @@ int nvmet_bdev_ns_enable(struct nvmet_ns *ns)
 		ns->csi = NVME_CSI_ZNS;
 	}
 
+	if (ns->use_poll)
+		nvmet_bdev_ns_enable_poll(ns);
 	return 0;
 }
 
@@ -175,6 +246,31 @@ static void nvmet_bio_done(struct bio *bio)
 	nvmet_req_bio_put(req, bio);
 }
 
+static void nvmet_bio_poll_done(struct bio *bio)
+{
+	struct nvmet_req *req = bio->bi_private;
+
+	req->b.poll_status = blk_to_nvme_status(req, bio->bi_status);
+	nvmet_req_bio_put(req, bio);
+	/* pairs with smp_load_acquire() in nvmet_bdev_poll_thread() */
+	smp_store_release(&req->b.poll_done, true);
+}
+
+static void nvmet_bdev_submit_polled(struct nvmet_req *req, struct bio *bio)
+{
+	struct nvmet_ns *ns = req->ns;
+
+	req->b.poll_done = false;
+	bio->bi_end_io = nvmet_bio_poll_done;
+	req->b.cookie = submit_bio(bio);
+
+	spin_lock_irq(&ns->poll_lock);
+	list_add_tail(&req->b.poll_entry, &ns->poll_list);
+	spin_unlock_irq(&ns->poll_lock);
+	if (wq_has_sleeper(&ns->poll_wait))
+		wake_up(&ns->poll_wait);
+}
+
 #ifdef CONFIG_BLK_DEV_INTEGRITY
 static int nvmet_bdev_alloc_bip(struct nvmet_req *req, struct bio *bio,
 				struct sg_mapping_iter *miter)
@@ -261,6 +357,8 @@ static void nvmet_bdev_execute_rw(struct nvmet_req *req)
 
 	if (is_pci_p2pdma_page(sg_page(req->sg)))
 		op |= REQ_NOMERGE;
+	if (req->ns->poll_thread)
+		op |= REQ_HIPRI;
 
 	sector = nvmet_lba_to_sect(req->ns, req->cmd->rw.slba);
 
@@ -295,6 +393,10 @@ static void nvmet_bdev_execute_rw(struct nvmet_req *req)
 				}
 			}
 
+			/* only single-bio requests are polled */
+			op &= ~REQ_HIPRI;
+			prev->bi_opf &= ~REQ_HIPRI;
+
 			bio = bio_alloc(GFP_KERNEL, bio_max_segs(sg_cnt));
 			bio_set_dev(bio, req->ns->bdev);
 			bio->bi_iter.bi_sector = sector;
@@ -316,7 +418,10 @@ static void nvmet_bdev_execute_rw(struct nvmet_req *req)
 		}
 	}
 
-	submit_bio(bio);
+	if (bio->bi_opf & REQ_HIPRI)
+		nvmet_bdev_submit_polled(req, bio);
+	else
+		submit_bio(bio);
 	blk_finish_plug(&plug);
 }
 
@@ -28,8 +28,7 @@ int nvmet_file_ns_revalidate(struct nvmet_ns *ns)
 void nvmet_file_ns_disable(struct nvmet_ns *ns)
 {
 	if (ns->file) {
-		if (ns->buffered_io)
-			flush_workqueue(buffered_io_wq);
+		flush_workqueue(buffered_io_wq);
 		mempool_destroy(ns->bvec_pool);
 		ns->bvec_pool = NULL;
 		kmem_cache_destroy(ns->bvec_cache);
@@ -125,11 +124,22 @@ static ssize_t nvmet_file_submit_bvec(struct nvmet_req *req, loff_t pos,
 	return call_iter(iocb, &iter);
 }
 
+static void nvmet_file_submit_buffered_io(struct nvmet_req *req);
+
 static void nvmet_file_io_done(struct kiocb *iocb, long ret, long ret2)
 {
 	struct nvmet_req *req = container_of(iocb, struct nvmet_req, f.iocb);
 	u16 status = NVME_SC_SUCCESS;
 
+	/*
+	 * An asynchronous IOCB_NOWAIT submission can still hit a blocking
+	 * condition after it was queued, retry it from the workqueue.
+	 */
+	if (unlikely(ret == -EAGAIN) && (iocb->ki_flags & IOCB_NOWAIT)) {
+		nvmet_file_submit_buffered_io(req);
+		return;
+	}
+
 	if (req->f.bvec != req->inline_bvec) {
 		if (likely(req->f.mpool_alloc == false))
 			kfree(req->f.bvec);
@@ -196,9 +206,10 @@ static bool nvmet_file_execute_io(struct nvmet_req *req, int ki_flags)
 
 	/*
 	 * A NULL ki_complete ask for synchronous execution, which we want
-	 * for the IOCB_NOWAIT case.
+	 * for the buffered IOCB_NOWAIT case where the data is either in the
+	 * page cache or not.  Direct I/O always completes asynchronously.
 	 */
-	if (!(ki_flags & IOCB_NOWAIT))
+	if (!(ki_flags & IOCB_NOWAIT) || !req->ns->buffered_io)
 		req->f.iocb.ki_complete = nvmet_file_io_done;
 
 	ret = nvmet_file_submit_bvec(req, pos, bv_cnt, total_len, ki_flags);
@@ -264,12 +275,16 @@ static void nvmet_file_execute_rw(struct nvmet_req *req)
 	} else
 		req->f.mpool_alloc = false;
 
-	if (req->ns->buffered_io) {
-		if (likely(!req->f.mpool_alloc) &&
-				nvmet_file_execute_io(req, IOCB_NOWAIT))
-			return;
+	/*
+	 * Try a non-blocking submission from the transport's context first
+	 * and only hand the request to the workqueue if it would block.
+	 */
+	if (likely(!req->f.mpool_alloc) &&
+	    nvmet_file_execute_io(req, IOCB_NOWAIT))
+		return;
+	if (req->ns->buffered_io)
 		nvmet_file_submit_buffered_io(req);
-	} else
+	else
 		nvmet_file_execute_io(req, 0);
 }
 
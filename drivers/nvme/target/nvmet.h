@@ -68,6 +68,7 @@ struct nvmet_ns {
 	u32			anagrpid;
 
 	bool			buffered_io;
+	bool			use_poll;
 	bool			enabled;
 	struct nvmet_subsys	*subsys;
 	const char		*device_path;
@@ -84,6 +85,12 @@ struct nvmet_ns {
 	int			pi_type;
 	int			metadata_size;
 	u8			csi;
+
+	/* polled bdev I/O, see nvmet_bdev_poll_thread() */
+	struct task_struct	*poll_thread;
+	spinlock_t		poll_lock;
+	struct list_head	poll_list;
+	wait_queue_head_t	poll_wait;
 };
 
 static inline struct nvmet_ns *to_nvmet_ns(struct config_item *item)
@@ -326,6 +333,11 @@ struct nvmet_req {
 	union {
 		struct {
 			struct bio      inline_bio;
+			/* only used for polled I/O: */
+			struct list_head	poll_entry;
+			blk_qc_t		cookie;
+			u16			poll_status;
+			bool			poll_done;
 		} b;
 		struct {
 			bool			mpool_alloc;
@@ -13,6 +13,9 @@
 #include <net/tcp.h>
 #include <linux/inet.h>
 #include <linux/llist.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <net/busy_poll.h>
 #include <crypto/hash.h>
 
 #include "nvmet.h"
@@ -41,6 +44,7 @@ MODULE_PARM_DESC(idle_poll_period_usecs,
 
 #define NVMET_TCP_RECV_BUDGET		8
 #define NVMET_TCP_SEND_BUDGET		8
+#define NVMET_TCP_SEND_BUDGET_MAX	32
 #define NVMET_TCP_IO_WORK_BUDGET	64
 
 enum nvmet_tcp_send_state {
@@ -131,6 +135,12 @@ struct nvmet_tcp_queue {
 
 	unsigned long           poll_end;
 
+	/* io_work statistics, reported in debugfs */
+	u64			nr_io_work;
+	u64			nr_recvs;
+	u64			nr_sends;
+	u64			nr_busy_polls;
+
 	spinlock_t		state_lock;
 	enum nvmet_tcp_queue_state state;
 
@@ -163,6 +173,7 @@ static LIST_HEAD(nvmet_tcp_queue_list);
 static DEFINE_MUTEX(nvmet_tcp_queue_mutex);
 
 static struct workqueue_struct *nvmet_tcp_wq;
+static struct dentry *nvmet_tcp_debugfs;
 static const struct nvmet_fabrics_ops nvmet_tcp_ops;
 static void nvmet_tcp_free_cmd(struct nvmet_tcp_cmd *c);
 static void nvmet_tcp_finish_cmd(struct nvmet_tcp_cmd *cmd);
@@ -781,6 +792,13 @@ static int nvmet_tcp_try_send(struct nvmet_tcp_queue *queue,
 {
 	int i, ret = 0;
 
+	/*
+	 * Let a deep backlog of R2T, C2H data and response PDUs go out in
+	 * one MSG_MORE batch instead of flushing every @budget PDUs.
+	 */
+	if (queue->send_list_len > budget)
+		budget = min(queue->send_list_len, NVMET_TCP_SEND_BUDGET_MAX);
+
 	for (i = 0; i < budget; i++) {
 		ret = nvmet_tcp_try_send_one(queue, i == budget - 1);
 		if (unlikely(ret < 0)) {
@@ -1272,32 +1290,50 @@ static void nvmet_tcp_io_work(struct work_struct *w)
 {
 	struct nvmet_tcp_queue *queue =
 		container_of(w, struct nvmet_tcp_queue, io_work);
+	struct blk_plug plug;
 	bool pending;
-	int ret, ops = 0;
+	int ret, recvs = 0, sends = 0;
 
+	queue->nr_io_work++;
 	do {
 		pending = false;
 
-		ret = nvmet_tcp_try_recv(queue, NVMET_TCP_RECV_BUDGET, &ops);
+		/* batch the backend I/O of all commands received in one pass */
+		blk_start_plug(&plug);
+		ret = nvmet_tcp_try_recv(queue, NVMET_TCP_RECV_BUDGET, &recvs);
+		blk_finish_plug(&plug);
 		if (ret > 0)
 			pending = true;
 		else if (ret < 0)
-			return;
+			goto out;
 
-		ret = nvmet_tcp_try_send(queue, NVMET_TCP_SEND_BUDGET, &ops);
+		ret = nvmet_tcp_try_send(queue, NVMET_TCP_SEND_BUDGET, &sends);
 		if (ret > 0)
 			pending = true;
 		else if (ret < 0)
-			return;
+			goto out;
 
-	} while (pending && ops < NVMET_TCP_IO_WORK_BUDGET);
+	} while (pending && recvs + sends < NVMET_TCP_IO_WORK_BUDGET);
 
 	/*
 	 * Requeue the worker if idle deadline period is in progress or any
 	 * ops activity was recorded during the do-while loop above.
 	 */
-	if (nvmet_tcp_check_queue_deadline(queue, ops) || pending)
+	if (nvmet_tcp_check_queue_deadline(queue, recvs + sends) || pending) {
+		/*
+		 * While idle-polling, spin on the NIC queue of this socket
+		 * instead of only rescheduling ourselves, so that the next
+		 * command is picked up without waiting for an interrupt.
+		 */
+		if (!pending && sk_can_busy_loop(queue->sock->sk)) {
+			sk_busy_loop(queue->sock->sk, true);
+			queue->nr_busy_polls++;
+		}
 		queue_work_on(queue_cpu(queue), nvmet_tcp_wq, &queue->io_work);
+	}
+out:
+	queue->nr_recvs += recvs;
+	queue->nr_sends += sends;
 }
 
 static int nvmet_tcp_alloc_cmd(struct nvmet_tcp_queue *queue,
@@ -1809,6 +1845,24 @@ static const struct nvmet_fabrics_ops nvmet_tcp_ops = {
 	.disc_traddr		= nvmet_tcp_disc_port_addr,
 };
 
+static int nvmet_tcp_queues_show(struct seq_file *m, void *v)
+{
+	struct nvmet_tcp_queue *queue;
+
+	mutex_lock(&nvmet_tcp_queue_mutex);
+	list_for_each_entry(queue, &nvmet_tcp_queue_list, queue_list) {
+		seq_printf(m, "queue %d: cpu %d io_work %llu recvs %llu sends %llu busy_polls %llu\n",
+			   queue->idx, queue_cpu(queue),
+			   READ_ONCE(queue->nr_io_work),
+			   READ_ONCE(queue->nr_recvs),
+			   READ_ONCE(queue->nr_sends),
+			   READ_ONCE(queue->nr_busy_polls));
+	}
+	mutex_unlock(&nvmet_tcp_queue_mutex);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(nvmet_tcp_queues);
+
 static int __init nvmet_tcp_init(void)
 {
 	int ret;
@@ -1821,6 +1875,9 @@ static int __init nvmet_tcp_init(void)
 	if (ret)
 		goto err;
 
+	nvmet_tcp_debugfs = debugfs_create_dir("nvmet_tcp", NULL);
+	debugfs_create_file("queues", 0444, nvmet_tcp_debugfs, NULL,
+			    &nvmet_tcp_queues_fops);
 	return 0;
 err:
 	destroy_workqueue(nvmet_tcp_wq);
@@ -1831,6 +1888,7 @@ static void __exit nvmet_tcp_exit(void)
 {
 	struct nvmet_tcp_queue *queue;
 
+	debugfs_remove_recursive(nvmet_tcp_debugfs);
 	nvmet_unregister_transport(&nvmet_tcp_ops);
 
 	flush_scheduled_work();
@@ -743,6 +743,9 @@ struct se_device *target_alloc_device(struct se_hba *hba, const char *name)
 
 		init_llist_head(&q->sq.cmd_list);
 		INIT_WORK(&q->sq.work, target_queued_submit_work);
+
+		init_llist_head(&q->cq.cmd_list);
+		INIT_WORK(&q->cq.work, target_queued_compl_work);
 	}
 
 	dev->se_hba = hba;
@@ -1009,6 +1012,7 @@ int target_configure_device(struct se_device *dev)
 void target_free_device(struct se_device *dev)
 {
 	struct se_hba *hba = dev->se_hba;
+	int i;
 
 	WARN_ON(!list_empty(&dev->dev_sep_list));
 
@@ -1032,6 +1036,9 @@ void target_free_device(struct se_device *dev)
 	if (dev->transport->free_prot)
 		dev->transport->free_prot(dev);
 
+	/* the last completion batch may still be unwinding */
+	for (i = 0; i < dev->queue_cnt; i++)
+		flush_work(&dev->queues[i].cq.work);
 	kfree(dev->queues);
 	dev->transport->free_device(dev);
 }
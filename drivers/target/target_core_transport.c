@@ -853,11 +853,37 @@ static bool target_cmd_interrupted(struct se_cmd *cmd)
 	return false;
 }
 
+static bool target_cmd_success(struct se_cmd *cmd)
+{
+	return cmd->scsi_status != SAM_STAT_CHECK_CONDITION ||
+	       (cmd->se_cmd_flags & SCF_TRANSPORT_TASK_SENSE);
+}
+
+void target_queued_compl_work(struct work_struct *work)
+{
+	struct se_cmd_queue *cq = container_of(work, struct se_cmd_queue, work);
+	struct se_cmd *se_cmd, *next_cmd;
+	struct llist_node *cmd_list;
+
+	cmd_list = llist_del_all(&cq->cmd_list);
+	if (!cmd_list)
+		return;
+
+	cmd_list = llist_reverse_order(cmd_list);
+	llist_for_each_entry_safe(se_cmd, next_cmd, cmd_list, se_cmd_list) {
+		if (target_cmd_success(se_cmd))
+			target_complete_ok_work(&se_cmd->work);
+		else
+			target_complete_failure_work(&se_cmd->work);
+	}
+}
+
 /* May be called from interrupt context so must not sleep. */
 void target_complete_cmd_with_sense(struct se_cmd *cmd, u8 scsi_status,
 				    sense_reason_t sense_reason)
 {
 	struct se_wwn *wwn = cmd->se_sess->se_tpg->se_tpg_wwn;
+	struct se_cmd_queue *cq;
 	int success, cpu;
 	unsigned long flags;
 
@@ -868,31 +894,34 @@ void target_complete_cmd_with_sense(struct se_cmd *cmd, u8 scsi_status,
 	cmd->sense_reason = sense_reason;
 
 	spin_lock_irqsave(&cmd->t_state_lock, flags);
-	switch (cmd->scsi_status) {
-	case SAM_STAT_CHECK_CONDITION:
-		if (cmd->se_cmd_flags & SCF_TRANSPORT_TASK_SENSE)
-			success = 1;
-		else
-			success = 0;
-		break;
-	default:
-		success = 1;
-		break;
-	}
-
+	success = target_cmd_success(cmd);
 	cmd->t_state = TRANSPORT_COMPLETE;
 	cmd->transport_state |= (CMD_T_COMPLETE | CMD_T_ACTIVE);
 	spin_unlock_irqrestore(&cmd->t_state_lock, flags);
 
-	INIT_WORK(&cmd->work, success ? target_complete_ok_work :
-		  target_complete_failure_work);
-
 	if (!wwn || wwn->cmd_compl_affinity == SE_COMPL_AFFINITY_CPUID)
 		cpu = cmd->cpuid;
+	else if (wwn->cmd_compl_affinity == WORK_CPU_UNBOUND)
+		cpu = raw_smp_processor_id();
 	else
 		cpu = wwn->cmd_compl_affinity;
 
-	queue_work_on(cpu, target_completion_wq, &cmd->work);
+	if (unlikely(!cmd->se_dev)) {
+		INIT_WORK(&cmd->work, success ? target_complete_ok_work :
+			  target_complete_failure_work);
+		queue_work_on(cpu, target_completion_wq, &cmd->work);
+		return;
+	}
+
+	/*
+	 * Commands completing on the same CPU are batched on a lockless
+	 * list, and the work item is only queued by whoever finds the list
+	 * empty.  The submission side is done with se_cmd_list by the time
+	 * a command completes, so it can be reused here.
+	 */
+	cq = &cmd->se_dev->queues[cpu].cq;
+	if (llist_add(&cmd->se_cmd_list, &cq->cmd_list))
+		queue_work_on(cpu, target_completion_wq, &cq->work);
 }
 EXPORT_SYMBOL(target_complete_cmd_with_sense);
 
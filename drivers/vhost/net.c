@@ -35,7 +35,7 @@
 
 #include "vhost.h"
 
-static int experimental_zcopytx = 0;
+static int experimental_zcopytx = 1;
 module_param(experimental_zcopytx, int, 0444);
 MODULE_PARM_DESC(experimental_zcopytx, "Enable Zero Copy TX;"
 		                       " 1 -Enable; 0 - Disable");
@@ -54,6 +54,12 @@ MODULE_PARM_DESC(experimental_zcopytx, "Enable Zero Copy TX;"
 #define VHOST_MAX_PEND 128
 #define VHOST_GOODCOPY_LEN 256
 
+/* If the lower device has not completed the oldest outstanding zerocopy
+ * buffer in this long, it is sitting on them (e.g. queued behind a slow
+ * qdisc): copy instead, so the guest is not held up waiting for them.
+ */
+#define VHOST_NET_ZCOPY_STALL (HZ / 100)
+
 /*
  * For transmit, used buffer len is unused; we override it to track buffer
  * status internally; used for zerocopy tx only.
@@ -115,6 +121,10 @@ struct vhost_net_virtqueue {
 	 * For RX, number of batched heads
 	 */
 	int done_idx;
+	/* For TX, jiffies when done_idx last moved or a zerocopy buffer was
+	 * first outstanding
+	 */
+	unsigned long zcopy_progress;
 	/* Number of XDP frames batched */
 	int batched_xdp;
 	/* an array of userspace buffers info */
@@ -330,13 +340,20 @@ static void vhost_net_tx_err(struct vhost_net *net)
 	++net->tx_zcopy_err;
 }
 
+static bool vhost_net_tx_zcopy_stalled(struct vhost_net_virtqueue *nvq)
+{
+	return nvq->done_idx != nvq->upend_idx &&
+	       time_after(jiffies, nvq->zcopy_progress + VHOST_NET_ZCOPY_STALL);
+}
+
 static bool vhost_net_tx_select_zcopy(struct vhost_net *net)
 {
 	/* TX flush waits for outstanding DMAs to be done.
 	 * Don't start new DMAs.
 	 */
 	return !net->tx_flush &&
-		net->tx_packets / 64 >= net->tx_zcopy_err;
+		net->tx_packets / 64 >= net->tx_zcopy_err &&
+		!vhost_net_tx_zcopy_stalled(&net->vqs[VHOST_NET_VQ_TX]);
 }
 
 static bool vhost_sock_zcopy(struct socket *sock)
@@ -372,13 +389,17 @@ static void vhost_zerocopy_signal_used(struct vhost_net *net,
 		} else
 			break;
 	}
+	if (!j)
+		return;
+
+	nvq->zcopy_progress = jiffies;
 	while (j) {
 		add = min(UIO_MAXIOV - nvq->done_idx, j);
-		vhost_add_used_and_signal_n(vq->dev, vq,
-					    &vq->heads[nvq->done_idx], add);
+		vhost_add_used_n(vq, &vq->heads[nvq->done_idx], add);
 		nvq->done_idx = (nvq->done_idx + add) % UIO_MAXIOV;
 		j -= add;
 	}
+	vhost_signal(vq->dev, vq);
 }
 
 static void vhost_zerocopy_callback(struct sk_buff *skb,
@@ -543,7 +564,7 @@ static void vhost_net_busy_poll(struct vhost_net *net,
 	endtime = busy_clock() + busyloop_timeout;
 
 	while (vhost_can_busy_poll(endtime)) {
-		if (vhost_has_work(&net->dev)) {
+		if (vhost_vq_has_work(poll_rx ? rvq : tvq)) {
 			*busyloop_intr = true;
 			break;
 		}
@@ -877,8 +898,12 @@ static void handle_tx_zerocopy(struct vhost_net *net, struct socket *sock)
 	do {
 		bool busyloop_intr;
 
-		/* Release DMAs done buffers first */
-		vhost_zerocopy_signal_used(net, vq);
+		/* Release DMAs done buffers every batch, or sooner if
+		 * they are holding up new zerocopy sends.
+		 */
+		if (!(sent_pkts % VHOST_NET_BATCH) ||
+		    vhost_exceeds_maxpend(net))
+			vhost_zerocopy_signal_used(net, vq);
 
 		busyloop_intr = false;
 		head = get_tx_bufs(net, nvq, &msg, &out, &in, &len,
@@ -917,6 +942,8 @@ static void handle_tx_zerocopy(struct vhost_net *net, struct socket *sock)
 			msg.msg_controllen = sizeof(ctl);
 			ubufs = nvq->ubufs;
 			atomic_inc(&ubufs->refcount);
+			if (nvq->upend_idx == nvq->done_idx)
+				nvq->zcopy_progress = jiffies;
 			nvq->upend_idx = (nvq->upend_idx + 1) % UIO_MAXIOV;
 		} else {
 			msg.msg_control = NULL;
@@ -949,10 +976,10 @@ static void handle_tx_zerocopy(struct vhost_net *net, struct socket *sock)
 				 " len %d != %zd\n", err, len);
 		if (!zcopy_used)
 			vhost_add_used_and_signal(&net->dev, vq, head, 0);
-		else
-			vhost_zerocopy_signal_used(net, vq);
 		vhost_net_tx_packet(net);
 	} while (likely(!vhost_exceeds_weight(vq, ++sent_pkts, total_len)));
+
+	vhost_zerocopy_signal_used(net, vq);
 }
 
 /* Expects to be always run from workqueue - which acts as
@@ -1339,8 +1366,10 @@ static int vhost_net_open(struct inode *inode, struct file *f)
 		       VHOST_NET_PKT_WEIGHT, VHOST_NET_WEIGHT, true,
 		       NULL);
 
-	vhost_poll_init(n->poll + VHOST_NET_VQ_TX, handle_tx_net, EPOLLOUT, dev);
-	vhost_poll_init(n->poll + VHOST_NET_VQ_RX, handle_rx_net, EPOLLIN, dev);
+	vhost_poll_init(n->poll + VHOST_NET_VQ_TX, handle_tx_net, EPOLLOUT, dev,
+			vqs[VHOST_NET_VQ_TX]);
+	vhost_poll_init(n->poll + VHOST_NET_VQ_RX, handle_rx_net, EPOLLIN, dev,
+			vqs[VHOST_NET_VQ_RX]);
 
 	f->private_data = n;
 	n->page_frag.page = NULL;
@@ -185,14 +185,16 @@ void vhost_work_init(struct vhost_work *work, vhost_work_fn_t fn)
 }
 EXPORT_SYMBOL_GPL(vhost_work_init);
 
-/* Init poll structure */
+/* Init poll structure.  The work runs on @vq's worker if there is a @vq. */
 void vhost_poll_init(struct vhost_poll *poll, vhost_work_fn_t fn,
-		     __poll_t mask, struct vhost_dev *dev)
+		     __poll_t mask, struct vhost_dev *dev,
+		     struct vhost_virtqueue *vq)
 {
 	init_waitqueue_func_entry(&poll->wait, vhost_poll_wakeup);
 	init_poll_funcptr(&poll->table, vhost_poll_func);
 	poll->mask = mask;
 	poll->dev = dev;
+	poll->vq = vq;
 	poll->wqh = NULL;
 
 	vhost_work_init(&poll->work, fn);
@@ -231,17 +233,40 @@ void vhost_poll_stop(struct vhost_poll *poll)
 }
 EXPORT_SYMBOL_GPL(vhost_poll_stop);
 
-void vhost_work_dev_flush(struct vhost_dev *dev)
+static void vhost_worker_queue(struct vhost_worker *worker,
+			       struct vhost_work *work)
+{
+	if (!test_and_set_bit(VHOST_WORK_QUEUED, &work->flags)) {
+		/* We can only add the work to the list after we're
+		 * sure it was not in the list.
+		 * test_and_set_bit() implies a memory barrier.
+		 */
+		llist_add(&work->node, &worker->work_list);
+		wake_up_process(worker->task);
+	}
+}
+
+static void vhost_worker_flush(struct vhost_worker *worker)
 {
 	struct vhost_flush_struct flush;
 
-	if (dev->worker) {
-		init_completion(&flush.wait_event);
-		vhost_work_init(&flush.work, vhost_flush_work);
+	init_completion(&flush.wait_event);
+	vhost_work_init(&flush.work, vhost_flush_work);
 
-		vhost_work_queue(dev, &flush.work);
-		wait_for_completion(&flush.wait_event);
-	}
+	vhost_worker_queue(worker, &flush.work);
+	wait_for_completion(&flush.wait_event);
+}
+
+void vhost_work_dev_flush(struct vhost_dev *dev)
+{
+	int i;
+
+	if (!dev->workers)
+		return;
+
+	for (i = 0; i < dev->nvqs; ++i)
+		if (dev->workers[i])
+			vhost_worker_flush(dev->workers[i]);
 }
 EXPORT_SYMBOL_GPL(vhost_work_dev_flush);
 
@@ -253,32 +278,57 @@ void vhost_poll_flush(struct vhost_poll *poll)
 }
 EXPORT_SYMBOL_GPL(vhost_poll_flush);
 
+/* Queue device wide work on the default worker */
 void vhost_work_queue(struct vhost_dev *dev, struct vhost_work *work)
 {
-	if (!dev->worker)
-		return;
+	struct vhost_worker *worker = READ_ONCE(dev->worker);
 
-	if (!test_and_set_bit(VHOST_WORK_QUEUED, &work->flags)) {
-		/* We can only add the work to the list after we're
-		 * sure it was not in the list.
-		 * test_and_set_bit() implies a memory barrier.
-		 */
-		llist_add(&work->node, &dev->work_list);
-		wake_up_process(dev->worker);
-	}
+	if (worker)
+		vhost_worker_queue(worker, work);
 }
 EXPORT_SYMBOL_GPL(vhost_work_queue);
 
+void vhost_vq_work_queue(struct vhost_virtqueue *vq, struct vhost_work *work)
+{
+	struct vhost_worker *worker = READ_ONCE(vq->worker);
+
+	if (worker)
+		vhost_worker_queue(worker, work);
+}
+EXPORT_SYMBOL_GPL(vhost_vq_work_queue);
+
 /* A lockless hint for busy polling code to exit the loop */
 bool vhost_has_work(struct vhost_dev *dev)
 {
-	return !llist_empty(&dev->work_list);
+	int i;
+
+	if (!dev->workers)
+		return false;
+
+	for (i = 0; i < dev->nvqs; ++i)
+		if (dev->workers[i] &&
+		    !llist_empty(&dev->workers[i]->work_list))
+			return true;
+
+	return false;
 }
 EXPORT_SYMBOL_GPL(vhost_has_work);
 
+/* Same, for the worker @vq runs on */
+bool vhost_vq_has_work(struct vhost_virtqueue *vq)
+{
+	struct vhost_worker *worker = READ_ONCE(vq->worker);
+
+	return worker && !llist_empty(&worker->work_list);
+}
+EXPORT_SYMBOL_GPL(vhost_vq_has_work);
+
 void vhost_poll_queue(struct vhost_poll *poll)
 {
-	vhost_work_queue(poll->dev, &poll->work);
+	if (poll->vq)
+		vhost_vq_work_queue(poll->vq, &poll->work);
+	else
+		vhost_work_queue(poll->dev, &poll->work);
 }
 EXPORT_SYMBOL_GPL(vhost_poll_queue);
 
@@ -288,6 +338,7 @@ static void __vhost_vq_meta_reset(struct vhost_virtqueue *vq)
 
 	for (j = 0; j < VHOST_NUM_ADDRS; j++)
 		vq->meta_iotlb[j] = NULL;
+	vq->desc_map = NULL;
 }
 
 static void vhost_vq_meta_reset(struct vhost_dev *d)
@@ -319,6 +370,7 @@ static void vhost_vq_reset(struct vhost_dev *dev,
 	vq->used = NULL;
 	vq->last_avail_idx = 0;
 	vq->avail_idx = 0;
+	vq->avail_heads_num = 0;
 	vq->last_used_idx = 0;
 	vq->signalled_used = 0;
 	vq->signalled_used_valid = false;
@@ -343,7 +395,8 @@ static void vhost_vq_reset(struct vhost_dev *dev,
 
 static int vhost_worker(void *data)
 {
-	struct vhost_dev *dev = data;
+	struct vhost_worker *worker = data;
+	struct vhost_dev *dev = worker->dev;
 	struct vhost_work *work, *work_next;
 	struct llist_node *node;
 
@@ -358,7 +411,7 @@ static int vhost_worker(void *data)
 			break;
 		}
 
-		node = llist_del_all(&dev->work_list);
+		node = llist_del_all(&worker->work_list);
 		if (!node)
 			schedule();
 
@@ -482,12 +535,12 @@ void vhost_dev_init(struct vhost_dev *dev,
 	dev->iotlb = NULL;
 	dev->mm = NULL;
 	dev->worker = NULL;
+	dev->workers = NULL;
 	dev->iov_limit = iov_limit;
 	dev->weight = weight;
 	dev->byte_weight = byte_weight;
 	dev->use_worker = use_worker;
 	dev->msg_handler = msg_handler;
-	init_llist_head(&dev->work_list);
 	init_waitqueue_head(&dev->wait);
 	INIT_LIST_HEAD(&dev->read_list);
 	INIT_LIST_HEAD(&dev->pending_list);
@@ -500,11 +553,12 @@ void vhost_dev_init(struct vhost_dev *dev,
 		vq->indirect = NULL;
 		vq->heads = NULL;
 		vq->dev = dev;
+		vq->worker = NULL;
 		mutex_init(&vq->mutex);
 		vhost_vq_reset(dev, vq);
 		if (vq->handle_kick)
 			vhost_poll_init(&vq->poll, vq->handle_kick,
-					EPOLLIN, dev);
+					EPOLLIN, dev, vq);
 	}
 }
 EXPORT_SYMBOL_GPL(vhost_dev_init);
@@ -531,17 +585,106 @@ static void vhost_attach_cgroups_work(struct vhost_work *work)
 	s->ret = cgroup_attach_task_all(s->owner, current);
 }
 
-static int vhost_attach_cgroups(struct vhost_dev *dev)
+static int vhost_attach_cgroups(struct vhost_worker *worker)
 {
 	struct vhost_attach_cgroups_struct attach;
 
 	attach.owner = current;
 	vhost_work_init(&attach.work, vhost_attach_cgroups_work);
-	vhost_work_queue(dev, &attach.work);
-	vhost_work_dev_flush(dev);
+	vhost_worker_queue(worker, &attach.work);
+	vhost_worker_flush(worker);
 	return attach.ret;
 }
 
+static struct vhost_worker *vhost_worker_create(struct vhost_dev *dev, u32 id)
+{
+	struct vhost_worker *worker;
+	struct task_struct *task;
+	int ret;
+
+	worker = kzalloc(sizeof(*worker), GFP_KERNEL_ACCOUNT);
+	if (!worker)
+		return ERR_PTR(-ENOMEM);
+
+	worker->dev = dev;
+	init_llist_head(&worker->work_list);
+
+	if (id)
+		task = kthread_create(vhost_worker, worker, "vhost-%d-%u",
+				      current->pid, id);
+	else
+		task = kthread_create(vhost_worker, worker, "vhost-%d",
+				      current->pid);
+	if (IS_ERR(task)) {
+		ret = PTR_ERR(task);
+		goto err_free;
+	}
+
+	worker->task = task;
+	wake_up_process(task); /* avoid contributing to loadavg */
+
+	ret = vhost_attach_cgroups(worker);
+	if (ret)
+		goto err_stop;
+
+	return worker;
+
+err_stop:
+	kthread_stop(task);
+err_free:
+	kfree(worker);
+	return ERR_PTR(ret);
+}
+
+static void vhost_dev_free_workers(struct vhost_dev *dev)
+{
+	int i;
+
+	if (!dev->workers)
+		return;
+
+	for (i = 0; i < dev->nvqs; ++i) {
+		struct vhost_worker *worker = dev->workers[i];
+
+		dev->vqs[i]->worker = NULL;
+		if (!worker)
+			continue;
+		WARN_ON(!llist_empty(&worker->work_list));
+		kthread_stop(worker->task);
+		kfree(worker);
+	}
+	kfree(dev->workers);
+	dev->workers = NULL;
+	dev->worker = NULL;
+}
+
+/* Caller should have device mutex and vq mutex */
+static long vhost_vq_set_worker(struct vhost_dev *dev,
+				struct vhost_virtqueue *vq, u32 id)
+{
+	struct vhost_worker *worker;
+
+	if (!dev->workers)
+		return -EINVAL;
+	/* Work already queued for the backend would race with the new worker */
+	if (vq->private_data)
+		return -EBUSY;
+	if (id >= dev->nvqs)
+		return -EINVAL;
+
+	id = array_index_nospec(id, dev->nvqs);
+	worker = dev->workers[id];
+	if (!worker) {
+		worker = vhost_worker_create(dev, id);
+		if (IS_ERR(worker))
+			return PTR_ERR(worker);
+		dev->workers[id] = worker;
+	}
+
+	WRITE_ONCE(vq->worker, worker);
+	return 0;
+}
+
 /* Caller should have device mutex */
 bool vhost_dev_has_owner(struct vhost_dev *dev)
 {
@@ -582,8 +725,8 @@ static void vhost_detach_mm(struct vhost_dev *dev)
 /* Caller should have device mutex */
 long vhost_dev_set_owner(struct vhost_dev *dev)
 {
-	struct task_struct *worker;
-	int err;
+	struct vhost_worker *worker;
+	int err, i;
 
 	/* Is there an owner already? */
 	if (vhost_dev_has_owner(dev)) {
@@ -595,19 +738,23 @@ long vhost_dev_set_owner(struct vhost_dev *dev)
 
 	dev->kcov_handle = kcov_common_handle();
 	if (dev->use_worker) {
-		worker = kthread_create(vhost_worker, dev,
-					"vhost-%d", current->pid);
+		dev->workers = kcalloc(dev->nvqs, sizeof(*dev->workers),
+				       GFP_KERNEL_ACCOUNT);
+		if (!dev->workers) {
+			err = -ENOMEM;
+			goto err_worker;
+		}
+
+		worker = vhost_worker_create(dev, 0);
 		if (IS_ERR(worker)) {
 			err = PTR_ERR(worker);
-			goto err_worker;
+			goto err_cgroup;
 		}
 
+		dev->workers[0] = worker;
 		dev->worker = worker;
-		wake_up_process(worker); /* avoid contributing to loadavg */
-
-		err = vhost_attach_cgroups(dev);
-		if (err)
-			goto err_cgroup;
+		for (i = 0; i < dev->nvqs; ++i)
+			dev->vqs[i]->worker = worker;
 	}
 
 	err = vhost_dev_alloc_iovecs(dev);
@@ -616,10 +763,7 @@ long vhost_dev_set_owner(struct vhost_dev *dev)
 
 	return 0;
 err_cgroup:
-	if (dev->worker) {
-		kthread_stop(dev->worker);
-		dev->worker = NULL;
-	}
+	vhost_dev_free_workers(dev);
 err_worker:
 	vhost_detach_mm(dev);
 	dev->kcov_handle = 0;
@@ -712,10 +856,8 @@ void vhost_dev_cleanup(struct vhost_dev *dev)
 	dev->iotlb = NULL;
 	vhost_clear_msg(dev);
 	wake_up_interruptible_poll(&dev->wait, EPOLLIN | EPOLLRDNORM);
-	WARN_ON(!llist_empty(&dev->work_list));
-	if (dev->worker) {
-		kthread_stop(dev->worker);
-		dev->worker = NULL;
+	if (dev->workers) {
+		vhost_dev_free_workers(dev);
 		dev->kcov_handle = 0;
 	}
 	vhost_detach_mm(dev);
@@ -1028,6 +1170,37 @@ static inline int vhost_get_avail_head(struct vhost_virtqueue *vq,
 			       &vq->avail->ring[idx & (vq->num - 1)]);
 }
 
+/* Read the avail ring entries from @idx up to vq->avail_idx (at most
+ * VHOST_AVAIL_HEADS, and not past the end of the ring) in one go. */
+static int vhost_fetch_avail_heads(struct vhost_virtqueue *vq, u16 idx)
+{
+	unsigned int slot = idx & (vq->num - 1);
+	unsigned int n = min3((unsigned int)(u16)(vq->avail_idx - idx),
+			      (unsigned int)VHOST_AVAIL_HEADS, vq->num - slot);
+	void __user *from = &vq->avail->ring[slot];
+	size_t size = n * sizeof(*vq->avail_heads);
+
+	vq->avail_heads_num = 0;
+	if (vq->iotlb) {
+		from = vhost_vq_meta_fetch(vq, (u64)(uintptr_t)from, size,
+					   VHOST_ADDR_AVAIL);
+		/* Not prefetched: one at a time through the IOTLB */
+		if (!from) {
+			n = 1;
+			if (vhost_get_avail_head(vq, vq->avail_heads, idx))
+				return -EFAULT;
+			goto out;
+		}
+	}
+
+	if (__copy_from_user(vq->avail_heads, from, size))
+		return -EFAULT;
+out:
+	vq->avail_heads_idx = idx;
+	vq->avail_heads_num = n;
+	return 0;
+}
+
 static inline int vhost_get_avail_flags(struct vhost_virtqueue *vq,
 					__virtio16 *flags)
 {
@@ -1470,6 +1643,7 @@ static long vhost_set_memory(struct vhost_dev *d, struct vhost_memory __user *m)
 	for (i = 0; i < d->nvqs; ++i) {
 		mutex_lock(&d->vqs[i]->mutex);
 		d->vqs[i]->umem = newumem;
+		__vhost_vq_meta_reset(d->vqs[i]);
 		mutex_unlock(&d->vqs[i]->mutex);
 	}
 
@@ -1634,6 +1808,13 @@ long vhost_vring_ioctl(struct vhost_dev *d, unsigned int ioctl, void __user *arg
 		if (copy_to_user(argp, &s, sizeof s))
 			r = -EFAULT;
 		break;
+	case VHOST_SET_VRING_WORKER:
+		if (copy_from_user(&s, argp, sizeof s)) {
+			r = -EFAULT;
+			break;
+		}
+		r = vhost_vq_set_worker(d, vq, s.num);
+		break;
 	case VHOST_SET_VRING_KICK:
 		if (copy_from_user(&f, argp, sizeof f)) {
 			r = -EFAULT;
@@ -2009,6 +2190,7 @@ int vhost_vq_init_access(struct vhost_virtqueue *vq)
 		return 0;
 
 	vhost_init_is_le(vq);
+	vq->avail_heads_num = 0;
 
 	r = vhost_update_used_flags(vq);
 	if (r)
@@ -2051,7 +2233,11 @@ static int translate_desc(struct vhost_virtqueue *vq, u64 addr, u32 len,
 			break;
 		}
 
-		map = vhost_iotlb_itree_first(umem, addr, addr + len - 1);
+		/* Buffers tend to come from the same region as the last one */
+		map = vq->desc_map;
+		if (!map || map->start > addr || map->last < addr)
+			map = vhost_iotlb_itree_first(umem, addr,
+						      addr + len - 1);
 		if (map == NULL || map->start > addr) {
 			if (umem != dev->iotlb) {
 				ret = -EFAULT;
@@ -2064,6 +2250,7 @@ static int translate_desc(struct vhost_virtqueue *vq, u64 addr, u32 len,
 			break;
 		}
 
+		vq->desc_map = map;
 		_iov = iov + ret;
 		size = map->size - addr + map->start;
 		_iov->iov_len = min((u64)len - s, size);
@@ -2239,12 +2426,16 @@ int vhost_get_vq_desc(struct vhost_virtqueue *vq,
 
 	/* Grab the next descriptor number they're advertising, and increment
 	 * the index we've seen. */
-	if (unlikely(vhost_get_avail_head(vq, &ring_head, last_avail_idx))) {
+	if ((u16)(last_avail_idx - vq->avail_heads_idx) >=
+	    vq->avail_heads_num &&
+	    unlikely(vhost_fetch_avail_heads(vq, last_avail_idx))) {
 		vq_err(vq, "Failed to read head: idx %d address %p\n",
 		       last_avail_idx,
 		       &vq->avail->ring[last_avail_idx % vq->num]);
 		return -EFAULT;
 	}
+	ring_head = vq->avail_heads[(u16)(last_avail_idx -
+					  vq->avail_heads_idx)];
 
 	head = vhost16_to_cpu(vq, ring_head);
 
@@ -21,6 +21,7 @@
 #include <linux/magic.h>
 #include <linux/pseudo_fs.h>
 #include <linux/page_reporting.h>
+#include <linux/sizes.h>
 
 /*
  * Balloon device works in 4K page units.  So each page is pointed to by
@@ -28,7 +29,15 @@
  * page units.
  */
 #define VIRTIO_BALLOON_PAGES_PER_PAGE (unsigned)(PAGE_SIZE >> VIRTIO_BALLOON_PFN_SHIFT)
-#define VIRTIO_BALLOON_ARRAY_PFNS_MAX 256
+#define VIRTIO_BALLOON_ARRAY_PFNS_MAX 4096
+/*
+ * Inflate in physically contiguous chunks of this order where possible, so
+ * that the host gets whole huge pages and doesn't have to split the THP
+ * backing the guest. Free page reporting uses the same granularity.
+ */
+#define VIRTIO_BALLOON_HUGE_ORDER \
+	min_t(unsigned int, pageblock_order, ilog2(SZ_2M >> PAGE_SHIFT))
+#define VIRTIO_BALLOON_HUGE_PAGES (1U << VIRTIO_BALLOON_HUGE_ORDER)
 /* Maximum number of (4k) pages to deflate on OOM notifications. */
 #define VIRTIO_BALLOON_OOM_NR_PAGES 256
 #define VIRTIO_BALLOON_OOM_NOTIFY_PRIORITY 80
@@ -208,20 +217,54 @@ static void set_page_pfns(struct virtio_balloon *vb,
 					  page_to_balloon_pfn(page) + i);
 }
 
+/*
+ * Allocate VIRTIO_BALLOON_HUGE_PAGES contiguous pages and push them as
+ * individual pages, lowest pfn on top, so that balloon compaction can still
+ * migrate them one by one.
+ */
+static bool balloon_huge_page_push(struct list_head *pages)
+{
+	struct page *page;
+	int i;
+
+	page = alloc_pages(balloon_mapping_gfp_mask() | __GFP_NOMEMALLOC |
+			   __GFP_NORETRY | __GFP_NOWARN,
+			   VIRTIO_BALLOON_HUGE_ORDER);
+	if (!page)
+		return false;
+
+	split_page(page, VIRTIO_BALLOON_HUGE_ORDER);
+	for (i = VIRTIO_BALLOON_HUGE_PAGES - 1; i >= 0; i--)
+		balloon_page_push(pages, page + i);
+	return true;
+}
+
 static unsigned fill_balloon(struct virtio_balloon *vb, size_t num)
 {
+	const unsigned int huge = VIRTIO_BALLOON_HUGE_PAGES *
+				  VIRTIO_BALLOON_PAGES_PER_PAGE;
 	unsigned num_allocated_pages;
 	unsigned num_pfns;
+	bool try_huge = true;
 	struct page *page;
 	LIST_HEAD(pages);
 
 	/* We can only do one array worth at a time. */
 	num = min(num, ARRAY_SIZE(vb->pfns));
 
-	for (num_pfns = 0; num_pfns < num;
-	     num_pfns += VIRTIO_BALLOON_PAGES_PER_PAGE) {
-		struct page *page = balloon_page_alloc();
+	for (num_pfns = 0; num_pfns < num; ) {
+		struct page *page;
 
+		if (try_huge && num - num_pfns >= huge) {
+			if (balloon_huge_page_push(&pages)) {
+				num_pfns += huge;
+				continue;
+			}
+			/* Too fragmented, stick to base pages for this round */
+			try_huge = false;
+		}
+
+		page = balloon_page_alloc();
 		if (!page) {
 			dev_info_ratelimited(&vb->vdev->dev,
 					     "Out of puff! Can't get %u pages\n",
@@ -232,6 +275,7 @@ static unsigned fill_balloon(struct virtio_balloon *vb, size_t num)
 		}
 
 		balloon_page_push(&pages, page);
+		num_pfns += VIRTIO_BALLOON_PAGES_PER_PAGE;
 	}
 
 	mutex_lock(&vb->balloon_lock);
@@ -998,17 +1042,15 @@ static int virtballoon_probe(struct virtio_device *vdev)
 		 * corresponds to 512MB in size on ARM64 when 64KB base page
 		 * size is used. The page reporting won't be triggered if the
 		 * freeing page can't come up with a free area like that huge.
-		 * So we specify the page reporting order to 5, corresponding
-		 * to 2MB. It helps to avoid THP splitting if 4KB base page
-		 * size is used by host.
+		 * So report at the granularity we inflate with, at most 2MB.
+		 * It helps to avoid THP splitting if 4KB base page size is
+		 * used by host.
 		 *
 		 * Ideally, the page reporting order is selected based on the
 		 * host's base page size. However, it needs more work to report
 		 * that value. The hard-coded order would be fine currently.
 		 */
-#if defined(CONFIG_ARM64) && defined(CONFIG_ARM64_64K_PAGES)
-		vb->pr_dev_info.order = 5;
-#endif
+		vb->pr_dev_info.order = VIRTIO_BALLOON_HUGE_ORDER;
 
 		err = page_reporting_register(&vb->pr_dev_info);
 		if (err)
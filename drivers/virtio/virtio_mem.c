@@ -1587,6 +1587,85 @@ static int virtio_mem_sbm_plug_and_add_mb(struct virtio_mem *vm,
 	return 0;
 }
 
+/*
+ * The largest number of @unit sized blocks a single plug request can cover.
+ */
+static uint64_t virtio_mem_max_plug_units(struct virtio_mem *vm, uint64_t unit)
+{
+	return max_t(uint64_t, 1,
+		     div64_u64((uint64_t)U16_MAX * vm->device_block_size,
+			       unit));
+}
+
+/*
+ * Prepare up to @max new, consecutive memory blocks that can be added.
+ * Returns the number of blocks prepared, the first one in @first_mb_id.
+ */
+static uint64_t virtio_mem_sbm_prepare_next_mbs(struct virtio_mem *vm,
+						uint64_t max,
+						unsigned long *first_mb_id)
+{
+	const uint64_t size = memory_block_size_bytes();
+	unsigned long mb_id;
+	uint64_t count;
+
+	for (count = 0; count < max; count++) {
+		if (!virtio_mem_could_add_memory(vm, (count + 1) * size))
+			break;
+		if (virtio_mem_sbm_prepare_next_mb(vm, &mb_id))
+			break;
+		if (!count)
+			*first_mb_id = mb_id;
+	}
+	return count;
+}
+
+/*
+ * Completely plug @count new, consecutive memory blocks starting at @mb_id
+ * with a single request and add them to Linux one after the other.
+ *
+ * Will modify the state of the memory blocks.
+ */
+static int virtio_mem_sbm_plug_and_add_mbs(struct virtio_mem *vm,
+					   unsigned long mb_id, uint64_t count,
+					   uint64_t *nb_sb)
+{
+	const uint64_t addr = virtio_mem_mb_id_to_phys(mb_id);
+	uint64_t i;
+	int rc;
+
+	rc = virtio_mem_send_plug_request(vm, addr,
+					  count * memory_block_size_bytes());
+	if (rc)
+		return rc;
+
+	for (i = 0; i < count; i++) {
+		virtio_mem_sbm_set_sb_plugged(vm, mb_id + i, 0,
+					      vm->sbm.sbs_per_mb);
+		virtio_mem_sbm_set_mb_state(vm, mb_id + i,
+					    VIRTIO_MEM_SBM_MB_OFFLINE);
+	}
+
+	for (i = 0; i < count; i++) {
+		rc = virtio_mem_sbm_add_mb(vm, mb_id + i);
+		if (rc)
+			break;
+		*nb_sb -= vm->sbm.sbs_per_mb;
+		cond_resched();
+	}
+
+	/* Unplug what we couldn't add, like virtio_mem_sbm_plug_and_add_mb() */
+	for (; i < count; i++) {
+		int new_state = VIRTIO_MEM_SBM_MB_UNUSED;
+
+		if (virtio_mem_sbm_unplug_sb(vm, mb_id + i, 0,
+					     vm->sbm.sbs_per_mb))
+			new_state = VIRTIO_MEM_SBM_MB_PLUGGED;
+		virtio_mem_sbm_set_mb_state(vm, mb_id + i, new_state);
+	}
+	return rc;
+}
+
 /*
  * Try to plug the desired number of subblocks of a memory block that
  * is already added to Linux.
@@ -1644,7 +1723,10 @@ static int virtio_mem_sbm_plug_request(struct virtio_mem *vm, uint64_t diff)
 		VIRTIO_MEM_SBM_MB_OFFLINE_PARTIAL,
 	};
 	uint64_t nb_sb = diff / vm->sbm.sb_size;
+	const uint64_t max = virtio_mem_max_plug_units(vm,
+						memory_block_size_bytes());
 	unsigned long mb_id;
+	uint64_t count;
 	int rc, i;
 
 	if (!nb_sb)
@@ -1679,8 +1761,21 @@ static int virtio_mem_sbm_plug_request(struct virtio_mem *vm, uint64_t diff)
 		cond_resched();
 	}
 
-	/* Try to prepare, plug and add new blocks */
+	/*
+	 * Try to prepare, plug and add new blocks. Blocks that get plugged
+	 * completely are requested from the device in batches.
+	 */
 	while (nb_sb) {
+		count = virtio_mem_sbm_prepare_next_mbs(vm,
+				min(nb_sb / vm->sbm.sbs_per_mb, max), &mb_id);
+		if (count) {
+			rc = virtio_mem_sbm_plug_and_add_mbs(vm, mb_id, count,
+							     &nb_sb);
+			if (rc)
+				return rc;
+			continue;
+		}
+
 		if (!virtio_mem_could_add_memory(vm, memory_block_size_bytes()))
 			return -ENOSPC;
 
@@ -1754,10 +1849,55 @@ static int virtio_mem_bbm_prepare_next_bb(struct virtio_mem *vm,
 	return 0;
 }
 
+/*
+ * Plug @count new, consecutive big blocks starting at @bb_id with a single
+ * request and add them to Linux one after the other.
+ *
+ * Will modify the state of the big blocks.
+ */
+static int virtio_mem_bbm_plug_and_add_bbs(struct virtio_mem *vm,
+					   unsigned long bb_id, uint64_t count,
+					   uint64_t *nb_bb)
+{
+	const uint64_t addr = virtio_mem_bb_id_to_phys(vm, bb_id);
+	uint64_t i;
+	int rc;
+
+	rc = virtio_mem_send_plug_request(vm, addr, count * vm->bbm.bb_size);
+	if (rc)
+		return rc;
+
+	for (i = 0; i < count; i++)
+		virtio_mem_bbm_set_bb_state(vm, bb_id + i,
+					    VIRTIO_MEM_BBM_BB_ADDED);
+
+	for (i = 0; i < count; i++) {
+		rc = virtio_mem_bbm_add_bb(vm, bb_id + i);
+		if (rc)
+			break;
+		(*nb_bb)--;
+		cond_resched();
+	}
+
+	/* Unplug what we couldn't add, like virtio_mem_bbm_plug_and_add_bb() */
+	for (; i < count; i++) {
+		if (!virtio_mem_bbm_unplug_bb(vm, bb_id + i))
+			virtio_mem_bbm_set_bb_state(vm, bb_id + i,
+						    VIRTIO_MEM_BBM_BB_UNUSED);
+		else
+			/* Retry from the main loop. */
+			virtio_mem_bbm_set_bb_state(vm, bb_id + i,
+						    VIRTIO_MEM_BBM_BB_PLUGGED);
+	}
+	return rc;
+}
+
 static int virtio_mem_bbm_plug_request(struct virtio_mem *vm, uint64_t diff)
 {
 	uint64_t nb_bb = diff / vm->bbm.bb_size;
-	unsigned long bb_id;
+	const uint64_t max = virtio_mem_max_plug_units(vm, vm->bbm.bb_size);
+	unsigned long bb_id, first_bb_id = 0;
+	uint64_t count;
 	int rc;
 
 	if (!nb_bb)
@@ -1776,20 +1916,26 @@ static int virtio_mem_bbm_plug_request(struct virtio_mem *vm, uint64_t diff)
 		cond_resched();
 	}
 
-	/* Try to prepare, plug and add new big blocks */
+	/* Try to prepare, plug and add new big blocks, in batches */
 	while (nb_bb) {
-		if (!virtio_mem_could_add_memory(vm, vm->bbm.bb_size))
-			return -ENOSPC;
-
-		rc = virtio_mem_bbm_prepare_next_bb(vm, &bb_id);
-		if (rc)
+		count = 0;
+		rc = -ENOSPC;
+		while (count < min(nb_bb, max) &&
+		       virtio_mem_could_add_memory(vm, (count + 1) *
+						   vm->bbm.bb_size)) {
+			rc = virtio_mem_bbm_prepare_next_bb(vm, &bb_id);
+			if (rc)
+				break;
+			if (!count++)
+				first_bb_id = bb_id;
+		}
+		if (!count)
 			return rc;
-		rc = virtio_mem_bbm_plug_and_add_bb(vm, bb_id);
-		if (!rc)
-			nb_bb--;
+
+		rc = virtio_mem_bbm_plug_and_add_bbs(vm, first_bb_id, count,
+						     &nb_bb);
 		if (rc)
 			return rc;
-		cond_resched();
 	}
 
 	return 0;
@@ -2155,6 +2301,31 @@ static bool virtio_mem_bbm_bb_is_movable(struct virtio_mem *vm,
 	return true;
 }
 
+/*
+ * Test if at least half of the pageblocks of an online big block are
+ * completely free, such that offlining it has little to migrate. Peeking
+ * at the buddy order without the zone lock is racy, but good enough to
+ * pick a candidate.
+ */
+static bool virtio_mem_bbm_bb_is_mostly_free(struct virtio_mem *vm,
+					     unsigned long bb_id)
+{
+	const unsigned long start_pfn = PFN_DOWN(virtio_mem_bb_id_to_phys(vm, bb_id));
+	const unsigned long nr_pages = PFN_DOWN(vm->bbm.bb_size);
+	unsigned long pfn, nr_free = 0;
+	struct page *page;
+
+	for (pfn = start_pfn; pfn < start_pfn + nr_pages;
+	     pfn += pageblock_nr_pages) {
+		page = pfn_to_online_page(pfn);
+		if (page && PageBuddy(page) &&
+		    READ_ONCE(page_private(page)) >= pageblock_order)
+			nr_free++;
+	}
+
+	return nr_free * pageblock_nr_pages * 2 >= nr_pages;
+}
+
 static int virtio_mem_bbm_unplug_request(struct virtio_mem *vm, uint64_t diff)
 {
 	uint64_t nb_bb = diff / vm->bbm.bb_size;
@@ -2166,9 +2337,10 @@ static int virtio_mem_bbm_unplug_request(struct virtio_mem *vm, uint64_t diff)
 
 	/*
 	 * Try to unplug big blocks. Similar to SBM, start with offline
-	 * big blocks.
+	 * big blocks. Of the online ones, prefer movable big blocks that
+	 * are mostly free, as they are the cheapest to offline.
 	 */
-	for (i = 0; i < 3; i++) {
+	for (i = 0; i < 4; i++) {
 		virtio_mem_bbm_for_each_bb_rev(vm, bb_id, VIRTIO_MEM_BBM_BB_ADDED) {
 			cond_resched();
 
@@ -2178,7 +2350,11 @@ static int virtio_mem_bbm_unplug_request(struct virtio_mem *vm, uint64_t diff)
 			 */
 			if (i == 0 && !virtio_mem_bbm_bb_is_offline(vm, bb_id))
 				continue;
-			if (i == 1 && !virtio_mem_bbm_bb_is_movable(vm, bb_id))
+			if ((i == 1 || i == 2) &&
+			    !virtio_mem_bbm_bb_is_movable(vm, bb_id))
+				continue;
+			if (i == 1 &&
+			    !virtio_mem_bbm_bb_is_mostly_free(vm, bb_id))
 				continue;
 			rc = virtio_mem_bbm_offline_remove_and_unplug_bb(vm, bb_id);
 			if (rc == -EBUSY)
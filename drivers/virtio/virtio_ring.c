@@ -69,6 +69,7 @@
 struct vring_desc_state_split {
 	void *data;			/* Data for callback. */
 	struct vring_desc *indir_desc;	/* Indirect descriptor, if any. */
+	u32 in_len;			/* Device writable length. */
 };
 
 struct vring_desc_state_packed {
@@ -106,6 +107,15 @@ struct vring_virtqueue {
 	/* Host publishes avail event idx */
 	bool event;
 
+	/* Host uses buffers in the order they were made available */
+	bool in_order;
+
+	/* Driver maps and unmaps the buffers itself */
+	bool premapped;
+
+	/* Between virtqueue_add_batch_begin() and _end() */
+	bool batch_add;
+
 	/* Head of free buffer list. */
 	unsigned int free_head;
 	/* Number we've added since last sync. */
@@ -136,6 +146,16 @@ struct vring_virtqueue {
 			struct vring_desc_state_split *desc_state;
 			struct vring_desc_extra *desc_extra;
 
+			/*
+			 * In order: last used entry read, which may stand
+			 * for several buffers.  id is UINT_MAX once they
+			 * have all been returned.
+			 */
+			struct {
+				unsigned int id;
+				u32 len;
+			} batch_last;
+
 			/* DMA address and size information */
 			dma_addr_t queue_dma_addr;
 			size_t queue_size_in_bytes;
@@ -169,6 +189,11 @@ struct vring_virtqueue {
 			 */
 			u16 event_flags_shadow;
 
+			/* First head of the current batch, not yet exposed. */
+			bool batch_head_pending;
+			u16 batch_head;
+			__le16 batch_head_flags;
+
 			/* Per-descriptor state. */
 			struct vring_desc_state_packed *desc_state;
 			struct vring_desc_extra *desc_extra;
@@ -334,6 +359,9 @@ static dma_addr_t vring_map_one_sg(const struct vring_virtqueue *vq,
 	if (!vq->use_dma_api)
 		return (dma_addr_t)sg_phys(sg);
 
+	if (vq->premapped)
+		return sg_dma_address(sg);
+
 	/*
 	 * We can't use dma_map_sg, because we don't use scatterlists in
 	 * the way it expects (we don't guarantee that the scatterlist
@@ -374,7 +402,8 @@ static void vring_unmap_one_split_indirect(const struct vring_virtqueue *vq,
 {
 	u16 flags;
 
-	if (!vq->use_dma_api)
+	/* Only buffers live in an indirect table */
+	if (!vq->use_dma_api || vq->premapped)
 		return;
 
 	flags = virtio16_to_cpu(vq->vq.vdev, desc->flags);
@@ -411,7 +440,7 @@ static unsigned int vring_unmap_one_split(const struct vring_virtqueue *vq,
 				 extra[i].len,
 				 (flags & VRING_DESC_F_WRITE) ?
 				 DMA_FROM_DEVICE : DMA_TO_DEVICE);
-	} else {
+	} else if (!vq->premapped) {
 		dma_unmap_page(vring_dma_dev(vq),
 			       extra[i].addr,
 			       extra[i].len,
@@ -488,6 +517,7 @@ static inline int virtqueue_add_split(struct virtqueue *_vq,
 	struct scatterlist *sg;
 	struct vring_desc *desc;
 	unsigned int i, n, avail, descs_used, prev, err_idx;
+	u32 in_len = 0;
 	int head;
 	bool indirect;
 
@@ -571,6 +601,7 @@ static inline int virtqueue_add_split(struct virtqueue *_vq,
 						     VRING_DESC_F_NEXT |
 						     VRING_DESC_F_WRITE,
 						     indirect);
+			in_len += sg->length;
 		}
 	}
 	/* Last one doesn't continue. */
@@ -609,6 +640,7 @@ static inline int virtqueue_add_split(struct virtqueue *_vq,
 		vq->split.desc_state[head].indir_desc = desc;
 	else
 		vq->split.desc_state[head].indir_desc = ctx;
+	vq->split.desc_state[head].in_len = in_len;
 
 	/* Put entry in available array (but don't update avail->idx until they
 	 * do sync). */
@@ -616,11 +648,14 @@ static inline int virtqueue_add_split(struct virtqueue *_vq,
 	vq->split.vring.avail->ring[avail] = cpu_to_virtio16(_vq->vdev, head);
 
 	/* Descriptors and available array need to be set before we expose the
-	 * new available array entries. */
-	virtio_wmb(vq->weak_barriers);
+	 * new available array entries.  In a batch that is done once, at the
+	 * end of it. */
 	vq->split.avail_idx_shadow++;
-	vq->split.vring.avail->idx = cpu_to_virtio16(_vq->vdev,
+	if (!vq->batch_add) {
+		virtio_wmb(vq->weak_barriers);
+		vq->split.vring.avail->idx = cpu_to_virtio16(_vq->vdev,
 						vq->split.avail_idx_shadow);
+	}
 	vq->num_added++;
 
 	pr_debug("Added buffer head %i to %p\n", head, vq);
@@ -708,8 +743,14 @@ static void detach_buf_split(struct vring_virtqueue *vq, unsigned int head,
 	}
 
 	vring_unmap_one_split(vq, i);
-	vq->split.desc_extra[i].next = vq->free_head;
-	vq->free_head = head;
+	/*
+	 * In order, descriptors come back in the order they were handed out
+	 * and the free ones stay a contiguous run starting at free_head.
+	 */
+	if (!vq->in_order) {
+		vq->split.desc_extra[i].next = vq->free_head;
+		vq->free_head = head;
+	}
 
 	/* Plus final descriptor */
 	vq->vq.num_free++;
@@ -741,32 +782,80 @@ static void detach_buf_split(struct vring_virtqueue *vq, unsigned int head,
 
 static inline bool more_used_split(const struct vring_virtqueue *vq)
 {
-	return vq->last_used_idx != virtio16_to_cpu(vq->vq.vdev,
+	return vq->split.batch_last.id != UINT_MAX ||
+	       vq->last_used_idx != virtio16_to_cpu(vq->vq.vdev,
 			vq->split.vring.used->idx);
 }
 
-static void *virtqueue_get_buf_ctx_split(struct virtqueue *_vq,
-					 unsigned int *len,
-					 void **ctx)
+/*
+ * With VIRTIO_F_IN_ORDER the device may write a single used entry for a
+ * batch of buffers, naming the last of them.  Buffers are handed back
+ * from the oldest one in flight until that one is reached, so the used
+ * ring is only read once per batch.  The buffers before it are reported
+ * as filled up to their writable length.
+ */
+static void *detach_used_split_in_order(struct vring_virtqueue *vq,
+					unsigned int *len, void **ctx)
 {
-	struct vring_virtqueue *vq = to_vvq(_vq);
-	void *ret;
+	unsigned int num = vq->split.vring.num;
 	unsigned int i;
 	u16 last_used;
+	void *ret;
 
-	START_USE(vq);
+	if (vq->split.batch_last.id == UINT_MAX) {
+		/* Only get used array entries after they have been exposed
+		 * by host. */
+		virtio_rmb(vq->weak_barriers);
 
-	if (unlikely(vq->broken)) {
-		END_USE(vq);
+		last_used = vq->last_used_idx & (num - 1);
+		i = virtio32_to_cpu(vq->vq.vdev,
+				vq->split.vring.used->ring[last_used].id);
+		if (unlikely(i >= num)) {
+			BAD_RING(vq, "id %u out of range\n", i);
+			return NULL;
+		}
+		vq->split.batch_last.id = i;
+		vq->split.batch_last.len = virtio32_to_cpu(vq->vq.vdev,
+				vq->split.vring.used->ring[last_used].len);
+		vq->last_used_idx++;
+	}
+
+	/* The oldest buffer in flight follows the free descriptors */
+	i = (vq->free_head + vq->vq.num_free) & (num - 1);
+	if (unlikely(!vq->split.desc_state[i].data)) {
+		BAD_RING(vq, "id %u is not a head!\n",
+			 vq->split.batch_last.id);
 		return NULL;
 	}
 
+	if (i == vq->split.batch_last.id) {
+		*len = vq->split.batch_last.len;
+		vq->split.batch_last.id = UINT_MAX;
+	} else {
+		*len = vq->split.desc_state[i].in_len;
+	}
+
+	/* detach_buf_split clears data, so grab it now. */
+	ret = vq->split.desc_state[i].data;
+	detach_buf_split(vq, i, ctx);
+	return ret;
+}
+
+static void *detach_used_split(struct vring_virtqueue *vq, unsigned int *len,
+			       void **ctx)
+{
+	void *ret;
+	unsigned int i;
+	u16 last_used;
+
 	if (!more_used_split(vq)) {
 		pr_debug("No more buffers in queue\n");
-		END_USE(vq);
 		return NULL;
 	}
 
+	if (vq->in_order)
+		return detach_used_split_in_order(vq, len, ctx);
+
 	/* Only get used array entries after they have been exposed by host. */
 	virtio_rmb(vq->weak_barriers);
 
@@ -789,20 +878,71 @@ static void *virtqueue_get_buf_ctx_split(struct virtqueue *_vq,
 	ret = vq->split.desc_state[i].data;
 	detach_buf_split(vq, i, ctx);
 	vq->last_used_idx++;
+	return ret;
+}
+
+static void update_used_event_split(struct vring_virtqueue *vq)
+{
 	/* If we expect an interrupt for the next entry, tell host
 	 * by writing event index and flush out the write before
 	 * the read in the next get_buf call. */
 	if (!(vq->split.avail_flags_shadow & VRING_AVAIL_F_NO_INTERRUPT))
 		virtio_store_mb(vq->weak_barriers,
 				&vring_used_event(&vq->split.vring),
-				cpu_to_virtio16(_vq->vdev, vq->last_used_idx));
+				cpu_to_virtio16(vq->vq.vdev,
+						vq->last_used_idx));
+}
 
-	LAST_ADD_TIME_INVALID(vq);
+static void *virtqueue_get_buf_ctx_split(struct virtqueue *_vq,
+					 unsigned int *len,
+					 void **ctx)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+	void *ret;
+
+	START_USE(vq);
+
+	if (unlikely(vq->broken)) {
+		END_USE(vq);
+		return NULL;
+	}
+
+	ret = detach_used_split(vq, len, ctx);
+	if (ret) {
+		update_used_event_split(vq);
+		LAST_ADD_TIME_INVALID(vq);
+	}
 
 	END_USE(vq);
 	return ret;
 }
 
+static unsigned int virtqueue_get_bufs_split(struct virtqueue *_vq,
+					     void **bufs, unsigned int *lens,
+					     unsigned int max)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+	unsigned int n = 0;
+
+	START_USE(vq);
+
+	if (unlikely(vq->broken)) {
+		END_USE(vq);
+		return 0;
+	}
+
+	while (n < max && (bufs[n] = detach_used_split(vq, &lens[n], NULL)))
+		n++;
+
+	if (n) {
+		update_used_event_split(vq);
+		LAST_ADD_TIME_INVALID(vq);
+	}
+
+	END_USE(vq);
+	return n;
+}
+
 static void virtqueue_disable_cb_split(struct virtqueue *_vq)
 {
 	struct vring_virtqueue *vq = to_vvq(_vq);
@@ -848,6 +988,10 @@ static bool virtqueue_poll_split(struct virtqueue *_vq, unsigned last_used_idx)
 {
 	struct vring_virtqueue *vq = to_vvq(_vq);
 
+	/* The rest of an in order batch is still to be returned */
+	if (vq->split.batch_last.id != UINT_MAX)
+		return true;
+
 	return (u16)last_used_idx != virtio16_to_cpu(_vq->vdev,
 			vq->split.vring.used->idx);
 }
@@ -878,7 +1022,8 @@ static bool virtqueue_enable_cb_delayed_split(struct virtqueue *_vq)
 			&vring_used_event(&vq->split.vring),
 			cpu_to_virtio16(_vq->vdev, vq->last_used_idx + bufs));
 
-	if (unlikely((u16)(virtio16_to_cpu(_vq->vdev, vq->split.vring.used->idx)
+	if (unlikely(vq->split.batch_last.id != UINT_MAX ||
+		     (u16)(virtio16_to_cpu(_vq->vdev, vq->split.vring.used->idx)
 					- vq->last_used_idx) > bufs)) {
 		END_USE(vq);
 		return false;
@@ -999,7 +1144,7 @@ static void vring_unmap_state_packed(const struct vring_virtqueue *vq,
 				 state->addr, state->len,
 				 (flags & VRING_DESC_F_WRITE) ?
 				 DMA_FROM_DEVICE : DMA_TO_DEVICE);
-	} else {
+	} else if (!vq->premapped) {
 		dma_unmap_page(vring_dma_dev(vq),
 			       state->addr, state->len,
 			       (flags & VRING_DESC_F_WRITE) ?
@@ -1012,7 +1157,8 @@ static void vring_unmap_desc_packed(const struct vring_virtqueue *vq,
 {
 	u16 flags;
 
-	if (!vq->use_dma_api)
+	/* Only buffers live in an indirect table */
+	if (!vq->use_dma_api || vq->premapped)
 		return;
 
 	flags = le16_to_cpu(desc->flags);
@@ -1032,6 +1178,35 @@ static void vring_unmap_desc_packed(const struct vring_virtqueue *vq,
 	}
 }
 
+/*
+ * Make the buffer starting at @head available.  In a batch only the
+ * first head is held back: the device doesn't look past a descriptor
+ * that isn't available yet, so the later ones can be written without a
+ * barrier and are exposed along with it at the end of the batch.
+ */
+static void virtqueue_expose_head_packed(struct vring_virtqueue *vq,
+					 u16 head, __le16 flags)
+{
+	if (vq->batch_add) {
+		if (vq->packed.batch_head_pending) {
+			vq->packed.vring.desc[head].flags = flags;
+		} else {
+			vq->packed.batch_head = head;
+			vq->packed.batch_head_flags = flags;
+			vq->packed.batch_head_pending = true;
+		}
+		return;
+	}
+
+	/*
+	 * A driver MUST NOT make the first descriptor in the list
+	 * available before all subsequent descriptors comprising
+	 * the list are made available.
+	 */
+	virtio_wmb(vq->weak_barriers);
+	vq->packed.vring.desc[head].flags = flags;
+}
+
 static struct vring_packed_desc *alloc_indirect_packed(unsigned int total_sg,
 						       gfp_t gfp)
 {
@@ -1112,14 +1287,9 @@ static int virtqueue_add_indirect_packed(struct vring_virtqueue *vq,
 						  vq->packed.avail_used_flags;
 	}
 
-	/*
-	 * A driver MUST NOT make the first descriptor in the list
-	 * available before all subsequent descriptors comprising
-	 * the list are made available.
-	 */
-	virtio_wmb(vq->weak_barriers);
-	vq->packed.vring.desc[head].flags = cpu_to_le16(VRING_DESC_F_INDIRECT |
-						vq->packed.avail_used_flags);
+	virtqueue_expose_head_packed(vq, head,
+				     cpu_to_le16(VRING_DESC_F_INDIRECT |
+						 vq->packed.avail_used_flags));
 
 	/* We're using some buffers from the free list. */
 	vq->vq.num_free -= 1;
@@ -1269,13 +1439,7 @@ static inline int virtqueue_add_packed(struct virtqueue *_vq,
 	vq->packed.desc_state[id].indir_desc = ctx;
 	vq->packed.desc_state[id].last = prev;
 
-	/*
-	 * A driver MUST NOT make the first descriptor in the list
-	 * available before all subsequent descriptors comprising
-	 * the list are made available.
-	 */
-	virtio_wmb(vq->weak_barriers);
-	vq->packed.vring.desc[head].flags = head_flags;
+	virtqueue_expose_head_packed(vq, head, head_flags);
 	vq->num_added += descs_used;
 
 	pr_debug("Added buffer head %i to %p\n", head, vq);
@@ -1419,24 +1583,14 @@ static inline bool more_used_packed(const struct vring_virtqueue *vq)
 			vq->packed.used_wrap_counter);
 }
 
-static void *virtqueue_get_buf_ctx_packed(struct virtqueue *_vq,
-					  unsigned int *len,
-					  void **ctx)
+static void *detach_used_packed(struct vring_virtqueue *vq, unsigned int *len,
+				void **ctx)
 {
-	struct vring_virtqueue *vq = to_vvq(_vq);
 	u16 last_used, id;
 	void *ret;
 
-	START_USE(vq);
-
-	if (unlikely(vq->broken)) {
-		END_USE(vq);
-		return NULL;
-	}
-
 	if (!more_used_packed(vq)) {
 		pr_debug("No more buffers in queue\n");
-		END_USE(vq);
 		return NULL;
 	}
 
@@ -1466,6 +1620,11 @@ static void *virtqueue_get_buf_ctx_packed(struct virtqueue *_vq,
 		vq->packed.used_wrap_counter ^= 1;
 	}
 
+	return ret;
+}
+
+static void update_used_event_packed(struct vring_virtqueue *vq)
+{
 	/*
 	 * If we expect an interrupt for the next entry, tell host
 	 * by writing event index and flush out the write before
@@ -1477,13 +1636,58 @@ static void *virtqueue_get_buf_ctx_packed(struct virtqueue *_vq,
 				cpu_to_le16(vq->last_used_idx |
 					(vq->packed.used_wrap_counter <<
 					 VRING_PACKED_EVENT_F_WRAP_CTR)));
+}
 
-	LAST_ADD_TIME_INVALID(vq);
+static void *virtqueue_get_buf_ctx_packed(struct virtqueue *_vq,
+					  unsigned int *len,
+					  void **ctx)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+	void *ret;
+
+	START_USE(vq);
+
+	if (unlikely(vq->broken)) {
+		END_USE(vq);
+		return NULL;
+	}
+
+	ret = detach_used_packed(vq, len, ctx);
+	if (ret) {
+		update_used_event_packed(vq);
+		LAST_ADD_TIME_INVALID(vq);
+	}
 
 	END_USE(vq);
 	return ret;
 }
 
+static unsigned int virtqueue_get_bufs_packed(struct virtqueue *_vq,
+					      void **bufs, unsigned int *lens,
+					      unsigned int max)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+	unsigned int n = 0;
+
+	START_USE(vq);
+
+	if (unlikely(vq->broken)) {
+		END_USE(vq);
+		return 0;
+	}
+
+	while (n < max && (bufs[n] = detach_used_packed(vq, &lens[n], NULL)))
+		n++;
+
+	if (n) {
+		update_used_event_packed(vq);
+		LAST_ADD_TIME_INVALID(vq);
+	}
+
+	END_USE(vq);
+	return n;
+}
+
 static void virtqueue_disable_cb_packed(struct virtqueue *_vq)
 {
 	struct vring_virtqueue *vq = to_vvq(_vq);
@@ -1703,6 +1907,9 @@ static struct virtqueue *vring_create_virtqueue_packed(
 	vq->num_added = 0;
 	vq->packed_ring = true;
 	vq->use_dma_api = vring_use_dma_api(vdev);
+	vq->premapped = false;
+	vq->batch_add = false;
+	vq->in_order = false;
 #ifdef DEBUG
 	vq->in_use = false;
 	vq->last_add_time_valid = false;
@@ -1728,6 +1935,7 @@ static struct virtqueue *vring_create_virtqueue_packed(
 	vq->packed.vring.device = device;
 
 	vq->packed.next_avail_idx = 0;
+	vq->packed.batch_head_pending = false;
 	vq->packed.avail_wrap_counter = 1;
 	vq->packed.used_wrap_counter = 1;
 	vq->packed.event_flags_shadow = 0;
@@ -1797,6 +2005,62 @@ static inline int virtqueue_add(struct virtqueue *_vq,
 					out_sgs, in_sgs, data, ctx, gfp);
 }
 
+/* Expose what was added in the current batch so far. */
+static void virtqueue_expose_batch(struct vring_virtqueue *vq)
+{
+	if (vq->packed_ring) {
+		if (!vq->packed.batch_head_pending)
+			return;
+		virtio_wmb(vq->weak_barriers);
+		vq->packed.vring.desc[vq->packed.batch_head].flags =
+			vq->packed.batch_head_flags;
+		vq->packed.batch_head_pending = false;
+	} else {
+		virtio_wmb(vq->weak_barriers);
+		vq->split.vring.avail->idx = cpu_to_virtio16(vq->vq.vdev,
+						vq->split.avail_idx_shadow);
+	}
+}
+
+/**
+ * virtqueue_add_batch_begin - start adding a batch of buffers
+ * @_vq: the struct virtqueue we're talking about.
+ *
+ * Buffers added with virtqueue_add_*() until virtqueue_add_batch_end()
+ * are exposed to the other side all at once, behind a single barrier,
+ * rather than one at a time.  virtqueue_kick_prepare() exposes what was
+ * added so far.
+ *
+ * Caller must ensure we don't call this with other virtqueue
+ * operations at the same time (except where noted).
+ */
+void virtqueue_add_batch_begin(struct virtqueue *_vq)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+
+	vq->batch_add = true;
+}
+EXPORT_SYMBOL_GPL(virtqueue_add_batch_begin);
+
+/**
+ * virtqueue_add_batch_end - expose a batch of buffers
+ * @_vq: the struct virtqueue we're talking about.
+ *
+ * Ends what virtqueue_add_batch_begin() started.  The other side still
+ * has to be kicked as usual.
+ *
+ * Caller must ensure we don't call this with other virtqueue
+ * operations at the same time (except where noted).
+ */
+void virtqueue_add_batch_end(struct virtqueue *_vq)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+
+	virtqueue_expose_batch(vq);
+	vq->batch_add = false;
+}
+EXPORT_SYMBOL_GPL(virtqueue_add_batch_end);
+
 /**
  * virtqueue_add_sgs - expose buffers to other end
  * @_vq: the struct virtqueue we're talking about.
@@ -1915,6 +2179,9 @@ bool virtqueue_kick_prepare(struct virtqueue *_vq)
 {
 	struct vring_virtqueue *vq = to_vvq(_vq);
 
+	if (vq->batch_add)
+		virtqueue_expose_batch(vq);
+
 	return vq->packed_ring ? virtqueue_kick_prepare_packed(_vq) :
 				 virtqueue_kick_prepare_split(_vq);
 }
@@ -1996,6 +2263,33 @@ void *virtqueue_get_buf(struct virtqueue *_vq, unsigned int *len)
 	return virtqueue_get_buf_ctx(_vq, len, NULL);
 }
 EXPORT_SYMBOL_GPL(virtqueue_get_buf);
+
+/**
+ * virtqueue_get_bufs - get a batch of used buffers
+ * @_vq: the struct virtqueue we're talking about.
+ * @bufs: where to store the "data" tokens handed to virtqueue_add_*().
+ * @lens: where to store the length written into each buffer.
+ * @max: the number of entries in @bufs and @lens.
+ *
+ * Like calling virtqueue_get_buf() up to @max times, except that the
+ * other side is told how far we got only once, at the end, instead of
+ * with a full memory barrier per buffer.
+ *
+ * Caller must ensure we don't call this with other virtqueue
+ * operations at the same time (except where noted).
+ *
+ * Returns the number of buffers stored in @bufs.
+ */
+unsigned int virtqueue_get_bufs(struct virtqueue *_vq, void **bufs,
+				unsigned int *lens, unsigned int max)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+
+	return vq->packed_ring ?
+		virtqueue_get_bufs_packed(_vq, bufs, lens, max) :
+		virtqueue_get_bufs_split(_vq, bufs, lens, max);
+}
+EXPORT_SYMBOL_GPL(virtqueue_get_bufs);
 /**
  * virtqueue_disable_cb - disable callbacks
  * @_vq: the struct virtqueue we're talking about.
@@ -2191,6 +2485,8 @@ struct virtqueue *__vring_new_virtqueue(unsigned int index,
 	vq->event_triggered = false;
 	vq->num_added = 0;
 	vq->use_dma_api = vring_use_dma_api(vdev);
+	vq->premapped = false;
+	vq->batch_add = false;
 #ifdef DEBUG
 	vq->in_use = false;
 	vq->last_add_time_valid = false;
@@ -2199,10 +2495,12 @@ struct virtqueue *__vring_new_virtqueue(unsigned int index,
 	vq->indirect = virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC) &&
 		!context;
 	vq->event = virtio_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX);
+	vq->in_order = virtio_has_feature(vdev, VIRTIO_F_IN_ORDER);
 
 	if (virtio_has_feature(vdev, VIRTIO_F_ORDER_PLATFORM))
 		vq->weak_barriers = false;
 
+	vq->split.batch_last.id = UINT_MAX;
 	vq->split.queue_dma_addr = 0;
 	vq->split.queue_size_in_bytes = 0;
 
@@ -2353,11 +2651,17 @@ void vring_transport_features(struct virtio_device *vdev)
 			break;
 		case VIRTIO_F_ORDER_PLATFORM:
 			break;
+		case VIRTIO_F_IN_ORDER:
+			break;
 		default:
 			/* We don't understand this bit. */
 			__virtio_clear_bit(vdev, i);
 		}
 	}
+
+	/* In order is only implemented for the split ring */
+	if (__virtio_test_bit(vdev, VIRTIO_F_RING_PACKED))
+		__virtio_clear_bit(vdev, VIRTIO_F_IN_ORDER);
 }
 EXPORT_SYMBOL_GPL(vring_transport_features);
 
@@ -2377,6 +2681,52 @@ unsigned int virtqueue_get_vring_size(struct virtqueue *_vq)
 }
 EXPORT_SYMBOL_GPL(virtqueue_get_vring_size);
 
+/**
+ * virtqueue_dma_dev - get the device to map buffers for
+ * @_vq: the struct virtqueue we're talking about.
+ *
+ * Returns the device drivers should map premapped buffers for, or NULL
+ * if the virtqueue doesn't use the DMA API.
+ */
+struct device *virtqueue_dma_dev(struct virtqueue *_vq)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+
+	return vq->use_dma_api ? vring_dma_dev(vq) : NULL;
+}
+EXPORT_SYMBOL_GPL(virtqueue_dma_dev);
+
+/**
+ * virtqueue_set_dma_premapped - let the driver do the DMA mapping
+ * @_vq: the struct virtqueue we're talking about.
+ *
+ * From now on the sg_dma_address() of the buffers passed to
+ * virtqueue_add_*() is used as is; the driver maps them for
+ * virtqueue_dma_dev() and unmaps them once they are used.  Can only be
+ * done on an empty virtqueue that uses the DMA API.
+ *
+ * Returns zero or -EINVAL.
+ */
+int virtqueue_set_dma_premapped(struct virtqueue *_vq)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+	unsigned int num;
+
+	START_USE(vq);
+
+	num = vq->packed_ring ? vq->packed.vring.num : vq->split.vring.num;
+	if (!vq->use_dma_api || vq->vq.num_free != num) {
+		END_USE(vq);
+		return -EINVAL;
+	}
+
+	vq->premapped = true;
+
+	END_USE(vq);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(virtqueue_set_dma_premapped);
+
 bool virtqueue_is_broken(struct virtqueue *_vq)
 {
 	struct vring_virtqueue *vq = to_vvq(_vq);
@@ -0,0 +1,226 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* Data-present map for cache files
+ *
+ * Each object carries a bitmap with one bit per CACHEFILES_GRAN_SIZE granule
+ * of the backing file.  A bit is only set once the whole granule (or all of
+ * it below the end of the file) has been written, so that the read path can
+ * tell what is in the cache without asking the backing filesystem with
+ * SEEK_DATA/SEEK_HOLE.  Whilst the object isn't in use, the map is kept in
+ * an xattr on the backing file.
+ *
+ * The map is stored as a little-endian bitmap so that the xattr doesn't
+ * depend on the word size or byte order of the machine that wrote it.
+ */
+
+#include <linux/fs.h>
+#include <linux/slab.h>
+#include <linux/xattr.h>
+#include "internal.h"
+
+static const char cachefiles_xattr_map[] =
+	XATTR_USER_PREFIX "CacheFiles.map";
+
+static size_t cachefiles_map_size(loff_t size)
+{
+	unsigned long granules;
+
+	granules = (size + CACHEFILES_GRAN_SIZE - 1) >> CACHEFILES_GRAN_SHIFT;
+	return min_t(size_t, round_up(DIV_ROUND_UP(granules, BITS_PER_BYTE),
+				      sizeof(unsigned long)),
+		     CACHEFILES_MAP_MAX);
+}
+
+/*
+ * Make sure the map covers [0, end).  This has to be done before a write is
+ * issued as the write completion may run in interrupt context.
+ */
+int cachefiles_expand_content_map(struct cachefiles_object *object, loff_t end)
+{
+	size_t size = cachefiles_map_size(end);
+	unsigned long flags;
+	void *map, *old;
+
+	if (size <= READ_ONCE(object->content_map_size))
+		return 0;
+
+	map = kzalloc(size, GFP_NOFS);
+	if (!map)
+		return -ENOMEM;
+
+	spin_lock_irqsave(&object->content_map_lock, flags);
+	old = object->content_map;
+	if (size > object->content_map_size) {
+		if (old)
+			memcpy(map, old, object->content_map_size);
+		object->content_map = map;
+		object->content_map_size = size;
+		map = old;
+	}
+	spin_unlock_irqrestore(&object->content_map_lock, flags);
+
+	kfree(map);
+	return 0;
+}
+
+/*
+ * Note that [start, start + len) has been written to the cache.  Only the
+ * granules this covers completely, or up to the end of the file, are marked.
+ */
+void cachefiles_mark_content_map(struct cachefiles_object *object,
+				 loff_t start, size_t len, loff_t i_size)
+{
+	loff_t end = start + len;
+	unsigned long granule, last, flags;
+
+	granule = (start + CACHEFILES_GRAN_SIZE - 1) >> CACHEFILES_GRAN_SHIFT;
+	if (end >= i_size)
+		last = (i_size + CACHEFILES_GRAN_SIZE - 1) >>
+			CACHEFILES_GRAN_SHIFT;
+	else
+		last = end >> CACHEFILES_GRAN_SHIFT;
+
+	spin_lock_irqsave(&object->content_map_lock, flags);
+	last = min_t(unsigned long, last,
+		     object->content_map_size * BITS_PER_BYTE);
+	for (; granule < last; granule++) {
+		if (!test_bit_le(granule, object->content_map)) {
+			__set_bit_le(granule, object->content_map);
+			object->content_map_changed = true;
+		}
+	}
+	spin_unlock_irqrestore(&object->content_map_lock, flags);
+}
+
+/*
+ * See whether the data at @start is in the cache and trim *_len down to the
+ * run of granules from @start that are all present or all absent.
+ */
+bool cachefiles_find_content(struct cachefiles_object *object,
+			     loff_t start, size_t *_len)
+{
+	unsigned long granule = start >> CACHEFILES_GRAN_SHIFT;
+	unsigned long nbits, next, flags;
+	bool present;
+	loff_t to;
+
+	spin_lock_irqsave(&object->content_map_lock, flags);
+	nbits = object->content_map_size * BITS_PER_BYTE;
+	if (granule >= nbits) {
+		spin_unlock_irqrestore(&object->content_map_lock, flags);
+		return false;
+	}
+
+	present = test_bit_le(granule, object->content_map);
+	if (present)
+		next = find_next_zero_bit_le(object->content_map, nbits,
+					     granule);
+	else
+		next = find_next_bit_le(object->content_map, nbits, granule);
+	spin_unlock_irqrestore(&object->content_map_lock, flags);
+
+	/* nothing further along the file is in the cache */
+	if (!present && next >= nbits)
+		return false;
+
+	to = (loff_t)next << CACHEFILES_GRAN_SHIFT;
+	if (to < start + *_len)
+		*_len = to - start;
+	return present;
+}
+
+/*
+ * Forget about everything from the granule containing @new_size onwards,
+ * including the partial granule at the new EOF.  The copy of the map in the
+ * xattr is removed as it may now claim data that's no longer there.  Must
+ * not be called with the backing inode locked.
+ */
+void cachefiles_shorten_content_map(struct cachefiles_object *object,
+				    loff_t new_size)
+{
+	unsigned long granule = new_size >> CACHEFILES_GRAN_SHIFT;
+	unsigned long nbits, flags;
+	int ret;
+
+	spin_lock_irqsave(&object->content_map_lock, flags);
+	nbits = object->content_map_size * BITS_PER_BYTE;
+	for (granule = find_next_bit_le(object->content_map, nbits, granule);
+	     granule < nbits;
+	     granule = find_next_bit_le(object->content_map, nbits,
+					granule + 1)) {
+		__clear_bit_le(granule, object->content_map);
+		object->content_map_changed = true;
+	}
+	spin_unlock_irqrestore(&object->content_map_lock, flags);
+
+	ret = vfs_removexattr(&init_user_ns, object->backer,
+			      cachefiles_xattr_map);
+	if (ret < 0 && ret != -ENODATA)
+		cachefiles_io_error_obj(object,
+					"Can't remove map xattr (err %d)",
+					ret);
+}
+
+/*
+ * Load the map from the backing file when the object is looked up.  A
+ * missing or unreadable map just means that nothing is known to be cached.
+ */
+void cachefiles_load_content_map(struct cachefiles_object *object)
+{
+	void *map;
+	ssize_t len;
+
+	if (object->new)
+		return;
+
+	map = kzalloc(CACHEFILES_MAP_MAX, GFP_KERNEL);
+	if (!map)
+		return;
+
+	len = vfs_getxattr(&init_user_ns, object->backer, cachefiles_xattr_map,
+			   map, CACHEFILES_MAP_MAX);
+	if (len <= 0) {
+		kfree(map);
+		return;
+	}
+
+	cachefiles_expand_content_map(object, (loff_t)len * BITS_PER_BYTE <<
+				      CACHEFILES_GRAN_SHIFT);
+	spin_lock_irq(&object->content_map_lock);
+	if (object->content_map_size >= len)
+		memcpy(object->content_map, map, len);
+	spin_unlock_irq(&object->content_map_lock);
+	kfree(map);
+}
+
+/*
+ * Write the map back to the backing file when the object is dropped.
+ */
+void cachefiles_save_content_map(struct cachefiles_object *object)
+{
+	struct inode *inode = d_backing_inode(object->backer);
+	size_t len;
+	int ret;
+
+	if (!object->content_map_changed)
+		return;
+	object->content_map_changed = false;
+
+	len = object->content_map_size;
+	while (len > 0 && !((u8 *)object->content_map)[len - 1])
+		len--;
+	if (!len) {
+		vfs_removexattr(&init_user_ns, object->backer,
+				cachefiles_xattr_map);
+		return;
+	}
+
+	/* The data must be stable before the map that advertises it is */
+	ret = sync_inode_metadata(inode, 1);
+	if (ret == 0)
+		ret = vfs_setxattr(&init_user_ns, object->backer,
+				   cachefiles_xattr_map, object->content_map,
+				   len, 0);
+	if (ret < 0)
+		vfs_removexattr(&init_user_ns, object->backer,
+				cachefiles_xattr_map);
+}
@@ -52,6 +52,9 @@ static struct fscache_object *cachefiles_alloc_object(
 	fscache_object_init(&object->fscache, cookie, &cache->cache);
 
 	object->type = cookie->def->type;
+	object->content_map = NULL;
+	object->content_map_size = 0;
+	object->content_map_changed = false;
 
 	/* get hold of the raw key
 	 * - stick the length on the front and leave space on the back for the
@@ -139,6 +142,9 @@ static int cachefiles_lookup_object(struct fscache_object *_object)
 	ret = cachefiles_walk_to_object(parent, object,
 					lookup_data->key,
 					lookup_data->auxdata);
+	if (ret == 0 &&
+	    object->fscache.cookie->def->type != FSCACHE_COOKIE_TYPE_INDEX)
+		cachefiles_load_content_map(object);
 	cachefiles_end_secure(cache, saved_cred);
 
 	/* polish off by setting the attributes of non-index files */
@@ -298,6 +304,10 @@ static void cachefiles_drop_object(struct fscache_object *_object)
 			cachefiles_begin_secure(cache, &saved_cred);
 			cachefiles_delete_object(cache, object);
 			cachefiles_end_secure(cache, saved_cred);
+		} else if (object->backer && d_is_reg(object->backer)) {
+			cachefiles_begin_secure(cache, &saved_cred);
+			cachefiles_save_content_map(object);
+			cachefiles_end_secure(cache, saved_cred);
 		}
 
 		/* close the filesystem stuff attached to the object */
@@ -361,6 +371,9 @@ void cachefiles_put_object(struct fscache_object *_object,
 			object->lookup_data = NULL;
 		}
 
+		kfree(object->content_map);
+		object->content_map = NULL;
+
 		cache = object->fscache.cache;
 		fscache_object_destroy(&object->fscache);
 		kmem_cache_free(cachefiles_object_jar, object);
@@ -461,6 +474,8 @@ static int cachefiles_attr_changed(struct fscache_object *_object)
 		return 0;
 
 	cachefiles_begin_secure(cache, &saved_cred);
+	/* the granule at the old EOF may have been complete only up to it */
+	cachefiles_shorten_content_map(object, min_t(loff_t, oi_size, ni_size));
 	inode_lock(d_inode(object->backer));
 
 	/* if there's an extension to a partial page at the end of the backing
@@ -523,6 +538,7 @@ static void cachefiles_invalidate_object(struct fscache_operation *op)
 		path.mnt = cache->mnt;
 
 		cachefiles_begin_secure(cache, &saved_cred);
+		cachefiles_shorten_content_map(object, 0);
 		ret = vfs_truncate(&path, 0);
 		if (ret == 0)
 			ret = vfs_truncate(&path, ni_size);
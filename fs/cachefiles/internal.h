@@ -29,6 +29,16 @@ extern unsigned cachefiles_debug;
 
 #define cachefiles_gfp (__GFP_RECLAIM | __GFP_NORETRY | __GFP_NOMEMALLOC)
 
+/*
+ * The content map tracks the backing file in granules of this size, and
+ * readahead is expanded to granule boundaries so that whole granules get
+ * downloaded and written to the cache.  The map (and thus the amount of a
+ * file that can be cached) is limited to what fits in an xattr.
+ */
+#define CACHEFILES_GRAN_SHIFT	18
+#define CACHEFILES_GRAN_SIZE	(1UL << CACHEFILES_GRAN_SHIFT)
+#define CACHEFILES_MAP_MAX	2048
+
 /*
  * node records
  */
@@ -45,6 +55,10 @@ struct cachefiles_object {
 	uint8_t				new;		/* T if object new */
 	spinlock_t			work_lock;
 	struct rb_node			active_node;	/* link in active tree (dentry is key) */
+	spinlock_t			content_map_lock;
+	void				*content_map;	/* granules present (LE bitmap) */
+	size_t				content_map_size; /* size of content_map in bytes */
+	bool				content_map_changed; /* T if map needs saving */
 };
 
 extern struct kmem_cache *cachefiles_object_jar;
@@ -137,6 +151,20 @@ static inline void cachefiles_state_changed(struct cachefiles_cache *cache)
 extern int cachefiles_daemon_bind(struct cachefiles_cache *cache, char *args);
 extern void cachefiles_daemon_unbind(struct cachefiles_cache *cache);
 
+/*
+ * content-map.c
+ */
+extern int cachefiles_expand_content_map(struct cachefiles_object *object,
+					 loff_t end);
+extern void cachefiles_mark_content_map(struct cachefiles_object *object,
+					loff_t start, size_t len, loff_t i_size);
+extern bool cachefiles_find_content(struct cachefiles_object *object,
+				    loff_t start, size_t *_len);
+extern void cachefiles_shorten_content_map(struct cachefiles_object *object,
+					   loff_t new_size);
+extern void cachefiles_load_content_map(struct cachefiles_object *object);
+extern void cachefiles_save_content_map(struct cachefiles_object *object);
+
 /*
  * daemon.c
  */
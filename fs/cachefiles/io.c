@@ -23,9 +23,18 @@ struct cachefiles_kiocb {
 	};
 	netfs_io_terminated_t	term_func;
 	void			*term_func_priv;
+	struct cachefiles_object *object;
 	bool			was_async;
 };
 
+static struct cachefiles_object *
+cachefiles_cres_object(struct netfs_cache_resources *cres)
+{
+	struct fscache_retrieval *op = cres->cache_priv;
+
+	return container_of(op->op.object, struct cachefiles_object, fscache);
+}
+
 static inline void cachefiles_put_kiocb(struct cachefiles_kiocb *ki)
 {
 	if (refcount_dec_and_test(&ki->ki_refcnt)) {
@@ -170,6 +179,10 @@ static void cachefiles_write_complete(struct kiocb *iocb, long ret, long ret2)
 	__sb_writers_acquired(inode->i_sb, SB_FREEZE_WRITE);
 	__sb_end_write(inode->i_sb, SB_FREEZE_WRITE);
 
+	if (ret > 0)
+		cachefiles_mark_content_map(ki->object, ki->start, ret,
+					    i_size_read(inode));
+
 	if (ki->term_func)
 		ki->term_func(ki->term_func_priv, ret, ki->was_async);
 
@@ -210,6 +223,7 @@ static int cachefiles_write(struct netfs_cache_resources *cres,
 	ki->len			= len;
 	ki->term_func		= term_func;
 	ki->term_func_priv	= term_func_priv;
+	ki->object		= cachefiles_cres_object(cres);
 	ki->was_async		= true;
 
 	if (ki->term_func)
@@ -261,72 +275,63 @@ static int cachefiles_write(struct netfs_cache_resources *cres,
 	return -ENOMEM;
 }
 
+/*
+ * Expand a readahead request to whole granules, so that what gets
+ * downloaded can be marked in the content map once it's been written to
+ * the cache.
+ */
+static void cachefiles_expand_readahead(struct netfs_cache_resources *cres,
+					loff_t *_start, size_t *_len,
+					loff_t i_size)
+{
+	loff_t start = *_start, end = *_start + *_len, eof;
+
+	eof = round_up(i_size, PAGE_SIZE);
+	start = round_down(start, CACHEFILES_GRAN_SIZE);
+	end = max(end, min_t(loff_t, round_up(end, CACHEFILES_GRAN_SIZE), eof));
+
+	*_start = start;
+	*_len = end - start;
+}
+
 /*
  * Prepare a read operation, shortening it to a cached/uncached
- * boundary as appropriate.
+ * boundary as appropriate.  What's cached is found from the content map
+ * rather than by probing the backing file.
  */
 static enum netfs_read_source cachefiles_prepare_read(struct netfs_read_subrequest *subreq,
 						      loff_t i_size)
 {
-	struct fscache_retrieval *op = subreq->rreq->cache_resources.cache_priv;
+	struct netfs_cache_resources *cres = &subreq->rreq->cache_resources;
 	struct cachefiles_object *object;
 	struct cachefiles_cache *cache;
-	const struct cred *saved_cred;
-	struct file *file = subreq->rreq->cache_resources.cache_priv2;
-	loff_t off, to;
+	struct file *file = cres->cache_priv2;
+	size_t len = subreq->len;
 
 	_enter("%zx @%llx/%llx", subreq->len, subreq->start, i_size);
 
-	object = container_of(op->op.object,
-			      struct cachefiles_object, fscache);
+	object = cachefiles_cres_object(cres);
 	cache = container_of(object->fscache.cache,
 			     struct cachefiles_cache, cache);
 
 	if (!file)
-		goto cache_fail_nosec;
+		goto cache_fail;
 
 	if (subreq->start >= i_size)
 		return NETFS_FILL_WITH_ZEROES;
 
-	cachefiles_begin_secure(cache, &saved_cred);
-
-	off = vfs_llseek(file, subreq->start, SEEK_DATA);
-	if (off < 0 && off >= (loff_t)-MAX_ERRNO) {
-		if (off == (loff_t)-ENXIO)
-			goto download_and_store;
-		goto cache_fail;
-	}
-
-	if (off >= subreq->start + subreq->len)
-		goto download_and_store;
-
-	if (off > subreq->start) {
-		off = round_up(off, cache->bsize);
-		subreq->len = off - subreq->start;
-		goto download_and_store;
+	if (cachefiles_find_content(object, subreq->start, &len)) {
+		/* A present granule at the EOF is only present up to it */
+		if (len < subreq->len && subreq->start + len > i_size)
+			len = round_up(i_size, cache->bsize) - subreq->start;
+		subreq->len = len;
+		return NETFS_READ_FROM_CACHE;
 	}
 
-	to = vfs_llseek(file, subreq->start, SEEK_HOLE);
-	if (to < 0 && to >= (loff_t)-MAX_ERRNO)
-		goto cache_fail;
-
-	if (to < subreq->start + subreq->len) {
-		if (subreq->start + subreq->len >= i_size)
-			to = round_up(to, cache->bsize);
-		else
-			to = round_down(to, cache->bsize);
-		subreq->len = to - subreq->start;
-	}
-
-	cachefiles_end_secure(cache, saved_cred);
-	return NETFS_READ_FROM_CACHE;
-
-download_and_store:
+	subreq->len = len;
 	if (cachefiles_has_space(cache, 0, (subreq->len + PAGE_SIZE - 1) / PAGE_SIZE) == 0)
 		__set_bit(NETFS_SREQ_WRITE_TO_CACHE, &subreq->flags);
 cache_fail:
-	cachefiles_end_secure(cache, saved_cred);
-cache_fail_nosec:
 	return NETFS_DOWNLOAD_FROM_SERVER;
 }
 
@@ -343,7 +348,10 @@ static int cachefiles_prepare_write(struct netfs_cache_resources *cres,
 	down = start - round_down(start, PAGE_SIZE);
 	*_start = start - down;
 	*_len = round_up(down + len, PAGE_SIZE);
-	return 0;
+
+	/* The completion can't allocate, so size the content map now */
+	return cachefiles_expand_content_map(cachefiles_cres_object(cres),
+					     *_start + *_len);
 }
 
 /*
@@ -370,6 +378,7 @@ static const struct netfs_cache_ops cachefiles_netfs_cache_ops = {
 	.end_operation		= cachefiles_end_operation,
 	.read			= cachefiles_read,
 	.write			= cachefiles_write,
+	.expand_readahead	= cachefiles_expand_readahead,
 	.prepare_read		= cachefiles_prepare_read,
 	.prepare_write		= cachefiles_prepare_write,
 };
@@ -1203,12 +1203,99 @@ static int ceph_unlink(struct inode *dir, struct dentry *dentry)
 	return err;
 }
 
+static void ceph_async_rename_cb(struct ceph_mds_client *mdsc,
+				 struct ceph_mds_request *req)
+{
+	int result = req->r_err ? req->r_err :
+			le32_to_cpu(req->r_reply_info.head->result);
+
+	if (result == -EJUKEBOX)
+		goto out;
+
+	/* If op failed, mark everyone involved for errors */
+	if (result) {
+		int pathlen = 0;
+		u64 base = 0;
+		char *path = ceph_mdsc_build_path(req->r_dentry, &pathlen,
+						  &base, 0);
+
+		/* mark error on parent + clear complete */
+		mapping_set_error(req->r_parent->i_mapping, result);
+		ceph_dir_clear_complete(req->r_parent);
+
+		/* drop both names -- we don't know which one is right */
+		if (!d_unhashed(req->r_dentry))
+			d_drop(req->r_dentry);
+		if (!d_unhashed(req->r_old_dentry))
+			d_drop(req->r_old_dentry);
+
+		/* mark inode itself for an error (since metadata is bogus) */
+		mapping_set_error(req->r_old_inode->i_mapping, result);
+
+		pr_warn("ceph: async rename failure path=(%llx)%s result=%d!\n",
+			base, IS_ERR(path) ? "<<bad>>" : path, result);
+		ceph_mdsc_free_path(path, pathlen);
+	}
+out:
+	iput(req->r_old_inode);
+	ceph_mdsc_release_dir_caps(req);
+}
+
+/*
+ * A rename within one directory is an unlink of the old name plus a create
+ * of the new one, so it can go async under the same conditions as those:
+ * Fx plus both Du and Dc on the directory, a primary source link and a
+ * target name that is known not to exist.
+ */
+static int get_caps_for_async_rename(struct inode *dir,
+				     struct dentry *old_dentry,
+				     struct dentry *new_dentry)
+{
+	struct ceph_inode_info *ci = ceph_inode(dir);
+	int got = 0, want = CEPH_CAP_FILE_EXCL | CEPH_CAP_DIR_UNLINK |
+			    CEPH_CAP_DIR_CREATE;
+	int gen;
+
+	if (d_is_dir(old_dentry) || d_really_is_positive(new_dentry))
+		return 0;
+
+	spin_lock(&ci->i_ceph_lock);
+	if ((__ceph_caps_issued(ci, NULL) & want) == want) {
+		ceph_take_cap_refs(ci, want, false);
+		got = want;
+	}
+	gen = atomic_read(&ci->i_shared_gen);
+	spin_unlock(&ci->i_ceph_lock);
+
+	if (!got)
+		return 0;
+
+	spin_lock(&old_dentry->d_lock);
+	if (gen != ceph_dentry(old_dentry)->lease_shared_gen ||
+	    !(ceph_dentry(old_dentry)->flags & CEPH_DENTRY_PRIMARY_LINK))
+		want = 0;
+	spin_unlock(&old_dentry->d_lock);
+
+	if (gen != READ_ONCE(ceph_dentry(new_dentry)->lease_shared_gen))
+		want = 0;
+
+	/* Do we still want what we've got? */
+	if (want == got)
+		return got;
+
+	ceph_put_cap_refs(ci, got);
+	return 0;
+}
+
 static int ceph_rename(struct user_namespace *mnt_userns, struct inode *old_dir,
 		       struct dentry *old_dentry, struct inode *new_dir,
 		       struct dentry *new_dentry, unsigned int flags)
 {
-	struct ceph_mds_client *mdsc = ceph_sb_to_mdsc(old_dir->i_sb);
+	struct ceph_fs_client *fsc = ceph_sb_to_client(old_dir->i_sb);
+	struct ceph_mds_client *mdsc = fsc->mdsc;
 	struct ceph_mds_request *req;
+	bool try_async = ceph_test_mount_opt(fsc, ASYNC_DIROPS) &&
+			 old_dir == new_dir;
 	int op = CEPH_MDS_OP_RENAME;
 	int err;
 
@@ -1230,6 +1317,7 @@ static int ceph_rename(struct user_namespace *mnt_userns, struct inode *old_dir,
 
 	dout("rename dir %p dentry %p to dir %p dentry %p\n",
 	     old_dir, old_dentry, new_dir, new_dentry);
+retry:
 	req = ceph_mdsc_create_request(mdsc, op, USE_AUTH_MDS);
 	if (IS_ERR(req))
 		return PTR_ERR(req);
@@ -1240,7 +1328,6 @@ static int ceph_rename(struct user_namespace *mnt_userns, struct inode *old_dir,
 	req->r_old_dentry_dir = old_dir;
 	req->r_parent = new_dir;
 	ihold(new_dir);
-	set_bit(CEPH_MDS_R_PARENT_LOCKED, &req->r_req_flags);
 	req->r_old_dentry_drop = CEPH_CAP_FILE_SHARED;
 	req->r_old_dentry_unless = CEPH_CAP_FILE_EXCL;
 	req->r_dentry_drop = CEPH_CAP_FILE_SHARED;
@@ -1251,14 +1338,41 @@ static int ceph_rename(struct user_namespace *mnt_userns, struct inode *old_dir,
 		req->r_inode_drop =
 			ceph_drop_caps_for_unlink(d_inode(new_dentry));
 	}
-	err = ceph_mdsc_do_request(mdsc, old_dir, req);
-	if (!err && !req->r_reply_info.head->is_dentry) {
-		/*
-		 * Normally d_move() is done by fill_trace (called by
-		 * do_request, above).  If there is no trace, we need
-		 * to do it here.
-		 */
-		d_move(old_dentry, new_dentry);
+
+	if (try_async && op == CEPH_MDS_OP_RENAME &&
+	    (req->r_dir_caps = get_caps_for_async_rename(old_dir, old_dentry,
+							 new_dentry))) {
+		dout("async rename on %llu/%pd -> %pd caps=%s",
+		     ceph_ino(old_dir), old_dentry, new_dentry,
+		     ceph_cap_string(req->r_dir_caps));
+		set_bit(CEPH_MDS_R_ASYNC, &req->r_req_flags);
+		req->r_callback = ceph_async_rename_cb;
+		req->r_old_inode = d_inode(old_dentry);
+		ihold(req->r_old_inode);
+		err = ceph_mdsc_submit_request(mdsc, old_dir, req);
+		if (!err) {
+			/*
+			 * We have enough caps, so we assume that the rename
+			 * will succeed and move the dentry ourselves, there
+			 * is no trace to do it for us.
+			 */
+			d_move(old_dentry, new_dentry);
+		} else if (err == -EJUKEBOX) {
+			try_async = false;
+			ceph_mdsc_put_request(req);
+			goto retry;
+		}
+	} else {
+		set_bit(CEPH_MDS_R_PARENT_LOCKED, &req->r_req_flags);
+		err = ceph_mdsc_do_request(mdsc, old_dir, req);
+		if (!err && !req->r_reply_info.head->is_dentry) {
+			/*
+			 * Normally d_move() is done by fill_trace (called by
+			 * do_request, above).  If there is no trace, we need
+			 * to do it here.
+			 */
+			d_move(old_dentry, new_dentry);
+		}
 	}
 	ceph_mdsc_put_request(req);
 	return err;
@@ -751,7 +751,7 @@ static struct ceph_mds_session *register_session(struct ceph_mds_client *mdsc,
 	INIT_LIST_HEAD(&s->s_unsafe);
 	xa_init(&s->s_delegated_inos);
 	INIT_LIST_HEAD(&s->s_cap_releases);
-	INIT_WORK(&s->s_cap_release_work, ceph_cap_release_work);
+	INIT_DELAYED_WORK(&s->s_cap_release_work, ceph_cap_release_work);
 
 	INIT_LIST_HEAD(&s->s_cap_dirty);
 	INIT_LIST_HEAD(&s->s_cap_flushing);
@@ -2189,7 +2189,8 @@ static void ceph_send_cap_releases(struct ceph_mds_client *mdsc,
 static void ceph_cap_release_work(struct work_struct *work)
 {
 	struct ceph_mds_session *session =
-		container_of(work, struct ceph_mds_session, s_cap_release_work);
+		container_of(to_delayed_work(work), struct ceph_mds_session,
+			     s_cap_release_work);
 
 	mutex_lock(&session->s_mutex);
 	if (session->s_state == CEPH_MDS_SESSION_OPEN ||
@@ -2206,15 +2207,34 @@ void ceph_flush_cap_releases(struct ceph_mds_client *mdsc,
 		return;
 
 	ceph_get_mds_session(session);
-	if (queue_work(mdsc->fsc->cap_wq,
-		       &session->s_cap_release_work)) {
+	/* pull a pending delayed flush in, it already holds a reference */
+	if (!mod_delayed_work(mdsc->fsc->cap_wq,
+			      &session->s_cap_release_work, 0)) {
 		dout("cap release work queued\n");
 	} else {
 		ceph_put_mds_session(session);
-		dout("failed to queue cap release work\n");
+		dout("cap release work already pending\n");
 	}
 }
 
+/*
+ * Send a partial batch of cap releases after a short delay, so that the
+ * releases of a burst of unlinks or evictions go out in a few messages
+ * rather than one per cap or waiting for the next delayed_work() tick.
+ */
+static void ceph_delay_cap_releases(struct ceph_mds_client *mdsc,
+				    struct ceph_mds_session *session)
+{
+	if (mdsc->stopping)
+		return;
+
+	ceph_get_mds_session(session);
+	if (!queue_delayed_work(mdsc->fsc->cap_wq,
+				&session->s_cap_release_work,
+				CEPH_CAP_RELEASE_DELAY))
+		ceph_put_mds_session(session);
+}
+
 /*
  * caller holds session->s_cap_lock
  */
@@ -2226,6 +2246,8 @@ void __ceph_queue_cap_release(struct ceph_mds_session *session,
 
 	if (!(session->s_num_cap_releases % CEPH_CAPS_PER_RELEASE))
 		ceph_flush_cap_releases(session->s_mdsc, session);
+	else if (session->s_num_cap_releases == 1)
+		ceph_delay_cap_releases(session->s_mdsc, session);
 }
 
 static void ceph_cap_reclaim_work(struct work_struct *work)
@@ -157,6 +157,12 @@ struct ceph_mds_reply_info_parsed {
 				sizeof(struct ceph_mds_cap_release)) /	\
 			        sizeof(struct ceph_mds_cap_item))
 
+/*
+ * How long a partial batch of cap releases may wait for more releases
+ * to join it before it is sent anyway.
+ */
+#define CEPH_CAP_RELEASE_DELAY	(HZ / 20)
+
 
 /*
  * state associated with each MDS<->client session
@@ -199,7 +205,7 @@ struct ceph_mds_session {
 	int		  s_cap_reconnect;
 	int		  s_readonly;
 	struct list_head  s_cap_releases; /* waiting cap_release messages */
-	struct work_struct s_cap_release_work;
+	struct delayed_work s_cap_release_work;
 
 	/* See ceph_inode_info->i_dirty_item. */
 	struct list_head  s_cap_dirty;	      /* inodes w/ dirty caps */
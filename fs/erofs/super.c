@@ -358,6 +358,7 @@ enum {
 	Opt_cache_strategy,
 	Opt_dax,
 	Opt_dax_enum,
+	Opt_sync_decompress_pages,
 	Opt_err
 };
 
@@ -381,6 +382,7 @@ static const struct fs_parameter_spec erofs_fs_parameters[] = {
 		     erofs_param_cache_strategy),
 	fsparam_flag("dax",             Opt_dax),
 	fsparam_enum("dax",		Opt_dax_enum, erofs_dax_param_enums),
+	fsparam_u32("sync_decompress_pages", Opt_sync_decompress_pages),
 	{}
 };
 
@@ -456,6 +458,20 @@ static int erofs_fc_parse_param(struct fs_context *fc,
 		if (!erofs_fc_set_dax_mode(fc, result.uint_32))
 			return -EINVAL;
 		break;
+	case Opt_sync_decompress_pages:
+#ifdef CONFIG_EROFS_FS_ZIP
+		/*
+		 * Decompress readahead requests up to this many pages in the
+		 * reader context from the start, instead of only once bios
+		 * were seen completing in atomic context; 0 never does.
+		 */
+		ctx->max_sync_decompress_pages = result.uint_32;
+		ctx->readahead_sync_decompress = result.uint_32 != 0;
+		set_opt(ctx, SYNC_DECOMPRESS);
+#else
+		errorfc(fc, "compression not supported, sync_decompress_pages ignored");
+#endif
+		break;
 	default:
 		return -ENOPARAM;
 	}
@@ -784,6 +800,9 @@ static int erofs_show_options(struct seq_file *seq, struct dentry *root)
 		seq_puts(seq, ",cache_strategy=readahead");
 	else if (ctx->cache_strategy == EROFS_ZIP_CACHE_READAROUND)
 		seq_puts(seq, ",cache_strategy=readaround");
+	if (test_opt(ctx, SYNC_DECOMPRESS))
+		seq_printf(seq, ",sync_decompress_pages=%u",
+			   ctx->max_sync_decompress_pages);
 #endif
 	if (test_opt(ctx, DAX_ALWAYS))
 		seq_puts(seq, ",dax=always");
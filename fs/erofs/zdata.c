@@ -6,6 +6,7 @@
 #include "zdata.h"
 #include "compress.h"
 #include <linux/prefetch.h>
+#include <linux/cpuhotplug.h>
 
 #include <trace/events/erofs.h>
 
@@ -124,9 +125,83 @@ typedef tagptr1_t compressed_page_t;
 
 static struct workqueue_struct *z_erofs_workqueue __read_mostly;
 
+/*
+ * Per-CPU high-priority decompression workers.  Pclusters of a read request
+ * are spread over them, so that LZ4 decompression isn't serialized on
+ * whichever CPU happened to complete the bio.  The unbound workqueue above
+ * is only used for CPUs whose worker isn't up (yet).
+ */
+static struct kthread_worker __rcu **z_erofs_pcpu_workers;
+static DEFINE_SPINLOCK(z_erofs_pcpu_worker_lock);
+static enum cpuhp_state z_erofs_cpuhp_state;
+
+static int z_erofs_cpu_online(unsigned int cpu)
+{
+	struct kthread_worker *worker, *old;
+
+	worker = kthread_create_worker_on_cpu(cpu, 0, "erofs_worker/%u", cpu);
+	if (IS_ERR(worker))
+		return PTR_ERR(worker);
+	sched_set_fifo_low(worker->task);
+
+	spin_lock(&z_erofs_pcpu_worker_lock);
+	old = rcu_dereference_protected(z_erofs_pcpu_workers[cpu],
+			lockdep_is_held(&z_erofs_pcpu_worker_lock));
+	if (!old)
+		rcu_assign_pointer(z_erofs_pcpu_workers[cpu], worker);
+	spin_unlock(&z_erofs_pcpu_worker_lock);
+	if (old)
+		kthread_destroy_worker(worker);
+	return 0;
+}
+
+static int z_erofs_cpu_offline(unsigned int cpu)
+{
+	struct kthread_worker *worker;
+
+	spin_lock(&z_erofs_pcpu_worker_lock);
+	worker = rcu_dereference_protected(z_erofs_pcpu_workers[cpu],
+			lockdep_is_held(&z_erofs_pcpu_worker_lock));
+	RCU_INIT_POINTER(z_erofs_pcpu_workers[cpu], NULL);
+	spin_unlock(&z_erofs_pcpu_worker_lock);
+
+	/* wait for queuers still using it, then drain what they queued */
+	synchronize_rcu();
+	if (worker)
+		kthread_destroy_worker(worker);
+	return 0;
+}
+
+static int z_erofs_init_pcpu_workers(void)
+{
+	int ret;
+
+	z_erofs_pcpu_workers = kcalloc(nr_cpu_ids, sizeof(*z_erofs_pcpu_workers),
+				       GFP_KERNEL);
+	if (!z_erofs_pcpu_workers)
+		return -ENOMEM;
+
+	ret = cpuhp_setup_state(CPUHP_AP_ONLINE_DYN, "fs/erofs:online",
+				z_erofs_cpu_online, z_erofs_cpu_offline);
+	if (ret < 0) {
+		kfree(z_erofs_pcpu_workers);
+		return ret;
+	}
+	z_erofs_cpuhp_state = ret;
+	return 0;
+}
+
+static void z_erofs_exit_pcpu_workers(void)
+{
+	/* tears down the workers of all online CPUs */
+	cpuhp_remove_state(z_erofs_cpuhp_state);
+	kfree(z_erofs_pcpu_workers);
+}
+
 void z_erofs_exit_zip_subsystem(void)
 {
 	destroy_workqueue(z_erofs_workqueue);
+	z_erofs_exit_pcpu_workers();
 	z_erofs_destroy_pcluster_pool();
 }
 
@@ -152,7 +227,16 @@ int __init z_erofs_init_zip_subsystem(void)
 		return err;
 	err = z_erofs_init_workqueue();
 	if (err)
-		z_erofs_destroy_pcluster_pool();
+		goto out_destroy_pool;
+	err = z_erofs_init_pcpu_workers();
+	if (err)
+		goto out_destroy_wq;
+	return 0;
+
+out_destroy_wq:
+	destroy_workqueue(z_erofs_workqueue);
+out_destroy_pool:
+	z_erofs_destroy_pcluster_pool();
 	return err;
 }
 
@@ -774,11 +858,13 @@ static int z_erofs_do_read_page(struct z_erofs_decompress_frontend *fe,
 	goto out;
 }
 
-static void z_erofs_decompressqueue_work(struct work_struct *work);
+static void z_erofs_decompress_bgqueue(struct z_erofs_decompressqueue *bgq);
+static void z_erofs_decompressqueue_kthread_work(struct kthread_work *work);
 static void z_erofs_decompress_kickoff(struct z_erofs_decompressqueue *io,
 				       bool sync, int bios)
 {
 	struct erofs_sb_info *const sbi = EROFS_SB(io->sb);
+	struct kthread_worker *worker;
 
 	/* wake up the caller thread for sync decompression */
 	if (sync) {
@@ -795,11 +881,21 @@ static void z_erofs_decompress_kickoff(struct z_erofs_decompressqueue *io,
 		return;
 	/* Use workqueue and sync decompression for atomic contexts only */
 	if (in_atomic() || irqs_disabled()) {
-		queue_work(z_erofs_workqueue, &io->u.work);
+		rcu_read_lock();
+		worker = rcu_dereference(
+				z_erofs_pcpu_workers[raw_smp_processor_id()]);
+		if (worker) {
+			kthread_init_work(&io->u.kthread_work,
+					  z_erofs_decompressqueue_kthread_work);
+			kthread_queue_work(worker, &io->u.kthread_work);
+		} else {
+			queue_work(z_erofs_workqueue, &io->u.work);
+		}
+		rcu_read_unlock();
 		sbi->ctx.readahead_sync_decompress = true;
 		return;
 	}
-	z_erofs_decompressqueue_work(&io->u.work);
+	z_erofs_decompress_bgqueue(io);
 }
 
 static bool z_erofs_page_is_invalidated(struct page *page)
@@ -1035,10 +1131,66 @@ static int z_erofs_decompress_pcluster(struct super_block *sb,
 	return err;
 }
 
+/* a pcluster handed off to the decompression worker of another CPU */
+struct z_erofs_decompress_job {
+	struct kthread_work work;
+	struct super_block *sb;
+	struct z_erofs_pcluster *pcl;
+};
+
+static void z_erofs_decompress_job_work(struct kthread_work *work)
+{
+	struct z_erofs_decompress_job *job =
+		container_of(work, struct z_erofs_decompress_job, work);
+	LIST_HEAD(pagepool);
+
+	z_erofs_decompress_pcluster(job->sb, job->pcl, &pagepool);
+	put_pages_list(&pagepool);
+	kfree(job);
+}
+
+/*
+ * Pick the next online CPU after *@cpu and queue @pcl on its worker.
+ * Returns false if the caller should decompress @pcl by itself, i.e. the
+ * turn came back to the current CPU or nothing could be queued.
+ */
+static bool z_erofs_fanout_pcluster(struct super_block *sb,
+				    struct z_erofs_pcluster *pcl, int *cpu)
+{
+	struct z_erofs_decompress_job *job;
+	struct kthread_worker *worker;
+
+	*cpu = cpumask_next(*cpu, cpu_online_mask);
+	if (*cpu >= nr_cpu_ids)
+		*cpu = cpumask_first(cpu_online_mask);
+	if (*cpu == raw_smp_processor_id())
+		return false;
+
+	job = kmalloc(sizeof(*job), GFP_NOIO | __GFP_NOWARN);
+	if (!job)
+		return false;
+	job->sb = sb;
+	job->pcl = pcl;
+	kthread_init_work(&job->work, z_erofs_decompress_job_work);
+
+	rcu_read_lock();
+	worker = rcu_dereference(z_erofs_pcpu_workers[*cpu]);
+	if (worker)
+		kthread_queue_work(worker, &job->work);
+	rcu_read_unlock();
+
+	if (!worker) {
+		kfree(job);
+		return false;
+	}
+	return true;
+}
+
 static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
-				     struct list_head *pagepool)
+				     struct list_head *pagepool, bool fanout)
 {
 	z_erofs_next_pcluster_t owned = io->head;
+	int cpu = raw_smp_processor_id();
 
 	while (owned != Z_EROFS_PCLUSTER_TAIL_CLOSED) {
 		struct z_erofs_pcluster *pcl;
@@ -1052,23 +1204,38 @@ static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
 		pcl = container_of(owned, struct z_erofs_pcluster, next);
 		owned = READ_ONCE(pcl->next);
 
+		/* always keep the last pcluster to ourselves */
+		if (fanout && owned != Z_EROFS_PCLUSTER_TAIL_CLOSED &&
+		    z_erofs_fanout_pcluster(io->sb, pcl, &cpu))
+			continue;
 		z_erofs_decompress_pcluster(io->sb, pcl, pagepool);
 	}
 }
 
-static void z_erofs_decompressqueue_work(struct work_struct *work)
+static void z_erofs_decompress_bgqueue(struct z_erofs_decompressqueue *bgq)
 {
-	struct z_erofs_decompressqueue *bgq =
-		container_of(work, struct z_erofs_decompressqueue, u.work);
 	LIST_HEAD(pagepool);
 
 	DBG_BUGON(bgq->head == Z_EROFS_PCLUSTER_TAIL_CLOSED);
-	z_erofs_decompress_queue(bgq, &pagepool);
+	z_erofs_decompress_queue(bgq, &pagepool, true);
 
 	put_pages_list(&pagepool);
 	kvfree(bgq);
 }
 
+static void z_erofs_decompressqueue_work(struct work_struct *work)
+{
+	z_erofs_decompress_bgqueue(container_of(work,
+				   struct z_erofs_decompressqueue, u.work));
+}
+
+static void z_erofs_decompressqueue_kthread_work(struct kthread_work *work)
+{
+	z_erofs_decompress_bgqueue(container_of(work,
+				   struct z_erofs_decompressqueue,
+				   u.kthread_work));
+}
+
 static struct page *pickup_page_for_submission(struct z_erofs_pcluster *pcl,
 					       unsigned int nr,
 					       struct list_head *pagepool,
@@ -1364,7 +1531,7 @@ static void z_erofs_runqueue(struct super_block *sb,
 	z_erofs_submit_queue(sb, f, pagepool, io, &force_fg);
 
 	/* handle bypass queue (no i/o pclusters) immediately */
-	z_erofs_decompress_queue(&io[JQ_BYPASS], pagepool);
+	z_erofs_decompress_queue(&io[JQ_BYPASS], pagepool, false);
 
 	if (!force_fg)
 		return;
@@ -1374,7 +1541,7 @@ static void z_erofs_runqueue(struct super_block *sb,
 		      !atomic_read(&io[JQ_SUBMIT].pending_bios));
 
 	/* handle synchronous decompress queue in the caller context */
-	z_erofs_decompress_queue(&io[JQ_SUBMIT], pagepool);
+	z_erofs_decompress_queue(&io[JQ_SUBMIT], pagepool, false);
 }
 
 static int z_erofs_readpage(struct file *file, struct page *page)
@@ -32,6 +32,13 @@
  */
 #define FUSE_DAX_RECLAIM_THRESHOLD	(20)
 
+/*
+ * Once started, background reclaim keeps going until this percentage of
+ * ranges is free, so that allocations don't hover at the threshold and
+ * fall back to inline reclaim.
+ */
+#define FUSE_DAX_RECLAIM_TARGET		(30)
+
 /** Translation information for file offsets to DAX window offsets */
 struct fuse_dax_mapping {
 	/* Pointer to inode where this memory range is mapped */
@@ -57,6 +64,9 @@ struct fuse_dax_mapping {
 
 	/* reference count when the mapping is used by dax iomap. */
 	refcount_t refcnt;
+
+	/* Used since the reclaimer last looked at it */
+	bool accessed;
 };
 
 /* Per-inode dax map */
@@ -106,12 +116,13 @@ static struct fuse_dax_mapping *
 alloc_dax_mapping_reclaim(struct fuse_conn_dax *fcd, struct inode *inode);
 
 static void
-__kick_dmap_free_worker(struct fuse_conn_dax *fcd, unsigned long delay_ms)
+__kick_dmap_free_worker(struct fuse_conn_dax *fcd, unsigned long delay_ms,
+			unsigned int threshold)
 {
 	unsigned long free_threshold;
 
 	/* If number of free ranges are below threshold, start reclaim */
-	free_threshold = max_t(unsigned long, fcd->nr_ranges * FUSE_DAX_RECLAIM_THRESHOLD / 100,
+	free_threshold = max_t(unsigned long, fcd->nr_ranges * threshold / 100,
 			     1);
 	if (fcd->nr_free_ranges < free_threshold)
 		queue_delayed_work(system_long_wq, &fcd->free_work,
@@ -119,10 +130,10 @@ __kick_dmap_free_worker(struct fuse_conn_dax *fcd, unsigned long delay_ms)
 }
 
 static void kick_dmap_free_worker(struct fuse_conn_dax *fcd,
-				  unsigned long delay_ms)
+				  unsigned long delay_ms, unsigned int threshold)
 {
 	spin_lock(&fcd->lock);
-	__kick_dmap_free_worker(fcd, delay_ms);
+	__kick_dmap_free_worker(fcd, delay_ms, threshold);
 	spin_unlock(&fcd->lock);
 }
 
@@ -140,7 +151,7 @@ static struct fuse_dax_mapping *alloc_dax_mapping(struct fuse_conn_dax *fcd)
 	}
 	spin_unlock(&fcd->lock);
 
-	kick_dmap_free_worker(fcd, 0);
+	kick_dmap_free_worker(fcd, 0, FUSE_DAX_RECLAIM_THRESHOLD);
 	return dmap;
 }
 
@@ -297,6 +308,7 @@ static void dmap_reinit_add_to_free_pool(struct fuse_conn_dax *fcd,
 	__dmap_remove_busy_list(fcd, dmap);
 	dmap->inode = NULL;
 	dmap->itn.start = dmap->itn.last = 0;
+	dmap->accessed = false;
 	__dmap_add_to_free_pool(fcd, dmap);
 }
 
@@ -418,6 +430,9 @@ static void fuse_fill_iomap(struct inode *inode, loff_t pos, loff_t length,
 		 * shared/exclusive.
 		 */
 		refcount_inc(&dmap->refcnt);
+		/* Recency hint for __pick_dmap_to_reclaim() */
+		if (!READ_ONCE(dmap->accessed))
+			WRITE_ONCE(dmap->accessed, true);
 
 		/* iomap->private should be NULL */
 		WARN_ON_ONCE(iomap->private);
@@ -1136,20 +1151,61 @@ static int lookup_and_reclaim_dmap(struct fuse_conn_dax *fcd,
 	return ret;
 }
 
+/*
+ * Busy ranges are kept in the order they were set up.  Pick the oldest idle
+ * one that hasn't been accessed since the last scan, clearing the accessed
+ * bit of the ones passed over so they are fair game next time around.
+ * This assumes fcd->lock is held.
+ */
+static struct fuse_dax_mapping *
+__pick_dmap_to_reclaim(struct fuse_conn_dax *fcd, struct inode **inodep)
+{
+	struct fuse_dax_mapping *pos, *temp;
+	struct inode *inode;
+
+	list_for_each_entry_safe(pos, temp, &fcd->busy_ranges, busy_list) {
+		/* skip this range if it's in use. */
+		if (refcount_read(&pos->refcnt) > 1)
+			continue;
+
+		/* Recently used, give it a second chance */
+		if (READ_ONCE(pos->accessed)) {
+			WRITE_ONCE(pos->accessed, false);
+			continue;
+		}
+
+		inode = igrab(pos->inode);
+		/*
+		 * This inode is going away. That will free
+		 * up all the ranges anyway, continue to
+		 * next range.
+		 */
+		if (!inode)
+			continue;
+		/*
+		 * Take this element off list and add it tail. If
+		 * this element can't be freed, it will help with
+		 * selecting new element in next iteration of loop.
+		 */
+		list_move_tail(&pos->busy_list, &fcd->busy_ranges);
+		*inodep = inode;
+		return pos;
+	}
+	return NULL;
+}
+
 static int try_to_free_dmap_chunks(struct fuse_conn_dax *fcd,
 				   unsigned long nr_to_free)
 {
-	struct fuse_dax_mapping *dmap, *pos, *temp;
+	struct fuse_dax_mapping *dmap;
 	int ret, nr_freed = 0;
 	unsigned long start_idx = 0, end_idx = 0;
 	struct inode *inode = NULL;
 
-	/* Pick first busy range and free it for now*/
 	while (1) {
 		if (nr_freed >= nr_to_free)
 			break;
 
-		dmap = NULL;
 		spin_lock(&fcd->lock);
 
 		if (!fcd->nr_busy_ranges) {
@@ -1157,30 +1213,12 @@ static int try_to_free_dmap_chunks(struct fuse_conn_dax *fcd,
 			return 0;
 		}
 
-		list_for_each_entry_safe(pos, temp, &fcd->busy_ranges,
-						busy_list) {
-			/* skip this range if it's in use. */
-			if (refcount_read(&pos->refcnt) > 1)
-				continue;
-
-			inode = igrab(pos->inode);
-			/*
-			 * This inode is going away. That will free
-			 * up all the ranges anyway, continue to
-			 * next range.
-			 */
-			if (!inode)
-				continue;
-			/*
-			 * Take this element off list and add it tail. If
-			 * this element can't be freed, it will help with
-			 * selecting new element in next iteration of loop.
-			 */
-			dmap = pos;
-			list_move_tail(&dmap->busy_list, &fcd->busy_ranges);
+		/* If every idle range was accessed, the rescan takes the oldest */
+		dmap = __pick_dmap_to_reclaim(fcd, &inode);
+		if (!dmap)
+			dmap = __pick_dmap_to_reclaim(fcd, &inode);
+		if (dmap)
 			start_idx = end_idx = dmap->itn.start;
-			break;
-		}
 		spin_unlock(&fcd->lock);
 		if (!dmap)
 			return 0;
@@ -1205,8 +1243,8 @@ static void fuse_dax_free_mem_worker(struct work_struct *work)
 			 ret);
 	}
 
-	/* If number of free ranges are still below threshold, requeue */
-	kick_dmap_free_worker(fcd, 1);
+	/* Keep reclaiming in the background until we are back at the target */
+	kick_dmap_free_worker(fcd, 1, FUSE_DAX_RECLAIM_TARGET);
 }
 
 static void fuse_free_dax_mem_ranges(struct list_head *mem_list)
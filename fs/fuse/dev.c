@@ -21,6 +21,9 @@
 #include <linux/swap.h>
 #include <linux/splice.h>
 #include <linux/sched.h>
+#include <linux/percpu.h>
+#include <linux/vmalloc.h>
+#include <linux/bvec.h>
 
 MODULE_ALIAS_MISCDEV(FUSE_MINOR);
 MODULE_ALIAS("devname:fuse");
@@ -194,8 +197,7 @@ EXPORT_SYMBOL_GPL(fuse_len_args);
 
 u64 fuse_get_unique(struct fuse_iqueue *fiq)
 {
-	fiq->reqctr += FUSE_REQ_ID_STEP;
-	return fiq->reqctr;
+	return atomic64_add_return(FUSE_REQ_ID_STEP, &fiq->reqctr);
 }
 EXPORT_SYMBOL_GPL(fuse_get_unique);
 
@@ -222,17 +224,103 @@ const struct fuse_iqueue_ops fuse_dev_fiq_ops = {
 };
 EXPORT_SYMBOL_GPL(fuse_dev_fiq_ops);
 
-static void queue_request_and_unlock(struct fuse_iqueue *fiq,
-				     struct fuse_req *req)
-__releases(fiq->lock)
+static void fuse_req_set_len(struct fuse_req *req)
 {
 	req->in.h.len = sizeof(struct fuse_in_header) +
 		fuse_len_args(req->args->in_numargs,
 			      (struct fuse_arg *) req->args->in_args);
+}
+
+static void queue_request_and_unlock(struct fuse_iqueue *fiq,
+				     struct fuse_req *req)
+__releases(fiq->lock)
+{
+	fuse_req_set_len(req);
 	list_add_tail(&req->list, &fiq->pending);
 	fiq->ops->wake_pending_and_unlock(fiq);
 }
 
+/*
+ * Queue @req on the input queue of the submitting CPU if a device is bound
+ * to it, so that it is read by the daemon thread serving this CPU without
+ * touching fiq->lock.  Returns false if the request has to go through the
+ * shared queue instead.
+ */
+static bool fuse_cpu_queue_request(struct fuse_conn *fc, struct fuse_req *req)
+{
+	struct fuse_iqueue_cpu __percpu *iq_cpu = smp_load_acquire(&fc->iq_cpu);
+	struct fuse_iqueue_cpu *ciq;
+
+	if (!iq_cpu)
+		return false;
+
+	ciq = per_cpu_ptr(iq_cpu, raw_smp_processor_id());
+	if (!READ_ONCE(ciq->nr_readers))
+		return false;
+
+	spin_lock(&ciq->lock);
+	if (!ciq->connected || !ciq->nr_readers) {
+		spin_unlock(&ciq->lock);
+		return false;
+	}
+	req->in.h.unique = fuse_get_unique(&fc->iq);
+	fuse_req_set_len(req);
+	req->ciq = ciq;
+	list_add_tail(&req->list, &ciq->pending);
+	wake_up(&ciq->waitq);
+	spin_unlock(&ciq->lock);
+
+	return true;
+}
+
+static struct fuse_req *fuse_cpu_dequeue_request(struct fuse_iqueue_cpu *ciq)
+{
+	struct fuse_req *req = NULL;
+
+	if (list_empty(&ciq->pending))
+		return NULL;
+
+	spin_lock(&ciq->lock);
+	if (!list_empty(&ciq->pending)) {
+		req = list_first_entry(&ciq->pending, struct fuse_req, list);
+		clear_bit(FR_PENDING, &req->flags);
+		list_del_init(&req->list);
+		req->ciq = NULL;
+	}
+	spin_unlock(&ciq->lock);
+
+	return req;
+}
+
+/*
+ * Take a request that has not been read yet off whichever input queue it
+ * is on.  req->ciq only changes from a per-CPU queue to NULL, and only under
+ * that queue's lock, so it is stable once the lock it names is held.
+ */
+static bool fuse_remove_pending(struct fuse_iqueue *fiq, struct fuse_req *req)
+{
+	struct fuse_iqueue_cpu *ciq;
+	spinlock_t *lock;
+	bool pending;
+
+again:
+	ciq = READ_ONCE(req->ciq);
+	lock = ciq ? &ciq->lock : &fiq->lock;
+	spin_lock(lock);
+	if (READ_ONCE(req->ciq) != ciq) {
+		spin_unlock(lock);
+		goto again;
+	}
+	pending = test_bit(FR_PENDING, &req->flags);
+	if (pending) {
+		list_del(&req->list);
+		req->ciq = NULL;
+	}
+	spin_unlock(lock);
+
+	return pending;
+}
+
 void fuse_queue_forget(struct fuse_conn *fc, struct fuse_forget_link *forget,
 		       u64 nodeid, u64 nlookup)
 {
@@ -263,6 +351,8 @@ static void flush_bg_queue(struct fuse_conn *fc)
 		req = list_first_entry(&fc->bg_queue, struct fuse_req, list);
 		list_del(&req->list);
 		fc->active_background++;
+		if (fuse_cpu_queue_request(fc, req))
+			continue;
 		spin_lock(&fiq->lock);
 		req->in.h.unique = fuse_get_unique(fiq);
 		queue_request_and_unlock(fiq, req);
@@ -392,16 +482,12 @@ static void request_wait_answer(struct fuse_req *req)
 		if (!err)
 			return;
 
-		spin_lock(&fiq->lock);
 		/* Request is not yet in userspace, bail out */
-		if (test_bit(FR_PENDING, &req->flags)) {
-			list_del(&req->list);
-			spin_unlock(&fiq->lock);
+		if (fuse_remove_pending(fiq, req)) {
 			__fuse_put_request(req);
 			req->out.h.error = -EINTR;
 			return;
 		}
-		spin_unlock(&fiq->lock);
 	}
 
 	/*
@@ -413,24 +499,28 @@ static void request_wait_answer(struct fuse_req *req)
 
 static void __fuse_request_send(struct fuse_req *req)
 {
-	struct fuse_iqueue *fiq = &req->fm->fc->iq;
+	struct fuse_conn *fc = req->fm->fc;
+	struct fuse_iqueue *fiq = &fc->iq;
 
 	BUG_ON(test_bit(FR_BACKGROUND, &req->flags));
-	spin_lock(&fiq->lock);
-	if (!fiq->connected) {
-		spin_unlock(&fiq->lock);
-		req->out.h.error = -ENOTCONN;
-	} else {
+	/* acquire extra reference, since request is still needed
+	   after fuse_request_end() */
+	__fuse_get_request(req);
+	if (!fuse_cpu_queue_request(fc, req)) {
+		spin_lock(&fiq->lock);
+		if (!fiq->connected) {
+			spin_unlock(&fiq->lock);
+			__fuse_put_request(req);
+			req->out.h.error = -ENOTCONN;
+			return;
+		}
 		req->in.h.unique = fuse_get_unique(fiq);
-		/* acquire extra reference, since request is still needed
-		   after fuse_request_end() */
-		__fuse_get_request(req);
 		queue_request_and_unlock(fiq, req);
-
-		request_wait_answer(req);
-		/* Pairs with smp_wmb() in fuse_request_end() */
-		smp_rmb();
 	}
+
+	request_wait_answer(req);
+	/* Pairs with smp_wmb() in fuse_request_end() */
+	smp_rmb();
 }
 
 static void fuse_adjust_compat(struct fuse_conn *fc, struct fuse_args *args)
@@ -659,6 +749,7 @@ struct fuse_copy_state {
 	unsigned len;
 	unsigned offset;
 	unsigned move_pages:1;
+	unsigned pinned:1;
 };
 
 static void fuse_copy_init(struct fuse_copy_state *cs, int write,
@@ -679,11 +770,15 @@ static void fuse_copy_finish(struct fuse_copy_state *cs)
 			buf->len = PAGE_SIZE - cs->len;
 		cs->currbuf = NULL;
 	} else if (cs->pg) {
-		if (cs->write) {
+		if (cs->write)
 			flush_dcache_page(cs->pg);
-			set_page_dirty_lock(cs->pg);
+		if (cs->pinned) {
+			unpin_user_pages_dirty_lock(&cs->pg, 1, cs->write);
+		} else {
+			if (cs->write)
+				set_page_dirty_lock(cs->pg);
+			put_page(cs->pg);
 		}
-		put_page(cs->pg);
 	}
 	cs->pg = NULL;
 }
@@ -738,14 +833,18 @@ static int fuse_copy_fill(struct fuse_copy_state *cs)
 		}
 	} else {
 		size_t off;
-		err = iov_iter_get_pages(cs->iter, &page, PAGE_SIZE, 1, &off);
+
+		/* Pin user memory we may write to; take refs on anything else */
+		cs->pinned = iov_iter_extract_will_pin(cs->iter);
+		err = iov_iter_extract_pages(cs->iter, &page, PAGE_SIZE, 1,
+					     cs->pinned ? 0 : ITER_EXTRACT_GET,
+					     &off);
 		if (err < 0)
 			return err;
 		BUG_ON(!err);
 		cs->len = err;
 		cs->offset = off;
 		cs->pg = page;
-		iov_iter_advance(cs->iter, err);
 	}
 
 	return lock_request(cs->req);
@@ -1190,12 +1289,13 @@ __releases(fiq->lock)
  * fuse_request_end().  Otherwise add it to the processing list, and set
  * the 'sent' flag.
  */
-static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
+static ssize_t fuse_dev_do_read(struct fuse_dev *fud, bool nonblock,
 				struct fuse_copy_state *cs, size_t nbytes)
 {
 	ssize_t err;
 	struct fuse_conn *fc = fud->fc;
 	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue_cpu *ciq = fud->ciq;
 	struct fuse_pqueue *fpq = &fud->pq;
 	struct fuse_req *req;
 	struct fuse_args *args;
@@ -1222,15 +1322,27 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 
  restart:
 	for (;;) {
+		/* Requests steered to our CPU first, then the shared queue */
+		if (ciq) {
+			req = fuse_cpu_dequeue_request(ciq);
+			if (req)
+				goto dequeued;
+		}
+
 		spin_lock(&fiq->lock);
 		if (!fiq->connected || request_pending(fiq))
 			break;
 		spin_unlock(&fiq->lock);
 
-		if (file->f_flags & O_NONBLOCK)
+		if (nonblock)
 			return -EAGAIN;
-		err = wait_event_interruptible_exclusive(fiq->waitq,
-				!fiq->connected || request_pending(fiq));
+		if (ciq)
+			err = wait_event_interruptible_exclusive(ciq->waitq,
+					!fiq->connected || request_pending(fiq) ||
+					!list_empty(&ciq->pending));
+		else
+			err = wait_event_interruptible_exclusive(fiq->waitq,
+					!fiq->connected || request_pending(fiq));
 		if (err)
 			return err;
 	}
@@ -1259,6 +1371,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	list_del_init(&req->list);
 	spin_unlock(&fiq->lock);
 
+ dequeued:
 	args = req->args;
 	reqsize = req->in.h.len;
 
@@ -1353,7 +1466,8 @@ static ssize_t fuse_dev_read(struct kiocb *iocb, struct iov_iter *to)
 
 	fuse_copy_init(&cs, 1, to);
 
-	return fuse_dev_do_read(fud, file, &cs, iov_iter_count(to));
+	return fuse_dev_do_read(fud, file->f_flags & O_NONBLOCK, &cs,
+				iov_iter_count(to));
 }
 
 static ssize_t fuse_dev_splice_read(struct file *in, loff_t *ppos,
@@ -1377,7 +1491,7 @@ static ssize_t fuse_dev_splice_read(struct file *in, loff_t *ppos,
 	fuse_copy_init(&cs, 1, NULL);
 	cs.pipebufs = bufs;
 	cs.pipe = pipe;
-	ret = fuse_dev_do_read(fud, in, &cs, len);
+	ret = fuse_dev_do_read(fud, in->f_flags & O_NONBLOCK, &cs, len);
 	if (ret < 0)
 		goto out;
 
@@ -2039,10 +2153,300 @@ static ssize_t fuse_dev_splice_write(struct pipe_inode_info *pipe,
 	return ret;
 }
 
+/* Bounds for FUSE_DEV_IOC_RING_SETUP */
+#define FUSE_RING_MAX_ENTRIES		4096
+#define FUSE_RING_MAX_ENTRY_SIZE	((FUSE_MAX_MAX_PAGES + 1) << PAGE_SHIFT)
+#define FUSE_RING_MAX_SIZE		(64 << 20)
+
+/*
+ * Shared memory request ring of a fuse_dev, see struct fuse_ring_setup in
+ * the uapi header for the protocol.  The kernel moves entries FREE -> REQ
+ * and REPLY -> FREE, the server REQ -> REPLY; the kernel side of both is
+ * serialized by @lock.
+ */
+struct fuse_ring {
+	struct fuse_dev *fud;
+
+	/** vmalloc_user() area mapped by the server */
+	void *area;
+	size_t size;
+
+	/** Descriptor array at the start of @area */
+	struct fuse_ring_desc *desc;
+
+	unsigned int nr_entries;
+	unsigned int entry_size;
+
+	/** Serializes filling and committing entries */
+	struct mutex lock;
+
+	/** Number of FUSE_RING_FREE entries */
+	unsigned int nr_free;
+
+	/** Where to start looking for a free entry */
+	unsigned int next;
+
+	/** Scratch page vector describing one entry */
+	struct bio_vec *bvec;
+
+	/** Entry on the input queue's waitq, kicks @fill_work */
+	wait_queue_entry_t wait;
+	wait_queue_head_t *wq_head;
+	struct work_struct fill_work;
+
+	/** FUSE_RING_ENTER_WAIT sleepers */
+	wait_queue_head_t waitq;
+};
+
+static void fuse_ring_entry_iter(struct fuse_ring *ring, unsigned int idx,
+				 struct iov_iter *iter, unsigned int dir)
+{
+	size_t desc_size = PAGE_ALIGN(ring->nr_entries * sizeof(*ring->desc));
+	void *entry = ring->area + desc_size + (size_t)idx * ring->entry_size;
+	unsigned int i, nr_pages = ring->entry_size >> PAGE_SHIFT;
+
+	for (i = 0; i < nr_pages; i++) {
+		ring->bvec[i].bv_page = vmalloc_to_page(entry + i * PAGE_SIZE);
+		ring->bvec[i].bv_offset = 0;
+		ring->bvec[i].bv_len = PAGE_SIZE;
+	}
+	iov_iter_bvec(iter, dir, ring->bvec, nr_pages, ring->entry_size);
+}
+
+/* Copy as many queued requests as there are free entries into the ring */
+static void fuse_ring_fill(struct fuse_ring *ring)
+{
+	struct fuse_copy_state cs;
+	struct iov_iter iter;
+	unsigned int idx, n;
+	ssize_t ret;
+
+	lockdep_assert_held(&ring->lock);
+
+	while (ring->nr_free) {
+		/* The server can scribble on the states, don't trust nr_free */
+		for (idx = ring->next, n = 0; n < ring->nr_entries;
+		     idx = (idx + 1) % ring->nr_entries, n++) {
+			if (READ_ONCE(ring->desc[idx].state) == FUSE_RING_FREE)
+				break;
+		}
+		if (n == ring->nr_entries) {
+			ring->nr_free = 0;
+			break;
+		}
+
+		fuse_ring_entry_iter(ring, idx, &iter, READ);
+		fuse_copy_init(&cs, 1, &iter);
+		ret = fuse_dev_do_read(ring->fud, true, &cs, ring->entry_size);
+		if (ret < 0)
+			break;
+
+		ring->desc[idx].len = ret;
+		/* Pairs with the server's acquire of the state */
+		smp_store_release(&ring->desc[idx].state, FUSE_RING_REQ);
+		ring->nr_free--;
+		ring->next = (idx + 1) % ring->nr_entries;
+	}
+	wake_up(&ring->waitq);
+}
+
+/* Hand every replied entry to fuse_dev_do_write() and free it */
+static int fuse_ring_commit(struct fuse_ring *ring)
+{
+	struct fuse_copy_state cs;
+	struct iov_iter iter;
+	unsigned int idx;
+	int nr = 0, err = 0;
+	ssize_t ret;
+	u32 len;
+
+	lockdep_assert_held(&ring->lock);
+
+	for (idx = 0; idx < ring->nr_entries; idx++) {
+		struct fuse_ring_desc *desc = &ring->desc[idx];
+
+		/* Pairs with the server's release of the state */
+		if (smp_load_acquire(&desc->state) != FUSE_RING_REPLY)
+			continue;
+
+		len = READ_ONCE(desc->len);
+		if (len > ring->entry_size) {
+			err = -EINVAL;
+		} else if (len) {
+			fuse_ring_entry_iter(ring, idx, &iter, WRITE);
+			iov_iter_truncate(&iter, len);
+			fuse_copy_init(&cs, 0, &iter);
+			ret = fuse_dev_do_write(ring->fud, &cs, len);
+			if (ret < 0 && !err)
+				err = ret;
+		}
+		WRITE_ONCE(desc->state, FUSE_RING_FREE);
+		ring->nr_free++;
+		nr++;
+	}
+
+	return err ?: nr;
+}
+
+static void fuse_ring_fill_work(struct work_struct *work)
+{
+	struct fuse_ring *ring = container_of(work, struct fuse_ring,
+					      fill_work);
+
+	mutex_lock(&ring->lock);
+	fuse_ring_fill(ring);
+	mutex_unlock(&ring->lock);
+}
+
+/*
+ * Woken like any exclusive reader when a request is queued.  If the ring is
+ * full, decline so that the wakeup goes on to a read() sleeper instead.
+ */
+static int fuse_ring_wake(wait_queue_entry_t *wait, unsigned int mode,
+			  int sync, void *key)
+{
+	struct fuse_ring *ring = container_of(wait, struct fuse_ring, wait);
+
+	if (!READ_ONCE(ring->nr_free))
+		return 0;
+
+	schedule_work(&ring->fill_work);
+	return 1;
+}
+
+static int fuse_ring_setup(struct fuse_dev *fud, struct fuse_ring_setup *rs)
+{
+	struct fuse_conn *fc = fud->fc;
+	struct fuse_ring *ring;
+	size_t desc_size, size;
+
+	if (rs->flags || rs->padding)
+		return -EINVAL;
+
+	/* Entries must be able to hold the negotiated max_write */
+	if (!fc->initialized)
+		return -EAGAIN;
+	/* Matches smp_wmb() in fuse_set_initialized() */
+	smp_rmb();
+
+	if (!rs->nr_entries || rs->nr_entries > FUSE_RING_MAX_ENTRIES ||
+	    !PAGE_ALIGNED(rs->entry_size) ||
+	    rs->entry_size > FUSE_RING_MAX_ENTRY_SIZE ||
+	    rs->entry_size < max_t(size_t, FUSE_MIN_READ_BUFFER,
+				   sizeof(struct fuse_in_header) +
+				   sizeof(struct fuse_write_in) +
+				   fc->max_write))
+		return -EINVAL;
+
+	desc_size = PAGE_ALIGN(rs->nr_entries * sizeof(struct fuse_ring_desc));
+	size = desc_size + (size_t)rs->nr_entries * rs->entry_size;
+	if (size > FUSE_RING_MAX_SIZE)
+		return -EINVAL;
+
+	ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+	if (!ring)
+		return -ENOMEM;
+
+	ring->bvec = kcalloc(rs->entry_size >> PAGE_SHIFT,
+			     sizeof(struct bio_vec), GFP_KERNEL);
+	ring->area = vmalloc_user(size);
+	if (!ring->bvec || !ring->area)
+		goto out_free;
+
+	ring->fud = fud;
+	ring->size = size;
+	ring->desc = ring->area;
+	ring->nr_entries = rs->nr_entries;
+	ring->entry_size = rs->entry_size;
+	ring->nr_free = rs->nr_entries;
+	mutex_init(&ring->lock);
+	init_waitqueue_head(&ring->waitq);
+	INIT_WORK(&ring->fill_work, fuse_ring_fill_work);
+	init_waitqueue_func_entry(&ring->wait, fuse_ring_wake);
+	ring->wq_head = fud->ciq ? &fud->ciq->waitq : &fc->iq.waitq;
+
+	if (cmpxchg(&fud->ring, NULL, ring)) {
+		vfree(ring->area);
+		kfree(ring->bvec);
+		kfree(ring);
+		return -EBUSY;
+	}
+
+	add_wait_queue_exclusive(ring->wq_head, &ring->wait);
+	/* Pick up whatever was queued before we started listening */
+	schedule_work(&ring->fill_work);
+
+	return 0;
+
+out_free:
+	vfree(ring->area);
+	kfree(ring->bvec);
+	kfree(ring);
+	return -ENOMEM;
+}
+
+static long fuse_ring_enter(struct fuse_dev *fud, u32 flags)
+{
+	struct fuse_ring *ring = READ_ONCE(fud->ring);
+	struct fuse_iqueue *fiq = &fud->fc->iq;
+	int res, err;
+
+	if (!ring || (flags & ~FUSE_RING_ENTER_WAIT))
+		return -EINVAL;
+
+	mutex_lock(&ring->lock);
+	res = fuse_ring_commit(ring);
+	fuse_ring_fill(ring);
+	mutex_unlock(&ring->lock);
+
+	if (res < 0 || !(flags & FUSE_RING_ENTER_WAIT))
+		return res;
+
+	err = wait_event_interruptible(ring->waitq, !READ_ONCE(fiq->connected) ||
+			READ_ONCE(ring->nr_free) != ring->nr_entries);
+	if (err)
+		return err;
+	if (!READ_ONCE(fiq->connected))
+		return fud->fc->aborted ? -ECONNABORTED : -ENODEV;
+
+	return res;
+}
+
+static void fuse_ring_free(struct fuse_dev *fud)
+{
+	struct fuse_ring *ring = fud->ring;
+
+	if (!ring)
+		return;
+
+	remove_wait_queue(ring->wq_head, &ring->wait);
+	cancel_work_sync(&ring->fill_work);
+	fud->ring = NULL;
+	vfree(ring->area);
+	kfree(ring->bvec);
+	kfree(ring);
+}
+
+static int fuse_dev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct fuse_dev *fud = fuse_get_dev(file);
+	struct fuse_ring *ring;
+
+	if (!fud)
+		return -EPERM;
+
+	ring = READ_ONCE(fud->ring);
+	if (!ring || vma->vm_pgoff)
+		return -EINVAL;
+
+	return remap_vmalloc_range(vma, ring->area, 0);
+}
+
 static __poll_t fuse_dev_poll(struct file *file, poll_table *wait)
 {
 	__poll_t mask = EPOLLOUT | EPOLLWRNORM;
 	struct fuse_iqueue *fiq;
+	struct fuse_iqueue_cpu *ciq;
 	struct fuse_dev *fud = fuse_get_dev(file);
 
 	if (!fud)
@@ -2050,11 +2454,14 @@ static __poll_t fuse_dev_poll(struct file *file, poll_table *wait)
 
 	fiq = &fud->fc->iq;
 	poll_wait(file, &fiq->waitq, wait);
+	ciq = fud->ciq;
+	if (ciq)
+		poll_wait(file, &ciq->waitq, wait);
 
 	spin_lock(&fiq->lock);
 	if (!fiq->connected)
 		mask = EPOLLERR;
-	else if (request_pending(fiq))
+	else if (request_pending(fiq) || (ciq && !list_empty(&ciq->pending)))
 		mask |= EPOLLIN | EPOLLRDNORM;
 	spin_unlock(&fiq->lock);
 
@@ -2074,6 +2481,30 @@ static void end_requests(struct list_head *head)
 	}
 }
 
+/* Disconnect the per-CPU input queues and collect their pending requests */
+static void abort_cpu_queues(struct fuse_conn *fc, struct list_head *to_end)
+{
+	struct fuse_req *req;
+	int cpu;
+
+	if (!fc->iq_cpu)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct fuse_iqueue_cpu *ciq = per_cpu_ptr(fc->iq_cpu, cpu);
+
+		spin_lock(&ciq->lock);
+		ciq->connected = 0;
+		list_for_each_entry(req, &ciq->pending, list) {
+			clear_bit(FR_PENDING, &req->flags);
+			req->ciq = NULL;
+		}
+		list_splice_tail_init(&ciq->pending, to_end);
+		wake_up_all(&ciq->waitq);
+		spin_unlock(&ciq->lock);
+	}
+}
+
 static void end_polls(struct fuse_conn *fc)
 {
 	struct rb_node *p;
@@ -2160,6 +2591,7 @@ void fuse_abort_conn(struct fuse_conn *fc)
 			kfree(fuse_dequeue_forget(fiq, 1, NULL));
 		wake_up_all(&fiq->waitq);
 		spin_unlock(&fiq->lock);
+		abort_cpu_queues(fc, &to_end);
 		kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
 		end_polls(fc);
 		wake_up_all(&fc->blocked_waitq);
@@ -2179,6 +2611,83 @@ void fuse_wait_aborted(struct fuse_conn *fc)
 	wait_event(fc->blocked_waitq, atomic_read(&fc->num_waiting) == 0);
 }
 
+/*
+ * Drop @fud's binding to its CPU.  If it was the last reader there, hand
+ * whatever is still queued to the shared queue and stop steering requests.
+ */
+static void fuse_dev_unbind_cpu(struct fuse_dev *fud)
+{
+	struct fuse_iqueue *fiq = &fud->fc->iq;
+	struct fuse_iqueue_cpu *ciq = fud->ciq;
+	struct fuse_req *req;
+
+	if (!ciq)
+		return;
+
+	fud->ciq = NULL;
+	spin_lock(&ciq->lock);
+	ciq->nr_readers--;
+	if (!ciq->nr_readers && !list_empty(&ciq->pending)) {
+		spin_lock(&fiq->lock);
+		list_for_each_entry(req, &ciq->pending, list)
+			req->ciq = NULL;
+		list_splice_tail_init(&ciq->pending, &fiq->pending);
+		fiq->ops->wake_pending_and_unlock(fiq);
+	}
+	spin_unlock(&ciq->lock);
+}
+
+static int fuse_dev_bind_cpu(struct fuse_dev *fud, u32 cpu)
+{
+	struct fuse_conn *fc = fud->fc;
+	struct fuse_iqueue_cpu __percpu *iq_cpu = NULL;
+	struct fuse_iqueue_cpu *ciq;
+	int i, res;
+
+	if (cpu >= nr_cpu_ids || !cpu_possible(cpu))
+		return -EINVAL;
+
+	if (!READ_ONCE(fc->iq_cpu)) {
+		iq_cpu = alloc_percpu(struct fuse_iqueue_cpu);
+		if (!iq_cpu)
+			return -ENOMEM;
+
+		for_each_possible_cpu(i) {
+			ciq = per_cpu_ptr(iq_cpu, i);
+			spin_lock_init(&ciq->lock);
+			ciq->connected = 1;
+			init_waitqueue_head(&ciq->waitq);
+			INIT_LIST_HEAD(&ciq->pending);
+		}
+	}
+
+	/* fc->lock orders us against fuse_abort_conn() */
+	spin_lock(&fc->lock);
+	res = -ENODEV;
+	if (!fc->connected)
+		goto out_unlock;
+	res = -EBUSY;
+	if (fud->ciq)
+		goto out_unlock;
+
+	if (!fc->iq_cpu) {
+		/* Pairs with smp_load_acquire() in fuse_cpu_queue_request() */
+		smp_store_release(&fc->iq_cpu, iq_cpu);
+		iq_cpu = NULL;
+	}
+	ciq = per_cpu_ptr(fc->iq_cpu, cpu);
+	spin_lock(&ciq->lock);
+	ciq->nr_readers++;
+	spin_unlock(&ciq->lock);
+	fud->ciq = ciq;
+	res = 0;
+
+out_unlock:
+	spin_unlock(&fc->lock);
+	free_percpu(iq_cpu);
+	return res;
+}
+
 int fuse_dev_release(struct inode *inode, struct file *file)
 {
 	struct fuse_dev *fud = fuse_get_dev(file);
@@ -2189,6 +2698,9 @@ int fuse_dev_release(struct inode *inode, struct file *file)
 		LIST_HEAD(to_end);
 		unsigned int i;
 
+		/* Stop the ring before its requests are ended below */
+		fuse_ring_free(fud);
+
 		spin_lock(&fpq->lock);
 		WARN_ON(!list_empty(&fpq->io));
 		for (i = 0; i < FUSE_PQ_HASH_SIZE; i++)
@@ -2196,6 +2708,7 @@ int fuse_dev_release(struct inode *inode, struct file *file)
 		spin_unlock(&fpq->lock);
 
 		end_requests(&to_end);
+		fuse_dev_unbind_cpu(fud);
 
 		/* Are we the last open device? */
 		if (atomic_dec_and_test(&fc->dev_count)) {
@@ -2241,7 +2754,10 @@ static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 {
 	int res;
 	int oldfd;
+	u32 cpu, flags;
 	struct fuse_dev *fud = NULL;
+	struct fuse_passthrough_out pto;
+	struct fuse_ring_setup rs;
 
 	switch (cmd) {
 	case FUSE_DEV_IOC_CLONE:
@@ -2268,6 +2784,42 @@ static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 			}
 		}
 		break;
+	case FUSE_DEV_IOC_PASSTHROUGH_OPEN:
+		res = -EFAULT;
+		if (!copy_from_user(&pto, (void __user *)arg, sizeof(pto))) {
+			res = -EINVAL;
+			fud = fuse_get_dev(file);
+			if (fud && !pto.flags)
+				res = fuse_passthrough_open(fud, pto.fd);
+		}
+		break;
+	case FUSE_DEV_IOC_BIND_CPU:
+		res = -EFAULT;
+		if (!get_user(cpu, (__u32 __user *)arg)) {
+			res = -EINVAL;
+			fud = fuse_get_dev(file);
+			if (fud)
+				res = fuse_dev_bind_cpu(fud, cpu);
+		}
+		break;
+	case FUSE_DEV_IOC_RING_SETUP:
+		res = -EFAULT;
+		if (!copy_from_user(&rs, (void __user *)arg, sizeof(rs))) {
+			res = -EINVAL;
+			fud = fuse_get_dev(file);
+			if (fud)
+				res = fuse_ring_setup(fud, &rs);
+		}
+		break;
+	case FUSE_DEV_IOC_RING_ENTER:
+		res = -EFAULT;
+		if (!get_user(flags, (__u32 __user *)arg)) {
+			res = -EINVAL;
+			fud = fuse_get_dev(file);
+			if (fud)
+				res = fuse_ring_enter(fud, flags);
+		}
+		break;
 	default:
 		res = -ENOTTY;
 		break;
@@ -2284,6 +2836,7 @@ const struct file_operations fuse_dev_operations = {
 	.write_iter	= fuse_dev_write,
 	.splice_write	= fuse_dev_splice_write,
 	.poll		= fuse_dev_poll,
+	.mmap		= fuse_dev_mmap,
 	.release	= fuse_dev_release,
 	.fasync		= fuse_dev_fasync,
 	.unlocked_ioctl = fuse_dev_ioctl,
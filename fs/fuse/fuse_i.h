@@ -31,6 +31,7 @@
 #include <linux/pid_namespace.h>
 #include <linux/refcount.h>
 #include <linux/user_namespace.h>
+#include <linux/idr.h>
 
 /** Default max number of pages that can be used in a single read request */
 #define FUSE_DEFAULT_MAX_PAGES_PER_REQ 32
@@ -173,6 +174,15 @@ struct fuse_conn;
 struct fuse_mount;
 struct fuse_release_args;
 
+/**
+ * Backing file of a passthrough open, and the credentials of the daemon
+ * that registered it, used for all I/O on it.
+ */
+struct fuse_passthrough {
+	struct file *filp;
+	const struct cred *cred;
+};
+
 /** FUSE specific file data */
 struct fuse_file {
 	/** Fuse connection for this file */
@@ -226,6 +236,9 @@ struct fuse_file {
 
 	/** Has flock been performed on this file? */
 	bool flock:1;
+
+	/** Backing file for FUSE_PASSTHROUGH, filp is NULL if unused */
+	struct fuse_passthrough passthrough;
 };
 
 /** One input argument of a request */
@@ -371,6 +384,9 @@ struct fuse_req {
 	void *argbuf;
 #endif
 
+	/** Per-CPU input queue this request is pending on, NULL if fiq */
+	struct fuse_iqueue_cpu *ciq;
+
 	/** fuse_mount this request belongs to */
 	struct fuse_mount *fm;
 };
@@ -424,7 +440,7 @@ struct fuse_iqueue {
 	wait_queue_head_t waitq;
 
 	/** The next unique request id */
-	u64 reqctr;
+	atomic64_t reqctr;
 
 	/** The list of pending requests */
 	struct list_head pending;
@@ -449,6 +465,31 @@ struct fuse_iqueue {
 	void *priv;
 };
 
+/**
+ * Per-CPU input queue
+ *
+ * Requests submitted on a CPU that has a /dev/fuse reader bound to it with
+ * FUSE_DEV_IOC_BIND_CPU are queued here instead of on fiq->pending, so that
+ * submitters and readers on different CPUs don't contend on fiq->lock.
+ * Interrupts and forgets always go through the shared fuse_iqueue.
+ */
+struct fuse_iqueue_cpu {
+	/** Lock protecting accesses to members of this structure */
+	spinlock_t lock;
+
+	/** Connection established */
+	unsigned connected;
+
+	/** Number of devices bound to this CPU */
+	unsigned int nr_readers;
+
+	/** Bound readers are waiting on this */
+	wait_queue_head_t waitq;
+
+	/** The list of pending requests */
+	struct list_head pending;
+};
+
 #define FUSE_PQ_HASH_BITS 8
 #define FUSE_PQ_HASH_SIZE (1 << FUSE_PQ_HASH_BITS)
 
@@ -466,6 +507,8 @@ struct fuse_pqueue {
 	struct list_head io;
 };
 
+struct fuse_ring;
+
 /**
  * Fuse device instance
  */
@@ -476,6 +519,12 @@ struct fuse_dev {
 	/** Processing queue */
 	struct fuse_pqueue pq;
 
+	/** Per-CPU input queue this device is bound to, or NULL */
+	struct fuse_iqueue_cpu *ciq;
+
+	/** Shared memory request ring, or NULL */
+	struct fuse_ring *ring;
+
 	/** list entry on fc->devices */
 	struct list_head entry;
 };
@@ -562,6 +611,9 @@ struct fuse_conn {
 	/** Input queue */
 	struct fuse_iqueue iq;
 
+	/** Per-CPU input queues, allocated when a device is first bound */
+	struct fuse_iqueue_cpu __percpu *iq_cpu;
+
 	/** The next unique kernel file handle */
 	atomic64_t khctr;
 
@@ -765,6 +817,13 @@ struct fuse_conn {
 	/* Propagate syncfs() to server */
 	unsigned int sync_fs:1;
 
+	/** Passthrough of read/write/mmap to a backing file negotiated */
+	unsigned int passthrough:1;
+
+	/** Backing files registered but not yet claimed by an open */
+	struct idr passthrough_req;
+	spinlock_t passthrough_req_lock;
+
 	/** The number of requests waiting for completion */
 	atomic_t num_waiting;
 
@@ -1274,6 +1333,16 @@ int fuse_fileattr_get(struct dentry *dentry, struct fileattr *fa);
 int fuse_fileattr_set(struct user_namespace *mnt_userns,
 		      struct dentry *dentry, struct fileattr *fa);
 
+/* passthrough.c */
+int fuse_passthrough_open(struct fuse_dev *fud, u32 fd);
+int fuse_passthrough_setup(struct fuse_conn *fc, struct fuse_file *ff,
+			   struct fuse_open_out *openarg);
+void fuse_passthrough_release(struct fuse_passthrough *passthrough);
+void fuse_passthrough_conn_free(struct fuse_conn *fc);
+ssize_t fuse_passthrough_read_iter(struct kiocb *iocb, struct iov_iter *to);
+ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *from);
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma);
+
 /* file.c */
 
 struct fuse_file *fuse_file_open(struct fuse_mount *fm, u64 nodeid,
@@ -0,0 +1,292 @@
+// SPDX-License-Identifier: GPL-2.0
+
+/*
+ * FUSE passthrough: reads, writes and mmaps of a file the daemon opened
+ * with a passthrough_fh are served directly from the backing file it
+ * registered, instead of taking a round trip through the daemon.
+ */
+
+#include "fuse_i.h"
+
+#include <linux/file.h>
+#include <linux/uio.h>
+
+struct fuse_aio_req {
+	struct kiocb iocb;
+	struct kiocb *iocb_fuse;
+};
+
+static rwf_t fuse_iocb_to_rwf(int ifl)
+{
+	rwf_t flags = 0;
+
+	if (ifl & IOCB_NOWAIT)
+		flags |= RWF_NOWAIT;
+	if (ifl & IOCB_HIPRI)
+		flags |= RWF_HIPRI;
+	if (ifl & IOCB_DSYNC)
+		flags |= RWF_DSYNC;
+	if (ifl & IOCB_SYNC)
+		flags |= RWF_SYNC;
+
+	return flags;
+}
+
+/* Writes through the backing file may extend it */
+static void fuse_copyattr(struct file *fuse_filp, struct file *backing_filp)
+{
+	struct inode *dst = file_inode(fuse_filp);
+	struct inode *src = file_inode(backing_filp);
+
+	i_size_write(dst, i_size_read(src));
+}
+
+static void fuse_aio_cleanup_handler(struct fuse_aio_req *aio_req)
+{
+	struct kiocb *iocb = &aio_req->iocb;
+	struct kiocb *iocb_fuse = aio_req->iocb_fuse;
+
+	if (iocb->ki_flags & IOCB_WRITE) {
+		/* Actually acquired in fuse_passthrough_write_iter() */
+		__sb_writers_acquired(file_inode(iocb->ki_filp)->i_sb,
+				      SB_FREEZE_WRITE);
+		file_end_write(iocb->ki_filp);
+		fuse_copyattr(iocb_fuse->ki_filp, iocb->ki_filp);
+	}
+
+	iocb_fuse->ki_pos = iocb->ki_pos;
+	kfree(aio_req);
+}
+
+static void fuse_aio_rw_complete(struct kiocb *iocb, long res, long res2)
+{
+	struct fuse_aio_req *aio_req =
+		container_of(iocb, struct fuse_aio_req, iocb);
+	struct kiocb *iocb_fuse = aio_req->iocb_fuse;
+
+	fuse_aio_cleanup_handler(aio_req);
+	iocb_fuse->ki_complete(iocb_fuse, res, res2);
+}
+
+static bool fuse_passthrough_dio_ok(struct kiocb *iocb, struct file *filp)
+{
+	return !(iocb->ki_flags & IOCB_DIRECT) ||
+	       (filp->f_mapping->a_ops && filp->f_mapping->a_ops->direct_IO);
+}
+
+ssize_t fuse_passthrough_read_iter(struct kiocb *iocb_fuse,
+				   struct iov_iter *iter)
+{
+	struct file *fuse_filp = iocb_fuse->ki_filp;
+	struct fuse_file *ff = fuse_filp->private_data;
+	struct file *backing_filp = ff->passthrough.filp;
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	if (!iov_iter_count(iter))
+		return 0;
+
+	if (!fuse_passthrough_dio_ok(iocb_fuse, backing_filp))
+		return -EINVAL;
+
+	old_cred = override_creds(ff->passthrough.cred);
+	if (is_sync_kiocb(iocb_fuse)) {
+		ret = vfs_iter_read(backing_filp, iter, &iocb_fuse->ki_pos,
+				    fuse_iocb_to_rwf(iocb_fuse->ki_flags));
+	} else {
+		struct fuse_aio_req *aio_req;
+
+		ret = -ENOMEM;
+		aio_req = kzalloc(sizeof(*aio_req), GFP_KERNEL);
+		if (!aio_req)
+			goto out;
+
+		aio_req->iocb_fuse = iocb_fuse;
+		kiocb_clone(&aio_req->iocb, iocb_fuse, backing_filp);
+		aio_req->iocb.ki_complete = fuse_aio_rw_complete;
+		ret = vfs_iocb_iter_read(backing_filp, &aio_req->iocb, iter);
+		if (ret != -EIOCBQUEUED)
+			fuse_aio_cleanup_handler(aio_req);
+	}
+out:
+	revert_creds(old_cred);
+	file_accessed(fuse_filp);
+
+	return ret;
+}
+
+ssize_t fuse_passthrough_write_iter(struct kiocb *iocb_fuse,
+				    struct iov_iter *iter)
+{
+	struct file *fuse_filp = iocb_fuse->ki_filp;
+	struct fuse_file *ff = fuse_filp->private_data;
+	struct inode *fuse_inode = file_inode(fuse_filp);
+	struct file *backing_filp = ff->passthrough.filp;
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	if (!iov_iter_count(iter))
+		return 0;
+
+	if (!fuse_passthrough_dio_ok(iocb_fuse, backing_filp))
+		return -EINVAL;
+
+	inode_lock(fuse_inode);
+	fuse_copyattr(fuse_filp, backing_filp);
+
+	old_cred = override_creds(ff->passthrough.cred);
+	if (is_sync_kiocb(iocb_fuse)) {
+		file_start_write(backing_filp);
+		ret = vfs_iter_write(backing_filp, iter, &iocb_fuse->ki_pos,
+				     fuse_iocb_to_rwf(iocb_fuse->ki_flags));
+		file_end_write(backing_filp);
+		if (ret > 0)
+			fuse_copyattr(fuse_filp, backing_filp);
+	} else {
+		struct fuse_aio_req *aio_req;
+
+		ret = -ENOMEM;
+		aio_req = kzalloc(sizeof(*aio_req), GFP_KERNEL);
+		if (!aio_req)
+			goto out;
+
+		file_start_write(backing_filp);
+		/* Pacify lockdep, same trick as done in aio_write() */
+		__sb_writers_release(file_inode(backing_filp)->i_sb,
+				     SB_FREEZE_WRITE);
+		aio_req->iocb_fuse = iocb_fuse;
+		kiocb_clone(&aio_req->iocb, iocb_fuse, backing_filp);
+		aio_req->iocb.ki_complete = fuse_aio_rw_complete;
+		ret = vfs_iocb_iter_write(backing_filp, &aio_req->iocb, iter);
+		if (ret != -EIOCBQUEUED)
+			fuse_aio_cleanup_handler(aio_req);
+	}
+out:
+	revert_creds(old_cred);
+	inode_unlock(fuse_inode);
+
+	return ret;
+}
+
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct fuse_file *ff = file->private_data;
+	struct file *backing_filp = ff->passthrough.filp;
+	const struct cred *old_cred;
+	int ret;
+
+	if (!backing_filp->f_op->mmap)
+		return -ENODEV;
+
+	if (WARN_ON(file != vma->vm_file))
+		return -EIO;
+
+	vma_set_file(vma, backing_filp);
+
+	old_cred = override_creds(ff->passthrough.cred);
+	ret = call_mmap(vma->vm_file, vma);
+	revert_creds(old_cred);
+	file_accessed(file);
+
+	return ret;
+}
+
+/*
+ * Called from the FUSE_DEV_IOC_PASSTHROUGH_OPEN ioctl: takes a reference
+ * on the daemon's @fd and returns an identifier for it, which the daemon
+ * then hands back in the reply to FUSE_OPEN or FUSE_CREATE.
+ */
+int fuse_passthrough_open(struct fuse_dev *fud, u32 fd)
+{
+	struct fuse_conn *fc = fud->fc;
+	struct fuse_passthrough *passthrough;
+	struct file *backing_filp;
+	int res;
+
+	if (!fc->passthrough)
+		return -EPERM;
+
+	backing_filp = fget(fd);
+	if (!backing_filp)
+		return -EBADF;
+
+	res = -EINVAL;
+	if (!backing_filp->f_op->read_iter ||
+	    !backing_filp->f_op->write_iter)
+		goto out_fput;
+
+	/* Don't build an unbounded stack of passthrough filesystems */
+	if (file_inode(backing_filp)->i_sb->s_stack_depth >=
+	    FILESYSTEM_MAX_STACK_DEPTH)
+		goto out_fput;
+
+	res = -ENOMEM;
+	passthrough = kmalloc(sizeof(*passthrough), GFP_KERNEL);
+	if (!passthrough)
+		goto out_fput;
+
+	passthrough->filp = backing_filp;
+	passthrough->cred = prepare_creds();
+	if (!passthrough->cred)
+		goto out_free;
+
+	idr_preload(GFP_KERNEL);
+	spin_lock(&fc->passthrough_req_lock);
+	res = idr_alloc(&fc->passthrough_req, passthrough, 1, 0, GFP_ATOMIC);
+	spin_unlock(&fc->passthrough_req_lock);
+	idr_preload_end();
+	if (res > 0)
+		return res;
+
+	put_cred(passthrough->cred);
+out_free:
+	kfree(passthrough);
+out_fput:
+	fput(backing_filp);
+	return res;
+}
+
+int fuse_passthrough_setup(struct fuse_conn *fc, struct fuse_file *ff,
+			   struct fuse_open_out *openarg)
+{
+	struct fuse_passthrough *passthrough;
+
+	if (!fc->passthrough)
+		return -EPERM;
+
+	spin_lock(&fc->passthrough_req_lock);
+	passthrough = idr_remove(&fc->passthrough_req, openarg->passthrough_fh);
+	spin_unlock(&fc->passthrough_req_lock);
+	if (!passthrough)
+		return -EINVAL;
+
+	ff->passthrough = *passthrough;
+	kfree(passthrough);
+	return 0;
+}
+
+void fuse_passthrough_release(struct fuse_passthrough *passthrough)
+{
+	if (passthrough->filp) {
+		fput(passthrough->filp);
+		passthrough->filp = NULL;
+	}
+	if (passthrough->cred) {
+		put_cred(passthrough->cred);
+		passthrough->cred = NULL;
+	}
+}
+
+static int fuse_passthrough_free_req(int id, void *p, void *data)
+{
+	fuse_passthrough_release(p);
+	kfree(p);
+	return 0;
+}
+
+/* Drop backing files the daemon registered but never used */
+void fuse_passthrough_conn_free(struct fuse_conn *fc)
+{
+	idr_for_each(&fc->passthrough_req, fuse_passthrough_free_req, NULL);
+	idr_destroy(&fc->passthrough_req);
+}
@@ -18,6 +18,7 @@
  * Private flags for iomap_dio, must not overlap with the public ones in
  * iomap.h:
  */
+#define IOMAP_DIO_INLINE_COMP	(1 << 27)
 #define IOMAP_DIO_WRITE_FUA	(1 << 28)
 #define IOMAP_DIO_NEED_SYNC	(1 << 29)
 #define IOMAP_DIO_WRITE		(1 << 30)
@@ -49,6 +50,9 @@ struct iomap_dio {
 	};
 };
 
+/* Per-cpu cached bios for polled I/O, see iomap_dio_alloc_bio() */
+static struct bio_set iomap_dio_bioset;
+
 int iomap_dio_iopoll(struct kiocb *kiocb, bool spin)
 {
 	struct request_queue *q = READ_ONCE(kiocb->private);
@@ -59,6 +63,22 @@ int iomap_dio_iopoll(struct kiocb *kiocb, bool spin)
 }
 EXPORT_SYMBOL_GPL(iomap_dio_iopoll);
 
+/*
+ * Bios of polled I/O to a queue that supports polling are completed and
+ * freed from task context, so they can come from the per-cpu bio cache and
+ * skip the mempool allocation.  Everything else uses bio_alloc().
+ */
+static struct bio *iomap_dio_alloc_bio(const struct iomap_iter *iter,
+		struct iomap_dio *dio, unsigned short nr_vecs)
+{
+	struct request_queue *q = bdev_get_queue(iter->iomap.bdev);
+
+	if ((dio->iocb->ki_flags & IOCB_ALLOC_CACHE) &&
+	    test_bit(QUEUE_FLAG_POLL, &q->queue_flags))
+		return bio_alloc_kiocb(dio->iocb, nr_vecs, &iomap_dio_bioset);
+	return bio_alloc(GFP_KERNEL, nr_vecs);
+}
+
 static void iomap_dio_submit_bio(const struct iomap_iter *iter,
 		struct iomap_dio *dio, struct bio *bio, loff_t pos)
 {
@@ -157,17 +177,26 @@ static void iomap_dio_bio_end_io(struct bio *bio)
 		iomap_dio_set_error(dio, blk_status_to_errno(bio->bi_status));
 
 	if (atomic_dec_and_test(&dio->ref)) {
+		struct inode *inode = file_inode(dio->iocb->ki_filp);
+
 		if (dio->wait_for_completion) {
 			struct task_struct *waiter = dio->submit.waiter;
 			WRITE_ONCE(dio->submit.waiter, NULL);
 			blk_wake_io_task(waiter);
-		} else if (dio->flags & IOMAP_DIO_WRITE) {
-			struct inode *inode = file_inode(dio->iocb->ki_filp);
-
+		} else if (!(dio->flags & IOMAP_DIO_WRITE) ||
+			   ((dio->flags & IOMAP_DIO_INLINE_COMP) &&
+			    !(dio->flags & IOMAP_DIO_NEED_SYNC) &&
+			    !inode->i_mapping->nrpages)) {
+			/*
+			 * Reads, and writes that need neither extent
+			 * conversion, a cache flush nor page cache
+			 * invalidation, complete right here.
+			 */
+			WRITE_ONCE(dio->iocb->private, NULL);
+			iomap_dio_complete_work(&dio->aio.work);
+		} else {
 			INIT_WORK(&dio->aio.work, iomap_dio_complete_work);
 			queue_work(inode->i_sb->s_dio_done_wq, &dio->aio.work);
-		} else {
-			iomap_dio_complete_work(&dio->aio.work);
 		}
 	}
 
@@ -255,6 +284,15 @@ static loff_t iomap_dio_bio_iter(const struct iomap_iter *iter,
 	if (iomap->flags & IOMAP_F_SHARED)
 		dio->flags |= IOMAP_DIO_COW;
 
+	/*
+	 * Only pure overwrites inside i_size can complete without a trip
+	 * through the workqueue: anything that needs zeroing, extent
+	 * conversion, COW remapping or a size update sleeps on completion.
+	 */
+	if (need_zeroout || (iomap->flags & (IOMAP_F_SHARED | IOMAP_F_NEW)) ||
+	    pos + length > dio->i_size)
+		dio->flags &= ~IOMAP_DIO_INLINE_COMP;
+
 	if (iomap->flags & IOMAP_F_NEW) {
 		need_zeroout = true;
 	} else if (iomap->type == IOMAP_MAPPED) {
@@ -305,7 +343,7 @@ static loff_t iomap_dio_bio_iter(const struct iomap_iter *iter,
 			goto out;
 		}
 
-		bio = bio_alloc(GFP_KERNEL, nr_pages);
+		bio = iomap_dio_alloc_bio(iter, dio, nr_pages);
 		bio_set_dev(bio, iomap->bdev);
 		bio->bi_iter.bi_sector = iomap_sector(iomap, pos);
 		bio->bi_write_hint = dio->iocb->ki_hint;
@@ -527,8 +565,20 @@ __iomap_dio_rw(struct kiocb *iocb, struct iov_iter *iter,
 		 */
 		if ((iocb->ki_flags & (IOCB_DSYNC | IOCB_SYNC)) == IOCB_DSYNC)
 			dio->flags |= IOMAP_DIO_WRITE_FUA;
+
+		/*
+		 * Without an ->end_io there is nothing filesystem specific to
+		 * do on completion; iomap_dio_bio_iter() clears this again for
+		 * extents that need more than the I/O itself.
+		 */
+		if (!dops || !dops->end_io)
+			dio->flags |= IOMAP_DIO_INLINE_COMP;
 	}
 
+	/* Polled bios are freed from task context, see iomap_dio_alloc_bio() */
+	if (iocb->ki_flags & IOCB_HIPRI)
+		iocb->ki_flags |= IOCB_ALLOC_CACHE;
+
 	if (dio_flags & IOMAP_DIO_OVERWRITE_ONLY) {
 		ret = -EAGAIN;
 		if (iomi.pos >= dio->i_size ||
@@ -652,3 +702,10 @@ iomap_dio_rw(struct kiocb *iocb, struct iov_iter *iter,
 	return iomap_dio_complete(dio);
 }
 EXPORT_SYMBOL_GPL(iomap_dio_rw);
+
+static int __init iomap_dio_init(void)
+{
+	return bioset_init(&iomap_dio_bioset, BIO_POOL_SIZE, 0,
+			   BIOSET_NEED_BVECS | BIOSET_PERCPU_CACHE);
+}
+fs_initcall(iomap_dio_init);
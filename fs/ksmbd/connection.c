@@ -48,6 +48,7 @@ void ksmbd_conn_free(struct ksmbd_conn *conn)
  */
 struct ksmbd_conn *ksmbd_conn_alloc(void)
 {
+	static atomic_t conn_seq = ATOMIC_INIT(0);
 	struct ksmbd_conn *conn;
 
 	conn = kzalloc(sizeof(struct ksmbd_conn), GFP_KERNEL);
@@ -62,6 +63,9 @@ struct ksmbd_conn *ksmbd_conn_alloc(void)
 	atomic_set(&conn->req_running, 0);
 	atomic_set(&conn->r_count, 0);
 	conn->total_credits = 1;
+	/* Spread connections, and so the channels of a session, over CPUs */
+	conn->cpu = cpumask_local_spread(atomic_inc_return(&conn_seq),
+					 NUMA_NO_NODE);
 
 	init_waitqueue_head(&conn->req_running_q);
 	INIT_LIST_HEAD(&conn->conns_list);
@@ -176,7 +180,11 @@ int ksmbd_conn_write(struct ksmbd_work *work)
 		len += iov[iov_idx++].iov_len;
 	}
 
-	if (work->aux_payload_sz) {
+	if (work->rdata_nr_bvec) {
+		/* the read data follows from the page cache */
+		iov[iov_idx] = (struct kvec) { rsp_hdr, work->resp_hdr_sz };
+		len += iov[iov_idx++].iov_len;
+	} else if (work->aux_payload_sz) {
 		iov[iov_idx] = (struct kvec) { rsp_hdr, work->resp_hdr_sz };
 		len += iov[iov_idx++].iov_len;
 		iov[iov_idx] = (struct kvec) { work->aux_payload_buf, work->aux_payload_sz };
@@ -191,10 +199,16 @@ int ksmbd_conn_write(struct ksmbd_work *work)
 	}
 
 	ksmbd_conn_lock(conn);
-	sent = conn->transport->ops->writev(conn->transport, &iov[0],
-					iov_idx, len,
-					work->need_invalidate_rkey,
-					work->remote_key);
+	if (work->rdata_nr_bvec)
+		sent = conn->transport->ops->sendpages(conn->transport,
+						       &iov[0], iov_idx, len,
+						       work->rdata_bvec,
+						       work->rdata_nr_bvec);
+	else
+		sent = conn->transport->ops->writev(conn->transport, &iov[0],
+						iov_idx, len,
+						work->need_invalidate_rkey,
+						work->remote_key);
 	ksmbd_conn_unlock(conn);
 
 	if (sent < 0) {
@@ -279,6 +293,7 @@ int ksmbd_conn_handler_loop(void *p)
 
 	mutex_init(&conn->srv_mutex);
 	__module_get(THIS_MODULE);
+	set_cpus_allowed_ptr(current, cpumask_of(conn->cpu));
 
 	if (t->ops->prepare && t->ops->prepare(t))
 		goto out;
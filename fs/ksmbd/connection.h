@@ -52,6 +52,8 @@ struct ksmbd_conn {
 	unsigned int			cli_cap;
 	char				*request_buf;
 	struct ksmbd_transport		*transport;
+	/* CPU the handler thread and request works run on */
+	int				cpu;
 	struct nls_table		*local_nls;
 	struct list_head		conns_list;
 	/* smb session 1 per user */
@@ -126,6 +128,8 @@ struct ksmbd_transport_ops {
 	int (*writev)(struct ksmbd_transport *t, struct kvec *iovs, int niov,
 		      int size, bool need_invalidate_rkey,
 		      unsigned int remote_key);
+	int (*sendpages)(struct ksmbd_transport *t, struct kvec *iovs, int niov,
+			 int size, struct bio_vec *bvec, int nbvec);
 	int (*rdma_read)(struct ksmbd_transport *t, void *buf, unsigned int len,
 			 u32 remote_key, u64 remote_offset, u32 remote_len);
 	int (*rdma_write)(struct ksmbd_transport *t, void *buf,
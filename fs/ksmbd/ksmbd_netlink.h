@@ -51,6 +51,10 @@
  *  - KSMBD_EVENT_SPNEGO_AUTHEN_REQUEST/RESPONSE(ksmbd_spnego_authen_request/response)
  *    This event is to make kerberos authentication to be processed in
  *    userspace.
+ *
+ *  - KSMBD_EVENT_SHARE_STATS_REQUEST/RESPONSE(ksmbd_share_stats_request/response)
+ *    This event is sent by user IPC daemon to read the activity counters
+ *    of a share, ksmbd replies to it directly.
  */
 
 #define KSMBD_GENL_NAME		"SMBD_GENL"
@@ -257,6 +261,27 @@ struct ksmbd_spnego_authen_response {
 	__u8	payload[]; /* session key + AP_REP */
 };
 
+/*
+ * IPC request from user IPC daemon for the counters of a share.
+ */
+struct ksmbd_share_stats_request {
+	__u32	handle;
+	__s8	share_name[KSMBD_REQ_MAX_SHARE_NAME]; /* share name */
+};
+
+/*
+ * IPC response to the share stats request. status is 0 or a negative
+ * errno, -ENOENT if the share has no tree connection.
+ */
+struct ksmbd_share_stats_response {
+	__u32	handle;
+	__s32	status;
+	__u64	tree_connects;	/* tree connects to the share */
+	__u64	opens;		/* files opened on the share */
+	__u64	read_bytes;	/* bytes read by clients */
+	__u64	write_bytes;	/* bytes written by clients */
+};
+
 /*
  * This also used as NETLINK attribute type value.
  *
@@ -290,6 +315,9 @@ enum ksmbd_event {
 	KSMBD_EVENT_SPNEGO_AUTHEN_REQUEST,
 	KSMBD_EVENT_SPNEGO_AUTHEN_RESPONSE	= 15,
 
+	KSMBD_EVENT_SHARE_STATS_REQUEST,
+	KSMBD_EVENT_SHARE_STATS_RESPONSE,
+
 	KSMBD_EVENT_MAX
 };
 
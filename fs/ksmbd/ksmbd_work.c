@@ -3,6 +3,7 @@
  *   Copyright (C) 2019 Samsung Electronics Co., Ltd.
  */
 
+#include <linux/bvec.h>
 #include <linux/list.h>
 #include <linux/mm.h>
 #include <linux/slab.h>
@@ -37,6 +38,7 @@ void ksmbd_free_work_struct(struct ksmbd_work *work)
 
 	kvfree(work->response_buf);
 	kvfree(work->aux_payload_buf);
+	ksmbd_work_put_rdata(work);
 	kfree(work->tr_buf);
 	kvfree(work->request_buf);
 	if (work->async_id)
@@ -44,6 +46,18 @@ void ksmbd_free_work_struct(struct ksmbd_work *work)
 	kmem_cache_free(work_cache, work);
 }
 
+/**
+ * ksmbd_work_put_rdata() - drop the page references of a zero-copy read
+ * @work:	smb work holding the read data
+ */
+void ksmbd_work_put_rdata(struct ksmbd_work *work)
+{
+	while (work->rdata_nr_bvec)
+		put_page(work->rdata_bvec[--work->rdata_nr_bvec].bv_page);
+	kvfree(work->rdata_bvec);
+	work->rdata_bvec = NULL;
+}
+
 void ksmbd_work_pool_destroy(void)
 {
 	kmem_cache_destroy(work_cache);
@@ -74,7 +88,16 @@ void ksmbd_workqueue_destroy(void)
 	ksmbd_wq = NULL;
 }
 
+/*
+ * Requests of a connection are run on the CPU its handler thread is bound
+ * to, so that the socket, session and file state of a channel stay in one
+ * CPU's cache and separate channels are spread over the machine.
+ */
 bool ksmbd_queue_work(struct ksmbd_work *work)
 {
+	int cpu = work->conn->cpu;
+
+	if (cpu_online(cpu))
+		return queue_work_on(cpu, ksmbd_wq, &work->work);
 	return queue_work(ksmbd_wq, &work->work);
 }
@@ -9,6 +9,7 @@
 #include <linux/ctype.h>
 #include <linux/workqueue.h>
 
+struct bio_vec;
 struct ksmbd_conn;
 struct ksmbd_session;
 struct ksmbd_tree_connect;
@@ -33,6 +34,9 @@ struct ksmbd_work {
 
 	/* Read data buffer */
 	void                            *aux_payload_buf;
+	/* Read data as page cache references, sent with sendpage */
+	struct bio_vec			*rdata_bvec;
+	unsigned int			rdata_nr_bvec;
 
 	/* Next cmd hdr in compound req buf*/
 	int                             next_smb2_rcv_hdr_off;
@@ -106,6 +110,7 @@ static inline void *ksmbd_req_buf_next(struct ksmbd_work *work)
 
 struct ksmbd_work *ksmbd_alloc_work_struct(void);
 void ksmbd_free_work_struct(struct ksmbd_work *work);
+void ksmbd_work_put_rdata(struct ksmbd_work *work);
 
 void ksmbd_work_pool_destroy(void);
 int ksmbd_work_pool_init(void);
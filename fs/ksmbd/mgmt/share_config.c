@@ -46,6 +46,7 @@ static void kill_share(struct ksmbd_share_config *share)
 
 	if (share->path)
 		path_put(&share->vfs_path);
+	free_percpu(share->stats);
 	kfree(share->name);
 	kfree(share->path);
 	kfree(share);
@@ -133,6 +134,13 @@ static struct ksmbd_share_config *share_config_request(char *name)
 	if (!share)
 		goto out;
 
+	share->stats = alloc_percpu(struct ksmbd_share_stats);
+	if (!share->stats) {
+		kfree(share);
+		share = NULL;
+		goto out;
+	}
+
 	share->flags = resp->flags;
 	atomic_set(&share->refcount, 1);
 	INIT_LIST_HEAD(&share->veto_list);
@@ -211,6 +219,37 @@ struct ksmbd_share_config *ksmbd_share_config_get(char *name)
 	return share_config_request(name);
 }
 
+/*
+ * Sum up the counters of a share.  Only shares with tree connections are
+ * known here; for any other the daemon gets -ENOENT.
+ */
+int ksmbd_share_config_stats(char *name, struct ksmbd_share_stats *stats)
+{
+	struct ksmbd_share_config *share;
+	int cpu;
+
+	strtolower(name);
+	memset(stats, 0, sizeof(*stats));
+
+	down_read(&shares_table_lock);
+	share = __share_lookup(name);
+	if (!share) {
+		up_read(&shares_table_lock);
+		return -ENOENT;
+	}
+
+	for_each_possible_cpu(cpu) {
+		struct ksmbd_share_stats *s = per_cpu_ptr(share->stats, cpu);
+
+		stats->tree_connects += s->tree_connects;
+		stats->opens += s->opens;
+		stats->read_bytes += s->read_bytes;
+		stats->write_bytes += s->write_bytes;
+	}
+	up_read(&shares_table_lock);
+	return 0;
+}
+
 bool ksmbd_share_veto_filename(struct ksmbd_share_config *share,
 			       const char *filename)
 {
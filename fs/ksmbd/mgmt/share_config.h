@@ -9,6 +9,15 @@
 #include <linux/workqueue.h>
 #include <linux/hashtable.h>
 #include <linux/path.h>
+#include <linux/percpu.h>
+
+/* Per-CPU share activity counters, summed up for the IPC daemon */
+struct ksmbd_share_stats {
+	u64			tree_connects;
+	u64			opens;
+	u64			read_bytes;
+	u64			write_bytes;
+};
 
 struct ksmbd_share_config {
 	char			*name;
@@ -28,8 +37,13 @@ struct ksmbd_share_config {
 	unsigned short		force_directory_mode;
 	unsigned short		force_uid;
 	unsigned short		force_gid;
+
+	struct ksmbd_share_stats __percpu *stats;
 };
 
+#define ksmbd_share_stats_add(share, field, val)		\
+	this_cpu_add((share)->stats->field, (val))
+
 #define KSMBD_SHARE_INVALID_UID	((__u16)-1)
 #define KSMBD_SHARE_INVALID_GID	((__u16)-1)
 
@@ -74,6 +88,7 @@ static inline void ksmbd_share_config_put(struct ksmbd_share_config *share)
 }
 
 struct ksmbd_share_config *ksmbd_share_config_get(char *name);
+int ksmbd_share_config_stats(char *name, struct ksmbd_share_stats *stats);
 bool ksmbd_share_veto_filename(struct ksmbd_share_config *share,
 			       const char *filename);
 void ksmbd_share_configs_cleanup(void);
@@ -5,6 +5,7 @@
  */
 
 #include <linux/moduleparam.h>
+#include <linux/jhash.h>
 
 #include "glob.h"
 #include "oplock.h"
@@ -16,9 +17,36 @@
 #include "mgmt/share_config.h"
 #include "mgmt/tree_connect.h"
 
-static LIST_HEAD(lease_table_list);
+#define LEASE_TABLE_HASH_BITS	6
+
+/* Per-client lease tables, hashed by client GUID */
+static DEFINE_HASHTABLE(lease_table_hash, LEASE_TABLE_HASH_BITS);
 static DEFINE_RWLOCK(lease_list_lock);
 
+static u32 lease_guid_hash(const char *client_guid)
+{
+	return jhash(client_guid, SMB2_CLIENT_GUID_SIZE, 0);
+}
+
+static u32 lease_key_hash(const char *lease_key)
+{
+	return jhash(lease_key, SMB2_LEASE_KEY_SIZE, 0);
+}
+
+/* Called with lease_list_lock held */
+static struct lease_table *lease_table_lookup(const char *client_guid)
+{
+	struct lease_table *lb;
+
+	hash_for_each_possible(lease_table_hash, lb, l_entry,
+			       lease_guid_hash(client_guid)) {
+		if (!memcmp(lb->client_guid, client_guid,
+			    SMB2_CLIENT_GUID_SIZE))
+			return lb;
+	}
+	return NULL;
+}
+
 /**
  * alloc_opinfo() - allocate a new opinfo object for oplock info
  * @work:	smb work
@@ -59,7 +87,8 @@ static void lease_add_list(struct oplock_info *opinfo)
 	struct lease_table *lb = opinfo->o_lease->l_lb;
 
 	spin_lock(&lb->lb_lock);
-	list_add_rcu(&opinfo->lease_entry, &lb->lease_list);
+	hash_add_rcu(lb->lease_hash, &opinfo->lease_entry,
+		     lease_key_hash(opinfo->o_lease->lease_key));
 	spin_unlock(&lb->lb_lock);
 }
 
@@ -71,23 +100,16 @@ static void lease_del_list(struct oplock_info *opinfo)
 		return;
 
 	spin_lock(&lb->lb_lock);
-	if (list_empty(&opinfo->lease_entry)) {
+	if (hlist_unhashed(&opinfo->lease_entry)) {
 		spin_unlock(&lb->lb_lock);
 		return;
 	}
 
-	list_del_init(&opinfo->lease_entry);
+	hash_del_rcu(&opinfo->lease_entry);
 	opinfo->o_lease->l_lb = NULL;
 	spin_unlock(&lb->lb_lock);
 }
 
-static void lb_add(struct lease_table *lb)
-{
-	write_lock(&lease_list_lock);
-	list_add(&lb->l_entry, &lease_table_list);
-	write_unlock(&lease_list_lock);
-}
-
 static int alloc_lease(struct oplock_info *opinfo, struct lease_ctx_info *lctx)
 {
 	struct lease *lease;
@@ -104,7 +126,7 @@ static int alloc_lease(struct oplock_info *opinfo, struct lease_ctx_info *lctx)
 	memcpy(lease->parent_lease_key, lctx->parent_lease_key, SMB2_LEASE_KEY_SIZE);
 	lease->version = lctx->version;
 	lease->epoch = 0;
-	INIT_LIST_HEAD(&opinfo->lease_entry);
+	INIT_HLIST_NODE(&opinfo->lease_entry);
 	opinfo->o_lease = lease;
 
 	return 0;
@@ -494,21 +516,18 @@ static struct oplock_info *same_client_has_lease(struct ksmbd_inode *ci,
 	 * Compare lease key and client_guid to know request from same owner
 	 * of same client
 	 */
-	read_lock(&ci->m_lock);
-	list_for_each_entry(opinfo, &ci->m_op_list, op_entry) {
+	rcu_read_lock();
+	list_for_each_entry_rcu(opinfo, &ci->m_op_list, op_entry) {
 		if (!opinfo->is_lease)
 			continue;
-		read_unlock(&ci->m_lock);
 		lease = opinfo->o_lease;
 
 		ret = compare_guid_key(opinfo, client_guid, lctx->lease_key);
 		if (ret) {
 			m_opinfo = opinfo;
 			/* skip upgrading lease about breaking lease */
-			if (atomic_read(&opinfo->breaking_cnt)) {
-				read_lock(&ci->m_lock);
+			if (atomic_read(&opinfo->breaking_cnt))
 				continue;
-			}
 
 			/* upgrading lease */
 			if ((atomic_read(&ci->op_count) +
@@ -532,9 +551,8 @@ static struct oplock_info *same_client_has_lease(struct ksmbd_inode *ci,
 			    SMB2_LEASE_NONE_LE)
 				lease_none_upgrade(opinfo, lctx->req_state);
 		}
-		read_lock(&ci->m_lock);
 	}
-	read_unlock(&ci->m_lock);
+	rcu_read_unlock();
 
 	return m_opinfo;
 }
@@ -927,29 +945,21 @@ static int oplock_break(struct oplock_info *brk_opinfo, int req_op_level)
 
 void destroy_lease_table(struct ksmbd_conn *conn)
 {
-	struct lease_table *lb, *lbtmp;
+	struct lease_table *lb;
 	struct oplock_info *opinfo;
+	struct hlist_node *tmp, *otmp;
+	int bkt, obkt;
 
 	write_lock(&lease_list_lock);
-	if (list_empty(&lease_table_list)) {
-		write_unlock(&lease_list_lock);
-		return;
-	}
-
-	list_for_each_entry_safe(lb, lbtmp, &lease_table_list, l_entry) {
+	hash_for_each_safe(lease_table_hash, bkt, tmp, lb, l_entry) {
 		if (conn && memcmp(lb->client_guid, conn->ClientGUID,
 				   SMB2_CLIENT_GUID_SIZE))
 			continue;
-again:
-		rcu_read_lock();
-		list_for_each_entry_rcu(opinfo, &lb->lease_list,
-					lease_entry) {
-			rcu_read_unlock();
+
+		hash_for_each_safe(lb->lease_hash, obkt, otmp, opinfo,
+				   lease_entry)
 			lease_del_list(opinfo);
-			goto again;
-		}
-		rcu_read_unlock();
-		list_del(&lb->l_entry);
+		hash_del(&lb->l_entry);
 		kfree(lb);
 	}
 	write_unlock(&lease_list_lock);
@@ -966,23 +976,15 @@ int find_same_lease_key(struct ksmbd_session *sess, struct ksmbd_inode *ci,
 		return err;
 
 	read_lock(&lease_list_lock);
-	if (list_empty(&lease_table_list)) {
+	lb = lease_table_lookup(sess->conn->ClientGUID);
+	if (!lb) {
 		read_unlock(&lease_list_lock);
 		return 0;
 	}
 
-	list_for_each_entry(lb, &lease_table_list, l_entry) {
-		if (!memcmp(lb->client_guid, sess->conn->ClientGUID,
-			    SMB2_CLIENT_GUID_SIZE))
-			goto found;
-	}
-	read_unlock(&lease_list_lock);
-
-	return 0;
-
-found:
 	rcu_read_lock();
-	list_for_each_entry_rcu(opinfo, &lb->lease_list, lease_entry) {
+	hash_for_each_possible_rcu(lb->lease_hash, opinfo, lease_entry,
+				   lease_key_hash(lctx->lease_key)) {
 		if (!atomic_inc_not_zero(&opinfo->refcount))
 			continue;
 		rcu_read_unlock();
@@ -1023,31 +1025,40 @@ static void copy_lease(struct oplock_info *op1, struct oplock_info *op2)
 
 static int add_lease_global_list(struct oplock_info *opinfo)
 {
-	struct lease_table *lb;
+	struct lease_table *lb, *new_lb;
 
 	read_lock(&lease_list_lock);
-	list_for_each_entry(lb, &lease_table_list, l_entry) {
-		if (!memcmp(lb->client_guid, opinfo->conn->ClientGUID,
-			    SMB2_CLIENT_GUID_SIZE)) {
-			opinfo->o_lease->l_lb = lb;
-			lease_add_list(opinfo);
-			read_unlock(&lease_list_lock);
-			return 0;
-		}
+	lb = lease_table_lookup(opinfo->conn->ClientGUID);
+	if (lb) {
+		opinfo->o_lease->l_lb = lb;
+		lease_add_list(opinfo);
+		read_unlock(&lease_list_lock);
+		return 0;
 	}
 	read_unlock(&lease_list_lock);
 
-	lb = kmalloc(sizeof(struct lease_table), GFP_KERNEL);
-	if (!lb)
+	new_lb = kmalloc(sizeof(struct lease_table), GFP_KERNEL);
+	if (!new_lb)
 		return -ENOMEM;
 
-	memcpy(lb->client_guid, opinfo->conn->ClientGUID,
+	memcpy(new_lb->client_guid, opinfo->conn->ClientGUID,
 	       SMB2_CLIENT_GUID_SIZE);
-	INIT_LIST_HEAD(&lb->lease_list);
-	spin_lock_init(&lb->lb_lock);
+	hash_init(new_lb->lease_hash);
+	spin_lock_init(&new_lb->lb_lock);
+
+	write_lock(&lease_list_lock);
+	lb = lease_table_lookup(opinfo->conn->ClientGUID);
+	if (!lb) {
+		lb = new_lb;
+		new_lb = NULL;
+		hash_add(lease_table_hash, &lb->l_entry,
+			 lease_guid_hash(lb->client_guid));
+	}
 	opinfo->o_lease->l_lb = lb;
 	lease_add_list(opinfo);
-	lb_add(lb);
+	write_unlock(&lease_list_lock);
+
+	kfree(new_lb);
 	return 0;
 }
 
@@ -1662,18 +1673,15 @@ struct oplock_info *lookup_lease_in_table(struct ksmbd_conn *conn,
 	int ret;
 
 	read_lock(&lease_list_lock);
-	list_for_each_entry(lt, &lease_table_list, l_entry) {
-		if (!memcmp(lt->client_guid, conn->ClientGUID,
-			    SMB2_CLIENT_GUID_SIZE))
-			goto found;
+	lt = lease_table_lookup(conn->ClientGUID);
+	if (!lt) {
+		read_unlock(&lease_list_lock);
+		return NULL;
 	}
 
-	read_unlock(&lease_list_lock);
-	return NULL;
-
-found:
 	rcu_read_lock();
-	list_for_each_entry_rcu(opinfo, &lt->lease_list, lease_entry) {
+	hash_for_each_possible_rcu(lt->lease_hash, opinfo, lease_entry,
+				   lease_key_hash(lease_key)) {
 		if (!atomic_inc_not_zero(&opinfo->refcount))
 			continue;
 		rcu_read_unlock();
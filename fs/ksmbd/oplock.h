@@ -7,6 +7,8 @@
 #ifndef __KSMBD_OPLOCK_H
 #define __KSMBD_OPLOCK_H
 
+#include <linux/hashtable.h>
+
 #include "smb_common.h"
 
 #define OPLOCK_WAIT_TIME	(35 * HZ)
@@ -39,10 +41,13 @@ struct lease_ctx_info {
 	int			version;
 };
 
+#define LEASE_HASH_BITS		5
+
+/* Leases of one client, hashed by lease key */
 struct lease_table {
 	char			client_guid[SMB2_CLIENT_GUID_SIZE];
-	struct list_head	lease_list;
-	struct list_head	l_entry;
+	DECLARE_HASHTABLE(lease_hash, LEASE_HASH_BITS);
+	struct hlist_node	l_entry;
 	spinlock_t		lb_lock;
 };
 
@@ -75,7 +80,7 @@ struct oplock_info {
 	struct lease		*o_lease;
 	struct list_head        interim_list;
 	struct list_head        op_entry;
-	struct list_head        lease_entry;
+	struct hlist_node	lease_entry;
 	wait_queue_head_t oplock_q; /* Other server threads */
 	wait_queue_head_t oplock_brk; /* oplock breaking wait */
 	struct rcu_head		rcu_head;
@@ -6117,6 +6117,28 @@ static ssize_t smb2_read_rdma_channel(struct ksmbd_work *work,
 	return length;
 }
 
+/*
+ * The read data can only be sent straight from the page cache when nothing
+ * has to be computed over the response after the read: it must not be
+ * signed or encrypted, nor be padded or followed by another response of a
+ * compound.  RDMA channels do their own data placement.
+ */
+static bool smb2_read_can_splice(struct ksmbd_work *work,
+				 struct smb2_read_req *req)
+{
+	if (!work->conn->transport->ops->sendpages)
+		return false;
+
+	if (req->Channel != SMB2_CHANNEL_NONE)
+		return false;
+
+	if (work->encrypted || work->sess->sign ||
+	    smb2_is_sign_req(work, SMB2_READ_HE))
+		return false;
+
+	return !work->next_smb2_rcv_hdr_off && !req->hdr.NextCommand;
+}
+
 /**
  * smb2_read() - handler for smb2 read from file
  * @work:	smb work containing read command buffer
@@ -6170,13 +6192,20 @@ int smb2_read(struct ksmbd_work *work)
 	ksmbd_debug(SMB, "filename %pd, offset %lld, len %zu\n",
 		    fp->filp->f_path.dentry, offset, length);
 
-	work->aux_payload_buf = kvmalloc(length, GFP_KERNEL | __GFP_ZERO);
-	if (!work->aux_payload_buf) {
-		err = -ENOMEM;
-		goto out;
-	}
+	nbytes = -EOPNOTSUPP;
+	if (smb2_read_can_splice(work, req))
+		nbytes = ksmbd_vfs_splice_read(work, fp, length, &offset);
 
-	nbytes = ksmbd_vfs_read(work, fp, length, &offset);
+	if (nbytes == -EOPNOTSUPP) {
+		work->aux_payload_buf = kvmalloc(length,
+						 GFP_KERNEL | __GFP_ZERO);
+		if (!work->aux_payload_buf) {
+			err = -ENOMEM;
+			goto out;
+		}
+
+		nbytes = ksmbd_vfs_read(work, fp, length, &offset);
+	}
 	if (nbytes < 0) {
 		err = nbytes;
 		goto out;
@@ -6185,6 +6214,7 @@ int smb2_read(struct ksmbd_work *work)
 	if ((nbytes == 0 && length != 0) || nbytes < mincount) {
 		kvfree(work->aux_payload_buf);
 		work->aux_payload_buf = NULL;
+		ksmbd_work_put_rdata(work);
 		rsp->hdr.Status = STATUS_END_OF_FILE;
 		smb2_set_err_rsp(work);
 		ksmbd_fd_put(work, fp);
@@ -6220,6 +6250,8 @@ int smb2_read(struct ksmbd_work *work)
 	work->resp_hdr_sz = get_rfc1002_len(rsp_org) + 4;
 	work->aux_payload_sz = nbytes;
 	inc_rfc1001_len(rsp_org, nbytes);
+	ksmbd_share_stats_add(work->tcon->share_conf, read_bytes,
+			      nbytes + remain_bytes);
 	ksmbd_fd_put(work, fp);
 	return 0;
 
@@ -6469,6 +6501,7 @@ int smb2_write(struct ksmbd_work *work)
 	rsp->DataRemaining = 0;
 	rsp->Reserved2 = 0;
 	inc_rfc1001_len(rsp_org, 16);
+	ksmbd_share_stats_add(work->tcon->share_conf, write_bytes, nbytes);
 	ksmbd_fd_put(work, fp);
 	return 0;
 
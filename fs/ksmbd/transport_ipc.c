@@ -71,6 +71,8 @@ static struct delayed_work ipc_timer_work;
 static int handle_startup_event(struct sk_buff *skb, struct genl_info *info);
 static int handle_unsupported_event(struct sk_buff *skb, struct genl_info *info);
 static int handle_generic_event(struct sk_buff *skb, struct genl_info *info);
+static int handle_share_stats_event(struct sk_buff *skb,
+				    struct genl_info *info);
 static int ksmbd_ipc_heartbeat_request(void);
 
 static const struct nla_policy ksmbd_nl_policy[KSMBD_EVENT_MAX] = {
@@ -118,6 +120,12 @@ static const struct nla_policy ksmbd_nl_policy[KSMBD_EVENT_MAX] = {
 	},
 	[KSMBD_EVENT_SPNEGO_AUTHEN_RESPONSE] = {
 	},
+	[KSMBD_EVENT_SHARE_STATS_REQUEST] = {
+		.len = sizeof(struct ksmbd_share_stats_request),
+	},
+	[KSMBD_EVENT_SHARE_STATS_RESPONSE] = {
+		.len = sizeof(struct ksmbd_share_stats_response),
+	},
 };
 
 static struct genl_ops ksmbd_genl_ops[] = {
@@ -185,6 +193,14 @@ static struct genl_ops ksmbd_genl_ops[] = {
 		.cmd	= KSMBD_EVENT_SPNEGO_AUTHEN_RESPONSE,
 		.doit	= handle_generic_event,
 	},
+	{
+		.cmd	= KSMBD_EVENT_SHARE_STATS_REQUEST,
+		.doit	= handle_share_stats_event,
+	},
+	{
+		.cmd	= KSMBD_EVENT_SHARE_STATS_RESPONSE,
+		.doit	= handle_unsupported_event,
+	},
 };
 
 static struct genl_family ksmbd_genl_family = {
@@ -410,6 +426,63 @@ static int handle_generic_event(struct sk_buff *skb, struct genl_info *info)
 	return handle_response(type, payload, sz);
 }
 
+static int handle_share_stats_event(struct sk_buff *skb,
+				    struct genl_info *info)
+{
+	struct ksmbd_share_stats_request *req;
+	struct ksmbd_share_stats_response *resp;
+	struct ksmbd_share_stats stats;
+	char name[KSMBD_REQ_MAX_SHARE_NAME];
+	struct sk_buff *msg;
+	struct nlattr *attr;
+	void *hdr;
+
+#ifdef CONFIG_SMB_SERVER_CHECK_CAP_NET_ADMIN
+	if (!netlink_capable(skb, CAP_NET_ADMIN))
+		return -EPERM;
+#endif
+
+	if (!ksmbd_ipc_validate_version(info))
+		return -EINVAL;
+
+	if (!info->attrs[KSMBD_EVENT_SHARE_STATS_REQUEST])
+		return -EINVAL;
+
+	req = nla_data(info->attrs[KSMBD_EVENT_SHARE_STATS_REQUEST]);
+	strscpy(name, req->share_name, sizeof(name));
+
+	msg = genlmsg_new(sizeof(*resp), GFP_KERNEL);
+	if (!msg)
+		return -ENOMEM;
+
+	hdr = genlmsg_put_reply(msg, info, &ksmbd_genl_family, 0,
+				KSMBD_EVENT_SHARE_STATS_RESPONSE);
+	if (!hdr)
+		goto out;
+
+	attr = nla_reserve(msg, KSMBD_EVENT_SHARE_STATS_RESPONSE,
+			   sizeof(*resp));
+	if (!attr) {
+		genlmsg_cancel(msg, hdr);
+		goto out;
+	}
+
+	resp = nla_data(attr);
+	resp->handle = req->handle;
+	resp->status = ksmbd_share_config_stats(name, &stats);
+	resp->tree_connects = stats.tree_connects;
+	resp->opens = stats.opens;
+	resp->read_bytes = stats.read_bytes;
+	resp->write_bytes = stats.write_bytes;
+
+	genlmsg_end(msg, hdr);
+	return genlmsg_reply(msg, info);
+
+out:
+	nlmsg_free(msg);
+	return -EMSGSIZE;
+}
+
 static int ipc_msg_send(struct ksmbd_ipc_msg *msg)
 {
 	struct genlmsghdr *nlh;
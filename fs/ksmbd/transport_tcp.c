@@ -362,6 +362,40 @@ static int ksmbd_tcp_writev(struct ksmbd_transport *t, struct kvec *iov,
 	return kernel_sendmsg(TCP_TRANS(t)->sock, &smb_msg, iov, nvecs, size);
 }
 
+/*
+ * Send the response header followed by file data straight from the page
+ * cache, so that reads are not copied through an intermediate buffer.
+ */
+static int ksmbd_tcp_sendpages(struct ksmbd_transport *t, struct kvec *iov,
+			       int nvecs, int size, struct bio_vec *bvec,
+			       int nbvec)
+{
+	struct socket *sock = TCP_TRANS(t)->sock;
+	struct msghdr smb_msg = {.msg_flags = MSG_NOSIGNAL | MSG_MORE};
+	int i, sent, total;
+
+	total = kernel_sendmsg(sock, &smb_msg, iov, nvecs, size);
+	if (total != size)
+		return total < 0 ? total : -EIO;
+
+	for (i = 0; i < nbvec; i++) {
+		int flags = MSG_NOSIGNAL | (i < nbvec - 1 ? MSG_MORE : 0);
+		unsigned int offset = bvec[i].bv_offset;
+		unsigned int len = bvec[i].bv_len;
+
+		while (len) {
+			sent = kernel_sendpage(sock, bvec[i].bv_page, offset,
+					       len, flags);
+			if (sent <= 0)
+				return sent < 0 ? sent : -EIO;
+			offset += sent;
+			len -= sent;
+			total += sent;
+		}
+	}
+	return total;
+}
+
 static void ksmbd_tcp_disconnect(struct ksmbd_transport *t)
 {
 	free_transport(TCP_TRANS(t));
@@ -614,5 +648,6 @@ int ksmbd_tcp_set_interfaces(char *ifc_list, int ifc_list_sz)
 static struct ksmbd_transport_ops ksmbd_tcp_transport_ops = {
 	.read		= ksmbd_tcp_read,
 	.writev		= ksmbd_tcp_writev,
+	.sendpages	= ksmbd_tcp_sendpages,
 	.disconnect	= ksmbd_tcp_disconnect,
 };
@@ -18,6 +18,7 @@
 #include <linux/vmalloc.h>
 #include <linux/sched/xacct.h>
 #include <linux/crc32c.h>
+#include <linux/splice.h>
 
 #include "../internal.h"	/* for vfs_path_lookup */
 
@@ -362,6 +363,35 @@ static int check_lock_range(struct file *filp, loff_t start, loff_t end,
  *
  * Return:	number of read bytes on success, otherwise error
  */
+static int ksmbd_vfs_check_read_access(struct ksmbd_work *work,
+				       struct ksmbd_file *fp)
+{
+	if (work->conn->connection_type) {
+		if (!(fp->daccess & (FILE_READ_DATA_LE | FILE_EXECUTE_LE))) {
+			pr_err("no right to read(%pd)\n",
+			       fp->filp->f_path.dentry);
+			return -EACCES;
+		}
+	}
+	return 0;
+}
+
+static int ksmbd_vfs_check_read_lock(struct ksmbd_work *work,
+				     struct ksmbd_file *fp, loff_t pos,
+				     size_t count)
+{
+	if (!work->tcon->posix_extensions) {
+		int ret;
+
+		ret = check_lock_range(fp->filp, pos, pos + count - 1, READ);
+		if (ret) {
+			pr_err("unable to read due to lock\n");
+			return -EAGAIN;
+		}
+	}
+	return 0;
+}
+
 int ksmbd_vfs_read(struct ksmbd_work *work, struct ksmbd_file *fp, size_t count,
 		   loff_t *pos)
 {
@@ -369,6 +399,7 @@ int ksmbd_vfs_read(struct ksmbd_work *work, struct ksmbd_file *fp, size_t count,
 	ssize_t nbytes = 0;
 	char *rbuf = work->aux_payload_buf;
 	struct inode *inode = file_inode(filp);
+	int ret;
 
 	if (S_ISDIR(inode->i_mode))
 		return -EISDIR;
@@ -376,26 +407,16 @@ int ksmbd_vfs_read(struct ksmbd_work *work, struct ksmbd_file *fp, size_t count,
 	if (unlikely(count == 0))
 		return 0;
 
-	if (work->conn->connection_type) {
-		if (!(fp->daccess & (FILE_READ_DATA_LE | FILE_EXECUTE_LE))) {
-			pr_err("no right to read(%pd)\n",
-			       fp->filp->f_path.dentry);
-			return -EACCES;
-		}
-	}
+	ret = ksmbd_vfs_check_read_access(work, fp);
+	if (ret)
+		return ret;
 
 	if (ksmbd_stream_fd(fp))
 		return ksmbd_vfs_stream_read(fp, rbuf, pos, count);
 
-	if (!work->tcon->posix_extensions) {
-		int ret;
-
-		ret = check_lock_range(filp, *pos, *pos + count - 1, READ);
-		if (ret) {
-			pr_err("unable to read due to lock\n");
-			return -EAGAIN;
-		}
-	}
+	ret = ksmbd_vfs_check_read_lock(work, fp, *pos, count);
+	if (ret)
+		return ret;
 
 	nbytes = kernel_read(filp, rbuf, count, pos);
 	if (nbytes < 0) {
@@ -408,6 +429,100 @@ int ksmbd_vfs_read(struct ksmbd_work *work, struct ksmbd_file *fp, size_t count,
 	return nbytes;
 }
 
+struct ksmbd_splice_ctx {
+	struct bio_vec		*bvec;
+	unsigned int		nr;
+	unsigned int		max;
+};
+
+static int ksmbd_vfs_splice_actor(struct pipe_inode_info *pipe,
+				  struct pipe_buffer *buf,
+				  struct splice_desc *sd)
+{
+	struct ksmbd_splice_ctx *ctx = sd->u.data;
+	struct bio_vec *bv;
+
+	/* a short read is fine, the client asks again for the rest */
+	if (ctx->nr == ctx->max)
+		return 0;
+
+	if (!pipe_buf_get(pipe, buf))
+		return -EFAULT;
+
+	bv = &ctx->bvec[ctx->nr++];
+	bv->bv_page = buf->page;
+	bv->bv_offset = buf->offset;
+	bv->bv_len = sd->len;
+	return sd->len;
+}
+
+static int ksmbd_vfs_splice_direct(struct pipe_inode_info *pipe,
+				   struct splice_desc *sd)
+{
+	return __splice_from_pipe(pipe, sd, ksmbd_vfs_splice_actor);
+}
+
+/**
+ * ksmbd_vfs_splice_read() - read file data without copying it
+ * @work:	smb work
+ * @fp:		ksmbd file pointer
+ * @count:	read byte count
+ * @pos:	file pos
+ *
+ * The data is left in the page cache and references to the pages it sits
+ * in are stored in @work, for the transport to send them with sendpage.
+ *
+ * Return:	number of read bytes on success, -EOPNOTSUPP if the file
+ *		must be read with ksmbd_vfs_read(), otherwise error
+ */
+ssize_t ksmbd_vfs_splice_read(struct ksmbd_work *work, struct ksmbd_file *fp,
+			      size_t count, loff_t *pos)
+{
+	struct file *filp = fp->filp;
+	struct ksmbd_splice_ctx ctx = {};
+	struct splice_desc sd = {
+		.total_len	= count,
+		.pos		= *pos,
+		.u.data		= &ctx,
+	};
+	ssize_t nbytes;
+	int ret;
+
+	if (!S_ISREG(file_inode(filp)->i_mode) || ksmbd_stream_fd(fp) ||
+	    !filp->f_op->splice_read)
+		return -EOPNOTSUPP;
+
+	if (unlikely(count == 0))
+		return 0;
+
+	ret = ksmbd_vfs_check_read_access(work, fp);
+	if (ret)
+		return ret;
+
+	ret = ksmbd_vfs_check_read_lock(work, fp, *pos, count);
+	if (ret)
+		return ret;
+
+	ctx.max = DIV_ROUND_UP(count, PAGE_SIZE) + 1;
+	ctx.bvec = kvmalloc_array(ctx.max, sizeof(struct bio_vec), GFP_KERNEL);
+	if (!ctx.bvec)
+		return -EOPNOTSUPP;
+
+	nbytes = splice_direct_to_actor(filp, &sd, ksmbd_vfs_splice_direct);
+	work->rdata_bvec = ctx.bvec;
+	work->rdata_nr_bvec = ctx.nr;
+	if (nbytes < 0) {
+		pr_err("smb splice read failed for (%s), err = %zd\n",
+		       fp->filename, nbytes);
+		ksmbd_work_put_rdata(work);
+		return nbytes;
+	}
+
+	*pos += nbytes;
+	filp->f_pos = *pos;
+	return nbytes;
+}
+
 static int ksmbd_vfs_stream_write(struct ksmbd_file *fp, char *buf, loff_t *pos,
 				  size_t count)
 {
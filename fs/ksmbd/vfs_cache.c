@@ -13,6 +13,7 @@
 #include "oplock.h"
 #include "vfs.h"
 #include "connection.h"
+#include "mgmt/share_config.h"
 #include "mgmt/tree_connect.h"
 #include "mgmt/user_session.h"
 #include "smb_common.h"
@@ -24,7 +25,7 @@
 static unsigned int inode_hash_mask __read_mostly;
 static unsigned int inode_hash_shift __read_mostly;
 static struct hlist_head *inode_hashtable __read_mostly;
-static DEFINE_RWLOCK(inode_hash_lock);
+static DEFINE_SPINLOCK(inode_hash_lock);
 
 static struct ksmbd_file_table global_ft;
 static atomic_long_t fd_limit;
@@ -71,7 +72,7 @@ static struct ksmbd_inode *__ksmbd_inode_lookup(struct inode *inode)
 		inode_hash(inode->i_sb, inode->i_ino);
 	struct ksmbd_inode *ci = NULL, *ret_ci = NULL;
 
-	hlist_for_each_entry(ci, head, m_hash) {
+	hlist_for_each_entry_rcu(ci, head, m_hash) {
 		if (ci->m_inode == inode) {
 			if (atomic_inc_not_zero(&ci->m_count))
 				ret_ci = ci;
@@ -90,9 +91,9 @@ static struct ksmbd_inode *ksmbd_inode_lookup_by_vfsinode(struct inode *inode)
 {
 	struct ksmbd_inode *ci;
 
-	read_lock(&inode_hash_lock);
+	rcu_read_lock();
 	ci = __ksmbd_inode_lookup(inode);
-	read_unlock(&inode_hash_lock);
+	rcu_read_unlock();
 	return ci;
 }
 
@@ -101,7 +102,7 @@ int ksmbd_query_inode_status(struct inode *inode)
 	struct ksmbd_inode *ci;
 	int ret = KSMBD_INODE_STATUS_UNKNOWN;
 
-	read_lock(&inode_hash_lock);
+	rcu_read_lock();
 	ci = __ksmbd_inode_lookup(inode);
 	if (ci) {
 		ret = KSMBD_INODE_STATUS_OK;
@@ -109,7 +110,7 @@ int ksmbd_query_inode_status(struct inode *inode)
 			ret = KSMBD_INODE_STATUS_PENDING_DELETE;
 		atomic_dec(&ci->m_count);
 	}
-	read_unlock(&inode_hash_lock);
+	rcu_read_unlock();
 	return ret;
 }
 
@@ -144,14 +145,14 @@ static void ksmbd_inode_hash(struct ksmbd_inode *ci)
 	struct hlist_head *b = inode_hashtable +
 		inode_hash(ci->m_inode->i_sb, ci->m_inode->i_ino);
 
-	hlist_add_head(&ci->m_hash, b);
+	hlist_add_head_rcu(&ci->m_hash, b);
 }
 
 static void ksmbd_inode_unhash(struct ksmbd_inode *ci)
 {
-	write_lock(&inode_hash_lock);
-	hlist_del_init(&ci->m_hash);
-	write_unlock(&inode_hash_lock);
+	spin_lock(&inode_hash_lock);
+	hlist_del_init_rcu(&ci->m_hash);
+	spin_unlock(&inode_hash_lock);
 }
 
 static int ksmbd_inode_init(struct ksmbd_inode *ci, struct ksmbd_file *fp)
@@ -173,9 +174,9 @@ static struct ksmbd_inode *ksmbd_inode_get(struct ksmbd_file *fp)
 	struct ksmbd_inode *ci, *tmpci;
 	int rc;
 
-	read_lock(&inode_hash_lock);
+	rcu_read_lock();
 	ci = ksmbd_inode_lookup(fp);
-	read_unlock(&inode_hash_lock);
+	rcu_read_unlock();
 	if (ci)
 		return ci;
 
@@ -190,7 +191,7 @@ static struct ksmbd_inode *ksmbd_inode_get(struct ksmbd_file *fp)
 		return NULL;
 	}
 
-	write_lock(&inode_hash_lock);
+	spin_lock(&inode_hash_lock);
 	tmpci = ksmbd_inode_lookup(fp);
 	if (!tmpci) {
 		ksmbd_inode_hash(ci);
@@ -198,14 +199,14 @@ static struct ksmbd_inode *ksmbd_inode_get(struct ksmbd_file *fp)
 		kfree(ci);
 		ci = tmpci;
 	}
-	write_unlock(&inode_hash_lock);
+	spin_unlock(&inode_hash_lock);
 	return ci;
 }
 
 static void ksmbd_inode_free(struct ksmbd_inode *ci)
 {
 	ksmbd_inode_unhash(ci);
-	kfree(ci);
+	kfree_rcu(ci, m_rcu);
 }
 
 static void ksmbd_inode_put(struct ksmbd_inode *ci)
@@ -299,6 +300,11 @@ static void __ksmbd_remove_fd(struct ksmbd_file_table *ft, struct ksmbd_file *fp
 	write_unlock(&ft->lock);
 }
 
+static void ksmbd_free_fp_rcu(struct rcu_head *rcu)
+{
+	kmem_cache_free(filp_cache, container_of(rcu, struct ksmbd_file, rcu));
+}
+
 static void __ksmbd_close_fd(struct ksmbd_file_table *ft, struct ksmbd_file *fp)
 {
 	struct file *filp;
@@ -331,7 +337,8 @@ static void __ksmbd_close_fd(struct ksmbd_file_table *ft, struct ksmbd_file *fp)
 	kfree(fp->filename);
 	if (ksmbd_stream_fd(fp))
 		kfree(fp->stream.name);
-	kmem_cache_free(filp_cache, fp);
+	/* __ksmbd_lookup_fd() may still be looking at it */
+	call_rcu(&fp->rcu, ksmbd_free_fp_rcu);
 }
 
 static struct ksmbd_file *ksmbd_fp_get(struct ksmbd_file *fp)
@@ -349,11 +356,11 @@ static struct ksmbd_file *__ksmbd_lookup_fd(struct ksmbd_file_table *ft,
 	if (!has_file_id(id))
 		return NULL;
 
-	read_lock(&ft->lock);
+	rcu_read_lock();
 	fp = idr_find(ft->idr, id);
 	if (fp)
 		fp = ksmbd_fp_get(fp);
-	read_unlock(&ft->lock);
+	rcu_read_unlock();
 	return fp;
 }
 
@@ -470,7 +477,7 @@ struct ksmbd_file *ksmbd_lookup_fd_cguid(char *cguid)
 	struct ksmbd_file	*fp = NULL;
 	unsigned int		id;
 
-	read_lock(&global_ft.lock);
+	rcu_read_lock();
 	idr_for_each_entry(global_ft.idr, fp, id) {
 		if (!memcmp(fp->create_guid,
 			    cguid,
@@ -479,7 +486,7 @@ struct ksmbd_file *ksmbd_lookup_fd_cguid(char *cguid)
 			break;
 		}
 	}
-	read_unlock(&global_ft.lock);
+	rcu_read_unlock();
 
 	return fp;
 }
@@ -587,6 +594,7 @@ struct ksmbd_file *ksmbd_open_fd(struct ksmbd_work *work, struct file *filp)
 	}
 
 	atomic_inc(&work->conn->stats.open_files_count);
+	ksmbd_share_stats_add(work->tcon->share_conf, opens, 1);
 	return fp;
 
 err_out:
@@ -705,5 +713,6 @@ int ksmbd_init_file_cache(void)
 
 void ksmbd_exit_file_cache(void)
 {
+	rcu_barrier();
 	kmem_cache_destroy(filp_cache);
 }
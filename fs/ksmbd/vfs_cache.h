@@ -58,6 +58,7 @@ struct ksmbd_inode {
 	struct list_head		m_op_list;
 	struct oplock_info		*m_opinfo;
 	__le32				m_fattr;
+	struct rcu_head			m_rcu;
 };
 
 struct ksmbd_file {
@@ -109,6 +110,8 @@ struct ksmbd_file {
 	/* if ls is happening on directory, below is valid*/
 	struct ksmbd_readdir_data	readdir_data;
 	int				dot_dotdot[2];
+
+	struct rcu_head			rcu;
 };
 
 static inline void set_ctx_actor(struct dir_context *ctx,
@@ -119,6 +122,10 @@ static inline void set_ctx_actor(struct dir_context *ctx,
 
 #define KSMBD_NR_OPEN_DEFAULT BITS_PER_LONG
 
+/*
+ * The lock serialises id allocation and removal, lookups only take the
+ * RCU read lock and then a reference on the file.
+ */
 struct ksmbd_file_table {
 	rwlock_t		lock;
 	struct idr		*idr;
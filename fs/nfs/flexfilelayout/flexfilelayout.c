@@ -672,11 +672,24 @@ nfs4_ff_layout_stat_io_end_read(struct rpc_task *task,
 		__u64 requested,
 		__u64 completed)
 {
+	ktime_t now = ktime_get();
+	s64 latency = ktime_to_ns(ktime_sub(now, task->tk_start));
+
 	spin_lock(&mirror->lock);
 	nfs4_ff_layout_stat_io_update_completed(&mirror->read_stat,
 			requested, completed,
-			ktime_get(), task->tk_start);
+			now, task->tk_start);
 	set_bit(NFS4_FF_MIRROR_STAT_AVAIL, &mirror->flags);
+
+	/* Moving average used to pick the mirror for the next READs */
+	if (mirror->read_latency &&
+	    ktime_ms_delta(now, mirror->read_latency_time) <=
+			FF_LAYOUT_LATENCY_STALE)
+		mirror->read_latency += (latency - mirror->read_latency) /
+					(1 << FF_LAYOUT_LATENCY_SHIFT);
+	else
+		mirror->read_latency = latency;
+	mirror->read_latency_time = now;
 	spin_unlock(&mirror->lock);
 }
 
@@ -732,6 +745,57 @@ ff_layout_mark_ds_reachable(struct pnfs_layout_segment *lseg, u32 idx)
 		nfs4_mark_deviceid_available(devid);
 }
 
+static s64
+ff_layout_mirror_read_latency(struct nfs4_ff_layout_mirror *mirror,
+			      ktime_t now)
+{
+	s64 latency;
+
+	spin_lock(&mirror->lock);
+	latency = mirror->read_latency;
+	if (ktime_ms_delta(now, mirror->read_latency_time) >
+			FF_LAYOUT_LATENCY_STALE)
+		latency = 0;
+	spin_unlock(&mirror->lock);
+
+	return latency;
+}
+
+/*
+ * Pick the mirror from @start_idx on that recently served READs the
+ * fastest.  A mirror without a recent sample counts as the fastest, so
+ * that a slow data server is retried once in a while and gets a chance
+ * to show it has recovered.  On a tie the more efficient mirror wins.
+ */
+static u32
+ff_layout_fastest_mirror_for_read(struct pnfs_layout_segment *lseg,
+				  u32 start_idx, bool check_device)
+{
+	struct nfs4_ff_layout_segment *fls = FF_LAYOUT_LSEG(lseg);
+	struct nfs4_ff_layout_mirror *mirror;
+	s64 latency, best_latency = S64_MAX;
+	u32 idx, best_idx = fls->mirror_array_cnt;
+	ktime_t now = ktime_get();
+
+	for (idx = start_idx; idx < fls->mirror_array_cnt; idx++) {
+		mirror = FF_LAYOUT_COMP(lseg, idx);
+		if (IS_ERR(mirror->mirror_ds))
+			continue;
+
+		if (check_device && mirror->mirror_ds &&
+		    nfs4_test_deviceid_unavailable(&mirror->mirror_ds->id_node))
+			continue;
+
+		latency = ff_layout_mirror_read_latency(mirror, now);
+		if (latency < best_latency) {
+			best_latency = latency;
+			best_idx = idx;
+		}
+	}
+
+	return best_idx;
+}
+
 static struct nfs4_pnfs_ds *
 ff_layout_choose_ds_for_read(struct pnfs_layout_segment *lseg,
 			     u32 start_idx, u32 *best_idx,
@@ -742,6 +806,16 @@ ff_layout_choose_ds_for_read(struct pnfs_layout_segment *lseg,
 	struct nfs4_pnfs_ds *ds;
 	u32 idx;
 
+	idx = ff_layout_fastest_mirror_for_read(lseg, start_idx, check_device);
+	if (idx < fls->mirror_array_cnt) {
+		mirror = FF_LAYOUT_COMP(lseg, idx);
+		ds = nfs4_ff_layout_prepare_ds(lseg, mirror, false);
+		if (ds) {
+			*best_idx = idx;
+			return ds;
+		}
+	}
+
 	/* mirrors are initially sorted by efficiency */
 	for (idx = start_idx; idx < fls->mirror_array_cnt; idx++) {
 		mirror = FF_LAYOUT_COMP(lseg, idx);
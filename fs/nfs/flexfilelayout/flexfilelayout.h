@@ -25,6 +25,11 @@
 #define FF_LAYOUTSTATS_REPORT_INTERVAL (60000L)
 #define FF_LAYOUTSTATS_MAXDEV 4
 
+/* READ latency samples older than this (in ms) are not trusted */
+#define FF_LAYOUT_LATENCY_STALE (5000L)
+/* Weight of a new READ latency sample is 1/2^FF_LAYOUT_LATENCY_SHIFT */
+#define FF_LAYOUT_LATENCY_SHIFT 3
+
 struct nfs4_ff_ds_version {
 	u32				version;
 	u32				minor_version;
@@ -90,6 +95,8 @@ struct nfs4_ff_layout_mirror {
 	struct nfs4_ff_layoutstat	write_stat;
 	ktime_t				start_time;
 	u32				report_interval;
+	s64				read_latency;	/* average, in ns */
+	ktime_t				read_latency_time;
 };
 
 #define NFS4_FF_MIRROR_STAT_AVAIL	(0)
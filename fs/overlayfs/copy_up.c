@@ -170,36 +170,22 @@ static int ovl_copy_fileattr(struct inode *inode, struct path *old,
 	return ovl_real_fileattr_set(new, &newfa);
 }
 
-static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
-			    struct path *new, loff_t len)
+/* Copy [pos, pos + len) of old_file to the same offset in new_file */
+static int ovl_copy_up_range(struct file *old_file, struct file *new_file,
+			     loff_t pos, loff_t len)
 {
-	struct file *old_file;
-	struct file *new_file;
-	loff_t old_pos = 0;
-	loff_t new_pos = 0;
+	loff_t old_pos = pos;
+	loff_t new_pos = pos;
 	loff_t cloned;
 	loff_t data_pos = -1;
 	loff_t hole_len;
 	bool skip_hole = false;
 	int error = 0;
 
-	if (len == 0)
-		return 0;
-
-	old_file = ovl_path_open(old, O_LARGEFILE | O_RDONLY);
-	if (IS_ERR(old_file))
-		return PTR_ERR(old_file);
-
-	new_file = ovl_path_open(new, O_LARGEFILE | O_WRONLY);
-	if (IS_ERR(new_file)) {
-		error = PTR_ERR(new_file);
-		goto out_fput;
-	}
-
 	/* Try to use clone_file_range to clone up within the same fs */
-	cloned = do_clone_file_range(old_file, 0, new_file, 0, len, 0);
+	cloned = do_clone_file_range(old_file, pos, new_file, pos, len, 0);
 	if (cloned == len)
-		goto out;
+		return 0;
 	/* Couldn't clone, so now we try to copy the data */
 
 	/* Check if lower fs supports seek operation */
@@ -239,6 +225,8 @@ static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
 			data_pos = vfs_llseek(old_file, old_pos, SEEK_DATA);
 			if (data_pos > old_pos) {
 				hole_len = data_pos - old_pos;
+				if (hole_len >= len)
+					break;
 				len -= hole_len;
 				old_pos = new_pos = data_pos;
 				continue;
@@ -260,7 +248,30 @@ static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
 
 		len -= bytes;
 	}
-out:
+	return error;
+}
+
+static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
+			    struct path *new, loff_t len)
+{
+	struct file *old_file;
+	struct file *new_file;
+	int error;
+
+	if (len == 0)
+		return 0;
+
+	old_file = ovl_path_open(old, O_LARGEFILE | O_RDONLY);
+	if (IS_ERR(old_file))
+		return PTR_ERR(old_file);
+
+	new_file = ovl_path_open(new, O_LARGEFILE | O_WRONLY);
+	if (IS_ERR(new_file)) {
+		error = PTR_ERR(new_file);
+		goto out_fput;
+	}
+
+	error = ovl_copy_up_range(old_file, new_file, 0, len);
 	if (!error && ovl_should_sync(ofs))
 		error = vfs_fsync(new_file, 0);
 	fput(new_file);
@@ -865,15 +876,365 @@ static ssize_t ovl_getxattr(struct dentry *dentry, char *name, char **value)
 	return res;
 }
 
+/*
+ * Lazy data copy up
+ *
+ * With lazydata=on, opening a lower file for write only copies up its
+ * metadata, like metacopy=on does for other opens.  The data is copied up
+ * just before a write touches it, a granule at a time, and reads are served
+ * from the upper or the lower file depending on which holds each granule.
+ * The map of what has been copied up is kept in the datamap xattr of the
+ * upper file.  Once all of the lower data has been copied up, the metacopy
+ * xattr is removed and the file becomes an ordinary upper file.
+ */
+
+#define OVL_DATAMAP_VERSION	0
+#define OVL_DATAMAP_MIN_SHIFT	20
+/* Keep the xattr small enough for the in-inode xattr space of most fs */
+#define OVL_DATAMAP_MAX_BYTES	3072
+
+struct ovl_datamap_xattr {
+	u8 version;
+	u8 shift;
+	u8 pad[6];
+	__le64 size;
+	u8 map[];
+} __packed;
+
+static unsigned int ovl_datamap_shift(loff_t size)
+{
+	unsigned int shift = OVL_DATAMAP_MIN_SHIFT;
+
+	while (DIV_ROUND_UP_ULL(size, 1ULL << shift) >
+	       OVL_DATAMAP_MAX_BYTES * BITS_PER_BYTE)
+		shift++;
+
+	return shift;
+}
+
+static struct ovl_datamap *ovl_datamap_alloc(struct dentry *dentry,
+					     loff_t size, unsigned int shift)
+{
+	unsigned long nbits = DIV_ROUND_UP_ULL(size, 1ULL << shift);
+	struct ovl_datamap *dm;
+	struct path lowerpath;
+
+	dm = kzalloc(struct_size(dm, map, BITS_TO_LONGS(nbits)), GFP_KERNEL);
+	if (!dm)
+		return ERR_PTR(-ENOMEM);
+
+	ovl_path_lowerdata(dentry, &lowerpath);
+	dm->lower = ovl_path_open(&lowerpath, O_LARGEFILE | O_RDONLY);
+	if (IS_ERR(dm->lower)) {
+		int err = PTR_ERR(dm->lower);
+
+		kfree(dm);
+		return ERR_PTR(err);
+	}
+	dm->size = size;
+	dm->shift = shift;
+	dm->nbits = nbits;
+
+	return dm;
+}
+
+void ovl_datamap_free(struct ovl_datamap *dm)
+{
+	if (dm) {
+		fput(dm->lower);
+		kfree(dm);
+	}
+}
+
+/* Store the map as it will be once granules [first, last) are copied up */
+static int ovl_datamap_store(struct ovl_fs *ofs, struct dentry *upper,
+			     struct ovl_datamap *dm, unsigned long first,
+			     unsigned long last)
+{
+	size_t len = DIV_ROUND_UP(dm->nbits, BITS_PER_BYTE);
+	struct ovl_datamap_xattr *dx;
+	int err;
+
+	dx = kzalloc(struct_size(dx, map, round_up(len, sizeof(long))),
+		     GFP_KERNEL);
+	if (!dx)
+		return -ENOMEM;
+
+	dx->version = OVL_DATAMAP_VERSION;
+	dx->shift = dm->shift;
+	dx->size = cpu_to_le64(dm->size);
+	memcpy(dx->map, dm->map, len);
+	for (; first < last; first++)
+		__set_bit_le(first, dx->map);
+
+	err = ovl_do_setxattr(ofs, upper, OVL_XATTR_DATAMAP, dx,
+			      struct_size(dx, map, len));
+	kfree(dx);
+	return err;
+}
+
+static struct ovl_datamap *ovl_datamap_load(struct dentry *dentry,
+					    struct dentry *upper)
+{
+	struct ovl_fs *ofs = OVL_FS(dentry->d_sb);
+	struct ovl_datamap_xattr *dx;
+	struct ovl_datamap *dm;
+	ssize_t res;
+	loff_t size;
+
+	res = ovl_do_getxattr(ofs, upper, OVL_XATTR_DATAMAP, NULL, 0);
+	if (res == -ENODATA || res == -EOPNOTSUPP)
+		return NULL;
+	if (res < 0)
+		return ERR_PTR(res);
+
+	dx = kzalloc(res, GFP_KERNEL);
+	if (!dx)
+		return ERR_PTR(-ENOMEM);
+
+	res = ovl_do_getxattr(ofs, upper, OVL_XATTR_DATAMAP, dx, res);
+	if (res < 0) {
+		dm = ERR_PTR(res);
+		goto out;
+	}
+
+	dm = ERR_PTR(-EIO);
+	if (res < sizeof(*dx) || dx->version != OVL_DATAMAP_VERSION ||
+	    dx->shift < OVL_DATAMAP_MIN_SHIFT || dx->shift >= 63)
+		goto invalid;
+	size = le64_to_cpu(dx->size);
+	if (size < 0 || res - sizeof(*dx) !=
+	    DIV_ROUND_UP(DIV_ROUND_UP_ULL(size, 1ULL << dx->shift),
+			 BITS_PER_BYTE))
+		goto invalid;
+
+	dm = ovl_datamap_alloc(dentry, size, dx->shift);
+	if (!IS_ERR(dm))
+		memcpy(dm->map, dx->map, res - sizeof(*dx));
+out:
+	kfree(dx);
+	return dm;
+
+invalid:
+	pr_warn_ratelimited("invalid datamap xattr (%pd2)\n", upper);
+	goto out;
+}
+
+/*
+ * Attach the datamap of an upper metacopy file to its inode, creating one
+ * if @create.  Returns NULL if there is no map.  Called with the ovl inode
+ * lock held.
+ */
+static struct ovl_datamap *ovl_datamap_get(struct dentry *dentry, bool create)
+{
+	struct ovl_inode *oi = OVL_I(d_inode(dentry));
+	struct dentry *upper = ovl_dentry_upper(dentry);
+	struct ovl_datamap *dm = oi->datamap;
+	struct path lowerpath;
+	struct kstat stat;
+	int err;
+
+	if (dm)
+		return dm;
+
+	dm = ovl_datamap_load(dentry, upper);
+	if (!dm && create) {
+		ovl_path_lowerdata(dentry, &lowerpath);
+		err = vfs_getattr(&lowerpath, &stat, STATX_SIZE,
+				  AT_STATX_SYNC_AS_STAT);
+		if (err)
+			return ERR_PTR(err);
+
+		dm = ovl_datamap_alloc(dentry, stat.size,
+				       ovl_datamap_shift(stat.size));
+		if (IS_ERR(dm))
+			return dm;
+
+		err = ovl_datamap_store(OVL_FS(dentry->d_sb), upper, dm, 0, 0);
+		if (err) {
+			ovl_datamap_free(dm);
+			return ERR_PTR(err);
+		}
+	}
+	if (IS_ERR_OR_NULL(dm))
+		return dm;
+
+	/* Pairs with smp_load_acquire() in ovl_lazy_datamap() */
+	smp_store_release(&oi->datamap, dm);
+	return dm;
+}
+
+/*
+ * Copy up the granules overlapping [pos, pos + len) that are not in the
+ * upper file yet, and turn the file into a normal upper file once nothing
+ * is left to copy.  Called with the ovl inode lock held.
+ */
+static int __ovl_datamap_fill(struct dentry *dentry, struct ovl_datamap *dm,
+			      loff_t pos, loff_t len)
+{
+	struct ovl_fs *ofs = OVL_FS(dentry->d_sb);
+	struct file *upper_file = NULL;
+	unsigned long first, last, g, next;
+	struct path upperpath;
+	char *capability = NULL;
+	ssize_t cap_size = 0;
+	loff_t end;
+	int err = 0;
+
+	ovl_path_upper(dentry, &upperpath);
+	if (WARN_ON(upperpath.dentry == NULL))
+		return -EIO;
+
+	end = len >= dm->size - pos ? dm->size : pos + len;
+	first = pos < dm->size ? pos >> dm->shift : dm->nbits;
+	last = pos < dm->size ? DIV_ROUND_UP_ULL(end, 1ULL << dm->shift) : 0;
+
+	for (g = find_next_zero_bit_le(dm->map, last, first); g < last;
+	     g = find_next_zero_bit_le(dm->map, last, next)) {
+		loff_t start = (loff_t)g << dm->shift;
+
+		next = find_next_bit_le(dm->map, last, g);
+		if (!upper_file) {
+			/* Writing to upper file will clear security.capability */
+			err = cap_size = ovl_getxattr(upperpath.dentry,
+						      XATTR_NAME_CAPS,
+						      &capability);
+			if (cap_size < 0)
+				goto out;
+
+			upper_file = ovl_path_open(&upperpath,
+						   O_LARGEFILE | O_WRONLY);
+			if (IS_ERR(upper_file)) {
+				err = PTR_ERR(upper_file);
+				upper_file = NULL;
+				goto out;
+			}
+		}
+
+		err = ovl_copy_up_range(dm->lower, upper_file, start,
+				min_t(loff_t, (loff_t)next << dm->shift,
+				      dm->size) - start);
+		if (err)
+			goto out;
+	}
+
+	if (upper_file) {
+		/* The data must be stable before the map that advertises it */
+		if (ovl_should_sync(ofs))
+			err = vfs_fsync(upper_file, 0);
+		if (!err)
+			err = ovl_datamap_store(ofs, upperpath.dentry, dm,
+						first, last);
+		if (err)
+			goto out;
+		for (g = first; g < last; g++)
+			set_bit_le(g, dm->map);
+
+		if (capability) {
+			err = vfs_setxattr(&init_user_ns, upperpath.dentry,
+					   XATTR_NAME_CAPS, capability,
+					   cap_size, 0);
+			if (err)
+				goto out;
+		}
+	}
+
+	if (find_next_zero_bit_le(dm->map, dm->nbits, 0) >= dm->nbits) {
+		err = ovl_do_removexattr(ofs, upperpath.dentry,
+					 OVL_XATTR_METACOPY);
+		if (err)
+			goto out;
+		ovl_do_removexattr(ofs, upperpath.dentry, OVL_XATTR_DATAMAP);
+		ovl_set_upperdata(d_inode(dentry));
+	}
+out:
+	if (upper_file)
+		fput(upper_file);
+	kfree(capability);
+	return err;
+}
+
+static int ovl_datamap_setup(struct dentry *dentry, bool create)
+{
+	struct inode *inode = d_inode(dentry);
+	const struct cred *old_cred;
+	struct ovl_datamap *dm;
+	int err;
+
+	if (!d_is_reg(dentry) || !ovl_dentry_upper(dentry) ||
+	    ovl_has_upperdata(inode))
+		return 0;
+
+	err = ovl_inode_lock_interruptible(inode);
+	if (err)
+		return err;
+
+	old_cred = ovl_override_creds(dentry->d_sb);
+	if (!ovl_has_upperdata(inode)) {
+		dm = ovl_datamap_get(dentry, create);
+		err = PTR_ERR_OR_ZERO(dm);
+		/* An empty lower file has nothing to wait for */
+		if (!IS_ERR_OR_NULL(dm) && create)
+			err = __ovl_datamap_fill(dentry, dm, 0, 0);
+	}
+	revert_creds(old_cred);
+	ovl_inode_unlock(inode);
+
+	return err;
+}
+
+/* Pick up the datamap of a file that was lazily copied up in the past */
+int ovl_datamap_init(struct dentry *dentry)
+{
+	return ovl_datamap_setup(dentry, false);
+}
+
+/* Make sure [pos, pos + len) of a lazily copied up file is in upper */
+int ovl_datamap_fill(struct dentry *dentry, loff_t pos, loff_t len)
+{
+	struct inode *inode = d_inode(dentry);
+	const struct cred *old_cred;
+	struct ovl_datamap *dm;
+	int err;
+
+	err = ovl_want_write(dentry);
+	if (err)
+		return err;
+
+	err = ovl_inode_lock_interruptible(inode);
+	if (err)
+		goto out_drop_write;
+
+	dm = ovl_lazy_datamap(inode);
+	if (dm) {
+		old_cred = ovl_override_creds(dentry->d_sb);
+		err = __ovl_datamap_fill(dentry, dm, pos, len);
+		revert_creds(old_cred);
+	}
+	ovl_inode_unlock(inode);
+out_drop_write:
+	ovl_drop_write(dentry);
+
+	return err;
+}
+
 /* Copy up data of an inode which was copied up metadata only in the past. */
 static int ovl_copy_up_meta_inode_data(struct ovl_copy_up_ctx *c)
 {
 	struct ovl_fs *ofs = OVL_FS(c->dentry->d_sb);
 	struct path upperpath, datapath;
+	struct ovl_datamap *dm;
 	int err;
 	char *capability = NULL;
 	ssize_t cap_size;
 
+	/* Only copy up what hasn't been lazily copied up already */
+	dm = ovl_datamap_get(c->dentry, false);
+	if (IS_ERR(dm))
+		return PTR_ERR(dm);
+	if (dm)
+		return __ovl_datamap_fill(c->dentry, dm, 0, LLONG_MAX);
+
 	ovl_path_upper(c->dentry, &upperpath);
 	if (WARN_ON(upperpath.dentry == NULL))
 		return -EIO;
@@ -1039,6 +1400,18 @@ static bool ovl_open_need_copy_up(struct dentry *dentry, int flags)
 	return true;
 }
 
+/*
+ * With lazydata=on, a write open only copies up metadata and leaves the
+ * data to be copied up as it is written.  Truncating opens don't need any
+ * of the lower data, so there is nothing to gain.
+ */
+static bool ovl_open_lazy_data(struct dentry *dentry, int flags)
+{
+	struct ovl_fs *ofs = OVL_FS(dentry->d_sb);
+
+	return ofs->config.lazydata && d_is_reg(dentry) && !(flags & O_TRUNC);
+}
+
 int ovl_maybe_copy_up(struct dentry *dentry, int flags)
 {
 	int err = 0;
@@ -1046,7 +1419,13 @@ int ovl_maybe_copy_up(struct dentry *dentry, int flags)
 	if (ovl_open_need_copy_up(dentry, flags)) {
 		err = ovl_want_write(dentry);
 		if (!err) {
-			err = ovl_copy_up_flags(dentry, flags);
+			if (ovl_open_lazy_data(dentry, flags)) {
+				err = ovl_copy_up_flags(dentry, 0);
+				if (!err)
+					err = ovl_datamap_setup(dentry, true);
+			} else {
+				err = ovl_copy_up_flags(dentry, flags);
+			}
 			ovl_drop_write(dentry);
 		}
 	}
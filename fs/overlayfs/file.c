@@ -109,7 +109,8 @@ static int ovl_real_fdget_meta(const struct file *file, struct fd *real,
 	real->flags = 0;
 	real->file = file->private_data;
 
-	if (allow_meta)
+	/* A lazily copied up file reads through the upper file */
+	if (allow_meta || ovl_lazy_datamap(inode))
 		realinode = ovl_inode_real(inode);
 	else
 		realinode = ovl_inode_realdata(inode);
@@ -143,6 +144,7 @@ static int ovl_real_fdget(const struct file *file, struct fd *real)
 
 static int ovl_open(struct inode *inode, struct file *file)
 {
+	struct inode *realinode;
 	struct file *realfile;
 	int err;
 
@@ -150,10 +152,19 @@ static int ovl_open(struct inode *inode, struct file *file)
 	if (err)
 		return err;
 
+	err = ovl_datamap_init(file_dentry(file));
+	if (err)
+		return err;
+
 	/* No longer need these flags, so don't pass them on to underlying fs */
 	file->f_flags &= ~(O_CREAT | O_EXCL | O_NOCTTY | O_TRUNC);
 
-	realfile = ovl_open_realfile(file, ovl_inode_realdata(inode));
+	if (ovl_lazy_datamap(inode))
+		realinode = ovl_inode_upper(inode);
+	else
+		realinode = ovl_inode_realdata(inode);
+
+	realfile = ovl_open_realfile(file, realinode);
 	if (IS_ERR(realfile))
 		return PTR_ERR(realfile);
 
@@ -169,6 +180,18 @@ static int ovl_release(struct inode *inode, struct file *file)
 	return 0;
 }
 
+/*
+ * Finish the data copy up of a lazily copied up file, for operations that
+ * can't be split between the upper and the lower file.
+ */
+static int ovl_lazy_copy_up_all(struct file *file)
+{
+	if (!ovl_lazy_datamap(file_inode(file)))
+		return 0;
+
+	return ovl_datamap_fill(file_dentry(file), 0, LLONG_MAX);
+}
+
 static loff_t ovl_llseek(struct file *file, loff_t offset, int whence)
 {
 	struct inode *inode = file_inode(file);
@@ -188,6 +211,13 @@ static loff_t ovl_llseek(struct file *file, loff_t offset, int whence)
 			return vfs_setpos(file, 0, 0);
 	}
 
+	/* Holes in the upper file of a lazy copy up are not real holes */
+	if (whence == SEEK_DATA || whence == SEEK_HOLE) {
+		ret = ovl_lazy_copy_up_all(file);
+		if (ret)
+			return ret;
+	}
+
 	ret = ovl_real_fdget(file, &real);
 	if (ret)
 		return ret;
@@ -282,9 +312,60 @@ static void ovl_aio_rw_complete(struct kiocb *iocb, long res, long res2)
 	orig_iocb->ki_complete(orig_iocb, res, res2);
 }
 
+/*
+ * Read from a lazily copied up file.  Granules that are not copied up yet
+ * are read from the lower file, everything else from the upper file.
+ */
+static ssize_t ovl_lazy_read(struct file *upper, struct ovl_datamap *dm,
+			     struct kiocb *iocb, struct iov_iter *iter)
+{
+	rwf_t flags = ovl_iocb_to_rwf(iocb->ki_flags);
+	ssize_t ret = 0;
+
+	while (iov_iter_count(iter)) {
+		size_t total = iov_iter_count(iter);
+		loff_t pos = iocb->ki_pos;
+		loff_t end = LLONG_MAX;
+		struct file *real = upper;
+		unsigned long g;
+		size_t count;
+		ssize_t bytes;
+
+		if (pos < dm->size) {
+			g = pos >> dm->shift;
+			if (test_bit_le(g, dm->map)) {
+				g = find_next_zero_bit_le(dm->map, dm->nbits, g);
+				if (g < dm->nbits)
+					end = (loff_t)g << dm->shift;
+			} else {
+				real = dm->lower;
+				g = find_next_bit_le(dm->map, dm->nbits, g);
+				end = min_t(loff_t, (loff_t)g << dm->shift,
+					    dm->size);
+			}
+		}
+		count = min_t(loff_t, total, end - pos);
+
+		iov_iter_truncate(iter, count);
+		bytes = vfs_iter_read(real, iter, &iocb->ki_pos, flags);
+		iov_iter_reexpand(iter, total - max_t(ssize_t, bytes, 0));
+		if (bytes <= 0) {
+			if (!ret)
+				ret = bytes;
+			break;
+		}
+		ret += bytes;
+		if (bytes < count)
+			break;
+	}
+
+	return ret;
+}
+
 static ssize_t ovl_read_iter(struct kiocb *iocb, struct iov_iter *iter)
 {
 	struct file *file = iocb->ki_filp;
+	struct ovl_datamap *dm;
 	struct fd real;
 	const struct cred *old_cred;
 	ssize_t ret;
@@ -303,7 +384,10 @@ static ssize_t ovl_read_iter(struct kiocb *iocb, struct iov_iter *iter)
 		goto out_fdput;
 
 	old_cred = ovl_override_creds(file_inode(file)->i_sb);
-	if (is_sync_kiocb(iocb)) {
+	dm = ovl_lazy_datamap(file_inode(file));
+	if (dm) {
+		ret = ovl_lazy_read(real.file, dm, iocb, iter);
+	} else if (is_sync_kiocb(iocb)) {
 		ret = vfs_iter_read(real.file, iter, &iocb->ki_pos,
 				    ovl_iocb_to_rwf(iocb->ki_flags));
 	} else {
@@ -345,6 +429,14 @@ static ssize_t ovl_write_iter(struct kiocb *iocb, struct iov_iter *iter)
 		return 0;
 
 	inode_lock(inode);
+	if (ovl_lazy_datamap(inode)) {
+		ret = ovl_datamap_fill(file_dentry(file),
+				       ifl & IOCB_APPEND ? i_size_read(inode) :
+				       iocb->ki_pos, iov_iter_count(iter));
+		if (ret)
+			goto out_unlock;
+	}
+
 	/* Update mode */
 	ovl_copyattr(ovl_inode_real(inode), inode);
 	ret = file_remove_privs(file);
@@ -423,6 +515,12 @@ static ssize_t ovl_splice_write(struct pipe_inode_info *pipe, struct file *out,
 	ssize_t ret;
 
 	inode_lock(inode);
+	if (ovl_lazy_datamap(inode)) {
+		ret = ovl_datamap_fill(file_dentry(out), *ppos, len);
+		if (ret)
+			goto out_unlock;
+	}
+
 	/* Update mode */
 	ovl_copyattr(realinode, inode);
 	ret = file_remove_privs(out);
@@ -485,6 +583,10 @@ static int ovl_mmap(struct file *file, struct vm_area_struct *vma)
 	if (!realfile->f_op->mmap)
 		return -ENODEV;
 
+	ret = ovl_lazy_copy_up_all(file);
+	if (ret)
+		return ret;
+
 	if (WARN_ON(file != vma->vm_file))
 		return -EIO;
 
@@ -505,6 +607,10 @@ static long ovl_fallocate(struct file *file, int mode, loff_t offset, loff_t len
 	const struct cred *old_cred;
 	int ret;
 
+	ret = ovl_lazy_copy_up_all(file);
+	if (ret)
+		return ret;
+
 	ret = ovl_real_fdget(file, &real);
 	if (ret)
 		return ret;
@@ -555,6 +661,12 @@ static loff_t ovl_copyfile(struct file *file_in, loff_t pos_in,
 	const struct cred *old_cred;
 	loff_t ret;
 
+	ret = ovl_lazy_copy_up_all(file_out);
+	if (!ret)
+		ret = ovl_lazy_copy_up_all(file_in);
+	if (ret)
+		return ret;
+
 	ret = ovl_real_fdget(file_out, &real_out);
 	if (ret)
 		return ret;
@@ -12,6 +12,7 @@
 #include <linux/ratelimit.h>
 #include <linux/mount.h>
 #include <linux/exportfs.h>
+#include <linux/hash.h>
 #include "overlayfs.h"
 
 struct ovl_lookup_data {
@@ -819,6 +820,164 @@ static int ovl_fix_origin(struct ovl_fs *ofs, struct dentry *dentry,
 	return err;
 }
 
+/*
+ * Negative lookup cache: names that are not in any lower layer of an overlay
+ * directory.  Lower layers may not change while the overlay is mounted, so an
+ * entry stays valid for as long as the directory dentry lives and is purged
+ * when it is released.  This saves walking every lower layer again for names
+ * that keep being looked up and are not there, after the negative overlay
+ * dentry was reclaimed or the name was created and removed in upper.
+ */
+#define OVL_NEGCACHE_BITS	10
+#define OVL_NEGCACHE_MAX	8192
+
+struct ovl_negcache_entry {
+	struct hlist_node hash;
+	struct list_head lru;
+	struct dentry *dir;
+	u64 hash_len;
+	char name[];
+};
+
+struct ovl_negcache {
+	spinlock_t lock;
+	unsigned int nr;
+	struct list_head lru;
+	struct hlist_head hash[1 << OVL_NEGCACHE_BITS];
+};
+
+struct ovl_negcache *ovl_negcache_alloc(void)
+{
+	struct ovl_negcache *nc;
+	int i;
+
+	nc = kmalloc(sizeof(*nc), GFP_KERNEL);
+	if (!nc)
+		return NULL;
+
+	spin_lock_init(&nc->lock);
+	nc->nr = 0;
+	INIT_LIST_HEAD(&nc->lru);
+	for (i = 0; i < ARRAY_SIZE(nc->hash); i++)
+		INIT_HLIST_HEAD(&nc->hash[i]);
+
+	return nc;
+}
+
+static void ovl_negcache_del(struct ovl_negcache *nc,
+			     struct ovl_negcache_entry *ne)
+{
+	hlist_del(&ne->hash);
+	list_del(&ne->lru);
+	nc->nr--;
+	kfree(ne);
+}
+
+void ovl_negcache_free(struct ovl_negcache *nc)
+{
+	struct ovl_negcache_entry *ne, *tmp;
+
+	if (!nc)
+		return;
+
+	list_for_each_entry_safe(ne, tmp, &nc->lru, lru)
+		ovl_negcache_del(nc, ne);
+	kfree(nc);
+}
+
+static struct hlist_head *ovl_negcache_head(struct ovl_negcache *nc,
+					    struct dentry *dir,
+					    const struct qstr *name)
+{
+	return &nc->hash[hash_long((unsigned long)dir ^ name->hash,
+				   OVL_NEGCACHE_BITS)];
+}
+
+static struct ovl_negcache_entry *
+ovl_negcache_find(struct hlist_head *head, struct dentry *dir,
+		  const struct qstr *name)
+{
+	struct ovl_negcache_entry *ne;
+
+	hlist_for_each_entry(ne, head, hash) {
+		if (ne->dir == dir && ne->hash_len == name->hash_len &&
+		    !memcmp(ne->name, name->name, name->len))
+			return ne;
+	}
+
+	return NULL;
+}
+
+static bool ovl_negcache_lookup(struct ovl_fs *ofs, struct dentry *dentry)
+{
+	struct ovl_negcache *nc = ofs->negcache;
+	struct dentry *dir = dentry->d_parent;
+	struct ovl_negcache_entry *ne;
+
+	if (!test_bit(OVL_E_NEGCACHE, &OVL_E(dir)->flags))
+		return false;
+
+	spin_lock(&nc->lock);
+	ne = ovl_negcache_find(ovl_negcache_head(nc, dir, &dentry->d_name),
+			       dir, &dentry->d_name);
+	if (ne)
+		list_move_tail(&ne->lru, &nc->lru);
+	spin_unlock(&nc->lock);
+
+	return ne;
+}
+
+static void ovl_negcache_add(struct ovl_fs *ofs, struct dentry *dentry)
+{
+	struct ovl_negcache *nc = ofs->negcache;
+	struct dentry *dir = dentry->d_parent;
+	const struct qstr *name = &dentry->d_name;
+	struct ovl_negcache_entry *ne;
+	struct hlist_head *head;
+
+	ne = kmalloc(struct_size(ne, name, name->len), GFP_KERNEL);
+	if (!ne)
+		return;
+
+	ne->dir = dir;
+	ne->hash_len = name->hash_len;
+	memcpy(ne->name, name->name, name->len);
+
+	head = ovl_negcache_head(nc, dir, name);
+	spin_lock(&nc->lock);
+	if (ovl_negcache_find(head, dir, name)) {
+		spin_unlock(&nc->lock);
+		kfree(ne);
+		return;
+	}
+	set_bit(OVL_E_NEGCACHE, &OVL_E(dir)->flags);
+	hlist_add_head(&ne->hash, head);
+	list_add_tail(&ne->lru, &nc->lru);
+	if (++nc->nr > OVL_NEGCACHE_MAX)
+		ovl_negcache_del(nc, list_first_entry(&nc->lru,
+						      struct ovl_negcache_entry,
+						      lru));
+	spin_unlock(&nc->lock);
+}
+
+/* Called when an overlay directory dentry with cached names goes away */
+void ovl_negcache_purge(struct ovl_fs *ofs, struct dentry *dir)
+{
+	struct ovl_negcache *nc = ofs->negcache;
+	struct ovl_negcache_entry *ne;
+	struct hlist_node *tmp;
+	int i;
+
+	spin_lock(&nc->lock);
+	for (i = 0; i < ARRAY_SIZE(nc->hash); i++) {
+		hlist_for_each_entry_safe(ne, tmp, &nc->hash[i], hash) {
+			if (ne->dir == dir)
+				ovl_negcache_del(nc, ne);
+		}
+	}
+	spin_unlock(&nc->lock);
+}
+
 struct dentry *ovl_lookup(struct inode *dir, struct dentry *dentry,
 			  unsigned int flags)
 {
@@ -839,6 +998,7 @@ struct dentry *ovl_lookup(struct inode *dir, struct dentry *dentry,
 	unsigned int i;
 	int err;
 	bool uppermetacopy = false;
+	bool negcached = false;
 	struct ovl_lookup_data d = {
 		.sb = dentry->d_sb,
 		.name = dentry->d_name,
@@ -895,6 +1055,11 @@ struct dentry *ovl_lookup(struct inode *dir, struct dentry *dentry,
 		upperopaque = d.opaque;
 	}
 
+	/* Lower layers are known not to have this name */
+	if (!upperdentry && !d.stop && poe->numlower &&
+	    ovl_negcache_lookup(ofs, dentry))
+		d.stop = negcached = true;
+
 	if (!d.stop && poe->numlower) {
 		err = -ENOMEM;
 		stack = kcalloc(ofs->numlayer - 1, sizeof(struct ovl_path),
@@ -1001,6 +1166,9 @@ struct dentry *ovl_lookup(struct inode *dir, struct dentry *dentry,
 		}
 	}
 
+	if (!upperdentry && !ctr && !negcached && poe->numlower)
+		ovl_negcache_add(ofs, dentry);
+
 	/*
 	 * For regular non-metacopy upper dentries, there is no lower
 	 * path based lookup, hence ctr will be zero. If a dentry is found
@@ -35,6 +35,7 @@ enum ovl_xattr {
 	OVL_XATTR_UPPER,
 	OVL_XATTR_METACOPY,
 	OVL_XATTR_PROTATTR,
+	OVL_XATTR_DATAMAP,
 };
 
 enum ovl_inode_flag {
@@ -52,6 +53,8 @@ enum ovl_entry_flag {
 	OVL_E_UPPER_ALIAS,
 	OVL_E_OPAQUE,
 	OVL_E_CONNECTED,
+	/* Dir may have entries in the negative lookup cache */
+	OVL_E_NEGCACHE,
 };
 
 enum {
@@ -443,6 +446,9 @@ int ovl_path_next(int idx, struct dentry *dentry, struct path *path);
 struct dentry *ovl_lookup(struct inode *dir, struct dentry *dentry,
 			  unsigned int flags);
 bool ovl_lower_positive(struct dentry *dentry);
+struct ovl_negcache *ovl_negcache_alloc(void);
+void ovl_negcache_free(struct ovl_negcache *nc);
+void ovl_negcache_purge(struct ovl_fs *ofs, struct dentry *dir);
 
 static inline int ovl_verify_origin(struct ovl_fs *ofs, struct dentry *upper,
 				    struct dentry *origin, bool set)
@@ -587,9 +593,37 @@ int ovl_fileattr_set(struct user_namespace *mnt_userns,
 		     struct dentry *dentry, struct fileattr *fa);
 
 /* copy_up.c */
+
+/*
+ * Which parts of the lower data have been copied up to a file that was
+ * opened for write with lazydata=on.  Each bit covers 1 << shift bytes of
+ * the first size bytes of the file.  Anything past size only exists in the
+ * upper file.  The map never goes away before the inode does, but once
+ * OVL_UPPERDATA is set it is no longer looked at.
+ */
+struct ovl_datamap {
+	struct file *lower;
+	loff_t size;
+	unsigned int shift;
+	unsigned long nbits;
+	unsigned long map[];
+};
+
+static inline struct ovl_datamap *ovl_lazy_datamap(struct inode *inode)
+{
+	if (ovl_has_upperdata(inode))
+		return NULL;
+
+	/* Pairs with smp_store_release() in ovl_datamap_init() */
+	return smp_load_acquire(&OVL_I(inode)->datamap);
+}
+
 int ovl_copy_up(struct dentry *dentry);
 int ovl_copy_up_with_data(struct dentry *dentry);
 int ovl_maybe_copy_up(struct dentry *dentry, int flags);
+int ovl_datamap_init(struct dentry *dentry);
+int ovl_datamap_fill(struct dentry *dentry, loff_t pos, loff_t len);
+void ovl_datamap_free(struct ovl_datamap *dm);
 int ovl_copy_xattr(struct super_block *sb, struct dentry *old,
 		   struct dentry *new);
 int ovl_set_attr(struct dentry *upper, struct kstat *stat);
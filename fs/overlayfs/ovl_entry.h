@@ -18,6 +18,7 @@ struct ovl_config {
 	bool nfs_export;
 	int xino;
 	bool metacopy;
+	bool lazydata;
 	bool userxattr;
 	bool ovl_volatile;
 };
@@ -83,6 +84,8 @@ struct ovl_fs {
 	struct dentry *whiteout;
 	/* r/o snapshot of upperdir sb's only taken on volatile mounts */
 	errseq_t errseq;
+	/* Names known to be absent from all lower layers of a dir */
+	struct ovl_negcache *negcache;
 };
 
 static inline struct vfsmount *ovl_upper_mnt(struct ovl_fs *ofs)
@@ -130,6 +133,8 @@ struct ovl_inode {
 	struct inode vfs_inode;
 	struct dentry *__upperdentry;
 	struct inode *lower;
+	/* Data copied up so far of a lazily copied up regular file */
+	struct ovl_datamap *datamap;
 
 	/* synchronize copy up and more */
 	struct mutex lock;
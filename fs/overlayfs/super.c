@@ -71,6 +71,8 @@ static void ovl_dentry_release(struct dentry *dentry)
 	struct ovl_entry *oe = dentry->d_fsdata;
 
 	if (oe) {
+		if (test_bit(OVL_E_NEGCACHE, &oe->flags))
+			ovl_negcache_purge(OVL_FS(dentry->d_sb), dentry);
 		ovl_entry_stack_free(oe);
 		kfree_rcu(oe, rcu);
 	}
@@ -186,6 +188,7 @@ static struct inode *ovl_alloc_inode(struct super_block *sb)
 	oi->__upperdentry = NULL;
 	oi->lower = NULL;
 	oi->lowerdata = NULL;
+	oi->datamap = NULL;
 	mutex_init(&oi->lock);
 
 	return &oi->vfs_inode;
@@ -210,6 +213,7 @@ static void ovl_destroy_inode(struct inode *inode)
 		ovl_dir_cache_free(inode);
 	else
 		iput(oi->lowerdata);
+	ovl_datamap_free(oi->datamap);
 }
 
 static void ovl_free_fs(struct ovl_fs *ofs)
@@ -245,6 +249,7 @@ static void ovl_free_fs(struct ovl_fs *ofs)
 	kfree(ofs->config.upperdir);
 	kfree(ofs->config.workdir);
 	kfree(ofs->config.redirect_mode);
+	ovl_negcache_free(ofs->negcache);
 	if (ofs->creator_cred)
 		put_cred(ofs->creator_cred);
 	kfree(ofs);
@@ -378,6 +383,8 @@ static int ovl_show_options(struct seq_file *m, struct dentry *dentry)
 	if (ofs->config.metacopy != ovl_metacopy_def)
 		seq_printf(m, ",metacopy=%s",
 			   ofs->config.metacopy ? "on" : "off");
+	if (ofs->config.lazydata)
+		seq_puts(m, ",lazydata=on");
 	if (ofs->config.ovl_volatile)
 		seq_puts(m, ",volatile");
 	if (ofs->config.userxattr)
@@ -436,6 +443,8 @@ enum {
 	OPT_XINO_AUTO,
 	OPT_METACOPY_ON,
 	OPT_METACOPY_OFF,
+	OPT_LAZYDATA_ON,
+	OPT_LAZYDATA_OFF,
 	OPT_VOLATILE,
 	OPT_ERR,
 };
@@ -458,6 +467,8 @@ static const match_table_t ovl_tokens = {
 	{OPT_XINO_AUTO,			"xino=auto"},
 	{OPT_METACOPY_ON,		"metacopy=on"},
 	{OPT_METACOPY_OFF,		"metacopy=off"},
+	{OPT_LAZYDATA_ON,		"lazydata=on"},
+	{OPT_LAZYDATA_OFF,		"lazydata=off"},
 	{OPT_VOLATILE,			"volatile"},
 	{OPT_ERR,			NULL}
 };
@@ -611,6 +622,14 @@ static int ovl_parse_opt(char *opt, struct ovl_config *config)
 			metacopy_opt = true;
 			break;
 
+		case OPT_LAZYDATA_ON:
+			config->lazydata = true;
+			break;
+
+		case OPT_LAZYDATA_OFF:
+			config->lazydata = false;
+			break;
+
 		case OPT_VOLATILE:
 			config->ovl_volatile = true;
 			break;
@@ -657,6 +676,16 @@ static int ovl_parse_opt(char *opt, struct ovl_config *config)
 	if (!config->upperdir && config->redirect_follow)
 		config->redirect_dir = true;
 
+	/* Resolve lazydata -> metacopy dependency */
+	if (config->lazydata && !config->metacopy) {
+		if (metacopy_opt) {
+			pr_err("conflicting options: lazydata=on,metacopy=off\n");
+			return -EINVAL;
+		}
+		/* Automatically enable metacopy otherwise. */
+		config->metacopy = true;
+	}
+
 	/* Resolve metacopy -> redirect_dir dependency */
 	if (config->metacopy && !config->redirect_dir) {
 		if (metacopy_opt && redirect_opt) {
@@ -744,6 +773,12 @@ static int ovl_parse_opt(char *opt, struct ovl_config *config)
 		config->metacopy = false;
 	}
 
+	/* Lazy data copy up is built on top of metacopy */
+	if (config->lazydata && !config->metacopy) {
+		pr_info("disabling lazydata due to metacopy=off\n");
+		config->lazydata = false;
+	}
+
 	return 0;
 }
 
@@ -1413,6 +1448,7 @@ static int ovl_make_workdir(struct super_block *sb, struct ovl_fs *ofs,
 		if (ofs->config.index || ofs->config.metacopy) {
 			ofs->config.index = false;
 			ofs->config.metacopy = false;
+			ofs->config.lazydata = false;
 			pr_warn("upper fs does not support xattr, falling back to index=off,metacopy=off.\n");
 		}
 		/*
@@ -2005,6 +2041,10 @@ static int ovl_fill_super(struct super_block *sb, void *data, int silent)
 	}
 
 	err = -ENOMEM;
+	ofs->negcache = ovl_negcache_alloc();
+	if (!ofs->negcache)
+		goto out_err;
+
 	splitlower = kstrdup(ofs->config.lowerdir, GFP_KERNEL);
 	if (!splitlower)
 		goto out_err;
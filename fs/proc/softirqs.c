@@ -25,9 +25,31 @@ static int show_softirqs(struct seq_file *p, void *v)
 	return 0;
 }
 
+/*
+ * /proc/softirqs_time  ... display the time spent in each softirq, in ns
+ */
+static int show_softirqs_time(struct seq_file *p, void *v)
+{
+	int i, j;
+
+	seq_puts(p, "                    ");
+	for_each_possible_cpu(i)
+		seq_printf(p, "CPU%-12d", i);
+	seq_putc(p, '\n');
+
+	for (i = 0; i < NR_SOFTIRQS; i++) {
+		seq_printf(p, "%12s:", softirq_to_name[i]);
+		for_each_possible_cpu(j)
+			seq_printf(p, " %14llu", kstat_softirq_time_cpu(i, j));
+		seq_putc(p, '\n');
+	}
+	return 0;
+}
+
 static int __init proc_softirqs_init(void)
 {
 	proc_create_single("softirqs", 0, NULL, show_softirqs);
+	proc_create_single("softirqs_time", 0, NULL, show_softirqs_time);
 	return 0;
 }
 fs_initcall(proc_softirqs_init);
@@ -384,6 +384,7 @@ struct mem_size_stats {
 	unsigned long private_dirty;
 	unsigned long referenced;
 	unsigned long anonymous;
+	unsigned long resident_shmem;
 	unsigned long lazyfree;
 	unsigned long anonymous_thp;
 	unsigned long shmem_thp;
@@ -443,6 +444,8 @@ static void smaps_account(struct mem_size_stats *mss, struct page *page,
 		mss->anonymous += size;
 		if (!PageSwapBacked(page) && !dirty && !PageDirty(page))
 			mss->lazyfree += size;
+	} else if (PageSwapBacked(page)) {
+		mss->resident_shmem += size;
 	}
 
 	mss->resident += size;
@@ -836,6 +839,34 @@ static int show_smap(struct seq_file *m, void *v)
 	return 0;
 }
 
+/*
+ * The proportional set size of @mm, as smaps_rollup shows it, for callers
+ * outside of procfs.  This walks the page tables of the whole address
+ * space, so it is as expensive as reading smaps_rollup.
+ */
+int proc_mm_pss(struct mm_struct *mm, struct proc_mm_pss *pss)
+{
+	struct mem_size_stats mss;
+	struct vm_area_struct *vma;
+	int ret;
+
+	memset(&mss, 0, sizeof(mss));
+
+	ret = mmap_read_lock_killable(mm);
+	if (ret)
+		return ret;
+	for (vma = mm->mmap; vma; vma = vma->vm_next)
+		smap_gather_stats(vma, &mss, 0);
+	mmap_read_unlock(mm);
+
+	pss->pss = mss.pss >> PSS_SHIFT;
+	pss->pss_anon = mss.pss_anon >> PSS_SHIFT;
+	pss->pss_file = mss.pss_file >> PSS_SHIFT;
+	pss->pss_shmem = mss.pss_shmem >> PSS_SHIFT;
+	pss->swap_pss = mss.swap_pss >> PSS_SHIFT;
+	return 0;
+}
+
 static int show_smaps_rollup(struct seq_file *m, void *v)
 {
 	struct proc_maps_private *priv = m->private;
@@ -942,6 +973,133 @@ static int show_smaps_rollup(struct seq_file *m, void *v)
 	release_task_mempolicy(priv);
 	mmap_read_unlock(mm);
 
+out_put_mm:
+	mmput(mm);
+out_put_task:
+	put_task_struct(priv->task);
+	priv->task = NULL;
+
+	return ret;
+}
+
+/*
+ * Number of PMD-sized ranges of each vma that smaps_rollup_fast walks.
+ * Larger vmas are sampled at an even stride.
+ */
+#define SMAPS_FAST_SAMPLES	32
+
+/*
+ * Walk an evenly spaced sample of @vma's page tables, just enough to
+ * estimate how widely its pages are shared.
+ */
+static void smap_sample_stats(struct vm_area_struct *vma,
+			      struct mem_size_stats *mss)
+{
+	unsigned long nr, stride, addr;
+
+	if (is_vm_hugetlb_page(vma))
+		return;
+
+	nr = DIV_ROUND_UP(vma->vm_end - (vma->vm_start & PMD_MASK), PMD_SIZE);
+	if (nr <= SMAPS_FAST_SAMPLES) {
+		walk_page_vma(vma, &smaps_walk_ops, mss);
+		return;
+	}
+
+	stride = (nr / SMAPS_FAST_SAMPLES) * PMD_SIZE;
+	for (addr = vma->vm_start & PMD_MASK; addr < vma->vm_end;
+	     addr += stride) {
+		unsigned long start = max(addr, vma->vm_start);
+		unsigned long end = min(addr + PMD_SIZE, vma->vm_end);
+
+		walk_page_range(vma->vm_mm, start, end, &smaps_walk_ops, mss);
+	}
+}
+
+/* @rss scaled by the fraction pss/resident seen in the sample */
+static u64 smaps_fast_estimate(unsigned long rss, u64 pss,
+			       unsigned long resident)
+{
+	if (!resident)
+		return rss;
+	return (rss * min_t(u64, div64_u64(pss, resident),
+			   1 << PSS_SHIFT)) >> PSS_SHIFT;
+}
+
+/*
+ * A cheap alternative to smaps_rollup.  The Rss and Swap figures come from
+ * the counters the mm maintains anyway, so they are exact and cost nothing
+ * to read.  The Pss figures are estimates: only a sample of each vma's page
+ * tables is walked, and the sharing seen there is applied to the exact Rss.
+ */
+static int show_smaps_rollup_fast(struct seq_file *m, void *v)
+{
+	struct proc_maps_private *priv = m->private;
+	unsigned long anon, file, shmem, swap, last_vma_end = 0;
+	struct mem_size_stats mss;
+	struct mm_struct *mm;
+	struct vm_area_struct *vma;
+	int ret = 0;
+
+	priv->task = get_proc_task(priv->inode);
+	if (!priv->task)
+		return -ESRCH;
+
+	mm = priv->mm;
+	if (!mm || !mmget_not_zero(mm)) {
+		ret = -ESRCH;
+		goto out_put_task;
+	}
+
+	memset(&mss, 0, sizeof(mss));
+
+	ret = mmap_read_lock_killable(mm);
+	if (ret)
+		goto out_put_mm;
+
+	for (vma = mm->mmap; vma;) {
+		smap_sample_stats(vma, &mss);
+		last_vma_end = vma->vm_end;
+
+		/* Losing a vma or two only makes the estimate rougher */
+		if (mmap_lock_is_contended(mm)) {
+			mmap_read_unlock(mm);
+			ret = mmap_read_lock_killable(mm);
+			if (ret)
+				goto out_put_mm;
+			vma = find_vma(mm, last_vma_end);
+			continue;
+		}
+		vma = vma->vm_next;
+	}
+	mmap_read_unlock(mm);
+
+	anon = get_mm_counter(mm, MM_ANONPAGES) << PAGE_SHIFT;
+	file = get_mm_counter(mm, MM_FILEPAGES) << PAGE_SHIFT;
+	shmem = get_mm_counter(mm, MM_SHMEMPAGES) << PAGE_SHIFT;
+	swap = get_mm_counter(mm, MM_SWAPENTS) << PAGE_SHIFT;
+
+	mss.pss_anon = smaps_fast_estimate(anon, mss.pss_anon, mss.anonymous);
+	mss.pss_shmem = smaps_fast_estimate(shmem, mss.pss_shmem,
+					    mss.resident_shmem);
+	mss.pss_file = smaps_fast_estimate(file, mss.pss_file,
+					   mss.resident - mss.anonymous -
+					   mss.resident_shmem);
+	mss.swap_pss = smaps_fast_estimate(swap, mss.swap_pss, mss.swap);
+
+	SEQ_PUT_DEC("Rss:            ", anon + file + shmem);
+	SEQ_PUT_DEC(" kB\nPss:            ",
+		    mss.pss_anon + mss.pss_file + mss.pss_shmem);
+	SEQ_PUT_DEC(" kB\nPss_Anon:       ", mss.pss_anon);
+	SEQ_PUT_DEC(" kB\nPss_File:       ", mss.pss_file);
+	SEQ_PUT_DEC(" kB\nPss_Shmem:      ", mss.pss_shmem);
+	SEQ_PUT_DEC(" kB\nRssAnon:        ", anon);
+	SEQ_PUT_DEC(" kB\nRssFile:        ", file);
+	SEQ_PUT_DEC(" kB\nRssShmem:       ", shmem);
+	SEQ_PUT_DEC(" kB\nSwap:           ", swap);
+	SEQ_PUT_DEC(" kB\nSwapPss:        ", mss.swap_pss);
+	seq_puts(m, " kB\n");
+
 out_put_mm:
 	mmput(mm);
 out_put_task:
@@ -964,7 +1122,8 @@ static int pid_smaps_open(struct inode *inode, struct file *file)
 	return do_maps_open(inode, file, &proc_pid_smaps_op);
 }
 
-static int smaps_rollup_open(struct inode *inode, struct file *file)
+static int __smaps_rollup_open(struct inode *inode, struct file *file,
+			       int (*show)(struct seq_file *, void *))
 {
 	int ret;
 	struct proc_maps_private *priv;
@@ -973,7 +1132,7 @@ static int smaps_rollup_open(struct inode *inode, struct file *file)
 	if (!priv)
 		return -ENOMEM;
 
-	ret = single_open(file, show_smaps_rollup, priv);
+	ret = single_open(file, show, priv);
 	if (ret)
 		goto out_free;
 
@@ -993,6 +1152,16 @@ static int smaps_rollup_open(struct inode *inode, struct file *file)
 	return ret;
 }
 
+static int smaps_rollup_open(struct inode *inode, struct file *file)
+{
+	return __smaps_rollup_open(inode, file, show_smaps_rollup);
+}
+
+static int smaps_rollup_fast_open(struct inode *inode, struct file *file)
+{
+	return __smaps_rollup_open(inode, file, show_smaps_rollup_fast);
+}
+
 static int smaps_rollup_release(struct inode *inode, struct file *file)
 {
 	struct seq_file *seq = file->private_data;
@@ -1019,6 +1188,13 @@ const struct file_operations proc_pid_smaps_rollup_operations = {
 	.release	= smaps_rollup_release,
 };
 
+const struct file_operations proc_pid_smaps_rollup_fast_operations = {
+	.open		= smaps_rollup_fast_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= smaps_rollup_release,
+};
+
 enum clear_refs_types {
 	CLEAR_REFS_ALL = 1,
 	CLEAR_REFS_ANON,
@@ -39,6 +39,7 @@
 #include "squashfs_fs_sb.h"
 #include "squashfs_fs_i.h"
 #include "squashfs.h"
+#include "page_actor.h"
 
 /*
  * Locate cache slot in range [offset, index] for specified inode.  If
@@ -494,7 +495,101 @@ static int squashfs_readpage(struct file *file, struct page *page)
 	return 0;
 }
 
+#ifdef CONFIG_SQUASHFS_FILE_DIRECT
+/*
+ * Decompress whole datablocks straight into the page cache.  The readahead
+ * window is first widened to datablock boundaries, then each datablock
+ * that is completely covered by the window is decompressed through a page
+ * actor over its pages.  Anything else (fragments, partially covered
+ * blocks, errors) is left !Uptodate for ->readpage to deal with.
+ */
+static void squashfs_readahead(struct readahead_control *ractl)
+{
+	struct inode *inode = ractl->mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	unsigned short shift = msblk->block_log - PAGE_SHIFT;
+	unsigned int max_pages = 1U << shift;
+	loff_t mask = msblk->block_size - 1;
+	loff_t start = readahead_pos(ractl) & ~mask;
+	loff_t isize = i_size_read(inode);
+	size_t len = readahead_length(ractl) + readahead_pos(ractl) - start;
+	int file_end = isize >> msblk->block_log;
+	struct page **pages;
+	int i;
+
+	readahead_expand(ractl, start, (len | mask) + 1);
+
+	pages = kmalloc_array(max_pages, sizeof(*pages), GFP_KERNEL);
+	if (!pages)
+		return;
+
+	for (;;) {
+		struct squashfs_page_actor *actor;
+		unsigned int nr_pages, block_pages;
+		int index, bsize, expected = 0, res = -EIO;
+		u64 block = 0;
+
+		/* never let a batch cross a datablock boundary */
+		nr_pages = __readahead_batch(ractl, pages, max_pages -
+				(readahead_index(ractl) & (max_pages - 1)));
+		if (!nr_pages)
+			break;
+
+		index = pages[0]->index >> shift;
+		block_pages = min_t(loff_t, max_pages, DIV_ROUND_UP(isize -
+				((loff_t)index << msblk->block_log), PAGE_SIZE));
+		if (pages[0]->index & (max_pages - 1) ||
+		    nr_pages != block_pages)
+			goto unlock;
+
+		if (index == file_end && squashfs_i(inode)->fragment_block !=
+							SQUASHFS_INVALID_BLK)
+			goto unlock;
+
+		expected = index == file_end ? (isize & mask) :
+					       msblk->block_size;
+
+		bsize = read_blocklist(inode, index, &block);
+		if (bsize <= 0)
+			goto unlock;
+
+		actor = squashfs_page_actor_init_special(pages, nr_pages, 0);
+		if (!actor)
+			goto unlock;
+		res = squashfs_read_data(inode->i_sb, block, bsize, NULL,
+					 actor);
+		kfree(actor);
+
+		if (res == expected) {
+			/* Last page may have trailing bytes not filled */
+			int bytes = res % PAGE_SIZE;
+
+			if (bytes) {
+				void *pageaddr;
+
+				pageaddr = kmap_atomic(pages[nr_pages - 1]);
+				memset(pageaddr + bytes, 0, PAGE_SIZE - bytes);
+				kunmap_atomic(pageaddr);
+			}
+		}
+unlock:
+		for (i = 0; i < nr_pages; i++) {
+			if (res == expected) {
+				flush_dcache_page(pages[i]);
+				SetPageUptodate(pages[i]);
+			}
+			unlock_page(pages[i]);
+			put_page(pages[i]);
+		}
+	}
+
+	kfree(pages);
+}
+#endif
 
 const struct address_space_operations squashfs_aops = {
-	.readpage = squashfs_readpage
+	.readpage = squashfs_readpage,
+#ifdef CONFIG_SQUASHFS_FILE_DIRECT
+	.readahead = squashfs_readahead,
+#endif
 };
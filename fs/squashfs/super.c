@@ -46,10 +46,12 @@ enum Opt_errors {
 
 enum squashfs_param {
 	Opt_errors,
+	Opt_fragment_cache,
 };
 
 struct squashfs_mount_opts {
 	enum Opt_errors errors;
+	unsigned int fragment_cache;
 };
 
 static const struct constant_table squashfs_param_errors[] = {
@@ -60,6 +62,7 @@ static const struct constant_table squashfs_param_errors[] = {
 
 static const struct fs_parameter_spec squashfs_fs_parameters[] = {
 	fsparam_enum("errors", Opt_errors, squashfs_param_errors),
+	fsparam_u32("fragment_cache", Opt_fragment_cache),
 	{}
 };
 
@@ -77,6 +80,11 @@ static int squashfs_parse_param(struct fs_context *fc, struct fs_parameter *para
 	case Opt_errors:
 		opts->errors = result.uint_32;
 		break;
+	case Opt_fragment_cache:
+		if (result.uint_32 < 1 || result.uint_32 > 64)
+			return invalfc(fc, "fragment_cache must be 1..64");
+		opts->fragment_cache = result.uint_32;
+		break;
 	default:
 		return -EINVAL;
 	}
@@ -134,6 +142,7 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 	msblk = sb->s_fs_info;
 
 	msblk->panic_on_errors = (opts->errors == Opt_errors_panic);
+	msblk->cached_fragments = opts->fragment_cache;
 
 	msblk->devblksize = sb_min_blocksize(sb, SQUASHFS_DEVBLK_SIZE);
 	msblk->devblksize_log2 = ffz(~msblk->devblksize);
@@ -320,7 +329,7 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 		goto check_directory_table;
 
 	msblk->fragment_cache = squashfs_cache_init("fragment",
-		SQUASHFS_CACHED_FRAGMENTS, msblk->block_size);
+		msblk->cached_fragments, msblk->block_size);
 	if (msblk->fragment_cache == NULL) {
 		err = -ENOMEM;
 		goto failed_mount;
@@ -433,6 +442,8 @@ static int squashfs_show_options(struct seq_file *s, struct dentry *root)
 		seq_puts(s, ",errors=panic");
 	else
 		seq_puts(s, ",errors=continue");
+	if (msblk->cached_fragments != SQUASHFS_CACHED_FRAGMENTS)
+		seq_printf(s, ",fragment_cache=%u", msblk->cached_fragments);
 
 	return 0;
 }
@@ -445,6 +456,7 @@ static int squashfs_init_fs_context(struct fs_context *fc)
 	if (!opts)
 		return -ENOMEM;
 
+	opts->fragment_cache = SQUASHFS_CACHED_FRAGMENTS;
 	fc->fs_private = opts;
 	fc->ops = &squashfs_context_ops;
 	return 0;
@@ -0,0 +1,210 @@
+// SPDX-License-Identifier: GPL-2.0+
+#include "xfs.h"
+#include "xfs_fs.h"
+#include "xfs_shared.h"
+#include "xfs_format.h"
+#include "xfs_trans_resv.h"
+#include "xfs_mount.h"
+#include "xfs_inode.h"
+#include "xfs_scrub.h"
+#include "scrub/scrub.h"
+#include "scrub/health.h"
+#include <linux/kthread.h>
+#include <linux/ioprio.h>
+#include <linux/task_io_accounting_ops.h>
+
+/*
+ * Scrubbing Every AG in Parallel
+ * ==============================
+ *
+ * A full check of a large filesystem driven one scrub call at a time from
+ * userspace is limited to one AG at a time.  Instead, we start a number of
+ * worker threads, each of which claims the next unchecked AG and runs every
+ * per-AG scrubber against it through the normal xfs_scrub_metadata() path,
+ * so locking, retries and health updates are exactly as for a single call.
+ *
+ * To keep foreground I/O unharmed, the workers can be given a nice value and
+ * the idle I/O class, and the metadata they read is throttled to a shared
+ * bytes per second budget.  The bytes read are measured with the task I/O
+ * accounting of each worker, so the throttle needs CONFIG_TASK_IO_ACCOUNTING.
+ *
+ * Inode and whole-filesystem metadata are not part of the batch.
+ */
+
+static const __u32 xchk_ags_types[] = {
+	XFS_SCRUB_TYPE_SB,
+	XFS_SCRUB_TYPE_AGF,
+	XFS_SCRUB_TYPE_AGFL,
+	XFS_SCRUB_TYPE_AGI,
+	XFS_SCRUB_TYPE_BNOBT,
+	XFS_SCRUB_TYPE_CNTBT,
+	XFS_SCRUB_TYPE_INOBT,
+	XFS_SCRUB_TYPE_FINOBT,
+	XFS_SCRUB_TYPE_RMAPBT,
+	XFS_SCRUB_TYPE_REFCNTBT,
+};
+
+struct xchk_ags_ctl {
+	struct file		*file;
+	struct xfs_mount	*mp;
+	struct xfs_scrub_ags	*sa;
+
+	/* Next AG to hand out to a worker. */
+	atomic_t		next_agno;
+
+	/* Throttle state, shared by all workers. */
+	atomic64_t		bytes;
+	unsigned long		start;
+
+	/* Progress, protected by lock. */
+	spinlock_t		lock;
+	struct xchk_ags_progress progress;
+
+	atomic_t		nr_running;
+	struct completion	done;
+	int			error;
+};
+
+/* Sleep until the bytes read so far fit in the rate budget. */
+static void
+xchk_ags_throttle(
+	struct xchk_ags_ctl	*ctl,
+	uint64_t		bytes)
+{
+	unsigned long		due;
+	uint64_t		total;
+
+	total = atomic64_add_return(bytes, &ctl->bytes);
+	if (!ctl->sa->sa_rate)
+		return;
+
+	due = ctl->start + div64_u64(total * HZ, ctl->sa->sa_rate);
+	if (time_before(jiffies, due))
+		schedule_timeout_interruptible(due - jiffies);
+}
+
+/* Run every per-AG scrubber against @agno. */
+static int
+xchk_ags_one(
+	struct xchk_ags_ctl	*ctl,
+	xfs_agnumber_t		agno)
+{
+	struct xfs_scrub_metadata sm;
+	uint64_t		inblock;
+	int			i;
+	int			error;
+
+	for (i = 0; i < ARRAY_SIZE(xchk_ags_types); i++) {
+		if (READ_ONCE(ctl->error))
+			return 0;
+
+		memset(&sm, 0, sizeof(sm));
+		sm.sm_type = xchk_ags_types[i];
+		sm.sm_agno = agno;
+
+		inblock = task_io_get_inblock(current);
+		error = xfs_scrub_metadata(ctl->file, &sm);
+		if (error == -ENOENT)
+			continue;
+		if (error)
+			return error;
+
+		spin_lock(&ctl->lock);
+		xchk_health_account(&ctl->progress, &sm);
+		spin_unlock(&ctl->lock);
+
+		xchk_ags_throttle(ctl,
+				(task_io_get_inblock(current) - inblock) << 9);
+	}
+
+	spin_lock(&ctl->lock);
+	ctl->progress.ags_done++;
+	spin_unlock(&ctl->lock);
+	return 0;
+}
+
+static int
+xchk_ags_worker(
+	void			*data)
+{
+	struct xchk_ags_ctl	*ctl = data;
+	xfs_agnumber_t		agno;
+	int			error;
+
+	set_user_nice(current, ctl->sa->sa_nice);
+	if (ctl->sa->sa_flags & XFS_SCRUB_AGS_IDLE_IO)
+		set_task_ioprio(current,
+				IOPRIO_PRIO_VALUE(IOPRIO_CLASS_IDLE, 0));
+
+	while (!READ_ONCE(ctl->error)) {
+		agno = atomic_inc_return(&ctl->next_agno) - 1;
+		if (agno >= ctl->mp->m_sb.sb_agcount)
+			break;
+
+		error = xchk_ags_one(ctl, agno);
+		if (error)
+			cmpxchg(&ctl->error, 0, error);
+	}
+
+	if (atomic_dec_and_test(&ctl->nr_running))
+		complete(&ctl->done);
+	return 0;
+}
+
+/* Scrub the metadata of every AG with up to sa_threads workers. */
+int
+xfs_scrub_all_ags(
+	struct file		*file,
+	struct xfs_scrub_ags	*sa)
+{
+	struct xchk_ags_ctl	*ctl;
+	struct xfs_mount	*mp = XFS_I(file_inode(file))->i_mount;
+	struct task_struct	*task;
+	unsigned int		nr, i;
+	int			error;
+
+	if (sa->sa_flags & ~XFS_SCRUB_AGS_FLAGS_ALL)
+		return -EINVAL;
+	if (sa->sa_nice < MIN_NICE || sa->sa_nice > MAX_NICE)
+		return -EINVAL;
+
+	ctl = kmem_zalloc(sizeof(*ctl), KM_MAYFAIL);
+	if (!ctl)
+		return -ENOMEM;
+
+	ctl->file = file;
+	ctl->mp = mp;
+	ctl->sa = sa;
+	ctl->start = jiffies;
+	spin_lock_init(&ctl->lock);
+	init_completion(&ctl->done);
+
+	nr = sa->sa_threads ? sa->sa_threads : num_online_cpus();
+	nr = min(nr, mp->m_sb.sb_agcount);
+
+	/* Hold off completion until every worker has been started. */
+	atomic_set(&ctl->nr_running, 1);
+	for (i = 0; i < nr; i++) {
+		atomic_inc(&ctl->nr_running);
+		task = kthread_run(xchk_ags_worker, ctl, "xfs_scrub/%s:%u",
+				mp->m_super->s_id, i);
+		if (IS_ERR(task)) {
+			atomic_dec(&ctl->nr_running);
+			if (i == 0)
+				ctl->error = PTR_ERR(task);
+			break;
+		}
+	}
+	if (!atomic_dec_and_test(&ctl->nr_running)) {
+		if (wait_for_completion_killable(&ctl->done)) {
+			cmpxchg(&ctl->error, 0, -EINTR);
+			wait_for_completion(&ctl->done);
+		}
+	}
+
+	error = ctl->error;
+	sa->sa_progress = ctl->progress;
+	sa->sa_progress.bytes = atomic64_read(&ctl->bytes);
+	kmem_free(ctl);
+	return error;
+}
@@ -10,6 +10,7 @@
 #include "xfs_btree.h"
 #include "xfs_ag.h"
 #include "xfs_health.h"
+#include "xfs_scrub.h"
 #include "scrub/scrub.h"
 #include "scrub/health.h"
 
@@ -170,6 +171,27 @@ xchk_update_health(
 	}
 }
 
+/*
+ * Fold the outcome of one scrub call made on behalf of xfs_scrub_all_ags()
+ * into its progress counters.  The in-core health state has already been
+ * updated by xchk_update_health() by then.
+ */
+void
+xchk_health_account(
+	struct xchk_ags_progress	*progress,
+	const struct xfs_scrub_metadata	*sm)
+{
+	progress->checked++;
+	if (sm->sm_flags & (XFS_SCRUB_OFLAG_CORRUPT | XFS_SCRUB_OFLAG_XCORRUPT))
+		progress->corrupt++;
+	if (sm->sm_flags & XFS_SCRUB_OFLAG_PREEN)
+		progress->preen++;
+	if (sm->sm_flags & XFS_SCRUB_OFLAG_XFAIL)
+		progress->xfail++;
+	if (sm->sm_flags & XFS_SCRUB_OFLAG_INCOMPLETE)
+		progress->incomplete++;
+}
+
 /* Is the given per-AG btree healthy enough for scanning? */
 bool
 xchk_ag_btree_healthy_enough(
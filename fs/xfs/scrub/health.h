@@ -6,8 +6,12 @@
 #ifndef __XFS_SCRUB_HEALTH_H__
 #define __XFS_SCRUB_HEALTH_H__
 
+struct xchk_ags_progress;
+
 unsigned int xchk_health_mask_for_scrub_type(__u32 scrub_type);
 void xchk_update_health(struct xfs_scrub *sc);
+void xchk_health_account(struct xchk_ags_progress *progress,
+		const struct xfs_scrub_metadata *sm);
 bool xchk_ag_btree_healthy_enough(struct xfs_scrub *sc, struct xfs_perag *pag,
 		xfs_btnum_t btnum);
 
@@ -6,10 +6,38 @@
 #ifndef __XFS_SCRUB_H__
 #define __XFS_SCRUB_H__
 
+/* Outcome of scrubbing every AG, see xfs_scrub_all_ags(). */
+struct xchk_ags_progress {
+	uint64_t		checked;	/* objects checked */
+	uint64_t		corrupt;	/* objects found corrupt */
+	uint64_t		preen;		/* objects that could be better */
+	uint64_t		xfail;		/* cross-references not checked */
+	uint64_t		incomplete;	/* checks that didn't finish */
+	uint64_t		bytes;		/* metadata bytes read */
+	uint32_t		ags_done;	/* AGs completely checked */
+};
+
+struct xfs_scrub_ags {
+	/* Inputs */
+	uint64_t		sa_rate;	/* bytes/sec read, 0 = no limit */
+	uint32_t		sa_flags;	/* XFS_SCRUB_AGS_* */
+	uint32_t		sa_threads;	/* 0 = one per online cpu */
+	int32_t			sa_nice;	/* nice value of the workers */
+
+	/* Outputs */
+	struct xchk_ags_progress sa_progress;
+};
+
+/* Put the workers in the idle I/O scheduling class. */
+#define XFS_SCRUB_AGS_IDLE_IO	(1u << 0)
+#define XFS_SCRUB_AGS_FLAGS_ALL	(XFS_SCRUB_AGS_IDLE_IO)
+
 #ifndef CONFIG_XFS_ONLINE_SCRUB
 # define xfs_scrub_metadata(file, sm)	(-ENOTTY)
+# define xfs_scrub_all_ags(file, sa)	(-ENOTTY)
 #else
 int xfs_scrub_metadata(struct file *file, struct xfs_scrub_metadata *sm);
+int xfs_scrub_all_ags(struct file *file, struct xfs_scrub_ags *sa);
 #endif /* CONFIG_XFS_ONLINE_SCRUB */
 
 #endif	/* __XFS_SCRUB_H__ */
@@ -38,9 +38,14 @@ static inline int node_to_pxm(int node)
 
 #ifdef CONFIG_ACPI_HMAT
 extern void disable_hmat(void);
+extern int hmat_node_is_slow(int nid);
 #else				/* CONFIG_ACPI_HMAT */
 static inline void disable_hmat(void)
 {
 }
+static inline int hmat_node_is_slow(int nid)
+{
+	return -ENOENT;
+}
 #endif				/* CONFIG_ACPI_HMAT */
 #endif				/* __ACPI_NUMA_H */
@@ -116,6 +116,8 @@ struct aead_request {
  * @setkey: see struct skcipher_alg
  * @encrypt: see struct skcipher_alg
  * @decrypt: see struct skcipher_alg
+ * @encrypt_batch: see struct skcipher_alg
+ * @decrypt_batch: see struct skcipher_alg
  * @ivsize: see struct skcipher_alg
  * @chunksize: see struct skcipher_alg
  * @init: Initialize the cryptographic transformation object. This function
@@ -139,6 +141,10 @@ struct aead_alg {
 	int (*setauthsize)(struct crypto_aead *tfm, unsigned int authsize);
 	int (*encrypt)(struct aead_request *req);
 	int (*decrypt)(struct aead_request *req);
+	void (*encrypt_batch)(struct aead_request **reqs, unsigned int nr,
+			      int *errs);
+	void (*decrypt_batch)(struct aead_request **reqs, unsigned int nr,
+			      int *errs);
 	int (*init)(struct crypto_aead *tfm);
 	void (*exit)(struct crypto_aead *tfm);
 
@@ -366,6 +372,34 @@ int crypto_aead_encrypt(struct aead_request *req);
  */
 int crypto_aead_decrypt(struct aead_request *req);
 
+/**
+ * crypto_aead_encrypt_batch() - encrypt a batch of AEAD requests
+ * @reqs: array of @nr requests, all on the same aead handle
+ * @nr: number of requests
+ * @errs: array of @nr ints receiving the result of each request
+ *
+ * Equivalent to calling crypto_aead_encrypt() on each request in turn, but
+ * lets implementations that support it process the requests together.
+ *
+ * Return: 0 if every request returned 0, otherwise the first non-zero result
+ */
+int crypto_aead_encrypt_batch(struct aead_request **reqs, unsigned int nr,
+			      int *errs);
+
+/**
+ * crypto_aead_decrypt_batch() - decrypt a batch of AEAD requests
+ * @reqs: array of @nr requests, all on the same aead handle
+ * @nr: number of requests
+ * @errs: array of @nr ints receiving the result of each request
+ *
+ * Batched counterpart to crypto_aead_decrypt(), see
+ * crypto_aead_encrypt_batch().
+ *
+ * Return: 0 if every request returned 0, otherwise the first non-zero result
+ */
+int crypto_aead_decrypt_batch(struct aead_request **reqs, unsigned int nr,
+			      int *errs);
+
 /**
  * DOC: Asynchronous AEAD Request Handle
  *
@@ -79,6 +79,12 @@ struct crypto_sync_skcipher {
  *	     be called in parallel with the same transformation object.
  * @decrypt: Decrypt a single block. This is a reverse counterpart to @encrypt
  *	     and the conditions are exactly the same.
+ * @encrypt_batch: Optional. Encrypt @nr independent requests on the same
+ *		   transformation object in one call, storing what @encrypt
+ *		   would have returned for reqs[i] in errs[i]. Meant for
+ *		   implementations that interleave several streams in SIMD
+ *		   lanes or amortise per-call setup across requests.
+ * @decrypt_batch: Optional. Batched counterpart to @decrypt.
  * @init: Initialize the cryptographic transformation object. This function
  *	  is used to initialize the cryptographic transformation object.
  *	  This function is called only once at the instantiation time, right
@@ -99,13 +105,18 @@ struct crypto_sync_skcipher {
  * 	      in parallel. Should be a multiple of chunksize.
  * @base: Definition of a generic crypto algorithm.
  *
- * All fields except @ivsize are mandatory and must be filled.
+ * All fields except @ivsize and the batch operations are mandatory and must
+ * be filled.
  */
 struct skcipher_alg {
 	int (*setkey)(struct crypto_skcipher *tfm, const u8 *key,
 	              unsigned int keylen);
 	int (*encrypt)(struct skcipher_request *req);
 	int (*decrypt)(struct skcipher_request *req);
+	void (*encrypt_batch)(struct skcipher_request **reqs, unsigned int nr,
+			      int *errs);
+	void (*decrypt_batch)(struct skcipher_request **reqs, unsigned int nr,
+			      int *errs);
 	int (*init)(struct crypto_skcipher *tfm);
 	void (*exit)(struct crypto_skcipher *tfm);
 
@@ -431,6 +442,36 @@ int crypto_skcipher_encrypt(struct skcipher_request *req);
  */
 int crypto_skcipher_decrypt(struct skcipher_request *req);
 
+/**
+ * crypto_skcipher_encrypt_batch() - encrypt a batch of requests
+ * @reqs: array of @nr requests, all on the same skcipher handle
+ * @nr: number of requests
+ * @errs: array of @nr ints receiving the result of each request
+ *
+ * Equivalent to calling crypto_skcipher_encrypt() on each request in turn,
+ * but lets implementations that support it process the requests together.
+ * Asynchronous completion works as for single requests: a request whose
+ * result is -EINPROGRESS or -EBUSY completes through its callback.
+ *
+ * Return: 0 if every request returned 0, otherwise the first non-zero result
+ */
+int crypto_skcipher_encrypt_batch(struct skcipher_request **reqs,
+				  unsigned int nr, int *errs);
+
+/**
+ * crypto_skcipher_decrypt_batch() - decrypt a batch of requests
+ * @reqs: array of @nr requests, all on the same skcipher handle
+ * @nr: number of requests
+ * @errs: array of @nr ints receiving the result of each request
+ *
+ * Batched counterpart to crypto_skcipher_decrypt(), see
+ * crypto_skcipher_encrypt_batch().
+ *
+ * Return: 0 if every request returned 0, otherwise the first non-zero result
+ */
+int crypto_skcipher_decrypt_batch(struct skcipher_request **reqs,
+				  unsigned int nr, int *errs);
+
 /**
  * DOC: Symmetric Key Cipher Request Handle
  *
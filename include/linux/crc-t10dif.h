@@ -13,4 +13,6 @@ extern __u16 crc_t10dif_generic(__u16 crc, const unsigned char *buffer,
 extern __u16 crc_t10dif(unsigned char const *, size_t);
 extern __u16 crc_t10dif_update(__u16 crc, unsigned char const *, size_t);
 
+u16 crc_t10dif_arch(u16 crc, const u8 *data, size_t length);
+
 #endif
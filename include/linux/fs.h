@@ -947,6 +947,9 @@ struct fown_struct {
  * @ra_pages: Maximum size of a readahead request.
  * @mmap_miss: How many mmap accesses missed in the page cache.
  * @prev_pos: The last byte in the most recent read request.
+ * @prev_miss: Index of the most recent non-sequential miss.
+ * @stride: Distance between the two most recent non-sequential misses.
+ * @stride_size: Request size of a confirmed strided reader, or 0.
  */
 struct file_ra_state {
 	pgoff_t start;
@@ -955,6 +958,9 @@ struct file_ra_state {
 	unsigned int ra_pages;
 	unsigned int mmap_miss;
 	loff_t prev_pos;
+	pgoff_t prev_miss;
+	long stride;
+	unsigned int stride_size;
 };
 
 /*
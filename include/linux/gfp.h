@@ -716,6 +716,11 @@ unsigned long __alloc_pages_bulk(gfp_t gfp, int preferred_nid,
 				struct list_head *page_list,
 				struct page **page_array);
 
+unsigned long __alloc_pages_bulk_order(gfp_t gfp, unsigned int order,
+				int preferred_nid, nodemask_t *nodemask,
+				int nr_pages, struct list_head *page_list,
+				struct page **page_array);
+
 /* Bulk allocate order-0 pages */
 static inline unsigned long
 alloc_pages_bulk_list(gfp_t gfp, unsigned long nr_pages, struct list_head *list)
@@ -744,6 +749,35 @@ alloc_pages_bulk_array_node(gfp_t gfp, int nid, unsigned long nr_pages, struct p
 	return __alloc_pages_bulk(gfp, nid, NULL, nr_pages, NULL, page_array);
 }
 
+/* Bulk allocate pages of a single order up to PAGE_ALLOC_COSTLY_ORDER */
+static inline unsigned long
+alloc_pages_bulk_list_order(gfp_t gfp, unsigned int order,
+			    unsigned long nr_pages, struct list_head *list)
+{
+	return __alloc_pages_bulk_order(gfp, order, numa_mem_id(), NULL,
+					nr_pages, list, NULL);
+}
+
+static inline unsigned long
+alloc_pages_bulk_array_order(gfp_t gfp, unsigned int order,
+			     unsigned long nr_pages, struct page **page_array)
+{
+	return __alloc_pages_bulk_order(gfp, order, numa_mem_id(), NULL,
+					nr_pages, NULL, page_array);
+}
+
+static inline unsigned long
+alloc_pages_bulk_array_order_node(gfp_t gfp, unsigned int order, int nid,
+				  unsigned long nr_pages,
+				  struct page **page_array)
+{
+	if (nid == NUMA_NO_NODE)
+		nid = numa_mem_id();
+
+	return __alloc_pages_bulk_order(gfp, order, nid, NULL, nr_pages,
+					NULL, page_array);
+}
+
 /*
  * Allocate pages, preferring the node given as nid. The node must be valid and
  * online. For more general interface, see alloc_pages_node().
@@ -845,6 +879,7 @@ extern void page_frag_free(void *addr);
 
 void page_alloc_init(void);
 void drain_zone_pages(struct zone *zone, struct per_cpu_pages *pcp);
+bool decay_pcp_high(struct zone *zone, struct per_cpu_pages *pcp);
 void drain_all_pages(struct zone *zone);
 void drain_local_pages(struct zone *zone);
 
@@ -149,6 +149,26 @@ static inline void clear_user_highpage(struct page *page, unsigned long vaddr)
 }
 #endif
 
+/*
+ * Clear a page that is unlikely to be accessed soon, without displacing
+ * useful data from the cache where the architecture can do so.
+ */
+#ifdef __HAVE_ARCH_CLEAR_PAGE_NOCACHE
+static inline void clear_user_highpage_nocache(struct page *page,
+					       unsigned long vaddr)
+{
+	void *addr = kmap_atomic(page);
+	clear_page_nocache(addr);
+	kunmap_atomic(addr);
+}
+#else
+static inline void clear_user_highpage_nocache(struct page *page,
+					       unsigned long vaddr)
+{
+	clear_user_highpage(page, vaddr);
+}
+#endif
+
 #ifndef __HAVE_ARCH_ALLOC_ZEROED_USER_HIGHPAGE_MOVABLE
 /**
  * alloc_zeroed_user_highpage_movable - Allocate a zeroed HIGHMEM page for a VMA that the caller knows can move
@@ -118,6 +118,8 @@ enum hrtimer_restart {
  * @is_soft:	Set if hrtimer will be expired in soft interrupt context.
  * @is_hard:	Set if hrtimer will be expired in hard interrupt context
  *		even on RT.
+ * @slack:	Minimum slack in ns applied when the timer is started,
+ *		see hrtimer_set_slack()
  *
  * The hrtimer structure must be initialized by hrtimer_init()
  */
@@ -138,6 +140,7 @@ struct hrtimer {
 	u8				is_rel;
 	u8				is_soft;
 	u8				is_hard;
+	u32				slack;
 };
 
 /**
@@ -209,6 +212,9 @@ enum  hrtimer_base_type {
  * @nr_retries:		Total number of hrtimer interrupt retries
  * @nr_hangs:		Total number of hrtimer interrupt hangs
  * @max_hang_time:	Maximum time spent in hrtimer_interrupt
+ * @nr_coalesced:	Total number of timers expired ahead of their hard
+ *			expiry because an earlier timer's interrupt covered
+ *			their slack window
  * @softirq_expiry_lock: Lock which is taken while softirq based hrtimer are
  *			 expired
  * @timer_waiters:	A hrtimer_cancel() invocation waits for the timer
@@ -258,6 +264,7 @@ struct hrtimer_cpu_base {
 	unsigned short			nr_retries;
 	unsigned short			nr_hangs;
 	unsigned int			max_hang_time;
+	unsigned int			nr_coalesced;
 #endif
 #ifdef CONFIG_PREEMPT_RT
 	spinlock_t			softirq_expiry_lock;
@@ -452,6 +459,20 @@ static inline void destroy_hrtimer_on_stack(struct hrtimer *timer) { }
 extern void hrtimer_start_range_ns(struct hrtimer *timer, ktime_t tim,
 				   u64 range_ns, const enum hrtimer_mode mode);
 
+/**
+ * hrtimer_set_slack - set the default slack of an hrtimer
+ * @timer:	the timer to be configured
+ * @slack_ns:	how late the timer may expire, in nanoseconds
+ *
+ * hrtimer_start() and hrtimer_start_range_ns() use at least this slack, so
+ * that timers which don't need to expire at a precise time can share their
+ * interrupt with other timers expiring in the same window.
+ */
+static inline void hrtimer_set_slack(struct hrtimer *timer, u64 slack_ns)
+{
+	timer->slack = min_t(u64, slack_ns, U32_MAX);
+}
+
 /**
  * hrtimer_start - (re)start an hrtimer
  * @timer:	the timer to be added
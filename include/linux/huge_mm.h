@@ -182,6 +182,15 @@ static inline bool __transparent_hugepage_enabled(struct vm_area_struct *vma)
 
 bool transparent_hugepage_active(struct vm_area_struct *vma);
 
+/* Smallest order of the per-size anonymous THP knobs, see thp_anon_orders(). */
+#define THP_ANON_ORDER_MIN	2
+
+extern unsigned long huge_anon_orders_always;
+extern unsigned long huge_anon_orders_madvise;
+extern unsigned long huge_anon_orders_inherit;
+
+unsigned long thp_anon_orders(struct vm_area_struct *vma);
+
 #define transparent_hugepage_use_zero_page()				\
 	(transparent_hugepage_flags &					\
 	 (1<<TRANSPARENT_HUGEPAGE_USE_ZERO_PAGE_FLAG))
@@ -380,6 +389,11 @@ static inline bool transparent_hugepage_active(struct vm_area_struct *vma)
 	return false;
 }
 
+static inline unsigned long thp_anon_orders(struct vm_area_struct *vma)
+{
+	return 0;
+}
+
 static inline bool transhuge_vma_suitable(struct vm_area_struct *vma,
 		unsigned long haddr)
 {
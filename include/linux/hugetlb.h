@@ -1097,10 +1097,9 @@ static inline void set_huge_swap_pte_at(struct mm_struct *mm, unsigned long addr
 }
 #endif	/* CONFIG_HUGETLB_PAGE */
 
-#ifdef CONFIG_HUGETLB_PAGE_FREE_VMEMMAP
-extern bool hugetlb_free_vmemmap_enabled;
-#else
-#define hugetlb_free_vmemmap_enabled	false
+#if defined(CONFIG_HUGETLB_PAGE_FREE_VMEMMAP) && defined(CONFIG_PROC_SYSCTL)
+int hugetlb_optimize_vmemmap_handler(struct ctl_table *table, int write,
+				     void *buffer, size_t *length, loff_t *ppos);
 #endif
 
 static inline spinlock_t *huge_pte_lock(struct hstate *h,
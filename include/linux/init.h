@@ -272,6 +272,7 @@ struct file_system_type;
 
 /* Defined in init/main.c */
 extern int do_one_initcall(initcall_t fn);
+extern void async_schedule_initcall(initcall_t fn);
 extern char __initdata boot_command_line[];
 extern char *saved_command_line;
 extern unsigned int reset_devices;
@@ -424,6 +425,24 @@ extern bool initcall_debug;
 #define late_initcall(fn)		__define_initcall(fn, 7)
 #define late_initcall_sync(fn)		__define_initcall(fn, 7s)
 
+/*
+ * An initcall nothing else in its level depends on.  When its turn comes it
+ * is started in the background and runs alongside the rest of the level;
+ * it is done before the next level starts.
+ */
+#define __define_async_initcall(fn, id)				\
+	static int __init __async_##fn(void)			\
+	{							\
+		async_schedule_initcall(fn);			\
+		return 0;					\
+	}							\
+	__define_initcall(__async_##fn, id)
+
+#define subsys_initcall_async(fn)	__define_async_initcall(fn, 4)
+#define fs_initcall_async(fn)		__define_async_initcall(fn, 5)
+#define device_initcall_async(fn)	__define_async_initcall(fn, 6)
+#define late_initcall_async(fn)		__define_async_initcall(fn, 7)
+
 #define __initcall(fn) device_initcall(fn)
 
 #define __exitcall(fn)						\
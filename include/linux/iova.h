@@ -25,13 +25,22 @@ struct iova {
 struct iova_magazine;
 struct iova_cpu_rcache;
 
-#define IOVA_RANGE_CACHE_MAX_SIZE 6	/* log of max cached IOVA range size (in pages) */
-#define MAX_GLOBAL_MAGS 32	/* magazines per bin */
+/* log of max cached IOVA range size (in pages) */
+#ifdef CONFIG_IOMMU_IOVA_RCACHE_ORDER
+#define IOVA_RANGE_CACHE_MAX_SIZE CONFIG_IOMMU_IOVA_RCACHE_ORDER
+#else
+#define IOVA_RANGE_CACHE_MAX_SIZE 6
+#endif
+#define MAX_GLOBAL_MAGS 32	/* magazines per bin and node */
 
-struct iova_rcache {
+struct iova_depot {
 	spinlock_t lock;
-	unsigned long depot_size;
-	struct iova_magazine *depot[MAX_GLOBAL_MAGS];
+	unsigned long size;
+	struct iova_magazine *mags[MAX_GLOBAL_MAGS];
+};
+
+struct iova_rcache {
+	struct iova_depot *depots;	/* one per NUMA node */
 	struct iova_cpu_rcache __percpu *cpu_rcaches;
 };
 
@@ -95,6 +104,11 @@ struct iova_domain {
 						   flush-queues */
 	atomic_t fq_timer_on;			/* 1 when timer is active, 0
 						   when not */
+	unsigned long fq_timeout;		/* Timer period in jiffies */
+	unsigned int fq_batch;			/* Flush once this many entries
+						   are queued, 0 if unbounded */
+	atomic_t fq_pending;			/* Entries queued since the
+						   last flush */
 	struct hlist_node	cpuhp_dead;
 };
 
@@ -155,6 +169,8 @@ void init_iova_domain(struct iova_domain *iovad, unsigned long granule,
 	unsigned long start_pfn);
 int init_iova_flush_queue(struct iova_domain *iovad,
 			  iova_flush_cb flush_cb, iova_entry_dtor entry_dtor);
+void iova_set_flush_queue_batch(struct iova_domain *iovad, unsigned int batch,
+				unsigned int timeout_ms);
 struct iova *find_iova(struct iova_domain *iovad, unsigned long pfn);
 void put_iova_domain(struct iova_domain *iovad);
 #else
@@ -223,6 +239,12 @@ static inline int init_iova_flush_queue(struct iova_domain *iovad,
 	return -ENODEV;
 }
 
+static inline void iova_set_flush_queue_batch(struct iova_domain *iovad,
+					      unsigned int batch,
+					      unsigned int timeout_ms)
+{
+}
+
 static inline struct iova *find_iova(struct iova_domain *iovad,
 				     unsigned long pfn)
 {
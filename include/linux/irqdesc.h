@@ -129,6 +129,11 @@ struct irq_desc {
 #ifdef CONFIG_SPARSE_IRQ
 	struct rcu_head		rcu;
 	struct kobject		kobj;
+#endif
+#ifdef CONFIG_IRQ_BALANCE
+	unsigned int		balance_cpu;	/* effective CPU at last sample */
+	unsigned int		balance_count;	/* kstat of balance_cpu then */
+	unsigned long		balance_moved;	/* jiffies of the last move */
 #endif
 	struct mutex		request_mutex;
 	int			parent_irq;
@@ -0,0 +1,85 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * kbench: a harness for in-kernel microbenchmarks
+ *
+ * A benchmark case provides one operation.  The harness runs it from a
+ * thread on each of a set of CPUs, times it, and prints its latency
+ * distribution in a fixed key=value format, so that runs on different
+ * kernels can be compared.  How many threads, on which CPUs, how many
+ * iterations and what size are parameters of the kbench module, common
+ * to all suites.
+ */
+#ifndef _LINUX_KBENCH_H
+#define _LINUX_KBENCH_H
+
+#include <linux/init.h>
+#include <linux/module.h>
+
+struct kbench_case;
+
+/**
+ * struct kbench_ctx - what the callbacks of a case work with
+ * @bcase: the case being run
+ * @size: the kbench.size parameter, what it means is up to the case
+ * @threads: number of threads running the case
+ * @thread: index of this thread, in [0, @threads)
+ * @priv: shared by all threads, for &kbench_case.setup to fill in
+ * @thread_priv: private to a thread, for &kbench_case.thread_setup
+ */
+struct kbench_ctx {
+	const struct kbench_case	*bcase;
+	unsigned long			size;
+	unsigned int			threads;
+	unsigned int			thread;
+	void				*priv;
+	void				*thread_priv;
+};
+
+/**
+ * struct kbench_case - one benchmark
+ * @name: name of the case in the output
+ * @setup: optional, called once before the threads start
+ * @teardown: optional, called once after they are all done
+ * @thread_setup: optional, called by each thread before timing starts
+ * @thread_teardown: optional, called by each thread once it is done
+ * @op: the timed operation, @i is the iteration number in this thread
+ *
+ * Each thread gets its own copy of the context, with @priv as left by
+ * @setup.  A case whose setup callbacks fail is reported as skipped.
+ */
+struct kbench_case {
+	const char	*name;
+	int		(*setup)(struct kbench_ctx *ctx);
+	void		(*teardown)(struct kbench_ctx *ctx);
+	int		(*thread_setup)(struct kbench_ctx *ctx);
+	void		(*thread_teardown)(struct kbench_ctx *ctx);
+	void		(*op)(struct kbench_ctx *ctx, unsigned long i);
+};
+
+/**
+ * struct kbench_suite - a set of cases run together
+ * @name: name of the suite in the output
+ * @cases: the cases, terminated by an entry without a name
+ */
+struct kbench_suite {
+	const char			*name;
+	const struct kbench_case	*cases;
+};
+
+int kbench_run_suite(const struct kbench_suite *suite);
+
+/*
+ * Run @suite when the module is loaded.  Like the other benchmark
+ * modules, loading then fails so that the run can be repeated without
+ * an rmmod in between.
+ */
+#define kbench_suite_module(suite)					\
+	static int __init suite##_init(void)				\
+	{								\
+		int ret = kbench_run_suite(&(suite));			\
+									\
+		return ret ? ret : -EAGAIN;				\
+	}								\
+	module_init(suite##_init)
+
+#endif /* _LINUX_KBENCH_H */
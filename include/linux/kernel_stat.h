@@ -38,6 +38,7 @@ struct kernel_cpustat {
 struct kernel_stat {
 	unsigned long irqs_sum;
 	unsigned int softirqs[NR_SOFTIRQS];
+	u64 softirq_time[NR_SOFTIRQS];	/* ns spent in each handler */
 };
 
 DECLARE_PER_CPU(struct kernel_stat, kstat);
@@ -64,6 +65,11 @@ static inline unsigned int kstat_softirqs_cpu(unsigned int irq, int cpu)
        return kstat_cpu(cpu).softirqs[irq];
 }
 
+static inline u64 kstat_softirq_time_cpu(unsigned int irq, int cpu)
+{
+	return kstat_cpu(cpu).softirq_time[irq];
+}
+
 /*
  * Number of interrupts per specific IRQ source, since bootup
  */
@@ -292,6 +292,13 @@ struct kvm_mmio_fragment {
 	unsigned len;
 };
 
+/* What ended a halt, as far as generic code can tell */
+enum kvm_halt_wakeup {
+	KVM_HALT_WAKEUP_TIMER,
+	KVM_HALT_WAKEUP_IRQ,	/* IPIs and device interrupts */
+	KVM_HALT_WAKEUP_NR,
+};
+
 struct kvm_vcpu {
 	struct kvm *kvm;
 #ifdef CONFIG_PREEMPT_NOTIFIERS
@@ -317,6 +324,9 @@ struct kvm_vcpu {
 	sigset_t sigset;
 	unsigned int halt_poll_ns;
 	bool valid_wakeup;
+	/* Moving average of the halt duration for each wakeup source */
+	u64 halt_wakeup_avg_ns[KVM_HALT_WAKEUP_NR];
+	u8 halt_last_wakeup;
 
 #ifdef CONFIG_HAS_IOMEM
 	int mmio_needed;
@@ -616,6 +626,9 @@ struct kvm {
 	struct srcu_struct irq_srcu;
 	pid_t userspace_pid;
 	unsigned int max_halt_poll_ns;
+	/* Halt polling time spent by all vCPUs in the current window */
+	u64 halt_poll_window_start;
+	atomic64_t halt_poll_window_ns;
 	u32 dirty_ring_size;
 	bool vm_bugged;
 
@@ -1453,6 +1466,12 @@ struct _kvm_stats_desc {
 	STATS_DESC_LOGHIST_TIME_NSEC(VCPU_GENERIC, halt_poll_fail_hist,	       \
 			HALT_POLL_HIST_COUNT),				       \
 	STATS_DESC_LOGHIST_TIME_NSEC(VCPU_GENERIC, halt_wait_hist,	       \
+			HALT_POLL_HIST_COUNT),				       \
+	STATS_DESC_COUNTER(VCPU_GENERIC, halt_poll_skipped),		       \
+	STATS_DESC_COUNTER(VCPU_GENERIC, halt_poll_throttled),		       \
+	STATS_DESC_LOGHIST_TIME_NSEC(VCPU_GENERIC, halt_wakeup_timer_hist,     \
+			HALT_POLL_HIST_COUNT),				       \
+	STATS_DESC_LOGHIST_TIME_NSEC(VCPU_GENERIC, halt_wakeup_irq_hist,       \
 			HALT_POLL_HIST_COUNT)
 
 extern struct dentry *kvm_debugfs_dir;
@@ -1662,6 +1681,7 @@ extern unsigned int halt_poll_ns;
 extern unsigned int halt_poll_ns_grow;
 extern unsigned int halt_poll_ns_grow_start;
 extern unsigned int halt_poll_ns_shrink;
+extern unsigned int halt_poll_vm_pct;
 
 struct kvm_device {
 	const struct kvm_device_ops *ops;
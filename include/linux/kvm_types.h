@@ -94,6 +94,10 @@ struct kvm_vcpu_stat_generic {
 	u64 halt_poll_success_hist[HALT_POLL_HIST_COUNT];
 	u64 halt_poll_fail_hist[HALT_POLL_HIST_COUNT];
 	u64 halt_wait_hist[HALT_POLL_HIST_COUNT];
+	u64 halt_poll_skipped;
+	u64 halt_poll_throttled;
+	u64 halt_wakeup_timer_hist[HALT_POLL_HIST_COUNT];
+	u64 halt_wakeup_irq_hist[HALT_POLL_HIST_COUNT];
 };
 
 #define KVM_STATS_NAME_SIZE	48
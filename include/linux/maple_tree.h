@@ -0,0 +1,67 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+#ifndef _LINUX_MAPLE_TREE_H
+#define _LINUX_MAPLE_TREE_H
+/*
+ * Maple Tree - an RCU-safe B-tree of non-overlapping ranges
+ *
+ * Each entry covers an inclusive range [first, last] of unsigned long
+ * indices.  Nodes hold up to MAPLE_NODE_SLOTS sorted ranges, so a lookup
+ * touches a handful of cachelines per level instead of one per level as
+ * an rbtree does.
+ *
+ * Readers only need rcu_read_lock().  Writers serialise on ma_lock and
+ * never modify a published node: every update copies the path from the
+ * root down to the leaf it changes, publishes the new root and frees the
+ * replaced nodes after a grace period.  A reader therefore always sees
+ * either the old or the new tree, never a mix of both.
+ */
+
+#include <linux/kernel.h>
+#include <linux/mutex.h>
+#include <linux/rcupdate.h>
+#include <linux/gfp.h>
+
+#define MAPLE_NODE_SLOTS	16
+
+struct maple_node;
+
+struct maple_tree {
+	struct mutex			ma_lock;
+	struct maple_node __rcu		*ma_root;
+};
+
+#define MTREE_INIT(name) {					\
+	.ma_lock = __MUTEX_INITIALIZER(name.ma_lock),		\
+	.ma_root = NULL,					\
+}
+
+#define DEFINE_MTREE(name)					\
+	struct maple_tree name = MTREE_INIT(name)
+
+static inline void mt_init(struct maple_tree *mt)
+{
+	mutex_init(&mt->ma_lock);
+	RCU_INIT_POINTER(mt->ma_root, NULL);
+}
+
+static inline bool mtree_empty(const struct maple_tree *mt)
+{
+	return rcu_access_pointer(mt->ma_root) == NULL;
+}
+
+int mtree_insert_range(struct maple_tree *mt, unsigned long first,
+		       unsigned long last, void *entry, gfp_t gfp);
+void *mtree_erase(struct maple_tree *mt, unsigned long index);
+void *mtree_load(struct maple_tree *mt, unsigned long index);
+void *mt_find(struct maple_tree *mt, unsigned long *index, unsigned long max);
+void mtree_destroy(struct maple_tree *mt);
+
+static inline int mtree_insert(struct maple_tree *mt, unsigned long index,
+			       void *entry, gfp_t gfp)
+{
+	return mtree_insert_range(mt, index, index, entry, gfp);
+}
+
+void maple_tree_init(void);
+
+#endif /* _LINUX_MAPLE_TREE_H */
@@ -87,6 +87,9 @@ struct memcg_vmstats_percpu {
 	/* Cgroup1: threshold notifications & softlimit tree updates */
 	unsigned long		nr_page_events;
 	unsigned long		targets[MEM_CGROUP_NTARGETS];
+
+	/* Updates not yet added to stats_updates of the cgroup tree */
+	unsigned int		stats_updates;
 };
 
 struct memcg_vmstats {
@@ -97,6 +100,9 @@ struct memcg_vmstats {
 	/* Pending child counts during tree propagation */
 	long			state_pending[MEMCG_NR_STAT];
 	unsigned long		events_pending[NR_VM_EVENT_ITEMS];
+
+	/* Updates in the subtree since the last flush */
+	atomic64_t		stats_updates;
 };
 
 struct mem_cgroup_reclaim_iter {
@@ -259,6 +265,16 @@ struct mem_cgroup {
 	/* Range enforcement for interrupt charges */
 	struct work_struct high_work;
 
+	/*
+	 * Background reclaim once usage crosses high_async_ratio percent
+	 * of memory.high, 0 disables it.
+	 */
+	unsigned int high_async_ratio;
+	struct work_struct async_high_work;
+
+	/* pages charged ahead into the per-cpu stock, memory.charge_batch */
+	unsigned int charge_batch;
+
 	unsigned long soft_limit;
 
 	/* vmpressure notifications */
@@ -359,6 +375,8 @@ struct mem_cgroup {
  * TODO: maybe necessary to use big numbers in big irons.
  */
 #define MEMCG_CHARGE_BATCH 32U
+/* upper bound of memory.charge_batch */
+#define MEMCG_CHARGE_BATCH_MAX 1024U
 
 extern struct mem_cgroup *root_mem_cgroup;
 
@@ -1033,7 +1051,8 @@ static inline unsigned long lruvec_page_state_local(struct lruvec *lruvec,
 	return x;
 }
 
-void mem_cgroup_flush_stats(void);
+void mem_cgroup_flush_stats(struct mem_cgroup *memcg);
+void mem_cgroup_flush_stats_ratelimited(struct mem_cgroup *memcg);
 
 void __mod_memcg_lruvec_state(struct lruvec *lruvec, enum node_stat_item idx,
 			      int val);
@@ -1450,7 +1469,11 @@ static inline unsigned long lruvec_page_state_local(struct lruvec *lruvec,
 	return node_page_state(lruvec_pgdat(lruvec), idx);
 }
 
-static inline void mem_cgroup_flush_stats(void)
+static inline void mem_cgroup_flush_stats(struct mem_cgroup *memcg)
+{
+}
+
+static inline void mem_cgroup_flush_stats_ratelimited(struct mem_cgroup *memcg)
 {
 }
 
@@ -100,6 +100,9 @@ static inline void __ClearPageMovable(struct page *page)
 #endif
 
 #ifdef CONFIG_NUMA_BALANCING
+/* migrate_misplaced_page() queued the page for a batched migration */
+#define NUMA_MIGRATE_QUEUED	2
+
 extern int migrate_misplaced_page(struct page *page,
 				  struct vm_area_struct *vma, int node);
 #else
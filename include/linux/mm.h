@@ -494,6 +494,8 @@ extern pgprot_t protection_map[16];
  * @FAULT_FLAG_REMOTE: The fault is not for current task/mm.
  * @FAULT_FLAG_INSTRUCTION: The fault was during an instruction fetch.
  * @FAULT_FLAG_INTERRUPTIBLE: The fault can be interrupted by non-fatal signals.
+ * @FAULT_FLAG_VMA_LOCK: The fault is handled under the per-VMA lock, mmap_lock
+ *                       is not held.
  *
  * About @FAULT_FLAG_ALLOW_RETRY and @FAULT_FLAG_TRIED: we can specify
  * whether we would allow page faults to retry by specifying these two
@@ -525,6 +527,7 @@ enum fault_flag {
 	FAULT_FLAG_REMOTE =		1 << 7,
 	FAULT_FLAG_INSTRUCTION =	1 << 8,
 	FAULT_FLAG_INTERRUPTIBLE =	1 << 9,
+	FAULT_FLAG_VMA_LOCK =		1 << 10,
 };
 
 /*
@@ -564,7 +567,8 @@ static inline bool fault_flag_allow_retry_first(enum fault_flag flags)
 	{ FAULT_FLAG_USER,		"USER" }, \
 	{ FAULT_FLAG_REMOTE,		"REMOTE" }, \
 	{ FAULT_FLAG_INSTRUCTION,	"INSTRUCTION" }, \
-	{ FAULT_FLAG_INTERRUPTIBLE,	"INTERRUPTIBLE" }
+	{ FAULT_FLAG_INTERRUPTIBLE,	"INTERRUPTIBLE" }, \
+	{ FAULT_FLAG_VMA_LOCK,		"VMA_LOCK" }
 
 /*
  * vm_fault is filled by the pagefault handler and passed to the vma's
@@ -712,11 +716,93 @@ struct vm_operations_struct {
  * IAMROOT, 2022.06.04:
  * - 기본초기화.
  */
+#ifdef CONFIG_PER_VMA_LOCK
+static inline void vma_lock_init(struct vm_area_struct *vma)
+{
+	init_rwsem(&vma->vm_lock);
+	vma->vm_lock_seq = -1;
+}
+
+/*
+ * Try to read-lock a VMA without mmap_lock. Fails if the VMA is
+ * write-locked by the current mmap_lock writer or if vm_lock is
+ * contended; the caller then falls back to mmap_lock.
+ */
+static inline bool vma_start_read(struct vm_area_struct *vma)
+{
+	/* A racy check is fine here, it is repeated under vm_lock. */
+	if (READ_ONCE(vma->vm_lock_seq) == READ_ONCE(vma->vm_mm->mm_lock_seq))
+		return false;
+
+	if (unlikely(!down_read_trylock(&vma->vm_lock)))
+		return false;
+
+	/* Pairs with smp_store_release() in vma_end_write_all(). */
+	if (unlikely(vma->vm_lock_seq ==
+		     smp_load_acquire(&vma->vm_mm->mm_lock_seq))) {
+		up_read(&vma->vm_lock);
+		return false;
+	}
+	return true;
+}
+
+static inline void vma_end_read(struct vm_area_struct *vma)
+{
+	/* Keep the VMA alive until up_read() is done with vm_lock. */
+	rcu_read_lock();
+	up_read(&vma->vm_lock);
+	rcu_read_unlock();
+}
+
+/*
+ * Mark a VMA write-locked until mmap_lock is dropped. Waits for the
+ * readers that got in before; new readers fail vma_start_read().
+ */
+static inline void vma_start_write(struct vm_area_struct *vma)
+{
+	int mm_lock_seq;
+
+	mmap_assert_write_locked(vma->vm_mm);
+	mm_lock_seq = READ_ONCE(vma->vm_mm->mm_lock_seq);
+	if (vma->vm_lock_seq == mm_lock_seq)
+		return;
+
+	down_write(&vma->vm_lock);
+	WRITE_ONCE(vma->vm_lock_seq, mm_lock_seq);
+	up_write(&vma->vm_lock);
+}
+
+static inline void vma_mark_detached(struct vm_area_struct *vma, bool detached)
+{
+	vma_start_write(vma);
+	WRITE_ONCE(vma->detached, detached);
+}
+
+struct vm_area_struct *lock_vma_under_rcu(struct mm_struct *mm,
+					  unsigned long address);
+#else /* !CONFIG_PER_VMA_LOCK */
+static inline void vma_lock_init(struct vm_area_struct *vma) {}
+static inline bool vma_start_read(struct vm_area_struct *vma)
+{
+	return false;
+}
+static inline void vma_end_read(struct vm_area_struct *vma) {}
+static inline void vma_start_write(struct vm_area_struct *vma) {}
+static inline void vma_mark_detached(struct vm_area_struct *vma,
+				     bool detached) {}
+static inline struct vm_area_struct *lock_vma_under_rcu(struct mm_struct *mm,
+							unsigned long address)
+{
+	return NULL;
+}
+#endif /* CONFIG_PER_VMA_LOCK */
+
 static inline void vma_init(struct vm_area_struct *vma, struct mm_struct *mm)
 {
 	static const struct vm_operations_struct dummy_vm_ops = {};
 
 	memset(vma, 0, sizeof(*vma));
+	vma_lock_init(vma);
 	vma->vm_mm = mm;
 	vma->vm_ops = &dummy_vm_ops;
 	INIT_LIST_HEAD(&vma->anon_vma_chain);
@@ -2045,6 +2131,8 @@ void zap_page_range(struct vm_area_struct *vma, unsigned long address,
 		    unsigned long size);
 void unmap_vmas(struct mmu_gather *tlb, struct vm_area_struct *start_vma,
 		unsigned long start, unsigned long end);
+extern unsigned int sysctl_exit_mmap_parallel_mb;
+int unmap_anon_vmas_mt(struct mm_struct *mm, bool oom_reap);
 
 struct mmu_notifier_range;
 
@@ -2574,6 +2662,9 @@ static inline bool pgtable_pte_page_ctor(struct page *page)
 {
 	if (!ptlock_init(page))
 		return false;
+#ifdef CONFIG_FORK_SHARE_PTE
+	atomic_set(&page->pt_share_count, 0);
+#endif
 	__SetPageTable(page);
 	inc_lruvec_page_state(page, NR_PAGETABLE);
 	return true;
@@ -2586,6 +2677,37 @@ static inline void pgtable_pte_page_dtor(struct page *page)
 	dec_lruvec_page_state(page, NR_PAGETABLE);
 }
 
+#ifdef CONFIG_FORK_SHARE_PTE
+/*
+ * A PTE table mapped by more than one mm, shared copy-on-write since fork.
+ * Anything that is about to change its entries on behalf of one mm has to
+ * unshare_pte_table() first.
+ */
+static inline bool pte_table_shared(pmd_t *pmd)
+{
+	pmd_t pmdval = READ_ONCE(*pmd);
+
+	if (pmd_none(pmdval) || !pmd_present(pmdval) ||
+	    pmd_trans_huge(pmdval) || pmd_devmap(pmdval) || pmd_bad(pmdval))
+		return false;
+	return atomic_read(&pmd_page(pmdval)->pt_share_count) > 1;
+}
+
+int unshare_pte_table(struct vm_area_struct *vma, pmd_t *pmd,
+		      unsigned long addr, gfp_t gfp);
+#else
+static inline bool pte_table_shared(pmd_t *pmd)
+{
+	return false;
+}
+
+static inline int unshare_pte_table(struct vm_area_struct *vma, pmd_t *pmd,
+				    unsigned long addr, gfp_t gfp)
+{
+	return 0;
+}
+#endif
+
 /*
  * IAMROOT, 2022.06.04:
  * - @pmd page에서 ptl을 spinlock 걸면서 pte를 return한다.
@@ -3443,10 +3565,17 @@ static inline void print_vma_addr(char *prefix, unsigned long rip)
 }
 #endif
 
+#define VMEMMAP_SPLIT_NO_TLB_FLUSH	BIT(0)
+#define VMEMMAP_REMAP_NO_TLB_FLUSH	BIT(1)
+
+int vmemmap_remap_split(unsigned long start, unsigned long end,
+			unsigned long reuse);
 int vmemmap_remap_free(unsigned long start, unsigned long end,
-		       unsigned long reuse);
+		       unsigned long reuse, struct list_head *freed_pages,
+		       unsigned long flags);
 int vmemmap_remap_alloc(unsigned long start, unsigned long end,
 			unsigned long reuse, gfp_t gfp_mask);
+void free_vmemmap_page_list(struct list_head *list);
 
 void *sparse_buffer_alloc(unsigned long size);
 struct page * __populate_section_memmap(unsigned long pfn,
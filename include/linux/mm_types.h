@@ -8,6 +8,7 @@
 #include <linux/list.h>
 #include <linux/spinlock.h>
 #include <linux/rbtree.h>
+#include <linux/maple_tree.h>
 #include <linux/rwsem.h>
 #include <linux/completion.h>
 #include <linux/cpumask.h>
@@ -257,6 +258,8 @@ struct page {
 			union {
 				struct mm_struct *pt_mm; /* x86 pgds only */
 				atomic_t pt_frag_refcount; /* powerpc */
+				/* mms mapping this PTE table, FORK_SHARE_PTE */
+				atomic_t pt_share_count;
 			};
 #if ALLOC_SPLIT_PTLOCKS
 			spinlock_t *ptl;
@@ -538,6 +541,14 @@ struct vm_area_struct {
 #ifdef CONFIG_SWAP
 	atomic_long_t swap_readahead_info;
 #endif
+#ifdef CONFIG_MMU
+	/*
+	 * Adaptive fault-around window: the size last used, in pages, and
+	 * the address right behind it. Updated racily by read faults.
+	 */
+	unsigned long vm_fault_around_next;
+	unsigned int vm_fault_around_pages;
+#endif
 #ifndef CONFIG_MMU
 	struct vm_region *vm_region;	/* NOMMU mapping region */
 #endif
@@ -545,6 +556,19 @@ struct vm_area_struct {
 	struct mempolicy *vm_policy;	/* NUMA policy for the VMA */
 #endif
 	struct vm_userfaultfd_ctx vm_userfaultfd_ctx;
+#ifdef CONFIG_PER_VMA_LOCK
+	/*
+	 * vm_lock_seq == mm->mm_lock_seq means the VMA is write-locked
+	 * until mmap_lock is released; readers lock vm_lock and check for
+	 * that. Freed through vm_rcu so that faults can look VMAs up
+	 * under rcu_read_lock().
+	 */
+	int vm_lock_seq;
+	struct rw_semaphore vm_lock;
+	/* Removed from the mm's VMA tree, only valid for RCU readers. */
+	bool detached;
+	struct rcu_head vm_rcu;
+#endif
 } __randomize_layout;
 
 struct core_thread {
@@ -569,6 +593,13 @@ struct mm_struct {
  * tmp = rb_entry(rb_node, struct vm_area_struct, vm_rb);
  */
 		struct rb_root mm_rb;
+#ifdef CONFIG_PER_VMA_LOCK
+		/*
+		 * The VMAs of mm_rb again, keyed by [vm_start, vm_end - 1],
+		 * for lookups that run under RCU instead of mmap_lock.
+		 */
+		struct maple_tree mm_mt;
+#endif
 /*
  * IAMROOT, 2022.05.28:
  * - vma가 바뀌었다는걸 ++로 해서 표시.
@@ -645,6 +676,14 @@ struct mm_struct {
 		 * cacheline.
 		 */
 		struct rw_semaphore mmap_lock;
+#ifdef CONFIG_PER_VMA_LOCK
+		/*
+		 * Bumped every time mmap_lock is released for write, which
+		 * drops all VMA write locks taken under it at once. See
+		 * vma_start_write() and vma_end_write_all().
+		 */
+		int mm_lock_seq;
+#endif
 
 		struct list_head mmlist; /* List of maybe swapped mm's.	These
 					  * are globally strung together off
@@ -775,12 +814,26 @@ struct mm_struct {
 
 #ifdef CONFIG_IOMMU_SUPPORT
 		u32 pasid;
+#endif
+#ifdef CONFIG_FUTEX
+		/*
+		 * Optional private futex hash, set once through
+		 * PR_FUTEX_HASH while the process is single threaded.
+		 */
+		struct futex_hash_bucket *futex_hash;
+		unsigned int futex_hash_slots;
+#endif
+#ifdef CONFIG_SCHED_MM_CID
+		/* Protects the concurrency ID mask behind the cpu_bitmap. */
+		raw_spinlock_t cid_lock;
 #endif
 	} __randomize_layout;
 
 	/*
 	 * The mm_cpumask needs to be at the end of mm_struct, because it
-	 * is dynamically sized based on nr_cpu_ids.
+	 * is dynamically sized based on nr_cpu_ids. With CONFIG_SCHED_MM_CID
+	 * the mask of concurrency IDs in use follows it, and with
+	 * CONFIG_MEMBARRIER the mask of CPUs running the mm after that.
 	 */
 	unsigned long cpu_bitmap[];
 };
@@ -802,6 +855,66 @@ static inline cpumask_t *mm_cpumask(struct mm_struct *mm)
 	return (struct cpumask *)&mm->cpu_bitmap;
 }
 
+#ifdef CONFIG_SCHED_MM_CID
+/* Accessor for the concurrency IDs in use, right after the cpu_bitmap. */
+static inline cpumask_t *mm_cidmask(struct mm_struct *mm)
+{
+	unsigned long cid_bitmap = (unsigned long)mm;
+
+	cid_bitmap += offsetof(struct mm_struct, cpu_bitmap);
+	cid_bitmap += cpumask_size();
+	return (struct cpumask *)cid_bitmap;
+}
+
+static inline void mm_init_cid(struct mm_struct *mm)
+{
+	raw_spin_lock_init(&mm->cid_lock);
+	cpumask_clear(mm_cidmask(mm));
+}
+
+static inline unsigned int mm_cid_size(void)
+{
+	return cpumask_size();
+}
+#else
+static inline void mm_init_cid(struct mm_struct *mm) { }
+static inline unsigned int mm_cid_size(void)
+{
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_MEMBARRIER
+/*
+ * CPUs which switched to the mm since it registered for private expedited
+ * membarrier, and did not switch to another one since.
+ */
+static inline cpumask_t *mm_membarrier_cpumask(struct mm_struct *mm)
+{
+	unsigned long bitmap = (unsigned long)mm;
+
+	bitmap += offsetof(struct mm_struct, cpu_bitmap);
+	bitmap += cpumask_size() + mm_cid_size();
+	return (struct cpumask *)bitmap;
+}
+
+static inline void mm_init_membarrier_cpumask(struct mm_struct *mm)
+{
+	cpumask_clear(mm_membarrier_cpumask(mm));
+}
+
+static inline unsigned int mm_membarrier_cpumask_size(void)
+{
+	return cpumask_size();
+}
+#else
+static inline void mm_init_membarrier_cpumask(struct mm_struct *mm) { }
+static inline unsigned int mm_membarrier_cpumask_size(void)
+{
+	return 0;
+}
+#endif
+
 struct mmu_gather;
 extern void tlb_gather_mmu(struct mmu_gather *tlb, struct mm_struct *mm);
 extern void tlb_gather_mmu_fullmm(struct mmu_gather *tlb, struct mm_struct *mm);
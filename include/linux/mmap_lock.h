@@ -14,6 +14,15 @@
 DECLARE_TRACEPOINT(mmap_lock_start_locking);
 DECLARE_TRACEPOINT(mmap_lock_acquire_returned);
 DECLARE_TRACEPOINT(mmap_lock_released);
+DECLARE_TRACEPOINT(mmap_lock_vma_fallback);
+
+/* Why a fault under the per-VMA lock had to fall back to mmap_lock. */
+enum vma_lock_fallback {
+	VMA_LOCK_FALLBACK_MISS,		/* no VMA covers the address */
+	VMA_LOCK_FALLBACK_UNSUPPORTED,	/* VMA type not handled locklessly */
+	VMA_LOCK_FALLBACK_LOCKED,	/* VMA write-locked or detached */
+	VMA_LOCK_FALLBACK_RETRY,	/* fault handler asked for mmap_lock */
+};
 
 #ifdef CONFIG_TRACING
 
@@ -21,6 +30,8 @@ void __mmap_lock_do_trace_start_locking(struct mm_struct *mm, bool write);
 void __mmap_lock_do_trace_acquire_returned(struct mm_struct *mm, bool write,
 					   bool success);
 void __mmap_lock_do_trace_released(struct mm_struct *mm, bool write);
+void __mmap_lock_do_trace_vma_fallback(struct mm_struct *mm,
+				       unsigned long address, int reason);
 
 static inline void __mmap_lock_trace_start_locking(struct mm_struct *mm,
 						   bool write)
@@ -42,6 +53,14 @@ static inline void __mmap_lock_trace_released(struct mm_struct *mm, bool write)
 		__mmap_lock_do_trace_released(mm, write);
 }
 
+static inline void __mmap_lock_trace_vma_fallback(struct mm_struct *mm,
+						  unsigned long address,
+						  int reason)
+{
+	if (tracepoint_enabled(mmap_lock_vma_fallback))
+		__mmap_lock_do_trace_vma_fallback(mm, address, reason);
+}
+
 #else /* !CONFIG_TRACING */
 
 static inline void __mmap_lock_trace_start_locking(struct mm_struct *mm,
@@ -58,11 +77,37 @@ static inline void __mmap_lock_trace_released(struct mm_struct *mm, bool write)
 {
 }
 
+static inline void __mmap_lock_trace_vma_fallback(struct mm_struct *mm,
+						  unsigned long address,
+						  int reason)
+{
+}
+
 #endif /* CONFIG_TRACING */
 
+#ifdef CONFIG_PER_VMA_LOCK
+static inline void mm_lock_seq_init(struct mm_struct *mm)
+{
+	mm->mm_lock_seq = 0;
+}
+
+/*
+ * Drop every VMA write lock taken under the current mmap_lock write
+ * section. Pairs with the smp_load_acquire() in vma_start_read().
+ */
+static inline void vma_end_write_all(struct mm_struct *mm)
+{
+	smp_store_release(&mm->mm_lock_seq, mm->mm_lock_seq + 1);
+}
+#else
+static inline void mm_lock_seq_init(struct mm_struct *mm) {}
+static inline void vma_end_write_all(struct mm_struct *mm) {}
+#endif
+
 static inline void mmap_init_lock(struct mm_struct *mm)
 {
 	init_rwsem(&mm->mmap_lock);
+	mm_lock_seq_init(mm);
 }
 
 static inline void mmap_write_lock(struct mm_struct *mm)
@@ -110,12 +155,14 @@ static inline bool mmap_write_trylock(struct mm_struct *mm)
 static inline void mmap_write_unlock(struct mm_struct *mm)
 {
 	__mmap_lock_trace_released(mm, true);
+	vma_end_write_all(mm);
 	up_write(&mm->mmap_lock);
 }
 
 static inline void mmap_write_downgrade(struct mm_struct *mm)
 {
 	__mmap_lock_trace_acquire_returned(mm, false, true);
+	vma_end_write_all(mm);
 	downgrade_write(&mm->mmap_lock);
 }
 
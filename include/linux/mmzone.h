@@ -294,6 +294,10 @@ enum node_stat_item {
 	NR_PAGETABLE,		/* used for pagetables */
 #ifdef CONFIG_SWAP
 	NR_SWAPCACHE,
+#endif
+#ifdef CONFIG_NUMA_BALANCING
+	PGPROMOTE_SUCCESS,	/* promote successfully */
+	PGPROMOTE_CANDIDATE,	/* candidate pages to promote */
 #endif
 	NR_VM_NODE_STAT_ITEMS
 };
@@ -401,7 +405,26 @@ enum lruvec_flags {
 	LRUVEC_CONGESTED,		/* lruvec has many dirty pages
 					 * backed by a congested BDI
 					 */
+	LRUVEC_GEN_WALKING,		/* page table walk aging
+					 * is in progress
+					 */
+};
+
+#ifdef CONFIG_LRU_GEN
+/*
+ * Page table walk aging state of an lruvec. Every completed walk over the
+ * mms charged to the lruvec bumps @seq; active anon pages found young by
+ * that walk carry PG_referenced until shrink_active_list() consumes it.
+ */
+struct lru_gen_struct {
+	/* generation of the last completed walk */
+	unsigned long		seq;
+	/* jiffies at which @seq was started */
+	unsigned long		timestamp;
+	/* number of eligible tasks to skip at the start of the next walk */
+	unsigned long		mm_cursor;
 };
+#endif
 
 struct lruvec {
 	struct list_head		lists[NR_LRU_LISTS];
@@ -420,6 +443,9 @@ struct lruvec {
 	unsigned long			refaults[ANON_AND_FILE];
 	/* Various lruvec state flags (enum lruvec_flags) */
 	unsigned long			flags;
+#ifdef CONFIG_LRU_GEN
+	struct lru_gen_struct		lrugen;
+#endif
 #ifdef CONFIG_MEMCG
 	struct pglist_data *pgdat;
 #endif
@@ -559,16 +585,38 @@ struct per_cpu_pages {
  */
 	int count;		/* number of pages in the list */
 	int high;		/* high watermark, emptying needed */
+	int high_min;		/* high watermark floor, see pcp_high_adaptive */
+	int high_max;		/* high watermark ceiling */
 	int batch;		/* chunk size for buddy add/remove */
 	short free_factor;	/* batch scaling factor during free */
 #ifdef CONFIG_NUMA
 	short expire;		/* When 0, remote pagesets are drained */
 #endif
+	u8 flags;		/* PCPF_* */
 
 	/* Lists of pages, one per migrate type stored on the pcp-lists */
 	struct list_head lists[NR_PCP_LISTS];
 };
 
+/* pcp->flags */
+#define PCPF_REFILLED		0x01	/* refilled from buddy since last drain */
+#define PCPF_ACTIVE		0x02	/* refilled since last high decay */
+
+/*
+ * Order-0 free pages cached between the per-cpu lists and the buddy lists.
+ * Each shard serves a subset of CPUs and has its own lock so that pcp
+ * refills and drains mostly avoid zone->lock. Pages on a shard are not
+ * accounted in NR_FREE_PAGES, exactly like pages on the pcp lists.
+ */
+#define MAX_ZONE_SHARDS		16
+
+struct zone_shard {
+	spinlock_t lock;
+	int count;		/* number of pages on the lists */
+	int high;		/* pages above this go to the buddy lists */
+	struct list_head lists[MIGRATE_PCPTYPES];
+} ____cacheline_aligned_in_smp;
+
 /*
  * IAMROOT, 2022.03.05:
  * - vm_stat에 합산전인 값들이 들어가있다.
@@ -785,6 +833,10 @@ struct zone {
 	int pageset_high;
 	int pageset_batch;
 
+	/* Lock-sharded order-0 free page caches, see zone_shards= */
+	struct zone_shard	*shards;
+	int nr_shards;
+
 #ifndef CONFIG_SPARSEMEM
 	/*
 	 * Flags for a pageblock_nr_pages block. See pageblock-flags.h.
@@ -970,6 +1022,15 @@ struct zone {
  * - compact가 실패된 order의 가장 작은 값을 저장한다.
  */
 	int			compact_order_failed;
+
+	/*
+	 * Free base pages in each pageblock, kept up to date under
+	 * zone->lock by the buddy allocator. Used to find the pageblocks
+	 * that are cheapest to empty for targeted compaction.
+	 */
+	u16			*pageblock_nr_free;
+	unsigned long		pageblock_nr_free_base;
+	unsigned long		nr_pageblock_nr_free;
 #endif
 
 #if defined CONFIG_COMPACTION || defined CONFIG_CMA
@@ -1260,6 +1321,9 @@ typedef struct pglist_data {
 	wait_queue_head_t kcompactd_wait;
 	struct task_struct *kcompactd;
 	bool proactive_compact_trigger;
+	/* keep compact_goal_blocks free blocks of compact_goal_order */
+	unsigned int compact_goal_order;
+	unsigned long compact_goal_blocks;
 #endif
 	/*
 	 * This is a per-node reserve of pages that are not available
@@ -1275,6 +1339,13 @@ typedef struct pglist_data {
 	unsigned long		min_slab_pages;
 #endif /* CONFIG_NUMA */
 
+#ifdef CONFIG_NUMA_BALANCING
+	/* start time in ms of current promote rate limit period */
+	unsigned int nbp_rl_start;
+	/* number of promote candidate pages at start time of current period */
+	unsigned long nbp_rl_nr_cand;
+#endif
+
 	/* Write-intensive fields used by page reclaim */
 	ZONE_PADDING(_pad1_)
 
@@ -1504,6 +1575,8 @@ int lowmem_reserve_ratio_sysctl_handler(struct ctl_table *, int, void *,
 		size_t *, loff_t *);
 int percpu_pagelist_high_fraction_sysctl_handler(struct ctl_table *, int,
 		void *, size_t *, loff_t *);
+int percpu_pagelist_high_adaptive_sysctl_handler(struct ctl_table *, int,
+		void *, size_t *, loff_t *);
 int sysctl_min_unmapped_ratio_sysctl_handler(struct ctl_table *, int,
 		void *, size_t *, loff_t *);
 int sysctl_min_slab_ratio_sysctl_handler(struct ctl_table *, int,
@@ -1511,6 +1584,7 @@ int sysctl_min_slab_ratio_sysctl_handler(struct ctl_table *, int,
 int numa_zonelist_order_handler(struct ctl_table *, int,
 		void *, size_t *, loff_t *);
 extern int percpu_pagelist_high_fraction;
+extern int percpu_pagelist_high_adaptive;
 extern char numa_zonelist_order[];
 #define NUMA_ZONELIST_ORDER_LEN	16
 
@@ -123,6 +123,10 @@ extern void cleanup_module(void);
 #define device_initcall_sync(fn)	module_init(fn)
 #define late_initcall(fn)		module_init(fn)
 #define late_initcall_sync(fn)		module_init(fn)
+#define subsys_initcall_async(fn)	module_init(fn)
+#define fs_initcall_async(fn)		module_init(fn)
+#define device_initcall_async(fn)	module_init(fn)
+#define late_initcall_async(fn)		module_init(fn)
 
 #define console_initcall(fn)		module_init(fn)
 
@@ -361,6 +365,8 @@ struct klp_modinfo {
 };
 #endif
 
+struct mod_symbol;
+
 struct module {
 	enum module_state state;
 
@@ -404,6 +410,9 @@ struct module {
 	const s32 *gpl_crcs;
 	bool using_gplonly_symbols;
 
+	/* Entries of all exported symbols in the global symbol hash. */
+	struct mod_symbol *symhash;
+
 #ifdef CONFIG_MODULE_SIG
 	/* Signature was verified. */
 	bool sig_ok;
@@ -19,6 +19,7 @@
 #include <linux/cpumask.h>
 #include <linux/list.h>
 #include <linux/workqueue.h>
+#include <linux/nodemask.h>
 
 /**
  * struct node_hmem_attrs - heterogeneous memory performance attributes
@@ -181,4 +182,9 @@ static inline void register_hugetlbfs_with_node(node_registration_func_t reg,
 
 #define to_node(device) container_of(device, struct node, dev)
 
+static inline bool node_is_toptier(int node)
+{
+	return node_state(node, N_CPU) && !node_state(node, N_SLOW_MEMORY);
+}
+
 #endif /* _LINUX_NODE_H_ */
@@ -424,6 +424,7 @@ enum node_states {
 	N_MEMORY,		/* The node has memory(regular, high, movable) */
 	N_CPU,		/* The node has one or more cpus */
 	N_GENERIC_INITIATOR,	/* The node has one or more Generic Initiators */
+	N_SLOW_MEMORY,	/* The node's memory is a tier below DRAM */
 	NR_NODE_STATES
 };
 
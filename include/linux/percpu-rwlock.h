@@ -0,0 +1,175 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _LINUX_PERCPU_RWLOCK_H
+#define _LINUX_PERCPU_RWLOCK_H
+
+#include <linux/atomic.h>
+#include <linux/irqflags.h>
+#include <linux/percpu.h>
+#include <linux/preempt.h>
+#include <linux/spinlock.h>
+#include <linux/lockdep.h>
+
+/*
+ * Reader-biased spinning rwlock.
+ *
+ * The spinning counterpart of percpu_rw_semaphore: readers only touch a
+ * per-CPU counter, so read-mostly paths do not bounce a shared cache line
+ * the way rwlock_t readers do, at the cost of a writer having to look at
+ * every CPU's counter. Writers are serialized on @wait_lock and, once one
+ * is waiting, new readers back off until it is done, so a stream of readers
+ * cannot starve writers.
+ *
+ * Readers may nest, also from interrupts. Writers must disable interrupts
+ * (softirqs) if readers can run from hardirq (softirq) context, as with
+ * rwlock_t. NMI readers are not supported.
+ */
+struct percpu_rwlock {
+	unsigned int __percpu	*read_count;
+	atomic_t		writer;
+	raw_spinlock_t		wait_lock;
+#ifdef CONFIG_DEBUG_LOCK_ALLOC
+	struct lockdep_map	dep_map;
+#endif
+};
+
+#ifdef CONFIG_DEBUG_LOCK_ALLOC
+#define __PERCPU_RWLOCK_DEP_MAP_INIT(lockname)	.dep_map = { .name = #lockname },
+#else
+#define __PERCPU_RWLOCK_DEP_MAP_INIT(lockname)
+#endif
+
+#define __DEFINE_PERCPU_RWLOCK(name, is_static)				\
+static DEFINE_PER_CPU(unsigned int, __percpu_rwlock_rc_##name);		\
+is_static struct percpu_rwlock name = {					\
+	.read_count = &__percpu_rwlock_rc_##name,			\
+	.writer = ATOMIC_INIT(0),					\
+	.wait_lock = __RAW_SPIN_LOCK_UNLOCKED(name.wait_lock),		\
+	__PERCPU_RWLOCK_DEP_MAP_INIT(name)				\
+}
+
+#define DEFINE_PERCPU_RWLOCK(name)		\
+	__DEFINE_PERCPU_RWLOCK(name, /* not static */)
+#define DEFINE_STATIC_PERCPU_RWLOCK(name)	\
+	__DEFINE_PERCPU_RWLOCK(name, static)
+
+extern void __percpu_read_lock_slowpath(struct percpu_rwlock *lock,
+					unsigned long flags);
+
+/*
+ * Called with interrupts disabled, so that a nested reader on this CPU can
+ * only ever observe the counter of readers that are inside the critical
+ * section, never that of one that is about to back off.
+ */
+static inline bool __percpu_read_trylock(struct percpu_rwlock *lock)
+{
+	/*
+	 * Nested inside a reader on this CPU: a writer that showed up since
+	 * has to wait for that reader anyway, so waiting for it here could
+	 * only deadlock.
+	 */
+	if (__this_cpu_inc_return(*lock->read_count) > 1)
+		return true;
+
+	smp_mb(); /* A matches D */
+
+	/*
+	 * If the writer's store is not visible yet, it is guaranteed to see
+	 * our increment when it looks at the counters.
+	 */
+	if (likely(!atomic_read(&lock->writer)))
+		return true;
+
+	__this_cpu_dec(*lock->read_count);
+	return false;
+}
+
+static inline void percpu_read_lock(struct percpu_rwlock *lock)
+{
+	unsigned long flags;
+
+	lock_acquire_shared_recursive(&lock->dep_map, 0, 0, NULL, _RET_IP_);
+
+	/*
+	 * Preemption stays disabled for the whole read side, which keeps the
+	 * decrement on the CPU that did the increment.
+	 */
+	preempt_disable();
+	local_irq_save(flags);
+	if (unlikely(!__percpu_read_trylock(lock)))
+		__percpu_read_lock_slowpath(lock, flags);
+	local_irq_restore(flags);
+}
+
+static inline bool percpu_read_trylock(struct percpu_rwlock *lock)
+{
+	unsigned long flags;
+	bool ret;
+
+	preempt_disable();
+	local_irq_save(flags);
+	ret = __percpu_read_trylock(lock);
+	local_irq_restore(flags);
+	if (!ret) {
+		preempt_enable();
+		return false;
+	}
+
+	lock_acquire_shared_recursive(&lock->dep_map, 0, 1, NULL, _RET_IP_);
+	return true;
+}
+
+static inline void percpu_read_unlock(struct percpu_rwlock *lock)
+{
+	lock_release(&lock->dep_map, _RET_IP_);
+
+	/*
+	 * If the writer sees our decrement it also sees the critical
+	 * section.
+	 */
+	smp_mb(); /* B matches C */
+	this_cpu_dec(*lock->read_count);
+	preempt_enable();
+}
+
+extern void percpu_write_lock(struct percpu_rwlock *lock);
+extern void percpu_write_unlock(struct percpu_rwlock *lock);
+
+#define percpu_write_lock_irqsave(lock, flags)		\
+do {							\
+	local_irq_save(flags);				\
+	percpu_write_lock(lock);			\
+} while (0)
+
+#define percpu_write_unlock_irqrestore(lock, flags)	\
+do {							\
+	percpu_write_unlock(lock);			\
+	local_irq_restore(flags);			\
+} while (0)
+
+static inline void percpu_write_lock_bh(struct percpu_rwlock *lock)
+{
+	local_bh_disable();
+	percpu_write_lock(lock);
+}
+
+static inline void percpu_write_unlock_bh(struct percpu_rwlock *lock)
+{
+	percpu_write_unlock(lock);
+	local_bh_enable();
+}
+
+extern int __percpu_rwlock_init(struct percpu_rwlock *lock,
+				const char *name, struct lock_class_key *key);
+
+extern void percpu_rwlock_free(struct percpu_rwlock *lock);
+
+#define percpu_rwlock_init(lock)				\
+({								\
+	static struct lock_class_key rwlock_key;		\
+	__percpu_rwlock_init(lock, #lock, &rwlock_key);		\
+})
+
+#define percpu_rwlock_is_held(lock)	lockdep_is_held(lock)
+#define percpu_rwlock_assert_held(lock)	lockdep_assert_held(lock)
+
+#endif
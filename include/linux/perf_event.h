@@ -1423,6 +1423,9 @@ extern int perf_output_begin_backward(struct perf_output_handle *handle,
 				      unsigned int size);
 
 extern void perf_output_end(struct perf_output_handle *handle);
+extern void perf_output_batch_begin(struct perf_output_handle *handle,
+				    struct perf_event *event);
+extern void perf_output_batch_end(struct perf_output_handle *handle);
 extern unsigned int perf_output_copy(struct perf_output_handle *handle,
 			     const void *buf, unsigned int len);
 extern unsigned int perf_output_skip(struct perf_output_handle *handle,
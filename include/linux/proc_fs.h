@@ -221,4 +221,24 @@ static inline struct pid_namespace *proc_pid_ns(struct super_block *sb)
 
 bool proc_ns_file(const struct file *file);
 
+struct mm_struct;
+
+/* The totals of /proc/<pid>/smaps_rollup, in bytes */
+struct proc_mm_pss {
+	u64 pss;
+	u64 pss_anon;
+	u64 pss_file;
+	u64 pss_shmem;
+	u64 swap_pss;
+};
+
+#if defined(CONFIG_PROC_FS) && defined(CONFIG_MMU)
+int proc_mm_pss(struct mm_struct *mm, struct proc_mm_pss *pss);
+#else
+static inline int proc_mm_pss(struct mm_struct *mm, struct proc_mm_pss *pss)
+{
+	return -EOPNOTSUPP;
+}
+#endif
+
 #endif /* _LINUX_PROC_FS_H */
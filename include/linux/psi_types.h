@@ -135,6 +135,9 @@ struct psi_trigger {
 };
 
 struct psi_group {
+	/* Accounting enabled, see cgroup.pressure */
+	bool enabled;
+
 	/* Protects data used by the aggregator */
 	struct mutex avgs_lock;
 
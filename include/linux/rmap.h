@@ -284,6 +284,13 @@ static inline void page_dup_rmap(struct page *page, bool compound)
 int page_referenced(struct page *, int is_locked,
 			struct mem_cgroup *memcg, unsigned long *vm_flags);
 
+/* Upper bound on the pages handed to page_referenced_batch() */
+#define RMAP_BATCH_MAX	32
+
+void page_referenced_batch(struct page **pages, int nr,
+			   struct mem_cgroup *memcg,
+			   int *referenced, unsigned long *vm_flags);
+
 void try_to_migrate(struct page *page, enum ttu_flags flags);
 void try_to_unmap(struct page *, enum ttu_flags flags);
 
@@ -384,6 +391,15 @@ static inline int page_referenced(struct page *page, int is_locked,
 	return 0;
 }
 
+static inline void page_referenced_batch(struct page **pages, int nr,
+					 struct mem_cgroup *memcg,
+					 int *referenced,
+					 unsigned long *vm_flags)
+{
+	memset(referenced, 0, nr * sizeof(*referenced));
+	memset(vm_flags, 0, nr * sizeof(*vm_flags));
+}
+
 static inline void try_to_unmap(struct page *page, enum ttu_flags flags)
 {
 }
@@ -654,6 +654,10 @@ struct sched_statistics {
 	u64				nr_wakeups_affine_attempts;
 	u64				nr_wakeups_passive;
 	u64				nr_wakeups_idle;
+
+#ifdef CONFIG_SCHED_CORE
+	u64				core_forceidle_sum;
+#endif
 #endif
 };
 
@@ -709,6 +713,10 @@ struct sched_entity {
  *   weight클수록 적게 누적된다.
  */
 	u64				vruntime;
+	u64				deadline;
+	u64				min_deadline;
+	/* Requested slice in ns, 0 for sysctl_sched_min_granularity */
+	u64				slice;
 	u64				prev_sum_exec_runtime;
 
 	u64				nr_migrations;
@@ -1738,6 +1746,13 @@ struct task_struct {
 	unsigned long rseq_event_mask;
 #endif
 
+#ifdef CONFIG_SCHED_MM_CID
+	/* Concurrency ID within the mm while running, -1 otherwise. */
+	int				mm_cid;
+	/* The mm this task released its ID for on exit or exec. */
+	struct mm_struct		*mm_cid_released;
+#endif
+
 	struct tlbflush_unmap_batch	tlb_ubc;
 
 	union {
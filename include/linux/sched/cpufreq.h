@@ -10,6 +10,18 @@
 
 #define SCHED_CPUFREQ_IOWAIT	(1U << 0)
 
+/*
+ * Why schedutil did or did not change the frequency of a policy, reported
+ * by the sugov_next_freq tracepoint.
+ */
+enum sugov_reason {
+	SUGOV_FREQ_UPDATE,
+	SUGOV_FREQ_LIMITS,
+	SUGOV_FREQ_SAME,
+	SUGOV_FREQ_RATE_LIMIT_UP,
+	SUGOV_FREQ_RATE_LIMIT_DOWN,
+};
+
 #ifdef CONFIG_CPU_FREQ
 struct cpufreq_policy;
 
@@ -416,4 +416,22 @@ static inline void membarrier_update_current_mm(struct mm_struct *next_mm)
 }
 #endif
 
+#ifdef CONFIG_SCHED_MM_CID
+void sched_mm_cid_release(struct task_struct *t, struct mm_struct *mm);
+int task_mm_cid(struct task_struct *t);
+#else
+static inline void sched_mm_cid_release(struct task_struct *t,
+					struct mm_struct *mm)
+{
+}
+static inline int task_mm_cid(struct task_struct *t)
+{
+	/*
+	 * Use the cpu number as a sane default ID when the scheduler does
+	 * not track concurrency IDs.
+	 */
+	return raw_smp_processor_id();
+}
+#endif
+
 #endif /* _LINUX_SCHED_MM_H */
@@ -61,6 +61,21 @@ extern unsigned int sysctl_sched_cfs_bandwidth_slice;
 extern unsigned int sysctl_sched_autogroup_enabled;
 #endif
 
+#define NUMA_BALANCING_DISABLED		0x0
+#define NUMA_BALANCING_NORMAL		0x1
+#define NUMA_BALANCING_MEMORY_TIERING	0x2
+
+/* Maximum number of pages migrated per batch of NUMA hinting faults */
+#define NUMA_MIGRATE_BATCH_MAX		128
+
+#ifdef CONFIG_NUMA_BALANCING
+extern int sysctl_numa_balancing_mode;
+extern unsigned int sysctl_numa_balancing_promote_rate_limit;
+extern unsigned int sysctl_numa_balancing_migrate_batch;
+#else
+#define sysctl_numa_balancing_mode	0
+#endif
+
 extern int sysctl_sched_rr_timeslice;
 extern int sched_rr_timeslice;
 
@@ -63,4 +63,12 @@ extern void wake_q_add(struct wake_q_head *head, struct task_struct *task);
 extern void wake_q_add_safe(struct wake_q_head *head, struct task_struct *task);
 extern void wake_up_q(struct wake_q_head *head);
 
+#ifdef CONFIG_SMP
+extern void wake_batch_begin(void);
+extern void wake_batch_end(void);
+#else
+static inline void wake_batch_begin(void) { }
+static inline void wake_batch_end(void) { }
+#endif
+
 #endif /* _LINUX_SCHED_WAKE_Q_H */
@@ -75,6 +75,12 @@ struct shrinker {
 #endif
 	/* objs pending delete, per node */
 	atomic_long_t *nr_deferred;
+#ifdef CONFIG_DEBUG_FS
+	/* lifetime totals, reported in debugfs shrinker/stats */
+	atomic_long_t stat_scanned;
+	atomic_long_t stat_freed;
+	atomic64_t stat_ns;
+#endif
 };
 #define DEFAULT_SEEKS 2 /* A good number if you don't know better. */
 
@@ -41,6 +41,19 @@ enum stat_item {
 	CPU_PARTIAL_DRAIN,	/* Drain cpu partial to node partial */
 	NR_SLUB_STAT_ITEMS };
 
+/*
+ * Slow path counters that are always maintained, unlike the CONFIG_SLUB_STATS
+ * ones above. They are only touched off the fast paths, so they cost a per
+ * cpu increment where a lock or a list walk is taken anyway.
+ */
+enum slub_pstat_item {
+	PSTAT_ALLOC_SLOWPATH,	/* Entries into ___slab_alloc() */
+	PSTAT_FREE_SLOWPATH,	/* Entries into __slab_free() */
+	PSTAT_LIST_LOCK,	/* Acquisitions of a node list_lock */
+	PSTAT_PARTIAL_SCAN,	/* Slabs visited on node partial lists */
+	PSTAT_REMOTE_FREE,	/* Slow path frees to a slab of another node */
+	NR_SLUB_PSTAT_ITEMS };
+
 /*
  * When changing the layout, make sure freelist and tid are still compatible
  * with this_cpu_cmpxchg_double() alignment requirements.
@@ -61,11 +74,23 @@ struct kmem_cache_cpu {
 	struct page *partial;	/* Partially allocated frozen slabs */
 #endif
 	local_lock_t lock;	/* Protects the fields above */
+	unsigned long pstat[NR_SLUB_PSTAT_ITEMS];
 #ifdef CONFIG_SLUB_STATS
 	unsigned stat[NR_SLUB_STAT_ITEMS];
 #endif
 };
 
+/*
+ * Per cpu array of free objects for caches created with SLAB_CPU_MAGAZINE.
+ * It is refilled from and flushed to the slabs in batches, so that most
+ * allocations and frees, including remote frees, do not touch slab pages.
+ */
+struct slub_magazine {
+	local_lock_t lock;	/* Protects the fields below */
+	unsigned int count;	/* Number of objects in the array */
+	void *objects[];
+};
+
 #ifdef CONFIG_SLUB_CPU_PARTIAL
 #define slub_percpu_partial(c)		((c)->partial)
 
@@ -105,6 +130,8 @@ struct kmem_cache_order_objects {
  */
 struct kmem_cache {
 	struct kmem_cache_cpu __percpu *cpu_slab;
+	struct slub_magazine __percpu *cpu_mag;
+	unsigned int mag_size;	/* Capacity of each cpu magazine */
 /*
  * IAMROOT, 2022.06.17:
  * - debug  : SLAB_CONSISTENCY_CHECKS(f), SLAB_RED_ZONE(z), SLAB_POISON(p)
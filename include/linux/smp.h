@@ -47,6 +47,7 @@ do {						\
  * flush_smp_call_function_queue() in detail.
  */
 extern void __smp_call_single_queue(int cpu, struct llist_node *node);
+extern bool __smp_call_single_queue_noipi(int cpu, struct llist_node *node);
 
 /* total number of cpus in this system (may exceed NR_CPUS) */
 extern unsigned int total_cpus;
@@ -59,6 +60,15 @@ void on_each_cpu_cond_mask(smp_cond_func_t cond_func, smp_call_func_t func,
 
 int smp_call_function_single_async(int cpu, struct __call_single_data *csd);
 
+struct call_function_data;
+
+/*
+ * Completion token of smp_call_function_many_async(), see there.
+ */
+struct smp_call_token {
+	struct call_function_data	*cfd;
+};
+
 /*
  * Cpus stopping functions in panic. All have default weak definitions.
  * Architecture-dependent code may override them.
@@ -154,6 +164,11 @@ extern void smp_cpus_done(unsigned int max_cpus);
 void smp_call_function(smp_call_func_t func, void *info, int wait);
 void smp_call_function_many(const struct cpumask *mask,
 			    smp_call_func_t func, void *info, bool wait);
+void smp_call_function_many_async(const struct cpumask *mask,
+				  smp_call_func_t func, void *info,
+				  struct smp_call_token *token);
+bool smp_call_done(struct smp_call_token *token);
+void smp_call_wait(struct smp_call_token *token);
 
 int smp_call_function_any(const struct cpumask *mask,
 			  smp_call_func_t func, void *info, int wait);
@@ -204,6 +219,14 @@ static inline void smp_send_reschedule(int cpu) { }
 #define smp_prepare_boot_cpu()			do {} while (0)
 #define smp_call_function_many(mask, func, info, wait) \
 			(up_smp_call_function(func, info))
+static inline void smp_call_function_many_async(const struct cpumask *mask,
+						smp_call_func_t func, void *info,
+						struct smp_call_token *token)
+{
+	token->cfd = NULL;
+}
+static inline bool smp_call_done(struct smp_call_token *token) { return true; }
+static inline void smp_call_wait(struct smp_call_token *token) { }
 static inline void call_function_init(void) { }
 
 static inline int
@@ -13,8 +13,17 @@
 
 typedef u32 depot_stack_handle_t;
 
+/* Take a reference on the stack, to be dropped with stack_depot_put() */
+#define STACK_DEPOT_FLAG_GET	0x01
+
 depot_stack_handle_t stack_depot_save(unsigned long *entries,
 				      unsigned int nr_entries, gfp_t gfp_flags);
+depot_stack_handle_t stack_depot_save_flags(unsigned long *entries,
+					    unsigned int nr_entries,
+					    gfp_t gfp_flags,
+					    unsigned int depot_flags);
+void stack_depot_get(depot_stack_handle_t handle, unsigned int nr);
+void stack_depot_put(depot_stack_handle_t handle, unsigned int nr);
 
 unsigned int stack_depot_fetch(depot_stack_handle_t handle,
 			       unsigned long **entries);
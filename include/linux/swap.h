@@ -324,6 +324,9 @@ struct swap_info_struct {
 					 */
 	struct work_struct discard_work; /* discard worker */
 	struct swap_cluster_list discard_clusters; /* discard clusters list */
+	atomic_t ra_hits;		/* cluster readahead hits since last window */
+	atomic_t ra_win;		/* last cluster readahead window */
+	unsigned long ra_prev_offset;	/* offset of the last missed swapin */
 	struct plist_node avail_lists[]; /*
 					   * entries in swap_avail_heads, one
 					   * entry per node.
@@ -12,6 +12,7 @@
 struct device;
 struct page;
 struct scatterlist;
+struct io_tlb_area;
 
 enum swiotlb_force {
 	SWIOTLB_NORMAL,		/* Default - depending on HW DMA mask etc. */
@@ -75,14 +76,15 @@ extern enum swiotlb_force swiotlb_force;
  * @nslabs:	The number of IO TLB blocks (in groups of 64) between @start and
  *		@end. For default swiotlb, this is command line adjustable via
  *		setup_io_tlb_npages.
- * @used:	The number of used IO TLB block.
+ * @nareas:	The number of independently locked areas the pool is split
+ *		into, a power of 2.
+ * @area_nslabs: The number of IO TLB blocks in each area.
+ * @areas:	The areas, each with its own lock, search index and count of
+ *		used blocks.
  * @list:	The free list describing the number of free entries available
  *		from each index.
- * @index:	The index to start searching in the next round.
  * @orig_addr:	The original address corresponding to a mapped entry.
  * @alloc_size:	Size of the allocated buffer.
- * @lock:	The lock to protect the above data structures in the map and
- *		unmap calls.
  * @debugfs:	The dentry to debugfs.
  * @late_alloc:	%true if allocated using the page allocator
  * @force_bounce: %true if swiotlb bouncing is forced
@@ -100,9 +102,9 @@ struct io_tlb_mem {
  * - slots의 개수가 저장된다.
  */
 	unsigned long nslabs;
-	unsigned long used;
-	unsigned int index;
-	spinlock_t lock;
+	unsigned int nareas;
+	unsigned int area_nslabs;
+	struct io_tlb_area *areas;
 	struct dentry *debugfs;
 	bool late_alloc;
 	bool force_bounce;
@@ -79,6 +79,9 @@ extern int __read_mostly node_reclaim_distance;
 #define PENALTY_FOR_NODE_WITH_CPUS	(1)
 #endif
 
+/* Larger than any distance: fall back to slow memory only after DRAM */
+#define PENALTY_FOR_SLOW_MEMORY		(256)
+
 #ifdef CONFIG_USE_PERCPU_NUMA_NODE_ID
 DECLARE_PER_CPU(int, numa_node);
 
@@ -210,6 +213,12 @@ static inline int cpu_to_mem(int cpu)
 #ifndef topology_core_cpumask
 #define topology_core_cpumask(cpu)		cpumask_of(cpu)
 #endif
+#ifndef topology_cluster_id
+#define topology_cluster_id(cpu)		((void)(cpu), -1)
+#endif
+#ifndef topology_cluster_cpumask
+#define topology_cluster_cpumask(cpu)		cpumask_of(cpu)
+#endif
 #ifndef topology_die_cpumask
 #define topology_die_cpumask(cpu)		cpumask_of(cpu)
 #endif
@@ -225,6 +234,13 @@ static inline const struct cpumask *cpu_smt_mask(int cpu)
 }
 #endif
 
+#if defined(CONFIG_SCHED_CLUSTER) && !defined(cpu_cluster_mask)
+static inline const struct cpumask *cpu_cluster_mask(int cpu)
+{
+	return topology_cluster_cpumask(cpu);
+}
+#endif
+
 /*
  * IAMROOT, 2023.04.15:
  * - @cpu가 속한 node의 cpumask를 return한다.
@@ -246,6 +246,22 @@ ssize_t iov_iter_get_pages(struct iov_iter *i, struct page **pages,
 ssize_t iov_iter_get_pages_alloc(struct iov_iter *i, struct page ***pages,
 			size_t maxsize, size_t *start);
 int iov_iter_npages(const struct iov_iter *i, int maxpages);
+
+/* Flags for iov_iter_extract_pages() */
+#define ITER_EXTRACT_GET	0x01	/* take page refs, not pins */
+
+ssize_t iov_iter_extract_pages(struct iov_iter *i, struct page **pages,
+			size_t maxsize, unsigned int maxpages,
+			unsigned int extract_flags, size_t *offset0);
+
+/*
+ * Whether iov_iter_extract_pages() without ITER_EXTRACT_GET pins the pages
+ * it returns (user-backed iterators) or takes no reference at all.
+ */
+static inline bool iov_iter_extract_will_pin(const struct iov_iter *i)
+{
+	return iter_is_iovec(i);
+}
 void iov_iter_restore(struct iov_iter *i, struct iov_iter_state *state);
 
 const void *dup_iter(struct iov_iter *new, struct iov_iter *old, gfp_t flags);
@@ -78,6 +78,7 @@ struct uprobe_task {
 
 	struct return_instance		*return_instances;
 	unsigned int			depth;
+	struct return_instance		*ri_pool;	/* free instances */
 };
 
 struct return_instance {
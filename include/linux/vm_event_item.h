@@ -50,6 +50,8 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 		PAGEOUTRUN, PGROTATED,
 		DROP_PAGECACHE, DROP_SLAB,
 		OOM_KILL,
+		RA_STRIDE,
+		ZAP_PARALLEL, ZAP_PARALLEL_PAGES, ZAP_PARALLEL_MSEC,
 #ifdef CONFIG_NUMA_BALANCING
 		NUMA_PTE_UPDATES,
 		NUMA_HUGE_PTE_UPDATES,
@@ -105,6 +107,8 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 		THP_ZERO_PAGE_ALLOC_FAILED,
 		THP_SWPOUT,
 		THP_SWPOUT_FALLBACK,
+		MTHP_ANON_FAULT_ALLOC,
+		MTHP_ANON_FAULT_FALLBACK,
 #endif
 #ifdef CONFIG_MEMORY_BALLOON
 		BALLOON_INFLATE,
@@ -126,6 +130,23 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 #ifdef CONFIG_SWAP
 		SWAP_RA,
 		SWAP_RA_HIT,
+		SWAP_RA_SKIP,
+#endif
+#ifdef CONFIG_LRU_GEN
+		LRU_GEN_WALK,
+		LRU_GEN_YOUNG,
+#endif
+#ifdef CONFIG_MEMCG
+		MEMCG_ASYNC_RECLAIM,
+		MEMCG_ASYNC_RECLAIM_STEAL,
+		MEMCG_STOCK_HIT,
+		MEMCG_STOCK_MISS,
+#endif
+#ifdef CONFIG_PER_VMA_LOCK
+		VMA_LOCK_SUCCESS,
+		VMA_LOCK_ABORT,
+		VMA_LOCK_RETRY,
+		VMA_LOCK_MISS,
 #endif
 #ifdef CONFIG_X86
 		DIRECT_MAP_LEVEL2_SPLIT,
@@ -1505,6 +1505,8 @@ static inline bool xas_retry(struct xa_state *xas, const void *entry)
 
 void *xas_load(struct xa_state *);
 void *xas_store(struct xa_state *, void *entry);
+unsigned int xas_store_batch(struct xa_state *, void **entries,
+			     unsigned int nr);
 void *xas_find(struct xa_state *, unsigned long max);
 void *xas_find_conflict(struct xa_state *);
 
@@ -1515,6 +1517,7 @@ void *xas_find_marked(struct xa_state *, unsigned long max, xa_mark_t);
 void xas_init_marks(const struct xa_state *);
 
 bool xas_nomem(struct xa_state *, gfp_t);
+int xas_prealloc(struct xa_state *, unsigned long nr, gfp_t);
 void xas_pause(struct xa_state *);
 
 void xas_create_range(struct xa_state *);
@@ -458,6 +458,41 @@ size_t ZSTD_decompress_usingDDict(ZSTD_DCtx *dctx, void *dst,
 	size_t dstCapacity, const void *src, size_t srcSize,
 	const ZSTD_DDict *ddict);
 
+/*-**************************************
+ * Per-CPU decompression context pool
+ ***************************************/
+
+/**
+ * zstd_dpool_register() - take a reference on the shared per-CPU pool of
+ *                         decompression contexts
+ *
+ * Return: 0 on success or -ENOMEM.
+ */
+int zstd_dpool_register(void);
+
+/**
+ * zstd_dpool_unregister() - drop a reference taken by zstd_dpool_register()
+ */
+void zstd_dpool_unregister(void);
+
+/**
+ * zstd_dpool_decompress() - decompress src into dst with a pooled context
+ * @dst:         The buffer to decompress src into.
+ * @dstCapacity: The size of the destination buffer.
+ * @src:         The zstd compressed data to decompress.
+ * @srcSize:     The exact size of the data to decompress.
+ * @ddict:       The digested dictionary to use, or NULL for none.
+ *
+ * Must be called between zstd_dpool_register() and zstd_dpool_unregister(),
+ * from process or softirq context.  Bottom halves are disabled until the
+ * call returns.
+ *
+ * Return:       The decompressed size or an error, which can be checked using
+ *               ZSTD_isError().
+ */
+size_t zstd_dpool_decompress(void *dst, size_t dstCapacity, const void *src,
+	size_t srcSize, const ZSTD_DDict *ddict);
+
 
 /*-**************************
  * Streaming
@@ -46,6 +46,9 @@ struct netns_xfrm {
 	unsigned int		state_hmask;
 	unsigned int		state_num;
 	struct work_struct	state_hash_work;
+	/* Per-CPU results of xfrm_state_find(), see xfrm_state.c */
+	struct xfrm_state_cache __percpu *state_cache;
+	atomic_t		state_cache_genid;
 
 	struct list_head	policy_all;
 	struct hlist_head	*policy_byidx;
@@ -3986,6 +3986,19 @@ static inline bool ib_uses_virt_dma(struct ib_device *dev)
 	return IS_ENABLED(CONFIG_INFINIBAND_VIRT_DMA) && !dev->dma_device;
 }
 
+/**
+ * ib_dma_pool_device - device to hand to DMA mapping allocators
+ * @dev: The device the buffers will be used with
+ *
+ * Returns the device the ib_dma_* helpers map for, so that ULPs can let
+ * e.g. a page_pool keep its buffers mapped, or NULL if @dev does not use
+ * DMA mappings at all.
+ */
+static inline struct device *ib_dma_pool_device(struct ib_device *dev)
+{
+	return ib_uses_virt_dma(dev) ? NULL : dev->dma_device;
+}
+
 /**
  * ib_dma_mapping_error - check a DMA addr for error
  * @dev: The device for which the dma_addr was created
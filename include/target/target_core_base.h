@@ -783,6 +783,8 @@ struct se_device_queue {
 	struct list_head	state_list;
 	spinlock_t		lock;
 	struct se_cmd_queue	sq;
+	/* commands completed by the backend, processed on this CPU */
+	struct se_cmd_queue	cq;
 };
 
 struct se_device {
@@ -101,6 +101,42 @@ TRACE_EVENT_FN(mmap_lock_released,
 	trace_mmap_lock_reg, trace_mmap_lock_unreg
 );
 
+TRACE_EVENT_FN(mmap_lock_vma_fallback,
+
+	TP_PROTO(struct mm_struct *mm, const char *memcg_path,
+		unsigned long address, int reason),
+
+	TP_ARGS(mm, memcg_path, address, reason),
+
+	TP_STRUCT__entry(
+		__field(struct mm_struct *, mm)
+		__string(memcg_path, memcg_path)
+		__field(unsigned long, address)
+		__field(int, reason)
+	),
+
+	TP_fast_assign(
+		__entry->mm = mm;
+		__assign_str(memcg_path, memcg_path);
+		__entry->address = address;
+		__entry->reason = reason;
+	),
+
+	TP_printk(
+		"mm=%p memcg_path=%s address=%lx reason=%s\n",
+		__entry->mm,
+		__get_str(memcg_path),
+		__entry->address,
+		__print_symbolic(__entry->reason,
+			{ 0, "miss" },
+			{ 1, "unsupported" },
+			{ 2, "locked" },
+			{ 3, "retry" })
+	),
+
+	trace_mmap_lock_reg, trace_mmap_lock_unreg
+);
+
 #endif /* _TRACE_MMAP_LOCK_H */
 
 /* This part must be outside protection */
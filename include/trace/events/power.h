@@ -8,6 +8,7 @@
 #include <linux/cpufreq.h>
 #include <linux/ktime.h>
 #include <linux/pm_qos.h>
+#include <linux/sched/cpufreq.h>
 #include <linux/tracepoint.h>
 #include <linux/trace_events.h>
 
@@ -173,6 +174,42 @@ TRACE_EVENT(cpu_frequency_limits,
 		  (unsigned long)__entry->cpu_id)
 );
 
+TRACE_EVENT(sugov_next_freq,
+
+	TP_PROTO(unsigned int cpu_id, unsigned int raw_freq,
+		 unsigned int cur_freq, unsigned int next_freq, int reason),
+
+	TP_ARGS(cpu_id, raw_freq, cur_freq, next_freq, reason),
+
+	TP_STRUCT__entry(
+		__field(u32, cpu_id)
+		__field(u32, raw_freq)
+		__field(u32, cur_freq)
+		__field(u32, next_freq)
+		__field(int, reason)
+	),
+
+	TP_fast_assign(
+		__entry->cpu_id = cpu_id;
+		__entry->raw_freq = raw_freq;
+		__entry->cur_freq = cur_freq;
+		__entry->next_freq = next_freq;
+		__entry->reason = reason;
+	),
+
+	TP_printk("cpu_id=%lu raw_freq=%lu cur_freq=%lu next_freq=%lu reason=%s",
+		  (unsigned long)__entry->cpu_id,
+		  (unsigned long)__entry->raw_freq,
+		  (unsigned long)__entry->cur_freq,
+		  (unsigned long)__entry->next_freq,
+		  __print_symbolic(__entry->reason,
+			{ SUGOV_FREQ_UPDATE,		"update" },
+			{ SUGOV_FREQ_LIMITS,		"limits" },
+			{ SUGOV_FREQ_SAME,		"same" },
+			{ SUGOV_FREQ_RATE_LIMIT_UP,	"rate_limit_up" },
+			{ SUGOV_FREQ_RATE_LIMIT_DOWN,	"rate_limit_down" }))
+);
+
 TRACE_EVENT(device_pm_callback_start,
 
 	TP_PROTO(struct device *dev, const char *pm_ops, int event),
@@ -229,10 +229,11 @@ TRACE_EVENT(mm_shrink_slab_start,
 
 TRACE_EVENT(mm_shrink_slab_end,
 	TP_PROTO(struct shrinker *shr, int nid, int shrinker_retval,
-		long unused_scan_cnt, long new_scan_cnt, long total_scan),
+		long unused_scan_cnt, long new_scan_cnt, long total_scan,
+		long scanned, u64 duration_ns),
 
 	TP_ARGS(shr, nid, shrinker_retval, unused_scan_cnt, new_scan_cnt,
-		total_scan),
+		total_scan, scanned, duration_ns),
 
 	TP_STRUCT__entry(
 		__field(struct shrinker *, shr)
@@ -242,6 +243,8 @@ TRACE_EVENT(mm_shrink_slab_end,
 		__field(long, new_scan)
 		__field(int, retval)
 		__field(long, total_scan)
+		__field(long, scanned)
+		__field(u64, duration_ns)
 	),
 
 	TP_fast_assign(
@@ -252,16 +255,20 @@ TRACE_EVENT(mm_shrink_slab_end,
 		__entry->new_scan = new_scan_cnt;
 		__entry->retval = shrinker_retval;
 		__entry->total_scan = total_scan;
+		__entry->scanned = scanned;
+		__entry->duration_ns = duration_ns;
 	),
 
-	TP_printk("%pS %p: nid: %d unused scan count %ld new scan count %ld total_scan %ld last shrinker return val %d",
+	TP_printk("%pS %p: nid: %d unused scan count %ld new scan count %ld total_scan %ld last shrinker return val %d scanned %ld duration_ns %llu",
 		__entry->shrink,
 		__entry->shr,
 		__entry->nid,
 		__entry->unused_scan,
 		__entry->new_scan,
 		__entry->total_scan,
-		__entry->retval)
+		__entry->retval,
+		__entry->scanned,
+		__entry->duration_ns)
 );
 
 TRACE_EVENT(mm_vmscan_lru_isolate,
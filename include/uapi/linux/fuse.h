@@ -184,6 +184,13 @@
  *
  *  7.34
  *  - add FUSE_SYNCFS
+ *
+ *  7.35
+ *  - add FUSE_PASSTHROUGH, passthrough_fh to fuse_open_out and
+ *    FUSE_DEV_IOC_PASSTHROUGH_OPEN
+ *  - add FUSE_DEV_IOC_BIND_CPU
+ *  - add FUSE_DEV_IOC_RING_SETUP, FUSE_DEV_IOC_RING_ENTER and the shared
+ *    memory request ring
  */
 
 #ifndef _LINUX_FUSE_H
@@ -219,7 +226,7 @@
 #define FUSE_KERNEL_VERSION 7
 
 /** Minor version number of this interface */
-#define FUSE_KERNEL_MINOR_VERSION 34
+#define FUSE_KERNEL_MINOR_VERSION 35
 
 /** The node ID of the root inode */
 #define FUSE_ROOT_ID 1
@@ -336,6 +343,9 @@ struct fuse_file_lock {
  *			write/truncate sgid is killed only if file has group
  *			execute permission. (Same as Linux VFS behavior).
  * FUSE_SETXATTR_EXT:	Server supports extended struct fuse_setxattr_in
+ * FUSE_PASSTHROUGH: reads, writes and mmaps of a file opened with a non-zero
+ *		     passthrough_fh go directly to the backing file registered
+ *		     with FUSE_DEV_IOC_PASSTHROUGH_OPEN
  */
 #define FUSE_ASYNC_READ		(1 << 0)
 #define FUSE_POSIX_LOCKS	(1 << 1)
@@ -367,6 +377,7 @@ struct fuse_file_lock {
 #define FUSE_SUBMOUNTS		(1 << 27)
 #define FUSE_HANDLE_KILLPRIV_V2	(1 << 28)
 #define FUSE_SETXATTR_EXT	(1 << 29)
+#define FUSE_PASSTHROUGH	(1U << 31)
 
 /**
  * CUSE INIT request/reply flags
@@ -639,7 +650,7 @@ struct fuse_create_in {
 struct fuse_open_out {
 	uint64_t	fh;
 	uint32_t	open_flags;
-	uint32_t	padding;
+	uint32_t	passthrough_fh;
 };
 
 struct fuse_release_in {
@@ -923,6 +934,64 @@ struct fuse_notify_retrieve_in {
 /* Device ioctls: */
 #define FUSE_DEV_IOC_MAGIC		229
 #define FUSE_DEV_IOC_CLONE		_IOR(FUSE_DEV_IOC_MAGIC, 0, uint32_t)
+#define FUSE_DEV_IOC_PASSTHROUGH_OPEN	_IOW(FUSE_DEV_IOC_MAGIC, 1, \
+					     struct fuse_passthrough_out)
+/*
+ * Bind a (usually cloned) device fd to a CPU: requests submitted on that CPU
+ * are queued for readers of this fd only, bypassing the shared input queue.
+ * Interrupts, forgets and requests from CPUs without a bound fd still go to
+ * the shared queue, so the server must keep at least one unbound reader.
+ */
+#define FUSE_DEV_IOC_BIND_CPU		_IOW(FUSE_DEV_IOC_MAGIC, 2, uint32_t)
+#define FUSE_DEV_IOC_RING_SETUP		_IOW(FUSE_DEV_IOC_MAGIC, 3, \
+					     struct fuse_ring_setup)
+#define FUSE_DEV_IOC_RING_ENTER		_IOW(FUSE_DEV_IOC_MAGIC, 4, uint32_t)
+
+/*
+ * Shared memory request ring
+ *
+ * Instead of read() and write() on the device, a server may set up a ring
+ * of @nr_entries buffers of @entry_size bytes each with
+ * FUSE_DEV_IOC_RING_SETUP and mmap() it from offset 0 of the same fd.  The
+ * mapping starts with an array of struct fuse_ring_desc, one per entry,
+ * followed at the next page boundary by the entries themselves.
+ *
+ * The kernel copies requests into FUSE_RING_FREE entries as they are queued
+ * and marks them FUSE_RING_REQ; the server finds them by polling the
+ * descriptors.  To reply it overwrites the entry with the reply (exactly
+ * what it would have written to the device), stores its length in @len and
+ * sets the state to FUSE_RING_REPLY, with @len = 0 for requests that take no
+ * reply.  FUSE_DEV_IOC_RING_ENTER then hands all replied entries back to the
+ * kernel in one call and, with FUSE_RING_ENTER_WAIT, sleeps until a request
+ * is available.  @state must be accessed with acquire/release semantics.
+ */
+struct fuse_ring_setup {
+	uint32_t	nr_entries;
+	uint32_t	entry_size;
+	uint32_t	flags;
+	uint32_t	padding;
+};
+
+#define FUSE_RING_FREE		0
+#define FUSE_RING_REQ		1
+#define FUSE_RING_REPLY		2
+
+struct fuse_ring_desc {
+	uint32_t	state;
+	uint32_t	len;
+};
+
+/* FUSE_DEV_IOC_RING_ENTER flags */
+#define FUSE_RING_ENTER_WAIT	(1 << 0)
+
+/*
+ * Registers @fd as a backing file.  The ioctl returns an identifier that
+ * the daemon passes back in fuse_open_out.passthrough_fh.
+ */
+struct fuse_passthrough_out {
+	uint32_t	fd;
+	uint32_t	flags;	/* must be zero */
+};
 
 struct fuse_lseek_in {
 	uint64_t	fh;
@@ -138,6 +138,10 @@
  *                          Alias to MEMBARRIER_CMD_GLOBAL. Provided for
  *                          header backward compatibility.
  *
+ * The three private expedited commands can also be passed to the
+ * membarrier_cpus system call, which only targets the threads running on
+ * a set of CPUs given as a cpu_set_t, like sched_setaffinity() takes it.
+ *
  * Command to be passed to the membarrier system call. The commands need to
  * be a single bit each, except for MEMBARRIER_CMD_QUERY which is assigned to
  * the value 0.
@@ -135,6 +135,9 @@ struct ovs_vport_stats {
 /* Allow per-cpu dispatch of upcalls */
 #define OVS_DP_F_DISPATCH_UPCALL_PER_CPU	(1 << 3)
 
+/* Allow several OVS_PACKET_CMD_MISS messages in one Netlink datagram */
+#define OVS_DP_F_UPCALL_BATCH	(1 << 4)
+
 /* Fixed logical ports. */
 #define OVSP_LOCAL      ((__u32)0)
 
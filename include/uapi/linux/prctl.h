@@ -269,4 +269,13 @@ struct prctl_mm_map {
 # define PR_SCHED_CORE_SHARE_FROM	3 /* pull core_sched cookie to pid */
 # define PR_SCHED_CORE_MAX		4
 
+/* Set up a process private futex hash */
+#define PR_FUTEX_HASH			78
+# define PR_FUTEX_HASH_SET_SLOTS	1
+# define PR_FUTEX_HASH_GET_SLOTS	2
+
+/* Share anonymous page tables copy-on-write on fork */
+#define PR_SET_FORK_SHARE_PTE		79
+#define PR_GET_FORK_SHARE_PTE		80
+
 #endif /* _LINUX_PRCTL_H */
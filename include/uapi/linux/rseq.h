@@ -142,6 +142,32 @@ struct rseq {
 	 *     this thread.
 	 */
 	__u32 flags;
+
+	/*
+	 * Restartable sequences node_id field. Updated by the kernel. Read by
+	 * user-space with single-copy atomicity semantics. This field should
+	 * only be read by the thread which registered this data structure.
+	 * Aligned on 32-bit. Contains the current NUMA node ID.
+	 */
+	__u32 node_id;
+
+	/*
+	 * Restartable sequences mm_cid field. Updated by the kernel. Read by
+	 * user-space with single-copy atomicity semantics. This field should
+	 * only be read by the thread which registered this data structure.
+	 * Aligned on 32-bit. Contains the current thread's concurrency ID
+	 * (allocated uniquely within a memory map), which stays below the
+	 * number of threads of the process running at the same time and
+	 * the number of CPUs they are allowed to run on, so it can index
+	 * per-CPU data sized for the process rather than for nr_cpu_ids.
+	 * Like cpu_id, it should be compared within a rseq critical section.
+	 *
+	 * Both node_id and mm_cid lie within the original 32-byte struct
+	 * rseq. Kernels which do not know about them leave them untouched,
+	 * user-space can detect support by initializing mm_cid to ~0 before
+	 * registration: a supporting kernel sets it on return to user-space.
+	 */
+	__u32 mm_cid;
 } __attribute__((aligned(4 * sizeof(__u64))));
 
 #endif /* _UAPI_LINUX_RSEQ_H */
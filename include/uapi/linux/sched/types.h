@@ -36,6 +36,7 @@ struct sched_param {
  *  @sched_policy	task's scheduling policy
  *  @sched_nice		task's nice value      (SCHED_NORMAL/BATCH)
  *  @sched_priority	task's static priority (SCHED_FIFO/RR)
+ *  @sched_runtime	task's slice in ns, 0 for the default (SCHED_NORMAL/BATCH)
  *
  * Certain more advanced scheduling features can be controlled by a
  * predefined set of flags via the attribute:
@@ -111,7 +112,7 @@ struct sched_attr {
 	/* SCHED_FIFO, SCHED_RR */
 	__u32 sched_priority;
 
-	/* SCHED_DEADLINE */
+	/* SCHED_DEADLINE, slice for SCHED_NORMAL/BATCH */
 	__u64 sched_runtime;
 	__u64 sched_deadline;
 	__u64 sched_period;
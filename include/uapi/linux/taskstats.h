@@ -198,6 +198,7 @@ enum {
 	TASKSTATS_TYPE_AGGR_PID,	/* contains pid + stats */
 	TASKSTATS_TYPE_AGGR_TGID,	/* contains tgid + stats */
 	TASKSTATS_TYPE_NULL,		/* contains nothing */
+	TASKSTATS_TYPE_QUERY,		/* taskstats_query structure */
 	__TASKSTATS_TYPE_MAX,
 };
 
@@ -214,6 +215,94 @@ enum {
 
 #define TASKSTATS_CMD_ATTR_MAX (__TASKSTATS_CMD_ATTR_MAX - 1)
 
+/*
+ * Batched query of the statistics of many tasks in one call.
+ *
+ * The request carries an array of __u32 pids in TASKSTATS_QUERY_ATTR_PIDS
+ * and the groups of fields wanted in TASKSTATS_QUERY_ATTR_MASK.  It must be
+ * sent as a dump request; the reply has one message per task with a
+ * TASKSTATS_TYPE_QUERY attribute holding a struct taskstats_query.  Pids
+ * that don't exist are skipped.
+ *
+ * The command is numbered after the cgroupstats commands, which share the
+ * family and are numbered from __TASKSTATS_CMD_MAX.
+ */
+#define TASKSTATS_CMD_QUERY	(__TASKSTATS_CMD_MAX + 3)
+
+enum {
+	TASKSTATS_QUERY_ATTR_UNSPEC = 0,
+	TASKSTATS_QUERY_ATTR_PIDS,	/* __u32 array of pids */
+	TASKSTATS_QUERY_ATTR_MASK,	/* __u32 TASKSTATS_QUERY_* mask */
+	__TASKSTATS_QUERY_ATTR_MAX,
+};
+
+#define TASKSTATS_QUERY_ATTR_MAX (__TASKSTATS_QUERY_ATTR_MAX - 1)
+
+#define TASKSTATS_QUERY_STAT	(1 << 0)	/* as /proc/<pid>/stat */
+#define TASKSTATS_QUERY_STATUS	(1 << 1)	/* ids, context switches */
+#define TASKSTATS_QUERY_IO	(1 << 2)	/* as /proc/<pid>/io */
+#define TASKSTATS_QUERY_MEM	(1 << 3)	/* RSS from the mm counters */
+#define TASKSTATS_QUERY_PSS	(1 << 4)	/* walks the page tables */
+
+struct taskstats_query {
+	__u32	pid;
+	__u32	mask;			/* groups filled in */
+
+	/* TASKSTATS_QUERY_STAT, the whole thread group */
+	__u32	ppid;
+	__u32	pgid;
+	__u32	sid;
+	__u32	tty_nr;
+	__u32	flags;			/* PF_* */
+	__u32	num_threads;
+	__s32	priority;
+	__s32	nice;
+	__u32	rt_priority;
+	__u32	policy;
+	__s32	processor;
+	__u8	state;			/* as in /proc/<pid>/stat */
+	__u8	__pad[3];
+	__u64	start_time;		/* nsec since boot */
+	__u64	utime;			/* nsec */
+	__u64	stime;			/* nsec */
+	__u64	min_flt;
+	__u64	maj_flt;
+	__u64	vsize;			/* bytes */
+	__u64	rss;			/* pages */
+
+	/* TASKSTATS_QUERY_STATUS */
+	__u32	uid;
+	__u32	euid;
+	__u32	gid;
+	__u32	egid;
+	__u64	nvcsw;
+	__u64	nivcsw;
+
+	/* TASKSTATS_QUERY_IO, the whole thread group */
+	__u64	rchar;
+	__u64	wchar;
+	__u64	syscr;
+	__u64	syscw;
+	__u64	read_bytes;
+	__u64	write_bytes;
+	__u64	cancelled_write_bytes;
+
+	/* TASKSTATS_QUERY_MEM, bytes */
+	__u64	rss_anon;
+	__u64	rss_file;
+	__u64	rss_shmem;
+	__u64	swap;
+	__u64	hiwater_rss;
+	__u64	pgtables;
+
+	/* TASKSTATS_QUERY_PSS, bytes */
+	__u64	pss;
+	__u64	pss_anon;
+	__u64	pss_file;
+	__u64	pss_shmem;
+	__u64	swap_pss;
+};
+
 /* NETLINK_GENERIC related info */
 
 #define TASKSTATS_GENL_NAME	"TASKSTATS"
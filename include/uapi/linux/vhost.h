@@ -70,6 +70,11 @@
 #define VHOST_VRING_BIG_ENDIAN 1
 #define VHOST_SET_VRING_ENDIAN _IOW(VHOST_VIRTIO, 0x13, struct vhost_vring_state)
 #define VHOST_GET_VRING_ENDIAN _IOW(VHOST_VIRTIO, 0x14, struct vhost_vring_state)
+/* Run the vring's work on worker thread num instead of the default one,
+ * creating it if needed.  Worker 0 is the default; there can be as many as
+ * there are vrings.  Workers are named vhost-<owner pid>-<num> so they can
+ * be found and pinned.  Returns -EBUSY while the vring has a backend. */
+#define VHOST_SET_VRING_WORKER _IOW(VHOST_VIRTIO, 0x15, struct vhost_vring_state)
 
 /* The following ioctls use eventfd file descriptors to signal and poll
  * for events. */
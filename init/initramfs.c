@@ -16,6 +16,9 @@
 #include <linux/namei.h>
 #include <linux/init_syscalls.h>
 #include <linux/umh.h>
+#include <linux/workqueue.h>
+#include <linux/wait_bit.h>
+#include <linux/sizes.h>
 
 static ssize_t __init xwrite(struct file *file, const char *p, size_t count,
 		loff_t *pos)
@@ -457,6 +460,59 @@ static long __init flush_buffer(void *bufv, unsigned long len)
 	return origLen;
 }
 
+/*
+ * Decompressing the archive and writing out its files each keep a CPU
+ * busy.  Do them in parallel: the decompressed data is copied into chunks
+ * that an ordered workqueue feeds to the cpio parser, while the
+ * decompressor goes on with the next one.  At most UNPACK_MAX_QUEUED bytes
+ * are waiting to be written at any time.
+ */
+#define UNPACK_MAX_QUEUED	SZ_32M
+
+struct unpack_chunk {
+	struct work_struct work;
+	unsigned long len;
+	char buf[];
+};
+
+static __initdata struct workqueue_struct *unpack_wq;
+static __initdata atomic_long_t unpack_queued;
+
+static void __init unpack_chunk_workfn(struct work_struct *work)
+{
+	struct unpack_chunk *chunk =
+		container_of(work, struct unpack_chunk, work);
+
+	flush_buffer(chunk->buf, chunk->len);
+	atomic_long_sub(chunk->len, &unpack_queued);
+	wake_up_var(&unpack_queued);
+	kvfree(chunk);
+}
+
+static long __init queue_flush_buffer(void *bufv, unsigned long len)
+{
+	struct unpack_chunk *chunk;
+
+	if (message)
+		return -1;
+
+	chunk = kvmalloc(struct_size(chunk, buf, len), GFP_KERNEL);
+	if (!chunk) {
+		/* Write it out ourselves, after everything queued before */
+		flush_workqueue(unpack_wq);
+		return flush_buffer(bufv, len);
+	}
+	memcpy(chunk->buf, bufv, len);
+	chunk->len = len;
+	INIT_WORK(&chunk->work, unpack_chunk_workfn);
+
+	wait_var_event(&unpack_queued,
+		       atomic_long_read(&unpack_queued) < UNPACK_MAX_QUEUED);
+	atomic_long_add(len, &unpack_queued);
+	queue_work(unpack_wq, &chunk->work);
+	return len;
+}
+
 static unsigned long my_inptr; /* index of next byte to be processed in inbuf */
 
 #include <linux/decompress/generic.h>
@@ -475,6 +531,9 @@ static char * __init unpack_to_rootfs(char *buf, unsigned long len)
 	if (!header_buf || !symlink_buf || !name_buf)
 		panic_show_mem("can't allocate buffers");
 
+	/* Without it, everything is just written out by the decompressor */
+	unpack_wq = alloc_ordered_workqueue("initramfs", 0);
+
 	state = Start;
 	this_header = 0;
 	message = NULL;
@@ -497,8 +556,13 @@ static char * __init unpack_to_rootfs(char *buf, unsigned long len)
 		decompress = decompress_method(buf, len, &compress_name);
 		pr_debug("Detected %s compressed data\n", compress_name);
 		if (decompress) {
-			int res = decompress(buf, len, NULL, flush_buffer, NULL,
-				   &my_inptr, error);
+			int res = decompress(buf, len, NULL,
+				unpack_wq ? queue_flush_buffer : flush_buffer,
+				NULL, &my_inptr, error);
+
+			/* The parser state is looked at below */
+			if (unpack_wq)
+				flush_workqueue(unpack_wq);
 			if (res)
 				error("decompressor failed");
 		} else if (compress_name) {
@@ -516,6 +580,8 @@ static char * __init unpack_to_rootfs(char *buf, unsigned long len)
 		buf += my_inptr;
 		len -= my_inptr;
 	}
+	if (unpack_wq)
+		destroy_workqueue(unpack_wq);
 	dir_utime();
 	kfree(name_buf);
 	kfree(symlink_buf);
@@ -100,6 +100,8 @@
 #include <linux/kcsan.h>
 #include <linux/init_syscalls.h>
 #include <linux/stackdepot.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <asm/io.h>
 #include <asm/bugs.h>
@@ -116,6 +118,7 @@ static int kernel_init(void *);
 
 extern void init_IRQ(void);
 extern void radix_tree_init(void);
+extern void maple_tree_init(void);
 
 /*
  * Debug helper: via this flag we know that we are in 'early bootup code'
@@ -1355,6 +1358,7 @@ asmlinkage __visible void __init __no_sanitize_address start_kernel(void)
 		 "Interrupts were enabled *very* early, fixing it\n"))
 		local_irq_disable();
 	radix_tree_init();
+	maple_tree_init();
 
 	/*
 	 * Set up housekeeping before setting up workqueues to allow the unbound
@@ -1696,7 +1700,7 @@ static initcall_entry_t *initcall_levels[] __initdata = {
 };
 
 /* Keep these in sync with initcalls in include/linux/init.h */
-static const char *initcall_level_names[] __initdata = {
+static const char *initcall_level_names[] = {
 	"pure",
 	"core",
 	"postcore",
@@ -1713,6 +1717,108 @@ static int __init ignore_unknown_bootoption(char *param, char *val,
 	return 0;
 }
 
+/*
+ * With initcall_timeline on the command line, the start time, duration and
+ * return value of each initcall are kept and shown in debugfs, together
+ * with how long the ones run in the background waited for a CPU.
+ */
+struct initcall_record {
+	initcall_t	fn;
+	s64		start_us;
+	s64		duration_us;
+	s64		wait_us;
+	int		ret;
+	u8		level;
+	bool		async;
+};
+
+static bool initcall_timeline;
+core_param(initcall_timeline, initcall_timeline, bool, 0);
+
+static struct initcall_record *initcall_records;
+static unsigned int initcall_records_max;
+static atomic_t initcall_nr_records = ATOMIC_INIT(0);
+static int initcall_cur_level __initdata;
+
+static void __init initcall_timeline_init(void)
+{
+	/* Room for a background run of each initcall on top of its own */
+	unsigned int nr = 2 * (__initcall_end - __initcall0_start);
+
+	if (!initcall_timeline)
+		return;
+
+	initcall_records = kvcalloc(nr, sizeof(*initcall_records),
+				    GFP_KERNEL);
+	if (initcall_records)
+		initcall_records_max = nr;
+}
+
+static int __init do_timed_initcall(initcall_t fn, int level,
+				    ktime_t queued, bool async)
+{
+	struct initcall_record *rec;
+	ktime_t start;
+	unsigned int i;
+	int ret;
+
+	if (!initcall_records)
+		return do_one_initcall(fn);
+
+	start = ktime_get();
+	ret = do_one_initcall(fn);
+
+	i = atomic_inc_return(&initcall_nr_records) - 1;
+	if (i >= initcall_records_max)
+		return ret;
+
+	rec = &initcall_records[i];
+	rec->fn = fn;
+	rec->start_us = ktime_to_us(start);
+	rec->duration_us = ktime_us_delta(ktime_get(), start);
+	rec->wait_us = ktime_us_delta(start, queued);
+	rec->ret = ret;
+	rec->level = level;
+	rec->async = async;
+	return ret;
+}
+
+static ASYNC_DOMAIN_EXCLUSIVE(initcall_domain);
+
+struct async_initcall {
+	initcall_t	fn;
+	int		level;
+	ktime_t		queued;
+};
+
+static void __init do_async_initcall(void *data, async_cookie_t cookie)
+{
+	struct async_initcall *ai = data;
+
+	do_timed_initcall(ai->fn, ai->level, ai->queued, true);
+	kfree(ai);
+}
+
+/*
+ * Run @fn in the background; do_initcall_level() waits for it before the
+ * next level starts.  Used by the *_initcall_async() variants.
+ */
+void __init async_schedule_initcall(initcall_t fn)
+{
+	struct async_initcall *ai;
+
+	ai = kmalloc(sizeof(*ai), GFP_KERNEL);
+	if (!ai) {
+		do_one_initcall(fn);
+		return;
+	}
+
+	ai->fn = fn;
+	ai->level = initcall_cur_level;
+	ai->queued = ktime_get();
+	async_schedule_domain(do_async_initcall, ai, &initcall_domain);
+}
+
 static void __init do_initcall_level(int level, char *command_line)
 {
 	initcall_entry_t *fn;
@@ -1724,8 +1830,12 @@ static void __init do_initcall_level(int level, char *command_line)
 		   NULL, ignore_unknown_bootoption);
 
 	trace_initcall_level(initcall_level_names[level]);
+	initcall_cur_level = level;
 	for (fn = initcall_levels[level]; fn < initcall_levels[level+1]; fn++)
-		do_one_initcall(initcall_from_entry(fn));
+		do_timed_initcall(initcall_from_entry(fn), level, ktime_get(),
+				  false);
+
+	async_synchronize_full_domain(&initcall_domain);
 }
 
 static void __init do_initcalls(void)
@@ -1738,6 +1848,8 @@ static void __init do_initcalls(void)
 	if (!command_line)
 		panic("%s: Failed to allocate %zu bytes\n", __func__, len);
 
+	initcall_timeline_init();
+
 	for (level = 0; level < ARRAY_SIZE(initcall_levels) - 1; level++) {
 		/* Parser modifies command_line, restore it each time */
 		strcpy(command_line, saved_command_line);
@@ -1747,6 +1859,35 @@ static void __init do_initcalls(void)
 	kfree(command_line);
 }
 
+static int initcall_timeline_show(struct seq_file *m, void *v)
+{
+	unsigned int i, nr = atomic_read(&initcall_nr_records);
+
+	seq_puts(m, "# level    async   start_us duration_us    wait_us    ret initcall\n");
+	for (i = 0; i < min(nr, initcall_records_max); i++) {
+		const struct initcall_record *rec = &initcall_records[i];
+
+		seq_printf(m, "%-10s %5d %10lld %11lld %10lld %6d %ps\n",
+			   initcall_level_names[rec->level], rec->async,
+			   rec->start_us, rec->duration_us, rec->wait_us,
+			   rec->ret, rec->fn);
+	}
+	if (nr > initcall_records_max)
+		seq_printf(m, "# %u initcalls not recorded\n",
+			   nr - initcall_records_max);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(initcall_timeline);
+
+static int __init initcall_timeline_debugfs_init(void)
+{
+	if (initcall_records)
+		debugfs_create_file("initcall_timeline", 0400, NULL, NULL,
+				    &initcall_timeline_fops);
+	return 0;
+}
+late_initcall(initcall_timeline_debugfs_init);
+
 /*
  * Ok, the machine is now initialized. None of the devices
  * have been touched yet, but the CPU subsystem is up and
@@ -1965,6 +2106,8 @@ static noinline void __init kernel_init_freeable(void)
 	smp_init();
 	sched_init_smp();
 
+	workqueue_init_topology();
+
 	padata_init();
 	page_alloc_init_late();
 	/* Initialize page ext after all struct pages are initialized. */
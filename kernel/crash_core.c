@@ -405,9 +405,10 @@ static int __init crash_save_vmcoreinfo_init(void)
 	VMCOREINFO_SYMBOL(node_online_map);
 #ifdef CONFIG_MMU
 	VMCOREINFO_SYMBOL_ARRAY(swapper_pg_dir);
+	vmcoreinfo_append_str("NUMBER(VMALLOC_START)=0x%lx\n",
+			      (unsigned long) VMALLOC_START);
 #endif
 	VMCOREINFO_SYMBOL(_stext);
-	VMCOREINFO_SYMBOL(vmap_area_list);
 
 #ifndef CONFIG_NUMA
 	VMCOREINFO_SYMBOL(mem_map);
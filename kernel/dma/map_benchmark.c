@@ -15,6 +15,7 @@
 #include <linux/module.h>
 #include <linux/pci.h>
 #include <linux/platform_device.h>
+#include <linux/scatterlist.h>
 #include <linux/slab.h>
 #include <linux/timekeeping.h>
 
@@ -22,6 +23,14 @@
 #define DMA_MAP_MAX_THREADS	1024
 #define DMA_MAP_MAX_SECONDS	300
 #define DMA_MAP_MAX_TRANS_DELAY	(10 * NSEC_PER_MSEC)
+#define DMA_MAP_MAX_SG_NENTS	256
+
+/*
+ * Latency histogram buckets: bucket i counts latencies in
+ * [2^i, 2^(i+1)) * 100ns, the first also takes anything shorter and the
+ * last anything longer.
+ */
+#define DMA_MAP_HIST_BUCKETS	8
 
 #define DMA_MAP_BIDIRECTIONAL	0
 #define DMA_MAP_TO_DEVICE	1
@@ -39,7 +48,11 @@ struct map_benchmark {
 	__u32 dma_dir; /* DMA data direction */
 	__u32 dma_trans_ns; /* time for DMA transmission in ns */
 	__u32 granule;	/* how many PAGE_SIZE will do map/unmap once a time */
-	__u8 expansion[76];	/* For future use */
+	__u32 sg_nents;	/* 0: dma_map_single, else dma_map_sg of this many
+			   entries of granule pages each */
+	__u32 map_hist[DMA_MAP_HIST_BUCKETS]; /* map latency histogram */
+	__u32 unmap_hist[DMA_MAP_HIST_BUCKETS]; /* as above */
+	__u8 expansion[8];	/* For future use */
 };
 
 struct map_benchmark_data {
@@ -52,8 +65,103 @@ struct map_benchmark_data {
 	atomic64_t sum_sq_map;
 	atomic64_t sum_sq_unmap;
 	atomic64_t loops;
+	atomic_t map_hist[DMA_MAP_HIST_BUCKETS];
+	atomic_t unmap_hist[DMA_MAP_HIST_BUCKETS];
 };
 
+static void map_benchmark_hist(atomic_t *hist, u64 lat_100ns)
+{
+	int bucket = lat_100ns ? ilog2(lat_100ns) : 0;
+
+	atomic_inc(&hist[min(bucket, DMA_MAP_HIST_BUCKETS - 1)]);
+}
+
+static void map_benchmark_account(struct map_benchmark_data *map,
+				  ktime_t map_delta, ktime_t unmap_delta)
+{
+	u64 map_100ns, unmap_100ns, map_sq, unmap_sq;
+
+	/* calculate sum and sum of squares */
+
+	map_100ns = div64_ul(map_delta,  100);
+	unmap_100ns = div64_ul(unmap_delta, 100);
+	map_sq = map_100ns * map_100ns;
+	unmap_sq = unmap_100ns * unmap_100ns;
+
+	atomic64_add(map_100ns, &map->sum_map_100ns);
+	atomic64_add(unmap_100ns, &map->sum_unmap_100ns);
+	atomic64_add(map_sq, &map->sum_sq_map);
+	atomic64_add(unmap_sq, &map->sum_sq_unmap);
+	atomic64_inc(&map->loops);
+
+	map_benchmark_hist(map->map_hist, map_100ns);
+	map_benchmark_hist(map->unmap_hist, unmap_100ns);
+}
+
+/* One buffer of granule pages per entry, mapped with dma_map_sg() */
+static int map_benchmark_sg_thread(struct map_benchmark_data *map)
+{
+	int nents = map->bparam.sg_nents;
+	u64 size = map->bparam.granule * PAGE_SIZE;
+	struct scatterlist *sg;
+	struct sg_table sgt;
+	void **bufs;
+	int i, ret;
+
+	bufs = kcalloc(nents, sizeof(*bufs), GFP_KERNEL);
+	if (!bufs)
+		return -ENOMEM;
+
+	ret = sg_alloc_table(&sgt, nents, GFP_KERNEL);
+	if (ret)
+		goto out_free_bufs;
+
+	for_each_sg(sgt.sgl, sg, nents, i) {
+		bufs[i] = alloc_pages_exact(size, GFP_KERNEL);
+		if (!bufs[i]) {
+			ret = -ENOMEM;
+			goto out;
+		}
+		sg_set_buf(sg, bufs[i], size);
+	}
+
+	while (!kthread_should_stop())  {
+		ktime_t map_stime, map_etime, unmap_stime, unmap_etime;
+
+		if (map->dir != DMA_FROM_DEVICE)
+			for (i = 0; i < nents; i++)
+				memset(bufs[i], 0x66, size);
+
+		map_stime = ktime_get();
+		if (unlikely(!dma_map_sg(map->dev, sgt.sgl, nents, map->dir))) {
+			pr_err("dma_map_sg failed on %s\n",
+				dev_name(map->dev));
+			ret = -ENOMEM;
+			goto out;
+		}
+		map_etime = ktime_get();
+
+		/* Pretend DMA is transmitting */
+		ndelay(map->bparam.dma_trans_ns);
+
+		unmap_stime = ktime_get();
+		dma_unmap_sg(map->dev, sgt.sgl, nents, map->dir);
+		unmap_etime = ktime_get();
+
+		map_benchmark_account(map, ktime_sub(map_etime, map_stime),
+				      ktime_sub(unmap_etime, unmap_stime));
+	}
+
+out:
+	for (i = 0; i < nents; i++)
+		if (bufs[i])
+			free_pages_exact(bufs[i], size);
+	sg_free_table(&sgt);
+out_free_bufs:
+	kfree(bufs);
+	return ret;
+}
+
 static int map_benchmark_thread(void *data)
 {
 	void *buf;
@@ -63,12 +171,14 @@ static int map_benchmark_thread(void *data)
 	u64 size = npages * PAGE_SIZE;
 	int ret = 0;
 
+	if (map->bparam.sg_nents)
+		return map_benchmark_sg_thread(map);
+
 	buf = alloc_pages_exact(size, GFP_KERNEL);
 	if (!buf)
 		return -ENOMEM;
 
 	while (!kthread_should_stop())  {
-		u64 map_100ns, unmap_100ns, map_sq, unmap_sq;
 		ktime_t map_stime, map_etime, unmap_stime, unmap_etime;
 		ktime_t map_delta, unmap_delta;
 
@@ -100,18 +210,7 @@ static int map_benchmark_thread(void *data)
 		unmap_etime = ktime_get();
 		unmap_delta = ktime_sub(unmap_etime, unmap_stime);
 
-		/* calculate sum and sum of squares */
-
-		map_100ns = div64_ul(map_delta,  100);
-		unmap_100ns = div64_ul(unmap_delta, 100);
-		map_sq = map_100ns * map_100ns;
-		unmap_sq = unmap_100ns * unmap_100ns;
-
-		atomic64_add(map_100ns, &map->sum_map_100ns);
-		atomic64_add(unmap_100ns, &map->sum_unmap_100ns);
-		atomic64_add(map_sq, &map->sum_sq_map);
-		atomic64_add(unmap_sq, &map->sum_sq_unmap);
-		atomic64_inc(&map->loops);
+		map_benchmark_account(map, map_delta, unmap_delta);
 	}
 
 out:
@@ -154,6 +253,10 @@ static int do_map_benchmark(struct map_benchmark_data *map)
 	atomic64_set(&map->sum_sq_map, 0);
 	atomic64_set(&map->sum_sq_unmap, 0);
 	atomic64_set(&map->loops, 0);
+	for (i = 0; i < DMA_MAP_HIST_BUCKETS; i++) {
+		atomic_set(&map->map_hist[i], 0);
+		atomic_set(&map->unmap_hist[i], 0);
+	}
 
 	for (i = 0; i < threads; i++) {
 		get_task_struct(tsk[i]);
@@ -190,6 +293,13 @@ static int do_map_benchmark(struct map_benchmark_data *map)
 				map->bparam.avg_unmap_100ns;
 		map->bparam.map_stddev = int_sqrt64(map_variance);
 		map->bparam.unmap_stddev = int_sqrt64(unmap_variance);
+
+		for (i = 0; i < DMA_MAP_HIST_BUCKETS; i++) {
+			map->bparam.map_hist[i] =
+				atomic_read(&map->map_hist[i]);
+			map->bparam.unmap_hist[i] =
+				atomic_read(&map->unmap_hist[i]);
+		}
 	}
 
 out:
@@ -241,6 +351,11 @@ static long map_benchmark_ioctl(struct file *file, unsigned int cmd,
 			return -EINVAL;
 		}
 
+		if (map->bparam.sg_nents > DMA_MAP_MAX_SG_NENTS) {
+			pr_err("invalid number of scatterlist entries\n");
+			return -EINVAL;
+		}
+
 		switch (map->bparam.dma_dir) {
 		case DMA_MAP_BIDIRECTIONAL:
 			map->dir = DMA_BIDIRECTIONAL;
@@ -316,11 +431,23 @@ static int __map_benchmark_probe(struct device *dev)
 	}
 
 	/*
-	 * we only permit a device bound with this driver, 2nd probe
-	 * will fail
+	 * the first device bound with this driver keeps the historical
+	 * name, further ones get their own file so that several devices
+	 * can be benchmarked at the same time
 	 */
-	entry = debugfs_create_file("dma_map_benchmark", 0600, NULL, map,
-			&map_benchmark_fops);
+	entry = debugfs_lookup("dma_map_benchmark", NULL);
+	if (entry) {
+		char name[64];
+
+		dput(entry);
+		snprintf(name, sizeof(name), "dma_map_benchmark-%s",
+			 dev_name(dev));
+		entry = debugfs_create_file(name, 0600, NULL, map,
+					    &map_benchmark_fops);
+	} else {
+		entry = debugfs_create_file("dma_map_benchmark", 0600, NULL,
+					    map, &map_benchmark_fops);
+	}
 	if (IS_ERR(entry))
 		return PTR_ERR(entry);
 	map->debugfs = entry;
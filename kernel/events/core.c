@@ -791,18 +791,19 @@ perf_cgroup_set_timestamp(struct task_struct *task,
 
 static DEFINE_PER_CPU(struct list_head, cgrp_cpuctx_list);
 
-#define PERF_CGROUP_SWOUT	0x1 /* cgroup switch out every event */
-#define PERF_CGROUP_SWIN	0x2 /* cgroup switch in events based on task */
+static void perf_cgroup_swap_events(struct perf_cpu_context *cpuctx,
+				    struct perf_cgroup *cgrp,
+				    struct task_struct *task);
 
 /*
- * reschedule events based on the cgroup constraint of task.
- *
- * mode SWOUT : schedule out everything
- * mode SWIN : schedule in based on cgroup for next
+ * Move the cgroup events of this CPU over to the cgroup of @task.  Only the
+ * events whose cgroup constraint changes are rescheduled, see
+ * perf_cgroup_swap_events().
  */
-static void perf_cgroup_switch(struct task_struct *task, int mode)
+static void perf_cgroup_switch(struct task_struct *task)
 {
 	struct perf_cpu_context *cpuctx;
+	struct perf_cgroup *cgrp;
 	struct list_head *list;
 	unsigned long flags;
 
@@ -817,63 +818,22 @@ static void perf_cgroup_switch(struct task_struct *task, int mode)
 		WARN_ON_ONCE(cpuctx->ctx.nr_cgroups == 0);
 
 		perf_ctx_lock(cpuctx, cpuctx->task_ctx);
-		perf_pmu_disable(cpuctx->ctx.pmu);
-
-		if (mode & PERF_CGROUP_SWOUT) {
-			cpu_ctx_sched_out(cpuctx, EVENT_ALL);
-			/*
-			 * must not be done before ctxswout due
-			 * to event_filter_match() in event_sched_out()
-			 */
-			cpuctx->cgrp = NULL;
-		}
-
-		if (mode & PERF_CGROUP_SWIN) {
-			WARN_ON_ONCE(cpuctx->cgrp);
-			/*
-			 * set cgrp before ctxsw in to allow
-			 * event_filter_match() to not have to pass
-			 * task around
-			 * we pass the cpuctx->ctx to perf_cgroup_from_task()
-			 * because cgorup events are only per-cpu
-			 */
-			cpuctx->cgrp = perf_cgroup_from_task(task,
-							     &cpuctx->ctx);
-			cpu_ctx_sched_in(cpuctx, EVENT_ALL, task);
+		/*
+		 * we pass the cpuctx->ctx to perf_cgroup_from_task()
+		 * because cgroup events are only per-cpu
+		 */
+		cgrp = perf_cgroup_from_task(task, &cpuctx->ctx);
+		if (cgrp != cpuctx->cgrp) {
+			perf_pmu_disable(cpuctx->ctx.pmu);
+			perf_cgroup_swap_events(cpuctx, cgrp, task);
+			perf_pmu_enable(cpuctx->ctx.pmu);
 		}
-		perf_pmu_enable(cpuctx->ctx.pmu);
 		perf_ctx_unlock(cpuctx, cpuctx->task_ctx);
 	}
 
 	local_irq_restore(flags);
 }
 
-static inline void perf_cgroup_sched_out(struct task_struct *task,
-					 struct task_struct *next)
-{
-	struct perf_cgroup *cgrp1;
-	struct perf_cgroup *cgrp2 = NULL;
-
-	rcu_read_lock();
-	/*
-	 * we come here when we know perf_cgroup_events > 0
-	 * we do not need to pass the ctx here because we know
-	 * we are holding the rcu lock
-	 */
-	cgrp1 = perf_cgroup_from_task(task, NULL);
-	cgrp2 = perf_cgroup_from_task(next, NULL);
-
-	/*
-	 * only schedule out current cgroup events if we know
-	 * that we are switching to a different cgroup. Otherwise,
-	 * do no touch the cgroup events.
-	 */
-	if (cgrp1 != cgrp2)
-		perf_cgroup_switch(task, PERF_CGROUP_SWOUT);
-
-	rcu_read_unlock();
-}
-
 static inline void perf_cgroup_sched_in(struct task_struct *prev,
 					struct task_struct *task)
 {
@@ -890,12 +850,12 @@ static inline void perf_cgroup_sched_in(struct task_struct *prev,
 	cgrp2 = perf_cgroup_from_task(prev, NULL);
 
 	/*
-	 * only need to schedule in cgroup events if we are changing
-	 * cgroup during ctxsw. Cgroup events were not scheduled
-	 * out of ctxsw out if that was not the case.
+	 * only need to switch cgroup events if we are changing
+	 * cgroup during ctxsw. They are left alone on ctxsw out,
+	 * so that the events common to both cgroups keep running.
 	 */
 	if (cgrp1 != cgrp2)
-		perf_cgroup_switch(task, PERF_CGROUP_SWIN);
+		perf_cgroup_switch(task);
 
 	rcu_read_unlock();
 }
@@ -1070,11 +1030,6 @@ static inline void update_cgrp_time_from_cpuctx(struct perf_cpu_context *cpuctx)
 {
 }
 
-static inline void perf_cgroup_sched_out(struct task_struct *task,
-					 struct task_struct *next)
-{
-}
-
 static inline void perf_cgroup_sched_in(struct task_struct *prev,
 					struct task_struct *task)
 {
@@ -1094,7 +1049,7 @@ perf_cgroup_set_timestamp(struct task_struct *task,
 }
 
 static inline void
-perf_cgroup_switch(struct task_struct *task, struct task_struct *next)
+perf_cgroup_switch(struct task_struct *task)
 {
 }
 
@@ -3595,14 +3550,6 @@ void __perf_event_task_sched_out(struct task_struct *task,
 
 	for_each_task_context_nr(ctxn)
 		perf_event_context_sched_out(task, ctxn, next);
-
-	/*
-	 * if cgroup events exist on this CPU, then we need
-	 * to check if we have to switch out PMU state.
-	 * cgroup event are system-wide mode only
-	 */
-	if (atomic_read(this_cpu_ptr(&perf_cgroup_events)))
-		perf_cgroup_sched_out(task, next);
 }
 
 /*
@@ -3739,6 +3686,10 @@ static int merge_sched_in(struct perf_event *event, void *data)
 	if (event->state <= PERF_EVENT_STATE_OFF)
 		return 0;
 
+	/* Kept on across a cgroup switch, see perf_cgroup_swap_events() */
+	if (event->state == PERF_EVENT_STATE_ACTIVE)
+		return 0;
+
 	if (!event_filter_match(event))
 		return 0;
 
@@ -3790,6 +3741,75 @@ ctx_flexible_sched_in(struct perf_event_context *ctx,
 			   merge_sched_in, &can_add_hw);
 }
 
+#ifdef CONFIG_CGROUP_PERF
+/*
+ * Whether there are pinned groups for a cgroup @cpuctx->cgrp is in,
+ * but @prev is not.
+ */
+static bool perf_cgroup_new_pinned(struct perf_cpu_context *cpuctx,
+				   struct perf_cgroup *prev)
+{
+	struct cgroup_subsys_state *css;
+
+	for (css = &cpuctx->cgrp->css; css; css = css->parent) {
+		if (prev && cgroup_is_descendant(prev->css.cgroup, css->cgroup))
+			break;
+		if (perf_event_groups_first(&cpuctx->ctx.pinned_groups,
+					    smp_processor_id(), css->cgroup))
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Move @cpuctx over to @cgrp.  Rather than scheduling every event out and
+ * back in, only the groups of cgroups @cgrp is not in are scheduled out and
+ * only those of cgroups it newly is in are scheduled in.  Events without a
+ * cgroup and those of common ancestors keep their counters.  If there are
+ * new pinned groups, the flexible ones make room for them first, like on a
+ * full reschedule.
+ */
+static void perf_cgroup_swap_events(struct perf_cpu_context *cpuctx,
+				    struct perf_cgroup *cgrp,
+				    struct task_struct *task)
+{
+	struct perf_event_context *ctx = &cpuctx->ctx;
+	struct perf_cgroup *prev = cpuctx->cgrp;
+	struct perf_event *event, *tmp;
+
+	if (!(ctx->is_active & EVENT_ALL)) {
+		cpuctx->cgrp = cgrp;
+		return;
+	}
+
+	/* update the time of the cgroups we are leaving, then switch */
+	ctx_sched_out(ctx, cpuctx, EVENT_TIME);
+	cpuctx->cgrp = cgrp;
+
+	list_for_each_entry_safe(event, tmp, &ctx->pinned_active, active_list) {
+		if (!perf_cgroup_match(event))
+			group_sched_out(event, cpuctx, ctx);
+	}
+	list_for_each_entry_safe(event, tmp, &ctx->flexible_active,
+				 active_list) {
+		if (!perf_cgroup_match(event))
+			group_sched_out(event, cpuctx, ctx);
+	}
+
+	if (perf_cgroup_new_pinned(cpuctx, prev))
+		ctx_sched_out(ctx, cpuctx, EVENT_FLEXIBLE);
+
+	/* restart time with the timestamps of the new cgroups */
+	ctx_sched_in(ctx, cpuctx, EVENT_TIME, task);
+
+	ctx_pinned_sched_in(ctx, cpuctx);
+	if (ctx->is_active & EVENT_FLEXIBLE)
+		ctx_flexible_sched_in(ctx, cpuctx);
+	else
+		ctx_sched_in(ctx, cpuctx, EVENT_FLEXIBLE, task);
+}
+#endif
+
 static void
 ctx_sched_in(struct perf_event_context *ctx,
 	     struct perf_cpu_context *cpuctx,
@@ -13433,7 +13453,7 @@ static int __perf_cgroup_move(void *info)
 {
 	struct task_struct *task = info;
 	rcu_read_lock();
-	perf_cgroup_switch(task, PERF_CGROUP_SWOUT | PERF_CGROUP_SWIN);
+	perf_cgroup_switch(task);
 	rcu_read_unlock();
 	return 0;
 }
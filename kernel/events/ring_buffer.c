@@ -302,6 +302,38 @@ void perf_output_end(struct perf_output_handle *handle)
 	rcu_read_unlock();
 }
 
+/*
+ * Bracket a run of records output for @event from the same context, such
+ * as a drained PEBS buffer.  The records nest inside @handle, so that
+ * ->data_head is published and the wakeup checked once for the whole run
+ * instead of for every record.
+ */
+void perf_output_batch_begin(struct perf_output_handle *handle,
+			     struct perf_event *event)
+{
+	struct perf_buffer *rb;
+
+	rcu_read_lock();
+	if (event->parent)
+		event = event->parent;
+
+	rb = rcu_dereference(event->rb);
+	if (rb && rb->paused)
+		rb = NULL;
+
+	handle->rb = rb;
+	handle->event = event;
+	if (rb)
+		perf_output_get_handle(handle);
+}
+
+void perf_output_batch_end(struct perf_output_handle *handle)
+{
+	if (handle->rb)
+		perf_output_put_handle(handle);
+	rcu_read_unlock();
+}
+
 static void
 ring_buffer_init(struct perf_buffer *rb, long watermark, int flags)
 {
@@ -27,6 +27,8 @@
 #include <linux/task_work.h>
 #include <linux/shmem_fs.h>
 #include <linux/khugepaged.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <linux/uprobes.h>
 
@@ -40,7 +42,10 @@ static struct rb_root uprobes_tree = RB_ROOT;
  */
 #define no_uprobe_events()	RB_EMPTY_ROOT(&uprobes_tree)
 
-static DEFINE_SPINLOCK(uprobes_treelock);	/* serialize rbtree access */
+static DEFINE_RWLOCK(uprobes_treelock);	/* serialize rbtree access */
+/* lets find_uprobe() walk the tree under RCU, see there */
+static seqcount_rwlock_t uprobes_seqcount =
+	SEQCNT_RWLOCK_ZERO(uprobes_seqcount, &uprobes_treelock);
 
 #define UPROBES_HASH_SZ	13
 /* serialize uprobe->pending_list */
@@ -63,6 +68,8 @@ struct uprobe {
 	loff_t			offset;
 	loff_t			ref_ctr_offset;
 	unsigned long		flags;
+	unsigned long __percpu	*nhits;		/* breakpoint hits */
+	struct rcu_head		rcu;
 
 	/*
 	 * The generic code assumes that it has two members of unknown type
@@ -593,6 +600,17 @@ set_orig_insn(struct arch_uprobe *auprobe, struct mm_struct *mm, unsigned long v
 			*(uprobe_opcode_t *)&auprobe->insn);
 }
 
+static void free_uprobe(struct uprobe *uprobe)
+{
+	free_percpu(uprobe->nhits);
+	kfree(uprobe);
+}
+
+static void free_uprobe_rcu(struct rcu_head *rcu)
+{
+	free_uprobe(container_of(rcu, struct uprobe, rcu));
+}
+
 static struct uprobe *get_uprobe(struct uprobe *uprobe)
 {
 	refcount_inc(&uprobe->ref);
@@ -610,7 +628,8 @@ static void put_uprobe(struct uprobe *uprobe)
 		mutex_lock(&delayed_uprobe_lock);
 		delayed_uprobe_remove(uprobe, NULL);
 		mutex_unlock(&delayed_uprobe_lock);
-		kfree(uprobe);
+		/* find_uprobe() may still be looking at it */
+		call_rcu(&uprobe->rcu, free_uprobe_rcu);
 	}
 }
 
@@ -667,31 +686,74 @@ static struct uprobe *__find_uprobe(struct inode *inode, loff_t offset)
 	return NULL;
 }
 
+/*
+ * Like rb_find(), but may run concurrently with __insert_uprobe() and
+ * delete_uprobe().  The rbtree code publishes child pointers with
+ * WRITE_ONCE(), so this always terminates, but a rotation can make it
+ * miss a node that is there: uprobes_seqcount tells when to retry.
+ */
+static struct uprobe *__find_uprobe_rcu(struct inode *inode, loff_t offset)
+{
+	struct rb_node *node = rcu_dereference_raw(uprobes_tree.rb_node);
+
+	while (node) {
+		struct uprobe *u = __node_2_uprobe(node);
+		int c = uprobe_cmp(inode, offset, u);
+
+		if (!c)
+			return u;
+		node = rcu_dereference_raw(c < 0 ? node->rb_left :
+						   node->rb_right);
+	}
+
+	return NULL;
+}
+
 /*
  * Find a uprobe corresponding to a given inode:offset
- * Acquires uprobes_treelock
+ * Only takes uprobes_treelock if the tree changed under the lookup.
  */
 static struct uprobe *find_uprobe(struct inode *inode, loff_t offset)
 {
 	struct uprobe *uprobe;
+	unsigned int seq;
 
-	spin_lock(&uprobes_treelock);
+	rcu_read_lock();
+	seq = raw_read_seqcount_begin(&uprobes_seqcount);
+	uprobe = __find_uprobe_rcu(inode, offset);
+	/* a dying uprobe has been erased from the tree already */
+	if (uprobe && !refcount_inc_not_zero(&uprobe->ref))
+		uprobe = NULL;
+	rcu_read_unlock();
+
+	if (uprobe || !read_seqcount_retry(&uprobes_seqcount, seq))
+		return uprobe;
+
+	read_lock(&uprobes_treelock);
 	uprobe = __find_uprobe(inode, offset);
-	spin_unlock(&uprobes_treelock);
+	read_unlock(&uprobes_treelock);
 
 	return uprobe;
 }
 
 static struct uprobe *__insert_uprobe(struct uprobe *uprobe)
 {
-	struct rb_node *node;
+	struct rb_node **link = &uprobes_tree.rb_node;
+	struct rb_node *parent = NULL;
+	int c;
 
-	node = rb_find_add(&uprobe->rb_node, &uprobes_tree, __uprobe_cmp);
-	if (node)
-		return get_uprobe(__node_2_uprobe(node));
+	while (*link) {
+		parent = *link;
+		c = __uprobe_cmp(&uprobe->rb_node, parent);
+		if (!c)
+			return get_uprobe(__node_2_uprobe(parent));
+		link = c < 0 ? &parent->rb_left : &parent->rb_right;
+	}
 
-	/* get access + creation ref */
+	/* get access + creation ref, before find_uprobe() can see it */
 	refcount_set(&uprobe->ref, 2);
+	rb_link_node_rcu(&uprobe->rb_node, parent, link);
+	rb_insert_color(&uprobe->rb_node, &uprobes_tree);
 	return NULL;
 }
 
@@ -707,9 +769,11 @@ static struct uprobe *insert_uprobe(struct uprobe *uprobe)
 {
 	struct uprobe *u;
 
-	spin_lock(&uprobes_treelock);
+	write_lock(&uprobes_treelock);
+	write_seqcount_begin(&uprobes_seqcount);
 	u = __insert_uprobe(uprobe);
-	spin_unlock(&uprobes_treelock);
+	write_seqcount_end(&uprobes_seqcount);
+	write_unlock(&uprobes_treelock);
 
 	return u;
 }
@@ -736,6 +800,11 @@ static struct uprobe *alloc_uprobe(struct inode *inode, loff_t offset,
 	uprobe->inode = inode;
 	uprobe->offset = offset;
 	uprobe->ref_ctr_offset = ref_ctr_offset;
+	uprobe->nhits = alloc_percpu(unsigned long);
+	if (!uprobe->nhits) {
+		kfree(uprobe);
+		return NULL;
+	}
 	init_rwsem(&uprobe->register_rwsem);
 	init_rwsem(&uprobe->consumer_rwsem);
 
@@ -746,10 +815,10 @@ static struct uprobe *alloc_uprobe(struct inode *inode, loff_t offset,
 		if (cur_uprobe->ref_ctr_offset != uprobe->ref_ctr_offset) {
 			ref_ctr_mismatch_warn(cur_uprobe, uprobe);
 			put_uprobe(cur_uprobe);
-			kfree(uprobe);
+			free_uprobe(uprobe);
 			return ERR_PTR(-EINVAL);
 		}
-		kfree(uprobe);
+		free_uprobe(uprobe);
 		uprobe = cur_uprobe;
 	}
 
@@ -941,9 +1010,11 @@ static void delete_uprobe(struct uprobe *uprobe)
 	if (WARN_ON(!uprobe_is_active(uprobe)))
 		return;
 
-	spin_lock(&uprobes_treelock);
+	write_lock(&uprobes_treelock);
+	write_seqcount_begin(&uprobes_seqcount);
 	rb_erase(&uprobe->rb_node, &uprobes_tree);
-	spin_unlock(&uprobes_treelock);
+	write_seqcount_end(&uprobes_seqcount);
+	write_unlock(&uprobes_treelock);
 	RB_CLEAR_NODE(&uprobe->rb_node); /* for uprobe_is_active() */
 	put_uprobe(uprobe);
 }
@@ -1302,7 +1373,7 @@ static void build_probe_list(struct inode *inode,
 	min = vaddr_to_offset(vma, start);
 	max = min + (end - start) - 1;
 
-	spin_lock(&uprobes_treelock);
+	read_lock(&uprobes_treelock);
 	n = find_node_in_range(inode, min, max);
 	if (n) {
 		for (t = n; t; t = rb_prev(t)) {
@@ -1320,7 +1391,7 @@ static void build_probe_list(struct inode *inode,
 			get_uprobe(u);
 		}
 	}
-	spin_unlock(&uprobes_treelock);
+	read_unlock(&uprobes_treelock);
 }
 
 /* @vma contains reference counter, not the probed instruction. */
@@ -1417,9 +1488,9 @@ vma_has_uprobes(struct vm_area_struct *vma, unsigned long start, unsigned long e
 	min = vaddr_to_offset(vma, start);
 	max = min + (end - start) - 1;
 
-	spin_lock(&uprobes_treelock);
+	read_lock(&uprobes_treelock);
 	n = find_node_in_range(inode, min, max);
-	spin_unlock(&uprobes_treelock);
+	read_unlock(&uprobes_treelock);
 
 	return !!n;
 }
@@ -1707,11 +1778,37 @@ unsigned long uprobe_get_trap_addr(struct pt_regs *regs)
 	return instruction_pointer(regs);
 }
 
-static struct return_instance *free_ret_instance(struct return_instance *ri)
+/*
+ * Return instances are recycled through a per-task list, so that a hot
+ * uretprobe doesn't have to go to the allocator on every call.  There are
+ * never more of them than the deepest the task has nested, which is at
+ * most MAX_URETPROBE_DEPTH.
+ */
+static struct return_instance *alloc_ret_instance(struct uprobe_task *utask)
+{
+	struct return_instance *ri = utask->ri_pool;
+
+	if (ri) {
+		utask->ri_pool = ri->next;
+		return ri;
+	}
+
+	return kmalloc(sizeof(struct return_instance), GFP_KERNEL);
+}
+
+static void recycle_ret_instance(struct uprobe_task *utask,
+				 struct return_instance *ri)
+{
+	ri->next = utask->ri_pool;
+	utask->ri_pool = ri;
+}
+
+static struct return_instance *free_ret_instance(struct uprobe_task *utask,
+						 struct return_instance *ri)
 {
 	struct return_instance *next = ri->next;
 	put_uprobe(ri->uprobe);
-	kfree(ri);
+	recycle_ret_instance(utask, ri);
 	return next;
 }
 
@@ -1732,7 +1829,12 @@ void uprobe_free_utask(struct task_struct *t)
 
 	ri = utask->return_instances;
 	while (ri)
-		ri = free_ret_instance(ri);
+		ri = free_ret_instance(utask, ri);
+
+	while ((ri = utask->ri_pool)) {
+		utask->ri_pool = ri->next;
+		kfree(ri);
+	}
 
 	xol_free_insn_slot(t);
 	kfree(utask);
@@ -1857,7 +1959,7 @@ static void cleanup_return_instances(struct uprobe_task *utask, bool chained,
 	enum rp_check ctx = chained ? RP_CHECK_CHAIN_CALL : RP_CHECK_CALL;
 
 	while (ri && !arch_uretprobe_is_alive(ri, ctx, regs)) {
-		ri = free_ret_instance(ri);
+		ri = free_ret_instance(utask, ri);
 		utask->depth--;
 	}
 	utask->return_instances = ri;
@@ -1884,7 +1986,7 @@ static void prepare_uretprobe(struct uprobe *uprobe, struct pt_regs *regs)
 		return;
 	}
 
-	ri = kmalloc(sizeof(struct return_instance), GFP_KERNEL);
+	ri = alloc_ret_instance(utask);
 	if (!ri)
 		return;
 
@@ -1926,7 +2028,7 @@ static void prepare_uretprobe(struct uprobe *uprobe, struct pt_regs *regs)
 
 	return;
  fail:
-	kfree(ri);
+	recycle_ret_instance(utask, ri);
 }
 
 /* Prepare to single-step probed instruction out of line. */
@@ -2081,6 +2183,8 @@ static void handler_chain(struct uprobe *uprobe, struct pt_regs *regs)
 	int remove = UPROBE_HANDLER_REMOVE;
 	bool need_prep = false; /* prepare return uprobe, when needed */
 
+	this_cpu_inc(*uprobe->nhits);
+
 	down_read(&uprobe->register_rwsem);
 	for (uc = uprobe->consumers; uc; uc = uc->next) {
 		int rc = 0;
@@ -2161,7 +2265,7 @@ static void handle_trampoline(struct pt_regs *regs)
 		do {
 			if (valid)
 				handle_uretprobe_chain(ri, regs);
-			ri = free_ret_instance(ri);
+			ri = free_ret_instance(utask, ri);
 			utask->depth--;
 		} while (ri != next);
 	} while (!valid);
@@ -2363,3 +2467,36 @@ void __init uprobes_init(void)
 
 	BUG_ON(register_die_notifier(&uprobe_exception_nb));
 }
+
+#ifdef CONFIG_DEBUG_FS
+/* One line per uprobe: inode number, offset and number of hits */
+static int uprobe_hits_show(struct seq_file *m, void *v)
+{
+	struct uprobe *uprobe;
+	struct rb_node *n;
+	unsigned long hits;
+	int cpu;
+
+	read_lock(&uprobes_treelock);
+	for (n = rb_first(&uprobes_tree); n; n = rb_next(n)) {
+		uprobe = __node_2_uprobe(n);
+		hits = 0;
+		for_each_possible_cpu(cpu)
+			hits += *per_cpu_ptr(uprobe->nhits, cpu);
+		seq_printf(m, "%lu 0x%llx %lu\n", uprobe->inode->i_ino,
+			   (unsigned long long)uprobe->offset, hits);
+	}
+	read_unlock(&uprobes_treelock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(uprobe_hits);
+
+static int __init uprobes_debugfs_init(void)
+{
+	debugfs_create_file("uprobe_hits", 0400, NULL, NULL,
+			    &uprobe_hits_fops);
+	return 0;
+}
+late_initcall(uprobes_debugfs_init);
+#endif
@@ -0,0 +1,274 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * In-kernel interrupt balancing
+ *
+ * Every interval_ms, look at the time each CPU spent in hard and soft
+ * interrupt context. For each CPU above threshold percent, the interrupt
+ * which fired the most on it since the previous sample is routed to the
+ * least loaded CPU of its affinity mask, provided that one is below half
+ * the threshold. Only the effective affinity changes, the affinity mask
+ * set up by the driver or through /proc/irq stays what it was.
+ *
+ * Managed and per-CPU interrupts as well as interrupts which opted out of
+ * balancing are never moved, and neither isolated nor interrupt isolated
+ * CPUs (isolcpus=domain,managed_irq) are picked as targets. A moved
+ * interrupt is left where it is for cooldown_ms to avoid ping-pong.
+ */
+
+#define pr_fmt(fmt) "irq_balance: " fmt
+
+#include <linux/cpumask.h>
+#include <linux/irq.h>
+#include <linux/jiffies.h>
+#include <linux/kernel_stat.h>
+#include <linux/moduleparam.h>
+#include <linux/sched/isolation.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+
+#include "internals.h"
+
+#ifdef MODULE_PARAM_PREFIX
+#undef MODULE_PARAM_PREFIX
+#endif
+#define MODULE_PARAM_PREFIX "irq_balance."
+
+static bool irq_balance_enabled;
+static unsigned int interval_ms = 20;
+module_param(interval_ms, uint, 0644);
+static unsigned int threshold = 60;
+module_param(threshold, uint, 0644);
+static unsigned int cooldown_ms = 1000;
+module_param(cooldown_ms, uint, 0644);
+
+struct irq_balance_cpu {
+	u64		last_time;	/* irq + softirq time at last sample */
+	unsigned int	load;		/* in percent of the interval */
+	/* busiest balanceable interrupt since the last sample */
+	struct irq_desc	*hot_desc;
+	unsigned int	hot_count;
+};
+
+static DEFINE_PER_CPU(struct irq_balance_cpu, irq_balance_cpus);
+
+static cpumask_var_t irq_balance_targets;
+static u64 irq_balance_last;
+static bool irq_balance_ready;
+
+static void irq_balance_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(irq_balance_work, irq_balance_fn);
+
+static unsigned long irq_balance_interval(void)
+{
+	return msecs_to_jiffies(max(READ_ONCE(interval_ms), 1U));
+}
+
+static bool irq_balance_candidate(struct irq_desc *desc)
+{
+	struct irq_data *data = irq_desc_get_irq_data(desc);
+
+	return desc->action && desc->kstat_irqs && irqd_can_balance(data) &&
+	       !irqd_affinity_is_managed(data) &&
+	       !irq_settings_is_per_cpu_devid(desc) &&
+	       irqd_is_started(data);
+}
+
+/* The CPUs interrupts may be moved to. */
+static void irq_balance_cpumask(struct cpumask *mask)
+{
+	cpumask_and(mask, cpu_online_mask,
+		    housekeeping_cpumask(HK_FLAG_DOMAIN));
+	cpumask_and(mask, mask, housekeeping_cpumask(HK_FLAG_MANAGED_IRQ));
+}
+
+static void irq_balance_update_loads(const struct cpumask *cpus, u64 delta)
+{
+	int cpu;
+
+	for_each_cpu(cpu, cpus) {
+		struct irq_balance_cpu *ibc = per_cpu_ptr(&irq_balance_cpus, cpu);
+		u64 *cpustat = kcpustat_cpu(cpu).cpustat;
+		u64 time = cpustat[CPUTIME_IRQ] + cpustat[CPUTIME_SOFTIRQ];
+
+		ibc->load = ibc->last_time && delta ?
+			    div64_u64((time - ibc->last_time) * 100, delta) : 0;
+		ibc->last_time = time;
+		ibc->hot_desc = NULL;
+		ibc->hot_count = 0;
+	}
+}
+
+/*
+ * Sample all interrupts on their effective CPU, and remember the busiest
+ * one of every CPU. Called with the sparse irq lock held, which keeps the
+ * descriptors around.
+ */
+static void irq_balance_sample(const struct cpumask *cpus)
+{
+	struct irq_desc *desc;
+	int irq;
+
+	for_each_irq_desc(irq, desc) {
+		struct irq_data *data = irq_desc_get_irq_data(desc);
+		struct irq_balance_cpu *ibc;
+		unsigned int cpu, count, delta;
+
+		if (!irq_balance_candidate(desc))
+			continue;
+
+		cpu = cpumask_first(irq_data_get_effective_affinity_mask(data));
+		if (cpu >= nr_cpu_ids)
+			continue;
+
+		count = *per_cpu_ptr(desc->kstat_irqs, cpu);
+		delta = desc->balance_cpu == cpu ? count - desc->balance_count : 0;
+		desc->balance_cpu = cpu;
+		desc->balance_count = count;
+
+		if (!delta || !cpumask_test_cpu(cpu, cpus))
+			continue;
+
+		ibc = per_cpu_ptr(&irq_balance_cpus, cpu);
+		if (delta > ibc->hot_count) {
+			ibc->hot_desc = desc;
+			ibc->hot_count = delta;
+		}
+	}
+}
+
+/* Find the least loaded allowed CPU for @desc, nr_cpu_ids if none. */
+static unsigned int irq_balance_pick(struct irq_desc *desc,
+				     const struct cpumask *cpus)
+{
+	const struct cpumask *affinity =
+		irq_data_get_affinity_mask(irq_desc_get_irq_data(desc));
+	unsigned int cpu, best = nr_cpu_ids, best_load = READ_ONCE(threshold) / 2;
+
+	for_each_cpu_and(cpu, cpus, affinity) {
+		struct irq_balance_cpu *ibc = per_cpu_ptr(&irq_balance_cpus, cpu);
+
+		if (cpumask_test_cpu(cpu, irq_balance_targets))
+			continue;
+		if (desc->affinity_hint &&
+		    !cpumask_test_cpu(cpu, desc->affinity_hint))
+			continue;
+		if (ibc->load < best_load) {
+			best = cpu;
+			best_load = ibc->load;
+		}
+	}
+
+	return best;
+}
+
+static void irq_balance_move(struct irq_desc *desc, unsigned int from,
+			     const struct cpumask *cpus)
+{
+	struct irq_data *data = irq_desc_get_irq_data(desc);
+	unsigned int to = nr_cpu_ids;
+	unsigned long flags;
+	int ret = -EAGAIN;
+
+	raw_spin_lock_irqsave(&desc->lock, flags);
+	if (!irq_balance_candidate(desc) ||
+	    time_before(jiffies, desc->balance_moved +
+			msecs_to_jiffies(READ_ONCE(cooldown_ms))) ||
+	    cpumask_first(irq_data_get_effective_affinity_mask(data)) != from)
+		goto out;
+
+	to = irq_balance_pick(desc, cpus);
+	if (to >= nr_cpu_ids)
+		goto out;
+
+	ret = irq_do_set_effective_affinity(data, to);
+	if (!ret) {
+		desc->balance_moved = jiffies;
+		/* don't pile several interrupts onto one CPU in a round */
+		cpumask_set_cpu(to, irq_balance_targets);
+	}
+out:
+	raw_spin_unlock_irqrestore(&desc->lock, flags);
+
+	if (!ret)
+		pr_debug("moved irq %u from CPU%u to CPU%u\n",
+			 irq_desc_get_irq(desc), from, to);
+}
+
+static void irq_balance_fn(struct work_struct *work)
+{
+	cpumask_var_t cpus;
+	u64 now, delta;
+	int cpu;
+
+	if (!READ_ONCE(irq_balance_enabled))
+		return;
+
+	if (!zalloc_cpumask_var(&cpus, GFP_KERNEL))
+		goto requeue;
+
+	cpus_read_lock();
+	irq_balance_cpumask(cpus);
+
+	now = ktime_get_ns();
+	delta = irq_balance_last ? now - irq_balance_last : 0;
+	irq_balance_last = now;
+	irq_balance_update_loads(cpus, delta);
+
+	irq_lock_sparse();
+	irq_balance_sample(cpus);
+
+	cpumask_clear(irq_balance_targets);
+	for_each_cpu(cpu, cpus) {
+		struct irq_balance_cpu *ibc = per_cpu_ptr(&irq_balance_cpus, cpu);
+
+		if (ibc->load >= READ_ONCE(threshold) && ibc->hot_desc)
+			irq_balance_move(ibc->hot_desc, cpu, cpus);
+	}
+	irq_unlock_sparse();
+	cpus_read_unlock();
+
+	free_cpumask_var(cpus);
+requeue:
+	queue_delayed_work(system_unbound_wq, &irq_balance_work,
+			   irq_balance_interval());
+}
+
+static int irq_balance_set_enabled(const char *val,
+				   const struct kernel_param *kp)
+{
+	bool was = irq_balance_enabled;
+	int ret;
+
+	ret = param_set_bool(val, kp);
+	if (ret || was == irq_balance_enabled)
+		return ret;
+
+	/* Before the initcall, which then starts the balancer. */
+	if (!READ_ONCE(irq_balance_ready))
+		return 0;
+
+	if (irq_balance_enabled) {
+		irq_balance_last = 0;
+		queue_delayed_work(system_unbound_wq, &irq_balance_work, 0);
+	}
+	return 0;
+}
+
+static const struct kernel_param_ops irq_balance_enabled_ops = {
+	.set = irq_balance_set_enabled,
+	.get = param_get_bool,
+};
+module_param_cb(enabled, &irq_balance_enabled_ops, &irq_balance_enabled, 0644);
+
+static int __init irq_balance_init(void)
+{
+	if (!zalloc_cpumask_var(&irq_balance_targets, GFP_KERNEL))
+		return -ENOMEM;
+
+	WRITE_ONCE(irq_balance_ready, true);
+	if (irq_balance_enabled)
+		queue_delayed_work(system_unbound_wq, &irq_balance_work,
+				   irq_balance_interval());
+	return 0;
+}
+late_initcall(irq_balance_init);
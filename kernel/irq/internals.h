@@ -136,6 +136,8 @@ extern void irq_set_thread_affinity(struct irq_desc *desc);
 
 extern int irq_do_set_affinity(struct irq_data *data,
 			       const struct cpumask *dest, bool force);
+extern int irq_do_set_effective_affinity(struct irq_data *data,
+					 unsigned int cpu);
 
 #ifdef CONFIG_SMP
 extern int irq_setup_affinity(struct irq_desc *desc);
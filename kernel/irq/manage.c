@@ -251,6 +251,42 @@ static inline void irq_init_effective_affinity(struct irq_data *data,
 					       const struct cpumask *mask) { }
 #endif
 
+#ifdef CONFIG_IRQ_BALANCE
+/**
+ * irq_do_set_effective_affinity - route an interrupt to one CPU of its mask
+ * @data:	irq data of the interrupt, with desc->lock held
+ * @cpu:	the target CPU
+ *
+ * Unlike irq_do_set_affinity() this leaves the affinity mask set up by the
+ * driver or user space alone and only changes the effective affinity, so
+ * that the balancer remains free to pick another CPU of the mask later.
+ */
+int irq_do_set_effective_affinity(struct irq_data *data, unsigned int cpu)
+{
+	struct irq_desc *desc = irq_data_to_desc(data);
+	struct irq_chip *chip = irq_data_get_irq_chip(data);
+	int ret;
+
+	if (!chip || !chip->irq_set_affinity)
+		return -EINVAL;
+
+	if (!irq_can_move_pcntxt(data) || irqd_is_setaffinity_pending(data))
+		return -EBUSY;
+
+	ret = chip->irq_set_affinity(data, cpumask_of(cpu), false);
+	switch (ret) {
+	case IRQ_SET_MASK_OK:
+	case IRQ_SET_MASK_OK_DONE:
+	case IRQ_SET_MASK_OK_NOCOPY:
+		irq_validate_effective_affinity(data);
+		irq_set_thread_affinity(desc);
+		ret = 0;
+	}
+
+	return ret;
+}
+#endif
+
 /*
  * IAMROOT, 2022.10.01:
  * - irq_set_thread_affinity callback수행.
@@ -22,14 +22,25 @@
 /* mutex to protect coming/going of the jump_label table */
 static DEFINE_MUTEX(jump_label_mutex);
 
+/* The task between static_key_batch_begin() and _end(), if any */
+static struct task_struct *jump_label_batch_owner;
+
+static bool jump_label_batching(void)
+{
+	return READ_ONCE(jump_label_batch_owner) == current;
+}
+
 void jump_label_lock(void)
 {
-	mutex_lock(&jump_label_mutex);
+	/* The batch owner already holds it */
+	if (!jump_label_batching())
+		mutex_lock(&jump_label_mutex);
 }
 
 void jump_label_unlock(void)
 {
-	mutex_unlock(&jump_label_mutex);
+	if (!jump_label_batching())
+		mutex_unlock(&jump_label_mutex);
 }
 
 /*
@@ -500,10 +511,74 @@ static void __jump_label_update(struct static_key *key,
 			BUG_ON(!arch_jump_label_transform_queue(entry, jump_label_type(entry)));
 		}
 	}
-	arch_jump_label_transform_apply();
+}
+
+/*
+ * Keys updated in the current batch.  The sites of a key may only be
+ * queued once before the queue is applied, as the arch code checks them
+ * against what they are expected to contain.
+ */
+#define JUMP_LABEL_BATCH_KEYS	64
+static struct static_key *jump_label_batch_keys[JUMP_LABEL_BATCH_KEYS];
+static unsigned int jump_label_batch_nr;
+
+static void jump_label_batch_add(struct static_key *key)
+{
+	unsigned int i;
+
+	for (i = 0; i < jump_label_batch_nr; i++) {
+		if (jump_label_batch_keys[i] == key)
+			break;
+	}
+	if (i < jump_label_batch_nr || i == JUMP_LABEL_BATCH_KEYS) {
+		arch_jump_label_transform_apply();
+		jump_label_batch_nr = 0;
+	}
+	jump_label_batch_keys[jump_label_batch_nr++] = key;
+}
+
+static void jump_label_apply(void)
+{
+	/* The batch owner applies everything in static_key_batch_end() */
+	if (!jump_label_batching())
+		arch_jump_label_transform_apply();
 }
 #endif
 
+#ifndef HAVE_JUMP_LABEL_BATCH
+static inline void jump_label_batch_add(struct static_key *key) { }
+static inline void jump_label_apply(void) { }
+#endif
+
+/**
+ * static_key_batch_begin - start a batch of static key updates
+ *
+ * The text changes of the static key updates up to static_key_batch_end()
+ * are queued and applied together, rather than costing a round of IPIs to
+ * every CPU per key.  They only take effect at static_key_batch_end().
+ * In between, the keys must be updated with the _cpuslocked() variants.
+ */
+void static_key_batch_begin(void)
+{
+	cpus_read_lock();
+	mutex_lock(&jump_label_mutex);
+	WRITE_ONCE(jump_label_batch_owner, current);
+}
+EXPORT_SYMBOL_GPL(static_key_batch_begin);
+
+void static_key_batch_end(void)
+{
+	WARN_ON_ONCE(!jump_label_batching());
+	WRITE_ONCE(jump_label_batch_owner, NULL);
+#ifdef HAVE_JUMP_LABEL_BATCH
+	arch_jump_label_transform_apply();
+	jump_label_batch_nr = 0;
+#endif
+	mutex_unlock(&jump_label_mutex);
+	cpus_read_unlock();
+}
+EXPORT_SYMBOL_GPL(static_key_batch_end);
+
 /*
  * IAMROOT, 2021.10.16:
  * - static_key를 정렬하고 static_key가 init section에 위치하는지 판단해
@@ -728,6 +803,7 @@ static int jump_label_add_module(struct module *mod)
 		if (jump_label_type(iter) != jump_label_init_type(iter))
 			__jump_label_update(key, iter, iter_stop, true);
 	}
+	jump_label_apply();
 
 	return 0;
 }
@@ -859,9 +935,15 @@ static void jump_label_update(struct static_key *key)
 	struct jump_entry *entry;
 #ifdef CONFIG_MODULES
 	struct module *mod;
+#endif
 
+	if (jump_label_batching())
+		jump_label_batch_add(key);
+
+#ifdef CONFIG_MODULES
 	if (static_key_linked(key)) {
 		__jump_label_mod_update(key);
+		jump_label_apply();
 		return;
 	}
 
@@ -877,6 +959,7 @@ static void jump_label_update(struct static_key *key)
 	/* if there are no users, entry can be NULL */
 	if (entry)
 		__jump_label_update(key, entry, stop, init);
+	jump_label_apply();
 }
 
 #ifdef CONFIG_STATIC_KEYS_SELFTEST
@@ -0,0 +1,318 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Sampled lock contention profiling
+ *
+ * lock_stat answers "which lock do we wait on", but needs full lockdep and
+ * is far too expensive to run outside of a debug kernel. This hooks the
+ * slowpaths of queued spinlocks, mutexes, rwsems and rtmutexes instead, so
+ * that nothing is paid on the uncontended fastpaths, and samples one in
+ * sample_period slowpath entries per CPU. A sample that waited for at least
+ * min_wait_ns is logged with the lock address, the waiter's stack and, for
+ * the sleeping locks, the pid of the task owning the lock when the wait
+ * started, into a per-CPU ring buffer of the last LC_RING_SIZE samples.
+ *
+ * With the tracer disabled each slowpath only pays for a static branch.
+ *
+ * Everything lives in <debugfs>/lock_contention/:
+ *
+ *   enable		1 to start sampling, 0 to stop
+ *   sample_period	sample one in this many slowpath entries (per CPU)
+ *   min_wait_ns	log samples that waited at least this long
+ *   stats		sampled entries and wait time per lock type
+ *   samples		logged samples, a write clears the rings and stats
+ *
+ * The rings are written without any synchronization against readers, a
+ * sample can be torn if it is replaced while being read. Stop sampling
+ * first if that matters.
+ */
+#include <linux/debugfs.h>
+#include <linux/mm.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
+#include <linux/sched/clock.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/stacktrace.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+
+#include "lock_contention.h"
+
+#define LC_RING_SIZE		256	/* must be a power of two */
+#define LC_STACK_DEPTH		8
+
+struct lc_sample {
+	unsigned long		lock;
+	u64			timestamp;
+	u64			wait_ns;
+	pid_t			pid;
+	pid_t			owner_pid;
+	u8			type;
+	u8			nr_entries;
+	unsigned long		entries[LC_STACK_DEPTH];
+};
+
+struct lc_ring {
+	unsigned int		head;
+	unsigned long		nr[LC_NR_TYPES];
+	u64			wait_ns[LC_NR_TYPES];
+	struct lc_sample	samples[LC_RING_SIZE];
+};
+
+static const char * const lc_type_names[LC_NR_TYPES] = {
+	[LC_SPINLOCK]		= "spinlock",
+	[LC_MUTEX]		= "mutex",
+	[LC_RWSEM_READ]		= "rwsem_read",
+	[LC_RWSEM_WRITE]	= "rwsem_write",
+	[LC_RTMUTEX]		= "rtmutex",
+};
+
+DEFINE_STATIC_KEY_FALSE(lock_contention_key);
+
+static u32 lc_sample_period = 64;
+static u64 lc_min_wait_ns = 1000;
+
+static DEFINE_PER_CPU(unsigned int, lc_sample_count);
+static DEFINE_PER_CPU(struct lc_ring *, lc_rings);
+
+void __lock_contention_begin(struct lock_contention *lc,
+			     struct task_struct *owner)
+{
+	unsigned int period = READ_ONCE(lc_sample_period);
+
+	/* The ring is only protected against interrupts. */
+	if (in_nmi())
+		return;
+
+	if (period > 1 && raw_cpu_inc_return(lc_sample_count) % period)
+		return;
+
+	lc->owner_pid = owner ? READ_ONCE(owner->pid) : 0;
+	lc->start = local_clock();
+}
+
+void __lock_contention_end(struct lock_contention *lc, void *lock,
+			   enum lock_contention_type type)
+{
+	u64 now = local_clock();
+	u64 wait = now - lc->start;
+	struct lc_sample *s;
+	struct lc_ring *ring;
+	unsigned long flags;
+
+	/*
+	 * Raw irq flags, this can be called from the spinlock slowpath which
+	 * lockdep depends on.
+	 */
+	raw_local_irq_save(flags);
+	ring = this_cpu_read(lc_rings);
+	if (!ring)
+		goto out;
+
+	ring->nr[type]++;
+	ring->wait_ns[type] += wait;
+	if (wait < READ_ONCE(lc_min_wait_ns))
+		goto out;
+
+	s = &ring->samples[ring->head++ & (LC_RING_SIZE - 1)];
+	s->lock = (unsigned long)lock;
+	s->timestamp = now;
+	s->wait_ns = wait;
+	s->pid = current->pid;
+	s->owner_pid = lc->owner_pid;
+	s->type = type;
+	s->nr_entries = stack_trace_save(s->entries, LC_STACK_DEPTH, 2);
+out:
+	raw_local_irq_restore(flags);
+}
+
+/*
+ * Samples are addressed as cpu * LC_RING_SIZE + slot, skipping the slots
+ * of rings that are not (yet) filled.
+ */
+static struct lc_sample *lc_find_sample(loff_t *pos)
+{
+	for (; *pos < (loff_t)nr_cpu_ids * LC_RING_SIZE; (*pos)++) {
+		int cpu = *pos / LC_RING_SIZE;
+		struct lc_ring *ring;
+		struct lc_sample *s;
+
+		if (!cpu_possible(cpu)) {
+			*pos = (loff_t)(cpu + 1) * LC_RING_SIZE - 1;
+			continue;
+		}
+
+		ring = per_cpu(lc_rings, cpu);
+		if (!ring) {
+			*pos = (loff_t)(cpu + 1) * LC_RING_SIZE - 1;
+			continue;
+		}
+
+		s = &ring->samples[*pos % LC_RING_SIZE];
+		if (READ_ONCE(s->wait_ns))
+			return s;
+	}
+
+	return NULL;
+}
+
+static void *lc_samples_start(struct seq_file *m, loff_t *pos)
+{
+	return lc_find_sample(pos);
+}
+
+static void *lc_samples_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	(*pos)++;
+	return lc_find_sample(pos);
+}
+
+static void lc_samples_stop(struct seq_file *m, void *v)
+{
+}
+
+static int lc_samples_show(struct seq_file *m, void *v)
+{
+	struct lc_sample s = *(struct lc_sample *)v;
+	int cpu = m->index / LC_RING_SIZE;
+	unsigned int i;
+
+	if (s.type >= LC_NR_TYPES)
+		return 0;
+
+	seq_printf(m, "cpu%d %llu %s %pS wait_ns=%llu pid=%d owner=%d\n",
+		   cpu, s.timestamp, lc_type_names[s.type], (void *)s.lock,
+		   s.wait_ns, s.pid, s.owner_pid);
+	for (i = 0; i < min_t(unsigned int, s.nr_entries, LC_STACK_DEPTH); i++)
+		seq_printf(m, "\t%pS\n", (void *)s.entries[i]);
+
+	return 0;
+}
+
+static const struct seq_operations lc_samples_sops = {
+	.start	= lc_samples_start,
+	.next	= lc_samples_next,
+	.stop	= lc_samples_stop,
+	.show	= lc_samples_show,
+};
+
+static int lc_samples_open(struct inode *inode, struct file *file)
+{
+	return seq_open(file, &lc_samples_sops);
+}
+
+/*
+ * Like the lock event counts, clearing can race with concurrent writers,
+ * it is only meant to start from a clean slate between two measurements.
+ */
+static ssize_t lc_samples_write(struct file *file, const char __user *ubuf,
+				size_t count, loff_t *ppos)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct lc_ring *ring = per_cpu(lc_rings, cpu);
+
+		if (ring)
+			memset(ring, 0, sizeof(*ring));
+	}
+
+	return count;
+}
+
+static const struct file_operations lc_samples_fops = {
+	.open		= lc_samples_open,
+	.read		= seq_read,
+	.write		= lc_samples_write,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
+static int lc_stats_show(struct seq_file *m, void *v)
+{
+	int cpu, type;
+
+	seq_puts(m, "# type sampled wait_ns\n");
+	for (type = 0; type < LC_NR_TYPES; type++) {
+		unsigned long nr = 0;
+		u64 wait = 0;
+
+		for_each_possible_cpu(cpu) {
+			struct lc_ring *ring = per_cpu(lc_rings, cpu);
+
+			if (!ring)
+				continue;
+			nr += READ_ONCE(ring->nr[type]);
+			wait += READ_ONCE(ring->wait_ns[type]);
+		}
+		seq_printf(m, "%s %lu %llu\n", lc_type_names[type], nr, wait);
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(lc_stats);
+
+static ssize_t lc_enable_read(struct file *file, char __user *ubuf,
+			      size_t count, loff_t *ppos)
+{
+	char buf[3] = { lock_contention_enabled() ? '1' : '0', '\n', 0 };
+
+	return simple_read_from_buffer(ubuf, count, ppos, buf, 2);
+}
+
+static ssize_t lc_enable_write(struct file *file, const char __user *ubuf,
+			       size_t count, loff_t *ppos)
+{
+	bool enable;
+	int ret;
+
+	ret = kstrtobool_from_user(ubuf, count, &enable);
+	if (ret)
+		return ret;
+
+	if (enable)
+		static_branch_enable(&lock_contention_key);
+	else
+		static_branch_disable(&lock_contention_key);
+
+	return count;
+}
+
+static const struct file_operations lc_enable_fops = {
+	.read		= lc_enable_read,
+	.write		= lc_enable_write,
+	.llseek		= default_llseek,
+};
+
+static int __init lock_contention_init(void)
+{
+	struct dentry *dir;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct lc_ring *ring;
+
+		ring = kvzalloc_node(sizeof(*ring), GFP_KERNEL, cpu_to_node(cpu));
+		if (!ring)
+			goto fail;
+		per_cpu(lc_rings, cpu) = ring;
+	}
+
+	dir = debugfs_create_dir("lock_contention", NULL);
+	debugfs_create_file("enable", 0600, dir, NULL, &lc_enable_fops);
+	debugfs_create_u32("sample_period", 0600, dir, &lc_sample_period);
+	debugfs_create_u64("min_wait_ns", 0600, dir, &lc_min_wait_ns);
+	debugfs_create_file("stats", 0400, dir, NULL, &lc_stats_fops);
+	debugfs_create_file("samples", 0600, dir, NULL, &lc_samples_fops);
+
+	return 0;
+
+fail:
+	for_each_possible_cpu(cpu) {
+		kvfree(per_cpu(lc_rings, cpu));
+		per_cpu(lc_rings, cpu) = NULL;
+	}
+	pr_warn("lock_contention: could not allocate the sample rings\n");
+	return -ENOMEM;
+}
+fs_initcall(lock_contention_init);
@@ -0,0 +1,78 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Sampled lock contention profiling
+ *
+ * Hooks for the lock slowpaths, see lock_contention.c.
+ */
+
+#ifndef __LOCKING_LOCK_CONTENTION_H
+#define __LOCKING_LOCK_CONTENTION_H
+
+#include <linux/jump_label.h>
+#include <linux/types.h>
+
+struct task_struct;
+
+enum lock_contention_type {
+	LC_SPINLOCK,
+	LC_MUTEX,
+	LC_RWSEM_READ,
+	LC_RWSEM_WRITE,
+	LC_RTMUTEX,
+	LC_NR_TYPES,
+};
+
+/*
+ * On-stack state of one sampled slowpath entry. @start stays 0 when the
+ * entry is not sampled so that the end hook costs a single test.
+ */
+struct lock_contention {
+	u64		start;
+	pid_t		owner_pid;
+};
+
+#ifdef CONFIG_LOCK_CONTENTION_PROFILE
+
+DECLARE_STATIC_KEY_FALSE(lock_contention_key);
+
+void __lock_contention_begin(struct lock_contention *lc,
+			     struct task_struct *owner);
+void __lock_contention_end(struct lock_contention *lc, void *lock,
+			   enum lock_contention_type type);
+
+static __always_inline bool lock_contention_enabled(void)
+{
+	return static_branch_unlikely(&lock_contention_key);
+}
+
+/*
+ * @owner is the lock holder when known, it must be kept from going away by
+ * the caller (RCU read side, preemption disabled or the lock's wait_lock).
+ */
+static __always_inline void
+lock_contention_begin(struct lock_contention *lc, struct task_struct *owner)
+{
+	lc->start = 0;
+	if (lock_contention_enabled())
+		__lock_contention_begin(lc, owner);
+}
+
+/* To be called once the lock has been acquired. */
+static __always_inline void
+lock_contention_end(struct lock_contention *lc, void *lock,
+		    enum lock_contention_type type)
+{
+	if (lc->start)
+		__lock_contention_end(lc, lock, type);
+}
+
+#else /* CONFIG_LOCK_CONTENTION_PROFILE */
+
+static inline bool lock_contention_enabled(void) { return false; }
+static inline void lock_contention_begin(struct lock_contention *lc,
+					 struct task_struct *owner) { }
+static inline void lock_contention_end(struct lock_contention *lc, void *lock,
+				       enum lock_contention_type type) { }
+
+#endif /* CONFIG_LOCK_CONTENTION_PROFILE */
+#endif /* __LOCKING_LOCK_CONTENTION_H */
@@ -67,3 +67,14 @@ LOCK_EVENT(rwsem_rlock_handoff)	/* # of read lock handoffs		*/
 LOCK_EVENT(rwsem_wlock)		/* # of write locks acquired		*/
 LOCK_EVENT(rwsem_wlock_fail)	/* # of failed write lock acquisitions	*/
 LOCK_EVENT(rwsem_wlock_handoff)	/* # of write lock handoffs		*/
+LOCK_EVENT(rwsem_rspin_lock)	/* # of read locks taken after spinning	*/
+LOCK_EVENT(rwsem_rspin_fail)	/* # of reader spins that had to queue	*/
+LOCK_EVENT(rwsem_rspin_skip)	/* # of reader spins skipped as too slow */
+LOCK_EVENT(rwsem_rspin_time)	/* Total time (ns) of reader spinning	*/
+
+/*
+ * Locking events for the optimistic spin queue
+ */
+LOCK_EVENT(osq_lock_fast)	/* # of uncontended osq acquisitions	*/
+LOCK_EVENT(osq_lock_queued)	/* # of osq acquisitions after queueing	*/
+LOCK_EVENT(osq_unqueue)		/* # of spinners that left the osq	*/
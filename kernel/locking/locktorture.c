@@ -660,6 +660,58 @@ static struct lock_torture_ops percpu_rwsem_lock_ops = {
 	.name		= "percpu_rwsem_lock"
 };
 
+#include <linux/percpu-rwlock.h>
+static struct percpu_rwlock pcpu_rwlock;
+
+static void torture_percpu_rwlock_init(void)
+{
+	BUG_ON(percpu_rwlock_init(&pcpu_rwlock));
+}
+
+static void torture_percpu_rwlock_exit(void)
+{
+	percpu_rwlock_free(&pcpu_rwlock);
+}
+
+static int torture_percpu_rwlock_write_lock(int tid __maybe_unused)
+__acquires(pcpu_rwlock)
+{
+	percpu_write_lock(&pcpu_rwlock);
+	return 0;
+}
+
+static void torture_percpu_rwlock_write_unlock(int tid __maybe_unused)
+__releases(pcpu_rwlock)
+{
+	percpu_write_unlock(&pcpu_rwlock);
+}
+
+static int torture_percpu_rwlock_read_lock(int tid __maybe_unused)
+__acquires(pcpu_rwlock)
+{
+	percpu_read_lock(&pcpu_rwlock);
+	return 0;
+}
+
+static void torture_percpu_rwlock_read_unlock(int tid __maybe_unused)
+__releases(pcpu_rwlock)
+{
+	percpu_read_unlock(&pcpu_rwlock);
+}
+
+static struct lock_torture_ops percpu_rwlock_lock_ops = {
+	.init		= torture_percpu_rwlock_init,
+	.exit		= torture_percpu_rwlock_exit,
+	.writelock	= torture_percpu_rwlock_write_lock,
+	.write_delay	= torture_rwlock_write_delay,
+	.task_boost     = torture_boost_dummy,
+	.writeunlock	= torture_percpu_rwlock_write_unlock,
+	.readlock       = torture_percpu_rwlock_read_lock,
+	.read_delay     = torture_rwlock_read_delay,
+	.readunlock     = torture_percpu_rwlock_read_unlock,
+	.name		= "percpu_rwlock"
+};
+
 /*
  * Lock torture writer kthread.  Repeatedly acquires and releases
  * the lock, checking for duplicate acquisitions.
@@ -912,6 +964,7 @@ static int __init lock_torture_init(void)
 #endif
 		&rwsem_lock_ops,
 		&percpu_rwsem_lock_ops,
+		&percpu_rwlock_lock_ops,
 	};
 
 	if (!torture_init_begin(torture_type, verbose))
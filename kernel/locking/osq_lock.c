@@ -3,6 +3,8 @@
 #include <linux/sched.h>
 #include <linux/osq_lock.h>
 
+#include "lock_events.h"
+
 /*
  * An MCS like lock especially tailored for optimistic spinning for sleeping
  * lock implementations (mutex, rwsem, etc).
@@ -105,8 +107,10 @@ bool osq_lock(struct optimistic_spin_queue *lock)
 	 * the lock tail.
 	 */
 	old = atomic_xchg(&lock->tail, curr);
-	if (old == OSQ_UNLOCKED_VAL)
+	if (old == OSQ_UNLOCKED_VAL) {
+		lockevent_inc(osq_lock_fast);
 		return true;
+	}
 
 	prev = decode_cpu(old);
 	node->prev = prev;
@@ -141,10 +145,13 @@ bool osq_lock(struct optimistic_spin_queue *lock)
 	 * polling, be careful.
 	 */
 	if (smp_cond_load_relaxed(&node->locked, VAL || need_resched() ||
-				  vcpu_is_preempted(node_cpu(node->prev))))
+				  vcpu_is_preempted(node_cpu(node->prev)))) {
+		lockevent_inc(osq_lock_queued);
 		return true;
+	}
 
 	/* unqueue */
+	lockevent_inc(osq_unqueue);
 	/*
 	 * Step - A  -- stabilize @prev
 	 *
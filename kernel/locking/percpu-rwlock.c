@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: GPL-2.0-only
+#include <linux/atomic.h>
+#include <linux/percpu.h>
+#include <linux/lockdep.h>
+#include <linux/percpu-rwlock.h>
+#include <linux/export.h>
+#include <linux/errno.h>
+
+int __percpu_rwlock_init(struct percpu_rwlock *lock,
+			 const char *name, struct lock_class_key *key)
+{
+	lock->read_count = alloc_percpu(unsigned int);
+	if (unlikely(!lock->read_count))
+		return -ENOMEM;
+
+	atomic_set(&lock->writer, 0);
+	raw_spin_lock_init(&lock->wait_lock);
+#ifdef CONFIG_DEBUG_LOCK_ALLOC
+	debug_check_no_locks_freed((void *)lock, sizeof(*lock));
+	lockdep_init_map(&lock->dep_map, name, key, 0);
+#endif
+	return 0;
+}
+EXPORT_SYMBOL_GPL(__percpu_rwlock_init);
+
+void percpu_rwlock_free(struct percpu_rwlock *lock)
+{
+	if (!lock->read_count)
+		return;
+
+	free_percpu(lock->read_count);
+	lock->read_count = NULL; /* catch use after free bugs */
+}
+EXPORT_SYMBOL_GPL(percpu_rwlock_free);
+
+/*
+ * A writer is pending or active: wait for it with the caller's interrupt
+ * state restored, as our increment has been undone nobody can be waiting
+ * for us.
+ *
+ * Called and returns with interrupts disabled, @flags are the caller's.
+ */
+void __percpu_read_lock_slowpath(struct percpu_rwlock *lock,
+				 unsigned long flags)
+{
+	do {
+		local_irq_restore(flags);
+		atomic_cond_read_relaxed(&lock->writer, !VAL);
+		local_irq_save(flags);
+	} while (!__percpu_read_trylock(lock));
+}
+EXPORT_SYMBOL_GPL(__percpu_read_lock_slowpath);
+
+#define per_cpu_sum(var)						\
+({									\
+	typeof(var) __sum = 0;						\
+	int cpu;							\
+	compiletime_assert_atomic_type(__sum);				\
+	for_each_possible_cpu(cpu)					\
+		__sum += per_cpu(var, cpu);				\
+	__sum;								\
+})
+
+void percpu_write_lock(struct percpu_rwlock *lock)
+{
+	lock_acquire_exclusive(&lock->dep_map, 0, 0, NULL, _RET_IP_);
+
+	/* Writers queue up on the spinlock, which keeps them in order. */
+	raw_spin_lock(&lock->wait_lock);
+
+	/* Turn new readers away... */
+	atomic_set(&lock->writer, 1);
+	smp_mb(); /* D matches A */
+
+	/*
+	 * ...and wait for the ones already inside. Readers back off within
+	 * a bounded number of instructions, so this only waits for actual
+	 * critical sections.
+	 */
+	while (per_cpu_sum(*lock->read_count))
+		cpu_relax();
+
+	smp_mb(); /* C matches B */
+}
+EXPORT_SYMBOL_GPL(percpu_write_lock);
+
+void percpu_write_unlock(struct percpu_rwlock *lock)
+{
+	lock_release(&lock->dep_map, _RET_IP_);
+
+	/* Release the critical section to the readers spinning on ->writer. */
+	atomic_set_release(&lock->writer, 0);
+	raw_spin_unlock(&lock->wait_lock);
+}
+EXPORT_SYMBOL_GPL(percpu_write_unlock);
@@ -11,7 +11,7 @@
  *          Peter Zijlstra <peterz@infradead.org>
  */
 
-#ifndef _GEN_PV_LOCK_SLOWPATH
+#if !defined(_GEN_PV_LOCK_SLOWPATH) && !defined(_GEN_CNA_LOCK_SLOWPATH)
 
 #include <linux/smp.h>
 #include <linux/bug.h>
@@ -27,6 +27,7 @@
  * Include queued spinlock statistics code
  */
 #include "qspinlock_stat.h"
+#include "lock_contention.h"
 
 /*
  * The basic principle of a queue-based spinlock can best be understood
@@ -83,7 +84,7 @@
  */
 struct qnode {
 	struct mcs_spinlock mcs;
-#ifdef CONFIG_PARAVIRT_SPINLOCKS
+#if defined(CONFIG_PARAVIRT_SPINLOCKS) || defined(CONFIG_NUMA_AWARE_SPINLOCKS)
 	long reserved[2];
 #endif
 };
@@ -320,11 +321,32 @@ static __always_inline u32  __pv_wait_head_or_lock(struct qspinlock *lock,
 #define pv_kick_node		__pv_kick_node
 #define pv_wait_head_or_lock	__pv_wait_head_or_lock
 
-#ifdef CONFIG_PARAVIRT_SPINLOCKS
+/*
+ * Plain MCS handoff at the end of the slowpath: clear the tail if we are the
+ * only waiter, or pass the MCS lock to the next one. NUMA-aware spinlocks
+ * override both to maintain their secondary queue.
+ */
+static __always_inline bool __try_clear_tail(struct qspinlock *lock,
+					     u32 val,
+					     struct mcs_spinlock *node)
+{
+	return atomic_try_cmpxchg_relaxed(&lock->val, &val, _Q_LOCKED_VAL);
+}
+
+static __always_inline void __mcs_lock_handoff(struct mcs_spinlock *node,
+					       struct mcs_spinlock *next)
+{
+	arch_mcs_spin_unlock_contended(&next->locked);
+}
+
+#define try_clear_tail		__try_clear_tail
+#define mcs_lock_handoff	__mcs_lock_handoff
+
+#if defined(CONFIG_PARAVIRT_SPINLOCKS) || defined(CONFIG_NUMA_AWARE_SPINLOCKS)
 #define queued_spin_lock_slowpath	native_queued_spin_lock_slowpath
 #endif
 
-#endif /* _GEN_PV_LOCK_SLOWPATH */
+#endif /* _GEN_PV_LOCK_SLOWPATH || _GEN_CNA_LOCK_SLOWPATH */
 
 /**
  * queued_spin_lock_slowpath - acquire the queued spinlock
@@ -374,11 +396,14 @@ static __always_inline u32  __pv_wait_head_or_lock(struct qspinlock *lock,
 void queued_spin_lock_slowpath(struct qspinlock *lock, u32 val)
 {
 	struct mcs_spinlock *prev, *next, *node;
+	struct lock_contention lc;
 	u32 old, tail;
 	int idx;
 
 	BUILD_BUG_ON(CONFIG_NR_CPUS >= (1U << _Q_TAIL_CPU_BITS));
 
+	lock_contention_begin(&lc, NULL);
+
 /*
  * IAMROOT, 2021.10.09:
  * pv_enabled: 항상 false 리턴.
@@ -501,6 +526,7 @@ void queued_spin_lock_slowpath(struct qspinlock *lock, u32 val)
 	 */
 	clear_pending_set_locked(lock);
 	lockevent_inc(lock_pending);
+	lock_contention_end(&lc, lock, LC_SPINLOCK);
 	return;
 
 	/*
@@ -709,7 +735,7 @@ void queued_spin_lock_slowpath(struct qspinlock *lock, u32 val)
  * - no contention : mcs에서 혼자 존재하다가 lock을 잡으므로 mcs가
  *   비게 되는 상황. 경쟁자 없이 lock 을 잡고 끝.
  */
-		if (atomic_try_cmpxchg_relaxed(&lock->val, &val, _Q_LOCKED_VAL))
+		if (try_clear_tail(lock, val, node))
 			goto release; /* No contention */
 	}
 
@@ -744,7 +770,7 @@ void queued_spin_lock_slowpath(struct qspinlock *lock, u32 val)
  * - 자신은 lock owner가 되서 release가 되므로 자신의 다음 cpu를 unlock
  *   해주는것.
  */
-	arch_mcs_spin_unlock_contended(&next->locked);
+	mcs_lock_handoff(node, next);
 	pv_kick_node(lock, next);
 
 release:
@@ -752,6 +778,7 @@ void queued_spin_lock_slowpath(struct qspinlock *lock, u32 val)
 	 * release the node
 	 */
 	__this_cpu_dec(qnodes[0].mcs.count);
+	lock_contention_end(&lc, lock, LC_SPINLOCK);
 }
 EXPORT_SYMBOL(queued_spin_lock_slowpath);
 
@@ -783,3 +810,43 @@ static __init int parse_nopvspin(char *arg)
 }
 early_param("nopvspin", parse_nopvspin);
 #endif
+
+/*
+ * Generate the code for NUMA-aware spinlocks
+ */
+#if !defined(_GEN_CNA_LOCK_SLOWPATH) && defined(CONFIG_NUMA_AWARE_SPINLOCKS)
+#define _GEN_CNA_LOCK_SLOWPATH
+
+#undef pv_init_node
+#define pv_init_node			cna_init_node
+
+#undef pv_wait_head_or_lock
+#define pv_wait_head_or_lock		cna_wait_head_or_lock
+
+#undef try_clear_tail
+#define try_clear_tail			cna_try_clear_tail
+
+#undef mcs_lock_handoff
+#define mcs_lock_handoff		cna_lock_handoff
+
+#undef  queued_spin_lock_slowpath
+#define queued_spin_lock_slowpath	__cna_queued_spin_lock_slowpath
+
+#include "qspinlock_cna.h"
+#include "qspinlock.c"
+
+#undef  queued_spin_lock_slowpath
+
+/*
+ * There is no paravirt hook to patch on the architectures CNA is available
+ * for, select the slowpath with a static key flipped at boot instead.
+ */
+void queued_spin_lock_slowpath(struct qspinlock *lock, u32 val)
+{
+	if (static_branch_unlikely(&cna_spinlock_key))
+		__cna_queued_spin_lock_slowpath(lock, val);
+	else
+		native_queued_spin_lock_slowpath(lock, val);
+}
+EXPORT_SYMBOL(queued_spin_lock_slowpath);
+#endif
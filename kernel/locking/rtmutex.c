@@ -86,6 +86,7 @@
 #include <linux/ww_mutex.h>
 
 #include "rtmutex_common.h"
+#include "lock_contention.h"
 
 #ifndef WW_RT
 # define build_ww_mutex()	(false)
@@ -1683,6 +1684,7 @@ static int __sched rt_mutex_slowlock(struct rt_mutex_base *lock,
 				     struct ww_acquire_ctx *ww_ctx,
 				     unsigned int state)
 {
+	struct lock_contention lc;
 	unsigned long flags;
 	int ret;
 
@@ -1695,8 +1697,12 @@ static int __sched rt_mutex_slowlock(struct rt_mutex_base *lock,
 	 * irqsave/restore variants.
 	 */
 	raw_spin_lock_irqsave(&lock->wait_lock, flags);
+	/* disabled interrupts keep the owner's task_struct around */
+	lock_contention_begin(&lc, rt_mutex_owner(lock));
 	ret = __rt_mutex_slowlock_locked(lock, ww_ctx, state);
 	raw_spin_unlock_irqrestore(&lock->wait_lock, flags);
+	if (!ret)
+		lock_contention_end(&lc, lock, LC_RTMUTEX);
 
 	return ret;
 }
@@ -30,6 +30,7 @@
 
 #ifndef CONFIG_PREEMPT_RT
 #include "lock_events.h"
+#include "lock_contention.h"
 
 /*
  * The least significant 2 bits of the owner value has the following
@@ -865,6 +866,110 @@ static inline void clear_nonspinnable(struct rw_semaphore *sem)
 		atomic_long_andnot(RWSEM_NONSPINNABLE, &sem->owner);
 }
 
+/*
+ * Upper bound of a reader spin on a running writer. It is also what a failed
+ * spin is accounted as in the per-CPU average below.
+ */
+#define RWSEM_RSPIN_MAX_NS	(20 * NSEC_PER_USEC)
+
+/*
+ * Running average of how long readers on this CPU recently had to spin
+ * before the writer handed the lock over. Once it gets close to the spin
+ * limit, spinning is more likely to burn the time than to save a sleep and
+ * readers go straight to the wait queue. Kept per-CPU, as putting it in the
+ * rwsem would grow every mmap_lock and i_rwsem.
+ */
+static DEFINE_PER_CPU(u32, rwsem_rspin_avg);
+
+static inline void rwsem_rspin_update_avg(u64 delta)
+{
+	u32 avg = this_cpu_read(rwsem_rspin_avg);
+
+	this_cpu_write(rwsem_rspin_avg, avg - (avg >> 3) + ((u32)delta >> 3));
+}
+
+/*
+ * Spin while the rwsem is write-owned by a running writer, with our
+ * RWSEM_READER_BIAS already in the count. Once the writer releases the lock
+ * without setting the handoff bit, no other writer can take it while our bias
+ * is there and the read lock is ours.
+ *
+ * Return: true if the read lock was acquired, with *cntp updated.
+ */
+static bool rwsem_reader_spin(struct rw_semaphore *sem, long *cntp)
+{
+	struct task_struct *owner;
+	unsigned long flags;
+	bool taken = false;
+	u64 start, delta;
+	int loop = 0;
+	long count;
+
+	if (need_resched() || rt_task(current))
+		return false;
+
+	if (this_cpu_read(rwsem_rspin_avg) > RWSEM_RSPIN_MAX_NS / 2) {
+		/*
+		 * Decay the average so that spinning is tried again once
+		 * in a while, hand-off latency may have improved.
+		 */
+		rwsem_rspin_update_avg(0);
+		lockevent_inc(rwsem_rspin_skip);
+		return false;
+	}
+
+	preempt_disable();
+	rcu_read_lock();
+	owner = rwsem_owner_flags(sem, &flags);
+	if (rwsem_owner_state(owner, flags) != OWNER_WRITER ||
+	    !owner_on_cpu(owner)) {
+		rcu_read_unlock();
+		preempt_enable();
+		return false;
+	}
+
+	start = sched_clock();
+	for (;;) {
+		count = atomic_long_read(&sem->count);
+		if (!(count & (RWSEM_WRITER_LOCKED | RWSEM_FLAG_HANDOFF))) {
+			/* Provide lock ACQUIRE */
+			smp_acquire__after_ctrl_dep();
+			taken = true;
+			break;
+		}
+
+		if (count & RWSEM_FLAG_HANDOFF)
+			break;
+
+		/* Leave once the writer we spin on stops running or goes. */
+		if (rwsem_owner_flags(sem, &flags) != owner ||
+		    need_resched() || !owner_on_cpu(owner))
+			break;
+
+		if (!(++loop & 0xf) &&
+		    sched_clock() - start > RWSEM_RSPIN_MAX_NS)
+			break;
+
+		cpu_relax();
+	}
+	rcu_read_unlock();
+
+	delta = sched_clock() - start;
+	rwsem_rspin_update_avg(taken ? min_t(u64, delta, RWSEM_RSPIN_MAX_NS) :
+				       RWSEM_RSPIN_MAX_NS);
+	preempt_enable();
+
+	lockevent_add(rwsem_rspin_time, delta);
+	if (taken) {
+		lockevent_inc(rwsem_rspin_lock);
+		*cntp = count;
+	} else {
+		lockevent_inc(rwsem_rspin_fail);
+	}
+
+	return taken;
+}
+
 #else
 static inline bool rwsem_can_spin_on_owner(struct rw_semaphore *sem)
 {
@@ -878,6 +983,11 @@ static inline bool rwsem_optimistic_spin(struct rw_semaphore *sem)
 
 static inline void clear_nonspinnable(struct rw_semaphore *sem) { }
 
+static inline bool rwsem_reader_spin(struct rw_semaphore *sem, long *cntp)
+{
+	return false;
+}
+
 static inline int
 rwsem_spin_on_owner(struct rw_semaphore *sem)
 {
@@ -908,9 +1018,12 @@ rwsem_down_read_slowpath(struct rw_semaphore *sem, long count, unsigned int stat
 		goto queue;
 
 	/*
-	 * Reader optimistic lock stealing.
+	 * Reader optimistic lock stealing, either right away or after
+	 * spinning on a running writer owner.
 	 */
-	if (!(count & (RWSEM_WRITER_LOCKED | RWSEM_FLAG_HANDOFF))) {
+	if (!(count & (RWSEM_WRITER_LOCKED | RWSEM_FLAG_HANDOFF)) ||
+	    rwsem_reader_spin(sem, &count)) {
+		rcnt = count >> RWSEM_READER_SHIFT;
 		rwsem_set_reader_owned(sem);
 		lockevent_inc(rwsem_rlock_steal);
 
@@ -1203,16 +1316,40 @@ static struct rw_semaphore *rwsem_downgrade_wake(struct rw_semaphore *sem)
 	return sem;
 }
 
+/*
+ * Only a writer owner is known to be alive, the owner field of a reader
+ * owned rwsem is just a hint and may point to a task that has exited.
+ */
+static inline void rwsem_contention_begin(struct rw_semaphore *sem,
+					  struct lock_contention *lc)
+{
+	struct task_struct *owner;
+	unsigned long flags;
+
+	if (!lock_contention_enabled()) {
+		lc->start = 0;
+		return;
+	}
+
+	rcu_read_lock();
+	owner = rwsem_owner_flags(sem, &flags);
+	lock_contention_begin(lc, (flags & RWSEM_READER_OWNED) ? NULL : owner);
+	rcu_read_unlock();
+}
+
 /*
  * lock for reading
  */
 static inline int __down_read_common(struct rw_semaphore *sem, int state)
 {
+	struct lock_contention lc;
 	long count;
 
 	if (!rwsem_read_trylock(sem, &count)) {
+		rwsem_contention_begin(sem, &lc);
 		if (IS_ERR(rwsem_down_read_slowpath(sem, count, state)))
 			return -EINTR;
+		lock_contention_end(&lc, sem, LC_RWSEM_READ);
 		DEBUG_RWSEMS_WARN_ON(!is_rwsem_reader_owned(sem), sem);
 	}
 	return 0;
@@ -1258,9 +1395,13 @@ static inline int __down_read_trylock(struct rw_semaphore *sem)
  */
 static inline int __down_write_common(struct rw_semaphore *sem, int state)
 {
+	struct lock_contention lc;
+
 	if (unlikely(!rwsem_write_trylock(sem))) {
+		rwsem_contention_begin(sem, &lc);
 		if (IS_ERR(rwsem_down_write_slowpath(sem, state)))
 			return -EINTR;
+		lock_contention_end(&lc, sem, LC_RWSEM_WRITE);
 	}
 
 	return 0;
@@ -55,6 +55,8 @@
 #include <linux/jump_label.h>
 #include <linux/pfn.h>
 #include <linux/bsearch.h>
+#include <linux/hashtable.h>
+#include <linux/stringhash.h>
 #include <linux/dynamic_debug.h>
 #include <linux/audit.h>
 #include <uapi/linux/module.h>
@@ -510,6 +512,93 @@ static bool find_exported_symbol_in_section(const struct symsearch *syms,
 	return false;
 }
 
+/*
+ * The exported symbols of all formed modules, hashed by name, so that
+ * resolving the undefined symbols of a module doesn't search the exports
+ * of every loaded module in turn.  Changed under module_mutex, and read
+ * under it or with preemption disabled, like the module list.
+ */
+struct mod_symbol {
+	struct hlist_node node;
+	struct module *owner;
+	unsigned int symnum;
+	bool gpl;
+};
+
+#define MOD_SYMHASH_BITS	12
+static DEFINE_HASHTABLE(mod_symhash, MOD_SYMHASH_BITS);
+
+static u32 mod_symhash_key(const char *name)
+{
+	return full_name_hash(NULL, name, strlen(name));
+}
+
+static void mod_symbol_search(const struct mod_symbol *ms,
+			      struct symsearch *syms)
+{
+	struct module *mod = ms->owner;
+
+	if (ms->gpl) {
+		syms->start = mod->gpl_syms;
+		syms->stop = mod->gpl_syms + mod->num_gpl_syms;
+		syms->crcs = mod->gpl_crcs;
+		syms->license = GPL_ONLY;
+	} else {
+		syms->start = mod->syms;
+		syms->stop = mod->syms + mod->num_syms;
+		syms->crcs = mod->crcs;
+		syms->license = NOT_GPL_ONLY;
+	}
+}
+
+/* Called with module_mutex held, once the exports have been verified. */
+static int mod_symhash_add(struct module *mod)
+{
+	unsigned int i, nr = mod->num_syms + mod->num_gpl_syms;
+	struct mod_symbol *ms;
+	struct symsearch syms;
+
+	if (!nr)
+		return 0;
+
+	ms = kvmalloc_array(nr, sizeof(*ms), GFP_KERNEL);
+	if (!ms)
+		return -ENOMEM;
+
+	for (i = 0; i < nr; i++) {
+		ms[i].owner = mod;
+		ms[i].gpl = i >= mod->num_syms;
+		ms[i].symnum = ms[i].gpl ? i - mod->num_syms : i;
+		mod_symbol_search(&ms[i], &syms);
+		hash_add_rcu(mod_symhash, &ms[i].node,
+			     mod_symhash_key(kernel_symbol_name(
+					&syms.start[ms[i].symnum])));
+	}
+	mod->symhash = ms;
+	return 0;
+}
+
+/*
+ * Called with module_mutex held.  The entries may only be freed with
+ * mod_symhash_free() after a grace period.
+ */
+static void mod_symhash_del(struct module *mod)
+{
+	unsigned int i;
+
+	if (!mod->symhash)
+		return;
+
+	for (i = 0; i < mod->num_syms + mod->num_gpl_syms; i++)
+		hash_del_rcu(&mod->symhash[i].node);
+}
+
+static void mod_symhash_free(struct module *mod)
+{
+	kvfree(mod->symhash);
+	mod->symhash = NULL;
+}
+
 /*
  * Find an exported symbol and return it, along with, (optional) crc and
  * (optional) module which owns it.  Needs preempt disabled or module_mutex.
@@ -523,7 +612,8 @@ static bool find_symbol(struct find_symbol_arg *fsa)
 		  __start___kcrctab_gpl,
 		  GPL_ONLY },
 	};
-	struct module *mod;
+	struct symsearch syms;
+	struct mod_symbol *ms;
 	unsigned int i;
 
 	module_assert_mutex_or_preempt();
@@ -532,22 +622,19 @@ static bool find_symbol(struct find_symbol_arg *fsa)
 		if (find_exported_symbol_in_section(&arr[i], NULL, fsa))
 			return true;
 
-	list_for_each_entry_rcu(mod, &modules, list,
-				lockdep_is_held(&module_mutex)) {
-		struct symsearch arr[] = {
-			{ mod->syms, mod->syms + mod->num_syms, mod->crcs,
-			  NOT_GPL_ONLY },
-			{ mod->gpl_syms, mod->gpl_syms + mod->num_gpl_syms,
-			  mod->gpl_crcs,
-			  GPL_ONLY },
-		};
+	hash_for_each_possible_rcu(mod_symhash, ms, node,
+				   mod_symhash_key(fsa->name),
+				   lockdep_is_held(&module_mutex)) {
+		if (ms->owner->state == MODULE_STATE_UNFORMED)
+			continue;
 
-		if (mod->state == MODULE_STATE_UNFORMED)
+		mod_symbol_search(ms, &syms);
+		if (strcmp(fsa->name,
+			   kernel_symbol_name(&syms.start[ms->symnum])))
 			continue;
 
-		for (i = 0; i < ARRAY_SIZE(arr); i++)
-			if (find_exported_symbol_in_section(&arr[i], mod, fsa))
-				return true;
+		if (check_exported_symbol(&syms, ms->owner, ms->symnum, fsa))
+			return true;
 	}
 
 	pr_debug("Failed to find symbol %s\n", fsa->name);
@@ -2193,11 +2280,13 @@ static void free_module(struct module *mod)
 	/* Unlink carefully: kallsyms could be walking list. */
 	list_del_rcu(&mod->list);
 	mod_tree_remove(mod);
+	mod_symhash_del(mod);
 	/* Remove this module from bug list, this uses list_del_rcu */
 	module_bug_cleanup(mod);
 	/* Wait for RCU-sched synchronizing before releasing mod->list and buglist. */
 	synchronize_rcu();
 	mutex_unlock(&module_mutex);
+	mod_symhash_free(mod);
 
 	/* Clean up CFI for the module. */
 	cfi_cleanup(mod);
@@ -3853,6 +3942,10 @@ static int complete_formation(struct module *mod, struct load_info *info)
 	if (err < 0)
 		goto out;
 
+	err = mod_symhash_add(mod);
+	if (err < 0)
+		goto out;
+
 	/* This relies on module_mutex for list integrity. */
 	module_bug_finalize(info->hdr, info->sechdrs, mod);
 
@@ -4131,10 +4224,12 @@ static int load_module(struct load_info *info, const char __user *uargs,
 	/* Unlink carefully: kallsyms could be walking list. */
 	list_del_rcu(&mod->list);
 	mod_tree_remove(mod);
+	mod_symhash_del(mod);
 	wake_up_all(&module_wq);
 	/* Wait for RCU-sched synchronizing before releasing mod->list. */
 	synchronize_rcu();
 	mutex_unlock(&module_mutex);
+	mod_symhash_free(mod);
  free_module:
 	/* Free lock-classes; relies on the preceding sync_rcu() */
 	lockdep_free_key_range(mod->core_layout.base, mod->core_layout.size);
@@ -17,8 +17,10 @@
 #include <linux/err.h>
 #include <linux/cpu.h>
 #include <linux/padata.h>
+#include <linux/memcontrol.h>
 #include <linux/mutex.h>
 #include <linux/sched.h>
+#include <linux/sched/mm.h>
 #include <linux/slab.h>
 #include <linux/sysfs.h>
 #include <linux/rcupdate.h>
@@ -42,10 +44,12 @@ struct padata_mt_job_state {
 	int			nworks;
 	int			nworks_fini;
 	unsigned long		chunk_size;
+	struct mem_cgroup	*memcg;
+	long			nice;
 };
 
 static void padata_free_pd(struct parallel_data *pd);
-static void __init padata_mt_helper(struct work_struct *work);
+static void padata_mt_helper(struct work_struct *work);
 
 static int padata_index_to_cpu(struct parallel_data *pd, int cpu_index)
 {
@@ -93,8 +97,8 @@ static void padata_work_init(struct padata_work *pw, work_func_t work_fn,
 	pw->pw_data = data;
 }
 
-static int __init padata_work_alloc_mt(int nworks, void *data,
-				       struct list_head *head)
+static int padata_work_alloc_mt(int nworks, void *data,
+				struct list_head *head)
 {
 	int i;
 
@@ -119,7 +123,7 @@ static void padata_work_free(struct padata_work *pw)
 	list_add(&pw->pw_list, &padata_free_works);
 }
 
-static void __init padata_works_free(struct list_head *works)
+static void padata_works_free(struct list_head *works)
 {
 	struct padata_work *cur, *next;
 
@@ -425,13 +429,23 @@ static int padata_setup_cpumasks(struct padata_instance *pinst)
 	return err;
 }
 
-static void __init padata_mt_helper(struct work_struct *w)
+static void padata_mt_helper(struct work_struct *w)
 {
 	struct padata_work *pw = container_of(w, struct padata_work, pw_work);
 	struct padata_mt_job_state *ps = pw->pw_data;
 	struct padata_mt_job *job = ps->job;
+	struct mem_cgroup *old_memcg;
+	long old_nice = task_nice(current);
 	bool done;
 
+	/*
+	 * Helpers work on behalf of the caller: charge what they allocate to
+	 * its memcg and don't let them run at a better priority than it does.
+	 */
+	old_memcg = set_active_memcg(ps->memcg);
+	if (ps->nice > old_nice)
+		set_user_nice(current, ps->nice);
+
 	spin_lock(&ps->lock);
 
 	while (job->size > 0) {
@@ -455,6 +469,10 @@ static void __init padata_mt_helper(struct work_struct *w)
 	done = (ps->nworks_fini == ps->nworks);
 	spin_unlock(&ps->lock);
 
+	if (task_nice(current) != old_nice)
+		set_user_nice(current, old_nice);
+	set_active_memcg(old_memcg);
+
 	if (done)
 		complete(&ps->completion);
 }
@@ -464,15 +482,23 @@ static void __init padata_mt_helper(struct work_struct *w)
  * @job: Description of the job.
  *
  * See the definition of struct padata_mt_job for more details.
+ *
+ * After boot, the job gets no more threads than the CPUs the caller may
+ * run on, which bounds what a task in a cpuset can take, and the helpers
+ * charge the caller's memcg and run at its nice level. Helpers come from
+ * a pool of one per possible CPU shared by all jobs; once it is used up,
+ * jobs run with the helpers that are left, down to the caller alone.
+ * Must be called from a context that can sleep.
  */
-void __init padata_do_multithreaded(struct padata_mt_job *job)
+void padata_do_multithreaded(struct padata_mt_job *job)
 {
 	/* In case threads finish at different times. */
 	static const unsigned long load_balance_factor = 4;
+	static atomic_t last_used_nid = ATOMIC_INIT(NUMA_NO_NODE);
 	struct padata_work my_work, *pw;
 	struct padata_mt_job_state ps;
 	LIST_HEAD(works);
-	int nworks;
+	int nworks, nid;
 
 	if (job->size == 0)
 		return;
@@ -480,6 +506,8 @@ void __init padata_do_multithreaded(struct padata_mt_job *job)
 	/* Ensure at least one thread when size < min_chunk. */
 	nworks = max(job->size / job->min_chunk, 1ul);
 	nworks = min(nworks, job->max_threads);
+	if (system_state == SYSTEM_RUNNING)
+		nworks = min_t(int, nworks, current->nr_cpus_allowed);
 
 	if (nworks == 1) {
 		/* Single thread, no coordination needed, cut to the chase. */
@@ -492,6 +520,8 @@ void __init padata_do_multithreaded(struct padata_mt_job *job)
 	ps.job	       = job;
 	ps.nworks      = padata_work_alloc_mt(nworks, &ps, &works);
 	ps.nworks_fini = 0;
+	ps.memcg       = get_mem_cgroup_from_mm(NULL);
+	ps.nice        = task_nice(current);
 
 	/*
 	 * Chunk size is the amount of work a helper does per call to the
@@ -503,8 +533,20 @@ void __init padata_do_multithreaded(struct padata_mt_job *job)
 	ps.chunk_size = max(ps.chunk_size, job->min_chunk);
 	ps.chunk_size = roundup(ps.chunk_size, job->align);
 
-	list_for_each_entry(pw, &works, pw_list)
-		queue_work(system_unbound_wq, &pw->pw_work);
+	list_for_each_entry(pw, &works, pw_list) {
+		if (job->numa_aware) {
+			int old_node = atomic_read(&last_used_nid);
+
+			/* Spread the helpers over the nodes that have CPUs. */
+			do {
+				nid = next_node_in(old_node, node_states[N_CPU]);
+			} while (!atomic_try_cmpxchg(&last_used_nid, &old_node,
+						     nid));
+			queue_work_node(nid, system_unbound_wq, &pw->pw_work);
+		} else {
+			queue_work(system_unbound_wq, &pw->pw_work);
+		}
+	}
 
 	/* Use the current thread, which saves starting a workqueue worker. */
 	padata_work_init(&my_work, padata_mt_helper, &ps, PADATA_WORK_ONSTACK);
@@ -515,6 +557,7 @@ void __init padata_do_multithreaded(struct padata_mt_job *job)
 
 	destroy_work_on_stack(&my_work.pw_work);
 	padata_works_free(&works);
+	mem_cgroup_put(ps.memcg);
 }
 
 static void __padata_list_init(struct padata_list *pd_list)
@@ -47,6 +47,8 @@
 #include <linux/sched/clock.h>
 #include <linux/sched/debug.h>
 #include <linux/sched/task_stack.h>
+#include <linux/kthread.h>
+#include <linux/panic.h>
 
 #include <linux/uaccess.h>
 #include <asm/sections.h>
@@ -2276,6 +2278,59 @@ int vprintk_store(int facility, int level,
 	return ret;
 }
 
+/*
+ * Once the printer thread is running, printk() callers only store their
+ * message and leave writing it to the consoles to that thread, so that a
+ * log storm keeps one thread busy instead of stalling every CPU that logs
+ * behind slow serial consoles.  Printing is direct again while oopsing or
+ * panicking and once the system is going down, so that the last messages
+ * make it out.
+ */
+static bool printk_console_offload = true;
+module_param_named(console_offload, printk_console_offload, bool, 0644);
+
+static struct task_struct *printk_kthread __read_mostly;
+static DECLARE_WAIT_QUEUE_HEAD(printk_kthread_wait);
+static bool printk_kthread_pending;
+
+static bool printk_should_offload(void)
+{
+	return READ_ONCE(printk_kthread) &&
+	       READ_ONCE(printk_console_offload) &&
+	       !oops_in_progress &&
+	       atomic_read(&panic_cpu) == PANIC_CPU_INVALID &&
+	       system_state == SYSTEM_RUNNING;
+}
+
+static int printk_kthread_func(void *unused)
+{
+	for (;;) {
+		wait_event_interruptible(printk_kthread_wait,
+					 READ_ONCE(printk_kthread_pending));
+		WRITE_ONCE(printk_kthread_pending, false);
+
+		/* Flushes everything stored so far, rescheduling as needed */
+		console_lock();
+		console_unlock();
+	}
+
+	return 0;
+}
+
+static int __init printk_kthread_init(void)
+{
+	struct task_struct *tsk;
+
+	tsk = kthread_run(printk_kthread_func, NULL, "printk");
+	if (IS_ERR(tsk)) {
+		pr_err("printk: failed to start printer thread\n");
+		return PTR_ERR(tsk);
+	}
+	WRITE_ONCE(printk_kthread, tsk);
+	return 0;
+}
+late_initcall(printk_kthread_init);
+
 asmlinkage int vprintk_emit(int facility, int level,
 			    const struct dev_printk_info *dev_info,
 			    const char *fmt, va_list args)
@@ -2297,8 +2352,13 @@ asmlinkage int vprintk_emit(int facility, int level,
 
 	printed_len = vprintk_store(facility, level, dev_info, fmt, args);
 
-	/* If called from the scheduler, we can not call up(). */
-	if (!in_sched) {
+	/*
+	 * If called from the scheduler, we can not call up(), and
+	 * vprintk_deferred() defers the output itself.
+	 */
+	if (!in_sched && printk_should_offload()) {
+		defer_console_output();
+	} else if (!in_sched) {
 		/*
 		 * Disable preemption to avoid being preempted while holding
 		 * console_sem which would prevent anyone from printing to
@@ -3286,9 +3346,13 @@ static void wake_up_klogd_work_func(struct irq_work *irq_work)
 	int pending = __this_cpu_xchg(printk_pending, 0);
 
 	if (pending & PRINTK_PENDING_OUTPUT) {
-		/* If trylock fails, someone else is doing the printing */
-		if (console_trylock())
+		if (printk_should_offload()) {
+			WRITE_ONCE(printk_kthread_pending, true);
+			wake_up_interruptible(&printk_kthread_wait);
+		} else if (console_trylock()) {
+			/* If trylock fails, someone else is printing */
 			console_unlock();
+		}
 	}
 
 	if (pending & PRINTK_PENDING_WAKEUP)
@@ -62,6 +62,7 @@
 #include <linux/vmalloc.h>
 #include <linux/mm.h>
 #include <linux/kasan.h>
+#include <linux/sort.h>
 #include "../time/tick-internal.h"
 
 #include "tree.h"
@@ -222,6 +223,12 @@ module_param(rcu_unlock_delay, int, 0444);
 static int rcu_min_cached_objs = 5;
 module_param(rcu_min_cached_objs, int, 0444);
 
+// The per-CPU page cache grows from rcu_min_cached_objs up to this many
+// pages when kvfree_rcu() blocks are consumed faster than they come back
+// from the batches in flight, and shrinks back when the rate drops.
+static int rcu_max_cached_objs = 64;
+module_param(rcu_max_cached_objs, int, 0444);
+
 // A page shrinker can ask for pages to be freed to make them
 // available for other parts of the system. This usually happens
 // under low memory conditions, and in that case we should also
@@ -3633,7 +3640,7 @@ static void check_cb_ovld(struct rcu_data *rdp)
  * - cb가 쌓여있으면 accelate, gp start 요청
  */
 static void
-__call_rcu(struct rcu_head *head, rcu_callback_t func)
+__call_rcu(struct rcu_head *head, rcu_callback_t func, bool lazy)
 {
 	static atomic_t doublefrees;
 	unsigned long flags;
@@ -3687,7 +3694,7 @@ __call_rcu(struct rcu_head *head, rcu_callback_t func)
  * IAMROOT, 2023.07.22:
  * - nocb인경우 return이거나 lock을 올수도있다. 기본값을 nocb를 사용안한다.
  */
-	if (rcu_nocb_try_bypass(rdp, head, &was_alldone, flags))
+	if (rcu_nocb_try_bypass(rdp, head, &was_alldone, flags, lazy))
 		return; // Enqueued onto ->nocb_bypass, so just leave.
 	// If no-CBs CPU gets here, rcu_nocb_try_bypass() acquired ->nocb_lock.
 	rcu_segcblist_enqueue(&rdp->cblist, head);
@@ -3793,10 +3800,33 @@ __call_rcu(struct rcu_head *head, rcu_callback_t func)
  */
 void call_rcu(struct rcu_head *head, rcu_callback_t func)
 {
-	__call_rcu(head, func);
+	__call_rcu(head, func, false);
 }
 EXPORT_SYMBOL_GPL(call_rcu);
 
+#ifdef CONFIG_RCU_LAZY
+/**
+ * call_rcu_lazy() - Queue a callback that is in no hurry to be invoked.
+ * @head: structure to be used for queueing the RCU updates.
+ * @func: actual callback function to be invoked after the grace period
+ *
+ * Like call_rcu(), but on CPUs whose callbacks are offloaded the callback
+ * may be batched for up to rcu_nocb.jiffies_till_flush before a grace
+ * period is started for it, so that an otherwise idle system is not woken
+ * up for it.  Callbacks are flushed earlier if enough of them pile up,
+ * when a non-lazy callback needs a grace period anyway, by rcu_barrier()
+ * and under memory pressure.
+ *
+ * Only use this for callbacks that nobody waits on, such as freeing
+ * memory that is not needed back urgently.
+ */
+void call_rcu_lazy(struct rcu_head *head, rcu_callback_t func)
+{
+	__call_rcu(head, func, true);
+}
+EXPORT_SYMBOL_GPL(call_rcu_lazy);
+#endif
+
 
 /* Maximum number of jiffies to wait before draining a batch. */
 #define KFREE_DRAIN_JIFFIES (HZ / 50)
@@ -3858,6 +3888,8 @@ struct kfree_rcu_cpu_work {
  * @work_in_progress: Indicates that page_cache_work is running
  * @hrtimer: A hrtimer for scheduling a page_cache_work
  * @nr_bkv_objs: number of allocated objects at @bkvcache.
+ * @nr_bkv_target: current size limit of @bkvcache
+ * @nr_bkv_used: blocks needed since the last batch was started
  *
  * This is a per-CPU structure.  The reason that it is not included in
  * the rcu_data structure is to permit this code to be extracted from
@@ -3881,6 +3913,8 @@ struct kfree_rcu_cpu {
 
 	struct llist_head bkvcache;
 	int nr_bkv_objs;
+	int nr_bkv_target;
+	int nr_bkv_used;
 };
 
 static DEFINE_PER_CPU(struct kfree_rcu_cpu, krc) = {
@@ -3932,7 +3966,7 @@ put_cached_bnode(struct kfree_rcu_cpu *krcp,
 	struct kvfree_rcu_bulk_data *bnode)
 {
 	// Check the limit.
-	if (krcp->nr_bkv_objs >= rcu_min_cached_objs)
+	if (krcp->nr_bkv_objs >= krcp->nr_bkv_target)
 		return false;
 
 	llist_add((struct llist_node *) bnode, &krcp->bkvcache);
@@ -3950,6 +3984,7 @@ drain_page_cache(struct kfree_rcu_cpu *krcp)
 	raw_spin_lock_irqsave(&krcp->lock, flags);
 	page_list = llist_del_all(&krcp->bkvcache);
 	WRITE_ONCE(krcp->nr_bkv_objs, 0);
+	WRITE_ONCE(krcp->nr_bkv_target, rcu_min_cached_objs);
 	raw_spin_unlock_irqrestore(&krcp->lock, flags);
 
 	llist_for_each_safe(pos, n, page_list) {
@@ -3960,6 +3995,47 @@ drain_page_cache(struct kfree_rcu_cpu *krcp)
 	return freed;
 }
 
+/*
+ * Resize the page cache to the number of blocks the last drain period
+ * needed: grow to it right away, shrink towards it by a quarter of the
+ * difference per batch so that a short lull does not throw pages away
+ * that a burst needs back. Under memory pressure stay at the minimum.
+ * Cached pages above the new size are handed back through @trim.
+ */
+static void
+kfree_rcu_update_cache_target(struct kfree_rcu_cpu *krcp,
+			      struct llist_node **trim)
+{
+	int used = krcp->nr_bkv_used;
+	int target = krcp->nr_bkv_target;
+
+	krcp->nr_bkv_used = 0;
+	if (atomic_read(&krcp->backoff_page_cache_fill))
+		target = rcu_min_cached_objs;
+	else if (used > target)
+		target = used;
+	else
+		target -= (target - used) / 4;
+	target = clamp(target, rcu_min_cached_objs, rcu_max_cached_objs);
+	WRITE_ONCE(krcp->nr_bkv_target, target);
+
+	while (krcp->nr_bkv_objs > target) {
+		struct llist_node *page = llist_del_first(&krcp->bkvcache);
+
+		page->next = *trim;
+		*trim = page;
+		WRITE_ONCE(krcp->nr_bkv_objs, krcp->nr_bkv_objs - 1);
+	}
+}
+
+static int kfree_rcu_ptr_cmp(const void *a, const void *b)
+{
+	unsigned long pa = *(unsigned long *)a;
+	unsigned long pb = *(unsigned long *)b;
+
+	return pa < pb ? -1 : pa > pb;
+}
+
 /*
  * This function is invoked in workqueue context after a grace period.
  * It frees all the objects queued on ->bkvhead_free or ->head_free.
@@ -4001,6 +4077,12 @@ static void kfree_rcu_work(struct work_struct *work)
 					rcu_state.name, bkvhead[i]->nr_records,
 					bkvhead[i]->records);
 
+				// Sorting puts objects of the same slab, and so
+				// of the same node, next to each other, letting
+				// kfree_bulk() give them back one slab at a time
+				// rather than in short runs.
+				sort(bkvhead[i]->records, bkvhead[i]->nr_records,
+				     sizeof(void *), kfree_rcu_ptr_cmp, NULL);
 				kfree_bulk(bkvhead[i]->nr_records,
 					bkvhead[i]->records);
 			} else { // vmalloc() / vfree().
@@ -4057,6 +4139,7 @@ static void kfree_rcu_monitor(struct work_struct *work)
 {
 	struct kfree_rcu_cpu *krcp = container_of(work,
 		struct kfree_rcu_cpu, monitor_work.work);
+	struct llist_node *trim = NULL, *pos, *n;
 	unsigned long flags;
 	int i, j;
 
@@ -4091,6 +4174,7 @@ static void kfree_rcu_monitor(struct work_struct *work)
 			}
 
 			WRITE_ONCE(krcp->count, 0);
+			kfree_rcu_update_cache_target(krcp, &trim);
 
 			// One work is per one batch, so there are three
 			// "free channels", the batch can handle. It can
@@ -4112,6 +4196,9 @@ static void kfree_rcu_monitor(struct work_struct *work)
 		schedule_delayed_work(&krcp->monitor_work, KFREE_DRAIN_JIFFIES);
 
 	raw_spin_unlock_irqrestore(&krcp->lock, flags);
+
+	llist_for_each_safe(pos, n, trim)
+		free_page((unsigned long)pos);
 }
 
 static enum hrtimer_restart
@@ -4136,7 +4223,7 @@ static void fill_page_cache_func(struct work_struct *work)
 	int i;
 
 	nr_pages = atomic_read(&krcp->backoff_page_cache_fill) ?
-		1 : rcu_min_cached_objs;
+		1 : READ_ONCE(krcp->nr_bkv_target);
 
 	for (i = 0; i < nr_pages; i++) {
 		bnode = (struct kvfree_rcu_bulk_data *)
@@ -4197,6 +4284,7 @@ add_ptr_to_bulk_krc_lock(struct kfree_rcu_cpu **krcp,
 	/* Check if a new block is required. */
 	if (!(*krcp)->bkvhead[idx] ||
 			(*krcp)->bkvhead[idx]->nr_records == KVFREE_BULK_MAX_ENTR) {
+		(*krcp)->nr_bkv_used++;
 		bnode = get_cached_bnode(*krcp);
 		if (!bnode && can_alloc) {
 			krc_this_cpu_unlock(*krcp, *flags);
@@ -4738,12 +4826,21 @@ static void rcu_barrier_func(void *cpu_in)
 {
 	uintptr_t cpu = (uintptr_t)cpu_in;
 	struct rcu_data *rdp = per_cpu_ptr(&rcu_data, cpu);
+	bool was_alldone, wake_nocb;
 
 	rcu_barrier_trace(TPS("IRQ"), -1, rcu_state.barrier_sequence);
 	rdp->barrier_head.func = rcu_barrier_callback;
 	debug_rcu_head_queue(&rdp->barrier_head);
 	rcu_nocb_lock(rdp);
-	WARN_ON_ONCE(!rcu_nocb_flush_bypass(rdp, NULL, jiffies));
+	/*
+	 * Flush the bypass and wake the GP kthread if this moved callbacks
+	 * onto an empty ->cblist, rather than waiting for a lazy timer that
+	 * may be seconds away.
+	 */
+	was_alldone = rcu_rdp_is_offloaded(rdp) &&
+		      !rcu_segcblist_pend_cbs(&rdp->cblist);
+	WARN_ON_ONCE(!rcu_nocb_flush_bypass(rdp, NULL, jiffies, false));
+	wake_nocb = was_alldone && rcu_segcblist_pend_cbs(&rdp->cblist);
 	if (rcu_segcblist_entrain(&rdp->cblist, &rdp->barrier_head)) {
 		atomic_inc(&rcu_state.barrier_cpu_count);
 	} else {
@@ -4752,6 +4849,8 @@ static void rcu_barrier_func(void *cpu_in)
 				  rcu_state.barrier_sequence);
 	}
 	rcu_nocb_unlock(rdp);
+	if (wake_nocb)
+		wake_nocb_gp(rdp, false);
 }
 
 /**
@@ -5148,7 +5247,7 @@ void rcutree_migrate_callbacks(int cpu)
 	my_rdp = this_cpu_ptr(&rcu_data);
 	my_rnp = my_rdp->mynode;
 	rcu_nocb_lock(my_rdp); /* irqs already disabled. */
-	WARN_ON_ONCE(!rcu_nocb_flush_bypass(my_rdp, NULL, jiffies));
+	WARN_ON_ONCE(!rcu_nocb_flush_bypass(my_rdp, NULL, jiffies, false));
 	raw_spin_lock_rcu_node(my_rnp); /* irqs already disabled. */
 	/* Leverage recent GPs and set GP for new callbacks. */
 	needwake = rcu_advance_cbs(my_rnp, rdp) ||
@@ -5484,6 +5583,12 @@ static void __init kfree_rcu_batch_init(void)
 			rcu_delay_page_cache_fill_msec);
 	}
 
+	if (rcu_max_cached_objs < rcu_min_cached_objs) {
+		rcu_max_cached_objs = rcu_min_cached_objs;
+		pr_info("Adjusting rcutree.rcu_max_cached_objs to %d.\n",
+			rcu_max_cached_objs);
+	}
+
 	for_each_possible_cpu(cpu) {
 		struct kfree_rcu_cpu *krcp = per_cpu_ptr(&krc, cpu);
 
@@ -5494,6 +5599,7 @@ static void __init kfree_rcu_batch_init(void)
 
 		INIT_DELAYED_WORK(&krcp->monitor_work, kfree_rcu_monitor);
 		INIT_DELAYED_WORK(&krcp->page_cache_work, fill_page_cache_func);
+		krcp->nr_bkv_target = rcu_min_cached_objs;
 		krcp->initialized = true;
 	}
 	if (register_shrinker(&kfree_rcu_shrinker))
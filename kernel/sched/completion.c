@@ -88,10 +88,12 @@ void complete_all(struct completion *x)
 
 	lockdep_assert_RT_in_threaded_ctx();
 
+	wake_batch_begin();
 	raw_spin_lock_irqsave(&x->wait.lock, flags);
 	x->done = UINT_MAX;
 	swake_up_all_locked(&x->wait);
 	raw_spin_unlock_irqrestore(&x->wait.lock, flags);
+	wake_batch_end();
 }
 EXPORT_SYMBOL(complete_all);
 
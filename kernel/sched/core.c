@@ -149,7 +149,7 @@ static inline bool __sched_core_less(struct task_struct *a, struct task_struct *
 		return false;
 
 	/* flip prio, so high prio is leftmost */
-	if (prio_less(b, a, task_rq(a)->core->core_forceidle))
+	if (prio_less(b, a, !!task_rq(a)->core->core_forceidle_count))
 		return true;
 
 	return false;
@@ -1113,6 +1113,7 @@ void wake_up_q(struct wake_q_head *head)
 {
 	struct wake_q_node *node = head->first;
 
+	wake_batch_begin();
 	while (node != WAKE_Q_TAIL) {
 		struct task_struct *task;
 
@@ -1128,6 +1129,7 @@ void wake_up_q(struct wake_q_head *head)
 		wake_up_process(task);
 		put_task_struct(task);
 	}
+	wake_batch_end();
 }
 
 /*
@@ -4550,14 +4552,75 @@ void send_call_function_single_ipi(int cpu)
  *   do_handle_IPI() -> IPI_CALL_FUNC -> flush_smp_call_function_queue() ->
  *   sched_ttwu_pending()을 실행하게 될것이다.
  */
+static DEFINE_PER_CPU(unsigned int, wake_batch_depth);
+static DEFINE_PER_CPU(cpumask_var_t, wake_batch_mask);
+
+/**
+ * wake_batch_begin - start batching remote wakeups
+ *
+ * Until the matching wake_batch_end(), wakeups that go through the remote
+ * wake_list only queue the task on the target CPU and remember that CPU;
+ * the IPIs are sent by wake_batch_end(), at most one per CPU and as a single
+ * mask for the architecture. Sections nest, the outermost one sends the IPIs.
+ *
+ * Nothing in the section may wait for a task it woke up to run.
+ */
+void wake_batch_begin(void)
+{
+	preempt_disable();
+	this_cpu_inc(wake_batch_depth);
+}
+
+/**
+ * wake_batch_end - end a wake_batch_begin() section and kick the wakee CPUs
+ */
+void wake_batch_end(void)
+{
+	struct cpumask *mask;
+	unsigned long flags;
+	int cpu;
+
+	local_irq_save(flags);
+	if (this_cpu_dec_return(wake_batch_depth))
+		goto out;
+
+	mask = this_cpu_cpumask_var_ptr(wake_batch_mask);
+	for_each_cpu(cpu, mask) {
+		if (set_nr_if_polling(cpu_rq(cpu)->idle)) {
+			__cpumask_clear_cpu(cpu, mask);
+			trace_sched_wake_idle_without_ipi(cpu);
+		}
+	}
+
+	if (!cpumask_empty(mask)) {
+		arch_send_call_function_ipi_mask(mask);
+		cpumask_clear(mask);
+	}
+out:
+	local_irq_restore(flags);
+	preempt_enable();
+}
+
 static void __ttwu_queue_wakelist(struct task_struct *p, int cpu, int wake_flags)
 {
 	struct rq *rq = cpu_rq(cpu);
+	struct llist_node *node = &p->wake_entry.llist;
 
 	p->sched_remote_wakeup = !!(wake_flags & WF_MIGRATED);
 
 	WRITE_ONCE(rq->ttwu_pending, 1);
-	__smp_call_single_queue(cpu, &p->wake_entry.llist);
+
+	/*
+	 * We hold p->pi_lock with IRQs disabled, so the batch mask cannot be
+	 * modified under us by an interrupt on this CPU.
+	 */
+	if (this_cpu_read(wake_batch_depth)) {
+		if (__smp_call_single_queue_noipi(cpu, node))
+			__cpumask_set_cpu(cpu, this_cpu_cpumask_var_ptr(wake_batch_mask));
+		return;
+	}
+
+	__smp_call_single_queue(cpu, node);
 }
 
 void wake_up_if_idle(int cpu)
@@ -4593,6 +4656,18 @@ bool cpus_share_cache(int this_cpu, int that_cpu)
 	return per_cpu(sd_llc_id, this_cpu) == per_cpu(sd_llc_id, that_cpu);
 }
 
+/*
+ * Whether CPUs share cache resources, which means LLC on non-cluster
+ * machines and LLC tag or L2 on machines with clusters.
+ */
+bool cpus_share_resources(int this_cpu, int that_cpu)
+{
+	if (this_cpu == that_cpu)
+		return true;
+
+	return per_cpu(sd_share_id, this_cpu) == per_cpu(sd_share_id, that_cpu);
+}
+
 /*
  * IAMROOT, 2023.05.20:
  * - llc cache를 공유하지 않으면 true
@@ -5333,13 +5408,19 @@ static void __sched_fork(unsigned long clone_flags, struct task_struct *p)
 	p->wake_entry.u_flags = CSD_TYPE_TTWU;
 	p->migration_pending = NULL;
 #endif
+#ifdef CONFIG_SCHED_MM_CID
+	p->mm_cid = -1;
+	p->mm_cid_released = NULL;
+#endif
 }
 
 DEFINE_STATIC_KEY_FALSE(sched_numa_balancing);
 
 #ifdef CONFIG_NUMA_BALANCING
 
-void set_numabalancing_state(bool enabled)
+int sysctl_numa_balancing_mode;
+
+static void __set_numabalancing_state(bool enabled)
 {
 	if (enabled)
 		static_branch_enable(&sched_numa_balancing);
@@ -5347,13 +5428,22 @@ void set_numabalancing_state(bool enabled)
 		static_branch_disable(&sched_numa_balancing);
 }
 
+void set_numabalancing_state(bool enabled)
+{
+	if (enabled)
+		sysctl_numa_balancing_mode = NUMA_BALANCING_NORMAL;
+	else
+		sysctl_numa_balancing_mode = NUMA_BALANCING_DISABLED;
+	__set_numabalancing_state(enabled);
+}
+
 #ifdef CONFIG_PROC_SYSCTL
 int sysctl_numa_balancing(struct ctl_table *table, int write,
 			  void *buffer, size_t *lenp, loff_t *ppos)
 {
 	struct ctl_table t;
 	int err;
-	int state = static_branch_likely(&sched_numa_balancing);
+	int state = sysctl_numa_balancing_mode;
 
 	if (write && !capable(CAP_SYS_ADMIN))
 		return -EPERM;
@@ -5363,8 +5453,10 @@ int sysctl_numa_balancing(struct ctl_table *table, int write,
 	err = proc_dointvec_minmax(&t, write, buffer, lenp, ppos);
 	if (err < 0)
 		return err;
-	if (write)
-		set_numabalancing_state(state);
+	if (write) {
+		sysctl_numa_balancing_mode = state;
+		__set_numabalancing_state(state);
+	}
 	return err;
 }
 #endif
@@ -5499,6 +5591,7 @@ int sched_fork(unsigned long clone_flags, struct task_struct *p)
 		} else if (PRIO_TO_NICE(p->static_prio) < 0)
 			p->static_prio = NICE_TO_PRIO(0);
 
+		p->se.slice = 0;
 		p->prio = p->normal_prio = p->static_prio;
 		set_load_weight(p, false);
 
@@ -6064,6 +6157,7 @@ prepare_task_switch(struct rq *rq, struct task_struct *prev,
  * - Gitblame 참고 (restartable sequences system call)
  */
 	rseq_preempt(prev);
+	switch_mm_cid(prev, next);
 	fire_sched_out_preempt_notifiers(prev, next);
 	kmap_local_sched_out();
 	prepare_task(next);
@@ -6674,6 +6768,7 @@ void scheduler_tick(void)
 	if (sched_feat(LATENCY_WARN))
 		resched_latency = cpu_resched_latency(rq);
 	calc_global_load_tick(rq);
+	sched_core_tick(rq);
 
 	rq_unlock(rq, &rf);
 
@@ -7231,10 +7326,16 @@ pick_next_task(struct rq *rq, struct task_struct *prev, struct rq_flags *rf)
 
 	/* reset state */
 	rq->core->core_cookie = 0UL;
-	if (rq->core->core_forceidle) {
+	if (rq->core->core_forceidle_count) {
+		if (rq != rq->core)
+			update_rq_clock(rq->core);
+		sched_core_account_forceidle(rq);
+		/* reset after accounting force idle */
+		rq->core->core_forceidle_start = 0;
+		rq->core->core_forceidle_count = 0;
+		rq->core->core_forceidle_occupation = 0;
 		need_sync = true;
 		fi_before = true;
-		rq->core->core_forceidle = false;
 	}
 
 	/*
@@ -7309,9 +7410,9 @@ pick_next_task(struct rq *rq, struct task_struct *prev, struct rq_flags *rf)
 
 			rq_i->core_pick = p;
 			if (rq_i->idle == p && rq_i->nr_running) {
-				rq->core->core_forceidle = true;
-				if (!fi_before)
+				if (!rq->core->core_forceidle_count && !fi_before)
 					rq->core->core_forceidle_seq++;
+				rq->core->core_forceidle_count++;
 			}
 
 			/*
@@ -7331,7 +7432,7 @@ pick_next_task(struct rq *rq, struct task_struct *prev, struct rq_flags *rf)
 				max = p;
 
 				if (old_max) {
-					rq->core->core_forceidle = false;
+					rq->core->core_forceidle_count = 0;
 					for_each_cpu(j, smt_mask) {
 						if (j == i)
 							continue;
@@ -7345,6 +7446,11 @@ pick_next_task(struct rq *rq, struct task_struct *prev, struct rq_flags *rf)
 		}
 	}
 
+	if (schedstat_enabled() && rq->core->core_forceidle_count) {
+		rq->core->core_forceidle_start = rq_clock(rq->core);
+		rq->core->core_forceidle_occupation = occ;
+	}
+
 	rq->core->core_pick_seq = rq->core->core_task_seq;
 	next = rq->core_pick;
 	rq->core_sched_seq = rq->core->core_pick_seq;
@@ -7381,8 +7487,8 @@ pick_next_task(struct rq *rq, struct task_struct *prev, struct rq_flags *rf)
 		 *  1            0       1
 		 *  1            1       0
 		 */
-		if (!(fi_before && rq->core->core_forceidle))
-			task_vruntime_update(rq_i, rq_i->core_pick, rq->core->core_forceidle);
+		if (!(fi_before && rq->core->core_forceidle_count))
+			task_vruntime_update(rq_i, rq_i->core_pick, !!rq->core->core_forceidle_count);
 
 		rq_i->core_pick->core_occupation = occ;
 
@@ -7589,8 +7695,16 @@ static void sched_core_cpu_deactivate(unsigned int cpu)
 	core_rq->core_task_seq      = rq->core_task_seq;
 	core_rq->core_pick_seq      = rq->core_pick_seq;
 	core_rq->core_cookie        = rq->core_cookie;
-	core_rq->core_forceidle     = rq->core_forceidle;
+	core_rq->core_forceidle_count = rq->core_forceidle_count;
 	core_rq->core_forceidle_seq = rq->core_forceidle_seq;
+	core_rq->core_forceidle_occupation = rq->core_forceidle_occupation;
+
+	/*
+	 * Accounting edge for forced idle is handled in pick_next_task().
+	 * Don't need another one here, since the hotplug thread shouldn't
+	 * have a cookie.
+	 */
+	core_rq->core_forceidle_start = 0;
 
 	/* install new leader */
 	for_each_cpu(t, smt_mask) {
@@ -9012,8 +9126,13 @@ static void __setscheduler_params(struct task_struct *p,
 
 	if (dl_policy(policy))
 		__setparam_dl(p, attr);
-	else if (fair_policy(policy))
+	else if (fair_policy(policy)) {
 		p->static_prio = NICE_TO_PRIO(attr->sched_nice);
+		/* sched_runtime is the requested EEVDF slice, 0 for default */
+		p->se.slice = attr->sched_runtime ?
+			clamp_t(u64, attr->sched_runtime, NSEC_PER_MSEC / 10,
+				NSEC_PER_MSEC * 100) : 0;
+	}
 
 	/*
 	 * __sched_setscheduler() ensures attr->sched_priority == 0 when
@@ -9177,6 +9296,8 @@ static int __sched_setscheduler(struct task_struct *p,
 	if (unlikely(policy == p->policy)) {
 		if (fair_policy(policy) && attr->sched_nice != task_nice(p))
 			goto change;
+		if (fair_policy(policy) && attr->sched_runtime != p->se.slice)
+			goto change;
 		if (rt_policy(policy) && attr->sched_priority != p->rt_priority)
 			goto change;
 		if (dl_policy(policy) && dl_param_changed(p, attr))
@@ -9318,6 +9439,8 @@ static int _sched_setscheduler(struct task_struct *p, int policy,
 		.sched_policy   = policy,
 		.sched_priority = param->sched_priority,
 		.sched_nice	= PRIO_TO_NICE(p->static_prio),
+		/* keep the slice set through sched_setattr() */
+		.sched_runtime	= p->se.slice,
 	};
 
 	/* Fixup the legacy SCHED_RESET_ON_FORK hack. */
@@ -9500,8 +9623,10 @@ static void get_params(struct task_struct *p, struct sched_attr *attr)
 		__getparam_dl(p, attr);
 	else if (task_has_rt_policy(p))
 		attr->sched_priority = p->rt_priority;
-	else
+	else {
 		attr->sched_nice = task_nice(p);
+		attr->sched_runtime = p->se.slice;
+	}
 }
 
 /**
@@ -11326,6 +11451,10 @@ void __init sched_init(void)
 			cpumask_size(), GFP_KERNEL, cpu_to_node(i));
 		per_cpu(select_idle_mask, i) = (cpumask_var_t)kzalloc_node(
 			cpumask_size(), GFP_KERNEL, cpu_to_node(i));
+#ifdef CONFIG_SMP
+		per_cpu(wake_batch_mask, i) = (cpumask_var_t)kzalloc_node(
+			cpumask_size(), GFP_KERNEL, cpu_to_node(i));
+#endif
 	}
 #endif /* CONFIG_CPUMASK_OFFSTACK */
 
@@ -11457,7 +11586,9 @@ void __init sched_init(void)
 		rq->core_pick = NULL;
 		rq->core_enabled = 0;
 		rq->core_tree = RB_ROOT;
-		rq->core_forceidle = false;
+		rq->core_forceidle_count = 0;
+		rq->core_forceidle_occupation = 0;
+		rq->core_forceidle_start = 0;
 
 		rq->core_cookie = 0UL;
 #endif
@@ -12917,3 +13048,42 @@ void call_trace_sched_update_nr_running(struct rq *rq, int count)
 {
         trace_sched_update_nr_running_tp(rq, count);
 }
+
+#ifdef CONFIG_SCHED_MM_CID
+/*
+ * Called on exit and exec while @t still uses @mm: give back its
+ * concurrency ID for good, it must not get a new one from @mm.
+ */
+void sched_mm_cid_release(struct task_struct *t, struct mm_struct *mm)
+{
+	unsigned long flags;
+
+	local_irq_save(flags);
+	if (t->mm_cid >= 0)
+		mm_cid_put(mm, t->mm_cid);
+	t->mm_cid = -1;
+	t->mm_cid_released = mm;
+	local_irq_restore(flags);
+}
+
+/*
+ * The concurrency ID of current, which after exec may not have been
+ * switched in with its new mm yet. -1 for tasks that have none.
+ */
+int task_mm_cid(struct task_struct *t)
+{
+	unsigned long flags;
+	int cid;
+
+	if (WARN_ON_ONCE(t != current))
+		return -1;
+
+	local_irq_save(flags);
+	if (t->mm_cid < 0 && mm_cid_wanted(t))
+		t->mm_cid = mm_cid_get(t->mm);
+	cid = t->mm_cid;
+	local_irq_restore(flags);
+
+	return cid;
+}
+#endif
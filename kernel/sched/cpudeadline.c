@@ -192,6 +192,14 @@ int cpudl_find(struct cpudl *cp, struct task_struct *p,
  * - bestcpu에서 @p를 동작시킬수있고, 만료시각이 cp보다 전의 시간이면 
  *   동작시킬수있다.
  */
+		/*
+		 * Preempting a later deadline on a CPU too small for @p
+		 * would just move the deadline miss to @p.
+		 */
+		if (static_branch_unlikely(&sched_asym_cpucapacity) &&
+		    best_cpu != -1 && !dl_task_fits_capacity(p, best_cpu))
+			return 0;
+
 		if (cpumask_test_cpu(best_cpu, &p->cpus_mask) &&
 		    dl_time_before(dl_se->deadline, cp->elements[0].dl)) {
 			if (later_mask)
@@ -125,6 +125,20 @@ static inline unsigned long dl_bw_capacity(int i)
 	}
 }
 
+/*
+ * On asymmetric systems the summed capacity of the root domain can admit a
+ * task no single CPU of it can serve in time: its runtime has to fit within
+ * its deadline when scaled to the biggest CPU, see dl_task_fits_capacity().
+ */
+static inline bool dl_bw_fits_max_capacity(int i, u64 runtime, u64 deadline)
+{
+	if (!static_branch_unlikely(&sched_asym_cpucapacity))
+		return true;
+
+	return cap_scale(deadline, READ_ONCE(cpu_rq(i)->rd->max_cpu_capacity)) >=
+	       runtime;
+}
+
 static inline bool dl_bw_visited(int cpu, u64 gen)
 {
 	struct root_domain *rd = cpu_rq(cpu)->rd;
@@ -151,6 +165,11 @@ static inline unsigned long dl_bw_capacity(int i)
 	return SCHED_CAPACITY_SCALE;
 }
 
+static inline bool dl_bw_fits_max_capacity(int i, u64 runtime, u64 deadline)
+{
+	return true;
+}
+
 static inline bool dl_bw_visited(int cpu, u64 gen)
 {
 	return false;
@@ -3856,6 +3875,10 @@ int sched_dl_overflow(struct task_struct *p, int policy,
 	if (new_bw == p->dl.dl_bw && task_has_dl_policy(p))
 		return 0;
 
+	if (dl_policy(policy) &&
+	    !dl_bw_fits_max_capacity(cpu, runtime, attr->sched_deadline))
+		return err;
+
 	/*
 	 * Either if a task, enters, leave, or stays -deadline but changes
 	 * its parameters, we may need to update accordingly the total
@@ -281,6 +281,49 @@ static const struct file_operations sched_dynamic_fops = {
 
 __read_mostly bool sched_debug_verbose;
 
+/*
+ * Per-CPU view of the SCHED_DEADLINE bandwidth: what the CPU is running and
+ * has been handed, against its capacity and the root domain it accounts to.
+ */
+static int sched_dl_bw_show(struct seq_file *m, void *v)
+{
+	int cpu;
+
+	cpus_read_lock();
+	for_each_online_cpu(cpu) {
+		struct dl_rq *dl_rq = &cpu_rq(cpu)->dl;
+		struct dl_bw *dl_bw;
+
+		rcu_read_lock_sched();
+#ifdef CONFIG_SMP
+		dl_bw = &cpu_rq(cpu)->rd->dl_bw;
+#else
+		dl_bw = &dl_rq->dl_bw;
+#endif
+		seq_printf(m, "cpu%d capacity=%lu running_bw=%llu this_bw=%llu extra_bw=%llu"
+			   " rd_bw=%lld rd_total_bw=%llu\n",
+			   cpu, arch_scale_cpu_capacity(cpu),
+			   dl_rq->running_bw, dl_rq->this_bw, dl_rq->extra_bw,
+			   dl_bw->bw, dl_bw->total_bw);
+		rcu_read_unlock_sched();
+	}
+	cpus_read_unlock();
+
+	return 0;
+}
+
+static int sched_dl_bw_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, sched_dl_bw_show, NULL);
+}
+
+static const struct file_operations sched_dl_bw_fops = {
+	.open		= sched_dl_bw_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static const struct seq_operations sched_debug_sops;
 
 static int sched_debug_open(struct inode *inode, struct file *filp)
@@ -336,6 +379,7 @@ static __init int sched_init_debug(void)
 #endif
 
 	debugfs_create_file("debug", 0444, debugfs_sched, NULL, &sched_debug_fops);
+	debugfs_create_file("dl_bw", 0444, debugfs_sched, NULL, &sched_dl_bw_fops);
 
 	return 0;
 }
@@ -998,6 +1042,9 @@ void proc_sched_show_task(struct task_struct *p, struct pid_namespace *ns,
 		P_SCHEDSTAT(se.statistics.nr_wakeups_affine_attempts);
 		P_SCHEDSTAT(se.statistics.nr_wakeups_passive);
 		P_SCHEDSTAT(se.statistics.nr_wakeups_idle);
+#ifdef CONFIG_SCHED_CORE
+		PN_SCHEDSTAT(se.statistics.core_forceidle_sum);
+#endif
 
 		avg_atom = p->se.sum_exec_runtime;
 		if (nr_switches)
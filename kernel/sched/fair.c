@@ -20,6 +20,9 @@
  *  Adaptive scheduling granularity, math enhancements by Peter Zijlstra
  *  Copyright (C) 2007 Red Hat, Inc., Peter Zijlstra
  */
+#include <linux/node.h>
+#include <linux/rbtree_augmented.h>
+
 #include "sched.h"
 
 /*
@@ -831,6 +834,101 @@ static inline bool entity_before(struct sched_entity *a,
 #define __node_2_se(node) \
 	rb_entry((node), struct sched_entity, run_node)
 
+/*
+ * Weighted average of the vruntime of all queued entities, curr included,
+ * for EEVDF eligibility:
+ *
+ *   V = \Sum w_i * v_i / W
+ *
+ * The sum is kept relative to min_vruntime, v_i - min_vruntime, to keep it
+ * small:  cfs_rq->avg_vruntime = \Sum w_i * (v_i - min_vruntime) over the
+ * tree and cfs_rq->avg_load = \Sum w_i.  curr is not in the tree and gets
+ * added on the fly.
+ */
+static inline s64 entity_key(struct cfs_rq *cfs_rq, struct sched_entity *se)
+{
+	return (s64)(se->vruntime - cfs_rq->min_vruntime);
+}
+
+static void
+avg_vruntime_add(struct cfs_rq *cfs_rq, struct sched_entity *se)
+{
+	unsigned long weight = scale_load_down(se->load.weight);
+	s64 key = entity_key(cfs_rq, se);
+
+	cfs_rq->avg_vruntime += key * weight;
+	cfs_rq->avg_load += weight;
+}
+
+static void
+avg_vruntime_sub(struct cfs_rq *cfs_rq, struct sched_entity *se)
+{
+	unsigned long weight = scale_load_down(se->load.weight);
+	s64 key = entity_key(cfs_rq, se);
+
+	cfs_rq->avg_vruntime -= key * weight;
+	cfs_rq->avg_load -= weight;
+}
+
+static inline
+void avg_vruntime_update(struct cfs_rq *cfs_rq, s64 delta)
+{
+	/*
+	 * v' = v + d ==> avg_vruntime' = avg_vruntime - d*avg_load
+	 */
+	cfs_rq->avg_vruntime -= cfs_rq->avg_load * delta;
+}
+
+static u64 avg_vruntime(struct cfs_rq *cfs_rq)
+{
+	struct sched_entity *curr = cfs_rq->curr;
+	s64 avg = cfs_rq->avg_vruntime;
+	long load = cfs_rq->avg_load;
+
+	if (curr && curr->on_rq) {
+		unsigned long weight = scale_load_down(curr->load.weight);
+
+		avg += entity_key(cfs_rq, curr) * weight;
+		load += weight;
+	}
+
+	if (load) {
+		/* sign flips effective floor / ceil */
+		if (avg < 0)
+			avg -= (load - 1);
+		avg = div_s64(avg, load);
+	}
+
+	return cfs_rq->min_vruntime + avg;
+}
+
+/*
+ * An entity is eligible when it did not receive more service than it was
+ * entitled to, i.e. v_i <= V.  Compare without the division:
+ *
+ *   (v_i - min_vruntime) * W <= \Sum w_i * (v_i - min_vruntime)
+ */
+static int entity_eligible(struct cfs_rq *cfs_rq, struct sched_entity *se)
+{
+	struct sched_entity *curr = cfs_rq->curr;
+	s64 avg = cfs_rq->avg_vruntime;
+	long load = cfs_rq->avg_load;
+
+	if (curr && curr->on_rq) {
+		unsigned long weight = scale_load_down(curr->load.weight);
+
+		avg += entity_key(cfs_rq, curr) * weight;
+		load += weight;
+	}
+
+	return avg >= entity_key(cfs_rq, se) * load;
+}
+
+static inline u64 entity_slice(struct sched_entity *se)
+{
+	return se->slice ?: sysctl_sched_min_granularity;
+}
+
 /*
  * IAMROOT, 2022.12.17:
  * - min_vruntime 값을 현재 cfs_rq 의 entity들 중 가장 작은 vruntime 값으로 업데이트한다.
@@ -915,7 +1013,10 @@ static void update_min_vruntime(struct cfs_rq *cfs_rq)
  * - 보통의 경우에 선택된 vruntime이 무조건 클것이지만 혹시나 모를 상황에
  *   대비해 max처리 해준것.
  */
-	cfs_rq->min_vruntime = max_vruntime(cfs_rq->min_vruntime, vruntime);
+	if ((s64)(vruntime - cfs_rq->min_vruntime) > 0) {
+		avg_vruntime_update(cfs_rq, vruntime - cfs_rq->min_vruntime);
+		cfs_rq->min_vruntime = vruntime;
+	}
 #ifndef CONFIG_64BIT
 	smp_wmb();
 	cfs_rq->min_vruntime_copy = cfs_rq->min_vruntime;
@@ -927,8 +1028,41 @@ static inline bool __entity_less(struct rb_node *a, const struct rb_node *b)
 	return entity_before(__node_2_se(a), __node_2_se(b));
 }
 
+#define deadline_gt(field, lse, rse) ({ (s64)((lse)->field - (rse)->field) > 0; })
+
+static inline void __update_min_deadline(struct sched_entity *se, struct rb_node *node)
+{
+	if (node) {
+		struct sched_entity *rse = __node_2_se(node);
+
+		if (deadline_gt(min_deadline, se, rse))
+			se->min_deadline = rse->min_deadline;
+	}
+}
+
+/*
+ * se->min_deadline = min(se->deadline, left->min_deadline, right->min_deadline)
+ */
+static inline bool min_deadline_update(struct sched_entity *se, bool exit)
+{
+	u64 old_min_deadline = se->min_deadline;
+	struct rb_node *node = &se->run_node;
+
+	se->min_deadline = se->deadline;
+	__update_min_deadline(se, node->rb_right);
+	__update_min_deadline(se, node->rb_left);
+
+	return se->min_deadline == old_min_deadline;
+}
+
+RB_DECLARE_CALLBACKS(static, min_deadline_cb, struct sched_entity,
+		     run_node, min_deadline, min_deadline_update);
+
 /*
  * Enqueue an entity into the rb-tree:
+ *
+ * The tree is ordered by vruntime and augmented with the earliest deadline
+ * of every subtree so that pick_eevdf() doesn't have to walk all of it.
  */
 /*
  * IAMROOT, 2023.01.28:
@@ -936,7 +1070,10 @@ static inline bool __entity_less(struct rb_node *a, const struct rb_node *b)
  */
 static void __enqueue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se)
 {
-	rb_add_cached(&se->run_node, &cfs_rq->tasks_timeline, __entity_less);
+	avg_vruntime_add(cfs_rq, se);
+	se->min_deadline = se->deadline;
+	rb_add_augmented_cached(&se->run_node, &cfs_rq->tasks_timeline,
+				__entity_less, &min_deadline_cb);
 }
 
 /*
@@ -945,7 +1082,9 @@ static void __enqueue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se)
  */
 static void __dequeue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se)
 {
-	rb_erase_cached(&se->run_node, &cfs_rq->tasks_timeline);
+	rb_erase_augmented_cached(&se->run_node, &cfs_rq->tasks_timeline,
+				  &min_deadline_cb);
+	avg_vruntime_sub(cfs_rq, se);
 }
 
 /*
@@ -976,6 +1115,114 @@ static struct sched_entity *__pick_next_entity(struct sched_entity *se)
 	return __node_2_se(next);
 }
 
+/*
+ * Earliest Eligible Virtual Deadline First
+ *
+ * Among the eligible entities (v_i <= V, curr included) pick the one with
+ * the earliest virtual deadline.  Eligible entities form a prefix of the
+ * vruntime ordered tree, so walk down from the root: an ineligible node
+ * sends us left, an eligible node makes its whole left subtree eligible
+ * and min_deadline tells which side can still hold a better deadline.
+ */
+static struct sched_entity *__pick_eevdf(struct cfs_rq *cfs_rq)
+{
+	struct rb_node *node = cfs_rq->tasks_timeline.rb_root.rb_node;
+	struct sched_entity *curr = cfs_rq->curr;
+	struct sched_entity *best = NULL;
+	struct sched_entity *best_left = NULL;
+
+	if (curr && (!curr->on_rq || !entity_eligible(cfs_rq, curr)))
+		curr = NULL;
+	best = curr;
+
+	while (node) {
+		struct sched_entity *se = __node_2_se(node);
+
+		/* If this entity is not eligible, try the left subtree. */
+		if (!entity_eligible(cfs_rq, se)) {
+			node = node->rb_left;
+			continue;
+		}
+
+		/* Now heap search eligible trees for the best (min_)deadline */
+		if (!best || deadline_gt(deadline, best, se))
+			best = se;
+
+		/*
+		 * Every se in a left branch is eligible, keep track of the
+		 * branch with the best min_deadline.
+		 */
+		if (node->rb_left) {
+			struct sched_entity *left = __node_2_se(node->rb_left);
+
+			if (!best_left || deadline_gt(min_deadline, best_left, left))
+				best_left = left;
+
+			/*
+			 * min_deadline is in the left branch. rb_left and all
+			 * descendants are eligible, so immediately switch to
+			 * the second loop.
+			 */
+			if (left->min_deadline == se->min_deadline)
+				break;
+		}
+
+		/* min_deadline is at this node, no need to look right */
+		if (se->deadline == se->min_deadline)
+			break;
+
+		/* else min_deadline is in the right branch. */
+		node = node->rb_right;
+	}
+
+	/*
+	 * We ran into an eligible node which is itself the best.
+	 * (Or nr_running == 0 and both are NULL)
+	 */
+	if (!best_left || (s64)(best_left->min_deadline - best->deadline) > 0)
+		return best;
+
+	/*
+	 * Now best_left and all of its children are eligible, and we are just
+	 * looking for deadline == min_deadline.
+	 */
+	node = &best_left->run_node;
+	while (node) {
+		struct sched_entity *se = __node_2_se(node);
+
+		/* min_deadline is the current node */
+		if (se->deadline == se->min_deadline)
+			return se;
+
+		/* min_deadline is in the left branch */
+		if (node->rb_left &&
+		    __node_2_se(node->rb_left)->min_deadline == se->min_deadline) {
+			node = node->rb_left;
+			continue;
+		}
+
+		/* else min_deadline is in the right branch */
+		node = node->rb_right;
+	}
+	return NULL;
+}
+
+static struct sched_entity *pick_eevdf(struct cfs_rq *cfs_rq)
+{
+	struct sched_entity *se = __pick_eevdf(cfs_rq);
+
+	if (!se) {
+		struct sched_entity *left = __pick_first_entity(cfs_rq);
+
+		if (left) {
+			pr_err("EEVDF scheduling fail, picking leftmost\n");
+			return left;
+		}
+	}
+
+	return se;
+}
+
 #ifdef CONFIG_SCHED_DEBUG
 struct sched_entity *__pick_last_entity(struct cfs_rq *cfs_rq)
 {
@@ -1268,6 +1515,21 @@ static void update_tg_load_avg(struct cfs_rq *cfs_rq)
   *   3. min_vruntime 갱신
   *   4. cfs bandwidth 처리(cfs bandwidth enable 시에만)
   */
+/*
+ * Once curr consumed its slice it gets a new virtual deadline; with EEVDF
+ * that is also the point where it may get preempted.
+ */
+static void update_deadline(struct cfs_rq *cfs_rq, struct sched_entity *se)
+{
+	if ((s64)(se->vruntime - se->deadline) < 0)
+		return;
+
+	se->deadline = se->vruntime + calc_delta_fair(entity_slice(se), se);
+
+	if (sched_feat(EEVDF) && cfs_rq->nr_running > 1)
+		resched_curr(rq_of(cfs_rq));
+}
+
 static void update_curr(struct cfs_rq *cfs_rq)
 {
 	struct sched_entity *curr = cfs_rq->curr;
@@ -1299,6 +1561,7 @@ static void update_curr(struct cfs_rq *cfs_rq)
 	 *   vruntime을 구해와서 누적시킨다.
 	 */
 	curr->vruntime += calc_delta_fair(delta_exec, curr);
+	update_deadline(cfs_rq, curr);
 	update_min_vruntime(cfs_rq);
 
 	/*
@@ -1554,6 +1817,9 @@ unsigned int sysctl_numa_balancing_scan_size = 256;
  */
 unsigned int sysctl_numa_balancing_scan_delay = 1000;
 
+/* Restrict the NUMA promotion throughput (MB/s) for each target node. */
+unsigned int sysctl_numa_balancing_promote_rate_limit = 65536;
+
 struct numa_group {
 	refcount_t refcount;
 
@@ -2186,6 +2452,30 @@ static inline unsigned long group_weight(struct task_struct *p, int nid,
 	return 1000 * faults / total_faults;
 }
 
+/*
+ * In memory tiering mode, promotion from slow memory is throttled per
+ * target node: once the number of candidate pages in the current one
+ * second period exceeds @rate_limit, hint faults on slow memory are not
+ * promoted until the next period starts.
+ */
+static bool numa_promotion_rate_limit(struct pglist_data *pgdat,
+				      unsigned long rate_limit, int nr)
+{
+	unsigned long nr_cand;
+	unsigned int now, start;
+
+	now = jiffies_to_msecs(jiffies);
+	mod_node_page_state(pgdat, PGPROMOTE_CANDIDATE, nr);
+	nr_cand = node_page_state(pgdat, PGPROMOTE_CANDIDATE);
+	start = pgdat->nbp_rl_start;
+	if (now - start > MSEC_PER_SEC &&
+	    cmpxchg(&pgdat->nbp_rl_start, start, now) == start)
+		pgdat->nbp_rl_nr_cand = nr_cand;
+	if (nr_cand - pgdat->nbp_rl_nr_cand >= rate_limit)
+		return true;
+	return false;
+}
+
 /*
  * IAMROOT, 2023.06.24:
  * @p       @page를 numa fault 한 task. (사실상 current)
@@ -2226,6 +2516,22 @@ bool should_numa_migrate_memory(struct task_struct *p, struct page * page,
 	int dst_nid = cpu_to_node(dst_cpu);
 	int last_cpupid, this_cpupid;
 
+	/*
+	 * The pages in slow memory node should be migrated according
+	 * to hot/cold instead of private/shared.
+	 */
+	if ((sysctl_numa_balancing_mode & NUMA_BALANCING_MEMORY_TIERING) &&
+	    !node_is_toptier(src_nid)) {
+		struct pglist_data *pgdat;
+		unsigned long rate_limit;
+
+		pgdat = NODE_DATA(dst_nid);
+		rate_limit = sysctl_numa_balancing_promote_rate_limit <<
+			(20 - PAGE_SHIFT);
+		return !numa_promotion_rate_limit(pgdat, rate_limit,
+						  thp_nr_pages(page));
+	}
+
 	this_cpupid = cpu_pid_to_cpupid(dst_cpu, current->pid);
 	last_cpupid = page_cpupid_xchg_last(page, this_cpupid);
 
@@ -5213,6 +5519,8 @@ static void reweight_entity(struct cfs_rq *cfs_rq, struct sched_entity *se,
 		/* commit outstanding execution time */
 		if (cfs_rq->curr == se)
 			update_curr(cfs_rq);
+		else
+			avg_vruntime_sub(cfs_rq, se);
 		update_load_sub(&cfs_rq->load, se->load.weight);
 	}
 	dequeue_load_avg(cfs_rq, se);
@@ -5237,8 +5545,11 @@ static void reweight_entity(struct cfs_rq *cfs_rq, struct sched_entity *se,
  * - @cfs_rq에 다시계산된 @se를 적산한다.
  */
 	enqueue_load_avg(cfs_rq, se);
-	if (se->on_rq)
+	if (se->on_rq) {
 		update_load_add(&cfs_rq->load, se->load.weight);
+		if (cfs_rq->curr != se)
+			avg_vruntime_add(cfs_rq, se);
+	}
 
 }
 
@@ -7114,6 +7425,16 @@ place_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int initial)
 {
 	u64 vruntime = cfs_rq->min_vruntime;
 
+	/*
+	 * EEVDF doesn't need sleeper credit to get woken tasks running soon,
+	 * their deadline does that.  (Re)start at zero lag, and never gain
+	 * time by being placed backwards.
+	 */
+	if (sched_feat(EEVDF)) {
+		se->vruntime = max_vruntime(se->vruntime, avg_vruntime(cfs_rq));
+		return;
+	}
+
 	/*
 	 * The 'current' period is already promised to the current tasks,
 	 * however the extra weight of the new task will slow them down a
@@ -7242,8 +7563,12 @@ enqueue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int flags)
 	check_schedstat_required();
 	update_stats_enqueue(cfs_rq, se, flags);
 	check_spread(cfs_rq, se);
-	if (!curr)
+	if (!curr) {
+		/* vruntime may be from another cfs_rq, start a new slice */
+		se->deadline = se->vruntime +
+			       calc_delta_fair(entity_slice(se), se);
 		__enqueue_entity(cfs_rq, se);
+	}
 	se->on_rq = 1;
 
 	/*
@@ -7377,6 +7702,10 @@ check_preempt_tick(struct cfs_rq *cfs_rq, struct sched_entity *curr)
 	struct sched_entity *se;
 	s64 delta;
 
+	/* EEVDF preempts from update_deadline() */
+	if (sched_feat(EEVDF))
+		return;
+
 /*
  * IAMROOT, 2023.01.07:
  * - @curr runtime을 종료된것을 검사한다. 다 사용됬으면
@@ -7522,6 +7851,9 @@ pick_next_entity(struct cfs_rq *cfs_rq, struct sched_entity *curr)
 	struct sched_entity *left = __pick_first_entity(cfs_rq);
 	struct sched_entity *se;
 
+	if (sched_feat(EEVDF))
+		return pick_eevdf(cfs_rq);
+
 	/*
 	 * If curr is set we have to see if its left of the leftmost entity
 	 * still in the tree, provided there was anything in the tree at all.
@@ -10070,7 +10402,8 @@ static int select_idle_smt(struct task_struct *p, struct sched_domain *sd, int t
 		if (!cpumask_test_cpu(cpu, p->cpus_ptr) ||
 		    !cpumask_test_cpu(cpu, sched_domain_span(sd)))
 			continue;
-		if (available_idle_cpu(cpu) || sched_idle_cpu(cpu))
+		if ((available_idle_cpu(cpu) || sched_idle_cpu(cpu)) &&
+		    sched_cpu_cookie_match(cpu_rq(cpu), p))
 			return cpu;
 	}
 
@@ -10100,6 +10433,149 @@ static inline int select_idle_smt(struct task_struct *p, struct sched_domain *sd
 
 #endif /* CONFIG_SCHED_SMT */
 
+#ifdef CONFIG_SCHED_SMT
+static void update_idle_core_mask(struct sched_domain_shared *sds, int cpu,
+				  bool idle)
+{
+	struct cpumask *idle_cores = sds_idle_cores(sds);
+	int sibling;
+
+	if (!static_branch_likely(&sched_smt_present)) {
+		if (idle)
+			cpumask_set_cpu(cpu, idle_cores);
+		else
+			cpumask_clear_cpu(cpu, idle_cores);
+		return;
+	}
+
+	if (!idle) {
+		if (!cpumask_test_cpu(cpu, idle_cores))
+			return;
+		for_each_cpu(sibling, cpu_smt_mask(cpu))
+			cpumask_clear_cpu(sibling, idle_cores);
+		return;
+	}
+
+	if (!cpumask_subset(cpu_smt_mask(cpu), sds_idle_cpus(sds)))
+		return;
+	for_each_cpu(sibling, cpu_smt_mask(cpu))
+		cpumask_set_cpu(sibling, idle_cores);
+}
+#else
+static inline void update_idle_core_mask(struct sched_domain_shared *sds,
+					 int cpu, bool idle) { }
+#endif
+
+/*
+ * Called on idle entry and exit to keep the LLC idle masks used by
+ * select_idle_cpu() in sync.  Only touch the shared cachelines when the state
+ * of this CPU actually changes, so a CPU bouncing in and out of idle while the
+ * masks already agree costs a test_bit.
+ */
+void update_idle_cpumask(struct rq *rq, bool idle)
+{
+	struct sched_domain_shared *sds;
+	int cpu = cpu_of(rq);
+
+	if (!sched_feat(SIS_IDLE_MASK))
+		return;
+
+	rcu_read_lock();
+	sds = rcu_dereference(per_cpu(sd_llc_shared, cpu));
+	if (!sds)
+		goto unlock;
+
+	if (cpumask_test_cpu(cpu, sds_idle_cpus(sds)) == idle)
+		goto unlock;
+
+	if (idle)
+		cpumask_set_cpu(cpu, sds_idle_cpus(sds));
+	else
+		cpumask_clear_cpu(cpu, sds_idle_cpus(sds));
+
+	update_idle_core_mask(sds, cpu, idle);
+unlock:
+	rcu_read_unlock();
+}
+
+/*
+ * Look for an idle CPU in the cluster of @target before going over the rest of
+ * the LLC: the wakee keeps sharing the L2 with its waker.  The cluster is
+ * removed from @cpus when nothing is found there.
+ */
+static int select_idle_cluster(struct task_struct *p, struct cpumask *cpus,
+			       bool has_idle_core, int target, int *idle_cpu)
+{
+	struct sched_domain *sdc;
+	struct rq *this_rq = this_rq();
+	int cpu, i;
+
+	if (!static_branch_unlikely(&sched_cluster_active))
+		return -1;
+
+	sdc = rcu_dereference(per_cpu(sd_cluster, target));
+	if (!sdc)
+		return -1;
+
+	for_each_cpu_wrap(cpu, sched_domain_span(sdc), target + 1) {
+		if (!cpumask_test_cpu(cpu, cpus))
+			continue;
+
+		schedstat_inc(this_rq->sis_scanned);
+		if (has_idle_core)
+			i = select_idle_core(p, cpu, cpus, idle_cpu);
+		else
+			i = __select_idle_cpu(cpu, p);
+		if ((unsigned int)i < nr_cpumask_bits)
+			return i;
+	}
+
+	cpumask_andnot(cpus, cpus, sched_domain_span(sdc));
+
+	return -1;
+}
+
+/*
+ * SIS_IDLE_MASK: rather than probing the LLC span within the SIS_PROP budget,
+ * only look at the CPUs (and cores) the LLC has marked idle.  The masks are
+ * hints, each candidate is still checked by select_idle_core() and
+ * __select_idle_cpu().
+ */
+static int select_idle_cpu_mask(struct task_struct *p, struct sched_domain *sd,
+				struct cpumask *cpus, bool has_idle_core,
+				int target)
+{
+	struct sched_domain_shared *sds = sd->shared;
+	struct rq *this_rq = this_rq();
+	int i, cpu, idle_cpu = -1;
+
+	if (has_idle_core) {
+		cpumask_and(cpus, cpus, sds_idle_cores(sds));
+		for_each_cpu_wrap(cpu, cpus, target + 1) {
+			schedstat_inc(this_rq->sis_scanned);
+			i = select_idle_core(p, cpu, cpus, &idle_cpu);
+			if ((unsigned int)i < nr_cpumask_bits)
+				return i;
+		}
+
+		set_idle_cores(target, false);
+		if ((unsigned int)idle_cpu < nr_cpumask_bits)
+			return idle_cpu;
+
+		cpumask_and(cpus, sched_domain_span(sd), p->cpus_ptr);
+	}
+
+	cpumask_and(cpus, cpus, sds_idle_cpus(sds));
+	for_each_cpu_wrap(cpu, cpus, target + 1) {
+		schedstat_inc(this_rq->sis_scanned);
+		idle_cpu = __select_idle_cpu(cpu, p);
+		if ((unsigned int)idle_cpu < nr_cpumask_bits)
+			return idle_cpu;
+	}
+
+	return -1;
+}
+
 /*
  * Scan the LLC domain for idle CPUs; this is dynamically regulated by
  * comparing the average scan cost (tracked in sd->avg_scan_cost) against the
@@ -10136,6 +10612,20 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, bool
 		return -1;
 
 	cpumask_and(cpus, sched_domain_span(sd), p->cpus_ptr);
+	schedstat_inc(this_rq->sis_search);
+
+	i = select_idle_cluster(p, cpus, has_idle_core, target, &idle_cpu);
+	if ((unsigned int)i < nr_cpumask_bits) {
+		schedstat_inc(this_rq->sis_found);
+		return i;
+	}
+
+	if (sched_feat(SIS_IDLE_MASK) && sd->shared) {
+		i = select_idle_cpu_mask(p, sd, cpus, has_idle_core, target);
+		if ((unsigned int)i < nr_cpumask_bits)
+			schedstat_inc(this_rq->sis_found);
+		return i;
+	}
 
 	/*
 	 * IAMROOT, 2023.06.10:
@@ -10206,6 +10696,7 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, bool
  *
  */
 	for_each_cpu_wrap(cpu, cpus, target + 1) {
+		schedstat_inc(this_rq->sis_scanned);
 		if (has_idle_core) {
 			i = select_idle_core(p, cpu, cpus, &idle_cpu);
 			/*
@@ -10213,8 +10704,10 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, bool
 			 * - 현재 루프의 cpu 내 하드웨어 thread가 모두 idle인
 			 *   코어를 찾는다.
 			 */
-			if ((unsigned int)i < nr_cpumask_bits)
+			if ((unsigned int)i < nr_cpumask_bits) {
+				schedstat_inc(this_rq->sis_found);
 				return i;
+			}
 
 		} else {
 			if (!--nr)
@@ -10260,6 +10753,9 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, bool
 		update_avg(&this_sd->avg_scan_cost, time);
 	}
 
+	if ((unsigned int)idle_cpu < nr_cpumask_bits)
+		schedstat_inc(this_rq->sis_found);
+
 	return idle_cpu;
 }
 
@@ -10361,7 +10857,7 @@ static int select_idle_sibling(struct task_struct *p, int prev, int target)
 	bool has_idle_core = false;
 	struct sched_domain *sd;
 	unsigned long task_util;
-	int i, recent_used_cpu;
+	int i, recent_used_cpu, prev_aff = -1;
 
 	/*
 	 * On asymmetric system, update task utilization because we will check
@@ -10388,7 +10884,8 @@ static int select_idle_sibling(struct task_struct *p, int prev, int target)
 	 * - @target이 idle이고 capa 를 만족
 	 */
 	if ((available_idle_cpu(target) || sched_idle_cpu(target)) &&
-	    asym_fits_capacity(task_util, target))
+	    asym_fits_capacity(task_util, target) &&
+	    sched_core_cookie_match(cpu_rq(target), p))
 		return target;
 
 	/*
@@ -10404,8 +10901,19 @@ static int select_idle_sibling(struct task_struct *p, int prev, int target)
 	 */
 	if (prev != target && cpus_share_cache(prev, target) &&
 	    (available_idle_cpu(prev) || sched_idle_cpu(prev)) &&
-	    asym_fits_capacity(task_util, prev))
-		return prev;
+	    asym_fits_capacity(task_util, prev) &&
+	    sched_core_cookie_match(cpu_rq(prev), p)) {
+		/*
+		 * With clusters, only take prev right away when it shares the
+		 * cluster with target; otherwise give the cluster of target a
+		 * chance first and fall back to prev.
+		 */
+		if (!static_branch_unlikely(&sched_cluster_active) ||
+		    cpus_share_resources(prev, target))
+			return prev;
+
+		prev_aff = prev;
+	}
 
 	/*
 	 * Allow a per-cpu kthread to stack with the wakee if the
@@ -10459,7 +10967,8 @@ static int select_idle_sibling(struct task_struct *p, int prev, int target)
 	    cpus_share_cache(recent_used_cpu, target) &&
 	    (available_idle_cpu(recent_used_cpu) || sched_idle_cpu(recent_used_cpu)) &&
 	    cpumask_test_cpu(p->recent_used_cpu, p->cpus_ptr) &&
-	    asym_fits_capacity(task_util, recent_used_cpu)) {
+	    asym_fits_capacity(task_util, recent_used_cpu) &&
+	    sched_core_cookie_match(cpu_rq(recent_used_cpu), p)) {
 		/*
 		 * Replace recent_used_cpu with prev as it is a potential
 		 * candidate for the next wake:
@@ -10568,6 +11077,15 @@ static int select_idle_sibling(struct task_struct *p, int prev, int target)
 	if ((unsigned)i < nr_cpumask_bits)
 		return i;
 
+	/*
+	 * For cluster machines which have lower sharing cache like L2 or
+	 * LLC Tag, we tend to find an idle CPU in the target's cluster
+	 * first. But prev may also be a good candidate, use it if possible
+	 * when no idle CPU was found in select_idle_cpu().
+	 */
+	if ((unsigned int)prev_aff < nr_cpumask_bits)
+		return prev_aff;
+
 	return target;
 }
 
@@ -11867,6 +12385,14 @@ static void check_preempt_wakeup(struct rq *rq, struct task_struct *p, int wake_
 		return;
 
 	update_curr(cfs_rq_of(se));
+
+	/* Preempt iff the woken entity is what EEVDF would pick now */
+	if (sched_feat(EEVDF)) {
+		if (pick_eevdf(cfs_rq_of(se)) == pse)
+			goto preempt;
+		return;
+	}
+
 	if (wakeup_preempt_entity(se, pse) == 1) {
 		/*
 		 * Bias pick_next to pick the sched entity that is
@@ -12527,6 +13053,7 @@ enum migration_type {
 #define LBF_DST_PINNED  0x04
 #define LBF_SOME_PINNED	0x08
 #define LBF_ACTIVE_LB	0x10
+#define LBF_NEWIDLE_STOP 0x20
 
 struct lb_env {
 	struct sched_domain	*sd;
@@ -14814,14 +15341,38 @@ find_idlest_group(struct sched_domain *sd, struct task_struct *p, int this_cpu)
  * - group을 순회하며 local과 busiest group을 찾고, 통계를 내어 @sds를 완성한다.
  *   통계후, rd에 SG_OVERLOAD, SG_OVERUTILIZED가 있었다면 기록한다.
  */
+/*
+ * newidle balancing is done on the way to idle: stop scanning groups as soon
+ * as there is something to run or a wakeup queued for this CPU, or when the
+ * expected idle time has been used up.
+ */
+static inline bool newidle_balance_stop(struct rq *this_rq)
+{
+	return READ_ONCE(this_rq->nr_running) ||
+	       READ_ONCE(this_rq->ttwu_pending) ||
+	       sched_clock_cpu(cpu_of(this_rq)) > this_rq->newidle_deadline;
+}
+
 static inline void update_sd_lb_stats(struct lb_env *env, struct sd_lb_stats *sds)
 {
 	struct sched_domain *child = env->sd->child;
 	struct sched_group *sg = env->sd->groups;
 	struct sg_lb_stats *local = &sds->local_stat;
 	struct sg_lb_stats tmp_sgs;
+	struct sched_group *first;
 	int sg_status = 0;
 
+	/*
+	 * A newidle scan that ran out of time picks up where it stopped, so
+	 * that the groups past the cut-off get looked at too.
+	 */
+	if (env->idle == CPU_NEWLY_IDLE) {
+		if (env->sd->newidle_resume)
+			sg = env->sd->newidle_resume;
+		env->sd->newidle_resume = NULL;
+	}
+	first = sg;
+
 /*
  * IAMROOT, 2023.05.06:
  * - group을 순회하며 sds를 통계한다. local인것은 한번반 선택되고, other인 경우
@@ -14831,6 +15382,14 @@ static inline void update_sd_lb_stats(struct lb_env *env, struct sd_lb_stats *sd
 		struct sg_lb_stats *sgs = &tmp_sgs;
 		int local_group;
 
+		if (env->idle == CPU_NEWLY_IDLE && sg != first && sds->local &&
+		    newidle_balance_stop(env->dst_rq)) {
+			env->sd->newidle_resume = sg;
+			env->flags |= LBF_NEWIDLE_STOP;
+			schedstat_inc(env->sd->newidle_lb_stopped);
+			break;
+		}
+
 /*
  * IAMROOT, 2023.05.06:
  * - dst_cpu가 local group에 있는지 확인한다.
@@ -14888,6 +15447,10 @@ static inline void update_sd_lb_stats(struct lb_env *env, struct sd_lb_stats *sd
 	if (env->sd->flags & SD_NUMA)
 		env->fbq_type = fbq_classify_group(&sds->busiest_stat);
 
+	/* The root domain indicators need every group */
+	if (env->flags & LBF_NEWIDLE_STOP)
+		return;
+
 /*
  * IAMROOT, 2023.05.06:
  * - root인 경우, SG_OVERLOAD, SG_OVERUTILIZED가 있었다면 기록한다.
@@ -15283,6 +15846,12 @@ static struct sched_group *find_busiest_group(struct lb_env *env)
  */
 	update_sd_lb_stats(env, &sds);
 
+	/* Don't pull when this CPU got work while we were scanning */
+	if ((env->flags & LBF_NEWIDLE_STOP) &&
+	    (READ_ONCE(env->dst_rq->nr_running) ||
+	     READ_ONCE(env->dst_rq->ttwu_pending)))
+		goto out_balanced;
+
 	if (sched_energy_enabled()) {
 		struct root_domain *rd = env->dst_rq->rd;
 
@@ -17532,12 +18101,16 @@ static int newidle_balance(struct rq *this_rq, struct rq_flags *rf)
 
 	raw_spin_rq_unlock(this_rq);
 
+	this_rq->newidle_deadline = sched_clock_cpu(this_cpu) + this_rq->avg_idle;
 	update_blocked_averages(this_cpu);
 	rcu_read_lock();
 	for_each_domain(this_cpu, sd) {
 		int continue_balancing = 1;
 		u64 t0, domain_cost;
 
+		if (READ_ONCE(this_rq->ttwu_pending))
+			break;
+
 		/*
 		 * IAMROOT, 2023.04.29:
 		 * - sd 단계별 cost 가 증가하면서 avg_idle 보다 커지면 중단하고
@@ -17565,6 +18138,7 @@ static int newidle_balance(struct rq *this_rq, struct rq_flags *rf)
 			if (domain_cost > sd->max_newidle_lb_cost)
 				sd->max_newidle_lb_cost = domain_cost;
 
+			schedstat_add(sd->newidle_lb_time, domain_cost);
 			curr_cost += domain_cost;
 		}
 
@@ -17754,7 +18328,7 @@ static inline void task_tick_core(struct rq *rq, struct task_struct *curr)
 	 * MIN_NR_TASKS_DURING_FORCEIDLE - 1 tasks and use that to check
 	 * if we need to give up the CPU.
 	 */
-	if (rq->core->core_forceidle && rq->cfs.nr_running == 1 &&
+	if (rq->core->core_forceidle_count && rq->cfs.nr_running == 1 &&
 	    __entity_slice_used(&curr->se, MIN_NR_TASKS_DURING_FORCEIDLE))
 		resched_curr(rq);
 }
@@ -12,6 +12,14 @@ SCHED_FEAT(GENTLE_FAIR_SLEEPERS, true)
  */
 SCHED_FEAT(START_DEBIT, true)
 
+/*
+ * Earliest eligible virtual deadline first: pick the entity with the
+ * earliest virtual deadline among those that are not ahead of the weighted
+ * average vruntime, and use the same rule for wakeup preemption.  The slice
+ * used for the deadline can be set per task with sched_setattr().
+ */
+SCHED_FEAT(EEVDF, false)
+
 /*
  * Prefer to schedule the task we woke last (assuming it failed
  * wakeup-preemption), since its likely going to consume data we
@@ -81,6 +89,12 @@ SCHED_FEAT(TTWU_QUEUE, true)
  */
 SCHED_FEAT(SIS_PROP, true)
 
+/*
+ * Track idle CPUs and idle cores per LLC on idle entry/exit and only scan
+ * those on wakeup, instead of probing the LLC span within the SIS_PROP budget.
+ */
+SCHED_FEAT(SIS_IDLE_MASK, true)
+
 /*
  * Issue a WARN when we do multiple update_rq_clock() calls
  * in a single rq->lock section. Default disabled because the
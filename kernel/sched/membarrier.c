@@ -196,6 +196,13 @@ static void ipi_rseq(void *info)
 	rseq_preempt(current);
 }
 
+static void membarrier_mark_cpu(struct mm_struct *mm)
+{
+	if (atomic_read(&mm->membarrier_state) &
+	    MEMBARRIER_STATE_PRIVATE_EXPEDITED)
+		cpumask_set_cpu(smp_processor_id(), mm_membarrier_cpumask(mm));
+}
+
 static void ipi_sync_rq_state(void *info)
 {
 	struct mm_struct *mm = (struct mm_struct *) info;
@@ -204,6 +211,11 @@ static void ipi_sync_rq_state(void *info)
 		return;
 	this_cpu_write(runqueues.membarrier_state,
 		       atomic_read(&mm->membarrier_state));
+	/*
+	 * CPUs switching to @mm from now on mark themselves, see
+	 * membarrier_switch_mm(), this takes care of those already on it.
+	 */
+	membarrier_mark_cpu(mm);
 	/*
 	 * Issue a memory barrier after setting
 	 * MEMBARRIER_STATE_GLOBAL_EXPEDITED in the current runqueue to
@@ -306,11 +318,32 @@ static int membarrier_global_expedited(void)
 	return 0;
 }
 
-static int membarrier_private_expedited(int flags, int cpu_id)
+struct membarrier_ipi_cond {
+	struct mm_struct	*mm;
+	bool			self;
+};
+
+/*
+ * Called with preemption disabled for every CPU marked in the mask of the
+ * mm, after the smp_mb() on syscall entry.
+ */
+static bool membarrier_cpu_runs_mm(int cpu, void *info)
+{
+	struct membarrier_ipi_cond *cond = info;
+	struct task_struct *p;
+
+	if (!cond->self && cpu == smp_processor_id())
+		return false;
+	p = rcu_dereference(cpu_rq(cpu)->curr);
+	return p && p->mm == cond->mm;
+}
+
+static int membarrier_private_expedited(int flags, int cpu_id,
+					struct cpumask *cpus)
 {
-	cpumask_var_t tmpmask;
 	struct mm_struct *mm = current->mm;
 	smp_call_func_t ipi_func = ipi_mb;
+	struct membarrier_ipi_cond cond = { .mm = mm };
 
 	if (flags == MEMBARRIER_FLAG_SYNC_CORE) {
 		if (!IS_ENABLED(CONFIG_ARCH_HAS_MEMBARRIER_SYNC_CORE))
@@ -343,9 +376,6 @@ static int membarrier_private_expedited(int flags, int cpu_id)
 	 */
 	smp_mb();	/* system call entry is not a mb. */
 
-	if (cpu_id < 0 && !zalloc_cpumask_var(&tmpmask, GFP_KERNEL))
-		return -ENOMEM;
-
 	cpus_read_lock();
 
 	if (cpu_id >= 0) {
@@ -360,27 +390,23 @@ static int membarrier_private_expedited(int flags, int cpu_id)
 			goto out;
 		}
 		rcu_read_unlock();
-	} else {
-		int cpu;
-
-		rcu_read_lock();
-		for_each_online_cpu(cpu) {
-			struct task_struct *p;
-
-			p = rcu_dereference(cpu_rq(cpu)->curr);
-			if (p && p->mm == mm)
-				__cpumask_set_cpu(cpu, tmpmask);
-		}
-		rcu_read_unlock();
-	}
-
-	if (cpu_id >= 0) {
 		/*
 		 * smp_call_function_single() will call ipi_func() if cpu_id
 		 * is the calling CPU.
 		 */
 		smp_call_function_single(cpu_id, ipi_func, NULL, 1);
 	} else {
+		const struct cpumask *mask = mm_membarrier_cpumask(mm);
+
+		/*
+		 * Only the CPUs which switched to @mm and not away from it
+		 * can run one of its threads, and only those that still do
+		 * get an IPI, all of them in one batch.
+		 */
+		if (cpus) {
+			cpumask_and(cpus, cpus, mask);
+			mask = cpus;
+		}
 		/*
 		 * For regular membarrier, we can save a few cycles by
 		 * skipping the current cpu -- we're about to do smp_mb()
@@ -398,18 +424,14 @@ static int membarrier_private_expedited(int flags, int cpu_id)
 		 * is not supposed to issue syscalls at all from inside an
 		 * rseq critical section.
 		 */
-		if (flags != MEMBARRIER_FLAG_SYNC_CORE) {
-			preempt_disable();
-			smp_call_function_many(tmpmask, ipi_func, NULL, true);
-			preempt_enable();
-		} else {
-			on_each_cpu_mask(tmpmask, ipi_func, NULL, true);
-		}
+		cond.self = flags == MEMBARRIER_FLAG_SYNC_CORE;
+		rcu_read_lock();
+		on_each_cpu_cond_mask(membarrier_cpu_runs_mm, ipi_func, &cond,
+				      true, mask);
+		rcu_read_unlock();
 	}
 
 out:
-	if (cpu_id < 0)
-		free_cpumask_var(tmpmask);
 	cpus_read_unlock();
 
 	/*
@@ -429,7 +451,10 @@ static int sync_runqueues_membarrier_state(struct mm_struct *mm)
 	int cpu;
 
 	if (atomic_read(&mm->mm_users) == 1 || num_online_cpus() == 1) {
+		preempt_disable();
 		this_cpu_write(runqueues.membarrier_state, membarrier_state);
+		membarrier_mark_cpu(mm);
+		preempt_enable();
 
 		/*
 		 * For single mm user, we can simply issue a memory barrier
@@ -612,18 +637,72 @@ SYSCALL_DEFINE3(membarrier, int, cmd, unsigned int, flags, int, cpu_id)
 	case MEMBARRIER_CMD_REGISTER_GLOBAL_EXPEDITED:
 		return membarrier_register_global_expedited();
 	case MEMBARRIER_CMD_PRIVATE_EXPEDITED:
-		return membarrier_private_expedited(0, cpu_id);
+		return membarrier_private_expedited(0, cpu_id, NULL);
 	case MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED:
 		return membarrier_register_private_expedited(0);
 	case MEMBARRIER_CMD_PRIVATE_EXPEDITED_SYNC_CORE:
-		return membarrier_private_expedited(MEMBARRIER_FLAG_SYNC_CORE, cpu_id);
+		return membarrier_private_expedited(MEMBARRIER_FLAG_SYNC_CORE, cpu_id, NULL);
 	case MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED_SYNC_CORE:
 		return membarrier_register_private_expedited(MEMBARRIER_FLAG_SYNC_CORE);
 	case MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ:
-		return membarrier_private_expedited(MEMBARRIER_FLAG_RSEQ, cpu_id);
+		return membarrier_private_expedited(MEMBARRIER_FLAG_RSEQ, cpu_id, NULL);
 	case MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED_RSEQ:
 		return membarrier_register_private_expedited(MEMBARRIER_FLAG_RSEQ);
 	default:
 		return -EINVAL;
 	}
 }
+
+/**
+ * sys_membarrier_cpus - issue memory barriers on the threads of the caller's
+ *                       mm running on a set of CPUs
+ * @cmd:           MEMBARRIER_CMD_PRIVATE_EXPEDITED, or its SYNC_CORE or RSEQ
+ *                 flavour, which the process has to be registered for.
+ * @flags:         Currently needs to be 0.
+ * @len:           Length in bytes of the bitmask pointed to by @user_mask_ptr.
+ * @user_mask_ptr: User-space pointer to the mask of CPUs to target.
+ *
+ * Same as sys_membarrier() with @cmd, except that threads running on CPUs
+ * outside of the mask are left alone. Saves the IPIs to CPUs the caller
+ * knows to be of no interest, e.g. the safepoint of a runtime which only
+ * needs to reach the threads of one NUMA node.
+ */
+SYSCALL_DEFINE4(membarrier_cpus, int, cmd, unsigned int, flags,
+		unsigned int, len, unsigned long __user *, user_mask_ptr)
+{
+	cpumask_var_t cpus;
+	int mb_flags, ret;
+
+	if (unlikely(flags))
+		return -EINVAL;
+
+	switch (cmd) {
+	case MEMBARRIER_CMD_PRIVATE_EXPEDITED:
+		mb_flags = 0;
+		break;
+	case MEMBARRIER_CMD_PRIVATE_EXPEDITED_SYNC_CORE:
+		mb_flags = MEMBARRIER_FLAG_SYNC_CORE;
+		break;
+	case MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ:
+		mb_flags = MEMBARRIER_FLAG_RSEQ;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	if (!alloc_cpumask_var(&cpus, GFP_KERNEL))
+		return -ENOMEM;
+
+	if (len < cpumask_size())
+		cpumask_clear(cpus);
+	else if (len > cpumask_size())
+		len = cpumask_size();
+
+	if (copy_from_user(cpus, user_mask_ptr, len))
+		ret = -EFAULT;
+	else
+		ret = membarrier_private_expedited(mb_flags, -1, cpus);
+
+	free_cpumask_var(cpus);
+	return ret;
+}
@@ -161,6 +161,18 @@ static int __init setup_psi(char *str)
 }
 __setup("psi=", setup_psi);
 
+/*
+ * With psi_lazy_avgs the running averages are only folded when somebody
+ * reads a pressure file, instead of every PSI_FREQ while tasks are active.
+ * Averages then treat the time since the last read as one sample period.
+ */
+static bool psi_lazy_avgs __read_mostly;
+static int __init setup_psi_lazy_avgs(char *str)
+{
+	return kstrtobool(str, &psi_lazy_avgs) == 0;
+}
+__setup("psi_lazy_avgs=", setup_psi_lazy_avgs);
+
 /* Running averages - we need to be higher-res than loadavg */
 #define PSI_FREQ	(2*HZ+1)	/* 2 sec intervals */
 #define EXP_10s		1677		/* 1/exp(2s/10s) as fixed-point */
@@ -189,6 +201,7 @@ static void group_init(struct psi_group *group)
 {
 	int cpu;
 
+	group->enabled = true;
 	for_each_possible_cpu(cpu)
 		seqcount_init(&per_cpu_ptr(group->pcpu, cpu)->seq);
 	group->avg_last_update = sched_clock();
@@ -706,7 +719,14 @@ static void psi_group_change(struct psi_group *group, int cpu,
 	 */
 	write_seqcount_begin(&groupc->seq);
 
-	record_times(groupc, now);
+	/*
+	 * A group disabled through cgroup.pressure keeps only its task
+	 * counts, so psi_cgroup_restart() can pick up from the correct
+	 * state.  The first change after disabling concludes the state the
+	 * group was in; past that there is no time to record.
+	 */
+	if (group->enabled || groupc->state_mask)
+		record_times(groupc, now);
 
 	for (t = 0, m = clear; m; m &= ~(1 << t), t++) {
 		if (!(m & (1 << t)))
@@ -726,6 +746,12 @@ static void psi_group_change(struct psi_group *group, int cpu,
 		if (set & (1 << t))
 			groupc->tasks[t]++;
 
+	if (!group->enabled) {
+		groupc->state_mask = 0;
+		write_seqcount_end(&groupc->seq);
+		return;
+	}
+
 	/* Calculate state mask representing active states */
 	for (s = 0; s < NR_PSI_STATES; s++) {
 		if (test_state(groupc->tasks, s))
@@ -750,10 +776,21 @@ static void psi_group_change(struct psi_group *group, int cpu,
 	if (state_mask & group->poll_states)
 		psi_schedule_poll_work(group, 1);
 
-	if (wake_clock && !delayed_work_pending(&group->avgs_work))
+	if (wake_clock && !psi_lazy_avgs &&
+	    !delayed_work_pending(&group->avgs_work))
 		schedule_delayed_work(&group->avgs_work, PSI_FREQ);
 }
 
+/* Account the cost of a psi update to the runqueue, see /proc/schedstat */
+static inline void psi_account_overhead(int cpu, u64 start)
+{
+	if (!schedstat_enabled())
+		return;
+
+	__schedstat_inc(cpu_rq(cpu)->psi_count);
+	__schedstat_add(cpu_rq(cpu)->psi_time, cpu_clock(cpu) - start);
+}
+
 static struct psi_group *iterate_groups(struct task_struct *task, void **iter)
 {
 	if (*iter == &psi_system)
@@ -825,6 +862,8 @@ void psi_task_change(struct task_struct *task, int clear, int set)
 
 	while ((group = iterate_groups(task, &iter)))
 		psi_group_change(group, cpu, clear, set, now, wake_clock);
+
+	psi_account_overhead(cpu, now);
 }
 
 void psi_task_switch(struct task_struct *prev, struct task_struct *next,
@@ -889,6 +928,8 @@ void psi_task_switch(struct task_struct *prev, struct task_struct *next,
 				psi_group_change(group, cpu, clear, set, now, true);
 		}
 	}
+
+	psi_account_overhead(cpu, now);
 }
 
 /**
@@ -1074,6 +1115,31 @@ void cgroup_move_task(struct task_struct *task, struct css_set *to)
 
 	task_rq_unlock(rq, task, &rf);
 }
+
+/*
+ * Called after cgroup.pressure changed @group->enabled.  Nothing needs to be
+ * done on disable: the per-cpu state is concluded on its next change.  On
+ * enable, recompute the state masks from the task counts that were kept up
+ * to date and restart the state clocks from now.
+ */
+void psi_cgroup_restart(struct psi_group *group)
+{
+	int cpu;
+
+	if (static_branch_likely(&psi_disabled) || !group->enabled)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct rq *rq = cpu_rq(cpu);
+		struct rq_flags rf;
+		u64 now;
+
+		rq_lock_irq(rq, &rf);
+		now = cpu_clock(cpu);
+		psi_group_change(group, cpu, 0, 0, now, true);
+		rq_unlock_irq(rq, &rf);
+	}
+}
 #endif /* CONFIG_CGROUPS */
 
 int psi_show(struct seq_file *m, struct psi_group *group, enum psi_res res)
@@ -1081,7 +1147,7 @@ int psi_show(struct seq_file *m, struct psi_group *group, enum psi_res res)
 	int full;
 	u64 now;
 
-	if (static_branch_likely(&psi_disabled))
+	if (static_branch_likely(&psi_disabled) || !group->enabled)
 		return -EOPNOTSUPP;
 
 	/* Update averages before reporting them */
@@ -749,6 +749,9 @@ struct cfs_rq {
 
 	u64			exec_clock;
 	u64			min_vruntime;
+	/* sum of (vruntime - min_vruntime) * weight over the queued entities */
+	s64			avg_vruntime;
+	u64			avg_load;
 #ifdef CONFIG_SCHED_CORE
 	unsigned int		forceidle_seq;
 	u64			min_vruntime_fi;
@@ -1454,6 +1457,8 @@ struct rq {
 
 	/* This is used to determine avg_idle's max value */
 	u64			max_idle_balance_cost;
+	/* newidle_balance() stops scanning groups past this sched_clock */
+	u64			newidle_deadline;
 
 #ifdef CONFIG_HOTPLUG_CPU
 	struct rcuwait		hotplug_wait;
@@ -1503,6 +1508,15 @@ struct rq {
 	/* try_to_wake_up() stats */
 	unsigned int		ttwu_count;
 	unsigned int		ttwu_local;
+
+	/* select_idle_cpu() stats */
+	unsigned int		sis_search;
+	unsigned int		sis_scanned;
+	unsigned int		sis_found;
+
+	/* psi_task_change() and psi_task_switch() overhead */
+	unsigned int		psi_count;
+	u64			psi_time;
 #endif
 
 #ifdef CONFIG_CPU_IDLE
@@ -1528,8 +1542,10 @@ struct rq {
 	unsigned int		core_task_seq;
 	unsigned int		core_pick_seq;
 	unsigned long		core_cookie;
-	unsigned char		core_forceidle;
+	unsigned int		core_forceidle_count;
 	unsigned int		core_forceidle_seq;
+	unsigned int		core_forceidle_occupation;
+	u64			core_forceidle_start;
 #endif
 };
 
@@ -1667,7 +1683,7 @@ static inline bool sched_group_cookie_match(struct rq *rq,
 		return true;
 
 	for_each_cpu_and(cpu, sched_group_span(group), p->cpus_ptr) {
-		if (sched_core_cookie_match(rq, p))
+		if (sched_core_cookie_match(cpu_rq(cpu), p))
 			return true;
 	}
 	return false;
@@ -1805,6 +1821,12 @@ static inline void update_idle_core(struct rq *rq)
 static inline void update_idle_core(struct rq *rq) { }
 #endif
 
+#ifdef CONFIG_SMP
+extern void update_idle_cpumask(struct rq *rq, bool idle);
+#else
+static inline void update_idle_cpumask(struct rq *rq, bool idle) { }
+#endif
+
 DECLARE_PER_CPU_SHARED_ALIGNED(struct rq, runqueues);
 
 /*
@@ -2341,11 +2363,14 @@ static inline struct sched_domain *lowest_flag_domain(int cpu, int flag)
 DECLARE_PER_CPU(struct sched_domain __rcu *, sd_llc);
 DECLARE_PER_CPU(int, sd_llc_size);
 DECLARE_PER_CPU(int, sd_llc_id);
+DECLARE_PER_CPU(int, sd_share_id);
 DECLARE_PER_CPU(struct sched_domain_shared __rcu *, sd_llc_shared);
+DECLARE_PER_CPU(struct sched_domain __rcu *, sd_cluster);
 DECLARE_PER_CPU(struct sched_domain __rcu *, sd_numa);
 DECLARE_PER_CPU(struct sched_domain __rcu *, sd_asym_packing);
 DECLARE_PER_CPU(struct sched_domain __rcu *, sd_asym_cpucapacity);
 extern struct static_key_false sched_asym_cpucapacity;
+extern struct static_key_false sched_cluster_active;
 
 struct sched_group_capacity {
 	atomic_t		ref;
@@ -3981,11 +4006,25 @@ static inline void membarrier_switch_mm(struct rq *rq,
 	if (prev_mm == next_mm)
 		return;
 
+	/*
+	 * Keep track of the CPUs running an mm registered for private
+	 * expedited membarrier, so that it only needs to look at those.
+	 * Both updates are ordered against user-space accesses like the
+	 * rq->curr store, and are only done when the bit changes.
+	 */
+	if (prev_mm &&
+	    cpumask_test_cpu(cpu_of(rq), mm_membarrier_cpumask(prev_mm)))
+		cpumask_clear_cpu(cpu_of(rq), mm_membarrier_cpumask(prev_mm));
+
 /*
  * IAMROOT, 2023.01.28:
  * - rq의 membarrier_state를 next로 갱신한다.
  */
 	membarrier_state = atomic_read(&next_mm->membarrier_state);
+	if ((membarrier_state & MEMBARRIER_STATE_PRIVATE_EXPEDITED) &&
+	    !cpumask_test_cpu(cpu_of(rq), mm_membarrier_cpumask(next_mm)))
+		cpumask_set_cpu(cpu_of(rq), mm_membarrier_cpumask(next_mm));
+
 	if (READ_ONCE(rq->membarrier_state) == membarrier_state)
 		return;
 
@@ -4012,6 +4051,71 @@ static inline bool is_per_cpu_kthread(struct task_struct *p)
 }
 #endif
 
+#ifdef CONFIG_SCHED_MM_CID
+/*
+ * Only user tasks get a concurrency ID, and only until they release the
+ * one of their mm on exit or exec.
+ */
+static inline bool mm_cid_wanted(struct task_struct *t)
+{
+	return t->mm && !(t->flags & PF_KTHREAD) && t->mm != t->mm_cid_released;
+}
+
+static inline int mm_cid_get(struct mm_struct *mm)
+{
+	struct cpumask *cidmask = mm_cidmask(mm);
+	int cid;
+
+	lockdep_assert_irqs_disabled();
+	raw_spin_lock(&mm->cid_lock);
+	/* The lowest free ID, which keeps the IDs in use compact. */
+	cid = cpumask_first_zero(cidmask);
+	if (cid < nr_cpu_ids)
+		__cpumask_set_cpu(cid, cidmask);
+	else
+		cid = -1;
+	raw_spin_unlock(&mm->cid_lock);
+
+	return cid;
+}
+
+static inline void mm_cid_put(struct mm_struct *mm, int cid)
+{
+	lockdep_assert_irqs_disabled();
+	if (cid < 0)
+		return;
+	raw_spin_lock(&mm->cid_lock);
+	__cpumask_clear_cpu(cid, mm_cidmask(mm));
+	raw_spin_unlock(&mm->cid_lock);
+}
+
+/*
+ * A task only holds a concurrency ID while it runs, so an mm never uses
+ * more IDs than it has threads running at the same time.
+ */
+static inline void switch_mm_cid(struct task_struct *prev,
+				 struct task_struct *next)
+{
+	if (prev->mm_cid >= 0) {
+		if (next->mm == prev->mm && mm_cid_wanted(next)) {
+			/* Between threads of the same mm, hand the ID over. */
+			next->mm_cid = prev->mm_cid;
+			prev->mm_cid = -1;
+			return;
+		}
+		mm_cid_put(prev->mm, prev->mm_cid);
+		prev->mm_cid = -1;
+	}
+	if (mm_cid_wanted(next))
+		next->mm_cid = mm_cid_get(next->mm);
+}
+#else
+static inline void switch_mm_cid(struct task_struct *prev,
+				 struct task_struct *next)
+{
+}
+#endif
+
 extern void swake_up_all_locked(struct swait_queue_head *q);
 extern void __prepare_to_swait(struct swait_queue_head *q, struct swait_queue *wait);
 
@@ -129,6 +129,7 @@ static int __wake_up_common(struct wait_queue_head *wq_head, unsigned int mode,
 static void __wake_up_common_lock(struct wait_queue_head *wq_head, unsigned int mode,
 			int nr_exclusive, int wake_flags, void *key)
 {
+	bool batch = nr_exclusive != 1;
 	unsigned long flags;
 	wait_queue_entry_t bookmark;
 
@@ -137,12 +138,22 @@ static void __wake_up_common_lock(struct wait_queue_head *wq_head, unsigned int
 	bookmark.func = NULL;
 	INIT_LIST_HEAD(&bookmark.entry);
 
+	/*
+	 * Waking more than one waiter: send the remote wakeup IPIs once per
+	 * CPU after the walk rather than one per wakee under wq_head->lock.
+	 */
+	if (batch)
+		wake_batch_begin();
+
 	do {
 		spin_lock_irqsave(&wq_head->lock, flags);
 		nr_exclusive = __wake_up_common(wq_head, mode, nr_exclusive,
 						wake_flags, key, &bookmark);
 		spin_unlock_irqrestore(&wq_head->lock, flags);
 	} while (bookmark.flags & WQ_FLAG_BOOKMARK);
+
+	if (batch)
+		wake_batch_end();
 }
 
 /**
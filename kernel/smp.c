@@ -25,6 +25,9 @@
 #include <linux/nmi.h>
 #include <linux/sched/debug.h>
 #include <linux/jump_label.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/timekeeping.h>
 
 #include "smpboot.h"
 #include "sched/smp.h"
@@ -96,6 +99,62 @@ static DEFINE_PER_CPU_ALIGNED(struct call_function_data, cfd_data);
 
 static DEFINE_PER_CPU_SHARED_ALIGNED(struct llist_head, call_single_queue);
 
+/*
+ * Always-on statistics, shown in /proc/smp_call_stats. Every CPU only
+ * updates its own.
+ */
+struct smp_call_stats {
+	unsigned long	ipi_sent;
+	unsigned long	ipi_received;
+	unsigned long	nr_flushes;	/* of a non-empty queue */
+	u64		latency_sum_ns;	/* from queueing to the flush */
+	u64		latency_max_ns;
+	unsigned long	nr_waits;
+	u64		wait_sum_ns;	/* waiting for remote callbacks */
+};
+
+static DEFINE_PER_CPU(struct smp_call_stats, smp_call_stats);
+
+/*
+ * Time the first entry of a CPU's call_single_queue was added at, written
+ * by the queueing CPU. Adders and the flush race for it, a sample can be
+ * a little off or be lost; that is fine for statistics and keeps the
+ * queue lockless.
+ */
+static DEFINE_PER_CPU_SHARED_ALIGNED(u64, call_single_queued_at);
+
+static __always_inline void csd_queue_stamp(int cpu)
+{
+	if (llist_empty(&per_cpu(call_single_queue, cpu)))
+		WRITE_ONCE(per_cpu(call_single_queued_at, cpu),
+			   ktime_get_mono_fast_ns());
+}
+
+/* Called from the flush, with interrupts disabled. */
+static void csd_queue_account(void)
+{
+	struct smp_call_stats *stats = this_cpu_ptr(&smp_call_stats);
+	u64 queued = __this_cpu_read(call_single_queued_at);
+	u64 now = ktime_get_mono_fast_ns();
+	u64 latency;
+
+	stats->nr_flushes++;
+	if (!queued || queued > now)
+		return;
+
+	__this_cpu_write(call_single_queued_at, 0);
+	latency = now - queued;
+	stats->latency_sum_ns += latency;
+	if (latency > stats->latency_max_ns)
+		stats->latency_max_ns = latency;
+}
+
+static void csd_wait_account(u64 start)
+{
+	this_cpu_inc(smp_call_stats.nr_waits);
+	this_cpu_add(smp_call_stats.wait_sum_ns, local_clock() - start);
+}
+
 static void flush_smp_call_function_queue(bool warn_cpu_offline);
 
 int smpcfd_prepare_cpu(unsigned int cpu)
@@ -435,6 +494,7 @@ static void __smp_call_single_queue_debug(int cpu, struct llist_node *node)
 		cfd_seq_store(pcpu->seq_ipi, this_cpu, cpu, CFD_SEQ_IPI);
 		cfd_seq_store(seq->ping, this_cpu, cpu, CFD_SEQ_PING);
 		send_call_function_single_ipi(cpu);
+		this_cpu_inc(smp_call_stats.ipi_sent);
 		cfd_seq_store(seq->pinged, this_cpu, cpu, CFD_SEQ_PINGED);
 	} else {
 		cfd_seq_store(pcpu->seq_noipi, this_cpu, cpu, CFD_SEQ_NOIPI);
@@ -490,6 +550,8 @@ static DEFINE_PER_CPU_SHARED_ALIGNED(call_single_data_t, csd_data);
  */
 void __smp_call_single_queue(int cpu, struct llist_node *node)
 {
+	csd_queue_stamp(cpu);
+
 #ifdef CONFIG_CSD_LOCK_WAIT_DEBUG
 	if (static_branch_unlikely(&csdlock_debug_extended)) {
 		unsigned int type;
@@ -525,8 +587,21 @@ void __smp_call_single_queue(int cpu, struct llist_node *node)
  *   따르는 것처럼 보이도록 해야 합니다. 일반 코드는 실제로 올바른 작업을 수행할 
  *   수 없습니다.
  */
-	if (llist_add(node, &per_cpu(call_single_queue, cpu)))
+	if (llist_add(node, &per_cpu(call_single_queue, cpu))) {
 		send_call_function_single_ipi(cpu);
+		this_cpu_inc(smp_call_stats.ipi_sent);
+	}
+}
+
+/*
+ * Same as __smp_call_single_queue(), but leave the IPI to the caller:
+ * returns true if @cpu needs to be kicked for @node to be seen. Used by
+ * the scheduler to send one IPI per CPU for a batch of remote wakeups.
+ */
+bool __smp_call_single_queue_noipi(int cpu, struct llist_node *node)
+{
+	csd_queue_stamp(cpu);
+	return llist_add(node, &per_cpu(call_single_queue, cpu));
 }
 
 /*
@@ -592,6 +667,7 @@ void generic_smp_call_function_single_interrupt(void)
 {
 	cfd_seq_store(this_cpu_ptr(&cfd_seq_local)->gotipi, CFD_SEQ_NOCPU,
 		      smp_processor_id(), CFD_SEQ_GOTIPI);
+	__this_cpu_inc(smp_call_stats.ipi_received);
 	flush_smp_call_function_queue(true);
 }
 
@@ -641,6 +717,8 @@ static void flush_smp_call_function_queue(bool warn_cpu_offline)
 		      /* Special meaning of source cpu: 0 == queue empty */
 		      entry ? CFD_SEQ_NOCPU : 0,
 		      smp_processor_id(), CFD_SEQ_DEQUEUE);
+	if (entry)
+		csd_queue_account();
 	entry = llist_reverse_order(entry);
 
 	/* There shouldn't be any pending callbacks on an offline CPU. */
@@ -825,8 +903,12 @@ int smp_call_function_single(int cpu, smp_call_func_t func, void *info,
 
 	err = generic_exec_single(cpu, csd);
 
-	if (wait)
+	if (wait && cpu != this_cpu) {
+		u64 start = local_clock();
+
 		csd_lock_wait(csd);
+		csd_wait_account(start);
+	}
 
 	put_cpu();
 
@@ -960,18 +1042,22 @@ EXPORT_SYMBOL_GPL(smp_call_function_any);
  *
  * %SCF_WAIT:		Wait until function execution is completed
  * %SCF_RUN_LOCAL:	Run also locally if local cpu is set in cpumask
+ * %SCF_WAIT_LATER:	Like %SCF_WAIT, but leave the waiting to smp_call_wait()
+ *
+ * Returns whether callbacks were queued on remote CPUs.
  */
 #define SCF_WAIT	(1U << 0)
 #define SCF_RUN_LOCAL	(1U << 1)
+#define SCF_WAIT_LATER	(1U << 2)
 
-static void smp_call_function_many_cond(const struct cpumask *mask,
+static bool smp_call_function_many_cond(const struct cpumask *mask,
 					smp_call_func_t func, void *info,
 					unsigned int scf_flags,
 					smp_cond_func_t cond_func)
 {
 	int cpu, last_cpu, this_cpu = smp_processor_id();
 	struct call_function_data *cfd;
-	bool wait = scf_flags & SCF_WAIT;
+	bool wait = scf_flags & (SCF_WAIT | SCF_WAIT_LATER);
 	bool run_remote = false;
 	bool run_local = false;
 	int nr_cpus = 0;
@@ -1030,6 +1116,7 @@ static void smp_call_function_many_cond(const struct cpumask *mask,
 			csd->node.dst = cpu;
 #endif
 			cfd_seq_store(pcpu->seq_queue, this_cpu, cpu, CFD_SEQ_QUEUE);
+			csd_queue_stamp(cpu);
 			if (llist_add(&csd->node.llist, &per_cpu(call_single_queue, cpu))) {
 				__cpumask_set_cpu(cpu, cfd->cpumask_ipi);
 				nr_cpus++;
@@ -1052,6 +1139,7 @@ static void smp_call_function_many_cond(const struct cpumask *mask,
 			send_call_function_single_ipi(last_cpu);
 		else if (likely(nr_cpus > 1))
 			arch_send_call_function_ipi_mask(cfd->cpumask_ipi);
+		this_cpu_add(smp_call_stats.ipi_sent, nr_cpus);
 
 		cfd_seq_store(this_cpu_ptr(&cfd_seq_local)->pinged, this_cpu, CFD_SEQ_NOCPU, CFD_SEQ_PINGED);
 	}
@@ -1064,14 +1152,19 @@ static void smp_call_function_many_cond(const struct cpumask *mask,
 		local_irq_restore(flags);
 	}
 
-	if (run_remote && wait) {
+	if (run_remote && (scf_flags & SCF_WAIT)) {
+		u64 start = local_clock();
+
 		for_each_cpu(cpu, cfd->cpumask) {
 			call_single_data_t *csd;
 
 			csd = &per_cpu_ptr(cfd->pcpu, cpu)->csd;
 			csd_lock_wait(csd);
 		}
+		csd_wait_account(start);
 	}
+
+	return run_remote;
 }
 
 /**
@@ -1097,6 +1190,85 @@ void smp_call_function_many(const struct cpumask *mask,
 }
 EXPORT_SYMBOL(smp_call_function_many);
 
+/**
+ * smp_call_function_many_async(): Run a function on a set of CPUs, wait later.
+ * @mask: The set of cpus to run on (only runs on online subset).
+ * @func: The function to run. This must be fast and non-blocking.
+ * @info: An arbitrary pointer to pass to the function.
+ * @token: Completion token, to be passed to smp_call_wait().
+ *
+ * Like smp_call_function_many() with @wait set, except that it returns as
+ * soon as the IPIs are sent, so that the caller can do useful work while
+ * @func runs on the other CPUs, and then waits for them with
+ * smp_call_wait() or polls smp_call_done().
+ *
+ * The same restrictions as for smp_call_function_many() apply. Preemption
+ * must stay disabled until smp_call_wait() returns, and no other
+ * smp_call_function_many*() call may be made in between: @token refers to
+ * this CPU's call data.
+ */
+void smp_call_function_many_async(const struct cpumask *mask,
+				  smp_call_func_t func, void *info,
+				  struct smp_call_token *token)
+{
+	token->cfd = NULL;
+	if (smp_call_function_many_cond(mask, func, info, SCF_WAIT_LATER, NULL))
+		token->cfd = this_cpu_ptr(&cfd_data);
+}
+EXPORT_SYMBOL_GPL(smp_call_function_many_async);
+
+/**
+ * smp_call_done(): Check whether an asynchronous call has completed.
+ * @token: Token set up by smp_call_function_many_async().
+ *
+ * Returns true once @func has returned on all CPUs, in which case
+ * smp_call_wait() won't spin.
+ */
+bool smp_call_done(struct smp_call_token *token)
+{
+	struct call_function_data *cfd = token->cfd;
+	int cpu;
+
+	if (!cfd)
+		return true;
+
+	WARN_ON_ONCE(cfd != this_cpu_ptr(&cfd_data));
+	for_each_cpu(cpu, cfd->cpumask) {
+		call_single_data_t *csd = &per_cpu_ptr(cfd->pcpu, cpu)->csd;
+
+		if (smp_load_acquire(&csd->node.u_flags) & CSD_FLAG_LOCK)
+			return false;
+	}
+
+	return true;
+}
+EXPORT_SYMBOL_GPL(smp_call_done);
+
+/**
+ * smp_call_wait(): Wait for an asynchronous call to complete.
+ * @token: Token set up by smp_call_function_many_async().
+ *
+ * Returns once @func has returned on all CPUs.
+ */
+void smp_call_wait(struct smp_call_token *token)
+{
+	struct call_function_data *cfd = token->cfd;
+	u64 start;
+	int cpu;
+
+	if (!cfd)
+		return;
+
+	WARN_ON_ONCE(cfd != this_cpu_ptr(&cfd_data));
+	start = local_clock();
+	for_each_cpu(cpu, cfd->cpumask)
+		csd_lock_wait(&per_cpu_ptr(cfd->pcpu, cpu)->csd);
+	csd_wait_account(start);
+
+	token->cfd = NULL;
+}
+EXPORT_SYMBOL_GPL(smp_call_wait);
+
 /**
  * smp_call_function(): Run a function on all other CPUs.
  * @func: The function to run. This must be fast and non-blocking.
@@ -1120,6 +1292,36 @@ void smp_call_function(smp_call_func_t func, void *info, int wait)
 }
 EXPORT_SYMBOL(smp_call_function);
 
+#ifdef CONFIG_PROC_FS
+static int smp_call_stats_show(struct seq_file *m, void *v)
+{
+	int cpu;
+
+	seq_puts(m, "# cpu ipi_sent ipi_received flushes latency_sum_ns latency_max_ns waits wait_sum_ns\n");
+	for_each_possible_cpu(cpu) {
+		struct smp_call_stats *stats = per_cpu_ptr(&smp_call_stats, cpu);
+
+		seq_printf(m, "cpu%d %lu %lu %lu %llu %llu %lu %llu\n", cpu,
+			   READ_ONCE(stats->ipi_sent),
+			   READ_ONCE(stats->ipi_received),
+			   READ_ONCE(stats->nr_flushes),
+			   READ_ONCE(stats->latency_sum_ns),
+			   READ_ONCE(stats->latency_max_ns),
+			   READ_ONCE(stats->nr_waits),
+			   READ_ONCE(stats->wait_sum_ns));
+	}
+
+	return 0;
+}
+
+static int __init smp_call_stats_init(void)
+{
+	proc_create_single("smp_call_stats", 0444, NULL, smp_call_stats_show);
+	return 0;
+}
+fs_initcall(smp_call_stats_init);
+#endif
+
 /* Setup configured maximum number of CPUs to activate */
 unsigned int setup_max_cpus = NR_CPUS;
 EXPORT_SYMBOL(setup_max_cpus);
@@ -27,6 +27,8 @@
 #include <linux/tick.h>
 #include <linux/irq.h>
 #include <linux/wait_bit.h>
+#include <linux/moduleparam.h>
+#include <linux/sched/clock.h>
 
 #include <asm/softirq_stack.h>
 
@@ -106,6 +108,13 @@ static void wakeup_softirqd(void)
  * right now. Let ksoftirqd handle this at its own rate, to get fairness,
  * unless we're doing some of the synchronous softirqs.
  */
+/*
+ * Vectors that overran their budget in __do_softirq() and have been left to
+ * ksoftirqd.  Only ksoftirqd clears them, so that a vector keeping the CPU
+ * busy can't come back through irq_exit() before the scheduler had a say.
+ */
+static DEFINE_PER_CPU(u32, softirq_deferred);
+
 #define SOFTIRQ_NOW_MASK ((1 << HI_SOFTIRQ) | (1 << TASKLET_SOFTIRQ))
 static bool ksoftirqd_running(unsigned long pending)
 {
@@ -113,6 +122,9 @@ static bool ksoftirqd_running(unsigned long pending)
 
 	if (pending & SOFTIRQ_NOW_MASK)
 		return false;
+	/* only the deferred vectors wait for ksoftirqd */
+	if (pending & ~__this_cpu_read(softirq_deferred))
+		return false;
 	return tsk && task_is_running(tsk) && !__kthread_should_park(tsk);
 }
 
@@ -568,6 +580,18 @@ asmlinkage __visible void do_softirq(void)
 #define MAX_SOFTIRQ_TIME  msecs_to_jiffies(2)
 #define MAX_SOFTIRQ_RESTART 10
 
+/*
+ * Time a single vector may run for in one __do_softirq() outside of
+ * ksoftirqd.  A vector exceeding it is deferred to ksoftirqd on its own
+ * while the others keep being handled on interrupt exit, so that a flood of
+ * network packets doesn't hold back timers and RCU, or the other way round.
+ * 0 disables the budget of a vector.
+ */
+static unsigned int softirq_budget_us[NR_SOFTIRQS] = {
+	[0 ... NR_SOFTIRQS - 1] = 2000,
+};
+module_param_array_named(budget_us, softirq_budget_us, uint, NULL, 0644);
+
 #ifdef CONFIG_TRACE_IRQFLAGS
 /*
  * When we run softirqs from irq_exit() and thus on the hardirq stack we need
@@ -613,9 +637,11 @@ asmlinkage __visible void __softirq_entry __do_softirq(void)
 	unsigned long end = jiffies + MAX_SOFTIRQ_TIME;
 	unsigned long old_flags = current->flags;
 	int max_restart = MAX_SOFTIRQ_RESTART;
+	bool in_ksoftirqd = __this_cpu_read(ksoftirqd) == current;
+	u64 vec_time[NR_SOFTIRQS] = { 0 };
 	struct softirq_action *h;
 	bool in_hardirq;
-	__u32 pending;
+	__u32 pending, deferred;
 	int softirq_bit;
 
 	/*
@@ -633,6 +659,9 @@ asmlinkage __visible void __softirq_entry __do_softirq(void)
 
 	pending = local_softirq_pending();
 
+	deferred = in_ksoftirqd ? 0 : __this_cpu_read(softirq_deferred);
+	__this_cpu_write(softirq_deferred, deferred);
+
 /*
  * IAMROOT, 2022.11.19:
  * - PREEMPT
@@ -646,8 +675,9 @@ asmlinkage __visible void __softirq_entry __do_softirq(void)
 	account_softirq_enter(current);
 
 restart:
-	/* Reset the pending bitmask before enabling irqs */
-	set_softirq_pending(0);
+	/* Reset the pending bitmask before enabling irqs, but for deferred */
+	set_softirq_pending(pending & deferred);
+	pending &= ~deferred;
 
 /*
  * IAMROOT, 2022.11.19:
@@ -659,8 +689,9 @@ asmlinkage __visible void __softirq_entry __do_softirq(void)
 	h = softirq_vec;
 
 	while ((softirq_bit = ffs(pending))) {
-		unsigned int vec_nr;
+		unsigned int vec_nr, budget;
 		int prev_count;
+		u64 start, delta;
 
 		h += softirq_bit - 1;
 
@@ -675,8 +706,18 @@ asmlinkage __visible void __softirq_entry __do_softirq(void)
  * IAMROOT, 2022.11.19:
  * - open_softirq에서 등록된 action handler 처리
  */
+		start = local_clock();
 		h->action(h);
+		delta = local_clock() - start;
 		trace_softirq_exit(vec_nr);
+
+		__this_cpu_add(kstat.softirq_time[vec_nr], delta);
+		vec_time[vec_nr] += delta;
+		budget = READ_ONCE(softirq_budget_us[vec_nr]);
+		if (!in_ksoftirqd && budget &&
+		    vec_time[vec_nr] > (u64)budget * NSEC_PER_USEC)
+			deferred |= BIT(vec_nr);
+
 		if (unlikely(prev_count != preempt_count())) {
 			pr_err("huh, entered softirq %u %s %p with preempt_count %08x, exited with %08x?\n",
 			       vec_nr, softirq_to_name[vec_nr], h->action,
@@ -705,11 +746,18 @@ asmlinkage __visible void __softirq_entry __do_softirq(void)
  *   그게 아니면 ksoftirqd 에서 처리한다.
  */
 	pending = local_softirq_pending();
-	if (pending) {
+
+	/* a deferred vector which isn't pending anymore has nothing to wait for */
+	deferred &= pending;
+	__this_cpu_write(softirq_deferred, deferred);
+
+	if (pending & ~deferred) {
 		if (time_before(jiffies, end) && !need_resched() &&
 		    --max_restart)
 			goto restart;
 
+		wakeup_softirqd();
+	} else if (deferred) {
 		wakeup_softirqd();
 	}
 
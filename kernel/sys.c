@@ -36,6 +36,7 @@
 #include <linux/ptrace.h>
 #include <linux/fs_struct.h>
 #include <linux/file.h>
+#include <linux/futex.h>
 #include <linux/mount.h>
 #include <linux/gfp.h>
 #include <linux/syscore_ops.h>
@@ -2534,6 +2535,27 @@ SYSCALL_DEFINE5(prctl, int, option, unsigned long, arg2, unsigned long, arg3,
 	case PR_SCHED_CORE:
 		error = sched_core_share_pid(arg2, arg3, arg4, arg5);
 		break;
+#endif
+	case PR_FUTEX_HASH:
+		error = futex_hash_prctl(arg2, arg3, arg4, arg5);
+		break;
+#ifdef CONFIG_FORK_SHARE_PTE
+	case PR_GET_FORK_SHARE_PTE:
+		if (arg2 || arg3 || arg4 || arg5)
+			return -EINVAL;
+		error = !!test_bit(MMF_FORK_SHARE_PTE, &me->mm->flags);
+		break;
+	case PR_SET_FORK_SHARE_PTE:
+		if (arg3 || arg4 || arg5)
+			return -EINVAL;
+		if (mmap_write_lock_killable(me->mm))
+			return -EINTR;
+		if (arg2)
+			set_bit(MMF_FORK_SHARE_PTE, &me->mm->flags);
+		else
+			clear_bit(MMF_FORK_SHARE_PTE, &me->mm->flags);
+		mmap_write_unlock(me->mm);
+		break;
 #endif
 	default:
 		error = -EINVAL;
@@ -150,6 +150,7 @@ COND_SYSCALL(set_robust_list);
 COND_SYSCALL_COMPAT(set_robust_list);
 COND_SYSCALL(get_robust_list);
 COND_SYSCALL_COMPAT(get_robust_list);
+COND_SYSCALL(futex_waitv);
 
 /* kernel/hrtimer.c */
 
@@ -344,6 +345,7 @@ COND_SYSCALL(userfaultfd);
 
 /* membarrier */
 COND_SYSCALL(membarrier);
+COND_SYSCALL(membarrier_cpus);
 
 COND_SYSCALL(mlock2);
 
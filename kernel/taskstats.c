@@ -21,6 +21,12 @@
 #include <net/genetlink.h>
 #include <linux/atomic.h>
 #include <linux/sched/cputime.h>
+#include <linux/sched/mm.h>
+#include <linux/proc_fs.h>
+#include <linux/ptrace.h>
+#include <linux/task_io_accounting_ops.h>
+#include <linux/time_namespace.h>
+#include <linux/tty.h>
 
 /*
  * Maximum length of a cpumask that can be specified in
@@ -40,6 +46,11 @@ static const struct nla_policy taskstats_cmd_get_policy[] = {
 	[TASKSTATS_CMD_ATTR_REGISTER_CPUMASK] = { .type = NLA_STRING },
 	[TASKSTATS_CMD_ATTR_DEREGISTER_CPUMASK] = { .type = NLA_STRING },};
 
+static const struct nla_policy taskstats_cmd_query_policy[] = {
+	[TASKSTATS_QUERY_ATTR_PIDS] = { .type = NLA_BINARY },
+	[TASKSTATS_QUERY_ATTR_MASK] = { .type = NLA_U32 },
+};
+
 static const struct nla_policy cgroupstats_cmd_get_policy[] = {
 	[CGROUPSTATS_CMD_ATTR_FD] = { .type = NLA_U32 },
 };
@@ -547,6 +558,207 @@ static int taskstats_user_cmd(struct sk_buff *skb, struct genl_info *info)
 		return -EINVAL;
 }
 
+static void query_fill_stat(struct task_struct *tsk, struct mm_struct *mm,
+			    struct pid_namespace *ns, struct taskstats_query *q)
+{
+	struct task_struct *t = tsk;
+	unsigned long flags;
+	u64 utime, stime;
+
+	q->state = task_state_to_char(tsk);
+	if (lock_task_sighand(tsk, &flags)) {
+		struct signal_struct *sig = tsk->signal;
+
+		if (sig->tty)
+			q->tty_nr = new_encode_dev(tty_devnum(sig->tty));
+		q->num_threads = get_nr_threads(tsk);
+
+		q->min_flt = sig->min_flt;
+		q->maj_flt = sig->maj_flt;
+		do {
+			q->min_flt += t->min_flt;
+			q->maj_flt += t->maj_flt;
+		} while_each_thread(tsk, t);
+		thread_group_cputime_adjusted(tsk, &utime, &stime);
+		q->utime = utime;
+		q->stime = stime;
+
+		q->sid = task_session_nr_ns(tsk, ns);
+		q->ppid = task_tgid_nr_ns(tsk->real_parent, ns);
+		q->pgid = task_pgrp_nr_ns(tsk, ns);
+		unlock_task_sighand(tsk, &flags);
+	}
+
+	q->flags = tsk->flags;
+	q->priority = task_prio(tsk);
+	q->nice = task_nice(tsk);
+	q->rt_priority = tsk->rt_priority;
+	q->policy = tsk->policy;
+	q->processor = task_cpu(tsk);
+	q->start_time = timens_add_boottime_ns(tsk->start_boottime);
+	if (mm) {
+		q->vsize = (u64)mm->total_vm << PAGE_SHIFT;
+		q->rss = get_mm_rss(mm);
+	}
+}
+
+static void query_fill_status(struct task_struct *tsk,
+			      struct taskstats_query *q)
+{
+	struct user_namespace *user_ns = current_user_ns();
+	const struct cred *cred;
+
+	rcu_read_lock();
+	cred = __task_cred(tsk);
+	q->uid = from_kuid_munged(user_ns, cred->uid);
+	q->euid = from_kuid_munged(user_ns, cred->euid);
+	q->gid = from_kgid_munged(user_ns, cred->gid);
+	q->egid = from_kgid_munged(user_ns, cred->egid);
+	rcu_read_unlock();
+
+	q->nvcsw = tsk->nvcsw;
+	q->nivcsw = tsk->nivcsw;
+}
+
+static void query_fill_io(struct task_struct *tsk, struct taskstats_query *q)
+{
+#ifdef CONFIG_TASK_IO_ACCOUNTING
+	struct task_io_accounting acct = tsk->ioac;
+	unsigned long flags;
+
+	if (lock_task_sighand(tsk, &flags)) {
+		struct task_struct *t = tsk;
+
+		task_io_accounting_add(&acct, &tsk->signal->ioac);
+		while_each_thread(tsk, t)
+			task_io_accounting_add(&acct, &t->ioac);
+		unlock_task_sighand(tsk, &flags);
+	}
+
+	q->rchar = acct.rchar;
+	q->wchar = acct.wchar;
+	q->syscr = acct.syscr;
+	q->syscw = acct.syscw;
+	q->read_bytes = acct.read_bytes;
+	q->write_bytes = acct.write_bytes;
+	q->cancelled_write_bytes = acct.cancelled_write_bytes;
+#endif
+}
+
+static void query_fill_mem(struct mm_struct *mm, struct taskstats_query *q)
+{
+	q->rss_anon = (u64)get_mm_counter(mm, MM_ANONPAGES) << PAGE_SHIFT;
+	q->rss_file = (u64)get_mm_counter(mm, MM_FILEPAGES) << PAGE_SHIFT;
+	q->rss_shmem = (u64)get_mm_counter(mm, MM_SHMEMPAGES) << PAGE_SHIFT;
+	q->swap = (u64)get_mm_counter(mm, MM_SWAPENTS) << PAGE_SHIFT;
+	q->hiwater_rss = (u64)max(mm->hiwater_rss, get_mm_rss(mm)) <<
+			 PAGE_SHIFT;
+	q->pgtables = mm_pgtables_bytes(mm);
+}
+
+/*
+ * Fill in the groups of @mask for @pid.  Everything but the stat and
+ * status groups needs the same access as the /proc files they come from.
+ */
+static int fill_query_for_pid(pid_t pid, u32 mask, struct taskstats_query *q)
+{
+	struct task_struct *tsk;
+	struct mm_struct *mm;
+
+	tsk = find_get_task_by_vpid(pid);
+	if (!tsk)
+		return -ESRCH;
+
+	memset(q, 0, sizeof(*q));
+	q->pid = pid;
+
+	if (!ptrace_may_access(tsk, PTRACE_MODE_READ_FSCREDS))
+		mask &= TASKSTATS_QUERY_STAT | TASKSTATS_QUERY_STATUS;
+	mm = get_task_mm(tsk);
+	if (!mm)
+		mask &= ~(TASKSTATS_QUERY_MEM | TASKSTATS_QUERY_PSS);
+
+	if (mask & TASKSTATS_QUERY_STAT)
+		query_fill_stat(tsk, mm, task_active_pid_ns(current), q);
+	if (mask & TASKSTATS_QUERY_STATUS)
+		query_fill_status(tsk, q);
+	if (mask & TASKSTATS_QUERY_IO)
+		query_fill_io(tsk, q);
+	if (mask & TASKSTATS_QUERY_MEM)
+		query_fill_mem(mm, q);
+	if (mask & TASKSTATS_QUERY_PSS) {
+		struct proc_mm_pss pss;
+
+		if (proc_mm_pss(mm, &pss) == 0) {
+			q->pss = pss.pss;
+			q->pss_anon = pss.pss_anon;
+			q->pss_file = pss.pss_file;
+			q->pss_shmem = pss.pss_shmem;
+			q->swap_pss = pss.swap_pss;
+		} else {
+			mask &= ~TASKSTATS_QUERY_PSS;
+		}
+	}
+	q->mask = mask;
+
+	if (mm)
+		mmput(mm);
+	put_task_struct(tsk);
+	return 0;
+}
+
+/*
+ * TASKSTATS_CMD_QUERY is a dump so that the replies for any number of pids
+ * can span several messages; cb->args[0] is the index of the next pid.
+ */
+static int taskstats_query_dumpit(struct sk_buff *skb,
+				  struct netlink_callback *cb)
+{
+	const struct genl_dumpit_info *info = genl_dumpit_info(cb);
+	struct nlattr *na = info->attrs[TASKSTATS_QUERY_ATTR_PIDS];
+	const u32 *pids;
+	u32 mask = 0;
+	int i, nr;
+
+	if (!na)
+		return -EINVAL;
+	if (info->attrs[TASKSTATS_QUERY_ATTR_MASK])
+		mask = nla_get_u32(info->attrs[TASKSTATS_QUERY_ATTR_MASK]);
+
+	pids = nla_data(na);
+	nr = nla_len(na) / sizeof(u32);
+
+	for (i = cb->args[0]; i < nr; i++) {
+		struct taskstats_query *q;
+		struct nlattr *attr;
+		void *hdr;
+
+		hdr = genlmsg_put(skb, NETLINK_CB(cb->skb).portid,
+				  cb->nlh->nlmsg_seq, &family, NLM_F_MULTI,
+				  TASKSTATS_CMD_QUERY);
+		if (!hdr)
+			break;
+
+		attr = nla_reserve_64bit(skb, TASKSTATS_TYPE_QUERY,
+					 sizeof(*q), TASKSTATS_TYPE_NULL);
+		if (!attr) {
+			genlmsg_cancel(skb, hdr);
+			break;
+		}
+
+		q = nla_data(attr);
+		if (fill_query_for_pid(pids[i], mask, q) < 0) {
+			genlmsg_cancel(skb, hdr);
+			continue;
+		}
+		genlmsg_end(skb, hdr);
+		cond_resched();
+	}
+
+	cb->args[0] = i;
+	return skb->len;
+}
+
 static struct taskstats *taskstats_tgid_alloc(struct task_struct *tsk)
 {
 	struct signal_struct *sig = tsk->signal;
@@ -656,6 +868,14 @@ static const struct genl_ops taskstats_ops[] = {
 		.policy		= cgroupstats_cmd_get_policy,
 		.maxattr	= ARRAY_SIZE(cgroupstats_cmd_get_policy) - 1,
 	},
+	{
+		.cmd		= TASKSTATS_CMD_QUERY,
+		.validate	= GENL_DONT_VALIDATE_STRICT,
+		.dumpit		= taskstats_query_dumpit,
+		.policy		= taskstats_cmd_query_policy,
+		.maxattr	= ARRAY_SIZE(taskstats_cmd_query_policy) - 1,
+		.flags		= GENL_ADMIN_PERM,
+	},
 };
 
 static struct genl_family family __ro_after_init = {
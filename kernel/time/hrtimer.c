@@ -1865,6 +1865,9 @@ void hrtimer_start_range_ns(struct hrtimer *timer, ktime_t tim,
 	else
 		WARN_ON_ONCE(!(mode & HRTIMER_MODE_HARD) ^ !timer->is_hard);
 
+	/* Let the timer share the interrupt of the ones in its window. */
+	delta_ns = max_t(u64, delta_ns, timer->slack);
+
 	base = lock_hrtimer_base(timer, &flags);
 
 /*
@@ -2515,6 +2518,11 @@ static void __hrtimer_run_queues(struct hrtimer_cpu_base *cpu_base, ktime_t now,
 			if (basenow < hrtimer_get_softexpires_tv64(timer))
 				break;
 
+#ifdef CONFIG_HIGH_RES_TIMERS
+			/* Would have needed an interrupt of its own. */
+			if (basenow < hrtimer_get_expires_tv64(timer))
+				cpu_base->nr_coalesced++;
+#endif
 			__run_hrtimer(cpu_base, base, timer, &basenow, flags);
 			if (active_mask == HRTIMER_ACTIVE_SOFT)
 				hrtimer_sync_wait_running(cpu_base, flags);
@@ -179,6 +179,7 @@ static inline void timers_update_nohz(void) { }
 DECLARE_PER_CPU(struct hrtimer_cpu_base, hrtimer_bases);
 
 extern u64 get_next_timer_interrupt(unsigned long basej, u64 basem);
+extern u64 timer_base_try_to_set_idle(void);
 void timer_clear_idle(void);
 
 #define CLOCK_SET_WALL							\
@@ -995,6 +995,16 @@ static void tick_nohz_stop_tick(struct tick_sched *ts, int cpu)
 	/* Make sure we won't be trying to stop it twice in a row. */
 	ts->timer_expires_base = 0;
 
+	/*
+	 * Going idle: the global timers get handed over to the timer
+	 * migration hierarchy, which also tells whether we're the one left
+	 * to wake up for them, ours or the ones of other idle CPUs.
+	 */
+	if (ts->inidle) {
+		expires = min_t(u64, expires, timer_base_try_to_set_idle());
+		tick = expires;
+	}
+
 	/*
 	 * If this CPU is the one which updates jiffies, then give up
 	 * the assignment and let it be taken by the CPU which runs
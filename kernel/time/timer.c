@@ -52,6 +52,7 @@
 #include <asm/io.h>
 
 #include "tick-internal.h"
+#include "timer_migration.h"
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/timer.h>
@@ -268,17 +269,25 @@ EXPORT_SYMBOL(jiffies_64);
  */
 #define WHEEL_SIZE	(LVL_SIZE * LVL_DEPTH)
 
+/*
+ * With NO_HZ_COMMON timers are split over three bases: BASE_LOCAL holds the
+ * pinned timers, which are always expired by their CPU, BASE_GLOBAL the ones
+ * which may be expired by another CPU while their CPU is idle, see
+ * timer_migration.c, and BASE_DEF the deferrable ones.
+ */
 #ifdef CONFIG_NO_HZ_COMMON
-# define NR_BASES	2
-# define BASE_STD	0
+# define NR_BASES	3
+# define BASE_LOCAL	0
+# define BASE_GLOBAL	1
 /*
  * IAMROOT, 2022.09.03:
  * - NOHZ용 (deffered 가능한).
  */
-# define BASE_DEF	1
+# define BASE_DEF	2
 #else
 # define NR_BASES	1
-# define BASE_STD	0
+# define BASE_LOCAL	0
+# define BASE_GLOBAL	0
 # define BASE_DEF	0
 #endif
 
@@ -303,6 +312,9 @@ static DEFINE_PER_CPU(struct timer_base, timer_bases[NR_BASES]);
 
 #ifdef CONFIG_NO_HZ_COMMON
 
+/* First expiry of BASE_GLOBAL, handed to the hierarchy on idle tick stop. */
+static DEFINE_PER_CPU(u64, timer_next_global) = KTIME_MAX;
+
 static DEFINE_STATIC_KEY_FALSE(timers_nohz_active);
 static DEFINE_MUTEX(timer_keys_mutex);
 
@@ -1215,7 +1227,8 @@ static int detach_if_pending(struct timer_list *timer, struct timer_base *base,
  */
 static inline struct timer_base *get_timer_cpu_base(u32 tflags, u32 cpu)
 {
-	struct timer_base *base = per_cpu_ptr(&timer_bases[BASE_STD], cpu);
+	int index = tflags & TIMER_PINNED ? BASE_LOCAL : BASE_GLOBAL;
+	struct timer_base *base = per_cpu_ptr(&timer_bases[index], cpu);
 
 	/*
 	 * If the timer is deferrable and NO_HZ_COMMON is set then we need
@@ -1236,7 +1249,8 @@ static inline struct timer_base *get_timer_cpu_base(u32 tflags, u32 cpu)
  */
 static inline struct timer_base *get_timer_this_cpu_base(u32 tflags)
 {
-	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
+	int index = tflags & TIMER_PINNED ? BASE_LOCAL : BASE_GLOBAL;
+	struct timer_base *base = this_cpu_ptr(&timer_bases[index]);
 
 	/*
 	 * If the timer is deferrable and NO_HZ_COMMON is set then we need
@@ -1272,8 +1286,15 @@ get_target_base(struct timer_base *base, unsigned tflags)
  *
  */
 	if (static_branch_likely(&timers_migration_enabled) &&
-	    !(tflags & TIMER_PINNED))
+	    !(tflags & TIMER_PINNED)) {
+		/*
+		 * The timer stays here, should this CPU go idle it is
+		 * handed over to a busy one from the hierarchy instead.
+		 */
+		if (tmigr_cpu_available())
+			return get_timer_this_cpu_base(tflags);
 		return get_timer_cpu_base(tflags, get_nohz_timer_target());
+	}
 #endif
 
 /*
@@ -1744,7 +1765,11 @@ void add_timer_on(struct timer_list *timer, int cpu)
 
 	BUG_ON(timer_pending(timer) || !timer->function);
 
-	new_base = get_timer_cpu_base(timer->flags, cpu);
+	/*
+	 * A timer explicitly queued on @cpu must be expired there, not by
+	 * whichever CPU the timer migration hierarchy picks.
+	 */
+	new_base = get_timer_cpu_base(timer->flags | TIMER_PINNED, cpu);
 
 	/*
 	 * If @timer was on a different CPU, it should be migrated with the
@@ -1759,7 +1784,7 @@ void add_timer_on(struct timer_list *timer, int cpu)
 		base = new_base;
 		raw_spin_lock(&base->lock);
 		WRITE_ONCE(timer->flags,
-			   (timer->flags & ~TIMER_BASEMASK) | cpu);
+			   (timer->flags & ~TIMER_BASEMASK) | cpu | TIMER_PINNED);
 	}
 	forward_timer_base(base);
 
@@ -2346,28 +2371,20 @@ static u64 cmp_next_hrtimer_event(u64 basem, u64 expires)
 	return DIV_ROUND_UP_ULL(nextevt, TICK_NSEC) * TICK_NSEC;
 }
 
-/**
- * get_next_timer_interrupt - return the time (clock mono) of the next timer
- * @basej:	base time jiffies
- * @basem:	base time clock monotonic
+/*
+ * Forward @base and return the clock monotonic time of its first timer,
+ * KTIME_MAX if none. Marks the base idle when that is more than a tick
+ * away: the tick is about to be stopped, so any added timer must forward
+ * the base clk itself to keep granularity small.
  *
- * Returns the tick aligned clock monotonic time of the next pending
- * timer or KTIME_MAX if no timer is pending.
+ * Called with @base->lock held.
  */
-u64 get_next_timer_interrupt(unsigned long basej, u64 basem)
+static u64 next_timer_interrupt_base(struct timer_base *base,
+				     unsigned long basej, u64 basem)
 {
-	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
 	u64 expires = KTIME_MAX;
 	unsigned long nextevt;
 
-	/*
-	 * Pretend that there is no timer pending if the cpu is offline.
-	 * Possible pending timers will be migrated later to an active cpu.
-	 */
-	if (cpu_is_offline(smp_processor_id()))
-		return expires;
-
-	raw_spin_lock(&base->lock);
 	if (base->next_expiry_recalc)
 		base->next_expiry = __next_timer_interrupt(base);
 	nextevt = base->next_expiry;
@@ -2391,20 +2408,74 @@ u64 get_next_timer_interrupt(unsigned long basej, u64 basem)
 		if (base->timers_pending)
 			expires = basem + (u64)(nextevt - basej) * TICK_NSEC;
 		/*
-		 * If we expect to sleep more than a tick, mark the base idle.
-		 * Also the tick is stopped so any added timer must forward
-		 * the base clk itself to keep granularity small. This idle
-		 * logic is only maintained for the BASE_STD base, deferrable
-		 * timers may still see large granularity skew (by design).
+		 * This idle logic is only maintained for the BASE_LOCAL and
+		 * BASE_GLOBAL bases, deferrable timers may still see large
+		 * granularity skew (by design).
 		 */
 		if ((expires - basem) > TICK_NSEC)
 			base->is_idle = true;
 	}
-	raw_spin_unlock(&base->lock);
+
+	return expires;
+}
+
+/**
+ * get_next_timer_interrupt - return the time (clock mono) of the next timer
+ * @basej:	base time jiffies
+ * @basem:	base time clock monotonic
+ *
+ * Returns the tick aligned clock monotonic time of the next pending
+ * timer or KTIME_MAX if no timer is pending.
+ *
+ * The first global timer is only taken into account if this CPU would
+ * have to expire it itself once idle, see tmigr_quick_check().
+ */
+u64 get_next_timer_interrupt(unsigned long basej, u64 basem)
+{
+	struct timer_base *base_local = this_cpu_ptr(&timer_bases[BASE_LOCAL]);
+	struct timer_base *base_global = this_cpu_ptr(&timer_bases[BASE_GLOBAL]);
+	u64 expires, global;
+
+	/*
+	 * Pretend that there is no timer pending if the cpu is offline.
+	 * Possible pending timers will be migrated later to an active cpu.
+	 */
+	if (cpu_is_offline(smp_processor_id())) {
+		__this_cpu_write(timer_next_global, KTIME_MAX);
+		return KTIME_MAX;
+	}
+
+	raw_spin_lock(&base_local->lock);
+	raw_spin_lock_nested(&base_global->lock, SINGLE_DEPTH_NESTING);
+
+	expires = next_timer_interrupt_base(base_local, basej, basem);
+	global = next_timer_interrupt_base(base_global, basej, basem);
+	__this_cpu_write(timer_next_global, global);
+
+	raw_spin_unlock(&base_global->lock);
+	raw_spin_unlock(&base_local->lock);
+
+	expires = min(expires, tmigr_quick_check(global));
 
 	return cmp_next_hrtimer_event(basem, expires);
 }
 
+/**
+ * timer_base_try_to_set_idle - hand the global timers over on idle entry
+ *
+ * To be called once the tick is actually being stopped in idle, right
+ * after get_next_timer_interrupt().
+ *
+ * Called with interrupts disabled.
+ *
+ * Return: The time this CPU has to wake up at for global timers, its own
+ * ones or the ones of other idle CPUs, KTIME_MAX if none.
+ */
+u64 timer_base_try_to_set_idle(void)
+{
+	return tmigr_cpu_deactivate(__this_cpu_read(timer_next_global));
+}
+
 /**
  * timer_clear_idle - Clear the idle state of the timer base
  *
@@ -2416,8 +2487,6 @@ u64 get_next_timer_interrupt(unsigned long basej, u64 basem)
  */
 void timer_clear_idle(void)
 {
-	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
-
 	/*
 	 * We do this unlocked. The worst outcome is a remote enqueue sending
 	 * a pointless IPI, but taking the lock would just make the window for
@@ -2431,7 +2500,11 @@ void timer_clear_idle(void)
  *   인큐(enqueue)이지만, 잠금을 사용하면 유휴 경로에서 종료할 때 잠금을 사용하는 
  *   비용에 비해 IPI를 보내는 데 필요한 몇 가지 명령이 더 작아집니다. 
  */
-	base->is_idle = false;
+	__this_cpu_write(timer_bases[BASE_LOCAL].is_idle, false);
+	__this_cpu_write(timer_bases[BASE_GLOBAL].is_idle, false);
+
+	/* We're back in charge of our global timers. */
+	tmigr_cpu_activate();
 }
 #endif
 
@@ -2459,6 +2532,17 @@ static inline void __run_timers(struct timer_base *base)
 	timer_base_lock_expiry(base);
 	raw_spin_lock_irq(&base->lock);
 
+	/*
+	 * The global base of an idle CPU is expired remotely by the timer
+	 * migration hierarchy; if that is still going on when the CPU comes
+	 * back, leave the timers to the remote CPU.
+	 */
+	if (base->running_timer) {
+		raw_spin_unlock_irq(&base->lock);
+		timer_base_unlock_expiry(base);
+		return;
+	}
+
 /*
  * IAMROOT, 2022.09.03:
  * 
@@ -2499,13 +2583,52 @@ static inline void __run_timers(struct timer_base *base)
  */
 static __latent_entropy void run_timer_softirq(struct softirq_action *h)
 {
-	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
+	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_LOCAL]);
 
 	__run_timers(base);
-	if (IS_ENABLED(CONFIG_NO_HZ_COMMON))
+	if (IS_ENABLED(CONFIG_NO_HZ_COMMON)) {
+		__run_timers(this_cpu_ptr(&timer_bases[BASE_GLOBAL]));
 		__run_timers(this_cpu_ptr(&timer_bases[BASE_DEF]));
+		tmigr_handle_remote();
+	}
 }
 
+#ifdef CONFIG_TIMER_MIGRATION
+/**
+ * timer_expire_remote - expire the global timers of an idle CPU
+ * @cpu:	the idle CPU the caller is in charge of
+ *
+ * Called from tmigr_handle_remote() with interrupts enabled.
+ *
+ * Return: The clock monotonic time of the next global timer of @cpu,
+ * KTIME_MAX if none.
+ */
+u64 timer_expire_remote(unsigned int cpu)
+{
+	struct timer_base *base = per_cpu_ptr(&timer_bases[BASE_GLOBAL], cpu);
+	unsigned long basej, flags;
+	u64 basem, expires = KTIME_MAX;
+
+	__run_timers(base);
+
+	raw_spin_lock_irqsave(&base->lock, flags);
+	basem = ktime_get();
+	basej = jiffies;
+	if (base->next_expiry_recalc)
+		base->next_expiry = __next_timer_interrupt(base);
+	if (base->timers_pending) {
+		if (time_before_eq(base->next_expiry, basej))
+			expires = basem;
+		else
+			expires = basem +
+				  (u64)(base->next_expiry - basej) * TICK_NSEC;
+	}
+	raw_spin_unlock_irqrestore(&base->lock, flags);
+
+	return expires;
+}
+#endif
+
 /*
  * Called by the local, per-CPU timer interrupt on SMP.
  */
@@ -2516,7 +2639,7 @@ static __latent_entropy void run_timer_softirq(struct softirq_action *h)
  */
 static void run_local_timers(void)
 {
-	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
+	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_LOCAL]);
 
 	hrtimer_run_queues();
 	/* Raise the softirq only if required. */
@@ -2528,9 +2651,11 @@ static void run_local_timers(void)
 	if (time_before(jiffies, base->next_expiry)) {
 		if (!IS_ENABLED(CONFIG_NO_HZ_COMMON))
 			return;
-		/* CPU is awake, so check the deferrable base. */
+		/* CPU is awake, so check the global and deferrable bases. */
 		base++;
-		if (time_before(jiffies, base->next_expiry))
+		if (time_before(jiffies, base->next_expiry) &&
+		    time_before(jiffies, base[1].next_expiry) &&
+		    !tmigr_requires_handle_remote())
 			return;
 	}
 /*
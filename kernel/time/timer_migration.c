@@ -0,0 +1,534 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Timer migration hierarchy
+ *
+ * Timers which aren't pinned to a CPU used to be queued on a busy CPU at
+ * enqueue time (get_nohz_timer_target()). That wakes up idle CPUs for no
+ * reason, piles the timers up on the housekeeping CPU, and the busy CPU
+ * picked at enqueue time may well be idle by the time the timer expires.
+ *
+ * Instead, such "global" timers now stay on the CPU they are queued on, and
+ * a CPU stopping its tick in idle hands the expiry of its global timers over
+ * to the CPUs which are still active:
+ *
+ *  - CPUs are grouped by NUMA node, at most TMIGR_CHILDREN_PER_GROUP per
+ *    group. Each group has a migrator, one of its active CPUs, which
+ *    expires the global timers of the idle CPUs of the group from its tick.
+ *
+ *  - When the last CPU of a group goes idle, the group itself goes idle in
+ *    the root, whose migrator, the migrator of one of the active groups,
+ *    expires the timers of the idle groups.
+ *
+ *  - When the last CPU of the system goes idle, it stays the migrator of
+ *    its group and of the root and wakes up for the first global timer of
+ *    all idle CPUs.
+ *
+ * So only one CPU per group, or one in the system, sees each global timer
+ * and deep idle periods last longer. Everything is serialized by the group
+ * locks, nested group -> root; the state is only changed on idle entry and
+ * exit and when remote timers got expired.
+ *
+ * CPUs outside of the timer housekeeping mask (nohz_full) don't take part,
+ * they keep pushing their timers to a busy CPU at enqueue time.
+ */
+#include <linux/cpuhotplug.h>
+#include <linux/cpumask.h>
+#include <linux/init.h>
+#include <linux/ktime.h>
+#include <linux/percpu.h>
+#include <linux/sched/isolation.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/topology.h>
+
+#include "tick-internal.h"
+#include "timer_migration.h"
+
+#define TMIGR_CHILDREN_PER_GROUP	8
+
+struct tmigr_group {
+	raw_spinlock_t		lock;
+	struct tmigr_group	*parent;	/* the root, NULL for the root */
+	unsigned int		nr_active;	/* active children */
+	/*
+	 * Group: an active CPU, or the last one to go idle.
+	 * Root: unused, see @migrator_grp.
+	 */
+	int			migrator;
+	/* Root: an active group, or the last one to go idle. */
+	struct tmigr_group	*migrator_grp;
+	/* first event of the idle children, KTIME_MAX if none */
+	u64			next_expiry;
+	/* Group: whether it's active in the root. Protected by root lock */
+	bool			active;
+	cpumask_var_t		cpus;		/* group only */
+};
+
+struct tmigr_cpu {
+	bool			online;		/* part of the hierarchy */
+	bool			idle;		/* tick stopped in idle */
+	/* first global timer of an idle CPU, KTIME_MAX if none or handled */
+	u64			next;
+	/* the hierarchy event this CPU wakes up for while idle */
+	u64			wakeup;
+	struct tmigr_group	*group;
+};
+
+static DEFINE_PER_CPU(struct tmigr_cpu, tmigr_cpu);
+
+static struct tmigr_group *tmigr_groups;
+static unsigned int tmigr_nr_groups;
+static struct tmigr_group tmigr_root;
+
+bool tmigr_cpu_available(void)
+{
+	return this_cpu_ptr(&tmigr_cpu)->online;
+}
+
+/* Called with @grp->lock held. */
+static void tmigr_group_recalc(struct tmigr_group *grp)
+{
+	u64 next = KTIME_MAX;
+	int cpu;
+
+	for_each_cpu(cpu, grp->cpus) {
+		struct tmigr_cpu *tmc = per_cpu_ptr(&tmigr_cpu, cpu);
+
+		if (tmc->online && tmc->idle)
+			next = min(next, tmc->next);
+	}
+	WRITE_ONCE(grp->next_expiry, next);
+
+	if (grp->nr_active)
+		return;
+
+	/* make sure the migrator of an idle group can't be a stale one */
+	if (!per_cpu_ptr(&tmigr_cpu, grp->migrator)->online)
+		grp->migrator = cpumask_first(grp->cpus);
+}
+
+/* Called with the root lock held. */
+static void tmigr_root_recalc(void)
+{
+	u64 next = KTIME_MAX;
+	unsigned int i;
+
+	for (i = 0; i < tmigr_nr_groups; i++) {
+		if (!tmigr_groups[i].active)
+			next = min(next, READ_ONCE(tmigr_groups[i].next_expiry));
+	}
+	WRITE_ONCE(tmigr_root.next_expiry, next);
+}
+
+static int tmigr_pick_cpu(struct tmigr_group *grp)
+{
+	int cpu;
+
+	for_each_cpu(cpu, grp->cpus) {
+		struct tmigr_cpu *tmc = per_cpu_ptr(&tmigr_cpu, cpu);
+
+		if (tmc->online && !tmc->idle)
+			return cpu;
+	}
+	return grp->migrator;
+}
+
+static struct tmigr_group *tmigr_pick_group(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < tmigr_nr_groups; i++) {
+		if (tmigr_groups[i].active)
+			return &tmigr_groups[i];
+	}
+	return tmigr_root.migrator_grp;
+}
+
+/*
+ * Propagate the state of @grp, whose lock is held, to the root. Returns the
+ * event @cpu has to handle, KTIME_MAX if another CPU takes care of it.
+ */
+static u64 tmigr_update_root(struct tmigr_group *grp, int cpu)
+{
+	struct tmigr_group *root = grp->parent;
+	bool active = grp->nr_active;
+	u64 wakeup = KTIME_MAX;
+
+	if (!root)
+		return active ? KTIME_MAX : grp->next_expiry;
+
+	raw_spin_lock_nested(&root->lock, SINGLE_DEPTH_NESTING);
+	if (grp->active != active) {
+		grp->active = active;
+		if (active)
+			root->nr_active++;
+		else
+			root->nr_active--;
+	}
+	tmigr_root_recalc();
+
+	if (active) {
+		if (!root->migrator_grp || !root->migrator_grp->active)
+			WRITE_ONCE(root->migrator_grp, grp);
+	} else if (root->nr_active) {
+		if (root->migrator_grp == grp)
+			WRITE_ONCE(root->migrator_grp, tmigr_pick_group());
+	} else {
+		/* the whole system is idle, @cpu is the one left in charge */
+		WRITE_ONCE(root->migrator_grp, grp);
+		wakeup = root->next_expiry;
+	}
+	raw_spin_unlock(&root->lock);
+
+	return wakeup;
+}
+
+static void __tmigr_cpu_activate(struct tmigr_cpu *tmc, int cpu)
+{
+	struct tmigr_group *grp = tmc->group;
+
+	raw_spin_lock(&grp->lock);
+	tmc->idle = false;
+	tmc->next = KTIME_MAX;
+	tmc->wakeup = KTIME_MAX;
+	if (!grp->nr_active++)
+		WRITE_ONCE(grp->migrator, cpu);
+	tmigr_group_recalc(grp);
+	tmigr_update_root(grp, cpu);
+	raw_spin_unlock(&grp->lock);
+}
+
+/**
+ * tmigr_cpu_activate - the tick of the current CPU is running again
+ *
+ * Called with interrupts disabled.
+ */
+void tmigr_cpu_activate(void)
+{
+	struct tmigr_cpu *tmc = this_cpu_ptr(&tmigr_cpu);
+
+	if (!tmc->online || !tmc->idle)
+		return;
+
+	__tmigr_cpu_activate(tmc, smp_processor_id());
+}
+
+static u64 __tmigr_cpu_deactivate(struct tmigr_cpu *tmc, int cpu, u64 nextexp)
+{
+	struct tmigr_group *grp = tmc->group;
+	u64 wakeup = KTIME_MAX;
+
+	raw_spin_lock(&grp->lock);
+	if (!tmc->idle) {
+		tmc->idle = true;
+		grp->nr_active--;
+	}
+	tmc->next = nextexp;
+	tmigr_group_recalc(grp);
+
+	if (grp->nr_active) {
+		if (grp->migrator == cpu)
+			WRITE_ONCE(grp->migrator, tmigr_pick_cpu(grp));
+	} else {
+		/* last one out, keep an eye on the group */
+		WRITE_ONCE(grp->migrator, cpu);
+	}
+	wakeup = tmigr_update_root(grp, cpu);
+	WRITE_ONCE(tmc->wakeup, wakeup);
+	raw_spin_unlock(&grp->lock);
+
+	return wakeup;
+}
+
+/**
+ * tmigr_cpu_deactivate - hand the global timers over on idle tick stop
+ * @nextexp:	the first global timer of the current CPU, KTIME_MAX if none
+ *
+ * Can be called again while the CPU is idle already, to update @nextexp.
+ * With timer migration disabled through sysctl the CPU still leaves the
+ * hierarchy, so it won't be picked as a migrator, but keeps its timers.
+ *
+ * Called with interrupts disabled.
+ *
+ * Return: The time the current CPU has to wake up at to expire global
+ * timers, its own or the ones of other idle CPUs, KTIME_MAX if none.
+ */
+u64 tmigr_cpu_deactivate(u64 nextexp)
+{
+	struct tmigr_cpu *tmc = this_cpu_ptr(&tmigr_cpu);
+	u64 wakeup;
+
+	if (!tmc->online)
+		return nextexp;
+
+	if (!static_branch_likely(&timers_migration_enabled)) {
+		wakeup = __tmigr_cpu_deactivate(tmc, smp_processor_id(),
+						KTIME_MAX);
+		return min(wakeup, nextexp);
+	}
+
+	return __tmigr_cpu_deactivate(tmc, smp_processor_id(), nextexp);
+}
+
+/**
+ * tmigr_quick_check - guess what tmigr_cpu_deactivate() will return
+ * @nextexp:	the first global timer of the current CPU, KTIME_MAX if none
+ *
+ * Lockless and racy, for tick_nohz_next_event() which may only be asking
+ * for the idle governor's sake.
+ */
+u64 tmigr_quick_check(u64 nextexp)
+{
+	struct tmigr_cpu *tmc = this_cpu_ptr(&tmigr_cpu);
+	struct tmigr_group *grp = tmc->group;
+
+	if (!tmc->online || !static_branch_likely(&timers_migration_enabled))
+		return nextexp;
+
+	/* somebody else in the group will still be around */
+	if (READ_ONCE(grp->nr_active) > !tmc->idle)
+		return KTIME_MAX;
+
+	if (grp->parent && READ_ONCE(grp->parent->nr_active) > grp->active)
+		return KTIME_MAX;
+
+	return nextexp;
+}
+
+static bool tmigr_is_migrator(struct tmigr_group *grp, int cpu)
+{
+	return READ_ONCE(grp->migrator) == cpu;
+}
+
+static bool tmigr_is_root_migrator(struct tmigr_group *grp, int cpu)
+{
+	return grp->parent && READ_ONCE(grp->parent->migrator_grp) == grp &&
+	       tmigr_is_migrator(grp, cpu);
+}
+
+/**
+ * tmigr_requires_handle_remote - check for remote timers to expire
+ *
+ * Called from the tick, also in idle, to decide whether TIMER_SOFTIRQ has
+ * to be raised for tmigr_handle_remote().
+ */
+bool tmigr_requires_handle_remote(void)
+{
+	struct tmigr_cpu *tmc = this_cpu_ptr(&tmigr_cpu);
+	int cpu = smp_processor_id();
+	struct tmigr_group *grp = tmc->group;
+	u64 next = KTIME_MAX;
+
+	if (!tmc->online)
+		return false;
+
+	if (READ_ONCE(tmc->idle)) {
+		next = READ_ONCE(tmc->wakeup);
+	} else {
+		if (tmigr_is_migrator(grp, cpu))
+			next = READ_ONCE(grp->next_expiry);
+		if (tmigr_is_root_migrator(grp, cpu))
+			next = min(next, READ_ONCE(grp->parent->next_expiry));
+	}
+
+	return next != KTIME_MAX && next <= ktime_get();
+}
+
+/*
+ * Expire the global timers of the idle CPUs of @grp which are due, if
+ * @cpu is in charge of @grp, or @force because it's in charge of the root.
+ */
+static void tmigr_handle_group(struct tmigr_group *grp, int cpu, u64 now,
+			       bool force)
+{
+	int expire[TMIGR_CHILDREN_PER_GROUP];
+	unsigned int nr = 0, i;
+	unsigned long flags;
+	int rcpu;
+
+	raw_spin_lock_irqsave(&grp->lock, flags);
+	if ((!force && grp->migrator != cpu) || grp->next_expiry > now) {
+		raw_spin_unlock_irqrestore(&grp->lock, flags);
+		return;
+	}
+	for_each_cpu(rcpu, grp->cpus) {
+		struct tmigr_cpu *tmc = per_cpu_ptr(&tmigr_cpu, rcpu);
+
+		if (tmc->online && tmc->idle && tmc->next <= now)
+			expire[nr++] = rcpu;
+	}
+	raw_spin_unlock_irqrestore(&grp->lock, flags);
+
+	/* The callbacks can't run under the group lock, they may arm timers. */
+	for (i = 0; i < nr; i++) {
+		struct tmigr_cpu *tmc = per_cpu_ptr(&tmigr_cpu, expire[i]);
+		u64 next = timer_expire_remote(expire[i]);
+
+		raw_spin_lock_irqsave(&grp->lock, flags);
+		/* an idle CPU coming back takes care of itself again */
+		if (tmc->idle)
+			tmc->next = next;
+		raw_spin_unlock_irqrestore(&grp->lock, flags);
+	}
+
+	raw_spin_lock_irqsave(&grp->lock, flags);
+	tmigr_group_recalc(grp);
+	tmigr_update_root(grp, cpu);
+	raw_spin_unlock_irqrestore(&grp->lock, flags);
+}
+
+/**
+ * tmigr_handle_remote - expire the timers of idle CPUs we're in charge of
+ *
+ * Called from TIMER_SOFTIRQ.
+ */
+void tmigr_handle_remote(void)
+{
+	struct tmigr_cpu *tmc = this_cpu_ptr(&tmigr_cpu);
+	int cpu = smp_processor_id();
+	struct tmigr_group *grp = tmc->group;
+	unsigned int i;
+	u64 now;
+
+	if (!tmc->online)
+		return;
+
+	now = ktime_get();
+	tmigr_handle_group(grp, cpu, now, false);
+
+	if (!tmigr_is_root_migrator(grp, cpu) ||
+	    READ_ONCE(tmigr_root.next_expiry) > now)
+		return;
+
+	for (i = 0; i < tmigr_nr_groups; i++) {
+		struct tmigr_group *rgrp = &tmigr_groups[i];
+
+		if (rgrp != grp && !READ_ONCE(rgrp->active))
+			tmigr_handle_group(rgrp, cpu, now, true);
+	}
+}
+
+static int tmigr_cpu_online(unsigned int cpu)
+{
+	struct tmigr_cpu *tmc = per_cpu_ptr(&tmigr_cpu, cpu);
+
+	if (!tmc->group)
+		return 0;
+
+	raw_spin_lock_irq(&tmc->group->lock);
+	tmc->online = true;
+	tmc->idle = true;
+	raw_spin_unlock_irq(&tmc->group->lock);
+
+	local_irq_disable();
+	__tmigr_cpu_activate(tmc, cpu);
+	local_irq_enable();
+	return 0;
+}
+
+static int tmigr_cpu_offline(unsigned int cpu)
+{
+	struct tmigr_cpu *tmc = per_cpu_ptr(&tmigr_cpu, cpu);
+
+	if (!tmc->online)
+		return 0;
+
+	/* The timers of @cpu are migrated to a live CPU once it's dead. */
+	local_irq_disable();
+	__tmigr_cpu_deactivate(tmc, cpu, KTIME_MAX);
+	raw_spin_lock(&tmc->group->lock);
+	tmc->online = false;
+	tmigr_group_recalc(tmc->group);
+	raw_spin_unlock(&tmc->group->lock);
+	local_irq_enable();
+	return 0;
+}
+
+static void __init tmigr_init_group(struct tmigr_group *grp,
+				    struct tmigr_group *parent)
+{
+	raw_spin_lock_init(&grp->lock);
+	grp->parent = parent;
+	grp->next_expiry = KTIME_MAX;
+}
+
+static int __init tmigr_init(void)
+{
+	const struct cpumask *hk = housekeeping_cpumask(HK_FLAG_TIMER);
+	unsigned int nr, i;
+	int cpu, ret;
+
+	/* only needed when there is more than one CPU to hand timers to */
+	if (cpumask_weight(hk) < 2)
+		return 0;
+
+	/* every node can leave one group partially filled */
+	nr = DIV_ROUND_UP(num_possible_cpus(), TMIGR_CHILDREN_PER_GROUP) +
+	     nr_node_ids;
+
+	tmigr_groups = kcalloc(nr, sizeof(*tmigr_groups), GFP_KERNEL);
+	if (!tmigr_groups)
+		goto err;
+
+	tmigr_init_group(&tmigr_root, NULL);
+
+	for_each_cpu(cpu, hk) {
+		struct tmigr_group *grp = NULL;
+
+		if (!cpu_possible(cpu))
+			continue;
+
+		/* the last group of the node, if it has room left */
+		for (i = 0; i < tmigr_nr_groups; i++) {
+			int first = cpumask_first(tmigr_groups[i].cpus);
+
+			if (cpu_to_node(first) == cpu_to_node(cpu) &&
+			    cpumask_weight(tmigr_groups[i].cpus) <
+			    TMIGR_CHILDREN_PER_GROUP)
+				grp = &tmigr_groups[i];
+		}
+
+		if (!grp) {
+			if (WARN_ON_ONCE(tmigr_nr_groups == nr))
+				goto err;
+			grp = &tmigr_groups[tmigr_nr_groups];
+			if (!zalloc_cpumask_var(&grp->cpus, GFP_KERNEL))
+				goto err;
+			tmigr_nr_groups++;
+			tmigr_init_group(grp, NULL);
+			grp->migrator = cpu;
+		}
+
+		cpumask_set_cpu(cpu, grp->cpus);
+		per_cpu_ptr(&tmigr_cpu, cpu)->group = grp;
+		per_cpu_ptr(&tmigr_cpu, cpu)->next = KTIME_MAX;
+		per_cpu_ptr(&tmigr_cpu, cpu)->wakeup = KTIME_MAX;
+	}
+
+	/* a single group doesn't need a root above it */
+	if (tmigr_nr_groups > 1) {
+		for (i = 0; i < tmigr_nr_groups; i++)
+			tmigr_groups[i].parent = &tmigr_root;
+	}
+
+	ret = cpuhp_setup_state(CPUHP_AP_ONLINE_DYN, "tmigr:online",
+				tmigr_cpu_online, tmigr_cpu_offline);
+	if (ret < 0)
+		goto err;
+
+	pr_info("Timer migration: %u groups of up to %d CPUs\n",
+		tmigr_nr_groups, TMIGR_CHILDREN_PER_GROUP);
+	return 0;
+
+err:
+	for_each_possible_cpu(cpu)
+		per_cpu_ptr(&tmigr_cpu, cpu)->group = NULL;
+	for (i = 0; i < tmigr_nr_groups; i++)
+		free_cpumask_var(tmigr_groups[i].cpus);
+	kfree(tmigr_groups);
+	tmigr_groups = NULL;
+	tmigr_nr_groups = 0;
+	pr_err("Timer migration setup failed\n");
+	return 0;
+}
+early_initcall(tmigr_init);
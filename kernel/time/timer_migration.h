@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef _KERNEL_TIME_MIGRATION_H
+#define _KERNEL_TIME_MIGRATION_H
+
+#include <linux/types.h>
+
+#ifdef CONFIG_TIMER_MIGRATION
+extern bool tmigr_cpu_available(void);
+extern u64 tmigr_quick_check(u64 nextexp);
+extern u64 tmigr_cpu_deactivate(u64 nextexp);
+extern void tmigr_cpu_activate(void);
+extern bool tmigr_requires_handle_remote(void);
+extern void tmigr_handle_remote(void);
+
+/* provided by timer.c */
+extern u64 timer_expire_remote(unsigned int cpu);
+#else
+static inline bool tmigr_cpu_available(void) { return false; }
+/* Without the hierarchy every CPU handles its global timers itself. */
+static inline u64 tmigr_quick_check(u64 nextexp) { return nextexp; }
+static inline u64 tmigr_cpu_deactivate(u64 nextexp) { return nextexp; }
+static inline void tmigr_cpu_activate(void) { }
+static inline bool tmigr_requires_handle_remote(void) { return false; }
+static inline void tmigr_handle_remote(void) { }
+#endif
+
+#endif /* _KERNEL_TIME_MIGRATION_H */
@@ -0,0 +1,307 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * kbench suite for core data structures and allocators.
+ *
+ * What kbench.size means for each case:
+ *   find_next_bit	bits in the bitmap, half of them set, one op walks it
+ *   rbtree		nodes per thread, an op inserts or erases one node
+ *   xarray		indices spread over by the threads, an op stores and
+ *			loads one
+ *   sbitmap		depth of the bitmap, an op gets and puts one bit
+ *   percpu_counter	unused, an op adds one
+ *   kmem_cache		object size, an op allocates and frees one object
+ *   page_alloc		bytes, rounded up to an order, an op allocates and
+ *			frees one block
+ */
+
+#include <linux/bitmap.h>
+#include <linux/gfp.h>
+#include <linux/kbench.h>
+#include <linux/percpu_counter.h>
+#include <linux/random.h>
+#include <linux/rbtree.h>
+#include <linux/sbitmap.h>
+#include <linux/slab.h>
+#include <linux/xarray.h>
+
+static unsigned long bench_sink;
+
+static int bench_find_bit_setup(struct kbench_ctx *ctx)
+{
+	unsigned long *bitmap, i;
+
+	bitmap = bitmap_zalloc(ctx->size, GFP_KERNEL);
+	if (!bitmap)
+		return -ENOMEM;
+
+	for (i = 0; i < ctx->size; i++)
+		if (prandom_u32() & 1)
+			__set_bit(i, bitmap);
+
+	ctx->priv = bitmap;
+	return 0;
+}
+
+static void bench_find_bit_teardown(struct kbench_ctx *ctx)
+{
+	bitmap_free(ctx->priv);
+}
+
+static void bench_find_bit_op(struct kbench_ctx *ctx, unsigned long iter)
+{
+	unsigned long i, cnt = 0;
+
+	for (i = find_first_bit(ctx->priv, ctx->size); i < ctx->size;
+	     i = find_next_bit(ctx->priv, ctx->size, i + 1))
+		cnt++;
+
+	WRITE_ONCE(bench_sink, cnt);
+}
+
+struct bench_rb_node {
+	struct rb_node	node;
+	u32		key;
+};
+
+struct bench_rb {
+	struct rb_root		root;
+	struct bench_rb_node	*nodes;
+};
+
+static bool bench_rb_less(struct rb_node *a, const struct rb_node *b)
+{
+	return rb_entry(a, struct bench_rb_node, node)->key <
+	       rb_entry(b, struct bench_rb_node, node)->key;
+}
+
+static int bench_rbtree_thread_setup(struct kbench_ctx *ctx)
+{
+	struct bench_rb *rb;
+	unsigned long i;
+
+	if (!ctx->size)
+		return -EINVAL;
+
+	rb = kzalloc(sizeof(*rb), GFP_KERNEL);
+	if (!rb)
+		return -ENOMEM;
+
+	rb->nodes = kvmalloc_array(ctx->size, sizeof(*rb->nodes), GFP_KERNEL);
+	if (!rb->nodes) {
+		kfree(rb);
+		return -ENOMEM;
+	}
+	for (i = 0; i < ctx->size; i++)
+		rb->nodes[i].key = prandom_u32();
+	rb->root = RB_ROOT;
+
+	ctx->thread_priv = rb;
+	return 0;
+}
+
+static void bench_rbtree_thread_teardown(struct kbench_ctx *ctx)
+{
+	struct bench_rb *rb = ctx->thread_priv;
+
+	kvfree(rb->nodes);
+	kfree(rb);
+}
+
+/* Alternately fill the tree with all the nodes and empty it again */
+static void bench_rbtree_op(struct kbench_ctx *ctx, unsigned long i)
+{
+	struct bench_rb *rb = ctx->thread_priv;
+	struct bench_rb_node *n = &rb->nodes[i % ctx->size];
+
+	if ((i / ctx->size) & 1)
+		rb_erase(&n->node, &rb->root);
+	else
+		rb_add(&n->node, &rb->root, bench_rb_less);
+}
+
+static int bench_xarray_setup(struct kbench_ctx *ctx)
+{
+	struct xarray *xa;
+
+	if (!ctx->size)
+		return -EINVAL;
+
+	xa = kmalloc(sizeof(*xa), GFP_KERNEL);
+	if (!xa)
+		return -ENOMEM;
+
+	xa_init(xa);
+	ctx->priv = xa;
+	return 0;
+}
+
+static void bench_xarray_teardown(struct kbench_ctx *ctx)
+{
+	xa_destroy(ctx->priv);
+	kfree(ctx->priv);
+}
+
+static void bench_xarray_op(struct kbench_ctx *ctx, unsigned long i)
+{
+	unsigned long index = (i * ctx->threads + ctx->thread) % ctx->size;
+
+	xa_store(ctx->priv, index, xa_mk_value(i), GFP_KERNEL);
+	WRITE_ONCE(bench_sink, xa_to_value(xa_load(ctx->priv, index)));
+}
+
+static int bench_sbitmap_setup(struct kbench_ctx *ctx)
+{
+	struct sbitmap *sb;
+	int ret;
+
+	sb = kmalloc(sizeof(*sb), GFP_KERNEL);
+	if (!sb)
+		return -ENOMEM;
+
+	ret = sbitmap_init_node(sb, min_t(unsigned long, ctx->size, INT_MAX),
+				-1, GFP_KERNEL, NUMA_NO_NODE, false, true);
+	if (ret) {
+		kfree(sb);
+		return ret;
+	}
+
+	ctx->priv = sb;
+	return 0;
+}
+
+static void bench_sbitmap_teardown(struct kbench_ctx *ctx)
+{
+	sbitmap_free(ctx->priv);
+	kfree(ctx->priv);
+}
+
+static void bench_sbitmap_op(struct kbench_ctx *ctx, unsigned long i)
+{
+	int nr = sbitmap_get(ctx->priv);
+
+	if (nr >= 0)
+		sbitmap_put(ctx->priv, nr);
+}
+
+static int bench_percpu_counter_setup(struct kbench_ctx *ctx)
+{
+	struct percpu_counter *c;
+	int ret;
+
+	c = kmalloc(sizeof(*c), GFP_KERNEL);
+	if (!c)
+		return -ENOMEM;
+
+	ret = percpu_counter_init(c, 0, GFP_KERNEL);
+	if (ret) {
+		kfree(c);
+		return ret;
+	}
+
+	ctx->priv = c;
+	return 0;
+}
+
+static void bench_percpu_counter_teardown(struct kbench_ctx *ctx)
+{
+	percpu_counter_destroy(ctx->priv);
+	kfree(ctx->priv);
+}
+
+static void bench_percpu_counter_op(struct kbench_ctx *ctx, unsigned long i)
+{
+	percpu_counter_add(ctx->priv, 1);
+}
+
+static int bench_kmem_cache_setup(struct kbench_ctx *ctx)
+{
+	if (!ctx->size || ctx->size > KMALLOC_MAX_SIZE)
+		return -EINVAL;
+
+	ctx->priv = kmem_cache_create("kbench", ctx->size, 0, 0, NULL);
+	return ctx->priv ? 0 : -ENOMEM;
+}
+
+static void bench_kmem_cache_teardown(struct kbench_ctx *ctx)
+{
+	kmem_cache_destroy(ctx->priv);
+}
+
+static void bench_kmem_cache_op(struct kbench_ctx *ctx, unsigned long i)
+{
+	void *p = kmem_cache_alloc(ctx->priv, GFP_KERNEL);
+
+	if (p)
+		kmem_cache_free(ctx->priv, p);
+}
+
+static int bench_page_alloc_setup(struct kbench_ctx *ctx)
+{
+	if (get_order(ctx->size) >= MAX_ORDER)
+		return -EINVAL;
+
+	return 0;
+}
+
+static void bench_page_alloc_op(struct kbench_ctx *ctx, unsigned long i)
+{
+	unsigned int order = get_order(ctx->size);
+	struct page *page = alloc_pages(GFP_KERNEL, order);
+
+	if (page)
+		__free_pages(page, order);
+}
+
+static const struct kbench_case core_benchmark_cases[] = {
+	{
+		.name		= "find_next_bit",
+		.setup		= bench_find_bit_setup,
+		.teardown	= bench_find_bit_teardown,
+		.op		= bench_find_bit_op,
+	},
+	{
+		.name		= "rbtree",
+		.thread_setup	= bench_rbtree_thread_setup,
+		.thread_teardown = bench_rbtree_thread_teardown,
+		.op		= bench_rbtree_op,
+	},
+	{
+		.name		= "xarray",
+		.setup		= bench_xarray_setup,
+		.teardown	= bench_xarray_teardown,
+		.op		= bench_xarray_op,
+	},
+	{
+		.name		= "sbitmap",
+		.setup		= bench_sbitmap_setup,
+		.teardown	= bench_sbitmap_teardown,
+		.op		= bench_sbitmap_op,
+	},
+	{
+		.name		= "percpu_counter",
+		.setup		= bench_percpu_counter_setup,
+		.teardown	= bench_percpu_counter_teardown,
+		.op		= bench_percpu_counter_op,
+	},
+	{
+		.name		= "kmem_cache",
+		.setup		= bench_kmem_cache_setup,
+		.teardown	= bench_kmem_cache_teardown,
+		.op		= bench_kmem_cache_op,
+	},
+	{
+		.name		= "page_alloc",
+		.setup		= bench_page_alloc_setup,
+		.op		= bench_page_alloc_op,
+	},
+	{}
+};
+
+static const struct kbench_suite core_benchmark = {
+	.name	= "core",
+	.cases	= core_benchmark_cases,
+};
+kbench_suite_module(core_benchmark);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Benchmarks of core data structures and allocators");
@@ -68,6 +68,9 @@ __u16 crc_t10dif_update(__u16 crc, const unsigned char *buffer, size_t len)
 	} desc;
 	int err;
 
+	if (IS_ENABLED(CONFIG_CRC_T10DIF_ARCH))
+		return crc_t10dif_arch(crc, buffer, len);
+
 	if (static_branch_unlikely(&crct10dif_fallback))
 		return crc_t10dif_generic(crc, buffer, len);
 
@@ -91,6 +94,10 @@ EXPORT_SYMBOL(crc_t10dif);
 
 static int __init crc_t10dif_mod_init(void)
 {
+	/* The arch code is called directly, no need to track the crypto API */
+	if (IS_ENABLED(CONFIG_CRC_T10DIF_ARCH))
+		return 0;
+
 	INIT_WORK(&crct10dif_rehash_work, crc_t10dif_rehash);
 	crypto_register_notifier(&crc_t10dif_nb);
 	crc_t10dif_rehash(&crct10dif_rehash_work);
@@ -99,6 +106,9 @@ static int __init crc_t10dif_mod_init(void)
 
 static void __exit crc_t10dif_mod_fini(void)
 {
+	if (IS_ENABLED(CONFIG_CRC_T10DIF_ARCH))
+		return;
+
 	crypto_unregister_notifier(&crc_t10dif_nb);
 	cancel_work_sync(&crct10dif_rehash_work);
 	crypto_free_shash(rcu_dereference_protected(crct10dif_tfm, 1));
@@ -112,6 +122,9 @@ static int crc_t10dif_transform_show(char *buffer, const struct kernel_param *kp
 	struct crypto_shash *tfm;
 	int len;
 
+	if (IS_ENABLED(CONFIG_CRC_T10DIF_ARCH))
+		return sprintf(buffer, "arch\n");
+
 	if (static_branch_unlikely(&crct10dif_fallback))
 		return sprintf(buffer, "fallback\n");
 
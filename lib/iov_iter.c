@@ -827,6 +827,13 @@ size_t copy_page_to_iter(struct page *page, size_t offset, size_t bytes,
 	size_t res = 0;
 	if (unlikely(!page_copy_sane(page, offset, bytes)))
 		return 0;
+	/*
+	 * A lowmem compound page is virtually contiguous in the direct map,
+	 * so everything but a pipe (which takes page references) can copy
+	 * the whole range in one pass instead of one subpage at a time.
+	 */
+	if (!PageHighMem(page) && !iov_iter_is_pipe(i))
+		return _copy_to_iter(page_address(page) + offset, bytes, i);
 	page += offset / PAGE_SIZE; // first subpage
 	offset %= PAGE_SIZE;
 	while (1) {
@@ -851,6 +858,10 @@ size_t copy_page_from_iter(struct page *page, size_t offset, size_t bytes,
 {
 	if (unlikely(!page_copy_sane(page, offset, bytes)))
 		return 0;
+	/* See copy_page_to_iter() */
+	if (!PageHighMem(page) && !iov_iter_is_pipe(i) &&
+	    !iov_iter_is_discard(i))
+		return _copy_from_iter(page_address(page) + offset, bytes, i);
 	if (likely(iter_is_iovec(i)))
 		return copy_page_from_iter_iovec(page, offset, bytes, i);
 	if (iov_iter_is_bvec(i) || iov_iter_is_kvec(i) || iov_iter_is_xarray(i)) {
@@ -1639,6 +1650,125 @@ ssize_t iov_iter_get_pages_alloc(struct iov_iter *i,
 }
 EXPORT_SYMBOL(iov_iter_get_pages_alloc);
 
+static ssize_t iovec_extract_pages(struct iov_iter *i, struct page **pages,
+				   size_t maxsize, unsigned int maxpages,
+				   unsigned int extract_flags, size_t *offset0)
+{
+	unsigned int gup_flags = iov_iter_rw(i) != WRITE ? FOLL_WRITE : 0;
+	size_t total = 0, len, start;
+	unsigned long addr;
+	int n, res;
+
+	while (maxsize && maxpages) {
+		addr = first_iovec_segment(i, &len, &start, maxsize, maxpages);
+		/* Only merge segments that meet on a page boundary */
+		if (total && start)
+			break;
+		n = DIV_ROUND_UP(len, PAGE_SIZE);
+		if (extract_flags & ITER_EXTRACT_GET)
+			res = get_user_pages_fast(addr, n, gup_flags, pages);
+		else
+			res = pin_user_pages_fast(addr, n, gup_flags, pages);
+		if (unlikely(res <= 0)) {
+			if (total)
+				break;
+			return res ? res : -EFAULT;
+		}
+		if (!total)
+			*offset0 = start;
+		len = (res == n ? len : res * PAGE_SIZE) - start;
+		iov_iter_advance(i, len);
+		total += len;
+		maxsize -= len;
+		maxpages -= res;
+		pages += res;
+		if (res < n || (start + len) & ~PAGE_MASK)
+			break;
+	}
+	return total;
+}
+
+static ssize_t bvec_extract_pages(struct iov_iter *i, struct page **pages,
+				  size_t maxsize, unsigned int maxpages,
+				  unsigned int extract_flags, size_t *offset0)
+{
+	size_t total = 0, len, start;
+	struct page *page;
+	int n;
+
+	while (maxsize && maxpages) {
+		page = first_bvec_segment(i, &len, &start, maxsize, maxpages);
+		if (total && start)
+			break;
+		if (!total)
+			*offset0 = start;
+		n = DIV_ROUND_UP(len, PAGE_SIZE);
+		len -= start;
+		iov_iter_advance(i, len);
+		total += len;
+		maxsize -= len;
+		maxpages -= n;
+		while (n--) {
+			*pages = page++;
+			if (extract_flags & ITER_EXTRACT_GET)
+				get_page(*pages);
+			pages++;
+		}
+		if ((start + len) & ~PAGE_MASK)
+			break;
+	}
+	return total;
+}
+
+/**
+ * iov_iter_extract_pages - extract and advance over a run of pages
+ * @i: the iterator to extract from
+ * @pages: array to fill with at most @maxpages pages
+ * @maxsize: maximum number of bytes to extract
+ * @maxpages: size of @pages
+ * @extract_flags: ITER_EXTRACT_* flags
+ * @offset0: set to the offset of the data in the first page
+ *
+ * Unlike iov_iter_get_pages(), this gathers as many segments as can be
+ * described by one page array (each one starting and, bar the last,
+ * ending on a page boundary) and advances the iterator past them.
+ *
+ * By default pages from a user-backed iterator are pinned with FOLL_PIN
+ * and must be released with unpin_user_page(); pages from a bvec get no
+ * extra reference at all, their lifetime being the caller's business.
+ * iov_iter_extract_will_pin() tells which one applies.  With
+ * ITER_EXTRACT_GET every page gets a plain reference for put_page()
+ * instead.  Other iterator types are only supported with that flag.
+ *
+ * Return: the number of bytes extracted or a negative error.
+ */
+ssize_t iov_iter_extract_pages(struct iov_iter *i, struct page **pages,
+			       size_t maxsize, unsigned int maxpages,
+			       unsigned int extract_flags, size_t *offset0)
+{
+	ssize_t ret;
+
+	if (maxsize > i->count)
+		maxsize = i->count;
+	if (!maxsize || !maxpages)
+		return 0;
+
+	if (likely(iter_is_iovec(i)))
+		return iovec_extract_pages(i, pages, maxsize, maxpages,
+					   extract_flags, offset0);
+	if (iov_iter_is_bvec(i))
+		return bvec_extract_pages(i, pages, maxsize, maxpages,
+					  extract_flags, offset0);
+	if (!(extract_flags & ITER_EXTRACT_GET))
+		return -EFAULT;
+
+	ret = iov_iter_get_pages(i, pages, maxsize, maxpages, offset0);
+	if (ret > 0)
+		iov_iter_advance(i, ret);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(iov_iter_extract_pages);
+
 size_t csum_and_copy_from_iter(void *addr, size_t bytes, __wsum *csum,
 			       struct iov_iter *i)
 {
@@ -0,0 +1,305 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * kbench: a harness for in-kernel microbenchmarks
+ *
+ * Each case is run by one kthread per selected CPU.  The threads are
+ * created and set up first and then released together.  Every sample
+ * times kbench.batch calls of the operation and goes into a per-thread
+ * histogram with 8 buckets per power of two of nanoseconds, so the
+ * reported percentiles are within 12.5% of the real ones.  The results
+ * are printed as one line per case:
+ *
+ *   kbench: suite=<s> case=<c> threads=<n> size=<n> iterations=<n>
+ *           batch=<n> mean_ns=<n> p50_ns=<n> p90_ns=<n> p99_ns=<n>
+ *           p999_ns=<n> max_ns=<n>
+ *
+ * all on one line, or with "skipped=<errno>" after the case name if it
+ * could not be set up.
+ */
+
+#define pr_fmt(fmt) "kbench: " fmt
+
+#include <linux/kbench.h>
+#include <linux/completion.h>
+#include <linux/cpumask.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+
+static unsigned int threads = 1;
+module_param(threads, uint, 0644);
+MODULE_PARM_DESC(threads, "Number of threads running each case");
+
+static char *cpus = "";
+module_param(cpus, charp, 0644);
+MODULE_PARM_DESC(cpus, "CPUs to run the threads on, default all online");
+
+static unsigned long iterations = 100000;
+module_param(iterations, ulong, 0644);
+MODULE_PARM_DESC(iterations, "Operations per thread");
+
+static unsigned int batch = 1;
+module_param(batch, uint, 0644);
+MODULE_PARM_DESC(batch, "Operations timed together in one sample");
+
+static unsigned long size = 4096;
+module_param(size, ulong, 0644);
+MODULE_PARM_DESC(size, "Size parameter of the cases, see each case");
+
+static char *filter = "";
+module_param(filter, charp, 0644);
+MODULE_PARM_DESC(filter, "Only run the cases whose name contains this");
+
+#define KBENCH_HIST_SUB_BITS	3
+#define KBENCH_HIST_SUB		(1 << KBENCH_HIST_SUB_BITS)
+#define KBENCH_HIST_BUCKETS	(64 * KBENCH_HIST_SUB)
+
+struct kbench_run {
+	struct completion	start;
+	struct completion	done;
+	atomic_t		running;
+	unsigned long		iterations;
+	unsigned int		batch;
+};
+
+struct kbench_thread {
+	struct kbench_ctx	ctx;
+	struct kbench_run	*run;
+	struct task_struct	*task;
+	int			err;
+	u64			total_ns;
+	u64			max_ns;
+	u64			hist[KBENCH_HIST_BUCKETS];
+};
+
+static unsigned int kbench_hist_idx(u64 ns)
+{
+	unsigned int shift;
+
+	if (ns < KBENCH_HIST_SUB)
+		return ns;
+
+	shift = fls64(ns) - 1 - KBENCH_HIST_SUB_BITS;
+	return (shift + 1) * KBENCH_HIST_SUB +
+	       ((ns >> shift) & (KBENCH_HIST_SUB - 1));
+}
+
+/* The largest value that goes into bucket @idx */
+static u64 kbench_hist_value(unsigned int idx)
+{
+	unsigned int shift;
+
+	if (idx < KBENCH_HIST_SUB)
+		return idx;
+
+	shift = idx / KBENCH_HIST_SUB - 1;
+	return ((u64)(KBENCH_HIST_SUB + idx % KBENCH_HIST_SUB) << shift) +
+	       (1ULL << shift) - 1;
+}
+
+static int kbench_thread_fn(void *data)
+{
+	struct kbench_thread *t = data;
+	struct kbench_run *run = t->run;
+	const struct kbench_case *bcase = t->ctx.bcase;
+	unsigned long i, j, n;
+	u64 start, ns;
+
+	if (bcase->thread_setup)
+		t->err = bcase->thread_setup(&t->ctx);
+
+	wait_for_completion(&run->start);
+
+	if (!t->err) {
+		for (i = 0; i < run->iterations; i += n) {
+			n = min_t(unsigned long, run->batch,
+				  run->iterations - i);
+
+			start = ktime_get_ns();
+			for (j = 0; j < n; j++)
+				bcase->op(&t->ctx, i + j);
+			ns = div_u64(ktime_get_ns() - start, n);
+
+			t->hist[kbench_hist_idx(ns)] += n;
+			t->total_ns += ns * n;
+			t->max_ns = max(t->max_ns, ns);
+			cond_resched();
+		}
+
+		if (bcase->thread_teardown)
+			bcase->thread_teardown(&t->ctx);
+	}
+
+	if (atomic_dec_and_test(&run->running))
+		complete(&run->done);
+
+	/* Stay around for kthread_stop() */
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!kthread_should_stop())
+			schedule();
+		__set_current_state(TASK_RUNNING);
+	}
+
+	return 0;
+}
+
+static void kbench_report(const struct kbench_suite *suite,
+			  const struct kbench_case *bcase,
+			  struct kbench_thread *t, unsigned int nr)
+{
+	static const unsigned int permille[] = { 500, 900, 990, 999 };
+	u64 pct[ARRAY_SIZE(permille)] = { 0 };
+	u64 *hist = t[0].hist;
+	u64 ops = 0, seen = 0, total_ns = 0, max_ns = 0;
+	unsigned int i, b, p = 0;
+
+	/* fold everything into the first thread's histogram */
+	for (i = 0; i < nr; i++) {
+		total_ns += t[i].total_ns;
+		max_ns = max(max_ns, t[i].max_ns);
+		for (b = 0; i && b < KBENCH_HIST_BUCKETS; b++)
+			hist[b] += t[i].hist[b];
+	}
+	for (b = 0; b < KBENCH_HIST_BUCKETS; b++)
+		ops += hist[b];
+	if (!ops)
+		return;
+
+	for (b = 0; b < KBENCH_HIST_BUCKETS && p < ARRAY_SIZE(permille); b++) {
+		seen += hist[b];
+		while (p < ARRAY_SIZE(permille) &&
+		       seen * 1000 >= ops * permille[p])
+			pct[p++] = min(kbench_hist_value(b), max_ns);
+	}
+
+	pr_info("suite=%s case=%s threads=%u size=%lu iterations=%lu batch=%u mean_ns=%llu p50_ns=%llu p90_ns=%llu p99_ns=%llu p999_ns=%llu max_ns=%llu\n",
+		suite->name, bcase->name, nr, size, iterations, batch,
+		div64_u64(total_ns, ops), pct[0], pct[1], pct[2], pct[3],
+		max_ns);
+}
+
+static int kbench_run_case(const struct kbench_suite *suite,
+			   const struct kbench_case *bcase,
+			   const struct cpumask *mask)
+{
+	struct kbench_ctx ctx = {
+		.bcase		= bcase,
+		.size		= size,
+		.threads	= threads,
+	};
+	struct kbench_run run = {
+		.iterations	= iterations,
+		.batch		= max(batch, 1U),
+	};
+	struct kbench_thread *t;
+	unsigned int i, nr = 0;
+	int cpu = -1, err = 0;
+
+	t = kvcalloc(threads, sizeof(*t), GFP_KERNEL);
+	if (!t)
+		return -ENOMEM;
+
+	if (bcase->setup) {
+		err = bcase->setup(&ctx);
+		if (err)
+			goto out_free;
+	}
+
+	init_completion(&run.start);
+	init_completion(&run.done);
+	/* held until all threads are created */
+	atomic_set(&run.running, 1);
+
+	for (i = 0; i < threads; i++) {
+		cpu = cpumask_next(cpu, mask);
+		if (cpu >= nr_cpu_ids)
+			cpu = cpumask_first(mask);
+
+		t[i].ctx = ctx;
+		t[i].ctx.thread = i;
+		t[i].run = &run;
+		t[i].task = kthread_create_on_cpu(kbench_thread_fn, &t[i], cpu,
+						  "kbench/%u");
+		if (IS_ERR(t[i].task)) {
+			err = PTR_ERR(t[i].task);
+			break;
+		}
+		get_task_struct(t[i].task);
+		atomic_inc(&run.running);
+		wake_up_process(t[i].task);
+		nr++;
+	}
+
+	complete_all(&run.start);
+	if (!atomic_dec_and_test(&run.running))
+		wait_for_completion(&run.done);
+
+	for (i = 0; i < nr; i++) {
+		kthread_stop(t[i].task);
+		put_task_struct(t[i].task);
+		if (!err)
+			err = t[i].err;
+	}
+
+	if (bcase->teardown)
+		bcase->teardown(&ctx);
+
+	if (!err)
+		kbench_report(suite, bcase, t, nr);
+out_free:
+	kvfree(t);
+	return err;
+}
+
+/**
+ * kbench_run_suite - run the cases of a suite and print their results
+ * @suite: the suite
+ *
+ * Cases that fail to set up are reported and skipped.
+ *
+ * Return: 0, or a negative errno if the parameters are invalid.
+ */
+int kbench_run_suite(const struct kbench_suite *suite)
+{
+	const struct kbench_case *bcase;
+	cpumask_var_t mask;
+	int err;
+
+	if (!threads || !iterations)
+		return -EINVAL;
+
+	if (!zalloc_cpumask_var(&mask, GFP_KERNEL))
+		return -ENOMEM;
+
+	if (*cpus) {
+		err = cpulist_parse(cpus, mask);
+		if (err)
+			goto out;
+	} else {
+		cpumask_copy(mask, cpu_online_mask);
+	}
+	cpumask_and(mask, mask, cpu_online_mask);
+	err = -EINVAL;
+	if (cpumask_empty(mask))
+		goto out;
+
+	for (bcase = suite->cases; bcase->name; bcase++) {
+		if (*filter && !strstr(bcase->name, filter))
+			continue;
+
+		err = kbench_run_case(suite, bcase, mask);
+		if (err)
+			pr_info("suite=%s case=%s skipped=%d\n",
+				suite->name, bcase->name, err);
+	}
+	err = 0;
+out:
+	free_cpumask_var(mask);
+	return err;
+}
+EXPORT_SYMBOL_GPL(kbench_run_suite);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("In-kernel microbenchmark harness");
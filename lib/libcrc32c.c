@@ -31,6 +31,7 @@
 #include <linux/init.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
+#include <linux/crc32.h>
 #include <linux/crc32c.h>
 
 static struct crypto_shash *tfm;
@@ -41,6 +42,10 @@ u32 crc32c(u32 crc, const void *address, unsigned int length)
 	u32 ret, *ctx = (u32 *)shash_desc_ctx(shash);
 	int err;
 
+	/* The arch CRC32C is patched in at boot, skip the crypto API */
+	if (IS_ENABLED(CONFIG_ARCH_HAS_FAST_CRC32))
+		return __crc32c_le(crc, address, length);
+
 	shash->tfm = tfm;
 	*ctx = crc;
 
@@ -56,17 +61,26 @@ EXPORT_SYMBOL(crc32c);
 
 static int __init libcrc32c_mod_init(void)
 {
+	if (IS_ENABLED(CONFIG_ARCH_HAS_FAST_CRC32))
+		return 0;
+
 	tfm = crypto_alloc_shash("crc32c", 0, 0);
 	return PTR_ERR_OR_ZERO(tfm);
 }
 
 static void __exit libcrc32c_mod_fini(void)
 {
+	if (IS_ENABLED(CONFIG_ARCH_HAS_FAST_CRC32))
+		return;
+
 	crypto_free_shash(tfm);
 }
 
 const char *crc32c_impl(void)
 {
+	if (IS_ENABLED(CONFIG_ARCH_HAS_FAST_CRC32))
+		return "crc32c-arch";
+
 	return crypto_shash_driver_name(tfm);
 }
 EXPORT_SYMBOL(crc32c_impl);
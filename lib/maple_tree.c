@@ -0,0 +1,516 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Maple Tree implementation
+ *
+ * A copy-on-write B-tree of ranges.  See include/linux/maple_tree.h for
+ * the locking rules.
+ */
+
+#include <linux/export.h>
+#include <linux/maple_tree.h>
+#include <linux/slab.h>
+
+/*
+ * Leaf nodes store ranges: slot[i] is the entry for [first[i], last[i]].
+ * Internal nodes store children: slot[i] is a child node whose ranges
+ * span first[i] to last[i].  In both cases the slots are sorted and
+ * first[i] > last[i - 1].
+ *
+ * Readers only look at leaf, count, first, last and slot.  The rcu head
+ * and free_next are private to the writer holding ma_lock.
+ */
+struct maple_node {
+	union {
+		struct rcu_head		rcu;
+		struct maple_node	*free_next;
+	};
+	unsigned char			leaf;
+	unsigned char			count;
+	unsigned long			first[MAPLE_NODE_SLOTS];
+	unsigned long			last[MAPLE_NODE_SLOTS];
+	void __rcu			*slot[MAPLE_NODE_SLOTS];
+};
+
+/* A node with fewer slots than this is merged into a sibling if possible */
+#define MAPLE_NODE_MIN		(MAPLE_NODE_SLOTS / 4)
+
+struct mn_entry {
+	unsigned long	first;
+	unsigned long	last;
+	void		*slot;
+};
+
+/*
+ * State of one write operation.  Every node a write may need is allocated
+ * up front so that nothing can fail once the tree is being rebuilt.
+ */
+struct mt_write {
+	struct maple_tree	*mt;
+	struct maple_node	*alloc;	/* preallocated, unused yet */
+	struct maple_node	*dead;	/* replaced, freed after publication */
+};
+
+static struct kmem_cache *maple_node_cache;
+
+#define mt_root(mt)							\
+	rcu_dereference_protected((mt)->ma_root,			\
+				  lockdep_is_held(&(mt)->ma_lock))
+
+#define mt_child(w, node, i)						\
+	((struct maple_node *)rcu_dereference_protected((node)->slot[i],	\
+				  lockdep_is_held(&(w)->mt->ma_lock)))
+
+/* First slot of @node whose range ends at or after @index */
+static unsigned int mn_offset(const struct maple_node *node,
+			      unsigned long index)
+{
+	unsigned int i;
+
+	for (i = 0; i < node->count; i++)
+		if (node->last[i] >= index)
+			break;
+	return i;
+}
+
+/*
+ * Find the first range that ends at or after @index.  Must be called
+ * under rcu_read_lock() or ma_lock.
+ */
+static void *mt_walk(struct maple_tree *mt, unsigned long index,
+		     unsigned long *first, unsigned long *last)
+{
+	struct maple_node *node = rcu_dereference_check(mt->ma_root,
+					lockdep_is_held(&mt->ma_lock));
+	unsigned int i;
+
+	while (node) {
+		i = mn_offset(node, index);
+		if (i == node->count)
+			break;
+		if (node->leaf) {
+			*first = node->first[i];
+			*last = node->last[i];
+			return rcu_dereference_check(node->slot[i],
+					lockdep_is_held(&mt->ma_lock));
+		}
+		node = rcu_dereference_check(node->slot[i],
+					lockdep_is_held(&mt->ma_lock));
+	}
+	return NULL;
+}
+
+static unsigned int mt_height(struct maple_tree *mt)
+{
+	struct maple_node *node = mt_root(mt);
+	unsigned int height = 0;
+
+	while (node) {
+		height++;
+		if (node->leaf)
+			break;
+		node = rcu_dereference_protected(node->slot[0],
+					lockdep_is_held(&mt->ma_lock));
+	}
+	return height;
+}
+
+static int mt_prealloc(struct mt_write *w, unsigned int nr, gfp_t gfp)
+{
+	struct maple_node *node;
+
+	while (nr--) {
+		node = kmem_cache_alloc(maple_node_cache, gfp);
+		if (!node)
+			return -ENOMEM;
+		node->free_next = w->alloc;
+		w->alloc = node;
+	}
+	return 0;
+}
+
+static struct maple_node *mn_alloc(struct mt_write *w, bool leaf)
+{
+	struct maple_node *node = w->alloc;
+
+	BUG_ON(!node);
+	w->alloc = node->free_next;
+	node->leaf = leaf;
+	node->count = 0;
+	return node;
+}
+
+/* Give back a node built during this write that was not used after all */
+static void mn_unalloc(struct mt_write *w, struct maple_node *node)
+{
+	node->free_next = w->alloc;
+	w->alloc = node;
+}
+
+static void mn_retire(struct mt_write *w, struct maple_node *node)
+{
+	node->free_next = w->dead;
+	w->dead = node;
+}
+
+static void mn_free_rcu(struct rcu_head *head)
+{
+	kmem_cache_free(maple_node_cache,
+			container_of(head, struct maple_node, rcu));
+}
+
+static void mt_write_end(struct mt_write *w)
+{
+	struct maple_node *node, *next;
+
+	for (node = w->dead; node; node = next) {
+		next = node->free_next;
+		call_rcu(&node->rcu, mn_free_rcu);
+	}
+	for (node = w->alloc; node; node = next) {
+		next = node->free_next;
+		kmem_cache_free(maple_node_cache, node);
+	}
+	w->dead = w->alloc = NULL;
+}
+
+static void mn_push(struct maple_node *node, unsigned long first,
+		    unsigned long last, void *slot)
+{
+	unsigned int i = node->count++;
+
+	node->first[i] = first;
+	node->last[i] = last;
+	RCU_INIT_POINTER(node->slot[i], slot);
+}
+
+static void mn_push_node(struct maple_node *node, struct maple_node *child)
+{
+	mn_push(node, child->first[0], child->last[child->count - 1], child);
+}
+
+/*
+ * Build the replacement of @src with @ndel slots removed at @pos and the
+ * @nins entries of @ins put in their place.  The result is split in two
+ * nodes if it does not fit in one.  out[0] is NULL if nothing is left.
+ */
+static void mn_build(struct mt_write *w, struct maple_node *src,
+		     unsigned int pos, unsigned int ndel,
+		     const struct mn_entry *ins, unsigned int nins,
+		     struct maple_node **out)
+{
+	unsigned int n = src->count - ndel + nins;
+	unsigned int split = n > MAPLE_NODE_SLOTS ? n / 2 : n;
+	struct maple_node *dst;
+	unsigned int i, j;
+
+	out[0] = out[1] = NULL;
+	if (!n)
+		return;
+
+	out[0] = mn_alloc(w, src->leaf);
+	if (split < n)
+		out[1] = mn_alloc(w, src->leaf);
+
+	for (i = 0; i < n; i++) {
+		dst = i < split ? out[0] : out[1];
+		if (i < pos) {
+			j = i;
+		} else if (i < pos + nins) {
+			const struct mn_entry *e = &ins[i - pos];
+
+			mn_push(dst, e->first, e->last, e->slot);
+			continue;
+		} else {
+			j = i - nins + ndel;
+		}
+		mn_push(dst, src->first[j], src->last[j],
+			rcu_dereference_protected(src->slot[j], true));
+	}
+}
+
+static unsigned int mn_entries(struct maple_node **nodes, struct mn_entry *e)
+{
+	unsigned int i, n = 0;
+
+	for (i = 0; i < 2 && nodes[i]; i++, n++) {
+		e[n].first = nodes[i]->first[0];
+		e[n].last = nodes[i]->last[nodes[i]->count - 1];
+		e[n].slot = nodes[i];
+	}
+	return n;
+}
+
+static void mt_insert_node(struct mt_write *w, struct maple_node *node,
+			   const struct mn_entry *new, struct maple_node **out)
+{
+	unsigned int i = mn_offset(node, new->first);
+	struct maple_node *child[2];
+	struct mn_entry ins[2];
+
+	if (node->leaf) {
+		mn_build(w, node, i, 0, new, 1, out);
+	} else {
+		/* Past the last child: the rightmost one grows */
+		if (i == node->count)
+			i--;
+		mt_insert_node(w, mt_child(w, node, i), new, child);
+		mn_build(w, node, i, 1, ins, mn_entries(child, ins), out);
+	}
+	mn_retire(w, node);
+}
+
+/**
+ * mtree_insert_range() - Store an entry for a range of indices.
+ * @mt: Maple Tree.
+ * @first: First index of the range.
+ * @last: Last index of the range, inclusive.
+ * @entry: Entry to store, must not be NULL.
+ * @gfp: Memory allocation flags.
+ *
+ * Context: Process context.  Takes and releases the ma_lock.  May sleep
+ * if @gfp allows it.
+ * Return: 0 on success, -EEXIST if any index in the range is already
+ * occupied, -ENOMEM if memory could not be allocated, -EINVAL for an
+ * empty range or a NULL @entry.
+ */
+int mtree_insert_range(struct maple_tree *mt, unsigned long first,
+		       unsigned long last, void *entry, gfp_t gfp)
+{
+	struct mn_entry new = { first, last, entry };
+	struct mt_write w = { .mt = mt };
+	struct maple_node *root, *out[2];
+	unsigned long f, l;
+	int ret;
+
+	if (WARN_ON_ONCE(first > last || !entry))
+		return -EINVAL;
+
+	mutex_lock(&mt->ma_lock);
+	if (mt_walk(mt, first, &f, &l) && f <= last) {
+		ret = -EEXIST;
+		goto unlock;
+	}
+
+	/* Up to two nodes per level, plus a new root */
+	ret = mt_prealloc(&w, 2 * mt_height(mt) + 1, gfp);
+	if (ret)
+		goto end;
+
+	root = mt_root(mt);
+	if (!root) {
+		root = mn_alloc(&w, true);
+		mn_push(root, first, last, entry);
+	} else {
+		mt_insert_node(&w, root, &new, out);
+		root = out[0];
+		if (out[1]) {
+			root = mn_alloc(&w, false);
+			mn_push_node(root, out[0]);
+			mn_push_node(root, out[1]);
+		}
+	}
+	rcu_assign_pointer(mt->ma_root, root);
+end:
+	mt_write_end(&w);
+unlock:
+	mutex_unlock(&mt->ma_lock);
+	return ret;
+}
+EXPORT_SYMBOL(mtree_insert_range);
+
+/* Fold @right into @left, both freshly built or published siblings */
+static struct maple_node *mn_merge(struct mt_write *w, struct maple_node *left,
+				   struct maple_node *right)
+{
+	struct maple_node *node = mn_alloc(w, left->leaf);
+	struct maple_node *src[2] = { left, right };
+	unsigned int i, j;
+
+	for (i = 0; i < 2; i++)
+		for (j = 0; j < src[i]->count; j++)
+			mn_push(node, src[i]->first[j], src[i]->last[j],
+				rcu_dereference_protected(src[i]->slot[j],
+							  true));
+	return node;
+}
+
+static void mt_erase_node(struct mt_write *w, struct maple_node *node,
+			  unsigned long index, struct maple_node **out)
+{
+	unsigned int i = mn_offset(node, index);
+	struct maple_node *child[2], *sib = NULL, *merged;
+	struct mn_entry ins[2];
+	unsigned int pos = i, ndel = 1;
+
+	if (node->leaf) {
+		mn_build(w, node, i, 1, NULL, 0, out);
+		mn_retire(w, node);
+		return;
+	}
+
+	mt_erase_node(w, mt_child(w, node, i), index, child);
+
+	/* Fold a child that became too sparse into a sibling */
+	if (child[0] && child[0]->count < MAPLE_NODE_MIN) {
+		if (i + 1 < node->count)
+			sib = mt_child(w, node, i + 1);
+		else if (i > 0)
+			sib = mt_child(w, node, i - 1);
+	}
+	if (sib && child[0]->count + sib->count <= MAPLE_NODE_SLOTS) {
+		if (i + 1 < node->count) {
+			merged = mn_merge(w, child[0], sib);
+		} else {
+			merged = mn_merge(w, sib, child[0]);
+			pos = i - 1;
+		}
+		mn_unalloc(w, child[0]);
+		mn_retire(w, sib);
+		child[0] = merged;
+		ndel = 2;
+	}
+	mn_build(w, node, pos, ndel, ins, mn_entries(child, ins), out);
+	mn_retire(w, node);
+}
+
+/**
+ * mtree_erase() - Remove the entry covering an index.
+ * @mt: Maple Tree.
+ * @index: Any index inside the range to remove.
+ *
+ * The whole range the entry was stored with is removed.
+ *
+ * Context: Process context.  Takes and releases the ma_lock.  May sleep.
+ * Return: The entry that was removed, or NULL if @index was empty.
+ */
+void *mtree_erase(struct maple_tree *mt, unsigned long index)
+{
+	struct mt_write w = { .mt = mt };
+	struct maple_node *root, *out[2];
+	unsigned long first, last;
+	void *entry;
+
+	mutex_lock(&mt->ma_lock);
+	entry = mt_walk(mt, index, &first, &last);
+	if (!entry || first > index) {
+		entry = NULL;
+		goto unlock;
+	}
+
+	/* One node per level, plus one per level for merging siblings */
+	mt_prealloc(&w, 2 * mt_height(mt), GFP_KERNEL | __GFP_NOFAIL);
+	mt_erase_node(&w, mt_root(mt), index, out);
+	root = out[0];
+
+	/* Drop internal roots that are left with a single child */
+	while (root && !root->leaf && root->count == 1) {
+		struct maple_node *child = mt_child(&w, root, 0);
+
+		mn_unalloc(&w, root);
+		root = child;
+	}
+	rcu_assign_pointer(mt->ma_root, root);
+	mt_write_end(&w);
+unlock:
+	mutex_unlock(&mt->ma_lock);
+	return entry;
+}
+EXPORT_SYMBOL(mtree_erase);
+
+/**
+ * mtree_load() - Load the entry covering an index.
+ * @mt: Maple Tree.
+ * @index: Index into the tree.
+ *
+ * Context: Any context.  Takes and releases the RCU lock.  The entry
+ * stays valid only as long as the caller keeps it from being erased and
+ * freed, either with its own rcu_read_lock() or by serialising against
+ * the writers.
+ * Return: The entry, or NULL if @index is empty.
+ */
+void *mtree_load(struct maple_tree *mt, unsigned long index)
+{
+	unsigned long first, last;
+	void *entry;
+
+	rcu_read_lock();
+	entry = mt_walk(mt, index, &first, &last);
+	if (entry && first > index)
+		entry = NULL;
+	rcu_read_unlock();
+	return entry;
+}
+EXPORT_SYMBOL(mtree_load);
+
+/**
+ * mt_find() - Find the first entry at or after an index.
+ * @mt: Maple Tree.
+ * @index: Pointer to the index to start searching from.
+ * @max: Highest index the entry may start at.
+ *
+ * Returns the first entry whose range ends at or after *@index and
+ * starts at or before @max.  On success *@index is moved past the end of
+ * that range so that calling mt_find() in a loop visits each entry once.
+ *
+ * Context: Any context.  Takes and releases the RCU lock, see
+ * mtree_load() for the lifetime of the returned entry.
+ * Return: The entry, or NULL if there is none.
+ */
+void *mt_find(struct maple_tree *mt, unsigned long *index, unsigned long max)
+{
+	unsigned long first, last;
+	void *entry;
+
+	rcu_read_lock();
+	entry = mt_walk(mt, *index, &first, &last);
+	if (entry && first > max)
+		entry = NULL;
+	rcu_read_unlock();
+
+	if (entry)
+		*index = last == ULONG_MAX ? ULONG_MAX : last + 1;
+	return entry;
+}
+EXPORT_SYMBOL(mt_find);
+
+static void mt_destroy_node(struct mt_write *w, struct maple_node *node)
+{
+	unsigned int i;
+
+	if (!node->leaf)
+		for (i = 0; i < node->count; i++)
+			mt_destroy_node(w, mt_child(w, node, i));
+	mn_retire(w, node);
+}
+
+/**
+ * mtree_destroy() - Free all nodes of a tree.
+ * @mt: Maple Tree.
+ *
+ * The entries themselves are not freed.  Readers that are still walking
+ * the tree under RCU remain safe, the nodes go away after a grace period.
+ *
+ * Context: Process context.  Takes and releases the ma_lock.
+ */
+void mtree_destroy(struct maple_tree *mt)
+{
+	struct mt_write w = { .mt = mt };
+	struct maple_node *root;
+
+	mutex_lock(&mt->ma_lock);
+	root = mt_root(mt);
+	if (root) {
+		RCU_INIT_POINTER(mt->ma_root, NULL);
+		mt_destroy_node(&w, root);
+		mt_write_end(&w);
+	}
+	mutex_unlock(&mt->ma_lock);
+}
+EXPORT_SYMBOL(mtree_destroy);
+
+void __init maple_tree_init(void)
+{
+	maple_node_cache = kmem_cache_create("maple_node",
+			sizeof(struct maple_node), 0,
+			SLAB_PANIC | SLAB_HWCACHE_ALIGN, NULL);
+}
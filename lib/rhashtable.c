@@ -181,7 +181,7 @@ static struct bucket_table *bucket_table_alloc(struct rhashtable *ht,
 	int i;
 	static struct lock_class_key __key;
 
-	tbl = kvzalloc(struct_size(tbl, buckets, nbuckets), gfp);
+	tbl = kvzalloc_node(struct_size(tbl, buckets, nbuckets), gfp, ht->node);
 
 	size = nbuckets;
 
@@ -221,72 +221,76 @@ static struct bucket_table *rhashtable_last_table(struct rhashtable *ht,
 	return new_tbl;
 }
 
-static int rhashtable_rehash_one(struct rhashtable *ht,
-				 struct rhash_lock_head __rcu **bkt,
-				 unsigned int old_hash)
-{
-	struct bucket_table *old_tbl = rht_dereference(ht->tbl, ht);
-	struct bucket_table *new_tbl = rhashtable_last_table(ht, old_tbl);
-	int err = -EAGAIN;
-	struct rhash_head *head, *next, *entry;
-	struct rhash_head __rcu **pprev = NULL;
-	unsigned int new_hash;
-
-	if (new_tbl->nest)
-		goto out;
-
-	err = -ENOENT;
-
-	rht_for_each_from(entry, rht_ptr(bkt, old_tbl, old_hash),
-			  old_tbl, old_hash) {
-		err = 0;
-		next = rht_dereference_bucket(entry->next, old_tbl, old_hash);
-
-		if (rht_is_a_nulls(next))
-			break;
-
-		pprev = &entry->next;
-	}
-
-	if (err)
-		goto out;
-
-	new_hash = head_hashfn(ht, new_tbl, entry);
-
-	rht_lock_nested(new_tbl, &new_tbl->buckets[new_hash], SINGLE_DEPTH_NESTING);
-
-	head = rht_ptr(new_tbl->buckets + new_hash, new_tbl, new_hash);
-
-	RCU_INIT_POINTER(entry->next, head);
-
-	rht_assign_unlock(new_tbl, &new_tbl->buckets[new_hash], entry);
-
-	if (pprev)
-		rcu_assign_pointer(*pprev, next);
-	else
-		/* Need to preserved the bit lock. */
-		rht_assign_locked(bkt, next);
-
-out:
-	return err;
-}
+/*
+ * Number of entries moved to the new table before the old chain is cut
+ * behind them.  Chains rarely grow past this, so a chain is usually moved
+ * with a single walk and a single update of the old bucket.
+ */
+#define RHT_REHASH_BATCH	16
 
 static int rhashtable_rehash_chain(struct rhashtable *ht,
 				    unsigned int old_hash)
 {
 	struct bucket_table *old_tbl = rht_dereference(ht->tbl, ht);
+	struct bucket_table *new_tbl = rhashtable_last_table(ht, old_tbl);
 	struct rhash_lock_head __rcu **bkt = rht_bucket_var(old_tbl, old_hash);
-	int err;
+	struct rhash_head *batch[RHT_REHASH_BATCH + 1];
+	struct rhash_head *entry, *head, *nulls;
+	unsigned int n, m, i, new_hash;
+	int err = 0;
 
 	if (!bkt)
 		return 0;
 	rht_lock(old_tbl, bkt);
 
-	while (!(err = rhashtable_rehash_one(ht, bkt, old_hash)))
-		;
+	if (new_tbl->nest) {
+		err = -EAGAIN;
+		goto out;
+	}
+
+	for (;;) {
+		/* Remember the tail of the chain and the entry before it */
+		n = 0;
+		rht_for_each_from(entry, rht_ptr(bkt, old_tbl, old_hash),
+				  old_tbl, old_hash)
+			batch[n++ % ARRAY_SIZE(batch)] = entry;
+		if (!n)
+			break;
+
+		entry = batch[(n - 1) % ARRAY_SIZE(batch)];
+		nulls = rht_dereference_bucket(entry->next, old_tbl, old_hash);
+
+		/*
+		 * Move the tail first.  A reader still walking the old chain
+		 * either reaches the entries it has not seen yet or is sent
+		 * into a chain of the new table, notices the foreign nulls
+		 * marker and restarts; it finds the moved entries through
+		 * future_tbl once the old chain has been cut.
+		 */
+		m = min_t(unsigned int, n, RHT_REHASH_BATCH);
+		for (i = 1; i <= m; i++) {
+			entry = batch[(n - i) % ARRAY_SIZE(batch)];
+			new_hash = head_hashfn(ht, new_tbl, entry);
+
+			rht_lock_nested(new_tbl, &new_tbl->buckets[new_hash],
+					SINGLE_DEPTH_NESTING);
+			head = rht_ptr(new_tbl->buckets + new_hash, new_tbl,
+				       new_hash);
+			RCU_INIT_POINTER(entry->next, head);
+			rht_assign_unlock(new_tbl, &new_tbl->buckets[new_hash],
+					  entry);
+		}
 
-	if (err == -ENOENT)
-		err = 0;
+		if (n == m) {
+			/* Need to preserved the bit lock. */
+			rht_assign_locked(bkt, nulls);
+			break;
+		}
+		rcu_assign_pointer(batch[(n - m - 1) % ARRAY_SIZE(batch)]->next,
+				   nulls);
+	}
+
+out:
 	rht_unlock(old_tbl, bkt);
 
 	return err;
@@ -1026,6 +1030,7 @@ int rhashtable_init(struct rhashtable *ht,
 	mutex_init(&ht->mutex);
 	spin_lock_init(&ht->lock);
 	memcpy(&ht->p, params, sizeof(*params));
+	ht->node = params->numa_local ? numa_node_id() : NUMA_NO_NODE;
 
 	if (params->min_size)
 		ht->p.min_size = roundup_pow_of_two(params->min_size);
@@ -5,10 +5,42 @@
  */
 
 #include <linux/sched.h>
+#include <linux/sched/topology.h>
 #include <linux/random.h>
 #include <linux/sbitmap.h>
 #include <linux/seq_file.h>
 
+/*
+ * Start the CPUs behind one last level cache in their own slice of the
+ * map, at a random offset within it.  They then mostly allocate from and
+ * free to the same words as each other, instead of bouncing every word
+ * between caches.
+ */
+static void sbitmap_spread_alloc_hint(struct sbitmap *sb, unsigned int depth)
+{
+	unsigned int nr_llc = 0, llc, span;
+	int i, j;
+
+	/* First pass: number the caches, keyed by their lowest CPU */
+	for_each_possible_cpu(i) {
+		for_each_possible_cpu(j)
+			if (cpus_share_cache(i, j))
+				break;
+		if (j == i)
+			llc = nr_llc++;
+		else
+			llc = *per_cpu_ptr(sb->alloc_hint, j);
+		*per_cpu_ptr(sb->alloc_hint, i) = llc;
+	}
+
+	span = max(depth / nr_llc, 1U);
+	for_each_possible_cpu(i) {
+		llc = *per_cpu_ptr(sb->alloc_hint, i);
+		*per_cpu_ptr(sb->alloc_hint, i) =
+			(llc * depth / nr_llc + prandom_u32() % span) % depth;
+	}
+}
+
 static int init_alloc_hint(struct sbitmap *sb, gfp_t flags)
 {
 	unsigned depth = sb->depth;
@@ -17,12 +49,8 @@ static int init_alloc_hint(struct sbitmap *sb, gfp_t flags)
 	if (!sb->alloc_hint)
 		return -ENOMEM;
 
-	if (depth && !sb->round_robin) {
-		int i;
-
-		for_each_possible_cpu(i)
-			*per_cpu_ptr(sb->alloc_hint, i) = prandom_u32() % depth;
-	}
+	if (depth && !sb->round_robin)
+		sbitmap_spread_alloc_hint(sb, depth);
 	return 0;
 }
 
@@ -489,6 +517,58 @@ int __sbitmap_queue_get(struct sbitmap_queue *sbq)
 }
 EXPORT_SYMBOL_GPL(__sbitmap_queue_get);
 
+unsigned long __sbitmap_queue_get_batch(struct sbitmap_queue *sbq, int nr_tags,
+					unsigned int *offset)
+{
+	struct sbitmap *sb = &sbq->sb;
+	unsigned int hint, depth;
+	unsigned long index, nr;
+	int i;
+
+	if (unlikely(sb->round_robin || nr_tags <= 0))
+		return 0;
+	if (nr_tags >= BITS_PER_LONG)
+		nr_tags = BITS_PER_LONG - 1;
+
+	depth = READ_ONCE(sb->depth);
+	hint = update_alloc_hint_before_get(sb, depth);
+	index = SB_NR_TO_INDEX(sb, hint);
+
+	for (i = 0; i < sb->map_nr; i++) {
+		struct sbitmap_word *map = &sb->map[index];
+		atomic_long_t *ptr = (atomic_long_t *)&map->word;
+		unsigned long get_mask, val;
+
+		sbitmap_deferred_clear(map);
+		nr = find_first_zero_bit(&map->word, map->depth);
+		if (nr + nr_tags > map->depth)
+			goto next;
+
+		/*
+		 * Grab up to nr_tags bits from the first free one with a
+		 * single atomic, keeping whichever of them were still free.
+		 */
+		get_mask = ((1UL << nr_tags) - 1) << nr;
+		val = READ_ONCE(map->word);
+		while (!atomic_long_try_cmpxchg(ptr, (long *)&val,
+						get_mask | val))
+			;
+		get_mask = (get_mask & ~val) >> nr;
+		if (get_mask) {
+			*offset = nr + (index << sb->shift);
+			update_alloc_hint_after_get(sb, depth, hint,
+						    *offset + nr_tags - 1);
+			return get_mask;
+		}
+next:
+		if (++index >= sb->map_nr)
+			index = 0;
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(__sbitmap_queue_get_batch);
+
 int __sbitmap_queue_get_shallow(struct sbitmap_queue *sbq,
 				unsigned int shallow_depth)
 {
@@ -607,6 +687,51 @@ void sbitmap_queue_clear(struct sbitmap_queue *sbq, unsigned int nr,
 }
 EXPORT_SYMBOL_GPL(sbitmap_queue_clear);
 
+void sbitmap_queue_clear_batch(struct sbitmap_queue *sbq, int offset,
+			       int *tags, int nr_tags)
+{
+	struct sbitmap *sb = &sbq->sb;
+	unsigned long *addr = NULL;
+	unsigned long mask = 0;
+	int i;
+
+	if (!nr_tags)
+		return;
+
+	/* Same ordering as sbitmap_queue_clear() */
+	smp_mb__before_atomic();
+	for (i = 0; i < nr_tags; i++) {
+		const int tag = tags[i] - offset;
+		unsigned long *this_addr;
+
+		/*
+		 * One atomic per word: there is no point in going through
+		 * the deferred ->cleared mask for a whole batch.
+		 */
+		this_addr = &sb->map[SB_NR_TO_INDEX(sb, tag)].word;
+		if (addr && addr != this_addr) {
+			atomic_long_andnot(mask, (atomic_long_t *)addr);
+			mask = 0;
+		}
+		addr = this_addr;
+		mask |= 1UL << SB_NR_TO_BIT(sb, tag);
+	}
+	atomic_long_andnot(mask, (atomic_long_t *)addr);
+
+	/* Waiters are accounted per freed bit, see sbq_calc_wake_batch() */
+	smp_mb__after_atomic();
+	for (i = 0; i < nr_tags; i++)
+		sbitmap_queue_wake_up(sbq);
+
+	if (likely(!sb->round_robin)) {
+		int tag = tags[nr_tags - 1] - offset;
+
+		if (tag < sb->depth)
+			this_cpu_write(*sb->alloc_hint, tag);
+	}
+}
+EXPORT_SYMBOL_GPL(sbitmap_queue_clear_batch);
+
 void sbitmap_queue_wake_all(struct sbitmap_queue *sbq)
 {
 	int i, wake_index;
@@ -10,8 +10,17 @@
  *
  * Instead, stack depot maintains a hashtable of unique stacktraces. Since alloc
  * and free stacks repeat a lot, we save about 100x space.
- * Stacks are never removed from depot, so we store them contiguously one after
- * another in a contiguous memory allocation.
+ * Stacks are stored contiguously one after another in a contiguous memory
+ * allocation.  By default they are never removed from the depot.  Stacks saved
+ * with STACK_DEPOT_FLAG_GET are refcounted instead: they are rounded up to a
+ * size class, and once the last reference is dropped they are unlinked and
+ * their slot is reused for a new stack of the same class after an RCU grace
+ * period.  The memory itself is never returned, so handles always point to
+ * valid storage.
+ *
+ * Lookups of known stacks are lockless.  Inserting and evicting serialise on
+ * one of DEPOT_SHARDS locks picked by hash; only carving a new record out of
+ * the pool takes the global depot_pool_lock.
  *
  * Author: Alexander Potapenko <glider@google.com>
  * Copyright (C) 2016 Google, Inc.
@@ -26,6 +35,9 @@
 #include <linux/mm.h>
 #include <linux/percpu.h>
 #include <linux/printk.h>
+#include <linux/rcupdate.h>
+#include <linux/seq_file.h>
+#include <linux/debugfs.h>
 #include <linux/slab.h>
 #include <linux/stacktrace.h>
 #include <linux/stackdepot.h>
@@ -58,11 +70,26 @@ union handle_parts {
 	};
 };
 
+/* Evictable records are rounded up to 8, 16, 32 or 64 frames */
+#define DEPOT_EVICT_MIN_FRAMES	8
+#define DEPOT_EVICT_CLASSES	4
+#define DEPOT_EVICT_MAX_FRAMES	(DEPOT_EVICT_MIN_FRAMES << (DEPOT_EVICT_CLASSES - 1))
+#define DEPOT_NO_CLASS		DEPOT_EVICT_CLASSES
+
+/* refs value of a record that is never evicted */
+#define DEPOT_PERMANENT		(-1)
+
+#define DEPOT_SHARDS		64
+
 struct stack_record {
 	struct stack_record *next;	/* Link in the hashtable */
 	u32 hash;			/* Hash in the hastable */
-	u32 size;			/* Number of frames in the stack */
+	u16 size;			/* Number of frames in the stack */
+	u16 class;			/* Size class, DEPOT_NO_CLASS if permanent */
 	union handle_parts handle;
+	atomic_t refs;			/* References or DEPOT_PERMANENT */
+	struct stack_record *free_next;	/* Link in a class freelist */
+	unsigned long rcu_state;	/* Grace period to wait for before reuse */
 	unsigned long entries[];	/* Variable-sized array of entries. */
 };
 
@@ -71,7 +98,19 @@ static void *stack_slabs[STACK_ALLOC_MAX_SLABS];
 static int depot_index;
 static int next_slab_inited;
 static size_t depot_offset;
-static DEFINE_RAW_SPINLOCK(depot_lock);
+/* Protects the above, the freelists and the counters below */
+static DEFINE_RAW_SPINLOCK(depot_pool_lock);
+/* Protect the hash buckets whose index is congruent modulo DEPOT_SHARDS */
+static raw_spinlock_t depot_shard_lock[DEPOT_SHARDS];
+
+/* FIFO per class, so the head is the record most likely past its GP */
+static struct stack_record *depot_free_head[DEPOT_EVICT_CLASSES];
+static struct stack_record *depot_free_tail[DEPOT_EVICT_CLASSES];
+
+static unsigned long depot_nr_live;
+static unsigned long depot_nr_evictable;
+static unsigned long depot_nr_free;
+static unsigned long depot_nr_reused;
 
 static bool init_stack_slab(void **prealloc)
 {
@@ -101,13 +140,47 @@ static bool init_stack_slab(void **prealloc)
 	return true;
 }
 
-/* Allocation of a new stack in raw storage */
+static inline unsigned int depot_size_class(unsigned int size)
+{
+	if (size <= DEPOT_EVICT_MIN_FRAMES)
+		return 0;
+	return order_base_2(size) - ilog2(DEPOT_EVICT_MIN_FRAMES);
+}
+
+/* Take a slot of @class whose grace period has elapsed off the freelist */
+static struct stack_record *depot_reuse_stack(unsigned int class)
+{
+	struct stack_record *stack = depot_free_head[class];
+
+	if (!stack || !poll_state_synchronize_rcu(stack->rcu_state))
+		return NULL;
+
+	depot_free_head[class] = stack->free_next;
+	if (!depot_free_head[class])
+		depot_free_tail[class] = NULL;
+	depot_nr_free--;
+	depot_nr_reused++;
+	return stack;
+}
+
+/* Allocation of a new stack in raw storage, called with depot_pool_lock */
 static struct stack_record *depot_alloc_stack(unsigned long *entries, int size,
-		u32 hash, void **prealloc, gfp_t alloc_flags)
+		u32 hash, void **prealloc, bool evictable)
 {
 	struct stack_record *stack;
-	size_t required_size = struct_size(stack, entries, size);
+	unsigned int class = DEPOT_NO_CLASS;
+	unsigned int capacity = size;
+	size_t required_size;
+
+	if (evictable && size <= DEPOT_EVICT_MAX_FRAMES) {
+		class = depot_size_class(size);
+		capacity = DEPOT_EVICT_MIN_FRAMES << class;
+		stack = depot_reuse_stack(class);
+		if (stack)
+			goto init;
+	}
 
+	required_size = struct_size(stack, entries, capacity);
 	required_size = ALIGN(required_size, 1 << STACK_ALLOC_ALIGN);
 
 	if (unlikely(depot_offset + required_size > STACK_ALLOC_SIZE)) {
@@ -131,13 +204,19 @@ static struct stack_record *depot_alloc_stack(unsigned long *entries, int size,
 
 	stack = stack_slabs[depot_index] + depot_offset;
 
-	stack->hash = hash;
-	stack->size = size;
 	stack->handle.slabindex = depot_index;
 	stack->handle.offset = depot_offset >> STACK_ALLOC_ALIGN;
 	stack->handle.valid = 1;
-	memcpy(stack->entries, entries, flex_array_size(stack, entries, size));
 	depot_offset += required_size;
+init:
+	stack->hash = hash;
+	stack->size = size;
+	stack->class = class;
+	atomic_set(&stack->refs, class == DEPOT_NO_CLASS ? DEPOT_PERMANENT : 1);
+	memcpy(stack->entries, entries, flex_array_size(stack, entries, size));
+	depot_nr_live++;
+	if (class != DEPOT_NO_CLASS)
+		depot_nr_evictable++;
 
 	return stack;
 }
@@ -179,6 +258,8 @@ int __init stack_depot_init(void)
 		stack_table = memblock_alloc(size, size);
 		for (i = 0; i < STACK_HASH_SIZE;  i++)
 			stack_table[i] = NULL;
+		for (i = 0; i < DEPOT_SHARDS; i++)
+			raw_spin_lock_init(&depot_shard_lock[i]);
 	}
 	return 0;
 }
@@ -213,7 +294,7 @@ static inline struct stack_record *find_stack(struct stack_record *bucket,
 {
 	struct stack_record *found;
 
-	for (found = bucket; found; found = found->next) {
+	for (found = bucket; found; found = READ_ONCE(found->next)) {
 		if (found->hash == hash &&
 		    found->size == size &&
 		    !stackdepot_memcmp(entries, found->entries, size))
@@ -222,6 +303,140 @@ static inline struct stack_record *find_stack(struct stack_record *bucket,
 	return NULL;
 }
 
+/*
+ * Take a reference on @stack if @get, or make it permanent otherwise, so
+ * that the handle handed out stays valid.  Fails if the record is dying.
+ */
+static bool depot_get_stack(struct stack_record *stack, bool get)
+{
+	int old = atomic_read(&stack->refs), new;
+
+	do {
+		if (old == DEPOT_PERMANENT)
+			return true;
+		if (!old)
+			return false;
+		new = get ? old + 1 : DEPOT_PERMANENT;
+	} while (!atomic_try_cmpxchg(&stack->refs, &old, new));
+
+	return true;
+}
+
+static struct stack_record *depot_fetch_stack(depot_stack_handle_t handle)
+{
+	union handle_parts parts = { .handle = handle };
+	size_t offset = parts.offset << STACK_ALLOC_ALIGN;
+	void *slab;
+
+	if (parts.slabindex > READ_ONCE(depot_index)) {
+		WARN(1, "slab index %d out of bounds (%d) for stack id %08x\n",
+			parts.slabindex, depot_index, handle);
+		return NULL;
+	}
+	slab = READ_ONCE(stack_slabs[parts.slabindex]);
+	if (!slab)
+		return NULL;
+	return slab + offset;
+}
+
+/* Unlink a record whose last reference is gone and queue it for reuse */
+static void depot_evict_stack(struct stack_record *stack)
+{
+	struct stack_record **pprev = &stack_table[stack->hash & STACK_HASH_MASK];
+	raw_spinlock_t *lock = &depot_shard_lock[stack->hash % DEPOT_SHARDS];
+	unsigned int class = stack->class;
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(lock, flags);
+	for (; *pprev; pprev = &(*pprev)->next) {
+		if (*pprev == stack) {
+			/*
+			 * Lockless readers may still be walking through the
+			 * record, so its ->next stays intact until reuse.
+			 */
+			WRITE_ONCE(*pprev, stack->next);
+			break;
+		}
+	}
+
+	raw_spin_lock(&depot_pool_lock);
+	stack->rcu_state = get_state_synchronize_rcu();
+	stack->free_next = NULL;
+	if (depot_free_tail[class])
+		depot_free_tail[class]->free_next = stack;
+	else
+		depot_free_head[class] = stack;
+	depot_free_tail[class] = stack;
+	depot_nr_free++;
+	depot_nr_live--;
+	depot_nr_evictable--;
+	raw_spin_unlock(&depot_pool_lock);
+	raw_spin_unlock_irqrestore(lock, flags);
+}
+
+/**
+ * stack_depot_get - Take more references on a refcounted stack
+ *
+ * @handle:		Handle from stack_depot_save_flags(STACK_DEPOT_FLAG_GET)
+ *			that the caller holds a reference on.
+ * @nr:			Number of references to add.
+ *
+ * Does nothing for stacks saved without STACK_DEPOT_FLAG_GET.
+ */
+void stack_depot_get(depot_stack_handle_t handle, unsigned int nr)
+{
+	struct stack_record *stack;
+	int old;
+
+	if (!handle || !nr)
+		return;
+	stack = depot_fetch_stack(handle);
+	if (!stack)
+		return;
+
+	old = atomic_read(&stack->refs);
+	do {
+		if (old == DEPOT_PERMANENT)
+			return;
+		if (WARN_ON_ONCE(old <= 0))
+			return;
+	} while (!atomic_try_cmpxchg(&stack->refs, &old, old + nr));
+}
+EXPORT_SYMBOL_GPL(stack_depot_get);
+
+/**
+ * stack_depot_put - Drop references on a refcounted stack
+ *
+ * @handle:		Handle from stack_depot_save_flags(STACK_DEPOT_FLAG_GET)
+ * @nr:			Number of references to drop.
+ *
+ * When the last reference goes, the stack is evicted and @handle may later
+ * be reused for a different stack.  Does nothing for permanent stacks.
+ */
+void stack_depot_put(depot_stack_handle_t handle, unsigned int nr)
+{
+	struct stack_record *stack;
+	int old;
+
+	if (!handle || !nr)
+		return;
+	stack = depot_fetch_stack(handle);
+	if (!stack)
+		return;
+
+	old = atomic_read(&stack->refs);
+	do {
+		if (old == DEPOT_PERMANENT)
+			return;
+		if (WARN_ON_ONCE(old < (int)nr))
+			return;
+	} while (!atomic_try_cmpxchg(&stack->refs, &old, old - nr));
+
+	if (old == nr)
+		depot_evict_stack(stack);
+}
+EXPORT_SYMBOL_GPL(stack_depot_put);
+
 /**
  * stack_depot_fetch - Fetch stack entries from a depot
  *
@@ -234,21 +449,12 @@ static inline struct stack_record *find_stack(struct stack_record *bucket,
 unsigned int stack_depot_fetch(depot_stack_handle_t handle,
 			       unsigned long **entries)
 {
-	union handle_parts parts = { .handle = handle };
-	void *slab;
-	size_t offset = parts.offset << STACK_ALLOC_ALIGN;
 	struct stack_record *stack;
 
 	*entries = NULL;
-	if (parts.slabindex > depot_index) {
-		WARN(1, "slab index %d out of bounds (%d) for stack id %08x\n",
-			parts.slabindex, depot_index, handle);
-		return 0;
-	}
-	slab = stack_slabs[parts.slabindex];
-	if (!slab)
+	stack = depot_fetch_stack(handle);
+	if (!stack)
 		return 0;
-	stack = slab + offset;
 
 	*entries = stack->entries;
 	return stack->size;
@@ -256,22 +462,31 @@ unsigned int stack_depot_fetch(depot_stack_handle_t handle,
 EXPORT_SYMBOL_GPL(stack_depot_fetch);
 
 /**
- * stack_depot_save - Save a stack trace from an array
+ * stack_depot_save_flags - Save a stack trace from an array
  *
  * @entries:		Pointer to storage array
  * @nr_entries:		Size of the storage array
  * @alloc_flags:	Allocation gfp flags
+ * @depot_flags:	STACK_DEPOT_FLAG_* flags
+ *
+ * With STACK_DEPOT_FLAG_GET the caller gets a reference on the stack that
+ * it must drop with stack_depot_put().  Without it, the stack becomes
+ * permanent.  A given stack is best saved in only one of the two ways, as
+ * a single permanent user pins it forever.
  *
  * Return: The handle of the stack struct stored in depot
  */
-depot_stack_handle_t stack_depot_save(unsigned long *entries,
-				      unsigned int nr_entries,
-				      gfp_t alloc_flags)
+depot_stack_handle_t stack_depot_save_flags(unsigned long *entries,
+					    unsigned int nr_entries,
+					    gfp_t alloc_flags,
+					    unsigned int depot_flags)
 {
+	bool get = depot_flags & STACK_DEPOT_FLAG_GET;
 	struct stack_record *found = NULL, **bucket;
 	depot_stack_handle_t retval = 0;
 	struct page *page = NULL;
 	void *prealloc = NULL;
+	raw_spinlock_t *lock;
 	unsigned long flags;
 	u32 hash;
 
@@ -280,14 +495,20 @@ depot_stack_handle_t stack_depot_save(unsigned long *entries,
 
 	hash = hash_stack(entries, nr_entries);
 	bucket = &stack_table[hash & STACK_HASH_MASK];
+	lock = &depot_shard_lock[hash % DEPOT_SHARDS];
 
 	/*
 	 * Fast path: look the stack trace up without locking.
 	 * The smp_load_acquire() here pairs with smp_store_release() to
-	 * |bucket| below.
+	 * |bucket| below.  Evicted records are only reused after a grace
+	 * period; the sched flavour works where RCU is not otherwise watching.
 	 */
+	rcu_read_lock_sched_notrace();
 	found = find_stack(smp_load_acquire(bucket), entries,
 			   nr_entries, hash);
+	if (found && !depot_get_stack(found, get))
+		found = NULL;
+	rcu_read_unlock_sched_notrace();
 	if (found)
 		goto exit;
 
@@ -313,13 +534,18 @@ depot_stack_handle_t stack_depot_save(unsigned long *entries,
 			prealloc = page_address(page);
 	}
 
-	raw_spin_lock_irqsave(&depot_lock, flags);
+	raw_spin_lock_irqsave(lock, flags);
 
 	found = find_stack(*bucket, entries, nr_entries, hash);
+	if (found && !depot_get_stack(found, get))
+		found = NULL;
 	if (!found) {
-		struct stack_record *new =
-			depot_alloc_stack(entries, nr_entries,
-					  hash, &prealloc, alloc_flags);
+		struct stack_record *new;
+
+		raw_spin_lock(&depot_pool_lock);
+		new = depot_alloc_stack(entries, nr_entries, hash, &prealloc,
+					get);
+		raw_spin_unlock(&depot_pool_lock);
 		if (new) {
 			new->next = *bucket;
 			/*
@@ -334,10 +560,12 @@ depot_stack_handle_t stack_depot_save(unsigned long *entries,
 		 * We didn't need to store this stack trace, but let's keep
 		 * the preallocated memory for the future.
 		 */
+		raw_spin_lock(&depot_pool_lock);
 		WARN_ON(!init_stack_slab(&prealloc));
+		raw_spin_unlock(&depot_pool_lock);
 	}
 
-	raw_spin_unlock_irqrestore(&depot_lock, flags);
+	raw_spin_unlock_irqrestore(lock, flags);
 exit:
 	if (prealloc) {
 		/* Nobody used this memory, ok to free it. */
@@ -348,6 +576,23 @@ depot_stack_handle_t stack_depot_save(unsigned long *entries,
 fast_exit:
 	return retval;
 }
+EXPORT_SYMBOL_GPL(stack_depot_save_flags);
+
+/**
+ * stack_depot_save - Save a stack trace from an array
+ *
+ * @entries:		Pointer to storage array
+ * @nr_entries:		Size of the storage array
+ * @alloc_flags:	Allocation gfp flags
+ *
+ * Return: The handle of the stack struct stored in depot
+ */
+depot_stack_handle_t stack_depot_save(unsigned long *entries,
+				      unsigned int nr_entries,
+				      gfp_t alloc_flags)
+{
+	return stack_depot_save_flags(entries, nr_entries, alloc_flags, 0);
+}
 EXPORT_SYMBOL_GPL(stack_depot_save);
 
 static inline int in_irqentry_text(unsigned long ptr)
@@ -372,3 +617,37 @@ unsigned int filter_irq_stacks(unsigned long *entries,
 	return nr_entries;
 }
 EXPORT_SYMBOL_GPL(filter_irq_stacks);
+
+#ifdef CONFIG_DEBUG_FS
+static int stack_depot_stats_show(struct seq_file *m, void *v)
+{
+	unsigned long live, evictable, free, reused;
+	size_t bytes;
+
+	raw_spin_lock_irq(&depot_pool_lock);
+	live = depot_nr_live;
+	evictable = depot_nr_evictable;
+	free = depot_nr_free;
+	reused = depot_nr_reused;
+	bytes = depot_index * STACK_ALLOC_SIZE + depot_offset;
+	raw_spin_unlock_irq(&depot_pool_lock);
+
+	seq_printf(m, "pools: %d\n", depot_index + 1);
+	seq_printf(m, "bytes: %zu\n", bytes);
+	seq_printf(m, "live: %lu\n", live);
+	seq_printf(m, "evictable: %lu\n", evictable);
+	seq_printf(m, "freelist: %lu\n", free);
+	seq_printf(m, "reused: %lu\n", reused);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(stack_depot_stats);
+
+static int __init stack_depot_debugfs_init(void)
+{
+	if (!stack_depot_disable)
+		debugfs_create_file("stack_depot_stats", 0400, NULL, NULL,
+				    &stack_depot_stats_fops);
+	return 0;
+}
+late_initcall(stack_depot_debugfs_init);
+#endif
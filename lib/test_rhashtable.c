@@ -211,7 +211,7 @@ static s64 __init test_rhashtable(struct rhashtable *ht, struct test_obj *array,
 	struct test_obj *obj;
 	int err;
 	unsigned int i, insert_retries = 0;
-	s64 start, end;
+	s64 start, end, lookup;
 
 	/*
 	 * Insertion Test:
@@ -236,8 +236,12 @@ static s64 __init test_rhashtable(struct rhashtable *ht, struct test_obj *array,
 
 	test_bucket_stats(ht, entries);
 	rcu_read_lock();
+	lookup = ktime_get_ns();
 	test_rht_lookup(ht, array, entries);
+	lookup = ktime_get_ns() - lookup;
 	rcu_read_unlock();
+	pr_info("  Looked up %u keys in %lld ns (%lld ns/lookup)\n",
+		entries, lookup, div_s64(lookup, entries));
 
 	test_bucket_stats(ht, entries);
 
@@ -50,6 +50,7 @@ __param(int, run_test_mask, INT_MAX,
 		"\t\tid: 128,  name: pcpu_alloc_test\n"
 		"\t\tid: 256,  name: kvfree_rcu_1_arg_vmalloc_test\n"
 		"\t\tid: 512,  name: kvfree_rcu_2_arg_vmalloc_test\n"
+		"\t\tid: 1024, name: multi_zone_alloc_test\n"
 		/* Add a new test case description here. */
 );
 
@@ -357,6 +358,53 @@ kvfree_rcu_2_arg_vmalloc_test(void)
 	return 0;
 }
 
+/*
+ * Keeps a batch of areas, most of them spanning several vmap zones,
+ * alive at the same time and releases them out of order, so busy
+ * tree insertion/removal, lookups of addresses in the middle of an
+ * area and lazy purging are exercised across all vmap nodes.
+ */
+static int
+multi_zone_alloc_test(void)
+{
+	unsigned long size[32];
+	void *ptr[32];
+	int i, j, rv = 0;
+
+	for (i = 0; i < test_loop_count; i++) {
+		for (j = 0; j < ARRAY_SIZE(ptr); j++) {
+			size[j] = (get_random_u32() % 64 + 1) * PAGE_SIZE;
+			ptr[j] = vmalloc(size[j]);
+			if (!ptr[j]) {
+				rv = -1;
+				continue;
+			}
+
+			*((__u8 *)ptr[j] + size[j] - 1) = 0;
+		}
+
+		for (j = 0; j < ARRAY_SIZE(ptr); j++) {
+			if (!ptr[j])
+				continue;
+
+			if (!vmalloc_to_page(ptr[j] + size[j] - 1))
+				rv = -1;
+		}
+
+		/* Release even slots first, then odd ones. */
+		for (j = 0; j < ARRAY_SIZE(ptr); j += 2)
+			vfree(ptr[j]);
+
+		for (j = 1; j < ARRAY_SIZE(ptr); j += 2)
+			vfree(ptr[j]);
+
+		if (rv)
+			break;
+	}
+
+	return rv;
+}
+
 struct test_case_desc {
 	const char *test_name;
 	int (*test_func)(void);
@@ -373,6 +421,7 @@ static struct test_case_desc test_case_array[] = {
 	{ "pcpu_alloc_test", pcpu_alloc_test },
 	{ "kvfree_rcu_1_arg_vmalloc_test", kvfree_rcu_1_arg_vmalloc_test },
 	{ "kvfree_rcu_2_arg_vmalloc_test", kvfree_rcu_2_arg_vmalloc_test },
+	{ "multi_zone_alloc_test", multi_zone_alloc_test },
 	/* Add a new test case here. */
 };
 
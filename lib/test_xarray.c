@@ -1555,6 +1555,48 @@ static void check_split_1(struct xarray *xa, unsigned long index,
 	xa_destroy(xa);
 }
 
+static noinline void check_store_batch_1(struct xarray *xa,
+		unsigned long index, unsigned int nr, unsigned long busy)
+{
+	XA_STATE(xas, xa, index);
+	static void *entries[200];
+	unsigned int i, stored = 0, expected = nr;
+
+	for (i = 0; i < nr; i++)
+		entries[i] = xa_mk_index(index + i);
+	if (busy >= index && busy < index + nr) {
+		xa_store_index(xa, busy, GFP_KERNEL);
+		expected = busy - index;
+	}
+
+	XA_BUG_ON(xa, xas_prealloc(&xas, nr, GFP_KERNEL));
+	do {
+		xas_lock(&xas);
+		stored += xas_store_batch(&xas, entries + stored, nr - stored);
+		xas_unlock(&xas);
+	} while (xas_nomem(&xas, GFP_KERNEL));
+
+	XA_BUG_ON(xa, stored != expected);
+	for (i = 0; i < stored; i++)
+		XA_BUG_ON(xa, xa_load(xa, index + i) != entries[i]);
+	XA_BUG_ON(xa, xa_load(xa, index + nr) != NULL);
+
+	xa_destroy(xa);
+	XA_BUG_ON(xa, !xa_empty(xa));
+}
+
+static noinline void check_store_batch(struct xarray *xa)
+{
+	check_store_batch_1(xa, 0, 1, ULONG_MAX);
+	check_store_batch_1(xa, 0, 64, ULONG_MAX);
+	check_store_batch_1(xa, 60, 200, ULONG_MAX);
+	check_store_batch_1(xa, 4095, 130, ULONG_MAX);
+	check_store_batch_1(xa, (1UL << 20) - 3, 7, ULONG_MAX);
+	check_store_batch_1(xa, 60, 200, 70);
+	check_store_batch_1(xa, 60, 200, 60);
+	check_store_batch_1(xa, 60, 200, 259);
+}
+
 static noinline void check_split(struct xarray *xa)
 {
 	unsigned int order, new_order;
@@ -1792,6 +1834,7 @@ static int xarray_checks(void)
 	check_move(&array);
 	check_create_range(&array);
 	check_store_range(&array);
+	check_store_batch(&array);
 	check_store_iter(&array);
 	check_align(&xa0);
 	check_split(&array);
@@ -347,6 +347,53 @@ static bool __xas_nomem(struct xa_state *xas, gfp_t gfp)
 	return true;
 }
 
+/**
+ * xas_prealloc() - Allocate nodes ahead of a batch of stores.
+ * @xas: XArray operation state.
+ * @nr: Number of consecutive indices, starting at the index of @xas, which
+ * are about to be stored.
+ * @gfp: Memory allocation flags.
+ *
+ * Call this before taking the xa_lock to allocate every node which
+ * xas_store_batch() could need to fill @nr indices of an empty range, so
+ * that the lock is not dropped and retaken once per node.  Nodes which
+ * turn out not to be needed are freed by xas_nomem() or xas_destroy().
+ *
+ * Context: Process context if @gfp allows blocking.
+ * Return: 0 on success, -ENOMEM if some node could not be allocated.
+ * Whatever was allocated stays in @xas either way.
+ */
+int xas_prealloc(struct xa_state *xas, unsigned long nr, gfp_t gfp)
+{
+	unsigned long first = xas->xa_index;
+	unsigned long last = first + nr - 1;
+	unsigned long nodes = 0;
+	unsigned int shift = 0;
+	struct xa_node *node;
+
+	if (!nr)
+		return 0;
+
+	/* One node per chunk the range touches on each level up to the root */
+	do {
+		shift += XA_CHUNK_SHIFT;
+		nodes += (last >> shift) - (first >> shift) + 1;
+	} while (shift < BITS_PER_LONG && (last >> shift));
+
+	if (xas->xa->xa_flags & XA_FLAGS_ACCOUNT)
+		gfp |= __GFP_ACCOUNT;
+	while (nodes--) {
+		node = kmem_cache_alloc(radix_tree_node_cachep, gfp);
+		if (!node)
+			return -ENOMEM;
+		XA_NODE_BUG_ON(node, !list_empty(&node->private_list));
+		RCU_INIT_POINTER(node->parent, xas->xa_alloc);
+		xas->xa_alloc = node;
+	}
+	return 0;
+}
+EXPORT_SYMBOL_GPL(xas_prealloc);
+
 static void xas_update(struct xa_state *xas, struct xa_node *node)
 {
 	if (xas->xa_update)
@@ -364,7 +411,7 @@ static void *xas_alloc(struct xa_state *xas, unsigned int shift)
 		return NULL;
 
 	if (node) {
-		xas->xa_alloc = NULL;
+		xas->xa_alloc = rcu_dereference_raw(node->parent);
 	} else {
 		gfp_t gfp = GFP_NOWAIT | __GFP_NOWARN;
 
@@ -843,6 +890,73 @@ void *xas_store(struct xa_state *xas, void *entry)
 }
 EXPORT_SYMBOL_GPL(xas_store);
 
+/**
+ * xas_store_batch() - Store consecutive entries into empty slots.
+ * @xas: XArray operation state.
+ * @entries: Entries for the index of @xas and the indices following it.
+ * @nr: Number of entries.
+ *
+ * Each leaf node is walked to once and its slots are filled in a single
+ * pass, with its counters and the update callback run once per node
+ * rather than once per entry.  The entries must be pointers or value
+ * entries, not %NULL or internal entries.  Combine with xas_prealloc() to
+ * avoid allocating nodes under the lock.
+ *
+ * Storing stops at the first index which is not empty, flagging @xas
+ * with -EEXIST, or when a node cannot be allocated, flagging it with
+ * -ENOMEM.  In both cases the index of @xas is the first one which was
+ * not stored.
+ *
+ * Context: Any context.  The caller should hold the xa_lock.
+ * Return: The number of entries stored.
+ */
+unsigned int xas_store_batch(struct xa_state *xas, void **entries,
+			     unsigned int nr)
+{
+	struct xarray *xa = xas->xa;
+	unsigned int done = 0;
+
+	while (done < nr) {
+		struct xa_node *node;
+		unsigned int offset;
+		int count = 0, values = 0;
+
+		if (xas_create(xas, false)) {
+			xas_set_err(xas, -EEXIST);
+			break;
+		}
+		if (xas_error(xas))
+			break;
+		node = xas->xa_node;
+		/* A multi-index entry covers this range */
+		if (node->shift) {
+			xas_set_err(xas, -EEXIST);
+			break;
+		}
+
+		offset = xas->xa_offset;
+		do {
+			void *entry = entries[done];
+
+			XA_NODE_BUG_ON(node, !entry || xa_is_internal(entry));
+			rcu_assign_pointer(node->slots[offset], entry);
+			if (xa_track_free(xa)) {
+				xas->xa_offset = offset;
+				xas_clear_mark(xas, XA_FREE_MARK);
+			}
+			count++;
+			values += xa_is_value(entry);
+			done++;
+		} while (done < nr && ++offset < XA_CHUNK_SIZE &&
+			 !xa_entry_locked(xa, node, offset));
+
+		update_node(xas, node, count, values);
+		xas_set(xas, xas->xa_index + count);
+	}
+	return done;
+}
+EXPORT_SYMBOL_GPL(xas_store_batch);
+
 /**
  * xas_get_mark() - Returns the state of this mark.
  * @xas: XArray operation state.
@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Per-CPU pool of zstd decompression contexts.
+ *
+ * A ZSTD_DCtx needs a ~160KB workspace.  Block users such as zram and the
+ * crypto API wrapper used to carry one per stream or per tfm, which adds up
+ * on large machines and leaves most of them cold in the cache.  The pool
+ * keeps exactly one context per possible CPU, shared by every registered
+ * user.  Bottom halves are disabled while a context is in use so that
+ * softirq users such as IPComp cannot reenter it; hardirq callers are not
+ * supported.
+ */
+
+#include <linux/bottom_half.h>
+#include <linux/cpumask.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/vmalloc.h>
+#include <linux/zstd.h>
+
+struct zstd_dpool_cpu {
+	ZSTD_DCtx *dctx;
+	void *wksp;
+};
+
+static DEFINE_PER_CPU(struct zstd_dpool_cpu, zstd_dpool);
+static DEFINE_MUTEX(zstd_dpool_mutex);
+static unsigned int zstd_dpool_users;
+
+static void zstd_dpool_free(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct zstd_dpool_cpu *pc = per_cpu_ptr(&zstd_dpool, cpu);
+
+		vfree(pc->wksp);
+		pc->wksp = NULL;
+		pc->dctx = NULL;
+	}
+}
+
+static int zstd_dpool_alloc(void)
+{
+	const size_t wksp_size = ZSTD_DCtxWorkspaceBound();
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct zstd_dpool_cpu *pc = per_cpu_ptr(&zstd_dpool, cpu);
+
+		pc->wksp = vmalloc_node(wksp_size, cpu_to_node(cpu));
+		if (!pc->wksp)
+			goto fail;
+		pc->dctx = ZSTD_initDCtx(pc->wksp, wksp_size);
+		if (!pc->dctx)
+			goto fail;
+	}
+	return 0;
+
+fail:
+	zstd_dpool_free();
+	return -ENOMEM;
+}
+
+/* The first user allocates the contexts, the last one frees them. */
+int zstd_dpool_register(void)
+{
+	int ret = 0;
+
+	mutex_lock(&zstd_dpool_mutex);
+	if (!zstd_dpool_users)
+		ret = zstd_dpool_alloc();
+	if (!ret)
+		zstd_dpool_users++;
+	mutex_unlock(&zstd_dpool_mutex);
+
+	return ret;
+}
+EXPORT_SYMBOL(zstd_dpool_register);
+
+void zstd_dpool_unregister(void)
+{
+	mutex_lock(&zstd_dpool_mutex);
+	if (!WARN_ON_ONCE(!zstd_dpool_users) && !--zstd_dpool_users)
+		zstd_dpool_free();
+	mutex_unlock(&zstd_dpool_mutex);
+}
+EXPORT_SYMBOL(zstd_dpool_unregister);
+
+size_t zstd_dpool_decompress(void *dst, size_t dstCapacity, const void *src,
+			     size_t srcSize, const ZSTD_DDict *ddict)
+{
+	struct zstd_dpool_cpu *pc;
+	size_t ret;
+
+	local_bh_disable();
+	pc = this_cpu_ptr(&zstd_dpool);
+	if (ddict)
+		ret = ZSTD_decompress_usingDDict(pc->dctx, dst, dstCapacity,
+						 src, srcSize, ddict);
+	else
+		ret = ZSTD_decompressDCtx(pc->dctx, dst, dstCapacity,
+					  src, srcSize);
+	local_bh_enable();
+
+	return ret;
+}
+EXPORT_SYMBOL(zstd_dpool_decompress);
@@ -3840,6 +3840,247 @@ static void proactive_compact_node(pg_data_t *pgdat)
 	}
 }
 
+/*
+ * Targeted compaction: keep a per-node goal of free blocks of a given order
+ * (/sys/devices/system/node/nodeN/compact_goal) and, when it is not met,
+ * compact only the movable pageblocks that are cheapest to empty, as told
+ * by the per-pageblock free counts the buddy allocator maintains.
+ */
+#define COMPACT_GOAL_MAX_BLOCKS	16
+
+struct compact_goal_candidate {
+	unsigned long pfn;
+	unsigned int nr_free;
+};
+
+static unsigned long node_free_blocks(pg_data_t *pgdat, unsigned int order)
+{
+	unsigned long nr = 0;
+	int zoneid;
+	unsigned int o;
+
+	for (zoneid = 0; zoneid < MAX_NR_ZONES; zoneid++) {
+		struct zone *zone = &pgdat->node_zones[zoneid];
+
+		if (!populated_zone(zone))
+			continue;
+
+		for (o = order; o < MAX_ORDER; o++)
+			nr += READ_ONCE(zone->free_area[o].nr_free) << (o - order);
+	}
+
+	return nr;
+}
+
+static bool compact_goal_unmet(pg_data_t *pgdat)
+{
+	unsigned long goal = READ_ONCE(pgdat->compact_goal_blocks);
+
+	if (!goal || kswapd_is_running(pgdat))
+		return false;
+
+	return node_free_blocks(pgdat, READ_ONCE(pgdat->compact_goal_order)) <
+		goal;
+}
+
+/*
+ * Fill @cand with up to @nr movable, partially free pageblocks of @zone
+ * that have the most free pages, sorted by pfn. Only the free counts are
+ * looked at for the ranking, the pages themselves are not scanned.
+ */
+static int compact_goal_candidates(struct zone *zone,
+				   struct compact_goal_candidate *cand, int nr)
+{
+	u16 *counts = zone->pageblock_nr_free;
+	unsigned long idx;
+	int i, n = 0, worst = 0;
+
+	if (!counts)
+		return 0;
+
+	for (idx = 0; idx < zone->nr_pageblock_nr_free; idx++) {
+		unsigned int nr_free = READ_ONCE(counts[idx]);
+		unsigned long pfn;
+		struct page *page;
+
+		/* Already free, or nothing to gain */
+		if (nr_free >= pageblock_nr_pages || !nr_free)
+			continue;
+		if (n == nr && nr_free <= cand[worst].nr_free)
+			continue;
+
+		pfn = zone->pageblock_nr_free_base + (idx << pageblock_order);
+		page = pageblock_pfn_to_page(pfn, pfn + pageblock_nr_pages, zone);
+		if (!page || !is_migrate_movable(get_pageblock_migratetype(page)))
+			continue;
+
+		if (n < nr) {
+			i = n++;
+		} else {
+			i = worst;
+		}
+		cand[i].pfn = pfn;
+		cand[i].nr_free = nr_free;
+
+		if (n == nr) {
+			for (worst = 0, i = 1; i < n; i++)
+				if (cand[i].nr_free < cand[worst].nr_free)
+					worst = i;
+		}
+	}
+
+	/* Low pfns first, the free scanner comes down from the zone end */
+	for (i = 1; i < n; i++) {
+		struct compact_goal_candidate tmp = cand[i];
+		int j = i;
+
+		while (j > 0 && cand[j - 1].pfn > tmp.pfn) {
+			cand[j] = cand[j - 1];
+			j--;
+		}
+		cand[j] = tmp;
+	}
+
+	return n;
+}
+
+static void compact_goal_zone(struct zone *zone, unsigned long nr_needed,
+			      unsigned int order)
+{
+	struct compact_goal_candidate cand[COMPACT_GOAL_MAX_BLOCKS];
+	struct compact_control cc = {
+		.order = -1,
+		.mode = MIGRATE_SYNC_LIGHT,
+		.ignore_skip_hint = true,
+		.gfp_mask = GFP_KERNEL,
+		.zone = zone,
+	};
+	const isolate_mode_t isolate_mode =
+		(sysctl_compact_unevictable_allowed ? ISOLATE_UNEVICTABLE : 0);
+	unsigned long per_block = pageblock_nr_pages >> order;
+	int i, n;
+
+	n = min_t(unsigned long, COMPACT_GOAL_MAX_BLOCKS,
+		  DIV_ROUND_UP(nr_needed, per_block));
+	n = compact_goal_candidates(zone, cand, n);
+	if (!n)
+		return;
+
+	INIT_LIST_HEAD(&cc.freepages);
+	INIT_LIST_HEAD(&cc.migratepages);
+	cc.free_pfn = pageblock_start_pfn(zone_end_pfn(zone) - 1);
+
+	for (i = 0; i < n; i++) {
+		unsigned long pfn = cand[i].pfn;
+		unsigned long end_pfn = pfn + pageblock_nr_pages;
+
+		/* The free scanner reached the block, nowhere to move to */
+		if (cc.free_pfn < end_pfn)
+			break;
+
+		cc.migrate_pfn = pfn;
+		while (pfn < end_pfn) {
+			int err;
+
+			cc.nr_migratepages = 0;
+			err = isolate_migratepages_block(&cc, pfn, end_pfn,
+							 isolate_mode);
+			if (err || cc.migrate_pfn <= pfn)
+				break;
+			pfn = cc.migrate_pfn;
+
+			if (list_empty(&cc.migratepages))
+				continue;
+
+			err = migrate_pages(&cc.migratepages, compaction_alloc,
+					    compaction_free, (unsigned long)&cc,
+					    cc.mode, MR_COMPACTION, NULL);
+			if (err)
+				break;
+		}
+
+		if (!list_empty(&cc.migratepages)) {
+			putback_movable_pages(&cc.migratepages);
+			cc.nr_migratepages = 0;
+		}
+
+		if (kthread_should_stop() || fatal_signal_pending(current))
+			break;
+		cond_resched();
+	}
+
+	if (cc.nr_freepages > 0) {
+		release_freepages(&cc.freepages);
+		cc.nr_freepages = 0;
+	}
+
+	VM_BUG_ON(!list_empty(&cc.freepages));
+	VM_BUG_ON(!list_empty(&cc.migratepages));
+}
+
+/*
+ * Work towards the node's compact_goal, highest zone first as that is
+ * where the movable allocations live. At most COMPACT_GOAL_MAX_BLOCKS
+ * pageblocks per zone are compacted per call so that kcompactd stays a
+ * background activity.
+ */
+static void compact_goal_node(pg_data_t *pgdat)
+{
+	unsigned int order = READ_ONCE(pgdat->compact_goal_order);
+	unsigned long goal = READ_ONCE(pgdat->compact_goal_blocks);
+	int zoneid;
+
+	for (zoneid = MAX_NR_ZONES - 1; zoneid >= 0; zoneid--) {
+		struct zone *zone = &pgdat->node_zones[zoneid];
+		unsigned long nr_free;
+
+		if (!populated_zone(zone))
+			continue;
+
+		nr_free = node_free_blocks(pgdat, order);
+		if (nr_free >= goal)
+			break;
+
+		compact_goal_zone(zone, goal - nr_free, order);
+	}
+}
+
+/*
+ * Start maintaining @zone->pageblock_nr_free. The initial counts are taken
+ * from the free lists under zone->lock, from then on the buddy allocator
+ * keeps them up to date. Pageblocks outside the zone span at this point
+ * (memory hot-added later) are not tracked.
+ */
+static void __init zone_pageblock_free_init(struct zone *zone)
+{
+	unsigned long base = pageblock_start_pfn(zone->zone_start_pfn);
+	unsigned long nr = DIV_ROUND_UP(zone_end_pfn(zone) - base,
+					pageblock_nr_pages);
+	unsigned long flags;
+	unsigned int order, t;
+	struct page *page;
+	u16 *counts;
+
+	/* The counts are u16 */
+	if (pageblock_nr_pages > U16_MAX)
+		return;
+
+	counts = kvcalloc(nr, sizeof(*counts), GFP_KERNEL);
+	if (!counts)
+		return;
+
+	spin_lock_irqsave(&zone->lock, flags);
+	zone->pageblock_nr_free_base = base;
+	zone->nr_pageblock_nr_free = nr;
+	zone->pageblock_nr_free = counts;
+	for_each_migratetype_order(order, t) {
+		list_for_each_entry(page, &zone->free_area[order].free_list[t],
+				    lru)
+			zone_pageblock_free_mod(zone, page, order, 1);
+	}
+	spin_unlock_irqrestore(&zone->lock, flags);
+}
+
 /* Compact all zones within a node */
 static void compact_node(int nid)
 {
@@ -3944,14 +4185,60 @@ static ssize_t compact_store(struct device *dev,
 }
 static DEVICE_ATTR_WO(compact);
 
+static ssize_t compact_goal_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	pg_data_t *pgdat = NODE_DATA(dev->id);
+	unsigned int order = READ_ONCE(pgdat->compact_goal_order);
+
+	return sysfs_emit(buf, "%u %lu %lu\n", order,
+			  READ_ONCE(pgdat->compact_goal_blocks),
+			  node_free_blocks(pgdat, order));
+}
+
+/* "<order> <nr_blocks>", a zero nr_blocks disables the goal */
+static ssize_t compact_goal_store(struct device *dev,
+				  struct device_attribute *attr,
+				  const char *buf, size_t count)
+{
+	pg_data_t *pgdat = NODE_DATA(dev->id);
+	unsigned int order;
+	unsigned long nr_blocks;
+
+	if (sscanf(buf, "%u %lu", &order, &nr_blocks) != 2)
+		return -EINVAL;
+
+	if (!order || order > pageblock_order)
+		return -EINVAL;
+
+	WRITE_ONCE(pgdat->compact_goal_order, order);
+	WRITE_ONCE(pgdat->compact_goal_blocks, nr_blocks);
+	if (nr_blocks)
+		wake_up_interruptible(&pgdat->kcompactd_wait);
+
+	return count;
+}
+static DEVICE_ATTR_RW(compact_goal);
+
 int compaction_register_node(struct node *node)
 {
-	return device_create_file(&node->dev, &dev_attr_compact);
+	int ret;
+
+	ret = device_create_file(&node->dev, &dev_attr_compact);
+	if (ret)
+		return ret;
+
+	ret = device_create_file(&node->dev, &dev_attr_compact_goal);
+	if (ret)
+		device_remove_file(&node->dev, &dev_attr_compact);
+
+	return ret;
 }
 
 void compaction_unregister_node(struct node *node)
 {
-	return device_remove_file(&node->dev, &dev_attr_compact);
+	device_remove_file(&node->dev, &dev_attr_compact_goal);
+	device_remove_file(&node->dev, &dev_attr_compact);
 }
 #endif /* CONFIG_SYSFS && CONFIG_NUMA */
 
@@ -4113,7 +4400,8 @@ static int kcompactd(void *p)
 		 * Avoid the unnecessary wakeup for proactive compaction
 		 * when it is disabled.
 		 */
-		if (!sysctl_compaction_proactiveness)
+		if (!sysctl_compaction_proactiveness &&
+		    !READ_ONCE(pgdat->compact_goal_blocks))
 			timeout = MAX_SCHEDULE_TIMEOUT;
 		trace_mm_compaction_kcompactd_sleep(pgdat->node_id);
 		if (wait_event_freezable_timeout(pgdat->kcompactd_wait,
@@ -4153,6 +4441,17 @@ static int kcompactd(void *p)
 				timeout =
 				   default_timeout << COMPACT_MAX_DEFER_SHIFT;
 		}
+		if (compact_goal_unmet(pgdat)) {
+			unsigned int order = READ_ONCE(pgdat->compact_goal_order);
+			unsigned long prev_free;
+
+			prev_free = node_free_blocks(pgdat, order);
+			compact_goal_node(pgdat);
+			/* Same back-off as above when nothing was gained */
+			if (node_free_blocks(pgdat, order) <= prev_free)
+				timeout =
+				   default_timeout << COMPACT_MAX_DEFER_SHIFT;
+		}
 		if (unlikely(pgdat->proactive_compact_trigger))
 			pgdat->proactive_compact_trigger = false;
 	}
@@ -4220,6 +4519,7 @@ static int kcompactd_cpu_online(unsigned int cpu)
 
 static int __init kcompactd_init(void)
 {
+	struct zone *zone;
 	int nid;
 	int ret;
 
@@ -4231,6 +4531,9 @@ static int __init kcompactd_init(void)
 		return ret;
 	}
 
+	for_each_populated_zone(zone)
+		zone_pageblock_free_init(zone);
+
 	for_each_node_state(nid, N_MEMORY)
 		kcompactd_run(nid);
 	return 0;
@@ -231,6 +231,42 @@ static void damon_test_split_regions_of(struct kunit *test)
 	damon_destroy_ctx(c);
 }
 
+static void damon_test_apply_schemes_quota(struct kunit *test)
+{
+	struct damon_ctx *c = damon_new_ctx();
+	struct damos_quota quota = {
+		.sz = 30,
+		.reset_interval = 1000 * 1000,
+	};
+	struct damon_target *t;
+	struct damon_region *r;
+	struct damos *s;
+
+	t = damon_new_target(42);
+	r = damon_new_region(0, 100);
+	r->nr_accesses = 5;
+	damon_add_region(r, t);
+	damon_add_target(c, t);
+
+	s = damon_new_scheme(0, ULONG_MAX, 0, UINT_MAX, 0, UINT_MAX,
+			DAMOS_STAT, &quota);
+	damon_add_scheme(c, s);
+
+	/* Only the quota-sized head of the region is charged */
+	kdamond_apply_schemes(c);
+	KUNIT_EXPECT_EQ(test, damon_nr_regions(t), 2u);
+	KUNIT_EXPECT_EQ(test, r->ar.end, 30ul);
+	KUNIT_EXPECT_EQ(test, s->stat_count, 1ul);
+	KUNIT_EXPECT_EQ(test, s->stat_sz, 30ul);
+
+	/* The quota is exhausted until the reset interval passes */
+	kdamond_apply_schemes(c);
+	KUNIT_EXPECT_EQ(test, s->stat_count, 1ul);
+	KUNIT_EXPECT_EQ(test, s->stat_sz, 30ul);
+
+	damon_destroy_ctx(c);
+}
+
 static struct kunit_case damon_test_cases[] = {
 	KUNIT_CASE(damon_test_target),
 	KUNIT_CASE(damon_test_regions),
@@ -239,6 +275,7 @@ static struct kunit_case damon_test_cases[] = {
 	KUNIT_CASE(damon_test_merge_two),
 	KUNIT_CASE(damon_test_merge_regions_of),
 	KUNIT_CASE(damon_test_split_regions_of),
+	KUNIT_CASE(damon_test_apply_schemes_quota),
 	{},
 };
 
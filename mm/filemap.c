@@ -1003,6 +1003,82 @@ int add_to_page_cache_lru(struct page *page, struct address_space *mapping,
 }
 EXPORT_SYMBOL_GPL(add_to_page_cache_lru);
 
+/**
+ * add_to_page_cache_lru_batch - add consecutive pages to the pagecache
+ * @pages:	pages to add, for @index, @index + 1, ...
+ * @nr:		number of pages
+ * @mapping:	the pages' address_space
+ * @index:	index of the first page
+ * @gfp_mask:	page allocation mode
+ *
+ * Like add_to_page_cache_lru() for a run of order-0 pages, but the xarray
+ * nodes are allocated up front and the pages are stored under a single
+ * acquisition of the i_pages lock.  Only empty indices are filled: the
+ * batch stops at the first index which holds a page or a shadow entry,
+ * which the caller may then add with add_to_page_cache_lru().
+ *
+ * The pages which were not added are handed back unlocked, with the
+ * caller's reference.
+ *
+ * Return: the number of pages added from the start of @pages.
+ */
+unsigned int add_to_page_cache_lru_batch(struct page **pages, unsigned int nr,
+					 struct address_space *mapping,
+					 pgoff_t index, gfp_t gfp_mask)
+{
+	XA_STATE(xas, &mapping->i_pages, index);
+	unsigned int i, charged, added = 0;
+	gfp_t gfp = gfp_mask & GFP_RECLAIM_MASK;
+
+	mapping_set_update(&xas, mapping);
+
+	for (charged = 0; charged < nr; charged++) {
+		struct page *page = pages[charged];
+
+		VM_BUG_ON_PAGE(PageSwapBacked(page) || PageCompound(page), page);
+		__SetPageLocked(page);
+		get_page(page);
+		page->mapping = mapping;
+		page->index = index + charged;
+		if (mem_cgroup_charge(page, NULL, gfp_mask)) {
+			page->mapping = NULL;
+			put_page(page);
+			__ClearPageLocked(page);
+			break;
+		}
+	}
+
+	if (charged && !xas_prealloc(&xas, charged, gfp)) {
+		do {
+			unsigned int stored;
+
+			xas_lock_irq(&xas);
+			stored = xas_store_batch(&xas, (void **)pages + added,
+						 charged - added);
+			for (i = added; i < added + stored; i++)
+				__inc_lruvec_page_state(pages[i], NR_FILE_PAGES);
+			mapping->nrpages += stored;
+			added += stored;
+			xas_unlock_irq(&xas);
+		} while (xas_nomem(&xas, gfp));
+	} else {
+		xas_nomem(&xas, gfp);
+	}
+
+	for (i = 0; i < added; i++) {
+		WARN_ON_ONCE(PageActive(pages[i]));
+		trace_mm_filemap_add_to_page_cache(pages[i]);
+		lru_cache_add(pages[i]);
+	}
+	for (i = added; i < charged; i++) {
+		mem_cgroup_uncharge(pages[i]);
+		pages[i]->mapping = NULL;
+		put_page(pages[i]);
+		__ClearPageLocked(pages[i]);
+	}
+	return added;
+}
+
 #ifdef CONFIG_NUMA
 struct page *__page_cache_alloc(gfp_t gfp)
 {
@@ -1646,9 +1646,12 @@ static void __prep_account_new_huge_page(struct hstate *h, int nid)
 	h->nr_huge_pages_node[nid]++;
 }
 
+/*
+ * Freeing the vmemmap pages of a new page is up to the callers, so that it
+ * can be done for many pages at once, see free_huge_page_vmemmap_list().
+ */
 static void __prep_new_huge_page(struct hstate *h, struct page *page)
 {
-	free_huge_page_vmemmap(h, page);
 	INIT_LIST_HEAD(&page->lru);
 	set_compound_page_dtor(page, HUGETLB_PAGE_DTOR);
 	hugetlb_set_page_subpool(page, NULL);
@@ -1855,10 +1858,11 @@ static struct page *alloc_buddy_huge_page(struct hstate *h,
 }
 
 /*
- * Common helper to allocate a fresh hugetlb page. All specific allocators
- * should use this function to get new hugetlb pages
+ * Allocates and prepares a fresh hugetlb page, but leaves its vmemmap
+ * alone. Use alloc_fresh_huge_page() unless the vmemmap of the page is
+ * going to be freed along with other pages.
  */
-static struct page *alloc_fresh_huge_page(struct hstate *h,
+static struct page *__alloc_fresh_huge_page(struct hstate *h,
 		gfp_t gfp_mask, int nid, nodemask_t *nmask,
 		nodemask_t *node_alloc_noretry)
 {
@@ -1894,29 +1898,70 @@ static struct page *alloc_fresh_huge_page(struct hstate *h,
 }
 
 /*
- * Allocates a fresh page to the hugetlb allocator pool in the node interleaved
- * manner.
+ * Common helper to allocate a fresh hugetlb page. All specific allocators
+ * should use this function to get new hugetlb pages
  */
-static int alloc_pool_huge_page(struct hstate *h, nodemask_t *nodes_allowed,
-				nodemask_t *node_alloc_noretry)
+static struct page *alloc_fresh_huge_page(struct hstate *h,
+		gfp_t gfp_mask, int nid, nodemask_t *nmask,
+		nodemask_t *node_alloc_noretry)
 {
 	struct page *page;
+
+	page = __alloc_fresh_huge_page(h, gfp_mask, nid, nmask,
+				       node_alloc_noretry);
+	if (page)
+		free_huge_page_vmemmap(h, page);
+
+	return page;
+}
+
+/*
+ * Allocates up to @nr fresh pages to the hugetlb allocator pool in the node
+ * interleaved manner. The vmemmap pages of all of them are freed in one go,
+ * which takes a couple of TLB flushes in total rather than per page.
+ * Returns the number of pages added to the pool.
+ */
+static unsigned long alloc_pool_huge_pages(struct hstate *h, unsigned long nr,
+					   nodemask_t *nodes_allowed,
+					   nodemask_t *node_alloc_noretry)
+{
+	struct page *page, *next;
+	unsigned long allocated = 0;
 	int nr_nodes, node;
 	gfp_t gfp_mask = htlb_alloc_mask(h) | __GFP_THISNODE;
+	LIST_HEAD(page_list);
 
-	for_each_node_mask_to_alloc(h, nr_nodes, node, nodes_allowed) {
-		page = alloc_fresh_huge_page(h, gfp_mask, node, nodes_allowed,
-						node_alloc_noretry);
-		if (page)
+	while (allocated < nr) {
+		page = NULL;
+		for_each_node_mask_to_alloc(h, nr_nodes, node, nodes_allowed) {
+			page = __alloc_fresh_huge_page(h, gfp_mask, node,
+					nodes_allowed, node_alloc_noretry);
+			if (page)
+				break;
+		}
+
+		if (!page)
+			break;
+
+		list_add_tail(&page->lru, &page_list);
+		allocated++;
+
+		/* yield cpu to avoid soft lockup */
+		cond_resched();
+
+		/* Bail for signals. Probably ctrl-c from user */
+		if (signal_pending(current))
 			break;
 	}
 
-	if (!page)
-		return 0;
+	free_huge_page_vmemmap_list(h, &page_list);
 
-	put_page(page); /* free it into the hugepage allocator */
+	list_for_each_entry_safe(page, next, &page_list, lru) {
+		list_del_init(&page->lru);
+		put_page(page); /* free it into the hugepage allocator */
+	}
 
-	return 1;
+	return allocated;
 }
 
 /*
@@ -2656,6 +2701,7 @@ static int alloc_and_dissolve_huge_page(struct hstate *h, struct page *old_page,
 	ClearHPageTemporary(new_page);
 
 	__prep_new_huge_page(h, new_page);
+	free_huge_page_vmemmap(h, new_page);
 
 retry:
 	spin_lock_irq(&hugetlb_lock);
@@ -2929,17 +2975,21 @@ int __alloc_bootmem_huge_page(struct hstate *h)
 static void __init gather_bootmem_prealloc(void)
 {
 	struct huge_bootmem_page *m;
+	struct page *page, *next;
+	struct hstate *h;
+	LIST_HEAD(page_list);
 
 	list_for_each_entry(m, &huge_boot_pages, list) {
-		struct page *page = virt_to_page(m);
-		struct hstate *h = m->hstate;
+		page = virt_to_page(m);
+		h = m->hstate;
 
 		VM_BUG_ON(!hstate_is_gigantic(h));
 		WARN_ON(page_count(page) != 1);
 		if (prep_compound_gigantic_page(page, huge_page_order(h))) {
 			WARN_ON(PageReserved(page));
 			prep_new_huge_page(h, page, page_to_nid(page));
-			put_page(page); /* add to the hugepage allocator */
+			/* added to the hugepage allocator below */
+			list_add_tail(&page->lru, &page_list);
 		} else {
 			/* VERY unlikely inflated ref count on a tail page */
 			free_gigantic_page(page, huge_page_order(h));
@@ -2953,6 +3003,25 @@ static void __init gather_bootmem_prealloc(void)
 		adjust_managed_page_count(page, pages_per_huge_page(h));
 		cond_resched();
 	}
+
+	/*
+	 * The list may mix hstates, so remap the vmemmap of each hstate's
+	 * pages as a single batch.
+	 */
+	for_each_hstate(h) {
+		LIST_HEAD(hstate_list);
+
+		list_for_each_entry_safe(page, next, &page_list, lru)
+			if (page_hstate(page) == h)
+				list_move_tail(&page->lru, &hstate_list);
+
+		free_huge_page_vmemmap_list(h, &hstate_list);
+
+		list_for_each_entry_safe(page, next, &hstate_list, lru) {
+			list_del_init(&page->lru);
+			put_page(page); /* add to the hugepage allocator */
+		}
+	}
 }
 
 static void __init hugetlb_hstate_alloc_pages(struct hstate *h)
@@ -2978,19 +3047,20 @@ static void __init hugetlb_hstate_alloc_pages(struct hstate *h)
 	if (node_alloc_noretry)
 		nodes_clear(*node_alloc_noretry);
 
-	for (i = 0; i < h->max_huge_pages; ++i) {
-		if (hstate_is_gigantic(h)) {
+	if (!hstate_is_gigantic(h)) {
+		i = alloc_pool_huge_pages(h, h->max_huge_pages,
+					  &node_states[N_MEMORY],
+					  node_alloc_noretry);
+	} else {
+		for (i = 0; i < h->max_huge_pages; ++i) {
 			if (hugetlb_cma_size) {
 				pr_warn_once("HugeTLB: hugetlb_cma is enabled, skip boot time allocation\n");
 				goto free;
 			}
 			if (!alloc_bootmem_huge_page(h))
 				break;
-		} else if (!alloc_pool_huge_page(h,
-					 &node_states[N_MEMORY],
-					 node_alloc_noretry))
-			break;
-		cond_resched();
+			cond_resched();
+		}
 	}
 	if (i < h->max_huge_pages) {
 		char buf[32];
@@ -3185,6 +3255,8 @@ static int set_max_huge_pages(struct hstate *h, unsigned long count, int nid,
 	}
 
 	while (count > persistent_huge_pages(h)) {
+		unsigned long nr = count - persistent_huge_pages(h);
+
 		/*
 		 * If this allocation races such that we no longer need the
 		 * page, free_huge_page will handle it by freeing the page
@@ -3195,10 +3267,10 @@ static int set_max_huge_pages(struct hstate *h, unsigned long count, int nid,
 		/* yield cpu to avoid soft lockup */
 		cond_resched();
 
-		ret = alloc_pool_huge_page(h, nodes_allowed,
-						node_alloc_noretry);
+		ret = alloc_pool_huge_pages(h, nr, nodes_allowed,
+					    node_alloc_noretry);
 		spin_lock_irq(&hugetlb_lock);
-		if (!ret)
+		if (ret < nr)
 			goto out;
 
 		/* Bail for signals. Probably ctrl-c from user */
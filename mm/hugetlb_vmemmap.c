@@ -124,9 +124,9 @@
  * page of page structs (page 0) associated with the HugeTLB page contains the 4
  * page structs necessary to describe the HugeTLB. The only use of the remaining
  * pages of page structs (page 1 to page 7) is to point to page->compound_head.
- * Therefore, we can remap pages 2 to 7 to page 1. Only 2 pages of page structs
+ * Therefore, we can remap pages 1 to 7 to page 0. Only 1 page of page structs
  * will be used for each HugeTLB page. This will allow us to free the remaining
- * 6 pages to the buddy allocator.
+ * 7 pages to the buddy allocator.
  *
  * Here is how things look after remapping.
  *
@@ -134,30 +134,36 @@
  * +-----------+ ---virt_to_page---> +-----------+   mapping to   +-----------+
  * |           |                     |     0     | -------------> |     0     |
  * |           |                     +-----------+                +-----------+
- * |           |                     |     1     | -------------> |     1     |
- * |           |                     +-----------+                +-----------+
- * |           |                     |     2     | ----------------^ ^ ^ ^ ^ ^
- * |           |                     +-----------+                   | | | | |
- * |           |                     |     3     | ------------------+ | | | |
- * |           |                     +-----------+                     | | | |
- * |           |                     |     4     | --------------------+ | | |
- * |    PMD    |                     +-----------+                       | | |
- * |   level   |                     |     5     | ----------------------+ | |
- * |  mapping  |                     +-----------+                         | |
- * |           |                     |     6     | ------------------------+ |
- * |           |                     +-----------+                           |
- * |           |                     |     7     | --------------------------+
+ * |           |                     |     1     | ---------------^ ^ ^ ^ ^ ^ ^
+ * |           |                     +-----------+                  | | | | | |
+ * |           |                     |     2     | -----------------+ | | | | |
+ * |           |                     +-----------+                    | | | | |
+ * |           |                     |     3     | -------------------+ | | | |
+ * |           |                     +-----------+                      | | | |
+ * |           |                     |     4     | ---------------------+ | | |
+ * |    PMD    |                     +-----------+                        | | |
+ * |   level   |                     |     5     | -----------------------+ | |
+ * |  mapping  |                     +-----------+                          | |
+ * |           |                     |     6     | -------------------------+ |
+ * |           |                     +-----------+                            |
+ * |           |                     |     7     | ---------------------------+
  * |           |                     +-----------+
  * |           |
  * |           |
  * |           |
  * +-----------+
  *
- * When a HugeTLB is freed to the buddy system, we should allocate 6 pages for
+ * When a HugeTLB is freed to the buddy system, we should allocate 7 pages for
  * vmemmap pages and restore the previous mapping relationship.
  *
  * For the HugeTLB page of the pud level mapping. It is similar to the former.
- * We also can use this approach to free (PAGE_SIZE - 2) vmemmap pages.
+ * We also can use this approach to free (PAGE_SIZE - 1) vmemmap pages, which
+ * leaves a single vmemmap page per 1GB HugeTLB page on x86-64.
+ *
+ * Since the head vmemmap page is not freed and all tail vmemmap pages map to
+ * it, there is more than one struct page with PG_head associated with each
+ * HugeTLB page (e.g. 8 per 2MB HugeTLB page). compound_head() copes with these
+ * fake heads, see page_fixed_fake_head().
  *
  * Apart from the HugeTLB page of the pmd/pud level mapping, some architectures
  * (e.g. aarch64) provides a contiguous bit in the translation table entries
@@ -166,23 +172,61 @@
  *
  * The contiguous bit is used to increase the mapping size at the pmd and pte
  * (last) level. So this type of HugeTLB page can be optimized only when its
- * size of the struct page structs is greater than 2 pages.
+ * size of the struct page structs is greater than 1 page.
+ *
+ * The optimization can be switched at runtime through the
+ * vm.hugetlb_optimize_vmemmap sysctl. That only affects HugeTLB pages
+ * allocated afterwards, pages which are already optimized keep their layout
+ * until they are freed to the buddy allocator. When many HugeTLB pages are
+ * allocated at once (e.g. by growing nr_hugepages), their vmemmap is
+ * remapped as a batch, see free_huge_page_vmemmap_list().
  */
 #define pr_fmt(fmt)	"HugeTLB: " fmt
 
+#include <linux/memory_hotplug.h>
+#include <linux/sysctl.h>
+#include <asm/tlbflush.h>
+
 #include "hugetlb_vmemmap.h"
 
 /*
  * There are a lot of struct page structures associated with each HugeTLB page.
- * For tail pages, the value of compound_head is the same. So we can reuse first
- * page of tail page structures. We map the virtual addresses of the remaining
- * pages of tail page structures to the first tail page struct, and then free
- * these page frames. Therefore, we need to reserve two pages as vmemmap areas.
+ * For tail pages, the value of compound_head is the same. So we can reuse the
+ * head page of page structures. We map the virtual addresses of all the pages
+ * of tail page structures to the head page struct, and then free these page
+ * frames. Therefore, we need to reserve one page as vmemmap areas.
  */
-#define RESERVE_VMEMMAP_NR		2U
+#define RESERVE_VMEMMAP_NR		1U
 #define RESERVE_VMEMMAP_SIZE		(RESERVE_VMEMMAP_NR << PAGE_SHIFT)
 
-bool hugetlb_free_vmemmap_enabled = IS_ENABLED(CONFIG_HUGETLB_PAGE_FREE_VMEMMAP_DEFAULT_ON);
+enum vmemmap_optimize_mode {
+	VMEMMAP_OPTIMIZE_OFF,
+	VMEMMAP_OPTIMIZE_ON,
+};
+
+/*
+ * The key is held once while the optimization is switched on and once for
+ * every HugeTLB page whose vmemmap is currently optimized, so fake heads are
+ * handled as long as any of them exist.
+ */
+DEFINE_STATIC_KEY_MAYBE(CONFIG_HUGETLB_PAGE_FREE_VMEMMAP_DEFAULT_ON,
+			hugetlb_optimize_vmemmap_key);
+EXPORT_SYMBOL(hugetlb_optimize_vmemmap_key);
+
+static enum vmemmap_optimize_mode vmemmap_optimize_mode =
+	IS_ENABLED(CONFIG_HUGETLB_PAGE_FREE_VMEMMAP_DEFAULT_ON);
+
+static void vmemmap_optimize_mode_switch(enum vmemmap_optimize_mode to)
+{
+	if (vmemmap_optimize_mode == to)
+		return;
+
+	if (to == VMEMMAP_OPTIMIZE_OFF)
+		static_branch_dec(&hugetlb_optimize_vmemmap_key);
+	else
+		static_branch_inc(&hugetlb_optimize_vmemmap_key);
+	WRITE_ONCE(vmemmap_optimize_mode, to);
+}
 
 static int __init early_hugetlb_free_vmemmap_param(char *buf)
 {
@@ -196,9 +240,9 @@ static int __init early_hugetlb_free_vmemmap_param(char *buf)
 		return -EINVAL;
 
 	if (!strcmp(buf, "on"))
-		hugetlb_free_vmemmap_enabled = true;
+		vmemmap_optimize_mode_switch(VMEMMAP_OPTIMIZE_ON);
 	else if (!strcmp(buf, "off"))
-		hugetlb_free_vmemmap_enabled = false;
+		vmemmap_optimize_mode_switch(VMEMMAP_OPTIMIZE_OFF);
 	else
 		return -EINVAL;
 
@@ -237,33 +281,167 @@ int alloc_huge_page_vmemmap(struct hstate *h, struct page *head)
 	ret = vmemmap_remap_alloc(vmemmap_addr, vmemmap_end, vmemmap_reuse,
 				  GFP_KERNEL | __GFP_NORETRY | __GFP_THISNODE);
 
-	if (!ret)
+	if (!ret) {
 		ClearHPageVmemmapOptimized(head);
+		static_branch_dec(&hugetlb_optimize_vmemmap_key);
+	}
 
 	return ret;
 }
 
-void free_huge_page_vmemmap(struct hstate *h, struct page *head)
+static bool vmemmap_should_optimize(struct hstate *h)
 {
+	return READ_ONCE(vmemmap_optimize_mode) &&
+	       free_vmemmap_pages_per_hpage(h);
+}
+
+static int __free_huge_page_vmemmap(struct hstate *h, struct page *head,
+				    struct list_head *freed_pages,
+				    unsigned long flags)
+{
+	int ret;
 	unsigned long vmemmap_addr = (unsigned long)head;
 	unsigned long vmemmap_end, vmemmap_reuse;
 
-	if (!free_vmemmap_pages_per_hpage(h))
-		return;
+	if (!vmemmap_should_optimize(h))
+		return 0;
 
 	vmemmap_addr += RESERVE_VMEMMAP_SIZE;
 	vmemmap_end = vmemmap_addr + free_vmemmap_pages_size_per_hpage(h);
 	vmemmap_reuse = vmemmap_addr - PAGE_SIZE;
 
+	/*
+	 * Fake heads show up as soon as the first tail vmemmap page is
+	 * remapped, so compound_head() has to start looking for them before.
+	 */
+	static_branch_inc(&hugetlb_optimize_vmemmap_key);
+
 	/*
 	 * Remap the vmemmap virtual address range [@vmemmap_addr, @vmemmap_end)
 	 * to the page which @vmemmap_reuse is mapped to, then free the pages
 	 * which the range [@vmemmap_addr, @vmemmap_end] is mapped to.
 	 */
-	if (!vmemmap_remap_free(vmemmap_addr, vmemmap_end, vmemmap_reuse))
+	ret = vmemmap_remap_free(vmemmap_addr, vmemmap_end, vmemmap_reuse,
+				 freed_pages, flags);
+	if (ret)
+		static_branch_dec(&hugetlb_optimize_vmemmap_key);
+	else
 		SetHPageVmemmapOptimized(head);
+
+	return ret;
+}
+
+void free_huge_page_vmemmap(struct hstate *h, struct page *head)
+{
+	__free_huge_page_vmemmap(h, head, NULL, 0);
 }
 
+static int split_huge_page_vmemmap(struct hstate *h, struct page *head)
+{
+	unsigned long vmemmap_addr = (unsigned long)head;
+	unsigned long vmemmap_end, vmemmap_reuse;
+
+	vmemmap_addr += RESERVE_VMEMMAP_SIZE;
+	vmemmap_end = vmemmap_addr + free_vmemmap_pages_size_per_hpage(h);
+	vmemmap_reuse = vmemmap_addr - PAGE_SIZE;
+
+	return vmemmap_remap_split(vmemmap_addr, vmemmap_end, vmemmap_reuse);
+}
+
+/**
+ * free_huge_page_vmemmap_list - free the vmemmap pages of a list of HugeTLB
+ *				 pages
+ * @h:		the hstate of the pages.
+ * @page_list:	list of HugeTLB pages linked through page->lru.
+ *
+ * Same as calling free_huge_page_vmemmap() on every page of @page_list, but
+ * the vmemmap PMDs of all pages are split first and then all pages are
+ * remapped, each step followed by a single TLB flush. Growing the pool by
+ * a large number of pages thus does not flush the TLB once or twice for
+ * every single page.
+ */
+void free_huge_page_vmemmap_list(struct hstate *h, struct list_head *page_list)
+{
+	struct page *page;
+	LIST_HEAD(vmemmap_pages);
+
+	if (!vmemmap_should_optimize(h) || list_empty(page_list))
+		return;
+
+	/* A ranged flush is cheaper for a single page. */
+	if (list_is_singular(page_list)) {
+		page = list_first_entry(page_list, struct page, lru);
+		free_huge_page_vmemmap(h, page);
+		return;
+	}
+
+	list_for_each_entry(page, page_list, lru) {
+		/*
+		 * Failing to split is not fatal, vmemmap_remap_free() splits
+		 * on its own then, just flushing the TLB for that PMD.
+		 */
+		if (split_huge_page_vmemmap(h, page))
+			break;
+	}
+
+	flush_tlb_all();
+
+	list_for_each_entry(page, page_list, lru) {
+		int ret;
+
+		ret = __free_huge_page_vmemmap(h, page, &vmemmap_pages,
+					       VMEMMAP_REMAP_NO_TLB_FLUSH);
+
+		/*
+		 * Splitting the PMDs may take page table pages. If that fails
+		 * for lack of memory, release the vmemmap pages gathered so
+		 * far and retry once.
+		 */
+		if (ret == -ENOMEM && !list_empty(&vmemmap_pages)) {
+			flush_tlb_all();
+			free_vmemmap_page_list(&vmemmap_pages);
+			__free_huge_page_vmemmap(h, page, &vmemmap_pages,
+						 VMEMMAP_REMAP_NO_TLB_FLUSH);
+		}
+	}
+
+	flush_tlb_all();
+	free_vmemmap_page_list(&vmemmap_pages);
+}
+
+#ifdef CONFIG_PROC_SYSCTL
+int hugetlb_optimize_vmemmap_handler(struct ctl_table *table, int write,
+				     void *buffer, size_t *length, loff_t *ppos)
+{
+	static DEFINE_MUTEX(mode_mutex);
+	struct ctl_table t;
+	int mode, ret;
+
+	if (write && !capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	mutex_lock(&mode_mutex);
+	mode = vmemmap_optimize_mode;
+	t = *table;
+	t.data = &mode;
+	ret = proc_dointvec_minmax(&t, write, buffer, length, ppos);
+	if (write && !ret) {
+		/*
+		 * The memmap of memory hotplugged with memmap_on_memory lives
+		 * in the hotplugged range itself and must not be freed.
+		 */
+		if (mode && (!is_power_of_2(sizeof(struct page)) ||
+			     mhp_memmap_on_memory()))
+			ret = -EPERM;
+		else
+			vmemmap_optimize_mode_switch(mode);
+	}
+	mutex_unlock(&mode_mutex);
+
+	return ret;
+}
+#endif
+
 void __init hugetlb_vmemmap_init(struct hstate *h)
 {
 	unsigned int nr_pages = pages_per_huge_page(h);
@@ -277,14 +455,17 @@ void __init hugetlb_vmemmap_init(struct hstate *h)
 	BUILD_BUG_ON(__NR_USED_SUBPAGE >=
 		     RESERVE_VMEMMAP_SIZE / sizeof(struct page));
 
-	if (!hugetlb_free_vmemmap_enabled)
+	/*
+	 * The optimization may be switched on at runtime, so the number of
+	 * vmemmap pages that can be freed is always set up.
+	 */
+	if (!is_power_of_2(sizeof(struct page)))
 		return;
 
 	vmemmap_pages = (nr_pages * sizeof(struct page)) >> PAGE_SHIFT;
 	/*
-	 * The head page and the first tail page are not to be freed to buddy
-	 * allocator, the other pages will map to the first tail page, so they
-	 * can be freed.
+	 * The head page is not to be freed to buddy allocator, the other tail
+	 * pages will map to the head page, so they can be freed.
 	 *
 	 * Could RESERVE_VMEMMAP_NR be greater than @vmemmap_pages? It is true
 	 * on some architectures (e.g. aarch64). See Documentation/arm64/
@@ -13,6 +13,7 @@
 #ifdef CONFIG_HUGETLB_PAGE_FREE_VMEMMAP
 int alloc_huge_page_vmemmap(struct hstate *h, struct page *head);
 void free_huge_page_vmemmap(struct hstate *h, struct page *head);
+void free_huge_page_vmemmap_list(struct hstate *h, struct list_head *page_list);
 void hugetlb_vmemmap_init(struct hstate *h);
 
 /*
@@ -33,6 +34,11 @@ static inline void free_huge_page_vmemmap(struct hstate *h, struct page *head)
 {
 }
 
+static inline void free_huge_page_vmemmap_list(struct hstate *h,
+					       struct list_head *page_list)
+{
+}
+
 static inline void hugetlb_vmemmap_init(struct hstate *h)
 {
 }
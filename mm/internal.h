@@ -410,6 +410,43 @@ isolate_migratepages_range(struct compact_control *cc,
 int find_suitable_fallback(struct free_area *area, unsigned int order,
 			int migratetype, bool only_stealable, bool *can_steal);
 
+#ifdef CONFIG_COMPACTION
+/*
+ * Account @order pages at @page entering (@sign 1) or leaving (@sign -1)
+ * the free lists of @zone in the per-pageblock free counts. Caller holds
+ * zone->lock.
+ */
+static inline void zone_pageblock_free_mod(struct zone *zone,
+					   struct page *page,
+					   unsigned int order, int sign)
+{
+	u16 *counts = zone->pageblock_nr_free;
+	unsigned long idx, nr;
+
+	if (!counts)
+		return;
+
+	idx = (page_to_pfn(page) - zone->pageblock_nr_free_base) >>
+		pageblock_order;
+	if (order < pageblock_order) {
+		if (idx < zone->nr_pageblock_nr_free)
+			counts[idx] += sign * (1 << order);
+		return;
+	}
+
+	for (nr = 1UL << (order - pageblock_order); nr; nr--, idx++) {
+		if (idx < zone->nr_pageblock_nr_free)
+			counts[idx] += sign * (int)pageblock_nr_pages;
+	}
+}
+#else
+static inline void zone_pageblock_free_mod(struct zone *zone,
+					   struct page *page,
+					   unsigned int order, int sign)
+{
+}
+#endif
+
 /*
  * This function returns the order of a free page in the buddy system. In
  * general, page_zone(page)->lock must be held by the caller to prevent the
@@ -32,6 +32,7 @@ enum scan_result {
 	SCAN_EXCEED_SHARED_PTE,
 	SCAN_PTE_NON_PRESENT,
 	SCAN_PTE_UFFD_WP,
+	SCAN_PTE_TABLE_SHARED,
 	SCAN_PAGE_RO,
 	SCAN_LACK_REFERENCED_PAGE,
 	SCAN_PAGE_NULL,
@@ -56,12 +57,25 @@ enum scan_result {
 #define CREATE_TRACE_POINTS
 #include <trace/events/huge_memory.h>
 
-static struct task_struct *khugepaged_thread __read_mostly;
 static DEFINE_MUTEX(khugepaged_mutex);
 
+/*
+ * The scan threads, serialized by khugepaged_mutex. With
+ * khugepaged_workers_per_node == 0 this is the single, unbound
+ * "khugepaged" thread, otherwise that many threads bound to each node
+ * with memory, all working through the same mm_slot list.
+ */
+static struct collapse_control **khugepaged_workers;
+static unsigned int nr_khugepaged_workers;
+static unsigned int khugepaged_workers_per_node __read_mostly;
+#define KHUGEPAGED_MAX_WORKERS_PER_NODE	16
+
+static int khugepaged_start_workers(void);
+static void khugepaged_stop_workers(void);
+
 /* default scan 8*512 pte (or vmas) every 30 second */
 static unsigned int khugepaged_pages_to_scan __read_mostly;
-static unsigned int khugepaged_pages_collapsed;
+static atomic_t khugepaged_pages_collapsed;
 static unsigned int khugepaged_full_scans;
 static unsigned int khugepaged_scan_sleep_millisecs __read_mostly = 10000;
 /* during fragmentation poll the hugepage allocator once every minute */
@@ -92,11 +106,15 @@ static struct kmem_cache *mm_slot_cache __read_mostly;
  * @mm: the mm that this information is valid for
  * @nr_pte_mapped_thp: number of pte mapped THP
  * @pte_mapped_thp: address array corresponding pte mapped THP
+ * @scanner: the scan thread currently working on this mm, if any
+ * @scan_round: khugepaged_scan.round this mm was last picked in
  */
 struct mm_slot {
 	struct hlist_node hash;
 	struct list_head mm_node;
 	struct mm_struct *mm;
+	struct collapse_control *scanner;
+	unsigned int scan_round;
 
 	/* pte-mapped THP in this mm */
 	int nr_pte_mapped_thp;
@@ -104,17 +122,41 @@ struct mm_slot {
 };
 
 /**
- * struct khugepaged_scan - cursor for scanning
+ * struct khugepaged_scan - the list of mms to scan
  * @mm_head: the head of the mm list to scan
- * @mm_slot: the current mm_slot we are scanning
- * @address: the next address inside that to be scanned
+ * @round: bumped each time every mm on the list has been picked once
  *
- * There is only the one khugepaged_scan instance of this cursor structure.
+ * Scan threads pick the first mm_slot on the list that no other thread
+ * is working on and move it to the tail, so the list is walked round
+ * robin however many threads there are.
  */
 struct khugepaged_scan {
 	struct list_head mm_head;
+	unsigned int round;
+};
+
+/**
+ * struct collapse_control - state of one scan thread
+ * @thread: the kthread
+ * @nid: node the thread is bound to, NUMA_NO_NODE if unbound
+ * @mm_slot: the mm_slot this thread is scanning
+ * @address: the next address inside that to be scanned
+ * @node_load: per-node count of the pages in the range being scanned
+ * @last_target_node: node the last huge page was allocated on
+ * @pages_scanned: pages scanned by this thread
+ * @pages_collapsed: huge pages collapsed by this thread
+ * @mm_scans: mms this thread has scanned to the end
+ */
+struct collapse_control {
+	struct task_struct *thread;
+	int nid;
 	struct mm_slot *mm_slot;
 	unsigned long address;
+	int node_load[MAX_NUMNODES];
+	int last_target_node;
+	unsigned long pages_scanned;
+	unsigned long pages_collapsed;
+	unsigned long mm_scans;
 };
 
 static struct khugepaged_scan khugepaged_scan = {
@@ -207,7 +249,7 @@ static ssize_t pages_collapsed_show(struct kobject *kobj,
 				    struct kobj_attribute *attr,
 				    char *buf)
 {
-	return sysfs_emit(buf, "%u\n", khugepaged_pages_collapsed);
+	return sysfs_emit(buf, "%u\n", atomic_read(&khugepaged_pages_collapsed));
 }
 static struct kobj_attribute pages_collapsed_attr =
 	__ATTR_RO(pages_collapsed);
@@ -221,6 +263,65 @@ static ssize_t full_scans_show(struct kobject *kobj,
 static struct kobj_attribute full_scans_attr =
 	__ATTR_RO(full_scans);
 
+static ssize_t workers_per_node_show(struct kobject *kobj,
+				     struct kobj_attribute *attr,
+				     char *buf)
+{
+	return sysfs_emit(buf, "%u\n", khugepaged_workers_per_node);
+}
+
+static ssize_t workers_per_node_store(struct kobject *kobj,
+				      struct kobj_attribute *attr,
+				      const char *buf, size_t count)
+{
+	unsigned int workers;
+	int err;
+
+	err = kstrtouint(buf, 10, &workers);
+	if (err || workers > KHUGEPAGED_MAX_WORKERS_PER_NODE)
+		return -EINVAL;
+
+	mutex_lock(&khugepaged_mutex);
+	if (workers != khugepaged_workers_per_node) {
+		khugepaged_workers_per_node = workers;
+		if (nr_khugepaged_workers) {
+			khugepaged_stop_workers();
+			err = khugepaged_start_workers();
+		}
+	}
+	mutex_unlock(&khugepaged_mutex);
+
+	return err ? err : count;
+}
+static struct kobj_attribute workers_per_node_attr =
+	__ATTR(workers_per_node, 0644, workers_per_node_show,
+	       workers_per_node_store);
+
+static ssize_t worker_stats_show(struct kobject *kobj,
+				 struct kobj_attribute *attr,
+				 char *buf)
+{
+	unsigned int i;
+	int len = 0;
+
+	mutex_lock(&khugepaged_mutex);
+	for (i = 0; i < nr_khugepaged_workers; i++) {
+		struct collapse_control *cc = khugepaged_workers[i];
+
+		len += sysfs_emit_at(buf, len,
+				     "%s node=%d pages_scanned=%lu pages_collapsed=%lu mm_scans=%lu\n",
+				     cc->thread->comm, cc->nid,
+				     READ_ONCE(cc->pages_scanned),
+				     READ_ONCE(cc->pages_collapsed),
+				     READ_ONCE(cc->mm_scans));
+	}
+	mutex_unlock(&khugepaged_mutex);
+
+	return len;
+}
+static struct kobj_attribute worker_stats_attr =
+	__ATTR_RO(worker_stats);
+
 static ssize_t khugepaged_defrag_show(struct kobject *kobj,
 				      struct kobj_attribute *attr, char *buf)
 {
@@ -333,6 +434,8 @@ static struct attribute *khugepaged_attr[] = {
 	&pages_to_scan_attr.attr,
 	&pages_collapsed_attr.attr,
 	&full_scans_attr.attr,
+	&workers_per_node_attr.attr,
+	&worker_stats_attr.attr,
 	&scan_sleep_millisecs_attr.attr,
 	&alloc_sleep_millisecs_attr.attr,
 	NULL,
@@ -491,6 +594,8 @@ int __khugepaged_enter(struct mm_struct *mm)
 
 	spin_lock(&khugepaged_mm_lock);
 	insert_to_mm_slots_hash(mm, mm_slot);
+	/* Not picked in the current round yet. */
+	mm_slot->scan_round = khugepaged_scan.round - 1;
 	/*
 	 * Insert just behind the scanning cursor, to let the area settle
 	 * down a little.
@@ -533,7 +638,7 @@ void __khugepaged_exit(struct mm_struct *mm)
 
 	spin_lock(&khugepaged_mm_lock);
 	mm_slot = get_mm_slot(mm);
-	if (mm_slot && khugepaged_scan.mm_slot != mm_slot) {
+	if (mm_slot && !mm_slot->scanner) {
 		hash_del(&mm_slot->hash);
 		list_del(&mm_slot->mm_node);
 		free = 1;
@@ -801,9 +906,7 @@ static void khugepaged_alloc_sleep(void)
 	remove_wait_queue(&khugepaged_wait, &wait);
 }
 
-static int khugepaged_node_load[MAX_NUMNODES];
-
-static bool khugepaged_scan_abort(int nid)
+static bool khugepaged_scan_abort(int nid, struct collapse_control *cc)
 {
 	int i;
 
@@ -815,11 +918,11 @@ static bool khugepaged_scan_abort(int nid)
 		return false;
 
 	/* If there is a count for this node already, it must be acceptable */
-	if (khugepaged_node_load[nid])
+	if (cc->node_load[nid])
 		return false;
 
 	for (i = 0; i < MAX_NUMNODES; i++) {
-		if (!khugepaged_node_load[i])
+		if (!cc->node_load[i])
 			continue;
 		if (node_distance(nid, i) > node_reclaim_distance)
 			return true;
@@ -834,28 +937,31 @@ static inline gfp_t alloc_hugepage_khugepaged_gfpmask(void)
 }
 
 #ifdef CONFIG_NUMA
-static int khugepaged_find_target_node(void)
+static int khugepaged_find_target_node(struct collapse_control *cc)
 {
-	static int last_khugepaged_target_node = NUMA_NO_NODE;
 	int nid, target_node = 0, max_value = 0;
 
 	/* find first node with max normal pages hit */
 	for (nid = 0; nid < MAX_NUMNODES; nid++)
-		if (khugepaged_node_load[nid] > max_value) {
-			max_value = khugepaged_node_load[nid];
+		if (cc->node_load[nid] > max_value) {
+			max_value = cc->node_load[nid];
 			target_node = nid;
 		}
 
+	/* a node-bound thread allocates locally if its node is as good */
+	if (cc->nid != NUMA_NO_NODE && cc->node_load[cc->nid] == max_value)
+		return cc->nid;
+
 	/* do some balance if several nodes have the same hit record */
-	if (target_node <= last_khugepaged_target_node)
-		for (nid = last_khugepaged_target_node + 1; nid < MAX_NUMNODES;
+	if (target_node <= cc->last_target_node)
+		for (nid = cc->last_target_node + 1; nid < MAX_NUMNODES;
 				nid++)
-			if (max_value == khugepaged_node_load[nid]) {
+			if (max_value == cc->node_load[nid]) {
 				target_node = nid;
 				break;
 			}
 
-	last_khugepaged_target_node = target_node;
+	cc->last_target_node = target_node;
 	return target_node;
 }
 
@@ -893,7 +999,7 @@ khugepaged_alloc_page(struct page **hpage, gfp_t gfp, int node)
 	return *hpage;
 }
 #else
-static int khugepaged_find_target_node(void)
+static int khugepaged_find_target_node(struct collapse_control *cc)
 {
 	return 0;
 }
@@ -1134,7 +1240,13 @@ static void collapse_huge_page(struct mm_struct *mm,
 	/* check if the pmd is still valid */
 	if (mm_find_pmd(mm, address) != pmd)
 		goto out_up_write;
+	if (pte_table_shared(pmd)) {
+		result = SCAN_PTE_TABLE_SHARED;
+		goto out_up_write;
+	}
 
+	/* Faults under the per-VMA lock don't take mmap_lock, fence them. */
+	vma_start_write(vma);
 	anon_vma_lock_write(vma->anon_vma);
 
 	mmu_notifier_range_init(&range, MMU_NOTIFY_CLEAR, 0, NULL, mm,
@@ -1208,7 +1320,7 @@ static void collapse_huge_page(struct mm_struct *mm,
 
 	*hpage = NULL;
 
-	khugepaged_pages_collapsed++;
+	atomic_inc(&khugepaged_pages_collapsed);
 	result = SCAN_SUCCEED;
 out_up_write:
 	mmap_write_unlock(mm);
@@ -1222,7 +1334,8 @@ static void collapse_huge_page(struct mm_struct *mm,
 static int khugepaged_scan_pmd(struct mm_struct *mm,
 			       struct vm_area_struct *vma,
 			       unsigned long address,
-			       struct page **hpage)
+			       struct page **hpage,
+			       struct collapse_control *cc)
 {
 	pmd_t *pmd;
 	pte_t *pte, *_pte;
@@ -1241,8 +1354,13 @@ static int khugepaged_scan_pmd(struct mm_struct *mm,
 		result = SCAN_PMD_NULL;
 		goto out;
 	}
+	/* Shared with other mms since fork, collapse once it is unshared. */
+	if (pte_table_shared(pmd)) {
+		result = SCAN_PTE_TABLE_SHARED;
+		goto out;
+	}
 
-	memset(khugepaged_node_load, 0, sizeof(khugepaged_node_load));
+	memset(cc->node_load, 0, sizeof(cc->node_load));
 	pte = pte_offset_map_lock(mm, pmd, address, &ptl);
 	for (_address = address, _pte = pte; _pte < pte+HPAGE_PMD_NR;
 	     _pte++, _address += PAGE_SIZE) {
@@ -1305,16 +1423,16 @@ static int khugepaged_scan_pmd(struct mm_struct *mm,
 
 		/*
 		 * Record which node the original page is from and save this
-		 * information to khugepaged_node_load[].
+		 * information to cc->node_load[].
 		 * Khupaged will allocate hugepage from the node has the max
 		 * hit record.
 		 */
 		node = page_to_nid(page);
-		if (khugepaged_scan_abort(node)) {
+		if (khugepaged_scan_abort(node, cc)) {
 			result = SCAN_SCAN_ABORT;
 			goto out_unmap;
 		}
-		khugepaged_node_load[node]++;
+		cc->node_load[node]++;
 		if (!PageLRU(page)) {
 			result = SCAN_PAGE_LRU;
 			goto out_unmap;
@@ -1365,10 +1483,13 @@ static int khugepaged_scan_pmd(struct mm_struct *mm,
 out_unmap:
 	pte_unmap_unlock(pte, ptl);
 	if (ret) {
-		node = khugepaged_find_target_node();
+		node = khugepaged_find_target_node(cc);
 		/* collapse_huge_page will return with the mmap_lock released */
 		collapse_huge_page(mm, address, hpage, node,
 				referenced, unmapped);
+		/* the huge page is consumed only by a successful collapse */
+		if (!*hpage)
+			cc->pages_collapsed++;
 	}
 out:
 	trace_mm_khugepaged_scan_pmd(mm, page, writable, referenced,
@@ -1937,7 +2058,7 @@ static void collapse_file(struct mm_struct *mm,
 		retract_page_tables(mapping, start);
 		*hpage = NULL;
 
-		khugepaged_pages_collapsed++;
+		atomic_inc(&khugepaged_pages_collapsed);
 	} else {
 		struct page *page;
 
@@ -1988,7 +2109,8 @@ static void collapse_file(struct mm_struct *mm,
 }
 
 static void khugepaged_scan_file(struct mm_struct *mm,
-		struct file *file, pgoff_t start, struct page **hpage)
+		struct file *file, pgoff_t start, struct page **hpage,
+		struct collapse_control *cc)
 {
 	struct page *page = NULL;
 	struct address_space *mapping = file->f_mapping;
@@ -1999,7 +2121,7 @@ static void khugepaged_scan_file(struct mm_struct *mm,
 
 	present = 0;
 	swap = 0;
-	memset(khugepaged_node_load, 0, sizeof(khugepaged_node_load));
+	memset(cc->node_load, 0, sizeof(cc->node_load));
 	rcu_read_lock();
 	xas_for_each(&xas, page, start + HPAGE_PMD_NR - 1) {
 		if (xas_retry(&xas, page))
@@ -2019,11 +2141,11 @@ static void khugepaged_scan_file(struct mm_struct *mm,
 		}
 
 		node = page_to_nid(page);
-		if (khugepaged_scan_abort(node)) {
+		if (khugepaged_scan_abort(node, cc)) {
 			result = SCAN_SCAN_ABORT;
 			break;
 		}
-		khugepaged_node_load[node]++;
+		cc->node_load[node]++;
 
 		if (!PageLRU(page)) {
 			result = SCAN_PAGE_LRU;
@@ -2055,8 +2177,10 @@ static void khugepaged_scan_file(struct mm_struct *mm,
 		if (present < HPAGE_PMD_NR - khugepaged_max_ptes_none) {
 			result = SCAN_EXCEED_NONE_PTE;
 		} else {
-			node = khugepaged_find_target_node();
+			node = khugepaged_find_target_node(cc);
 			collapse_file(mm, file, start, hpage, node);
+			if (!*hpage)
+				cc->pages_collapsed++;
 		}
 	}
 
@@ -2064,7 +2188,8 @@ static void khugepaged_scan_file(struct mm_struct *mm,
 }
 #else
 static void khugepaged_scan_file(struct mm_struct *mm,
-		struct file *file, pgoff_t start, struct page **hpage)
+		struct file *file, pgoff_t start, struct page **hpage,
+		struct collapse_control *cc)
 {
 	BUILD_BUG();
 }
@@ -2074,27 +2199,49 @@ static void khugepaged_collapse_pte_mapped_thps(struct mm_slot *mm_slot)
 }
 #endif
 
+/*
+ * Hand the first mm_slot on the list that no other thread is scanning to
+ * @cc, and move it to the tail. Finding that mm_slot already picked in
+ * the current round means the whole list has been gone through.
+ */
+static bool khugepaged_claim_mm_slot(struct collapse_control *cc)
+{
+	struct mm_slot *mm_slot;
+
+	lockdep_assert_held(&khugepaged_mm_lock);
+
+	list_for_each_entry(mm_slot, &khugepaged_scan.mm_head, mm_node) {
+		if (mm_slot->scanner)
+			continue;
+		if (mm_slot->scan_round == khugepaged_scan.round) {
+			khugepaged_scan.round++;
+			khugepaged_full_scans++;
+		}
+		mm_slot->scan_round = khugepaged_scan.round;
+		mm_slot->scanner = cc;
+		list_move_tail(&mm_slot->mm_node, &khugepaged_scan.mm_head);
+		cc->mm_slot = mm_slot;
+		cc->address = 0;
+		return true;
+	}
+	return false;
+}
+
 static unsigned int khugepaged_scan_mm_slot(unsigned int pages,
-					    struct page **hpage)
+					    struct page **hpage,
+					    struct collapse_control *cc)
 	__releases(&khugepaged_mm_lock)
 	__acquires(&khugepaged_mm_lock)
 {
-	struct mm_slot *mm_slot;
+	struct mm_slot *mm_slot = cc->mm_slot;
 	struct mm_struct *mm;
 	struct vm_area_struct *vma;
 	int progress = 0;
 
 	VM_BUG_ON(!pages);
+	VM_BUG_ON(!mm_slot || mm_slot->scanner != cc);
 	lockdep_assert_held(&khugepaged_mm_lock);
 
-	if (khugepaged_scan.mm_slot)
-		mm_slot = khugepaged_scan.mm_slot;
-	else {
-		mm_slot = list_entry(khugepaged_scan.mm_head.next,
-				     struct mm_slot, mm_node);
-		khugepaged_scan.address = 0;
-		khugepaged_scan.mm_slot = mm_slot;
-	}
 	spin_unlock(&khugepaged_mm_lock);
 	khugepaged_collapse_pte_mapped_thps(mm_slot);
 
@@ -2107,7 +2254,7 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages,
 	if (unlikely(!mmap_read_trylock(mm)))
 		goto breakouterloop_mmap_lock;
 	if (likely(!khugepaged_test_exit(mm)))
-		vma = find_vma(mm, khugepaged_scan.address);
+		vma = find_vma(mm, cc->address);
 
 	progress++;
 	for (; vma; vma = vma->vm_next) {
@@ -2127,40 +2274,40 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages,
 		hend = vma->vm_end & HPAGE_PMD_MASK;
 		if (hstart >= hend)
 			goto skip;
-		if (khugepaged_scan.address > hend)
+		if (cc->address > hend)
 			goto skip;
-		if (khugepaged_scan.address < hstart)
-			khugepaged_scan.address = hstart;
-		VM_BUG_ON(khugepaged_scan.address & ~HPAGE_PMD_MASK);
+		if (cc->address < hstart)
+			cc->address = hstart;
+		VM_BUG_ON(cc->address & ~HPAGE_PMD_MASK);
 		if (shmem_file(vma->vm_file) && !shmem_huge_enabled(vma))
 			goto skip;
 
-		while (khugepaged_scan.address < hend) {
+		while (cc->address < hend) {
 			int ret;
 			cond_resched();
 			if (unlikely(khugepaged_test_exit(mm)))
 				goto breakouterloop;
 
-			VM_BUG_ON(khugepaged_scan.address < hstart ||
-				  khugepaged_scan.address + HPAGE_PMD_SIZE >
-				  hend);
+			VM_BUG_ON(cc->address < hstart ||
+				  cc->address + HPAGE_PMD_SIZE > hend);
 			if (IS_ENABLED(CONFIG_SHMEM) && vma->vm_file) {
 				struct file *file = get_file(vma->vm_file);
 				pgoff_t pgoff = linear_page_index(vma,
-						khugepaged_scan.address);
+						cc->address);
 
 				mmap_read_unlock(mm);
 				ret = 1;
-				khugepaged_scan_file(mm, file, pgoff, hpage);
+				khugepaged_scan_file(mm, file, pgoff, hpage,
+						     cc);
 				fput(file);
 			} else {
 				ret = khugepaged_scan_pmd(mm, vma,
-						khugepaged_scan.address,
-						hpage);
+						cc->address, hpage, cc);
 			}
 			/* move to next address */
-			khugepaged_scan.address += HPAGE_PMD_SIZE;
+			cc->address += HPAGE_PMD_SIZE;
 			progress += HPAGE_PMD_NR;
+			cc->pages_scanned += HPAGE_PMD_NR;
 			if (ret)
 				/* we released mmap_lock so break loop */
 				goto breakouterloop_mmap_lock;
@@ -2173,27 +2320,19 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages,
 breakouterloop_mmap_lock:
 
 	spin_lock(&khugepaged_mm_lock);
-	VM_BUG_ON(khugepaged_scan.mm_slot != mm_slot);
+	VM_BUG_ON(cc->mm_slot != mm_slot);
 	/*
 	 * Release the current mm_slot if this mm is about to die, or
 	 * if we scanned all vmas of this mm.
 	 */
 	if (khugepaged_test_exit(mm) || !vma) {
 		/*
-		 * Make sure that if mm_users is reaching zero while
-		 * khugepaged runs here, khugepaged_exit will find
-		 * mm_slot not pointing to the exiting mm.
+		 * __khugepaged_exit() leaves an mm_slot with a scanner
+		 * alone, so it is up to us to free it if the mm exited.
 		 */
-		if (mm_slot->mm_node.next != &khugepaged_scan.mm_head) {
-			khugepaged_scan.mm_slot = list_entry(
-				mm_slot->mm_node.next,
-				struct mm_slot, mm_node);
-			khugepaged_scan.address = 0;
-		} else {
-			khugepaged_scan.mm_slot = NULL;
-			khugepaged_full_scans++;
-		}
-
+		mm_slot->scanner = NULL;
+		cc->mm_slot = NULL;
+		cc->mm_scans++;
 		collect_mm_slot(mm_slot);
 	}
 
@@ -2212,10 +2351,10 @@ static int khugepaged_wait_event(void)
 		kthread_should_stop();
 }
 
-static void khugepaged_do_scan(void)
+static void khugepaged_do_scan(struct collapse_control *cc)
 {
 	struct page *hpage = NULL;
-	unsigned int progress = 0, pass_through_head = 0;
+	unsigned int progress = 0, round = READ_ONCE(khugepaged_scan.round);
 	unsigned int pages = READ_ONCE(khugepaged_pages_to_scan);
 	bool wait = true;
 
@@ -2230,13 +2369,13 @@ static void khugepaged_do_scan(void)
 		if (unlikely(kthread_should_stop() || try_to_freeze()))
 			break;
 
+		/* Don't go through the list more than about once per call. */
 		spin_lock(&khugepaged_mm_lock);
-		if (!khugepaged_scan.mm_slot)
-			pass_through_head++;
 		if (khugepaged_has_work() &&
-		    pass_through_head < 2)
+		    (cc->mm_slot || (khugepaged_scan.round - round < 2 &&
+				     khugepaged_claim_mm_slot(cc))))
 			progress += khugepaged_scan_mm_slot(pages - progress,
-							    &hpage);
+							    &hpage, cc);
 		else
 			progress = pages;
 		spin_unlock(&khugepaged_mm_lock);
@@ -2272,27 +2411,118 @@ static void khugepaged_wait_work(void)
 		wait_event_freezable(khugepaged_wait, khugepaged_wait_event());
 }
 
-static int khugepaged(void *none)
+static int khugepaged(void *data)
 {
+	struct collapse_control *cc = data;
 	struct mm_slot *mm_slot;
 
 	set_freezable();
 	set_user_nice(current, MAX_NICE);
 
 	while (!kthread_should_stop()) {
-		khugepaged_do_scan();
+		khugepaged_do_scan(cc);
 		khugepaged_wait_work();
 	}
 
 	spin_lock(&khugepaged_mm_lock);
-	mm_slot = khugepaged_scan.mm_slot;
-	khugepaged_scan.mm_slot = NULL;
-	if (mm_slot)
+	mm_slot = cc->mm_slot;
+	cc->mm_slot = NULL;
+	if (mm_slot) {
+		mm_slot->scanner = NULL;
 		collect_mm_slot(mm_slot);
+	}
 	spin_unlock(&khugepaged_mm_lock);
 	return 0;
 }
 
+static struct collapse_control *khugepaged_create_worker(int nid,
+							 unsigned int idx)
+{
+	struct collapse_control *cc;
+	struct task_struct *thread;
+
+	cc = kzalloc_node(sizeof(*cc), GFP_KERNEL, nid);
+	if (!cc)
+		return ERR_PTR(-ENOMEM);
+	cc->nid = nid;
+	cc->last_target_node = NUMA_NO_NODE;
+
+	if (nid == NUMA_NO_NODE) {
+		thread = kthread_run(khugepaged, cc, "khugepaged");
+	} else {
+		thread = kthread_create_on_node(khugepaged, cc, nid,
+						"khugepaged/%d:%u", nid, idx);
+		if (!IS_ERR(thread)) {
+			const struct cpumask *cpumask = cpumask_of_node(nid);
+
+			if (!cpumask_empty(cpumask))
+				set_cpus_allowed_ptr(thread, cpumask);
+			wake_up_process(thread);
+		}
+	}
+	if (IS_ERR(thread)) {
+		kfree(cc);
+		return ERR_CAST(thread);
+	}
+	cc->thread = thread;
+	return cc;
+}
+
+static int khugepaged_start_workers(void)
+{
+	unsigned int per_node = khugepaged_workers_per_node;
+	unsigned int nr = per_node ? per_node * num_node_state(N_MEMORY) : 1;
+	struct collapse_control *cc;
+	unsigned int i;
+	int nid;
+
+	lockdep_assert_held(&khugepaged_mutex);
+
+	khugepaged_workers = kcalloc(nr, sizeof(*khugepaged_workers),
+				     GFP_KERNEL);
+	if (!khugepaged_workers)
+		return -ENOMEM;
+
+	if (!per_node) {
+		cc = khugepaged_create_worker(NUMA_NO_NODE, 0);
+		if (IS_ERR(cc))
+			goto fail;
+		khugepaged_workers[nr_khugepaged_workers++] = cc;
+		return 0;
+	}
+
+	for_each_node_state(nid, N_MEMORY) {
+		for (i = 0; i < per_node; i++) {
+			if (nr_khugepaged_workers == nr)
+				break;
+			cc = khugepaged_create_worker(nid, i);
+			if (IS_ERR(cc))
+				goto fail;
+			khugepaged_workers[nr_khugepaged_workers++] = cc;
+		}
+	}
+	return 0;
+fail:
+	pr_err("khugepaged: failed to start scan thread\n");
+	khugepaged_stop_workers();
+	return PTR_ERR(cc);
+}
+
+static void khugepaged_stop_workers(void)
+{
+	unsigned int i;
+
+	lockdep_assert_held(&khugepaged_mutex);
+
+	for (i = 0; i < nr_khugepaged_workers; i++) {
+		kthread_stop(khugepaged_workers[i]->thread);
+		kfree(khugepaged_workers[i]);
+	}
+	kfree(khugepaged_workers);
+	khugepaged_workers = NULL;
+	nr_khugepaged_workers = 0;
+}
+
 static void set_recommended_min_free_kbytes(void)
 {
 	struct zone *zone;
@@ -2343,23 +2573,18 @@ int start_stop_khugepaged(void)
 
 	mutex_lock(&khugepaged_mutex);
 	if (khugepaged_enabled()) {
-		if (!khugepaged_thread)
-			khugepaged_thread = kthread_run(khugepaged, NULL,
-							"khugepaged");
-		if (IS_ERR(khugepaged_thread)) {
-			pr_err("khugepaged: kthread_run(khugepaged) failed\n");
-			err = PTR_ERR(khugepaged_thread);
-			khugepaged_thread = NULL;
-			goto fail;
+		if (!nr_khugepaged_workers) {
+			err = khugepaged_start_workers();
+			if (err)
+				goto fail;
 		}
 
 		if (!list_empty(&khugepaged_scan.mm_head))
 			wake_up_interruptible(&khugepaged_wait);
 
 		set_recommended_min_free_kbytes();
-	} else if (khugepaged_thread) {
-		kthread_stop(khugepaged_thread);
-		khugepaged_thread = NULL;
+	} else if (nr_khugepaged_workers) {
+		khugepaged_stop_workers();
 	}
 fail:
 	mutex_unlock(&khugepaged_mutex);
@@ -2369,7 +2594,7 @@ int start_stop_khugepaged(void)
 void khugepaged_min_free_kbytes_update(void)
 {
 	mutex_lock(&khugepaged_mutex);
-	if (khugepaged_enabled() && khugepaged_thread)
+	if (khugepaged_enabled() && nr_khugepaged_workers)
 		set_recommended_min_free_kbytes();
 	mutex_unlock(&khugepaged_mutex);
 }
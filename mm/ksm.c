@@ -25,6 +25,7 @@
 #include <linux/rmap.h>
 #include <linux/spinlock.h>
 #include <linux/xxhash.h>
+#include <linux/crc32c.h>
 #include <linux/delay.h>
 #include <linux/kthread.h>
 #include <linux/wait.h>
@@ -273,6 +274,25 @@ static unsigned int ksm_thread_sleep_millisecs = 20;
 /* Checksum of an empty (zeroed) page */
 static unsigned int zero_checksum __read_mostly;
 
+/* Function used to checksum unstable pages, see calc_checksum() */
+enum ksm_checksum {
+	KSM_CHECKSUM_XXHASH,
+	KSM_CHECKSUM_CRC32C,
+};
+
+static const char * const ksm_checksum_names[] = {
+	[KSM_CHECKSUM_XXHASH] = "xxhash",
+	[KSM_CHECKSUM_CRC32C] = "crc32c",
+};
+
+static enum ksm_checksum ksm_checksum __read_mostly = KSM_CHECKSUM_XXHASH;
+
+/* Pages merged into a KSM page, and the rate over the last full scan */
+static unsigned long ksm_pages_merged;
+static unsigned long ksm_merge_rate;
+static unsigned long ksm_scan_start_merged;
+static unsigned long ksm_scan_start_jiffies = INITIAL_JIFFIES;
+
 /* Whether to merge empty (zeroed) pages with actual zero pages */
 static bool ksm_use_zero_pages __read_mostly;
 
@@ -1015,11 +1035,30 @@ static int unmerge_and_remove_all_rmap_items(void)
 }
 #endif /* CONFIG_SYSFS */
 
+/*
+ * crc32c is offered when libcrc32c is built in; it uses the CPU's crc32
+ * instruction where there is one (e.g. SSE4.2), which can beat xxhash.
+ */
+static bool ksm_checksum_available(enum ksm_checksum type)
+{
+	if (type == KSM_CHECKSUM_CRC32C)
+		return IS_BUILTIN(CONFIG_LIBCRC32C);
+	return true;
+}
+
 static u32 calc_checksum(struct page *page)
 {
 	u32 checksum;
 	void *addr = kmap_atomic(page);
-	checksum = xxhash(addr, PAGE_SIZE, 0);
+
+	switch (READ_ONCE(ksm_checksum)) {
+	case KSM_CHECKSUM_CRC32C:
+		checksum = crc32c(0, addr, PAGE_SIZE);
+		break;
+	default:
+		checksum = xxhash(addr, PAGE_SIZE, 0);
+		break;
+	}
 	kunmap_atomic(addr);
 	return checksum;
 }
@@ -1246,6 +1285,9 @@ static int try_to_merge_one_page(struct vm_area_struct *vma,
 			err = replace_page(vma, page, kpage, orig_pte);
 	}
 
+	if (kpage && !err)
+		ksm_pages_merged++;
+
 	if ((vma->vm_flags & VM_LOCKED) && kpage && !err) {
 		munlock_vma_page(page);
 		if (!PageMlocked(kpage)) {
@@ -2370,6 +2412,11 @@ static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 		goto next_mm;
 
 	ksm_scan.seqnr++;
+	if (jiffies != ksm_scan_start_jiffies)
+		ksm_merge_rate = (ksm_pages_merged - ksm_scan_start_merged) * HZ /
+				 (jiffies - ksm_scan_start_jiffies);
+	ksm_scan_start_merged = ksm_pages_merged;
+	ksm_scan_start_jiffies = jiffies;
 	return NULL;
 }
 
@@ -3005,6 +3052,44 @@ static ssize_t use_zero_pages_store(struct kobject *kobj,
 }
 KSM_ATTR(use_zero_pages);
 
+static ssize_t checksum_show(struct kobject *kobj,
+			     struct kobj_attribute *attr, char *buf)
+{
+	int i, len = 0;
+
+	for (i = 0; i < ARRAY_SIZE(ksm_checksum_names); i++) {
+		if (!ksm_checksum_available(i))
+			continue;
+		len += sysfs_emit_at(buf, len, i == ksm_checksum ? "[%s] " : "%s ",
+				     ksm_checksum_names[i]);
+	}
+	buf[len - 1] = '\n';
+	return len;
+}
+
+static ssize_t checksum_store(struct kobject *kobj,
+			      struct kobj_attribute *attr,
+			      const char *buf, size_t count)
+{
+	int type;
+
+	type = sysfs_match_string(ksm_checksum_names, buf);
+	if (type < 0 || !ksm_checksum_available(type))
+		return -EINVAL;
+
+	/*
+	 * Checksums already stored in rmap_items no longer match, which
+	 * only makes every page look volatile for one more scan.
+	 */
+	mutex_lock(&ksm_thread_mutex);
+	WRITE_ONCE(ksm_checksum, type);
+	zero_checksum = calc_checksum(ZERO_PAGE(0));
+	mutex_unlock(&ksm_thread_mutex);
+
+	return count;
+}
+KSM_ATTR(checksum);
+
 static ssize_t max_page_sharing_show(struct kobject *kobj,
 				     struct kobj_attribute *attr, char *buf)
 {
@@ -3131,6 +3216,20 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t pages_merged_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%lu\n", READ_ONCE(ksm_pages_merged));
+}
+KSM_ATTR_RO(pages_merged);
+
+static ssize_t merge_rate_show(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%lu\n", READ_ONCE(ksm_merge_rate));
+}
+KSM_ATTR_RO(merge_rate);
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
@@ -3140,6 +3239,8 @@ static struct attribute *ksm_attrs[] = {
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
+	&pages_merged_attr.attr,
+	&merge_rate_attr.attr,
 #ifdef CONFIG_NUMA
 	&merge_across_nodes_attr.attr,
 #endif
@@ -3148,6 +3249,7 @@ static struct attribute *ksm_attrs[] = {
 	&stable_node_dups_attr.attr,
 	&stable_node_chains_prune_millisecs_attr.attr,
 	&use_zero_pages_attr.attr,
+	&checksum_attr.attr,
 	NULL,
 };
 
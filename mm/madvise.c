@@ -168,8 +168,10 @@ static long madvise_behavior(struct vm_area_struct *vma,
 
 success:
 	/*
-	 * vm_flags is protected by the mmap_lock held in write mode.
+	 * vm_flags is protected by the mmap_lock held in write mode
+	 * and by the VMA write lock.
 	 */
+	vma_start_write(vma);
 	vma->vm_flags = new_flags;
 
 out_convert_errno:
@@ -588,6 +590,9 @@ static int madvise_free_pte_range(pmd_t *pmd, unsigned long addr,
 
 	if (pmd_trans_unstable(pmd))
 		return 0;
+	/* It's only a hint, don't unshare a table to lazily free pages */
+	if (pte_table_shared(pmd))
+		return 0;
 
 	tlb_change_page_size(tlb, PAGE_SIZE);
 	orig_pte = pte = pte_offset_map_lock(mm, pmd, addr, &ptl);
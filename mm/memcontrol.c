@@ -62,6 +62,7 @@
 #include <linux/tracehook.h>
 #include <linux/psi.h>
 #include <linux/seq_buf.h>
+#include <linux/moduleparam.h>
 #include "internal.h"
 #include <net/sock.h>
 #include <net/ip.h>
@@ -107,10 +108,26 @@ static bool do_memsw_account(void)
 	return !cgroup_subsys_on_dfl(memory_cgrp_subsys) && !cgroup_memory_noswap;
 }
 
-/* memcg and lruvec stats flushing */
+/*
+ * memcg and lruvec stats flushing
+ *
+ * Readers only flush a subtree once enough updates are pending in it, which
+ * bounds the error to MEMCG_CHARGE_BATCH per online CPU.  On top of that, all
+ * stats are flushed every stats_flush_interval_ms, which bounds staleness.
+ */
 static void flush_memcg_stats_dwork(struct work_struct *w);
 static DECLARE_DEFERRABLE_WORK(stats_flush_dwork, flush_memcg_stats_dwork);
-static DEFINE_SPINLOCK(stats_flush_lock);
+static unsigned int stats_flush_interval_ms = 2000;
+module_param(stats_flush_interval_ms, uint, 0644);
+static atomic_t stats_flush_ongoing = ATOMIC_INIT(0);
+static u64 flush_next_time;
+
+static void __mem_cgroup_flush_stats(struct mem_cgroup *memcg, bool atomic);
+
+static unsigned long stats_flush_interval(void)
+{
+	return max(msecs_to_jiffies(READ_ONCE(stats_flush_interval_ms)), 1UL);
+}
 
 #define THRESHOLDS_EVENTS_TARGET 128
 #define SOFTLIMIT_EVENTS_TARGET 1024
@@ -683,13 +700,46 @@ mem_cgroup_largest_soft_limit_node(struct mem_cgroup_tree_per_node *mctz)
  * @idx: the stat item - can be enum memcg_stat_item or enum node_stat_item
  * @val: delta to add to the counter, can be negative
  */
+static bool memcg_vmstats_needs_flush(struct mem_cgroup *memcg)
+{
+	return atomic64_read(&memcg->vmstats.stats_updates) >
+		MEMCG_CHARGE_BATCH * num_online_cpus();
+}
+
+static void memcg_rstat_updated(struct mem_cgroup *memcg, int val)
+{
+	struct memcg_vmstats_percpu *statc;
+	unsigned int stats_updates;
+
+	if (!val)
+		return;
+
+	cgroup_rstat_updated(memcg->css.cgroup, smp_processor_id());
+
+	/* Account to the cgroup and its ancestors in batches */
+	statc = this_cpu_ptr(memcg->vmstats_percpu);
+	stats_updates = statc->stats_updates + abs(val);
+	if (stats_updates < MEMCG_CHARGE_BATCH) {
+		statc->stats_updates = stats_updates;
+		return;
+	}
+	statc->stats_updates = 0;
+
+	for (; memcg; memcg = parent_mem_cgroup(memcg)) {
+		/* If this one is due a flush, so are the ancestors */
+		if (memcg_vmstats_needs_flush(memcg))
+			break;
+		atomic64_add(stats_updates, &memcg->vmstats.stats_updates);
+	}
+}
+
 void __mod_memcg_state(struct mem_cgroup *memcg, int idx, int val)
 {
 	if (mem_cgroup_disabled())
 		return;
 
 	__this_cpu_add(memcg->vmstats_percpu->state[idx], val);
-	cgroup_rstat_updated(memcg->css.cgroup, smp_processor_id());
+	memcg_rstat_updated(memcg, val);
 }
 
 /* idx can be of type enum memcg_stat_item or node_stat_item. */
@@ -822,7 +872,7 @@ void __count_memcg_events(struct mem_cgroup *memcg, enum vm_event_item idx,
 		return;
 
 	__this_cpu_add(memcg->vmstats_percpu->events[idx], count);
-	cgroup_rstat_updated(memcg->css.cgroup, smp_processor_id());
+	memcg_rstat_updated(memcg, count);
 }
 
 static unsigned long memcg_events(struct mem_cgroup *memcg, int event)
@@ -1588,7 +1638,7 @@ static char *memory_stat_format(struct mem_cgroup *memcg)
 	 *
 	 * Current memory state:
 	 */
-	cgroup_rstat_flush(memcg->css.cgroup);
+	mem_cgroup_flush_stats(memcg);
 
 	for (i = 0; i < ARRAY_SIZE(memory_stats); i++) {
 		u64 size;
@@ -1626,6 +1676,15 @@ static char *memory_stat_format(struct mem_cgroup *memcg)
 	seq_buf_printf(&s, "%s %lu\n", vm_event_name(PGLAZYFREED),
 		       memcg_events(memcg, PGLAZYFREED));
 
+	seq_buf_printf(&s, "charge_stock_hit %lu\n",
+		       memcg_events(memcg, MEMCG_STOCK_HIT));
+	seq_buf_printf(&s, "charge_stock_miss %lu\n",
+		       memcg_events(memcg, MEMCG_STOCK_MISS));
+	seq_buf_printf(&s, "async_reclaim %lu\n",
+		       memcg_events(memcg, MEMCG_ASYNC_RECLAIM));
+	seq_buf_printf(&s, "async_reclaim_steal %lu\n",
+		       memcg_events(memcg, MEMCG_ASYNC_RECLAIM_STEAL));
+
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 	seq_buf_printf(&s, "%s %lu\n", vm_event_name(THP_FAULT_ALLOC),
 		       memcg_events(memcg, THP_FAULT_ALLOC));
@@ -2252,9 +2311,18 @@ struct obj_stock {
 #endif
 };
 
+/*
+ * Number of memcgs whose charges are cached per cpu. Several cgroups
+ * commonly share a cpu, a single slot would be drained on every switch.
+ */
+#define NR_MEMCG_STOCK 4
+
 struct memcg_stock_pcp {
-	struct mem_cgroup *cached; /* this never be root cgroup */
-	unsigned int nr_pages;
+	/* these are never the root cgroup */
+	struct mem_cgroup *cached[NR_MEMCG_STOCK];
+	unsigned int nr_pages[NR_MEMCG_STOCK];
+	/* slot to evict next when all of them are in use */
+	unsigned int victim;
 	struct obj_stock task_obj;
 	struct obj_stock irq_obj;
 
@@ -2263,6 +2331,11 @@ struct memcg_stock_pcp {
 #define FLUSHING_CACHED_CHARGE	0
 };
 static DEFINE_PER_CPU(struct memcg_stock_pcp, memcg_stock);
+
+static inline unsigned int memcg_charge_batch(struct mem_cgroup *memcg)
+{
+	return READ_ONCE(memcg->charge_batch);
+}
 static DEFINE_MUTEX(percpu_charge_mutex);
 
 #ifdef CONFIG_MEMCG_KMEM
@@ -2321,9 +2394,9 @@ static inline void put_obj_stock(unsigned long flags)
  * @memcg: memcg to consume from.
  * @nr_pages: how many pages to charge.
  *
- * The charges will only happen if @memcg matches the current cpu's memcg
- * stock, and at least @nr_pages are available in that stock.  Failure to
- * service an allocation will refill the stock.
+ * The charges will only happen if @memcg has a slot in the current cpu's
+ * memcg stock, and at least @nr_pages are available in that slot.  Failure
+ * to service an allocation will refill the stock.
  *
  * returns true if successful, false otherwise.
  */
@@ -2332,17 +2405,25 @@ static bool consume_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
 	struct memcg_stock_pcp *stock;
 	unsigned long flags;
 	bool ret = false;
+	int i;
 
-	if (nr_pages > MEMCG_CHARGE_BATCH)
+	if (nr_pages > memcg_charge_batch(memcg))
 		return ret;
 
 	local_irq_save(flags);
 
 	stock = this_cpu_ptr(&memcg_stock);
-	if (memcg == stock->cached && stock->nr_pages >= nr_pages) {
-		stock->nr_pages -= nr_pages;
-		ret = true;
+	for (i = 0; i < NR_MEMCG_STOCK; i++) {
+		if (memcg != stock->cached[i])
+			continue;
+		if (stock->nr_pages[i] >= nr_pages) {
+			stock->nr_pages[i] -= nr_pages;
+			ret = true;
+		}
+		break;
 	}
+	__count_memcg_events(memcg, ret ? MEMCG_STOCK_HIT : MEMCG_STOCK_MISS,
+			     1);
 
 	local_irq_restore(flags);
 
@@ -2350,24 +2431,35 @@ static bool consume_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
 }
 
 /*
- * Returns stocks cached in percpu and reset cached information.
+ * Returns the charges cached in one slot and resets it.
  */
-static void drain_stock(struct memcg_stock_pcp *stock)
+static void drain_stock_slot(struct memcg_stock_pcp *stock, int i)
 {
-	struct mem_cgroup *old = stock->cached;
+	struct mem_cgroup *old = stock->cached[i];
 
 	if (!old)
 		return;
 
-	if (stock->nr_pages) {
-		page_counter_uncharge(&old->memory, stock->nr_pages);
+	if (stock->nr_pages[i]) {
+		page_counter_uncharge(&old->memory, stock->nr_pages[i]);
 		if (do_memsw_account())
-			page_counter_uncharge(&old->memsw, stock->nr_pages);
-		stock->nr_pages = 0;
+			page_counter_uncharge(&old->memsw, stock->nr_pages[i]);
+		stock->nr_pages[i] = 0;
 	}
 
 	css_put(&old->css);
-	stock->cached = NULL;
+	stock->cached[i] = NULL;
+}
+
+/*
+ * Returns stocks cached in percpu and reset cached information.
+ */
+static void drain_stock(struct memcg_stock_pcp *stock)
+{
+	int i;
+
+	for (i = 0; i < NR_MEMCG_STOCK; i++)
+		drain_stock_slot(stock, i);
 }
 
 static void drain_local_stock(struct work_struct *dummy)
@@ -2400,19 +2492,33 @@ static void refill_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
 {
 	struct memcg_stock_pcp *stock;
 	unsigned long flags;
+	int i, empty = -1;
 
 	local_irq_save(flags);
 
 	stock = this_cpu_ptr(&memcg_stock);
-	if (stock->cached != memcg) { /* reset if necessary */
-		drain_stock(stock);
-		css_get(&memcg->css);
-		stock->cached = memcg;
+	for (i = 0; i < NR_MEMCG_STOCK; i++) {
+		if (stock->cached[i] == memcg)
+			goto found;
+		if (!stock->cached[i] && empty < 0)
+			empty = i;
+	}
+
+	/* No slot yet, take a free one or evict round robin */
+	if (empty >= 0) {
+		i = empty;
+	} else {
+		i = stock->victim;
+		stock->victim = (i + 1) % NR_MEMCG_STOCK;
+		drain_stock_slot(stock, i);
 	}
-	stock->nr_pages += nr_pages;
+	css_get(&memcg->css);
+	stock->cached[i] = memcg;
+found:
+	stock->nr_pages[i] += nr_pages;
 
-	if (stock->nr_pages > MEMCG_CHARGE_BATCH)
-		drain_stock(stock);
+	if (stock->nr_pages[i] > memcg_charge_batch(memcg))
+		drain_stock_slot(stock, i);
 
 	local_irq_restore(flags);
 }
@@ -2439,13 +2545,18 @@ static void drain_all_stock(struct mem_cgroup *root_memcg)
 		struct memcg_stock_pcp *stock = &per_cpu(memcg_stock, cpu);
 		struct mem_cgroup *memcg;
 		bool flush = false;
+		int i;
 
 		rcu_read_lock();
-		memcg = stock->cached;
-		if (memcg && stock->nr_pages &&
-		    mem_cgroup_is_descendant(memcg, root_memcg))
-			flush = true;
-		else if (obj_stock_flush_required(stock, root_memcg))
+		for (i = 0; i < NR_MEMCG_STOCK; i++) {
+			memcg = stock->cached[i];
+			if (memcg && stock->nr_pages[i] &&
+			    mem_cgroup_is_descendant(memcg, root_memcg)) {
+				flush = true;
+				break;
+			}
+		}
+		if (!flush && obj_stock_flush_required(stock, root_memcg))
 			flush = true;
 		rcu_read_unlock();
 
@@ -2504,6 +2615,52 @@ static void high_work_func(struct work_struct *work)
 	reclaim_high(memcg, MEMCG_CHARGE_BATCH, GFP_KERNEL);
 }
 
+/* Background reclaim ahead of memory.high, see memory.high_async_ratio */
+static struct workqueue_struct *memcg_async_reclaim_wq;
+
+static unsigned long memcg_async_high(struct mem_cgroup *memcg)
+{
+	unsigned int ratio = READ_ONCE(memcg->high_async_ratio);
+	unsigned long high = READ_ONCE(memcg->memory.high);
+
+	if (!ratio || high == PAGE_COUNTER_MAX)
+		return PAGE_COUNTER_MAX;
+
+	return high / 100 * ratio;
+}
+
+static void async_high_work_func(struct work_struct *work)
+{
+	struct mem_cgroup *memcg;
+	unsigned int nr_retries = MAX_RECLAIM_RETRIES;
+	unsigned long nr_reclaimed = 0;
+
+	memcg = container_of(work, struct mem_cgroup, async_high_work);
+
+	for (;;) {
+		unsigned long nr_pages = page_counter_read(&memcg->memory);
+		unsigned long async_high = memcg_async_high(memcg);
+		unsigned long reclaimed;
+
+		if (nr_pages <= async_high)
+			break;
+
+		reclaimed = try_to_free_mem_cgroup_pages(memcg,
+				min_t(unsigned long, nr_pages - async_high,
+				      MEMCG_CHARGE_BATCH * 4),
+				GFP_KERNEL, true);
+		nr_reclaimed += reclaimed;
+
+		if (!reclaimed && !nr_retries--)
+			break;
+
+		cond_resched();
+	}
+
+	count_memcg_events(memcg, MEMCG_ASYNC_RECLAIM, 1);
+	count_memcg_events(memcg, MEMCG_ASYNC_RECLAIM_STEAL, nr_reclaimed);
+}
+
 /*
  * Clamp the maximum sleep time per allocation batch to 2 seconds. This is
  * enough to still cause a significant slowdown in most cases, while still
@@ -2727,7 +2884,7 @@ void mem_cgroup_handle_over_high(void)
 static int try_charge_memcg(struct mem_cgroup *memcg, gfp_t gfp_mask,
 			unsigned int nr_pages)
 {
-	unsigned int batch = max(MEMCG_CHARGE_BATCH, nr_pages);
+	unsigned int batch = max(memcg_charge_batch(memcg), nr_pages);
 	int nr_retries = MAX_RECLAIM_RETRIES;
 	struct mem_cgroup *mem_over_limit;
 	struct page_counter *counter;
@@ -2888,6 +3045,15 @@ static int try_charge_memcg(struct mem_cgroup *memcg, gfp_t gfp_mask,
 		swap_high = page_counter_read(&memcg->swap) >
 			READ_ONCE(memcg->swap.high);
 
+		/*
+		 * Start background reclaim before the high limit is hit so
+		 * that the tasks in this cgroup rarely pay for it inline.
+		 */
+		if (!mem_high && READ_ONCE(memcg->high_async_ratio) &&
+		    page_counter_read(&memcg->memory) > memcg_async_high(memcg))
+			queue_work(memcg_async_reclaim_wq,
+				   &memcg->async_high_work);
+
 		/* Don't bother a random interrupted task */
 		if (in_interrupt()) {
 			if (mem_high) {
@@ -3766,7 +3932,7 @@ static unsigned long mem_cgroup_usage(struct mem_cgroup *memcg, bool swap)
 
 	if (mem_cgroup_is_root(memcg)) {
 		/* mem_cgroup_threshold() calls here from irqsafe context */
-		cgroup_rstat_flush_irqsafe(memcg->css.cgroup);
+		__mem_cgroup_flush_stats(memcg, true);
 		val = memcg_page_state(memcg, NR_FILE_PAGES) +
 			memcg_page_state(memcg, NR_ANON_MAPPED);
 		if (swap)
@@ -4147,7 +4313,7 @@ static int memcg_numa_stat_show(struct seq_file *m, void *v)
 	int nid;
 	struct mem_cgroup *memcg = mem_cgroup_from_seq(m);
 
-	cgroup_rstat_flush(memcg->css.cgroup);
+	mem_cgroup_flush_stats(memcg);
 
 	for (stat = stats; stat < stats + ARRAY_SIZE(stats); stat++) {
 		seq_printf(m, "%s=%lu", stat->name,
@@ -4219,7 +4385,7 @@ static int memcg_stat_show(struct seq_file *m, void *v)
 
 	BUILD_BUG_ON(ARRAY_SIZE(memcg1_stat_names) != ARRAY_SIZE(memcg1_stats));
 
-	cgroup_rstat_flush(memcg->css.cgroup);
+	mem_cgroup_flush_stats(memcg);
 
 	for (i = 0; i < ARRAY_SIZE(memcg1_stats); i++) {
 		unsigned long nr;
@@ -4722,7 +4888,7 @@ void mem_cgroup_wb_stats(struct bdi_writeback *wb, unsigned long *pfilepages,
 	struct mem_cgroup *memcg = mem_cgroup_from_css(wb->memcg_css);
 	struct mem_cgroup *parent;
 
-	cgroup_rstat_flush_irqsafe(memcg->css.cgroup);
+	__mem_cgroup_flush_stats(memcg, true);
 
 	*pdirty = memcg_page_state(memcg, NR_FILE_DIRTY);
 	*pwriteback = memcg_page_state(memcg, NR_WRITEBACK);
@@ -5397,6 +5563,7 @@ static struct mem_cgroup *mem_cgroup_alloc(void)
 		goto fail;
 
 	INIT_WORK(&memcg->high_work, high_work_func);
+	INIT_WORK(&memcg->async_high_work, async_high_work_func);
 	INIT_LIST_HEAD(&memcg->oom_notify);
 	mutex_init(&memcg->thresholds_lock);
 	spin_lock_init(&memcg->move_lock);
@@ -5443,9 +5610,11 @@ mem_cgroup_css_alloc(struct cgroup_subsys_state *parent_css)
 	page_counter_set_high(&memcg->memory, PAGE_COUNTER_MAX);
 	memcg->soft_limit = PAGE_COUNTER_MAX;
 	page_counter_set_high(&memcg->swap, PAGE_COUNTER_MAX);
+	memcg->charge_batch = MEMCG_CHARGE_BATCH;
 	if (parent) {
 		memcg->swappiness = mem_cgroup_swappiness(parent);
 		memcg->oom_kill_disable = parent->oom_kill_disable;
+		memcg->charge_batch = parent->charge_batch;
 
 		page_counter_init(&memcg->memory, &parent->memory);
 		page_counter_init(&memcg->swap, &parent->swap);
@@ -5496,7 +5665,7 @@ static int mem_cgroup_css_online(struct cgroup_subsys_state *css)
 
 	if (unlikely(mem_cgroup_is_root(memcg)))
 		queue_delayed_work(system_unbound_wq, &stats_flush_dwork,
-				   2UL*HZ);
+				   stats_flush_interval());
 	return 0;
 }
 
@@ -5553,6 +5722,7 @@ static void mem_cgroup_css_free(struct cgroup_subsys_state *css)
 
 	vmpressure_cleanup(&memcg->vmpressure);
 	cancel_work_sync(&memcg->high_work);
+	cancel_work_sync(&memcg->async_high_work);
 	mem_cgroup_remove_from_trees(memcg);
 	free_shrinker_info(memcg);
 	memcg_free_kmem(memcg);
@@ -5588,19 +5758,77 @@ static void mem_cgroup_css_reset(struct cgroup_subsys_state *css)
 	memcg_wb_domain_size_changed(memcg);
 }
 
-void mem_cgroup_flush_stats(void)
+static void do_flush_stats(struct mem_cgroup *memcg, bool atomic)
+{
+	bool root = mem_cgroup_is_root(memcg);
+
+	/*
+	 * Everybody queueing up behind a flush of the whole tree would find
+	 * nothing left to do: let the flusher in progress serve them.
+	 */
+	if (root) {
+		if (atomic_read(&stats_flush_ongoing) ||
+		    atomic_xchg(&stats_flush_ongoing, 1))
+			return;
+		WRITE_ONCE(flush_next_time,
+			   get_jiffies_64() + 2 * stats_flush_interval());
+	}
+
+	if (atomic)
+		cgroup_rstat_flush_irqsafe(memcg->css.cgroup);
+	else
+		cgroup_rstat_flush(memcg->css.cgroup);
+
+	if (root)
+		atomic_set(&stats_flush_ongoing, 0);
+}
+
+static void __mem_cgroup_flush_stats(struct mem_cgroup *memcg, bool atomic)
 {
-	if (!spin_trylock(&stats_flush_lock))
+	if (mem_cgroup_disabled())
 		return;
 
-	cgroup_rstat_flush_irqsafe(root_mem_cgroup->css.cgroup);
-	spin_unlock(&stats_flush_lock);
+	if (!memcg)
+		memcg = root_mem_cgroup;
+	if (memcg_vmstats_needs_flush(memcg))
+		do_flush_stats(memcg, atomic);
+}
+
+/**
+ * mem_cgroup_flush_stats - flush the stats of a memory cgroup subtree
+ * @memcg: root of the subtree, NULL for all memory cgroups
+ *
+ * This only flushes if enough updates are pending in the subtree.
+ *
+ * This function may block.
+ */
+void mem_cgroup_flush_stats(struct mem_cgroup *memcg)
+{
+	__mem_cgroup_flush_stats(memcg, false);
+}
+
+/**
+ * mem_cgroup_flush_stats_ratelimited - flush if the periodic flush is late
+ * @memcg: root of the subtree, NULL for all memory cgroups
+ *
+ * For hot paths that can live with stats up to stats_flush_interval_ms
+ * old.  This function can be called from any context.
+ */
+void mem_cgroup_flush_stats_ratelimited(struct mem_cgroup *memcg)
+{
+	if (time_after64(get_jiffies_64(), READ_ONCE(flush_next_time)))
+		__mem_cgroup_flush_stats(memcg, true);
 }
 
 static void flush_memcg_stats_dwork(struct work_struct *w)
 {
-	mem_cgroup_flush_stats();
-	queue_delayed_work(system_unbound_wq, &stats_flush_dwork, 2UL*HZ);
+	/*
+	 * Flush unconditionally, so that readers rarely find enough updates
+	 * pending to have to flush themselves.
+	 */
+	do_flush_stats(root_mem_cgroup, false);
+	queue_delayed_work(system_unbound_wq, &stats_flush_dwork,
+			   stats_flush_interval());
 }
 
 static void mem_cgroup_css_rstat_flush(struct cgroup_subsys_state *css, int cpu)
@@ -5613,6 +5841,11 @@ static void mem_cgroup_css_rstat_flush(struct cgroup_subsys_state *css, int cpu)
 
 	statc = per_cpu_ptr(memcg->vmstats_percpu, cpu);
 
+	/* The flush covers all updates, the first CPU resets the count */
+	if (atomic64_read(&memcg->vmstats.stats_updates))
+		atomic64_set(&memcg->vmstats.stats_updates, 0);
+	statc->stats_updates = 0;
+
 	for (i = 0; i < MEMCG_NR_STAT; i++) {
 		/*
 		 * Collect the aggregated propagation counts of groups
@@ -6620,7 +6853,7 @@ static int memory_numa_stat_show(struct seq_file *m, void *v)
 	int i;
 	struct mem_cgroup *memcg = mem_cgroup_from_seq(m);
 
-	cgroup_rstat_flush(memcg->css.cgroup);
+	mem_cgroup_flush_stats(memcg);
 
 	for (i = 0; i < ARRAY_SIZE(memory_stats); i++) {
 		int nid;
@@ -6676,6 +6909,69 @@ static ssize_t memory_oom_group_write(struct kernfs_open_file *of,
 	return nbytes;
 }
 
+static int memory_high_async_ratio_show(struct seq_file *m, void *v)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_seq(m);
+
+	seq_printf(m, "%u\n", READ_ONCE(memcg->high_async_ratio));
+
+	return 0;
+}
+
+static ssize_t memory_high_async_ratio_write(struct kernfs_open_file *of,
+					     char *buf, size_t nbytes,
+					     loff_t off)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_css(of_css(of));
+	unsigned int ratio;
+	int ret;
+
+	buf = strstrip(buf);
+	ret = kstrtouint(buf, 0, &ratio);
+	if (ret)
+		return ret;
+
+	if (ratio >= 100)
+		return -EINVAL;
+
+	WRITE_ONCE(memcg->high_async_ratio, ratio);
+
+	if (ratio && page_counter_read(&memcg->memory) > memcg_async_high(memcg))
+		queue_work(memcg_async_reclaim_wq, &memcg->async_high_work);
+
+	return nbytes;
+}
+
+static int memory_charge_batch_show(struct seq_file *m, void *v)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_seq(m);
+
+	seq_printf(m, "%u\n", memcg_charge_batch(memcg));
+
+	return 0;
+}
+
+static ssize_t memory_charge_batch_write(struct kernfs_open_file *of,
+					 char *buf, size_t nbytes, loff_t off)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_css(of_css(of));
+	unsigned int batch;
+	int ret;
+
+	buf = strstrip(buf);
+	ret = kstrtouint(buf, 0, &batch);
+	if (ret)
+		return ret;
+
+	if (!batch || batch > MEMCG_CHARGE_BATCH_MAX)
+		return -EINVAL;
+
+	WRITE_ONCE(memcg->charge_batch, batch);
+
+	/* Stocks above the new batch are trimmed on their next refill */
+	return nbytes;
+}
+
 static struct cftype memory_files[] = {
 	{
 		.name = "current",
@@ -6700,6 +6996,18 @@ static struct cftype memory_files[] = {
 		.seq_show = memory_high_show,
 		.write = memory_high_write,
 	},
+	{
+		.name = "charge_batch",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = memory_charge_batch_show,
+		.write = memory_charge_batch_write,
+	},
+	{
+		.name = "high_async_ratio",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = memory_high_async_ratio_show,
+		.write = memory_high_async_ratio_write,
+	},
 	{
 		.name = "max",
 		.flags = CFTYPE_NOT_ON_ROOT,
@@ -7351,6 +7659,11 @@ static int __init mem_cgroup_init(void)
 	cpuhp_setup_state_nocalls(CPUHP_MM_MEMCQ_DEAD, "mm/memctrl:dead", NULL,
 				  memcg_hotplug_cpu_dead);
 
+	memcg_async_reclaim_wq = alloc_workqueue("memcg_async_reclaim",
+						 WQ_UNBOUND | WQ_MEM_RECLAIM,
+						 0);
+	BUG_ON(!memcg_async_reclaim_wq);
+
 	for_each_possible_cpu(cpu)
 		INIT_WORK(&per_cpu_ptr(&memcg_stock, cpu)->work,
 			  drain_local_stock);
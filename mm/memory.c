@@ -70,6 +70,7 @@
 #include <linux/dax.h>
 #include <linux/oom.h>
 #include <linux/numa.h>
+#include <linux/padata.h>
 #include <linux/perf_event.h>
 #include <linux/ptrace.h>
 #include <linux/vmalloc.h>
@@ -1374,6 +1375,227 @@ copy_pte_range(struct vm_area_struct *dst_vma, struct vm_area_struct *src_vma,
  * IAMROOT, 2023.04.01:
  * - pmd entry를 수행하며 table copy를 수행한다.
  */
+#ifdef CONFIG_FORK_SHARE_PTE
+/*
+ * Let the child map the parent's PTE table instead of copying it, if the
+ * parent asked for it with PR_SET_FORK_SHARE_PTE. Only done for tables that
+ * are entirely covered by a private anonymous mapping and only map anon
+ * (or zero) pages that are not pinned, anything else is copied.
+ *
+ * A shared table counts as a single mapping of its pages, for the page
+ * refcount and the rmap, but in the RSS of every mm sharing it. Writable
+ * entries are write protected here, so the first write fault in either mm
+ * goes to unshare_pte_table(), which takes the references for the copy.
+ */
+static bool
+share_pte_table(struct vm_area_struct *dst_vma, struct vm_area_struct *src_vma,
+		pmd_t *dst_pmd, pmd_t *src_pmd, unsigned long addr,
+		unsigned long end)
+{
+	struct mm_struct *dst_mm = dst_vma->vm_mm;
+	struct mm_struct *src_mm = src_vma->vm_mm;
+	pte_t *orig_src_pte, *src_pte;
+	int rss[NR_MM_COUNTERS];
+	spinlock_t *src_ptl;
+	struct page *table;
+	bool ret = false;
+
+	if (!test_bit(MMF_FORK_SHARE_PTE, &src_mm->flags))
+		return false;
+	if (!vma_is_anonymous(src_vma) || !is_cow_mapping(src_vma->vm_flags) ||
+	    userfaultfd_wp(dst_vma))
+		return false;
+	if (end - addr != PMD_SIZE || !pmd_none(*dst_pmd))
+		return false;
+
+	init_rss_vec(rss);
+	src_pte = pte_offset_map_lock(src_mm, src_pmd, addr, &src_ptl);
+	orig_src_pte = src_pte;
+	do {
+		pte_t pte = *src_pte;
+		struct page *page;
+
+		if (pte_none(pte))
+			continue;
+		if (!pte_present(pte))
+			goto out;
+		page = vm_normal_page(src_vma, addr, pte);
+		if (page) {
+			if (!PageAnon(page) ||
+			    page_needs_cow_for_dma(src_vma, page))
+				goto out;
+			rss[mm_counter(page)]++;
+		}
+		/* entries already write protected are copied as they are */
+		if (pte_write(pte))
+			ptep_set_wrprotect(src_mm, addr, src_pte);
+	} while (src_pte++, addr += PAGE_SIZE, addr != end);
+
+	table = pmd_pgtable(*src_pmd);
+	/* a table that was never shared has no count yet */
+	atomic_cmpxchg(&table->pt_share_count, 0, 1);
+	atomic_inc(&table->pt_share_count);
+
+	mm_inc_nr_ptes(dst_mm);
+	pmd_populate(dst_mm, dst_pmd, table);
+	add_mm_rss_vec(dst_mm, rss);
+	ret = true;
+out:
+	pte_unmap_unlock(orig_src_pte, src_ptl);
+	return ret;
+}
+
+/*
+ * Give this mm its own copy of the shared PTE table mapping @addr. Returns
+ * 0 when the table is private by now, whether we copied it or the other
+ * mms went away in the meantime.
+ */
+int unshare_pte_table(struct vm_area_struct *vma, pmd_t *pmd,
+		      unsigned long addr, gfp_t gfp)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	unsigned long start = addr & PMD_MASK, end = start + PMD_SIZE;
+	pte_t *orig_src_pte, *src_pte, *dst_pte;
+	spinlock_t *pml, *ptl;
+	struct page *table;
+	pgtable_t new;
+
+	new = __pte_alloc_one(mm, gfp);
+	if (!new)
+		return -ENOMEM;
+
+	pml = pmd_lock(mm, pmd);
+	if (!pte_table_shared(pmd))
+		goto out;
+
+	table = pmd_pgtable(*pmd);
+	ptl = pte_lockptr(mm, pmd);
+	if (ptl != pml)
+		spin_lock_nested(ptl, SINGLE_DEPTH_NESTING);
+	/* the others dropped theirs, keep the table */
+	if (!atomic_add_unless(&table->pt_share_count, -1, 1))
+		goto out_unlock;
+
+	src_pte = orig_src_pte = pte_offset_map(pmd, start);
+	dst_pte = (pte_t *)page_address(new);
+	addr = start;
+	do {
+		pte_t pte = *src_pte;
+		struct page *page;
+
+		if (pte_none(pte))
+			continue;
+		/*
+		 * Only present entries were shared, and rmap walks leave
+		 * shared tables alone.
+		 */
+		VM_WARN_ON_ONCE(!pte_present(pte));
+		page = vm_normal_page(vma, addr, pte);
+		if (page) {
+			get_page(page);
+			page_dup_rmap(page, false);
+		}
+		set_pte_at(mm, addr, dst_pte, pte);
+	} while (src_pte++, dst_pte++, addr += PAGE_SIZE, addr != end);
+	pte_unmap(orig_src_pte);
+
+	/* break before make, the translations stay the same */
+	pmd_clear(pmd);
+	flush_tlb_range(vma, start, end);
+	smp_wmb(); /* See comment in __pte_alloc() */
+	pmd_populate(mm, pmd, new);
+	new = NULL;
+out_unlock:
+	if (ptl != pml)
+		spin_unlock(ptl);
+out:
+	spin_unlock(pml);
+	if (new)
+		pte_free(mm, new);
+	return 0;
+}
+
+/*
+ * Drop this mm's reference to a shared PTE table fully covered by the zap,
+ * which leaves the pages to the other mms. Returns false if the table has
+ * to be zapped as usual, because it is private by now or only partially
+ * unmapped.
+ */
+static bool zap_shared_pte_table(struct mmu_gather *tlb,
+				 struct vm_area_struct *vma, pmd_t *pmd,
+				 unsigned long addr, unsigned long end)
+{
+	struct mm_struct *mm = tlb->mm;
+	int rss[NR_MM_COUNTERS];
+	spinlock_t *pml, *ptl;
+	pte_t *start_pte, *pte;
+	struct page *table;
+	bool ret = false;
+
+	/* the rest of the table stays mapped, zap a private copy */
+	if (end - addr != PMD_SIZE) {
+		unshare_pte_table(vma, pmd, addr,
+				  GFP_PGTABLE_USER | __GFP_NOFAIL);
+		return false;
+	}
+
+	init_rss_vec(rss);
+	pml = pmd_lock(mm, pmd);
+	if (!pte_table_shared(pmd))
+		goto out;
+
+	table = pmd_pgtable(*pmd);
+	ptl = pte_lockptr(mm, pmd);
+	if (ptl != pml)
+		spin_lock_nested(ptl, SINGLE_DEPTH_NESTING);
+	if (!atomic_add_unless(&table->pt_share_count, -1, 1))
+		goto out_unlock;
+
+	start_pte = pte = pte_offset_map(pmd, addr);
+	do {
+		struct page *page;
+
+		if (pte_none(*pte))
+			continue;
+		page = vm_normal_page(vma, addr, *pte);
+		if (page)
+			rss[mm_counter(page)]--;
+	} while (pte++, addr += PAGE_SIZE, addr != end);
+	pte_unmap(start_pte);
+
+	/*
+	 * Flush before dropping the ptl: the last mm mapping the table may
+	 * free its pages as soon as it can zap it.
+	 */
+	pmd_clear(pmd);
+	flush_tlb_range(vma, end - PMD_SIZE, end);
+	mm_dec_nr_ptes(mm);
+	add_mm_rss_vec(mm, rss);
+	ret = true;
+out_unlock:
+	if (ptl != pml)
+		spin_unlock(ptl);
+out:
+	spin_unlock(pml);
+	return ret;
+}
+#else
+static inline bool
+share_pte_table(struct vm_area_struct *dst_vma, struct vm_area_struct *src_vma,
+		pmd_t *dst_pmd, pmd_t *src_pmd, unsigned long addr,
+		unsigned long end)
+{
+	return false;
+}
+
+static inline bool zap_shared_pte_table(struct mmu_gather *tlb,
+					struct vm_area_struct *vma, pmd_t *pmd,
+					unsigned long addr, unsigned long end)
+{
+	return false;
+}
+#endif
+
 static inline int
 copy_pmd_range(struct vm_area_struct *dst_vma, struct vm_area_struct *src_vma,
 	       pud_t *dst_pud, pud_t *src_pud, unsigned long addr,
@@ -1404,6 +1626,9 @@ copy_pmd_range(struct vm_area_struct *dst_vma, struct vm_area_struct *src_vma,
 		}
 		if (pmd_none_or_clear_bad(src_pmd))
 			continue;
+		if (share_pte_table(dst_vma, src_vma, dst_pmd, src_pmd,
+				    addr, next))
+			continue;
 		if (copy_pte_range(dst_vma, src_vma, dst_pmd, src_pmd,
 				   addr, next))
 			return -ENOMEM;
@@ -1794,6 +2019,9 @@ static inline unsigned long zap_pmd_range(struct mmu_gather *tlb,
 		 */
 		if (pmd_none_or_trans_huge_or_clear_bad(pmd))
 			goto next;
+		if (pte_table_shared(pmd) &&
+		    zap_shared_pte_table(tlb, vma, pmd, addr, next))
+			goto next;
 		next = zap_pte_range(tlb, vma, pmd, addr, next, details);
 next:
 		cond_resched();
@@ -1984,6 +2212,166 @@ void unmap_vmas(struct mmu_gather *tlb,
 	mmu_notifier_invalidate_range_end(&range);
 }
 
+/*
+ * Exiting or reaping the largest processes is dominated by zapping their
+ * anonymous memory, which unmap_anon_vmas_mt() spreads over padata helpers
+ * once there is more than this many megabytes of it. 0 disables.
+ */
+unsigned int sysctl_exit_mmap_parallel_mb __read_mostly = 1024;
+
+#ifdef CONFIG_PADATA
+/* Every eligible VMA and where it starts in the job, which counts pages. */
+struct zap_mt_vma {
+	struct vm_area_struct	*vma;
+	unsigned long		first;
+};
+
+struct zap_mt_args {
+	struct mm_struct	*mm;
+	struct zap_mt_vma	*vmas;
+	int			nr_vmas;
+	bool			oom_reap;
+	bool			blocked;
+};
+
+static void zap_mt_thread(unsigned long start, unsigned long end, void *arg)
+{
+	struct zap_mt_args *args = arg;
+	struct mm_struct *mm = args->mm;
+	int lo = 0, hi = args->nr_vmas - 1;
+	struct mmu_gather tlb;
+
+	/* The last VMA starting at or before @start. */
+	while (lo < hi) {
+		int mid = (lo + hi + 1) / 2;
+
+		if (args->vmas[mid].first <= start)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	/*
+	 * Each helper gathers and flushes on its own. Chunks of different
+	 * helpers may end up in the same page table, zap_pte_range() takes
+	 * the ptl and only frees pages, the tables are left to the caller.
+	 */
+	if (args->oom_reap)
+		tlb_gather_mmu(&tlb, mm);
+	else
+		tlb_gather_mmu_fullmm(&tlb, mm);
+
+	for (; lo < args->nr_vmas && args->vmas[lo].first < end; lo++) {
+		struct vm_area_struct *vma = args->vmas[lo].vma;
+		unsigned long first = args->vmas[lo].first;
+		struct mmu_notifier_range range;
+		unsigned long vs, ve;
+
+		vs = vma->vm_start + ((max(start, first) - first) << PAGE_SHIFT);
+		ve = vma->vm_start +
+		     ((min(end, first + vma_pages(vma)) - first) << PAGE_SHIFT);
+		/*
+		 * Hand out whole PMDs inside a VMA, so that no huge pmd or
+		 * shared PTE table gets split between two helpers.
+		 */
+		if (vs != vma->vm_start)
+			vs = min(ALIGN(vs, PMD_SIZE), vma->vm_end);
+		if (ve != vma->vm_end)
+			ve = min(ALIGN(ve, PMD_SIZE), vma->vm_end);
+		if (vs >= ve)
+			continue;
+
+		mmu_notifier_range_init(&range, MMU_NOTIFY_UNMAP, 0, vma, mm,
+					vs, ve);
+		if (!args->oom_reap) {
+			mmu_notifier_invalidate_range_start(&range);
+		} else if (mmu_notifier_invalidate_range_start_nonblock(&range)) {
+			WRITE_ONCE(args->blocked, true);
+			continue;
+		}
+		unmap_page_range(&tlb, vma, vs, ve, NULL);
+		mmu_notifier_invalidate_range_end(&range);
+	}
+
+	tlb_finish_mmu(&tlb);
+}
+
+/**
+ * unmap_anon_vmas_mt - zap the private anonymous memory of an mm in parallel
+ * @mm: the mm, which no task is using anymore
+ * @oom_reap: from the OOM reaper: skip mlocked VMAs and don't block in mmu
+ *	      notifiers
+ *
+ * Only page table entries are zapped, freeing the page tables is left to
+ * the caller, as is zapping all the other VMAs. The caller has to wait for
+ * workqueue workers, the oom_reaper thread itself therefore doesn't use it.
+ *
+ * Returns 1 if nothing was done because @mm is too small or the VMA array
+ * could not be allocated, -EAGAIN if a notifier would have blocked for part
+ * of the memory and 0 otherwise.
+ */
+int unmap_anon_vmas_mt(struct mm_struct *mm, bool oom_reap)
+{
+	unsigned long min_pages = (unsigned long)
+		READ_ONCE(sysctl_exit_mmap_parallel_mb) << (20 - PAGE_SHIFT);
+	struct zap_mt_args args = { .mm = mm, .oom_reap = oom_reap };
+	struct padata_mt_job job;
+	struct vm_area_struct *vma;
+	unsigned long nr_pages = 0, rss;
+	u64 start;
+
+	rss = get_mm_counter(mm, MM_ANONPAGES);
+	if (!min_pages || num_online_cpus() < 2 || rss < min_pages)
+		return 1;
+
+	args.vmas = kvmalloc_array(mm->map_count, sizeof(*args.vmas),
+				   (oom_reap ? GFP_NOWAIT : GFP_KERNEL) |
+				   __GFP_NOWARN);
+	if (!args.vmas)
+		return 1;
+
+	for (vma = mm->mmap; vma; vma = vma->vm_next) {
+		if (!vma_is_anonymous(vma))
+			continue;
+		if (oom_reap && !can_madv_lru_vma(vma))
+			continue;
+		if (WARN_ON_ONCE(args.nr_vmas == mm->map_count))
+			break;
+		args.vmas[args.nr_vmas].vma = vma;
+		args.vmas[args.nr_vmas].first = nr_pages;
+		args.nr_vmas++;
+		nr_pages += vma_pages(vma);
+	}
+
+	job = (struct padata_mt_job) {
+		.thread_fn	= zap_mt_thread,
+		.fn_arg		= &args,
+		.start		= 0,
+		.size		= nr_pages,
+		.align		= PTRS_PER_PTE,
+		.min_chunk	= SZ_256M >> PAGE_SHIFT,
+		.max_threads	= max(num_online_cpus() / 2, 1U),
+		.numa_aware	= true,
+	};
+	start = ktime_get_ns();
+	padata_do_multithreaded(&job);
+
+	count_vm_event(ZAP_PARALLEL);
+	count_vm_events(ZAP_PARALLEL_PAGES,
+			rss - min(rss, get_mm_counter(mm, MM_ANONPAGES)));
+	count_vm_events(ZAP_PARALLEL_MSEC,
+			div_u64(ktime_get_ns() - start, NSEC_PER_MSEC));
+
+	kvfree(args.vmas);
+	return args.blocked ? -EAGAIN : 0;
+}
+#else
+int unmap_anon_vmas_mt(struct mm_struct *mm, bool oom_reap)
+{
+	return 1;
+}
+#endif
+
 /**
  * zap_page_range - remove user pages in a given range
  * @vma: vm_area_struct holding the applicable pages
@@ -4129,6 +4517,140 @@ vm_fault_t do_swap_page(struct vm_fault *vmf)
 	return ret;
 }
 
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+static bool pte_range_none(pte_t *pte, int nr)
+{
+	int i;
+
+	for (i = 0; i < nr; i++)
+		if (!pte_none(ptep_get(pte + i)))
+			return false;
+	return true;
+}
+
+static void free_anon_range(struct page *page, int nr)
+{
+	int i;
+
+	for (i = 0; i < nr; i++)
+		put_page(page + i);
+}
+
+/*
+ * Fill the naturally aligned range around the fault from a single
+ * high-order allocation, using the largest order that the per-size
+ * hugepages-<size>kB/enabled knobs allow and that fits the VMA and
+ * empty PTEs. The block is split into base pages so that rmap, LRU,
+ * reclaim and swap keep handling them as ordinary anonymous pages;
+ * the gain is one fault, one PTL section and contiguous memory for
+ * the whole range. Returns VM_FAULT_FALLBACK if no order could be
+ * used, and the caller then maps a single page.
+ */
+static vm_fault_t do_anonymous_range(struct vm_fault *vmf)
+{
+	struct vm_area_struct *vma = vmf->vma;
+	unsigned long orders, addr = 0;
+	struct page *page = NULL;
+	vm_fault_t ret = 0;
+	int order, nr = 1, i;
+	gfp_t gfp;
+	pte_t *pte;
+
+	if (userfaultfd_armed(vma))
+		return VM_FAULT_FALLBACK;
+
+	orders = thp_anon_orders(vma);
+	if (!orders)
+		return VM_FAULT_FALLBACK;
+
+	/* Don't reclaim or compact for this, a single page always works. */
+	gfp = GFP_TRANSHUGE_LIGHT & ~__GFP_COMP;
+
+	while (orders) {
+		order = fls_long(orders) - 1;
+		orders &= ~BIT(order);
+		nr = 1 << order;
+		addr = ALIGN_DOWN(vmf->address, PAGE_SIZE << order);
+		if (addr < vma->vm_start ||
+		    addr + (PAGE_SIZE << order) > vma->vm_end)
+			continue;
+
+		pte = pte_offset_map(vmf->pmd, addr);
+		if (!pte_range_none(pte, nr)) {
+			pte_unmap(pte);
+			continue;
+		}
+		pte_unmap(pte);
+
+		page = alloc_pages_vma(gfp, order, vma, addr, numa_node_id(),
+				       false);
+		if (!page) {
+			count_vm_event(MTHP_ANON_FAULT_FALLBACK);
+			continue;
+		}
+		split_page(page, order);
+
+		for (i = 0; i < nr; i++)
+			if (mem_cgroup_charge(page + i, vma->vm_mm, GFP_KERNEL))
+				break;
+		if (i < nr) {
+			free_anon_range(page, nr);
+			page = NULL;
+			count_vm_event(MTHP_ANON_FAULT_FALLBACK);
+			continue;
+		}
+		break;
+	}
+	if (!page)
+		return VM_FAULT_FALLBACK;
+
+	cgroup_throttle_swaprate(page, GFP_KERNEL);
+	for (i = 0; i < nr; i++) {
+		clear_user_highpage(page + i, addr + i * PAGE_SIZE);
+		/* See the comment in do_anonymous_page() */
+		__SetPageUptodate(page + i);
+	}
+
+	vmf->pte = pte_offset_map_lock(vma->vm_mm, vmf->pmd, addr, &vmf->ptl);
+	/* Lost a race with another fault in the range, let it refault. */
+	if (!pte_range_none(vmf->pte, nr))
+		goto release;
+
+	ret = check_stable_address_space(vma->vm_mm);
+	if (ret)
+		goto release;
+
+	add_mm_counter_fast(vma->vm_mm, MM_ANONPAGES, nr);
+	for (i = 0; i < nr; i++) {
+		unsigned long address = addr + i * PAGE_SIZE;
+		pte_t entry = mk_pte(page + i, vma->vm_page_prot);
+
+		entry = pte_sw_mkyoung(entry);
+		if (vma->vm_flags & VM_WRITE)
+			entry = pte_mkwrite(pte_mkdirty(entry));
+
+		page_add_new_anon_rmap(page + i, vma, address, false);
+		lru_cache_add_inactive_or_unevictable(page + i, vma);
+		set_pte_at(vma->vm_mm, address, vmf->pte + i, entry);
+		/* No need to invalidate - it was non-present before */
+		update_mmu_cache(vma, address, vmf->pte + i);
+	}
+	pte_unmap_unlock(vmf->pte, vmf->ptl);
+	count_vm_event(MTHP_ANON_FAULT_ALLOC);
+	return 0;
+
+release:
+	pte_unmap_unlock(vmf->pte, vmf->ptl);
+	free_anon_range(page, nr);
+	return ret;
+}
+#else
+static inline vm_fault_t do_anonymous_range(struct vm_fault *vmf)
+{
+	return VM_FAULT_FALLBACK;
+}
+#endif /* CONFIG_TRANSPARENT_HUGEPAGE */
+
 /*
  * We enter with non-exclusive mmap_lock (to exclude vma changes,
  * but allow concurrent faults), and pte mapped but not yet locked.
@@ -4226,6 +4748,12 @@ static vm_fault_t do_anonymous_page(struct vm_fault *vmf)
 	/* Allocate our own private page. */
 	if (unlikely(anon_vma_prepare(vma)))
 		goto oom;
+
+	ret = do_anonymous_range(vmf);
+	if (ret != VM_FAULT_FALLBACK)
+		return ret;
+	ret = 0;
+
 	page = alloc_zeroed_user_highpage_movable(vma, vmf->address);
 	if (!page)
 		goto oom;
@@ -4545,6 +5073,7 @@ vm_fault_t finish_fault(struct vm_fault *vmf)
 
 static unsigned long fault_around_bytes __read_mostly =
 	rounddown_pow_of_two(65536);
+static bool fault_around_adaptive __read_mostly = true;
 
 #ifdef CONFIG_DEBUG_FS
 static int fault_around_bytes_get(void *data, u64 *val)
@@ -4574,6 +5103,8 @@ static int __init fault_around_debugfs(void)
 {
 	debugfs_create_file_unsafe("fault_around_bytes", 0644, NULL, NULL,
 				   &fault_around_bytes_fops);
+	debugfs_create_bool("fault_around_adaptive", 0644, NULL,
+			    &fault_around_adaptive);
 	return 0;
 }
 late_initcall(fault_around_debugfs);
@@ -4602,7 +5133,32 @@ late_initcall(fault_around_debugfs);
  * fault_around_bytes rounded down to the machine page size
  * (and therefore to page order).  This way it's easier to guarantee
  * that we don't cross page table boundaries.
+ *
+ * With fault_around_adaptive set, fault_around_bytes is only the initial
+ * window of a VMA, see vma_fault_around_pages().
  */
+/*
+ * Size the fault-around window of a VMA from how the previous window
+ * was used. A fault landing right behind the previous window means the
+ * mapping is read sequentially and the mapped-around pages were used, so
+ * double the window; a fault anywhere else means they were likely not,
+ * so halve it. The result stays a power of two between one page and a
+ * full page table.
+ */
+static unsigned long vma_fault_around_pages(struct vm_fault *vmf)
+{
+	struct vm_area_struct *vma = vmf->vma;
+	unsigned long nr_pages = READ_ONCE(vma->vm_fault_around_pages);
+	unsigned long next = READ_ONCE(vma->vm_fault_around_next);
+
+	if (!READ_ONCE(fault_around_adaptive) || !nr_pages)
+		return READ_ONCE(fault_around_bytes) >> PAGE_SHIFT;
+
+	if (vmf->address >= next && vmf->address - next < nr_pages * PAGE_SIZE)
+		return min_t(unsigned long, nr_pages * 2, PTRS_PER_PTE);
+	return max(nr_pages / 2, 1UL);
+}
+
 static vm_fault_t do_fault_around(struct vm_fault *vmf)
 {
 	unsigned long address = vmf->address, nr_pages, mask;
@@ -4610,7 +5166,7 @@ static vm_fault_t do_fault_around(struct vm_fault *vmf)
 	pgoff_t end_pgoff;
 	int off;
 
-	nr_pages = READ_ONCE(fault_around_bytes) >> PAGE_SHIFT;
+	nr_pages = vma_fault_around_pages(vmf);
 	mask = ~(nr_pages * PAGE_SIZE - 1) & PAGE_MASK;
 
 	address = max(address & mask, vmf->vma->vm_start);
@@ -4627,6 +5183,10 @@ static vm_fault_t do_fault_around(struct vm_fault *vmf)
 	end_pgoff = min3(end_pgoff, vma_pages(vmf->vma) + vmf->vma->vm_pgoff - 1,
 			start_pgoff + nr_pages - 1);
 
+	WRITE_ONCE(vmf->vma->vm_fault_around_pages, nr_pages);
+	WRITE_ONCE(vmf->vma->vm_fault_around_next,
+		   address + ((end_pgoff - start_pgoff + 1) << PAGE_SHIFT));
+
 	if (pmd_none(*vmf->pmd)) {
 		vmf->prealloc_pte = pte_alloc_one(vmf->vma->vm_mm);
 		if (!vmf->prealloc_pte)
@@ -4864,6 +5424,7 @@ static vm_fault_t do_numa_page(struct vm_fault *vmf)
 	int page_nid = NUMA_NO_NODE;
 	int last_cpupid;
 	int target_nid;
+	int migrated;
 	pte_t pte, old_pte;
 	bool was_writable = pte_savedwrite(vmf->orig_pte);
 	int flags = 0;
@@ -4985,7 +5546,8 @@ static vm_fault_t do_numa_page(struct vm_fault *vmf)
 	 *   node의 cpu 들에서 충분히 memory 접근이 많다면 taget_nid에 현재 cpu의
 	 *   node가 설정되어 현재 cpu의 노드로 @page를 옮긴다.
 	 */
-	if (migrate_misplaced_page(page, vma, target_nid)) {
+	migrated = migrate_misplaced_page(page, vma, target_nid);
+	if (migrated == 1) {
 /*
  * IAMROOT, 2023.06.24:
  * - migrate가 전부 성공
@@ -4997,7 +5559,13 @@ static vm_fault_t do_numa_page(struct vm_fault *vmf)
  * IAMROOT, 2023.06.24:
  * - migrate 실패(전부 실패 or 일부만 성공)
  */
-		flags |= TNF_MIGRATE_FAIL;
+		if (migrated == NUMA_MIGRATE_QUEUED) {
+			/* Still mapped here until the batch is migrated */
+			page_nid = target_nid;
+			flags |= TNF_MIGRATED;
+		} else {
+			flags |= TNF_MIGRATE_FAIL;
+		}
 		vmf->pte = pte_offset_map(vmf->pmd, vmf->address);
 		spin_lock(vmf->ptl);
 /*
@@ -5199,8 +5767,14 @@ static vm_fault_t handle_pte_fault(struct vm_fault *vmf)
  * - vmf->pte가 있지만 present가 안된. 즉 invalid. swap 상태라는의미.
  * - 즉 mapping이 없는 상태.
  */
-	if (!pte_present(vmf->orig_pte))
+	if (!pte_present(vmf->orig_pte)) {
+		/* Swapin may sleep on I/O and page locks, do it under mmap_lock. */
+		if (vmf->flags & FAULT_FLAG_VMA_LOCK) {
+			pte_unmap(vmf->pte);
+			return VM_FAULT_RETRY;
+		}
 		return do_swap_page(vmf);
+	}
 
 /*
  * IAMROOT, 2022.06.04:
@@ -5215,8 +5789,13 @@ static vm_fault_t handle_pte_fault(struct vm_fault *vmf)
  *   numa fault시 PTE_PROT_NONE으로 설정했었다. 그렇기 때문에 prot none인지
  *   확인하는것이다.
  */
-	if (pte_protnone(vmf->orig_pte) && vma_is_accessible(vmf->vma))
+	if (pte_protnone(vmf->orig_pte) && vma_is_accessible(vmf->vma)) {
+		if (vmf->flags & FAULT_FLAG_VMA_LOCK) {
+			pte_unmap(vmf->pte);
+			return VM_FAULT_RETRY;
+		}
 		return do_numa_page(vmf);
+	}
 
 	vmf->ptl = pte_lockptr(vmf->vma->vm_mm, vmf->pmd);
 	spin_lock(vmf->ptl);
@@ -5343,8 +5922,11 @@ static vm_fault_t __handle_mm_fault(struct vm_area_struct *vma,
 			return 0;
 		}
 		if (pmd_trans_huge(vmf.orig_pmd) || pmd_devmap(vmf.orig_pmd)) {
-			if (pmd_protnone(vmf.orig_pmd) && vma_is_accessible(vma))
+			if (pmd_protnone(vmf.orig_pmd) && vma_is_accessible(vma)) {
+				if (flags & FAULT_FLAG_VMA_LOCK)
+					return VM_FAULT_RETRY;
 				return do_huge_pmd_numa_page(&vmf);
+			}
 
 			if (dirty && !pmd_write(vmf.orig_pmd)) {
 				ret = wp_huge_pmd(&vmf);
@@ -5357,6 +5939,10 @@ static vm_fault_t __handle_mm_fault(struct vm_area_struct *vma,
 		}
 	}
 
+	if (unlikely(pte_table_shared(vmf.pmd)) &&
+	    unshare_pte_table(vma, vmf.pmd, address, GFP_PGTABLE_USER))
+		return VM_FAULT_OOM;
+
 	return handle_pte_fault(&vmf);
 }
 
@@ -5484,6 +6070,81 @@ vm_fault_t handle_mm_fault(struct vm_area_struct *vma, unsigned long address,
 }
 EXPORT_SYMBOL_GPL(handle_mm_fault);
 
+#ifdef CONFIG_PER_VMA_LOCK
+/*
+ * The same as find_vma() minus the vmacache, but walking mm_mt so that
+ * it is safe under RCU.  The VMA may be detached or resized by the time
+ * it is returned, which lock_vma_under_rcu() catches when it rechecks
+ * the range.
+ */
+static struct vm_area_struct *find_vma_rcu(struct mm_struct *mm,
+					   unsigned long addr)
+{
+	return mt_find(&mm->mm_mt, &addr, ULONG_MAX);
+}
+
+/**
+ * lock_vma_under_rcu - look up and read-lock the VMA covering @address
+ * @mm: the mm_struct the fault happened in
+ * @address: faulting address
+ *
+ * Only anonymous VMAs that already have an anon_vma are returned, so
+ * that the fault needs neither ->fault nor anon_vma_prepare(), both of
+ * which rely on mmap_lock. Userfaultfd-armed VMAs are left to the
+ * regular path as well.
+ *
+ * Return: the read-locked VMA, to be released with vma_end_read(), or
+ * NULL if the caller has to take mmap_lock.
+ */
+struct vm_area_struct *lock_vma_under_rcu(struct mm_struct *mm,
+					  unsigned long address)
+{
+	struct vm_area_struct *vma;
+	int reason;
+
+	rcu_read_lock();
+	vma = find_vma_rcu(mm, address);
+	if (!vma) {
+		reason = VMA_LOCK_FALLBACK_MISS;
+		goto miss;
+	}
+
+	if (!vma_start_read(vma)) {
+		reason = VMA_LOCK_FALLBACK_LOCKED;
+		goto abort;
+	}
+
+	/* The VMA could have been unlinked, resized or split meanwhile. */
+	if (unlikely(READ_ONCE(vma->detached) ||
+		     address < vma->vm_start || address >= vma->vm_end)) {
+		vma_end_read(vma);
+		reason = VMA_LOCK_FALLBACK_MISS;
+		goto miss;
+	}
+
+	if (!vma_is_anonymous(vma) || !vma->anon_vma ||
+	    userfaultfd_armed(vma)) {
+		vma_end_read(vma);
+		reason = VMA_LOCK_FALLBACK_UNSUPPORTED;
+		goto abort;
+	}
+
+	rcu_read_unlock();
+	return vma;
+
+miss:
+	rcu_read_unlock();
+	count_vm_vma_lock_event(VMA_LOCK_MISS);
+	__mmap_lock_trace_vma_fallback(mm, address, reason);
+	return NULL;
+abort:
+	rcu_read_unlock();
+	count_vm_vma_lock_event(VMA_LOCK_ABORT);
+	__mmap_lock_trace_vma_fallback(mm, address, reason);
+	return NULL;
+}
+#endif /* CONFIG_PER_VMA_LOCK */
+
 #ifndef __PAGETABLE_P4D_FOLDED
 /*
  * Allocate p4d page table.
@@ -6021,15 +6682,72 @@ static void clear_gigantic_page(struct page *page,
 	for (i = 0; i < pages_per_huge_page;
 	     i++, p = mem_map_next(p, page, i)) {
 		cond_resched();
-		clear_user_highpage(p, addr + i * PAGE_SIZE);
+		clear_user_highpage_nocache(p, addr + i * PAGE_SIZE);
 	}
 }
 
+#ifdef CONFIG_PADATA
+struct clear_gigantic_args {
+	struct page	*page;
+	unsigned long	addr;
+};
+
+static void clear_gigantic_thread(unsigned long start, unsigned long end,
+				  void *arg)
+{
+	struct clear_gigantic_args *args = arg;
+
+	clear_gigantic_page(nth_page(args->page, start),
+			    args->addr + start * PAGE_SIZE, end - start);
+}
+
+/*
+ * Clearing a 1GB page takes a single CPU long enough to show up in the
+ * start time of VMs backed by them, spread it over a few helpers instead.
+ */
+static void clear_gigantic_page_mt(struct page *page, unsigned long addr,
+				   unsigned int pages_per_huge_page)
+{
+	struct clear_gigantic_args args = { .page = page, .addr = addr };
+	struct padata_mt_job job = {
+		.thread_fn	= clear_gigantic_thread,
+		.fn_arg		= &args,
+		.start		= 0,
+		.size		= pages_per_huge_page,
+		.align		= MAX_ORDER_NR_PAGES,
+		.min_chunk	= SZ_64M >> PAGE_SHIFT,
+		.max_threads	= 16,
+	};
+
+	padata_do_multithreaded(&job);
+}
+#else
+static void clear_gigantic_page_mt(struct page *page, unsigned long addr,
+				   unsigned int pages_per_huge_page)
+{
+	clear_gigantic_page(page, addr, pages_per_huge_page);
+}
+#endif
+
+/*
+ * Subpages this close to the faulting one are cleared through the cache,
+ * the others are not likely to be touched before being evicted anyway.
+ */
+#define CLEAR_HUGE_PAGE_HOT	16
+
+struct clear_huge_args {
+	struct page	*page;
+	int		target;
+};
+
 static void clear_subpage(unsigned long addr, int idx, void *arg)
 {
-	struct page *page = arg;
+	struct clear_huge_args *args = arg;
 
-	clear_user_highpage(page + idx, addr);
+	if (abs(idx - args->target) < CLEAR_HUGE_PAGE_HOT)
+		clear_user_highpage(args->page + idx, addr);
+	else
+		clear_user_highpage_nocache(args->page + idx, addr);
 }
 
 void clear_huge_page(struct page *page,
@@ -6037,13 +6755,17 @@ void clear_huge_page(struct page *page,
 {
 	unsigned long addr = addr_hint &
 		~(((unsigned long)pages_per_huge_page << PAGE_SHIFT) - 1);
+	struct clear_huge_args args = {
+		.page	= page,
+		.target	= (addr_hint - addr) >> PAGE_SHIFT,
+	};
 
 	if (unlikely(pages_per_huge_page > MAX_ORDER_NR_PAGES)) {
-		clear_gigantic_page(page, addr, pages_per_huge_page);
+		clear_gigantic_page_mt(page, addr, pages_per_huge_page);
 		return;
 	}
 
-	process_huge_page(addr_hint, pages_per_huge_page, clear_subpage, page);
+	process_huge_page(addr_hint, pages_per_huge_page, clear_subpage, &args);
 }
 
 static void copy_user_gigantic_page(struct page *dst, struct page *src,
@@ -36,6 +36,7 @@
 #include <linux/memblock.h>
 #include <linux/compaction.h>
 #include <linux/rmap.h>
+#include <linux/padata.h>
 
 #include <asm/tlbflush.h>
 
@@ -711,6 +712,58 @@ static void section_taint_zone_device(unsigned long pfn)
 	ms->section_mem_map |= SECTION_TAINT_ZONE_DEVICE;
 }
 
+struct memmap_init_hotplug_arg {
+	int nid;
+	unsigned long zone;
+	int migratetype;
+};
+
+static void memmap_init_hotplug_chunk(unsigned long start_pfn,
+				      unsigned long end_pfn, void *data)
+{
+	struct memmap_init_hotplug_arg *arg = data;
+
+	memmap_init_range(end_pfn - start_pfn, arg->nid, arg->zone, start_pfn,
+			  0, MEMINIT_HOTPLUG, NULL, arg->migratetype);
+}
+
+/*
+ * Initialize the memmap of a hot-added range the way deferred_init_memmap()
+ * does at boot: split at section granularity and handed to padata helpers.
+ * Every helper only writes the struct pages and pageblock flags of its own
+ * sections, so no locking is needed beyond what the caller already holds.
+ */
+static void memmap_init_hotplug(struct zone *zone, unsigned long start_pfn,
+				unsigned long nr_pages, int migratetype)
+{
+	struct memmap_init_hotplug_arg arg = {
+		.nid         = zone_to_nid(zone),
+		.zone        = zone_idx(zone),
+		.migratetype = migratetype,
+	};
+	struct padata_mt_job job = {
+		.thread_fn   = memmap_init_hotplug_chunk,
+		.fn_arg      = &arg,
+		.start       = start_pfn,
+		.size        = nr_pages,
+		.align       = PAGES_PER_SECTION,
+		.min_chunk   = PAGES_PER_SECTION,
+		.max_threads = num_online_cpus(),
+		.numa_aware  = true,
+	};
+
+	if (!IS_ENABLED(CONFIG_PADATA)) {
+		memmap_init_hotplug_chunk(start_pfn, start_pfn + nr_pages, &arg);
+		return;
+	}
+
+	/* memmap_init_range() updates this without locking, do it up front */
+	if (highest_memmap_pfn < start_pfn + nr_pages - 1)
+		highest_memmap_pfn = start_pfn + nr_pages - 1;
+
+	padata_do_multithreaded(&job);
+}
+
 /*
  * Associate the pfn range with the given zone, initializing the memmaps
  * and resizing the pgdat/zone data to span the added pages. After this
@@ -753,8 +806,11 @@ void __ref move_pfn_range_to_zone(struct zone *zone, unsigned long start_pfn,
 	 * expects the zone spans the pfn range. All the pages in the range
 	 * are reserved so nobody should be touching them so we should be safe
 	 */
-	memmap_init_range(nr_pages, nid, zone_idx(zone), start_pfn, 0,
-			 MEMINIT_HOTPLUG, altmap, migratetype);
+	if (zone_is_zone_device(zone))
+		memmap_init_range(nr_pages, nid, zone_idx(zone), start_pfn, 0,
+				  MEMINIT_HOTPLUG, altmap, migratetype);
+	else
+		memmap_init_hotplug(zone, start_pfn, nr_pages, migratetype);
 
 	set_zone_contiguous(zone);
 }
@@ -1339,6 +1395,11 @@ static int online_memory_block(struct memory_block *mem, void *arg)
 	return device_online(&mem->dev);
 }
 
+bool mhp_memmap_on_memory(void)
+{
+	return memmap_on_memory;
+}
+
 bool mhp_supports_memmap_on_memory(unsigned long size)
 {
 	unsigned long nr_vmemmap_pages = size / PAGE_SIZE;
@@ -1372,7 +1433,7 @@ bool mhp_supports_memmap_on_memory(unsigned long size)
 	 *       populate a single PMD.
 	 */
 	return memmap_on_memory &&
-	       !hugetlb_free_vmemmap_enabled &&
+	       !hugetlb_optimize_vmemmap_enabled() &&
 	       IS_ENABLED(CONFIG_MHP_MEMMAP_ON_MEMORY) &&
 	       size == memory_block_size_bytes() &&
 	       IS_ALIGNED(vmemmap_size, PMD_SIZE) &&
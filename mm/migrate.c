@@ -50,6 +50,9 @@
 #include <linux/ptrace.h>
 #include <linux/oom.h>
 #include <linux/memory.h>
+#include <linux/node.h>
+#include <linux/random.h>
+#include <linux/sched/sysctl.h>
 
 #include <asm/tlbflush.h>
 
@@ -1377,12 +1380,25 @@ static int __unmap_and_move(struct page *page, struct page *newpage,
  *
  * This is represented in the node_demotion[] like this:
  *
- *	{  1, // Node 0 migrates to 1
- *	   2, // Node 1 migrates to 2
- *	  -1, // Node 2 does not migrate
- *	   4, // Node 3 migrates to 4
- *	   5, // Node 4 migrates to 5
- *	  -1} // Node 5 does not migrate
+ *	{  nr=1, nodes[0]=1 }, // Node 0 migrates to 1
+ *	{  nr=1, nodes[0]=2 }, // Node 1 migrates to 2
+ *	{  nr=0, nodes[0]=-1 }, // Node 2 does not migrate
+ *	{  nr=1, nodes[0]=4 }, // Node 3 migrates to 4
+ *	{  nr=1, nodes[0]=5 }, // Node 4 migrates to 5
+ *	{  nr=0, nodes[0]=-1 }, // Node 5 does not migrate
+ *
+ * Moreover some systems may have multiple slow memory nodes.
+ * Suppose a system has one socket with 3 memory nodes, node 0
+ * is fast memory type, and node 1/2 both are slow memory
+ * type, and the distance between fast memory node and slow
+ * memory node is same.  So the migration path should be:
+ *
+ *	0 -> 1/2 -> stop
+ *
+ * This is represented in the node_demotion[] like this:
+ *	{ nr=2, {nodes[0]=1, nodes[1]=2} }, // Node 0 migrates to node 1 and node 2
+ *	{ nr=0, nodes[0]=-1, }, // Node 1 dose not migrate
+ *	{ nr=0, nodes[0]=-1, }, // Node 2 does not migrate
  */
 
 /*
@@ -1393,8 +1409,20 @@ static int __unmap_and_move(struct page *page, struct page *newpage,
  * must be held over all reads to ensure that no cycles are
  * observed.
  */
-static int node_demotion[MAX_NUMNODES] __read_mostly =
-	{[0 ...  MAX_NUMNODES - 1] = NUMA_NO_NODE};
+#define DEFAULT_DEMOTION_TARGET_NODES 15
+
+#if MAX_NUMNODES < DEFAULT_DEMOTION_TARGET_NODES
+#define DEMOTION_TARGET_NODES	(MAX_NUMNODES - 1)
+#else
+#define DEMOTION_TARGET_NODES	DEFAULT_DEMOTION_TARGET_NODES
+#endif
+
+struct demotion_nodes {
+	unsigned short nr;
+	short nodes[DEMOTION_TARGET_NODES];
+};
+
+static struct demotion_nodes *node_demotion __read_mostly;
 
 /**
  * next_demotion_node() - Get the next node in the demotion path
@@ -1403,12 +1431,20 @@ static int node_demotion[MAX_NUMNODES] __read_mostly =
  * Return: node id for next memory node in the demotion path hierarchy
  * from @node; NUMA_NO_NODE if @node is terminal.  This does not keep
  * @node online or guarantee that it *continues* to be the next demotion
- * target.
+ * target.  If @node has several equally close demotion targets, one of
+ * them is picked at random to spread the demoted pages.
  */
 int next_demotion_node(int node)
 {
+	struct demotion_nodes *nd;
+	unsigned short target_nr, index;
 	int target;
 
+	if (!node_demotion)
+		return NUMA_NO_NODE;
+
+	nd = &node_demotion[node];
+
 	/*
 	 * node_demotion[] is updated without excluding this
 	 * function from running.  RCU doesn't provide any
@@ -1419,9 +1455,28 @@ int next_demotion_node(int node)
 	 * node_demotion[] reads need to be consistent.
 	 */
 	rcu_read_lock();
-	target = READ_ONCE(node_demotion[node]);
-	rcu_read_unlock();
+	target_nr = READ_ONCE(nd->nr);
 
+	switch (target_nr) {
+	case 0:
+		target = NUMA_NO_NODE;
+		goto out;
+	case 1:
+		index = 0;
+		break;
+	default:
+		/*
+		 * If there are multiple target nodes, just select one
+		 * target node randomly.
+		 */
+		index = get_random_int() % target_nr;
+		break;
+	}
+
+	target = READ_ONCE(nd->nodes[index]);
+
+out:
+	rcu_read_unlock();
 	return target;
 }
 
@@ -2477,8 +2532,23 @@ static int numamigrate_isolate_page(pg_data_t *pgdat, struct page *page)
 		return 0;
 
 	/* Avoid migrating to a node that is nearly full */
-	if (!migrate_balanced_pgdat(pgdat, nr_pages))
+	if (!migrate_balanced_pgdat(pgdat, nr_pages)) {
+		int z;
+
+		if (!(sysctl_numa_balancing_mode & NUMA_BALANCING_MEMORY_TIERING))
+			return 0;
+		/*
+		 * In memory tiering mode, wake up kswapd so that it can
+		 * demote cold pages and make room for the promotion.
+		 */
+		for (z = pgdat->nr_zones - 1; z >= 0; z--) {
+			if (populated_zone(pgdat->node_zones + z))
+				break;
+		}
+		wakeup_kswapd(pgdat->node_zones + z, 0,
+			      compound_order(page), ZONE_MOVABLE);
 		return 0;
+	}
 
 	if (isolate_lru_page(page))
 		return 0;
@@ -2502,10 +2572,289 @@ static int numamigrate_isolate_page(pg_data_t *pgdat, struct page *page)
 	return 1;
 }
 
+/*
+ * Batched migration of misplaced pages.
+ *
+ * With kernel.numa_balancing_migrate_batch set, NUMA hinting faults do not
+ * migrate the faulting page synchronously.  The page is isolated and queued
+ * on its target node and stays mapped at its old location.  A work item per
+ * target node migrates the queued pages when the batch fills up or
+ * NUMA_MIGRATE_FLUSH_DELAY passes.  All pages of a batch are unmapped with
+ * TTU_BATCH_FLUSH, so only one TLB flush is sent for the whole batch
+ * instead of one per page.
+ *
+ * Each target node also has a budget of
+ * kernel.numa_balancing_promote_rate_limit_MBps per second.  Pages beyond
+ * the budget are left where they are.
+ *
+ * The work is queued from the faulting CPU, which sits on the target node.
+ * It therefore runs on that node's unbound worker pool.
+ */
+unsigned int sysctl_numa_balancing_migrate_batch;
+
+#define NUMA_MIGRATE_FLUSH_DELAY	msecs_to_jiffies(10)
+
+struct numa_migrate_entry {
+	struct page *page;
+	struct page *newpage;
+	struct anon_vma *anon_vma;
+	bool mapped;
+};
+
+struct numa_migrate_queue {
+	spinlock_t lock;
+	struct list_head pages;
+	unsigned int nr;
+	int nid;
+	/* start time in jiffies and pages queued in the current budget period */
+	unsigned long rl_start;
+	unsigned long rl_nr;
+	struct delayed_work work;
+	/* only used by @work, which never runs concurrently with itself */
+	struct numa_migrate_entry entries[NUMA_MIGRATE_BATCH_MAX];
+};
+
+static struct numa_migrate_queue **numa_migrate_queues __read_mostly;
+
+/*
+ * Skip the pages that cannot be migrated without blocking and unmap the
+ * rest without flushing the TLB.  Returns false if @e should go back to
+ * the LRU.
+ */
+static bool numa_migrate_unmap(struct numa_migrate_entry *e, int node)
+{
+	struct page *page = e->page;
+
+	e->anon_vma = NULL;
+	e->mapped = false;
+
+	e->newpage = alloc_misplaced_dst_page(page, node);
+	if (!e->newpage)
+		return false;
+
+	if (!trylock_page(page))
+		goto put_new;
+
+	if (PageWriteback(page) || !page->mapping)
+		goto unlock;
+
+	if (PageAnon(page) && !PageKsm(page))
+		e->anon_vma = page_get_anon_vma(page);
+
+	if (unlikely(!trylock_page(e->newpage)))
+		goto put_anon;
+
+	if (page_mapped(page)) {
+		try_to_migrate(page, TTU_BATCH_FLUSH);
+		e->mapped = true;
+	}
+	return true;
+
+put_anon:
+	if (e->anon_vma)
+		put_anon_vma(e->anon_vma);
+unlock:
+	unlock_page(page);
+put_new:
+	put_page(e->newpage);
+	return false;
+}
+
+static void numa_migrate_dec_isolated(struct page *page)
+{
+	mod_node_page_state(page_pgdat(page), NR_ISOLATED_ANON +
+			    page_is_file_lru(page), -thp_nr_pages(page));
+}
+
+static void numa_migrate_putback(struct page *page)
+{
+	numa_migrate_dec_isolated(page);
+	putback_lru_page(page);
+}
+
+/*
+ * Migrate an array of isolated base pages to @node.  Called with at most
+ * NUMA_MIGRATE_BATCH_MAX entries.
+ */
+static void numa_migrate_batch(struct numa_migrate_entry *entries, int nr,
+			       int node)
+{
+	unsigned int nr_succeeded = 0, nr_failed = 0, nr_promoted = 0;
+	int i;
+
+	for (i = 0; i < nr; i++) {
+		struct page *page = entries[i].page;
+
+		if (page_count(page) == 1) {
+			/* page was freed from under us */
+			ClearPageActive(page);
+			ClearPageUnevictable(page);
+			numa_migrate_dec_isolated(page);
+			put_page(page);
+			entries[i].page = NULL;
+			continue;
+		}
+
+		if (!numa_migrate_unmap(&entries[i], node)) {
+			numa_migrate_putback(page);
+			entries[i].page = NULL;
+			nr_failed++;
+		}
+	}
+
+	/* One flush for every PTE cleared above */
+	try_to_unmap_flush();
+
+	for (i = 0; i < nr; i++) {
+		struct numa_migrate_entry *e = &entries[i];
+		struct page *page = e->page;
+		int rc = -EAGAIN;
+		int page_nid;
+
+		if (!page)
+			continue;
+
+		page_nid = page_to_nid(page);
+		if (!page_mapped(page))
+			rc = move_to_new_page(e->newpage, page, MIGRATE_ASYNC);
+
+		if (e->mapped)
+			remove_migration_ptes(page, rc == MIGRATEPAGE_SUCCESS ?
+					      e->newpage : page, false);
+
+		unlock_page(e->newpage);
+		if (e->anon_vma)
+			put_anon_vma(e->anon_vma);
+		unlock_page(page);
+
+		if (rc == MIGRATEPAGE_SUCCESS) {
+			set_page_owner_migrate_reason(e->newpage,
+						      MR_NUMA_MISPLACED);
+			putback_lru_page(e->newpage);
+			numa_migrate_dec_isolated(page);
+			put_page(page);
+			nr_succeeded++;
+			if (!node_is_toptier(page_nid) && node_is_toptier(node))
+				nr_promoted++;
+		} else {
+			put_page(e->newpage);
+			numa_migrate_putback(page);
+			nr_failed++;
+		}
+	}
+
+	count_vm_events(PGMIGRATE_SUCCESS, nr_succeeded);
+	count_vm_events(PGMIGRATE_FAIL, nr_failed);
+	count_vm_numa_events(NUMA_PAGE_MIGRATE, nr_succeeded);
+	if (nr_promoted)
+		mod_node_page_state(NODE_DATA(node), PGPROMOTE_SUCCESS,
+				    nr_promoted);
+}
+
+static void numa_migrate_work_fn(struct work_struct *work)
+{
+	struct numa_migrate_queue *q = container_of(to_delayed_work(work),
+					struct numa_migrate_queue, work);
+	struct page *page, *next;
+	LIST_HEAD(pages);
+	int nr = 0;
+
+	spin_lock(&q->lock);
+	list_splice_init(&q->pages, &pages);
+	q->nr = 0;
+	spin_unlock(&q->lock);
+
+	list_for_each_entry_safe(page, next, &pages, lru) {
+		list_del(&page->lru);
+		q->entries[nr++].page = page;
+		if (nr == NUMA_MIGRATE_BATCH_MAX) {
+			numa_migrate_batch(q->entries, nr, q->nid);
+			nr = 0;
+			cond_resched();
+		}
+	}
+	if (nr)
+		numa_migrate_batch(q->entries, nr, q->nid);
+}
+
+/* Called with q->lock held */
+static bool numa_migrate_budget_exceeded(struct numa_migrate_queue *q,
+					 int nr_pages)
+{
+	unsigned long limit = (unsigned long)
+		sysctl_numa_balancing_promote_rate_limit << (20 - PAGE_SHIFT);
+
+	if (time_after(jiffies, q->rl_start + HZ)) {
+		q->rl_start = jiffies;
+		q->rl_nr = 0;
+	}
+	if (q->rl_nr + nr_pages > limit)
+		return true;
+	q->rl_nr += nr_pages;
+	return false;
+}
+
+/*
+ * Queue an isolated @page for the batched migration to @node.  Returns
+ * false if the page was not queued; it is then still isolated and the
+ * caller has to handle it.
+ */
+static bool numa_migrate_queue_page(struct page *page, int node,
+				    unsigned int batch)
+{
+	struct numa_migrate_queue *q = numa_migrate_queues[node];
+	bool kick;
+
+	spin_lock(&q->lock);
+	if (numa_migrate_budget_exceeded(q, 1)) {
+		spin_unlock(&q->lock);
+		return false;
+	}
+	list_add_tail(&page->lru, &q->pages);
+	kick = ++q->nr >= batch;
+	spin_unlock(&q->lock);
+
+	if (kick)
+		mod_delayed_work(system_unbound_wq, &q->work, 0);
+	else
+		queue_delayed_work(system_unbound_wq, &q->work,
+				   NUMA_MIGRATE_FLUSH_DELAY);
+	return true;
+}
+
+static int __init numa_migrate_queue_init(void)
+{
+	int nid;
+
+	numa_migrate_queues = kcalloc(nr_node_ids, sizeof(*numa_migrate_queues),
+				      GFP_KERNEL);
+	if (!numa_migrate_queues)
+		return -ENOMEM;
+
+	for_each_node(nid) {
+		struct numa_migrate_queue *q;
+
+		q = kzalloc_node(sizeof(*q), GFP_KERNEL, nid);
+		if (!q)
+			continue;
+		spin_lock_init(&q->lock);
+		INIT_LIST_HEAD(&q->pages);
+		q->nid = nid;
+		q->rl_start = jiffies;
+		INIT_DELAYED_WORK(&q->work, numa_migrate_work_fn);
+		numa_migrate_queues[nid] = q;
+	}
+	return 0;
+}
+subsys_initcall(numa_migrate_queue_init);
+
 /*
  * Attempt to migrate a misplaced page to the specified destination
  * node. Caller is expected to have an elevated reference count on
  * the page that will be dropped by this function before returning.
+ *
+ * Returns NUMA_MIGRATE_QUEUED if the page was queued for the batched
+ * migration instead; it is still mapped at its old location then.
  */
 /*
  * IAMROOT, 2023.06.24:
@@ -2530,6 +2879,8 @@ int migrate_misplaced_page(struct page *page, struct vm_area_struct *vma,
 	new_page_t *new;
 	bool compound;
 	int nr_pages = thp_nr_pages(page);
+	int page_nid = page_to_nid(page);
+	unsigned int batch;
 
 	/*
 	 * PTE mapped THP or HugeTLB page can't reach here so the page could
@@ -2584,6 +2935,16 @@ int migrate_misplaced_page(struct page *page, struct vm_area_struct *vma,
 	if (!isolated)
 		goto out;
 
+	batch = READ_ONCE(sysctl_numa_balancing_migrate_batch);
+	if (batch > 1 && !compound && numa_migrate_queues &&
+	    numa_migrate_queues[node]) {
+		if (numa_migrate_queue_page(page, node, batch))
+			return NUMA_MIGRATE_QUEUED;
+		/* Over the migration budget of @node, leave the page alone */
+		numa_migrate_putback(page);
+		return 0;
+	}
+
 	list_add(&page->lru, &migratepages);
 	nr_remaining = migrate_pages(&migratepages, *new, NULL, node,
 				     MIGRATE_ASYNC, MR_NUMA_MISPLACED, NULL);
@@ -2600,8 +2961,12 @@ int migrate_misplaced_page(struct page *page, struct vm_area_struct *vma,
 			putback_lru_page(page);
 		}
 		isolated = 0;
-	} else
+	} else {
 		count_vm_numa_events(NUMA_PAGE_MIGRATE, nr_pages);
+		if (!node_is_toptier(page_nid) && node_is_toptier(node))
+			mod_node_page_state(pgdat, PGPROMOTE_SUCCESS,
+					    nr_pages);
+	}
 	BUG_ON(!list_empty(&migratepages));
 	return isolated;
 
@@ -3475,10 +3840,16 @@ EXPORT_SYMBOL(migrate_vma_finalize);
 /* Disable reclaim-based migration. */
 static void __disable_all_migrate_targets(void)
 {
-	int node;
+	int node, i;
 
-	for_each_online_node(node)
-		node_demotion[node] = NUMA_NO_NODE;
+	if (!node_demotion)
+		return;
+
+	for_each_online_node(node) {
+		node_demotion[node].nr = 0;
+		for (i = 0; i < DEMOTION_TARGET_NODES; i++)
+			node_demotion[node].nodes[i] = NUMA_NO_NODE;
+	}
 }
 
 static void disable_all_migrate_targets(void)
@@ -3505,28 +3876,50 @@ static void disable_all_migrate_targets(void)
  * Failing here is OK.  It might just indicate
  * being at the end of a chain.
  */
-static int establish_migrate_target(int node, nodemask_t *used)
+static int establish_migrate_target(int node, nodemask_t *used,
+				    int best_distance)
 {
-	int migration_target;
+	int migration_target, index, val;
+	struct demotion_nodes *nd;
 
-	/*
-	 * Can not set a migration target on a
-	 * node with it already set.
-	 *
-	 * No need for READ_ONCE() here since this
-	 * in the write path for node_demotion[].
-	 * This should be the only thread writing.
-	 */
-	if (node_demotion[node] != NUMA_NO_NODE)
+	if (!node_demotion)
 		return NUMA_NO_NODE;
 
+	nd = &node_demotion[node];
+
 	migration_target = find_next_best_node(node, used);
 	if (migration_target == NUMA_NO_NODE)
 		return NUMA_NO_NODE;
 
-	node_demotion[node] = migration_target;
+	/*
+	 * If the node has been set a migration target node before,
+	 * which means it's the best distance between them. Still
+	 * check if this node can be demoted to other target nodes
+	 * if they have a same best distance.
+	 */
+	if (best_distance != -1) {
+		val = node_distance(node, migration_target);
+		if (val > best_distance)
+			goto out_clear;
+	}
+
+	index = nd->nr;
+	if (WARN_ONCE(index >= DEMOTION_TARGET_NODES,
+		      "Exceeds maximum demotion target nodes\n"))
+		goto out_clear;
+
+	/*
+	 * No need for READ_ONCE() here since this
+	 * in the write path for node_demotion[].
+	 * This should be the only thread writing.
+	 */
+	nd->nodes[index] = migration_target;
+	nd->nr++;
 
 	return migration_target;
+out_clear:
+	node_clear(migration_target, *used);
+	return NUMA_NO_NODE;
 }
 
 /*
@@ -3552,7 +3945,7 @@ static void __set_migration_target_nodes(void)
 	nodemask_t next_pass	= NODE_MASK_NONE;
 	nodemask_t this_pass	= NODE_MASK_NONE;
 	nodemask_t used_targets = NODE_MASK_NONE;
-	int node;
+	int node, best_distance;
 
 	/*
 	 * Avoid any oddities like cycles that could occur
@@ -3564,8 +3957,14 @@ static void __set_migration_target_nodes(void)
 	/*
 	 * Allocations go close to CPUs, first.  Assume that
 	 * the migration path starts at the nodes with CPUs.
+	 * Once some memory is known to be a lower tier, all
+	 * other memory starts the path so that DRAM is never
+	 * demoted to DRAM.
 	 */
 	next_pass = node_states[N_CPU];
+	if (!nodes_empty(node_states[N_SLOW_MEMORY]))
+		nodes_andnot(next_pass, node_states[N_MEMORY],
+			     node_states[N_SLOW_MEMORY]);
 again:
 	this_pass = next_pass;
 	next_pass = NODE_MASK_NONE;
@@ -3582,17 +3981,31 @@ static void __set_migration_target_nodes(void)
 	 */
 	nodes_or(used_targets, used_targets, this_pass);
 	for_each_node_mask(node, this_pass) {
-		int target_node = establish_migrate_target(node, &used_targets);
-
-		if (target_node == NUMA_NO_NODE)
-			continue;
+		best_distance = -1;
 
 		/*
-		 * Visit targets from this pass in the next pass.
-		 * Eventually, every node will have been part of
-		 * a pass, and will become set in 'used_targets'.
+		 * Try to set up the migration path for the node, and the target
+		 * migration nodes can be multiple, so doing a loop to find all
+		 * the target nodes if they all have a best node distance.
 		 */
-		node_set(target_node, next_pass);
+		do {
+			int target_node =
+				establish_migrate_target(node, &used_targets,
+							 best_distance);
+
+			if (target_node == NUMA_NO_NODE)
+				break;
+
+			if (best_distance == -1)
+				best_distance = node_distance(node, target_node);
+
+			/*
+			 * Visit targets from this pass in the next pass.
+			 * Eventually, every node will have been part of
+			 * a pass, and will become set in 'used_targets'.
+			 */
+			node_set(target_node, next_pass);
+		} while (1);
 	}
 	/*
 	 * 'next_pass' contains nodes which became migration
@@ -3693,6 +4106,10 @@ static int __init migrate_on_reclaim_init(void)
 {
 	int ret;
 
+	node_demotion = kcalloc(nr_node_ids, sizeof(struct demotion_nodes),
+				GFP_KERNEL);
+	WARN_ON(!node_demotion);
+
 	ret = cpuhp_setup_state_nocalls(CPUHP_MM_DEMOTION_DEAD, "mm/demotion:offline",
 					NULL, migration_offline_cpu);
 	/*
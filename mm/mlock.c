@@ -545,6 +545,7 @@ static int mlock_fixup(struct vm_area_struct *vma, struct vm_area_struct **prev,
 	 * It's okay if try_to_unmap_one unmaps a page just after we
 	 * set VM_LOCKED, populate_vma_page_range will bring it back.
 	 */
+	vma_start_write(vma);
 
 	if (lock)
 		vma->vm_flags = newflags;
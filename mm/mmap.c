@@ -732,6 +732,31 @@ static unsigned long count_vma_pages_range(struct mm_struct *mm,
 	return nr_pages;
 }
 
+#ifdef CONFIG_PER_VMA_LOCK
+/*
+ * mm->mm_mt mirrors mm_rb for lock_vma_under_rcu().  A VMA that stayed in
+ * it after being freed would be found by RCU readers, so the tree must
+ * never miss an update: its nodes are allocated with __GFP_NOFAIL.
+ */
+static void vma_mt_store(struct mm_struct *mm, struct vm_area_struct *vma)
+{
+	WARN_ON_ONCE(mtree_insert_range(&mm->mm_mt, vma->vm_start,
+					vma->vm_end - 1, vma,
+					GFP_KERNEL | __GFP_NOFAIL));
+}
+
+static void vma_mt_erase(struct mm_struct *mm, struct vm_area_struct *vma)
+{
+	if (!WARN_ON_ONCE(mtree_load(&mm->mm_mt, vma->vm_start) != vma))
+		mtree_erase(&mm->mm_mt, vma->vm_start);
+}
+#else
+static inline void vma_mt_store(struct mm_struct *mm,
+				struct vm_area_struct *vma) { }
+static inline void vma_mt_erase(struct mm_struct *mm,
+				struct vm_area_struct *vma) { }
+#endif
+
 /*
  * IAMROOT, 2023.04.01:
  * @rb_link out. 새로 추가된 leaf node의 위치.
@@ -740,6 +765,12 @@ static unsigned long count_vma_pages_range(struct mm_struct *mm,
 void __vma_link_rb(struct mm_struct *mm, struct vm_area_struct *vma,
 		struct rb_node **rb_link, struct rb_node *rb_parent)
 {
+	/*
+	 * The caller may still be setting the new VMA up after linking it,
+	 * keep per-VMA lock faults away until mmap_lock is released.
+	 */
+	vma_start_write(vma);
+
 	/* Update tracking information for the gap following the new vma. */
 	if (vma->vm_next)
 		vma_gap_update(vma->vm_next);
@@ -759,6 +790,7 @@ void __vma_link_rb(struct mm_struct *mm, struct vm_area_struct *vma,
 	vma->rb_subtree_gap = 0;
 	vma_gap_update(vma);
 	vma_rb_insert(vma, &mm->mm_rb);
+	vma_mt_store(mm, vma);
 }
 
 static void __vma_link_file(struct vm_area_struct *vma)
@@ -846,7 +878,9 @@ static __always_inline void __vma_unlink(struct mm_struct *mm,
 						struct vm_area_struct *vma,
 						struct vm_area_struct *ignore)
 {
+	vma_mark_detached(vma, true);
 	vma_rb_erase_ignore(vma, &mm->mm_rb, ignore);
+	vma_mt_erase(mm, vma);
 	__vma_unlink_list(mm, vma);
 	/* Kill the cache */
 	vmacache_invalidate(mm);
@@ -882,9 +916,14 @@ int __vma_adjust(struct vm_area_struct *vma, unsigned long start,
 	struct anon_vma *anon_vma = NULL;
 	struct file *file = vma->vm_file;
 	bool start_changed = false, end_changed = false;
+	bool mt_moved;
 	long adjust_next = 0;
 	int remove_next = 0;
 
+	vma_start_write(vma);
+	if (next)
+		vma_start_write(next);
+
 /*
  * IAMROOT, 2022.05.28:
  * - adjust 시작 vma의 next가 존재
@@ -1113,6 +1152,16 @@ int __vma_adjust(struct vm_area_struct *vma, unsigned long start,
 			anon_vma_interval_tree_pre_update_vma(next);
 	}
 
+	/*
+	 * Take the VMAs whose range changes out of mm_mt first, they are
+	 * stored back once the neighbours they grow into are gone.
+	 */
+	mt_moved = start != vma->vm_start || end != vma->vm_end;
+	if (mt_moved)
+		vma_mt_erase(mm, vma);
+	if (adjust_next)
+		vma_mt_erase(mm, next);
+
 	if (file) {
 		flush_dcache_mmap_lock(mapping);
 		vma_interval_tree_remove(vma, root);
@@ -1204,6 +1253,11 @@ int __vma_adjust(struct vm_area_struct *vma, unsigned long start,
  *   즉 조정을 위해 vma의 avc들을 av의 avc rbtree에서 제거해 놓은 상태이고, 조정이
  *   끝낫으므로 원래 연결되있던 av rbtree에 넣어놓는것이다.
  */
+	if (mt_moved)
+		vma_mt_store(mm, vma);
+	if (adjust_next)
+		vma_mt_store(mm, next);
+
 	if (anon_vma) {
 		anon_vma_interval_tree_post_update_vma(vma);
 		if (adjust_next)
@@ -3161,6 +3215,7 @@ int expand_upwards(struct vm_area_struct *vma, unsigned long address)
 				 * So, we reuse mm->page_table_lock to guard
 				 * against concurrent vma expansions.
 				 */
+				vma_mt_erase(mm, vma);
 				spin_lock(&mm->page_table_lock);
 				if (vma->vm_flags & VM_LOCKED)
 					mm->locked_vm += grow;
@@ -3173,6 +3228,7 @@ int expand_upwards(struct vm_area_struct *vma, unsigned long address)
 				else
 					mm->highest_vm_end = vm_end_gap(vma);
 				spin_unlock(&mm->page_table_lock);
+				vma_mt_store(mm, vma);
 
 				perf_event_mmap(vma);
 			}
@@ -3241,6 +3297,7 @@ int expand_downwards(struct vm_area_struct *vma,
 				 * So, we reuse mm->page_table_lock to guard
 				 * against concurrent vma expansions.
 				 */
+				vma_mt_erase(mm, vma);
 				spin_lock(&mm->page_table_lock);
 				if (vma->vm_flags & VM_LOCKED)
 					mm->locked_vm += grow;
@@ -3251,6 +3308,7 @@ int expand_downwards(struct vm_area_struct *vma,
 				anon_vma_interval_tree_post_update_vma(vma);
 				vma_gap_update(vma);
 				spin_unlock(&mm->page_table_lock);
+				vma_mt_store(mm, vma);
 
 				perf_event_mmap(vma);
 			}
@@ -3394,7 +3452,9 @@ detach_vmas_to_be_unmapped(struct mm_struct *mm, struct vm_area_struct *vma,
 	insertion_point = (prev ? &prev->vm_next : &mm->mmap);
 	vma->vm_prev = NULL;
 	do {
+		vma_mark_detached(vma, true);
 		vma_rb_erase(vma, &mm->mm_rb);
+		vma_mt_erase(mm, vma);
 		mm->map_count--;
 		tail_vma = vma;
 		vma = vma->vm_next;
@@ -3962,6 +4022,7 @@ void exit_mmap(struct mm_struct *mm)
 		 * which clears VM_LOCKED, otherwise the oom reaper cannot
 		 * reliably test it.
 		 */
+		(void)unmap_anon_vmas_mt(mm, true);
 		(void)__oom_reap_task_mm(mm);
 
 		set_bit(MMF_OOM_SKIP, &mm->flags);
@@ -3980,6 +4041,11 @@ void exit_mmap(struct mm_struct *mm)
 
 	lru_add_drain();
 	flush_cache_mm(mm);
+	/*
+	 * Zap the bulk of a huge address space with helpers first, so that
+	 * unmap_vmas() below finds little more than empty page tables.
+	 */
+	unmap_anon_vmas_mt(mm, false);
 	tlb_gather_mmu_fullmm(&tlb, mm);
 	/* update_hiwater_rss(mm) here? but nobody should be looking */
 	/* Use -1 here to ensure all VMAs in the mm are unmapped */
@@ -3998,6 +4064,9 @@ void exit_mmap(struct mm_struct *mm)
 		cond_resched();
 	}
 	vm_unacct_memory(nr_accounted);
+#ifdef CONFIG_PER_VMA_LOCK
+	mtree_destroy(&mm->mm_mt);
+#endif
 }
 
 /* Insert vm structure into process list sorted by address
@@ -16,6 +16,7 @@
 EXPORT_TRACEPOINT_SYMBOL(mmap_lock_start_locking);
 EXPORT_TRACEPOINT_SYMBOL(mmap_lock_acquire_returned);
 EXPORT_TRACEPOINT_SYMBOL(mmap_lock_released);
+EXPORT_TRACEPOINT_SYMBOL(mmap_lock_vma_fallback);
 
 #ifdef CONFIG_MEMCG
 
@@ -243,4 +244,11 @@ void __mmap_lock_do_trace_released(struct mm_struct *mm, bool write)
 	TRACE_MMAP_LOCK_EVENT(released, mm, write);
 }
 EXPORT_SYMBOL(__mmap_lock_do_trace_released);
+
+void __mmap_lock_do_trace_vma_fallback(struct mm_struct *mm,
+				       unsigned long address, int reason)
+{
+	TRACE_MMAP_LOCK_EVENT(vma_fallback, mm, address, reason);
+}
+EXPORT_SYMBOL(__mmap_lock_do_trace_vma_fallback);
 #endif /* CONFIG_TRACING */
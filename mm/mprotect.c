@@ -28,9 +28,12 @@
 #include <linux/ksm.h>
 #include <linux/uaccess.h>
 #include <linux/mm_inline.h>
+#include <linux/node.h>
 #include <linux/pgtable.h>
+#include <linux/sched/sysctl.h>
 #include <asm/cacheflush.h>
 #include <asm/mmu_context.h>
+#include <asm/pgalloc.h>
 #include <asm/tlbflush.h>
 
 #include "internal.h"
@@ -129,6 +132,7 @@ static unsigned long change_pte_range(struct vm_area_struct *vma, pmd_t *pmd,
  */
 			if (prot_numa) {
 				struct page *page;
+				int nid;
 
 				/* Avoid TLB flush if possible */
 /*
@@ -182,7 +186,16 @@ static unsigned long change_pte_range(struct vm_area_struct *vma, pmd_t *pmd,
  *   건드리지 마십시오.
  * - single task이면 this node에 이미 있는경우 옮길 필요없으므로 skip 
  */
-				if (target_node == page_to_nid(page))
+				nid = page_to_nid(page);
+				if (target_node == nid)
+					continue;
+
+				/*
+				 * Skip scanning top tier node if normal numa
+				 * balancing is disabled
+				 */
+				if (!(sysctl_numa_balancing_mode & NUMA_BALANCING_NORMAL) &&
+				    node_is_toptier(nid))
 					continue;
 			}
 
@@ -389,6 +402,13 @@ static inline unsigned long change_pmd_range(struct vm_area_struct *vma,
 			}
 			/* fall through, the trans huge pmd just split */
 		}
+		if (unlikely(pte_table_shared(pmd))) {
+			/* NUMA hinting can wait until the table is unshared */
+			if (cp_flags & MM_CP_PROT_NUMA)
+				goto next;
+			unshare_pte_table(vma, pmd, addr,
+					  GFP_PGTABLE_USER | __GFP_NOFAIL);
+		}
 		this_pages = change_pte_range(vma, pmd, addr, next, newprot,
 					      cp_flags);
 		pages += this_pages;
@@ -617,8 +637,9 @@ mprotect_fixup(struct vm_area_struct *vma, struct vm_area_struct **pprev,
 success:
 	/*
 	 * vm_flags and vm_page_prot are protected by the mmap_lock
-	 * held in write mode.
+	 * held in write mode and by the VMA write lock.
 	 */
+	vma_start_write(vma);
 	vma->vm_flags = newflags;
 	dirty_accountable = vma_wants_writenotify(vma, vma->vm_page_prot);
 	vma_set_page_prot(vma);
@@ -548,6 +548,10 @@ unsigned long move_page_tables(struct vm_area_struct *vma,
 				continue;
 		}
 
+		/* move_ptes() would take the entries away from other mms */
+		if (unlikely(pte_table_shared(old_pmd)) &&
+		    unshare_pte_table(vma, old_pmd, old_addr, GFP_PGTABLE_USER))
+			break;
 		if (pte_alloc(new_vma->vm_mm, new_pmd))
 			break;
 		move_ptes(vma, old_pmd, old_addr, old_addr + extent, new_vma,
@@ -583,6 +587,9 @@ static unsigned long move_vma(struct vm_area_struct *vma,
 	if (mm->map_count >= sysctl_max_map_count - 3)
 		return -ENOMEM;
 
+	/* Page tables are about to move out from under the VMA. */
+	vma_start_write(vma);
+
 	if (vma->vm_ops && vma->vm_ops->may_split) {
 		if (vma->vm_start != old_addr)
 			err = vma->vm_ops->may_split(vma, old_addr);
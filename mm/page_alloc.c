@@ -208,6 +208,14 @@ unsigned long totalcma_pages __read_mostly;
  */
 int percpu_pagelist_high_fraction;
 
+/*
+ * When set, pcp->high of each CPU floats between the static value computed by
+ * zone_highsize() and PCP_HIGH_ADAPTIVE_SCALE times that value depending on
+ * how often the CPU ping-pongs pages between its pcp lists and the buddy.
+ */
+int percpu_pagelist_high_adaptive;
+#define PCP_HIGH_ADAPTIVE_SCALE	8
+
 /*
  * IAMROOT, 2022.06.18:
  * - boot중에는 reclaim이 제외된채지만. booting이 끝나면 정상적으로 변경된다.
@@ -1259,6 +1267,7 @@ static inline void add_to_free_list(struct page *page, struct zone *zone,
 
 	list_add(&page->lru, &area->free_list[migratetype]);
 	area->nr_free++;
+	zone_pageblock_free_mod(zone, page, order, 1);
 }
 
 /* Used for pages not on another list */
@@ -1269,6 +1278,7 @@ static inline void add_to_free_list_tail(struct page *page, struct zone *zone,
 
 	list_add_tail(&page->lru, &area->free_list[migratetype]);
 	area->nr_free++;
+	zone_pageblock_free_mod(zone, page, order, 1);
 }
 
 /*
@@ -1309,6 +1319,7 @@ static inline void del_page_from_free_list(struct page *page, struct zone *zone,
 	__ClearPageBuddy(page);
 	set_page_private(page, 0);
 	zone->free_area[order].nr_free--;
+	zone_pageblock_free_mod(zone, page, order, -1);
 }
 
 /*
@@ -1879,6 +1890,132 @@ static inline void prefetch_buddy(struct page *page)
 	prefetch(buddy);
 }
 
+/*
+ * Number of lock-sharded order-0 free page caches per zone, see the
+ * zone_shards= boot parameter. Zero disables sharding and every pcp refill
+ * and drain is served by the buddy lists under zone->lock.
+ */
+static int nr_zone_shards __read_mostly;
+
+static int __init cmdline_parse_zone_shards(char *p)
+{
+	int nr;
+
+	if (kstrtoint(p, 0, &nr) || nr < 0)
+		return -EINVAL;
+
+	nr_zone_shards = min(nr, MAX_ZONE_SHARDS);
+	return 0;
+}
+early_param("zone_shards", cmdline_parse_zone_shards);
+
+/* CPUs are steered to a fixed shard so their pages stay cache and lock local */
+static inline struct zone_shard *zone_cpu_shard(struct zone *zone)
+{
+	return &zone->shards[raw_smp_processor_id() % zone->nr_shards];
+}
+
+/*
+ * Park order-0 pages from @head on this CPU's shard instead of freeing them
+ * to the buddy lists. Pages that do not fit, or are not order-0, are left on
+ * @head. The pages on @head have the order encoded in the migratetype, see
+ * free_pcppages_bulk(). Called with pagesets.lock held.
+ */
+static void zone_shard_free(struct zone *zone, struct list_head *head)
+{
+	struct zone_shard *shard = zone_cpu_shard(zone);
+	int high = READ_ONCE(shard->high);
+	struct page *page, *tmp;
+
+	if (READ_ONCE(shard->count) >= high)
+		return;
+
+	spin_lock(&shard->lock);
+	list_for_each_entry_safe(page, tmp, head, lru) {
+		int mt = get_pcppage_migratetype(page);
+		int list_mt;
+
+		if (shard->count >= high)
+			break;
+
+		if (mt & NR_PCP_ORDER_MASK)
+			continue;
+
+		mt >>= NR_PCP_ORDER_WIDTH;
+		set_pcppage_migratetype(page, mt);
+
+		/* Same list selection as free_unref_page() */
+		list_mt = mt < MIGRATE_PCPTYPES ? mt : MIGRATE_MOVABLE;
+		list_move(&page->lru, &shard->lists[list_mt]);
+		shard->count++;
+	}
+	spin_unlock(&shard->lock);
+}
+
+/*
+ * Move up to @count order-0 pages of @migratetype from this CPU's shard to
+ * @list. Returns the number of pages moved. Called with pagesets.lock held.
+ */
+static int zone_shard_refill(struct zone *zone, int count,
+			     struct list_head *list, int migratetype)
+{
+	struct zone_shard *shard = zone_cpu_shard(zone);
+	struct page *page, *tmp;
+	int moved = 0;
+
+	if (!READ_ONCE(shard->count))
+		return 0;
+
+	spin_lock(&shard->lock);
+	list_for_each_entry_safe(page, tmp, &shard->lists[migratetype], lru) {
+		if (moved == count)
+			break;
+		list_move_tail(&page->lru, list);
+		moved++;
+	}
+	shard->count -= moved;
+	spin_unlock(&shard->lock);
+
+	return moved;
+}
+
+/* Return all pages parked on the shards of @zone to the buddy lists. */
+static void drain_zone_shards(struct zone *zone)
+{
+	struct page *page, *tmp;
+	unsigned long flags;
+	int i, mt;
+
+	for (i = 0; i < zone->nr_shards; i++) {
+		struct zone_shard *shard = &zone->shards[i];
+		bool isolated_pageblocks;
+		LIST_HEAD(head);
+
+		if (!READ_ONCE(shard->count))
+			continue;
+
+		spin_lock_irqsave(&shard->lock, flags);
+		for (mt = 0; mt < MIGRATE_PCPTYPES; mt++)
+			list_splice_init(&shard->lists[mt], &head);
+		shard->count = 0;
+		spin_unlock_irqrestore(&shard->lock, flags);
+
+		spin_lock_irqsave(&zone->lock, flags);
+		isolated_pageblocks = has_isolate_pageblock(zone);
+		list_for_each_entry_safe(page, tmp, &head, lru) {
+			mt = get_pcppage_migratetype(page);
+			/* Pageblock could have been isolated meanwhile */
+			if (unlikely(isolated_pageblocks))
+				mt = get_pageblock_migratetype(page);
+
+			__free_one_page(page, page_to_pfn(page), zone, 0, mt,
+					FPI_NONE);
+			trace_mm_page_pcpu_drain(page, 0, mt);
+		}
+		spin_unlock_irqrestore(&zone->lock, flags);
+	}
+}
+
 /*
  * Frees a number of pages from the PCP lists
  * Assumes all pages on list are in same zone, and of same order.
@@ -1983,6 +2120,19 @@ static void free_pcppages_bulk(struct zone *zone, int count,
 	}
 	pcp->count -= nr_freed;
 
+	/*
+	 * With zone shards, order-0 pages are parked on this CPU's shard and
+	 * only the overflow takes zone->lock. Boot and disabled pagesets must
+	 * not cache pages, and pageblock isolation relies on drain_all_pages()
+	 * which also empties the shards, so bypass them in those cases.
+	 */
+	if (zone->nr_shards && READ_ONCE(pcp->batch) > 1 &&
+	    !has_isolate_pageblock(zone)) {
+		zone_shard_free(zone, &head);
+		if (list_empty(&head))
+			return;
+	}
+
 	/*
 	 * local_lock_irq held so equivalent to spin_lock_irqsave for
 	 * both PREEMPT_RT and non-PREEMPT_RT configurations.
@@ -4035,6 +4185,14 @@ static int rmqueue_bulk(struct zone *zone, unsigned int order,
 {
 	int i, allocated = 0;
 
+	/* Order-0 refills are served by this CPU's shard first */
+	if (zone->nr_shards && !order) {
+		allocated = zone_shard_refill(zone, count, list, migratetype);
+		if (allocated == count)
+			return allocated;
+		count -= allocated;
+	}
+
 	/*
 	 * local_lock_irq held so equivalent to spin_lock_irqsave for
 	 * both PREEMPT_RT and non-PREEMPT_RT configurations.
@@ -4119,6 +4277,42 @@ void drain_zone_pages(struct zone *zone, struct per_cpu_pages *pcp)
 }
 #endif
 
+/*
+ * Called from the vmstat counter updater to shrink an adaptively grown
+ * pcp->high back towards pcp->high_min once the CPU stopped refilling from
+ * the buddy, returning the pages cached above the new high. Returns true while
+ * pcp->high is still above its floor so the updater keeps running.
+ *
+ * Note that this function must be called with the thread pinned to
+ * a single processor.
+ */
+bool decay_pcp_high(struct zone *zone, struct per_cpu_pages *pcp)
+{
+	unsigned long flags;
+	int high, high_min, to_drain;
+
+	high = READ_ONCE(pcp->high);
+	high_min = READ_ONCE(pcp->high_min);
+	if (high <= high_min)
+		return false;
+
+	local_lock_irqsave(&pagesets.lock, flags);
+	if (pcp->flags & PCPF_ACTIVE) {
+		pcp->flags &= ~PCPF_ACTIVE;
+	} else {
+		high -= max((high - high_min) >> 2, READ_ONCE(pcp->batch));
+		high = max(high, high_min);
+		WRITE_ONCE(pcp->high, high);
+
+		to_drain = pcp->count - high;
+		if (to_drain > 0)
+			free_pcppages_bulk(zone, to_drain, pcp);
+	}
+	local_unlock_irqrestore(&pagesets.lock, flags);
+
+	return high > high_min;
+}
+
 /*
  * Drain pcplists of the indicated processor and zone.
  *
@@ -4312,6 +4506,15 @@ static void __drain_all_pages(struct zone *zone, bool force_all_cpus)
 	for_each_cpu(cpu, &cpus_with_pcps)
 		flush_work(&per_cpu_ptr(&pcpu_drain, cpu)->work);
 
+	if (zone) {
+		drain_zone_shards(zone);
+	} else {
+		struct zone *z;
+
+		for_each_populated_zone(z)
+			drain_zone_shards(z);
+	}
+
 	mutex_unlock(&pcpu_drain_mutex);
 }
 
@@ -4494,7 +4697,20 @@ static void free_unref_page_commit(struct page *page, unsigned long pfn,
 	if (pcp->count >= high) {
 		int batch = READ_ONCE(pcp->batch);
 
-		free_pcppages_bulk(zone, nr_pcp_free(pcp, high, batch), pcp);
+		/*
+		 * Draining pages that were refilled from the buddy since the
+		 * previous drain means the list is too small for this CPU's
+		 * working set. Grow it by a batch instead of ping-ponging.
+		 */
+		if ((pcp->flags & PCPF_REFILLED) && high == pcp->high &&
+		    high < READ_ONCE(pcp->high_max)) {
+			high = min(high + batch, READ_ONCE(pcp->high_max));
+			WRITE_ONCE(pcp->high, high);
+		}
+		pcp->flags &= ~PCPF_REFILLED;
+
+		if (pcp->count >= high)
+			free_pcppages_bulk(zone, nr_pcp_free(pcp, high, batch), pcp);
 	}
 }
 
@@ -4810,6 +5026,7 @@ struct page *__rmqueue_pcplist(struct zone *zone, unsigned int order,
 					migratetype, alloc_flags);
 
 			pcp->count += alloced << order;
+			pcp->flags |= PCPF_REFILLED | PCPF_ACTIVE;
 			if (unlikely(list_empty(list)))
 				return NULL;
 		}
@@ -7183,8 +7400,32 @@ static inline bool prepare_alloc_pages(gfp_t gfp_mask, unsigned int order,
 }
 
 /*
- * __alloc_pages_bulk - Allocate a number of order-0 pages to a list or array
+ * Number of pages of @order to pull from the buddy lists when a bulk request
+ * finds the pcp list empty. Unlike the single page path, which refills by
+ * pcp->batch, the remaining demand of the bulk request is taken under a
+ * single hold of zone->lock. The refill is capped by pcp->high so that the
+ * IRQ-disabled section stays bounded and any leftover is a normal pcp list.
+ */
+static inline int nr_pcp_bulk_refill(struct per_cpu_pages *pcp,
+				     unsigned int order, int nr_wanted)
+{
+	int batch = READ_ONCE(pcp->batch);
+	int high = READ_ONCE(pcp->high);
+
+	/* Boot pagesets must never store free pages, see __rmqueue_pcplist */
+	if (batch <= 1)
+		return batch;
+
+	batch = max(batch >> order, 2);
+	high = max(high >> order, batch);
+
+	return clamp(nr_wanted, batch, high);
+}
+
+/*
+ * __alloc_pages_bulk_order - Allocate a number of pages of a given order
  * @gfp: GFP flags for the allocation
+ * @order: The order of each page, must be a pcp order
  * @preferred_nid: The preferred NUMA node ID to allocate from
  * @nodemask: Set of nodes to allocate from, may be NULL
  * @nr_pages: The number of pages desired on the list or array
@@ -7195,6 +7436,13 @@ static inline bool prepare_alloc_pages(gfp_t gfp_mask, unsigned int order,
  * allocate nr_pages quickly. Pages are added to page_list if page_list
  * is not NULL, otherwise it is assumed that the page_array is valid.
  *
+ * Orders that are not cached on the pcp lists (see pcp_allowed_order) are
+ * served one page at a time. When the pcp list runs dry part way through
+ * the request, it is refilled with the remaining demand in one go instead
+ * of pcp->batch at a time, so a bulk request takes zone->lock once in the
+ * common case. Callers needing pages of several orders issue one call per
+ * order; each call costs at most a single zone->lock round trip.
+ *
  * For lists, nr_pages is the number of pages that should be allocated.
  *
  * For arrays, only NULL elements are populated with pages and nr_pages
@@ -7209,8 +7457,8 @@ static inline bool prepare_alloc_pages(gfp_t gfp_mask, unsigned int order,
  * @page_list가 인자로 지정된 경우 @page_list에도 추가한다.
  * 그런 후 할당 받은 페이지 수를 반환한다.
  */
-unsigned long __alloc_pages_bulk(gfp_t gfp, int preferred_nid,
-			nodemask_t *nodemask, int nr_pages,
+unsigned long __alloc_pages_bulk_order(gfp_t gfp, unsigned int order,
+			int preferred_nid, nodemask_t *nodemask, int nr_pages,
 			struct list_head *page_list,
 			struct page **page_array)
 {
@@ -7248,6 +7496,10 @@ unsigned long __alloc_pages_bulk(gfp_t gfp, int preferred_nid,
 	if (nr_pages - nr_populated == 1)
 		goto failed;
 
+	/* Orders not cached on the pcp lists gain nothing from batching. */
+	if (!pcp_allowed_order(order))
+		goto failed;
+
 #ifdef CONFIG_PAGE_OWNER
 	/*
 	 * PAGE_OWNER may recurse into the allocator to allocate space to
@@ -7263,10 +7515,18 @@ unsigned long __alloc_pages_bulk(gfp_t gfp, int preferred_nid,
 	/* May set ALLOC_NOFRAGMENT, fragmentation will return 1 page. */
 	gfp &= gfp_allowed_mask;
 	alloc_gfp = gfp;
-	if (!prepare_alloc_pages(gfp, 0, preferred_nid, nodemask, &ac, &alloc_gfp, &alloc_flags))
+	if (!prepare_alloc_pages(gfp, order, preferred_nid, nodemask, &ac, &alloc_gfp, &alloc_flags))
 		goto out;
 	gfp = alloc_gfp;
 
+	/*
+	 * MIGRATE_MOVABLE pcp lists may hold CMA pages which must not be
+	 * handed out when CMA is not allowed, see rmqueue().
+	 */
+	if (IS_ENABLED(CONFIG_CMA) && !(alloc_flags & ALLOC_CMA) &&
+	    ac.migratetype == MIGRATE_MOVABLE)
+		goto failed;
+
 	/* Find an allowed local zone that meets the low watermark. */
 	for_each_zone_zonelist_nodemask(zone, z, ac.zonelist, ac.highest_zoneidx, ac.nodemask) {
 		unsigned long mark;
@@ -7281,8 +7541,9 @@ unsigned long __alloc_pages_bulk(gfp_t gfp, int preferred_nid,
 			goto failed;
 		}
 
-		mark = wmark_pages(zone, alloc_flags & ALLOC_WMARK_MASK) + nr_pages;
-		if (zone_watermark_fast(zone, 0,  mark,
+		mark = wmark_pages(zone, alloc_flags & ALLOC_WMARK_MASK) +
+			((unsigned long)nr_pages << order);
+		if (zone_watermark_fast(zone, order, mark,
 				zonelist_zone_idx(ac.preferred_zoneref),
 				alloc_flags, gfp)) {
 			break;
@@ -7307,7 +7568,7 @@ unsigned long __alloc_pages_bulk(gfp_t gfp, int preferred_nid,
  */
 	local_lock_irqsave(&pagesets.lock, flags);
 	pcp = this_cpu_ptr(zone->per_cpu_pageset);
-	pcp_list = &pcp->lists[order_to_pindex(ac.migratetype, 0)];
+	pcp_list = &pcp->lists[order_to_pindex(ac.migratetype, order)];
 
 	while (nr_populated < nr_pages) {
 
@@ -7317,7 +7578,17 @@ unsigned long __alloc_pages_bulk(gfp_t gfp, int preferred_nid,
 			continue;
 		}
 
-		page = __rmqueue_pcplist(zone, 0, ac.migratetype, alloc_flags,
+		/* Refill for the rest of the request under one zone->lock */
+		if (list_empty(pcp_list)) {
+			int count = nr_pcp_bulk_refill(pcp, order,
+						       nr_pages - nr_populated);
+
+			pcp->count += rmqueue_bulk(zone, order, count, pcp_list,
+					ac.migratetype, alloc_flags) << order;
+			pcp->flags |= PCPF_REFILLED | PCPF_ACTIVE;
+		}
+
+		page = __rmqueue_pcplist(zone, order, ac.migratetype, alloc_flags,
 								pcp, pcp_list);
 		if (unlikely(!page)) {
 			/* Try and get at least one page */
@@ -7327,7 +7598,7 @@ unsigned long __alloc_pages_bulk(gfp_t gfp, int preferred_nid,
 		}
 		nr_account++;
 
-		prep_new_page(page, 0, gfp, 0);
+		prep_new_page(page, order, gfp, 0);
 		if (page_list)
 			list_add(&page->lru, page_list);
 		else
@@ -7337,7 +7608,7 @@ unsigned long __alloc_pages_bulk(gfp_t gfp, int preferred_nid,
 
 	local_unlock_irqrestore(&pagesets.lock, flags);
 
-	__count_zid_vm_events(PGALLOC, zone_idx(zone), nr_account);
+	__count_zid_vm_events(PGALLOC, zone_idx(zone), nr_account << order);
 	zone_statistics(ac.preferred_zoneref->zone, zone, nr_account);
 
 out:
@@ -7351,7 +7622,7 @@ unsigned long __alloc_pages_bulk(gfp_t gfp, int preferred_nid,
  * - 실패했을경우 single page만 slowpath로 할당한다.
  */
 failed:
-	page = __alloc_pages(gfp, 0, preferred_nid, nodemask);
+	page = __alloc_pages(gfp, order, preferred_nid, nodemask);
 	if (page) {
 		if (page_list)
 			list_add(&page->lru, page_list);
@@ -7362,6 +7633,21 @@ unsigned long __alloc_pages_bulk(gfp_t gfp, int preferred_nid,
 
 	goto out;
 }
+EXPORT_SYMBOL_GPL(__alloc_pages_bulk_order);
+
+/*
+ * __alloc_pages_bulk - Allocate a number of order-0 pages to a list or array
+ *
+ * See __alloc_pages_bulk_order().
+ */
+unsigned long __alloc_pages_bulk(gfp_t gfp, int preferred_nid,
+			nodemask_t *nodemask, int nr_pages,
+			struct list_head *page_list,
+			struct page **page_array)
+{
+	return __alloc_pages_bulk_order(gfp, 0, preferred_nid, nodemask,
+					nr_pages, page_list, page_array);
+}
 EXPORT_SYMBOL_GPL(__alloc_pages_bulk);
 
 /*
@@ -8315,6 +8601,11 @@ int find_next_best_node(int node, nodemask_t *used_node_mask)
 		if (!cpumask_empty(cpumask_of_node(n)))
 			val += PENALTY_FOR_NODE_WITH_CPUS;
 
+		/* Keep lower tier memory at the end of the fallback list */
+		if (node_state(n, N_SLOW_MEMORY) &&
+		    !node_state(node, N_SLOW_MEMORY))
+			val += PENALTY_FOR_SLOW_MEMORY;
+
 /*
  * IAMROOT, 2022.02.18:
  * - 1) 적당한 N배를 곱하고 (이전 값들이 더 영향을 많이 받게)
@@ -9298,7 +9589,14 @@ static int zone_highsize(struct zone *zone, int batch, int cpu_online)
 static void pageset_update(struct per_cpu_pages *pcp, unsigned long high,
 		unsigned long batch)
 {
+	unsigned long high_max = high;
+
+	if (percpu_pagelist_high_adaptive)
+		high_max = high * PCP_HIGH_ADAPTIVE_SCALE;
+
 	WRITE_ONCE(pcp->batch, batch);
+	WRITE_ONCE(pcp->high_min, high);
+	WRITE_ONCE(pcp->high_max, high_max);
 	WRITE_ONCE(pcp->high, high);
 }
 
@@ -9323,6 +9621,8 @@ static void per_cpu_pages_init(struct per_cpu_pages *pcp, struct per_cpu_zonesta
 	 * pageset yet.
 	 */
 	pcp->high = BOOT_PAGESET_HIGH;
+	pcp->high_min = BOOT_PAGESET_HIGH;
+	pcp->high_max = BOOT_PAGESET_HIGH;
 	pcp->batch = BOOT_PAGESET_BATCH;
 	pcp->free_factor = 0;
 }
@@ -9344,6 +9644,48 @@ static void __zone_set_pageset_high_and_batch(struct zone *zone, unsigned long h
 	}
 }
 
+/*
+ * Size the zone shards so that together they cache at most 1/1024th of the
+ * zone, but at least a few pcp batches each so drains are absorbed.
+ */
+static void zone_shards_set_high(struct zone *zone, int batch)
+{
+	unsigned long high;
+	int i;
+
+	if (!zone->nr_shards)
+		return;
+
+	high = zone_managed_pages(zone) / 1024 / zone->nr_shards;
+	high = clamp_t(unsigned long, high, batch * 4, INT_MAX);
+
+	for (i = 0; i < zone->nr_shards; i++)
+		WRITE_ONCE(zone->shards[i].high, high);
+}
+
+static void __meminit zone_shards_init(struct zone *zone)
+{
+	struct zone_shard *shards;
+	int i, mt;
+
+	if (!nr_zone_shards || zone->shards)
+		return;
+
+	shards = kcalloc_node(nr_zone_shards, sizeof(*shards), GFP_KERNEL,
+			      zone_to_nid(zone));
+	if (!shards)
+		return;
+
+	for (i = 0; i < nr_zone_shards; i++) {
+		spin_lock_init(&shards[i].lock);
+		for (mt = 0; mt < MIGRATE_PCPTYPES; mt++)
+			INIT_LIST_HEAD(&shards[i].lists[mt]);
+	}
+
+	zone->shards = shards;
+	zone->nr_shards = nr_zone_shards;
+}
+
 /*
  * Calculate and set new high and batch values for all per-cpu pagesets of a
  * zone based on the zone's size.
@@ -9360,6 +9702,8 @@ static void zone_set_pageset_high_and_batch(struct zone *zone, int cpu_online)
 	new_batch = max(1, zone_batchsize(zone));
 	new_high = zone_highsize(zone, new_batch, cpu_online);
 
+	zone_shards_set_high(zone, new_batch);
+
 	if (zone->pageset_high == new_high &&
 	    zone->pageset_batch == new_batch)
 		return;
@@ -9388,6 +9732,7 @@ void __meminit setup_zone_pageset(struct zone *zone)
 		per_cpu_pages_init(pcp, pzstats);
 	}
 
+	zone_shards_init(zone);
 	zone_set_pageset_high_and_batch(zone, 0);
 }
 
@@ -11495,6 +11840,38 @@ int percpu_pagelist_high_fraction_sysctl_handler(struct ctl_table *table,
 	return ret;
 }
 
+/*
+ * percpu_pagelist_high_adaptive - lets pcp->high of each cpu grow beyond the
+ * static value while the cpu keeps draining to and refilling from the buddy
+ * allocator, and decay back once it goes quiet.
+ */
+int percpu_pagelist_high_adaptive_sysctl_handler(struct ctl_table *table,
+		int write, void *buffer, size_t *length, loff_t *ppos)
+{
+	struct zone *zone;
+	int old_percpu_pagelist_high_adaptive;
+	int ret;
+
+	mutex_lock(&pcp_batch_high_lock);
+	old_percpu_pagelist_high_adaptive = percpu_pagelist_high_adaptive;
+
+	ret = proc_dointvec_minmax(table, write, buffer, length, ppos);
+	if (!write || ret < 0)
+		goto out;
+
+	/* No change? */
+	if (percpu_pagelist_high_adaptive == old_percpu_pagelist_high_adaptive)
+		goto out;
+
+	/* Static high and batch are unchanged, only the ceiling moves */
+	for_each_populated_zone(zone)
+		__zone_set_pageset_high_and_batch(zone, zone->pageset_high,
+						  zone->pageset_batch);
+out:
+	mutex_unlock(&pcp_batch_high_lock);
+	return ret;
+}
+
 #ifndef __HAVE_ARCH_RESERVED_KERNEL_PAGES
 /*
  * Returns the number of pages that arch has reserved but
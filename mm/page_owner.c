@@ -98,7 +98,36 @@ static inline struct page_owner *get_page_owner(struct page_ext *page_ext)
 	return (void *)page_ext + page_owner_ops.offset;
 }
 
-static noinline depot_stack_handle_t save_stack(gfp_t flags)
+/*
+ * Each page_owner slot holds a reference on the alloc and free stacks it
+ * points to, so that stacks no page refers to any more are evicted from
+ * the depot.  The references are dropped when a slot is overwritten,
+ * batched over runs of subpages that share a handle.
+ */
+struct stack_put_batch {
+	depot_stack_handle_t handle;
+	unsigned int nr;
+};
+
+static inline void stack_put_batch_add(struct stack_put_batch *batch,
+				       depot_stack_handle_t handle)
+{
+	if (handle != batch->handle) {
+		stack_depot_put(batch->handle, batch->nr);
+		batch->handle = handle;
+		batch->nr = 0;
+	}
+	batch->nr++;
+}
+
+static inline void stack_put_batch_flush(struct stack_put_batch *batch)
+{
+	stack_depot_put(batch->handle, batch->nr);
+}
+
+/* Returns a handle with @nr_refs references, one for each page_owner slot */
+static noinline depot_stack_handle_t save_stack(gfp_t flags,
+						unsigned int nr_refs)
 {
 	unsigned long entries[PAGE_OWNER_STACK_DEPTH];
 	depot_stack_handle_t handle;
@@ -117,9 +146,12 @@ static noinline depot_stack_handle_t save_stack(gfp_t flags)
 	current->in_page_owner = 1;
 
 	nr_entries = stack_trace_save(entries, ARRAY_SIZE(entries), 2);
-	handle = stack_depot_save(entries, nr_entries, flags);
+	handle = stack_depot_save_flags(entries, nr_entries, flags,
+					STACK_DEPOT_FLAG_GET);
 	if (!handle)
 		handle = failure_handle;
+	else
+		stack_depot_get(handle, nr_refs - 1);
 
 	current->in_page_owner = 0;
 	return handle;
@@ -135,20 +167,23 @@ void __reset_page_owner(struct page *page, unsigned int order)
 	struct page_ext *page_ext;
 	depot_stack_handle_t handle;
 	struct page_owner *page_owner;
+	struct stack_put_batch old = {};
 	u64 free_ts_nsec = local_clock();
 
 	page_ext = lookup_page_ext(page);
 	if (unlikely(!page_ext))
 		return;
 
-	handle = save_stack(GFP_NOWAIT | __GFP_NOWARN);
+	handle = save_stack(GFP_NOWAIT | __GFP_NOWARN, 1 << order);
 	for (i = 0; i < (1 << order); i++) {
 		__clear_bit(PAGE_EXT_OWNER_ALLOCATED, &page_ext->flags);
 		page_owner = get_page_owner(page_ext);
+		stack_put_batch_add(&old, page_owner->free_handle);
 		page_owner->free_handle = handle;
 		page_owner->free_ts_nsec = free_ts_nsec;
 		page_ext = page_ext_next(page_ext);
 	}
+	stack_put_batch_flush(&old);
 }
 
 static inline void __set_page_owner_handle(struct page_ext *page_ext,
@@ -156,10 +191,12 @@ static inline void __set_page_owner_handle(struct page_ext *page_ext,
 					unsigned int order, gfp_t gfp_mask)
 {
 	struct page_owner *page_owner;
+	struct stack_put_batch old = {};
 	int i;
 
 	for (i = 0; i < (1 << order); i++) {
 		page_owner = get_page_owner(page_ext);
+		stack_put_batch_add(&old, page_owner->handle);
 		page_owner->handle = handle;
 		page_owner->order = order;
 		page_owner->gfp_mask = gfp_mask;
@@ -171,6 +208,7 @@ static inline void __set_page_owner_handle(struct page_ext *page_ext,
 
 		page_ext = page_ext_next(page_ext);
 	}
+	stack_put_batch_flush(&old);
 }
 
 /*
@@ -186,7 +224,7 @@ noinline void __set_page_owner(struct page *page, unsigned int order,
 	if (unlikely(!page_ext))
 		return;
 
-	handle = save_stack(gfp_mask);
+	handle = save_stack(gfp_mask, 1 << order);
 	__set_page_owner_handle(page_ext, handle, order, gfp_mask);
 }
 
@@ -233,6 +271,8 @@ void __copy_page_owner(struct page *oldpage, struct page *newpage)
 	new_page_owner->gfp_mask = old_page_owner->gfp_mask;
 	new_page_owner->last_migrate_reason =
 		old_page_owner->last_migrate_reason;
+	stack_depot_get(old_page_owner->handle, 1);
+	stack_depot_put(new_page_owner->handle, 1);
 	new_page_owner->handle = old_page_owner->handle;
 	new_page_owner->pid = old_page_owner->pid;
 	new_page_owner->ts_nsec = old_page_owner->ts_nsec;
@@ -261,6 +261,19 @@ bool page_vma_mapped_walk(struct page_vma_mapped_walk *pvmw)
 		if (!map_pte(pvmw))
 			goto next_pte;
 this_pte:
+		/*
+		 * Shared since fork: leave the pages alone until the table
+		 * is unshared, the other mms would not see a TLB flush.
+		 * Checked under the ptl, which fork shares tables with.
+		 */
+		if (unlikely(pte_table_shared(pvmw->pmd))) {
+			spin_unlock(pvmw->ptl);
+			pvmw->ptl = NULL;
+			pte_unmap(pvmw->pte);
+			pvmw->pte = NULL;
+			step_forward(pvmw, PMD_SIZE);
+			continue;
+		}
 		if (check_pte(pvmw))
 			return true;
 next_pte:
@@ -142,6 +142,7 @@ extern int pcpu_nr_slots;
 extern int pcpu_sidelined_slot;
 extern int pcpu_to_depopulate_slot;
 extern int pcpu_nr_empty_pop_pages;
+extern int pcpu_atomic_pop_target;
 
 extern struct pcpu_chunk *pcpu_first_chunk;
 extern struct pcpu_chunk *pcpu_reserved_chunk;
@@ -197,6 +198,12 @@ static inline int pcpu_chunk_map_bits(struct pcpu_chunk *chunk)
 #ifdef CONFIG_PERCPU_STATS
 
 #include <linux/spinlock.h>
+#include <linux/atomic.h>
+#include <linux/sched/clock.h>
+#include <linux/log2.h>
+
+/* pcpu_alloc() latency buckets, bucket i counts [2^i, 2^(i+1)) usecs */
+#define PCPU_STATS_NR_LAT	16
 
 struct percpu_stats {
 	u64 nr_alloc;		/* lifetime # of allocations */
@@ -207,6 +214,7 @@ struct percpu_stats {
 	u32 nr_max_chunks;	/* max # of live chunks */
 	size_t min_alloc_size;	/* min allocation size */
 	size_t max_alloc_size;	/* max allocation size */
+	atomic64_t alloc_lat[PCPU_STATS_NR_LAT]; /* pcpu_alloc() latency */
 };
 
 extern struct percpu_stats pcpu_stats;
@@ -303,12 +311,40 @@ static inline void pcpu_stats_chunk_dealloc(void)
 	spin_unlock_irqrestore(&pcpu_lock, flags);
 }
 
+static inline u64 pcpu_stats_alloc_start(void)
+{
+	return local_clock();
+}
+
+/*
+ * pcpu_stats_alloc_latency - account a pcpu_alloc() call in the histogram
+ * @start: value returned by pcpu_stats_alloc_start()
+ *
+ * Lockless so that the histogram doesn't add to pcpu_lock contention.
+ */
+static inline void pcpu_stats_alloc_latency(u64 start)
+{
+	u64 usecs = (local_clock() - start) / NSEC_PER_USEC;
+	int i = usecs ? min_t(int, ilog2(usecs), PCPU_STATS_NR_LAT - 1) : 0;
+
+	atomic64_inc(&pcpu_stats.alloc_lat[i]);
+}
+
 #else
 
 static inline void pcpu_stats_save_ai(const struct pcpu_alloc_info *ai)
 {
 }
 
+static inline u64 pcpu_stats_alloc_start(void)
+{
+	return 0;
+}
+
+static inline void pcpu_stats_alloc_latency(u64 start)
+{
+}
+
 static inline void pcpu_stats_area_alloc(struct pcpu_chunk *chunk, size_t size)
 {
 }
@@ -135,7 +135,7 @@ static void chunk_map_stats(struct seq_file *m, struct pcpu_chunk *chunk,
 static int percpu_stats_show(struct seq_file *m, void *v)
 {
 	struct pcpu_chunk *chunk;
-	int slot, max_nr_alloc;
+	int slot, max_nr_alloc, i;
 	int *buffer;
 
 alloc_buffer:
@@ -189,10 +189,25 @@ static int percpu_stats_show(struct seq_file *m, void *v)
 	PU(min_alloc_size);
 	PU(max_alloc_size);
 	P("empty_pop_pages", pcpu_nr_empty_pop_pages);
+	P("atomic_pop_target", pcpu_atomic_pop_target);
 	seq_putc(m, '\n');
 
 #undef PU
 
+	seq_printf(m,
+			"Allocation Latency:\n"
+			"----------------------------------------\n");
+	for (i = 0; i < PCPU_STATS_NR_LAT; i++) {
+		char name[20];
+
+		if (i < PCPU_STATS_NR_LAT - 1)
+			snprintf(name, sizeof(name), "< %lu us", 2UL << i);
+		else
+			snprintf(name, sizeof(name), ">= %lu us", 1UL << i);
+		P(name, atomic64_read(&pcpu_stats.alloc_lat[i]));
+	}
+	seq_putc(m, '\n');
+
 	seq_printf(m,
 			"Per Chunk Stats:\n"
 			"----------------------------------------\n");
@@ -124,6 +124,7 @@
  */
 #define PCPU_EMPTY_POP_PAGES_LOW	2
 #define PCPU_EMPTY_POP_PAGES_HIGH	4
+#define PCPU_EMPTY_POP_PAGES_MAX	64
 
 #ifdef CONFIG_SMP
 /* default addr <-> pcpu_ptr mapping, override in asm/percpu.h if necessary */
@@ -305,9 +306,9 @@ static unsigned long pcpu_nr_populated;
 
 /*
  * Balance work is used to populate or destroy chunks asynchronously.  We
- * try to keep the number of populated free pages between
- * PCPU_EMPTY_POP_PAGES_LOW and HIGH for atomic allocations and at most one
- * empty chunk.
+ * try to keep the number of populated free pages between half of
+ * pcpu_atomic_pop_target and the target itself for atomic allocations and
+ * at most one empty chunk.
  */
 static void pcpu_balance_workfn(struct work_struct *work);
 static DECLARE_WORK(pcpu_balance_work, pcpu_balance_workfn);
@@ -320,6 +321,15 @@ static bool pcpu_async_enabled __read_mostly;
  */
 static bool pcpu_atomic_alloc_failed;
 
+/*
+ * The number of empty populated pages the balance work tries to keep around
+ * for atomic allocations.  It follows the atomic demand seen between two
+ * balance runs, between PCPU_EMPTY_POP_PAGES_HIGH and _MAX, and decays back
+ * once the demand goes away.  Updated under pcpu_lock.
+ */
+int pcpu_atomic_pop_target = PCPU_EMPTY_POP_PAGES_HIGH;
+static size_t pcpu_atomic_alloc_bytes;
+
 
 /*
  * IAMROOT, 2022.02.05:
@@ -2606,6 +2616,32 @@ static void pcpu_memcg_free_hook(struct pcpu_chunk *chunk, int off, size_t size)
 }
 #endif /* CONFIG_MEMCG_KMEM */
 
+/*
+ * Non-atomic allocations only need pcpu_alloc_mutex to create a chunk or
+ * to populate pages.  Most of them are served from already populated space
+ * under pcpu_lock alone, so the mutex is grabbed lazily.
+ */
+/*
+ * IAMROOT, 2022.01.22: 
+ * 일반적인 커널 메모리 할당(is_atomic==0)을 사용하는 경우
+ * pcpu_alloc_mutex를 잡고 진입한다. 단 __GFP_NOFAIL 옵션을 사용하지 않는 
+ * 경우 killable(at fatal signal)이 가능한 lock 함수를 사용한다.
+ */
+static bool pcpu_alloc_mutex_lock(gfp_t gfp)
+{
+	/*
+	 * pcpu_balance_workfn() allocates memory under this mutex,
+	 * and it may wait for memory reclaim. Allow current task
+	 * to become OOM victim, in case of memory pressure.
+	 */
+	if (gfp & __GFP_NOFAIL) {
+		mutex_lock(&pcpu_alloc_mutex);
+		return true;
+	}
+
+	return !mutex_lock_killable(&pcpu_alloc_mutex);
+}
+
 /**
  * pcpu_alloc - the percpu allocator
  * @size: size of area to allocate in bytes
@@ -2627,14 +2663,16 @@ static void __percpu *pcpu_alloc(size_t size, size_t align, bool reserved,
 	gfp_t pcpu_gfp;
 	bool is_atomic;
 	bool do_warn;
+	bool mutex_held = false;
 	struct obj_cgroup *objcg = NULL;
 	static int warn_limit = 10;
 	struct pcpu_chunk *chunk, *next;
 	const char *err;
-	int slot, off, cpu, ret;
+	int slot, off, cpu, ret, next_off;
 	unsigned long flags;
 	void __percpu *ptr;
 	size_t bits, bit_align;
+	u64 start = pcpu_stats_alloc_start();
 
 /*
  * IAMROOT, 2022.01.23:
@@ -2691,26 +2729,6 @@ static void __percpu *pcpu_alloc(size_t size, size_t align, bool reserved,
 	if (unlikely(!pcpu_memcg_pre_alloc_hook(size, gfp, &objcg)))
 		return NULL;
 
-/*
- * IAMROOT, 2022.01.22: 
- * 일반적인 커널 메모리 할당(is_atomic==0)을 사용하는 경우
- * pcpu_alloc_mutex를 잡고 진입한다. 단 __GFP_NOFAIL 옵션을 사용하지 않는 
- * 경우 killable(at fatal signal)이 가능한 lock 함수를 사용한다.
- */
-	if (!is_atomic) {
-		/*
-		 * pcpu_balance_workfn() allocates memory under this mutex,
-		 * and it may wait for memory reclaim. Allow current task
-		 * to become OOM victim, in case of memory pressure.
-		 */
-		if (gfp & __GFP_NOFAIL) {
-			mutex_lock(&pcpu_alloc_mutex);
-		} else if (mutex_lock_killable(&pcpu_alloc_mutex)) {
-			pcpu_memcg_post_alloc_hook(objcg, NULL, 0, size);
-			return NULL;
-		}
-	}
-
 	spin_lock_irqsave(&pcpu_lock, flags);
 
 /*
@@ -2776,6 +2794,15 @@ static void __percpu *pcpu_alloc(size_t size, size_t align, bool reserved,
 		goto fail;
 	}
 
+	/* grab the mutex and look again, someone may have made room */
+	if (!mutex_held) {
+		if (!pcpu_alloc_mutex_lock(gfp))
+			goto fail_killed;
+		mutex_held = true;
+		spin_lock_irqsave(&pcpu_lock, flags);
+		goto restart;
+	}
+
 	if (list_empty(&pcpu_chunk_lists[pcpu_free_slot])) {
 		chunk = pcpu_create_chunk(pcpu_gfp);
 		if (!chunk) {
@@ -2793,7 +2820,26 @@ static void __percpu *pcpu_alloc(size_t size, size_t align, bool reserved,
 
 area_found:
 	pcpu_stats_area_alloc(chunk, size);
-	spin_unlock_irqrestore(&pcpu_lock, flags);
+	if (is_atomic)
+		pcpu_atomic_alloc_bytes += size;
+
+	/*
+	 * Populated pages backing an allocated area can't be depopulated, so
+	 * if they are all there already the mutex isn't needed at all.
+	 */
+	if (!is_atomic && !mutex_held &&
+	    !pcpu_is_populated(chunk, off / PCPU_MIN_ALLOC_SIZE, bits, &next_off)) {
+		spin_unlock_irqrestore(&pcpu_lock, flags);
+		if (!pcpu_alloc_mutex_lock(gfp)) {
+			spin_lock_irqsave(&pcpu_lock, flags);
+			pcpu_free_area(chunk, off);
+			spin_unlock_irqrestore(&pcpu_lock, flags);
+			goto fail_killed;
+		}
+		mutex_held = true;
+	} else {
+		spin_unlock_irqrestore(&pcpu_lock, flags);
+	}
 
 
 /*
@@ -2804,7 +2850,7 @@ static void __percpu *pcpu_alloc(size_t size, size_t align, bool reserved,
  *   해당 공간이 populate안되있다면 populate를 해줘야된다.
  */
 	/* populate if not all pages are already there */
-	if (!is_atomic) {
+	if (mutex_held) {
 		unsigned int page_start, page_end, rs, re;
 
 		page_start = PFN_DOWN(off);
@@ -2829,7 +2875,8 @@ static void __percpu *pcpu_alloc(size_t size, size_t align, bool reserved,
 		mutex_unlock(&pcpu_alloc_mutex);
 	}
 
-	if (pcpu_nr_empty_pop_pages < PCPU_EMPTY_POP_PAGES_LOW)
+	if (pcpu_nr_empty_pop_pages < max(PCPU_EMPTY_POP_PAGES_LOW,
+					  pcpu_atomic_pop_target / 2))
 		pcpu_schedule_balance_work();
 
 
@@ -2853,6 +2900,7 @@ static void __percpu *pcpu_alloc(size_t size, size_t align, bool reserved,
 			chunk->base_addr, off, ptr);
 
 	pcpu_memcg_post_alloc_hook(objcg, chunk, off, size);
+	pcpu_stats_alloc_latency(start);
 
 	return ptr;
 
@@ -2872,10 +2920,12 @@ static void __percpu *pcpu_alloc(size_t size, size_t align, bool reserved,
 		/* see the flag handling in pcpu_balance_workfn() */
 		pcpu_atomic_alloc_failed = true;
 		pcpu_schedule_balance_work();
-	} else {
+	} else if (mutex_held) {
 		mutex_unlock(&pcpu_alloc_mutex);
 	}
+	pcpu_stats_alloc_latency(start);
 
+fail_killed:
 	pcpu_memcg_post_alloc_hook(objcg, NULL, 0, size);
 
 	return NULL;
@@ -3004,6 +3054,34 @@ static void pcpu_balance_free(bool empty_only)
 	spin_lock_irq(&pcpu_lock);
 }
 
+/**
+ * pcpu_update_atomic_pop_target - size the atomic pool by recent demand
+ *
+ * CONTEXT:
+ * pcpu_lock.
+ */
+static void pcpu_update_atomic_pop_target(void)
+{
+	int demand = min_t(size_t, DIV_ROUND_UP(pcpu_atomic_alloc_bytes, PAGE_SIZE),
+			   PCPU_EMPTY_POP_PAGES_MAX);
+	int target;
+
+	lockdep_assert_held(&pcpu_lock);
+
+	/*
+	 * Keep twice what atomic allocations consumed since the last run.
+	 * Halve the target when the demand drops and double it when an
+	 * atomic allocation failed regardless.
+	 */
+	target = max(2 * demand, pcpu_atomic_pop_target / 2);
+	if (pcpu_atomic_alloc_failed)
+		target = max(target, 2 * pcpu_atomic_pop_target);
+
+	pcpu_atomic_pop_target = clamp(target, PCPU_EMPTY_POP_PAGES_HIGH,
+				       PCPU_EMPTY_POP_PAGES_MAX);
+	pcpu_atomic_alloc_bytes = 0;
+}
+
 /**
  * pcpu_balance_populated - manage the amount of populated pages
  *
@@ -3037,7 +3115,8 @@ static void pcpu_balance_populated(void)
 	 * Ensure there are certain number of free populated pages for
 	 * atomic allocs.  Fill up from the most packed so that atomic
 	 * allocs don't increase fragmentation.  If atomic allocation
-	 * failed previously, always populate the maximum amount.  This
+	 * failed previously, always populate the whole target.  The target
+	 * itself is sized by pcpu_update_atomic_pop_target().  This
 	 * should prevent atomic allocs larger than PAGE_SIZE from keeping
 	 * failing indefinitely; however, large atomic allocs are not
 	 * something we support properly and can be highly unreliable and
@@ -3051,13 +3130,13 @@ static void pcpu_balance_populated(void)
  *   그게 아니라면 system empty populate를 4개로 유지한다.
  */
 	if (pcpu_atomic_alloc_failed) {
-		nr_to_pop = PCPU_EMPTY_POP_PAGES_HIGH;
+		nr_to_pop = pcpu_atomic_pop_target;
 		/* best effort anyway, don't worry about synchronization */
 		pcpu_atomic_alloc_failed = false;
 	} else {
-		nr_to_pop = clamp(PCPU_EMPTY_POP_PAGES_HIGH -
+		nr_to_pop = clamp(pcpu_atomic_pop_target -
 				  pcpu_nr_empty_pop_pages,
-				  0, PCPU_EMPTY_POP_PAGES_HIGH);
+				  0, pcpu_atomic_pop_target);
 	}
 
 	for (slot = pcpu_size_to_slot(PAGE_SIZE); slot <= pcpu_free_slot; slot++) {
@@ -3186,7 +3265,7 @@ static void pcpu_reclaim_populated(void)
  *   reintegrate 한다.
  */
 			/* reintegrate chunk to prevent atomic alloc failures */
-			if (pcpu_nr_empty_pop_pages < PCPU_EMPTY_POP_PAGES_HIGH) {
+			if (pcpu_nr_empty_pop_pages < pcpu_atomic_pop_target) {
 				reintegrate = true;
 				goto end_chunk;
 			}
@@ -3307,6 +3386,7 @@ static void pcpu_balance_workfn(struct work_struct *work)
  * - 일단 free_slot에 있는건 한개빼구 전부 free한다.
  */
 	pcpu_balance_free(false);
+	pcpu_update_atomic_pop_target();
 	pcpu_reclaim_populated();
 	pcpu_balance_populated();
 /*
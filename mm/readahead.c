@@ -23,6 +23,7 @@
 #include <linux/blk-cgroup.h>
 #include <linux/fadvise.h>
 #include <linux/sched/mm.h>
+#include <linux/cpuset.h>
 
 #include "internal.h"
 
@@ -157,6 +158,89 @@ static void read_pages(struct readahead_control *rac, struct list_head *pages,
 		rac->_index++;
 }
 
+/*
+ * Readahead pages are taken from a small stash refilled by the bulk
+ * allocator rather than going through the page allocator once per page.
+ * The bulk allocator only knows about the local node, so it is not used
+ * when a task mempolicy or cpuset page spreading would place the pages
+ * elsewhere.
+ */
+#define RA_ALLOC_BATCH	32
+
+struct ra_page_stash {
+	struct page *pages[RA_ALLOC_BATCH];
+	unsigned int nr;
+};
+
+static bool ra_can_bulk_alloc(void)
+{
+	if (cpuset_do_page_mem_spread())
+		return false;
+#ifdef CONFIG_NUMA
+	if (current->mempolicy)
+		return false;
+#endif
+	return true;
+}
+
+static struct page *ra_alloc_page(struct ra_page_stash *stash, gfp_t gfp,
+		unsigned long nr_wanted)
+{
+	if (!stash->nr && nr_wanted > 1 && ra_can_bulk_alloc())
+		stash->nr = alloc_pages_bulk_array(gfp,
+				min_t(unsigned long, nr_wanted, RA_ALLOC_BATCH),
+				stash->pages);
+	if (stash->nr) {
+		struct page *page = stash->pages[--stash->nr];
+
+		stash->pages[stash->nr] = NULL;
+		return page;
+	}
+	return __page_cache_alloc(gfp);
+}
+
+static void ra_free_stash(struct ra_page_stash *stash)
+{
+	while (stash->nr)
+		put_page(stash->pages[--stash->nr]);
+}
+
+/*
+ * Pages for empty indices are collected and added to the page cache in
+ * one go, see add_to_page_cache_lru_batch().  The batch always continues
+ * the pages already in @ractl.
+ */
+struct ra_page_batch {
+	struct page *pages[RA_ALLOC_BATCH];
+	unsigned int nr;
+	pgoff_t mark;		/* index to flag PageReadahead */
+};
+
+/*
+ * Returns false if some pages of the batch could not be added.  They are
+ * released, and the first one of them is where @ractl now ends, so the
+ * caller can skip that index as if a single page had failed.
+ */
+static bool ra_flush_batch(struct readahead_control *ractl,
+			   struct ra_page_batch *batch, gfp_t gfp)
+{
+	unsigned int i, added;
+
+	if (!batch->nr)
+		return true;
+	added = add_to_page_cache_lru_batch(batch->pages, batch->nr,
+			ractl->mapping, ractl->_index + ractl->_nr_pages, gfp);
+	for (i = 0; i < added; i++)
+		if (batch->pages[i]->index == batch->mark)
+			SetPageReadahead(batch->pages[i]);
+	for (i = added; i < batch->nr; i++)
+		put_page(batch->pages[i]);
+	ractl->_nr_pages += added;
+	i = batch->nr;
+	batch->nr = 0;
+	return added == i;
+}
+
 /**
  * page_cache_ra_unbounded - Start unchecked readahead.
  * @ractl: Readahead control.
@@ -178,6 +262,10 @@ void page_cache_ra_unbounded(struct readahead_control *ractl,
 	unsigned long index = readahead_index(ractl);
 	LIST_HEAD(page_pool);
 	gfp_t gfp_mask = readahead_gfp_mask(mapping);
+	struct ra_page_stash stash = { };
+	struct ra_page_batch batch = {
+		.mark = index + nr_to_read - lookahead_size,
+	};
 	unsigned long i;
 
 	/*
@@ -197,9 +285,10 @@ void page_cache_ra_unbounded(struct readahead_control *ractl,
 	 * Preallocate as many pages as we will need.
 	 */
 	for (i = 0; i < nr_to_read; i++) {
-		struct page *page = xa_load(&mapping->i_pages, index + i);
+		void *entry = xa_load(&mapping->i_pages, index + i);
+		struct page *page;
 
-		if (page && !xa_is_value(page)) {
+		if (entry && !xa_is_value(entry)) {
 			/*
 			 * Page already present?  Kick off the current batch
 			 * of contiguous pages before continuing with the
@@ -208,19 +297,30 @@ void page_cache_ra_unbounded(struct readahead_control *ractl,
 			 * have a stable reference to this page, and it's
 			 * not worth getting one just for that.
 			 */
+			ra_flush_batch(ractl, &batch, gfp_mask);
 			read_pages(ractl, &page_pool, true);
 			i = ractl->_index + ractl->_nr_pages - index - 1;
 			continue;
 		}
 
-		page = __page_cache_alloc(gfp_mask);
+		page = ra_alloc_page(&stash, gfp_mask, nr_to_read - i);
 		if (!page)
 			break;
 		if (mapping->a_ops->readpages) {
 			page->index = index + i;
 			list_add(&page->lru, &page_pool);
-		} else if (add_to_page_cache_lru(page, mapping, index + i,
+		} else if (!entry) {
+			batch.pages[batch.nr++] = page;
+			if (batch.nr == ARRAY_SIZE(batch.pages) &&
+			    !ra_flush_batch(ractl, &batch, gfp_mask)) {
+				read_pages(ractl, &page_pool, true);
+				i = ractl->_index + ractl->_nr_pages - index - 1;
+			}
+			continue;
+		} else if (!ra_flush_batch(ractl, &batch, gfp_mask) ||
+			   add_to_page_cache_lru(page, mapping, index + i,
 					gfp_mask) < 0) {
+			/* Shadow entries go through the single page path */
 			put_page(page);
 			read_pages(ractl, &page_pool, true);
 			i = ractl->_index + ractl->_nr_pages - index - 1;
@@ -230,6 +330,7 @@ void page_cache_ra_unbounded(struct readahead_control *ractl,
 			SetPageReadahead(page);
 		ractl->_nr_pages++;
 	}
+	ra_flush_batch(ractl, &batch, gfp_mask);
 
 	/*
 	 * Now start the IO.  We ignore I/O errors - if the page is not
@@ -238,6 +339,7 @@ void page_cache_ra_unbounded(struct readahead_control *ractl,
 	 */
 	read_pages(ractl, &page_pool, false);
 	filemap_invalidate_unlock_shared(mapping);
+	ra_free_stash(&stash);
 	memalloc_nofs_restore(nofs);
 }
 EXPORT_SYMBOL_GPL(page_cache_ra_unbounded);
@@ -435,6 +537,36 @@ static int try_context_readahead(struct address_space *mapping,
 /*
  * A minimal readahead algorithm for trivial sequential/random reads.
  */
+/* Upper bound on the strided chunks read ahead in one go */
+#define RA_STRIDE_MAX_CHUNKS	8
+
+/*
+ * Read ahead the chunks that follow ra->prev_miss along a confirmed
+ * stride, which may be negative for backward scans.  The first chunk
+ * carries the readahead marker, so the reader hitting it schedules the
+ * next batch before it catches up with the I/O.
+ */
+static void stride_readahead(struct readahead_control *ractl,
+		unsigned long max_pages)
+{
+	struct file_ra_state *ra = ractl->ra;
+	unsigned long size = ra->stride_size;
+	unsigned long nr = clamp(max_pages / size, 1UL,
+				 (unsigned long)RA_STRIDE_MAX_CHUNKS);
+	pgoff_t index = ra->prev_miss;
+	unsigned long i;
+
+	for (i = 0; i < nr; i++) {
+		if (ra->stride < 0 && index < (pgoff_t)-ra->stride)
+			break;
+		index += ra->stride;
+		ractl->_index = index;
+		do_page_cache_ra(ractl, size, i ? 0 : size);
+		ra->prev_miss = index;
+	}
+	count_vm_event(RA_STRIDE);
+}
+
 static void ondemand_readahead(struct readahead_control *ractl,
 		bool hit_readahead_marker, unsigned long req_size)
 {
@@ -452,6 +584,15 @@ static void ondemand_readahead(struct readahead_control *ractl,
 	if (req_size > max_pages && bdi->io_pages > max_pages)
 		max_pages = min(req_size, bdi->io_pages);
 
+	/*
+	 * Hit the marker of a strided window: keep the next chunks coming.
+	 */
+	if (hit_readahead_marker && ra->stride_size &&
+	    (long)(index - ra->prev_miss) % ra->stride == 0) {
+		stride_readahead(ractl, max_pages);
+		return;
+	}
+
 	/*
 	 * start of file
 	 */
@@ -495,6 +636,24 @@ static void ondemand_readahead(struct readahead_control *ractl,
 		goto readit;
 	}
 
+	/*
+	 * Strided or backward scan: the last two misses are the same
+	 * distance apart, and that distance is not covered by the requests
+	 * themselves.  Read this request and the next chunks along the
+	 * stride.
+	 */
+	if (index - ra->prev_miss == ra->stride &&
+	    (ra->stride < 0 || ra->stride > (long)req_size)) {
+		ra->prev_miss = index;
+		ra->stride_size = req_size;
+		do_page_cache_ra(ractl, req_size, 0);
+		stride_readahead(ractl, max_pages);
+		return;
+	}
+	ra->stride = index - ra->prev_miss;
+	ra->prev_miss = index;
+	ra->stride_size = 0;
+
 	/*
 	 * oversize read
 	 */
@@ -1067,6 +1067,13 @@ struct page_referenced_arg {
 	unsigned long vm_flags;
 	struct mem_cgroup *memcg;
 };
+
+struct page_referenced_batch_arg {
+	int *mapcount;
+	int *referenced;
+	unsigned long *vm_flags;
+	struct mem_cgroup *memcg;
+};
 /*
  * arg: page_referenced_arg will be passed
  */
@@ -1240,6 +1247,167 @@ int page_referenced(struct page *page,
 	return pra.referenced;
 }
 
+/*
+ * Return @page's anon_vma if it hangs off the locked @root. A mapped page
+ * cannot change or lose its anon_vma while the root rwsem is held, see
+ * page_lock_anon_vma_read().
+ */
+static struct anon_vma *page_anon_vma_under_root(struct page *page,
+						 struct anon_vma *root)
+{
+	struct anon_vma *anon_vma = NULL;
+	unsigned long anon_mapping;
+
+	rcu_read_lock();
+	anon_mapping = (unsigned long)READ_ONCE(page->mapping);
+	if ((anon_mapping & PAGE_MAPPING_FLAGS) != PAGE_MAPPING_ANON)
+		goto out;
+
+	anon_vma = (struct anon_vma *) (anon_mapping - PAGE_MAPPING_ANON);
+	if (READ_ONCE(anon_vma->root) != root || !page_mapped(page))
+		anon_vma = NULL;
+out:
+	rcu_read_unlock();
+	return anon_vma;
+}
+
+/*
+ * Walk @anon_vma's interval tree once for every page in @group that
+ * belongs to it, and drop those pages from @group.
+ */
+static void page_referenced_anon_vma(struct anon_vma *anon_vma,
+				     struct page **pages, int nr,
+				     unsigned long *group,
+				     struct page_referenced_batch_arg *arg)
+{
+	DECLARE_BITMAP(walk, RMAP_BATCH_MAX);
+	struct anon_vma_chain *avc;
+	pgoff_t pgoff_start = ULONG_MAX, pgoff_end = 0;
+	int i;
+
+	bitmap_zero(walk, nr);
+	for_each_set_bit(i, group, nr) {
+		struct page *page = pages[i];
+
+		if (page_anon_vma(page) != anon_vma)
+			continue;
+
+		__set_bit(i, walk);
+		__clear_bit(i, group);
+		pgoff_start = min(pgoff_start, page_to_pgoff(page));
+		pgoff_end = max(pgoff_end,
+				page_to_pgoff(page) + thp_nr_pages(page) - 1);
+	}
+
+	anon_vma_interval_tree_foreach(avc, &anon_vma->rb_root,
+			pgoff_start, pgoff_end) {
+		struct vm_area_struct *vma = avc->vma;
+
+		cond_resched();
+
+		if (arg->memcg && !mm_match_cgroup(vma->vm_mm, arg->memcg))
+			continue;
+
+		for_each_set_bit(i, walk, nr) {
+			struct page_referenced_arg pra = {
+				.mapcount = arg->mapcount[i],
+				.memcg = arg->memcg,
+			};
+			unsigned long address = vma_address(pages[i], vma);
+
+			/* The tree range covers the whole batch */
+			if (address == -EFAULT)
+				continue;
+
+			if (!page_referenced_one(pages[i], vma, address, &pra))
+				__clear_bit(i, walk);
+
+			arg->mapcount[i] = pra.mapcount;
+			arg->referenced[i] += pra.referenced;
+			arg->vm_flags[i] |= pra.vm_flags;
+		}
+
+		if (bitmap_empty(walk, nr))
+			break;
+	}
+}
+
+/**
+ * page_referenced_batch - test a vector of pages for references
+ * @pages: the pages to test, at most RMAP_BATCH_MAX
+ * @nr: number of pages in @pages
+ * @memcg: target memory cgroup
+ * @referenced: returns page_referenced() of each page
+ * @vm_flags: returns the referencing vma->vm_flags of each page
+ *
+ * Equivalent to calling page_referenced() on each page with @is_locked
+ * clear, but anon pages sharing an anon_vma root are tested under a single
+ * acquisition of the root rwsem, and pages sharing an anon_vma under a
+ * single walk of its interval tree. Other pages take the regular path.
+ */
+void page_referenced_batch(struct page **pages, int nr,
+			   struct mem_cgroup *memcg,
+			   int *referenced, unsigned long *vm_flags)
+{
+	DECLARE_BITMAP(pending, RMAP_BATCH_MAX);
+	DECLARE_BITMAP(group, RMAP_BATCH_MAX);
+	int mapcount[RMAP_BATCH_MAX];
+	struct page_referenced_batch_arg arg = {
+		.mapcount = mapcount,
+		.referenced = referenced,
+		.vm_flags = vm_flags,
+		.memcg = memcg,
+	};
+	int i, j;
+
+	VM_BUG_ON(nr > RMAP_BATCH_MAX);
+
+	bitmap_zero(pending, nr);
+	for (i = 0; i < nr; i++) {
+		struct page *page = pages[i];
+
+		referenced[i] = 0;
+		vm_flags[i] = 0;
+		mapcount[i] = total_mapcount(page);
+		if (!mapcount[i] || !page_rmapping(page))
+			continue;
+
+		if (!PageAnon(page) || PageKsm(page)) {
+			referenced[i] = page_referenced(page, 0, memcg,
+							&vm_flags[i]);
+			continue;
+		}
+
+		__set_bit(i, pending);
+	}
+
+	while ((i = find_first_bit(pending, nr)) < nr) {
+		struct anon_vma *anon_vma, *root;
+
+		__clear_bit(i, pending);
+		anon_vma = page_lock_anon_vma_read(pages[i]);
+		if (!anon_vma)
+			continue;
+
+		/* Gather everything else the root lock covers */
+		root = anon_vma->root;
+		bitmap_zero(group, nr);
+		__set_bit(i, group);
+		for_each_set_bit(j, pending, nr) {
+			if (page_anon_vma_under_root(pages[j], root)) {
+				__clear_bit(j, pending);
+				__set_bit(j, group);
+			}
+		}
+
+		while ((j = find_first_bit(group, nr)) < nr)
+			page_referenced_anon_vma(page_anon_vma(pages[j]),
+						 pages, nr, group, &arg);
+
+		anon_vma_unlock_read(anon_vma);
+	}
+}
+
 static bool page_mkclean_one(struct page *page, struct vm_area_struct *vma,
 			    unsigned long address, void *arg)
 {
@@ -2179,7 +2347,18 @@ static bool try_to_migrate_one(struct page *page, struct vm_area_struct *vma,
  * IAMROOT, 2022.04.09:
  * - 기존 pte를 가져오면서 clear(unmap)한다.
  */
-		pteval = ptep_clear_flush(vma, address, pvmw.pte);
+		if (should_defer_flush(mm, flags)) {
+			/*
+			 * The caller batches the TLB flush and must call
+			 * try_to_unmap_flush() before touching the page
+			 * contents, see numa_migrate_batch().
+			 */
+			pteval = ptep_get_and_clear(mm, address, pvmw.pte);
+
+			set_tlb_ubc_flush_pending(mm, pte_dirty(pteval));
+		} else {
+			pteval = ptep_clear_flush(vma, address, pvmw.pte);
+		}
 
 		/* Move the dirty bit to the page. Now the pte is gone. */
 		if (pte_dirty(pteval))
@@ -2335,11 +2514,11 @@ void try_to_migrate(struct page *page, enum ttu_flags flags)
 	};
 
 	/*
-	 * Migration always ignores mlock and only supports TTU_RMAP_LOCKED and
-	 * TTU_SPLIT_HUGE_PMD and TTU_SYNC flags.
+	 * Migration always ignores mlock and only supports TTU_RMAP_LOCKED,
+	 * TTU_SPLIT_HUGE_PMD, TTU_SYNC and TTU_BATCH_FLUSH flags.
 	 */
 	if (WARN_ON_ONCE(flags & ~(TTU_RMAP_LOCKED | TTU_SPLIT_HUGE_PMD |
-					TTU_SYNC)))
+					TTU_SYNC | TTU_BATCH_FLUSH)))
 		return;
 
 	if (is_zone_device_page(page) && !is_device_private_page(page))
@@ -402,6 +402,18 @@ static void debugfs_slab_add(struct kmem_cache *);
 static inline void debugfs_slab_add(struct kmem_cache *s) { }
 #endif
 
+static inline void pstat_add(const struct kmem_cache *s,
+			     enum slub_pstat_item si, unsigned long nr)
+{
+	/* Racy on a preemptible kernel like stat(), which is acceptable */
+	raw_cpu_add(s->cpu_slab->pstat[si], nr);
+}
+
+static inline void pstat(const struct kmem_cache *s, enum slub_pstat_item si)
+{
+	pstat_add(s, si, 1);
+}
+
 static inline void stat(const struct kmem_cache *s, enum stat_item si)
 {
 #ifdef CONFIG_SLUB_STATS
@@ -2693,6 +2705,7 @@ static void *get_partial_node(struct kmem_cache *s, struct kmem_cache_node *n,
 	unsigned int available = 0;
 	unsigned long flags;
 	int objects;
+	unsigned long scanned = 0;
 
 	/*
 	 * Racy check. If we mistakenly see no partial slabs then we
@@ -2708,6 +2721,7 @@ static void *get_partial_node(struct kmem_cache *s, struct kmem_cache_node *n,
 		return NULL;
 
 	spin_lock_irqsave(&n->list_lock, flags);
+	pstat(s, PSTAT_LIST_LOCK);
 
 /*
  * IAMROOT, 2022.06.25:
@@ -2716,6 +2730,8 @@ static void *get_partial_node(struct kmem_cache *s, struct kmem_cache_node *n,
 	list_for_each_entry_safe(page, page2, &n->partial, slab_list) {
 		void *t;
 
+		scanned++;
+
 /*
  * IAMROOT, 2022.06.25:
  * - pfmemalloc 매칭이 안맞다면 continue
@@ -2759,6 +2775,7 @@ static void *get_partial_node(struct kmem_cache *s, struct kmem_cache_node *n,
 
 	}
 	spin_unlock_irqrestore(&n->list_lock, flags);
+	pstat_add(s, PSTAT_PARTIAL_SCAN, scanned);
 	return object;
 }
 
@@ -3053,6 +3070,7 @@ static void deactivate_slab(struct kmem_cache *s, struct page *page,
 			 * is frozen
 			 */
 			spin_lock_irqsave(&n->list_lock, flags);
+			pstat(s, PSTAT_LIST_LOCK);
 		}
 	} else {
 		m = M_FULL;
@@ -3064,6 +3082,7 @@ static void deactivate_slab(struct kmem_cache *s, struct page *page,
 			 * any frozen slabs.
 			 */
 			spin_lock_irqsave(&n->list_lock, flags);
+			pstat(s, PSTAT_LIST_LOCK);
 		}
 	}
 
@@ -3135,6 +3154,7 @@ static void __unfreeze_partials(struct kmem_cache *s, struct page *partial_page)
 
 			n = n2;
 			spin_lock_irqsave(&n->list_lock, flags);
+			pstat(s, PSTAT_LIST_LOCK);
 		}
 
 /*
@@ -3358,6 +3378,8 @@ static inline void __flush_cpu_slab(struct kmem_cache *s, int cpu)
 	unfreeze_partials_cpu(s, c);
 }
 
+static void flush_cpu_magazine(struct kmem_cache *s, struct slub_magazine *mag);
+
 struct slub_flush_work {
 	struct work_struct work;
 	struct kmem_cache *s;
@@ -3378,6 +3400,11 @@ static void flush_cpu_slab(struct work_struct *w)
 	sfw = container_of(w, struct slub_flush_work, work);
 
 	s = sfw->s;
+
+	/* Magazine objects go back to the slabs before those are flushed */
+	if (s->cpu_mag)
+		flush_cpu_magazine(s, this_cpu_ptr(s->cpu_mag));
+
 	c = this_cpu_ptr(s->cpu_slab);
 
 	if (c->page)
@@ -3390,6 +3417,9 @@ static bool has_cpu_slab(int cpu, struct kmem_cache *s)
 {
 	struct kmem_cache_cpu *c = per_cpu_ptr(s->cpu_slab, cpu);
 
+	if (s->cpu_mag && READ_ONCE(per_cpu_ptr(s->cpu_mag, cpu)->count))
+		return true;
+
 	return c->page || slub_percpu_partial(c);
 }
 
@@ -3442,8 +3472,11 @@ static int slub_cpu_dead(unsigned int cpu)
 	struct kmem_cache *s;
 
 	mutex_lock(&slab_mutex);
-	list_for_each_entry(s, &slab_caches, list)
+	list_for_each_entry(s, &slab_caches, list) {
+		if (s->cpu_mag)
+			flush_cpu_magazine(s, per_cpu_ptr(s->cpu_mag, cpu));
 		__flush_cpu_slab(s, cpu);
+	}
 	mutex_unlock(&slab_mutex);
 	return 0;
 }
@@ -3646,6 +3679,7 @@ static void *___slab_alloc(struct kmem_cache *s, gfp_t gfpflags, int node,
 	unsigned long flags;
 
 	stat(s, ALLOC_SLOWPATH);
+	pstat(s, PSTAT_ALLOC_SLOWPATH);
 
 reread_page:
 
@@ -3936,6 +3970,9 @@ static __always_inline void maybe_wipe_obj_freeptr(struct kmem_cache *s,
  *
  * - object를 요청한 cache의 node에서 할당을 한다.
  */
+static void *magazine_alloc(struct kmem_cache *s, gfp_t gfpflags);
+static bool magazine_free(struct kmem_cache *s, void *object);
+
 static __always_inline void *slab_alloc_node(struct kmem_cache *s,
 		gfp_t gfpflags, int node, unsigned long addr, size_t orig_size)
 {
@@ -3954,6 +3991,16 @@ static __always_inline void *slab_alloc_node(struct kmem_cache *s,
 	if (unlikely(object))
 		goto out;
 
+	/* Magazine objects may be from any node, only use them for any node */
+	if (s->cpu_mag && node == NUMA_NO_NODE) {
+		object = magazine_alloc(s, gfpflags);
+		if (likely(object)) {
+			maybe_wipe_obj_freeptr(s, object);
+			init = slab_want_init_on_alloc(gfpflags, s);
+			goto out;
+		}
+	}
+
 redo:
 	/*
 	 * Must read kmem_cache cpu data via this cpu ptr. Preemption is
@@ -4204,10 +4251,14 @@ static void __slab_free(struct kmem_cache *s, struct page *page,
 	unsigned long flags;
 
 	stat(s, FREE_SLOWPATH);
+	pstat(s, PSTAT_FREE_SLOWPATH);
 
 	if (kfence_free(head))
 		return;
 
+	if (page_to_nid(page) != numa_mem_id())
+		pstat(s, PSTAT_REMOTE_FREE);
+
 	if (kmem_cache_debug(s) &&
 	    !free_debug_processing(s, page, head, tail, cnt, addr))
 		return;
@@ -4275,6 +4326,7 @@ static void __slab_free(struct kmem_cache *s, struct page *page,
  *   동기화됩니다.
  */
 				spin_lock_irqsave(&n->list_lock, flags);
+				pstat(s, PSTAT_LIST_LOCK);
 
 			}
 		}
@@ -4466,6 +4518,10 @@ static __always_inline void slab_free(struct kmem_cache *s, struct page *page,
 				      void *head, void *tail, int cnt,
 				      unsigned long addr)
 {
+	/* Bulk frees already batch, only single objects go to the magazine */
+	if (s->cpu_mag && !tail && magazine_free(s, head))
+		return;
+
 	/*
 	 * With KASAN enabled slab_free_freelist_hook modifies the freelist
 	 * to remove objects, whose reuse must be delayed.
@@ -4616,18 +4672,19 @@ void kmem_cache_free_bulk(struct kmem_cache *s, size_t size, void **p)
 }
 EXPORT_SYMBOL(kmem_cache_free_bulk);
 
-/* Note that interrupts must be enabled when calling this function. */
-int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t size,
-			  void **p)
+/*
+ * Take @size objects from the cpu slab and the slow path without running any
+ * of the alloc hooks. Returns the number of objects stored at @p, which is
+ * less than @size only if the slow path failed.
+ *
+ * Note that interrupts must be enabled when calling this function.
+ */
+static int __kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags,
+				   size_t size, void **p, bool use_kfence)
 {
 	struct kmem_cache_cpu *c;
 	int i;
-	struct obj_cgroup *objcg = NULL;
 
-	/* memcg and kmem_cache debug support */
-	s = slab_pre_alloc_hook(s, &objcg, size, flags);
-	if (unlikely(!s))
-		return false;
 	/*
 	 * Drain objects in the per cpu slab, while disabling local
 	 * IRQs, which protects against PREEMPT and interrupts
@@ -4637,7 +4694,10 @@ int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t size,
 	local_lock_irq(&s->cpu_slab->lock);
 
 	for (i = 0; i < size; i++) {
-		void *object = kfence_alloc(s, s->object_size, flags);
+		void *object = NULL;
+
+		if (use_kfence)
+			object = kfence_alloc(s, s->object_size, flags);
 
 		if (unlikely(object)) {
 			p[i] = object;
@@ -4663,8 +4723,10 @@ int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t size,
 			 */
 			p[i] = ___slab_alloc(s, flags, NUMA_NO_NODE,
 					    _RET_IP_, c);
-			if (unlikely(!p[i]))
-				goto error;
+			if (unlikely(!p[i])) {
+				slub_put_cpu_ptr(s->cpu_slab);
+				return i;
+			}
 
 			c = this_cpu_ptr(s->cpu_slab);
 			maybe_wipe_obj_freeptr(s, p[i]);
@@ -4681,6 +4743,25 @@ int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t size,
 	local_unlock_irq(&s->cpu_slab->lock);
 	slub_put_cpu_ptr(s->cpu_slab);
 
+	return i;
+}
+
+/* Note that interrupts must be enabled when calling this function. */
+int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t size,
+			  void **p)
+{
+	int i;
+	struct obj_cgroup *objcg = NULL;
+
+	/* memcg and kmem_cache debug support */
+	s = slab_pre_alloc_hook(s, &objcg, size, flags);
+	if (unlikely(!s))
+		return false;
+
+	i = __kmem_cache_alloc_bulk(s, flags, size, p, true);
+	if (unlikely(i < size))
+		goto error;
+
 	/*
 	 * memcg and kmem_cache debug support and memory initialization.
 	 * Done outside of the IRQ disabled fastpath loop.
@@ -4689,13 +4770,147 @@ int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t size,
 				slab_want_init_on_alloc(flags, s));
 	return i;
 error:
-	slub_put_cpu_ptr(s->cpu_slab);
 	slab_post_alloc_hook(s, objcg, flags, i, p, false);
 	__kmem_cache_free_bulk(s, i, p);
 	return 0;
 }
 EXPORT_SYMBOL(kmem_cache_alloc_bulk);
 
+/*
+ * Per cpu magazines.
+ *
+ * Objects in a magazine are free as far as the alloc and free hooks are
+ * concerned: the free hooks run when an object enters the magazine and the
+ * alloc hooks when it leaves. For the slabs, they are allocated objects,
+ * which is why refill and flush bypass the hooks and go straight to the cpu
+ * slab and do_slab_free().
+ */
+#define MAGAZINE_BATCH_MAX	32
+
+static unsigned int magazine_batch(struct kmem_cache *s)
+{
+	return min(s->mag_size / 2, (unsigned int)MAGAZINE_BATCH_MAX);
+}
+
+/* Return @nr objects at @p to their slabs. The free hooks have already run. */
+static void magazine_free_objects(struct kmem_cache *s, size_t nr, void **p)
+{
+	do {
+		struct detached_freelist df;
+
+		nr = build_detached_freelist(s, nr, p, &df);
+		if (!df.page)
+			continue;
+
+		do_slab_free(df.s, df.page, df.freelist, df.tail, df.cnt,
+			     _RET_IP_);
+	} while (likely(nr));
+}
+
+static void *magazine_alloc(struct kmem_cache *s, gfp_t gfpflags)
+{
+	void *batch[MAGAZINE_BATCH_MAX];
+	struct slub_magazine *mag;
+	unsigned long flags;
+	void *object = NULL;
+	unsigned int nr, room;
+
+	local_lock_irqsave(&s->cpu_mag->lock, flags);
+	mag = this_cpu_ptr(s->cpu_mag);
+	if (likely(mag->count))
+		object = mag->objects[--mag->count];
+	local_unlock_irqrestore(&s->cpu_mag->lock, flags);
+
+	if (likely(object))
+		return object;
+
+	/* The bulk refill needs interrupts enabled */
+	if (irqs_disabled())
+		return NULL;
+
+	nr = __kmem_cache_alloc_bulk(s, gfpflags, magazine_batch(s), batch,
+				     false);
+	if (unlikely(!nr))
+		return NULL;
+
+	/* Keep one for the caller and stash the rest on the current cpu */
+	object = batch[--nr];
+
+	local_lock_irqsave(&s->cpu_mag->lock, flags);
+	mag = this_cpu_ptr(s->cpu_mag);
+	room = min(nr, s->mag_size - mag->count);
+	nr -= room;
+	memcpy(&mag->objects[mag->count], &batch[nr], room * sizeof(void *));
+	mag->count += room;
+	local_unlock_irqrestore(&s->cpu_mag->lock, flags);
+
+	if (unlikely(nr))
+		magazine_free_objects(s, nr, batch);
+
+	return object;
+}
+
+/*
+ * Returns false if the object must take the regular free path instead.
+ */
+static bool magazine_free(struct kmem_cache *s, void *object)
+{
+	void *batch[MAGAZINE_BATCH_MAX];
+	struct slub_magazine *mag;
+	unsigned long flags;
+	unsigned int nr = 0;
+	void *tail = NULL;
+	int cnt = 1;
+
+	if (is_kfence_address(object))
+		return false;
+
+	/* KASAN may keep the object in quarantine and free it later */
+	if (!slab_free_freelist_hook(s, &object, &tail, &cnt))
+		return true;
+	memcg_slab_free_hook(s, &object, 1);
+
+	local_lock_irqsave(&s->cpu_mag->lock, flags);
+	mag = this_cpu_ptr(s->cpu_mag);
+	if (unlikely(mag->count == s->mag_size)) {
+		/* Flush the oldest objects, keep the cache hot ones */
+		nr = magazine_batch(s);
+		memcpy(batch, mag->objects, nr * sizeof(void *));
+		mag->count -= nr;
+		memmove(mag->objects, &mag->objects[nr],
+			mag->count * sizeof(void *));
+	}
+	mag->objects[mag->count++] = object;
+	local_unlock_irqrestore(&s->cpu_mag->lock, flags);
+
+	if (unlikely(nr))
+		magazine_free_objects(s, nr, batch);
+
+	return true;
+}
+
+/*
+ * Return all objects of @mag to their slabs. @mag is either the magazine of
+ * the current cpu with migration disabled, or that of a dead cpu.
+ */
+static void flush_cpu_magazine(struct kmem_cache *s, struct slub_magazine *mag)
+{
+	void *batch[MAGAZINE_BATCH_MAX];
+	unsigned long flags;
+	unsigned int nr;
+
+	do {
+		local_lock_irqsave(&s->cpu_mag->lock, flags);
+		nr = min(mag->count, (unsigned int)MAGAZINE_BATCH_MAX);
+		mag->count -= nr;
+		memcpy(batch, &mag->objects[mag->count], nr * sizeof(void *));
+		local_unlock_irqrestore(&s->cpu_mag->lock, flags);
+
+		if (nr)
+			magazine_free_objects(s, nr, batch);
+	} while (nr);
+}
+
 
 /*
  * Object placement in a slab is made very easy because we always start at
@@ -5067,6 +5282,7 @@ static void free_kmem_cache_nodes(struct kmem_cache *s)
 void __kmem_cache_release(struct kmem_cache *s)
 {
 	cache_random_seq_destroy(s);
+	free_percpu(s->cpu_mag);
 	free_percpu(s->cpu_slab);
 	free_kmem_cache_nodes(s);
 }
@@ -5447,6 +5663,42 @@ static int calculate_sizes(struct kmem_cache *s, int forced_order)
 	return !!oo_objects(s->oo);
 }
 
+/*
+ * Smaller objects are allocated and freed at higher rates, give them bigger
+ * magazines. The memory held per cpu stays roughly within a few pages.
+ */
+static unsigned int calculate_magazine_size(struct kmem_cache *s)
+{
+	if (s->size >= PAGE_SIZE)
+		return 8;
+	if (s->size >= 1024)
+		return 16;
+	if (s->size >= 256)
+		return 32;
+	return 64;
+}
+
+static int alloc_kmem_cache_magazines(struct kmem_cache *s)
+{
+	int cpu;
+
+	/* Debug caches need every object to go through the slab checks */
+	if (!(s->flags & SLAB_CPU_MAGAZINE) || kmem_cache_debug(s))
+		return 1;
+
+	s->mag_size = calculate_magazine_size(s);
+	s->cpu_mag = __alloc_percpu(sizeof(struct slub_magazine) +
+				    s->mag_size * sizeof(void *),
+				    sizeof(void *));
+	if (!s->cpu_mag)
+		return 0;
+
+	for_each_possible_cpu(cpu)
+		local_lock_init(&per_cpu_ptr(s->cpu_mag, cpu)->lock);
+
+	return 1;
+}
+
 static int kmem_cache_open(struct kmem_cache *s, slab_flags_t flags)
 {
 /*
@@ -5506,7 +5758,10 @@ static int kmem_cache_open(struct kmem_cache *s, slab_flags_t flags)
 	if (!init_kmem_cache_nodes(s))
 		goto error;
 
-	if (alloc_kmem_cache_cpus(s))
+	if (!alloc_kmem_cache_cpus(s))
+		goto error;
+
+	if (alloc_kmem_cache_magazines(s))
 		return 0;
 
 error:
@@ -5892,11 +6147,24 @@ static int __kmem_cache_do_shrink(struct kmem_cache *s)
 	int ret = 0;
 
 	for_each_kmem_cache_node(s, node, n) {
+		/*
+		 * Racy check. A node without partial slabs has nothing to
+		 * discard or promote, so don't contend on its list_lock with
+		 * the allocation and free slow paths. A partial slab added
+		 * concurrently is left for the next shrink.
+		 */
+		if (!READ_ONCE(n->nr_partial)) {
+			if (slabs_node(s, node))
+				ret = 1;
+			continue;
+		}
+
 		INIT_LIST_HEAD(&discard);
 		for (i = 0; i < SHRINK_PROMOTE_MAX; i++)
 			INIT_LIST_HEAD(promote + i);
 
 		spin_lock_irqsave(&n->list_lock, flags);
+		pstat(s, PSTAT_LIST_LOCK);
 
 		/*
 		 * Build lists of slabs to discard or promote.
@@ -6822,6 +7090,12 @@ static ssize_t cpu_partial_store(struct kmem_cache *s, const char *buf,
 }
 SLAB_ATTR(cpu_partial);
 
+static ssize_t magazine_size_show(struct kmem_cache *s, char *buf)
+{
+	return sysfs_emit(buf, "%u\n", s->cpu_mag ? s->mag_size : 0);
+}
+SLAB_ATTR_RO(magazine_size);
+
 static ssize_t ctor_show(struct kmem_cache *s, char *buf)
 {
 	if (!s->ctor)
@@ -7044,6 +7318,47 @@ static ssize_t remote_node_defrag_ratio_store(struct kmem_cache *s,
 SLAB_ATTR(remote_node_defrag_ratio);
 #endif
 
+static int show_pstat(struct kmem_cache *s, char *buf,
+		      enum slub_pstat_item si)
+{
+	unsigned long sum = 0;
+	int cpu;
+
+	for_each_online_cpu(cpu)
+		sum += per_cpu_ptr(s->cpu_slab, cpu)->pstat[si];
+
+	return sysfs_emit(buf, "%lu\n", sum);
+}
+
+static void clear_pstat(struct kmem_cache *s, enum slub_pstat_item si)
+{
+	int cpu;
+
+	for_each_online_cpu(cpu)
+		per_cpu_ptr(s->cpu_slab, cpu)->pstat[si] = 0;
+}
+
+#define PSTAT_ATTR(si, text)					\
+static ssize_t text##_show(struct kmem_cache *s, char *buf)	\
+{								\
+	return show_pstat(s, buf, si);				\
+}								\
+static ssize_t text##_store(struct kmem_cache *s,		\
+				const char *buf, size_t length)	\
+{								\
+	if (buf[0] != '0')					\
+		return -EINVAL;					\
+	clear_pstat(s, si);					\
+	return length;						\
+}								\
+SLAB_ATTR(text);						\
+
+PSTAT_ATTR(PSTAT_ALLOC_SLOWPATH, slowpath_allocs);
+PSTAT_ATTR(PSTAT_FREE_SLOWPATH, slowpath_frees);
+PSTAT_ATTR(PSTAT_LIST_LOCK, list_lock_acquired);
+PSTAT_ATTR(PSTAT_PARTIAL_SCAN, partial_scanned);
+PSTAT_ATTR(PSTAT_REMOTE_FREE, remote_frees);
+
 #ifdef CONFIG_SLUB_STATS
 static int show_stat(struct kmem_cache *s, char *buf, enum stat_item si)
 {
@@ -7135,6 +7450,7 @@ static struct attribute *slab_attrs[] = {
 	&order_attr.attr,
 	&min_partial_attr.attr,
 	&cpu_partial_attr.attr,
+	&magazine_size_attr.attr,
 	&objects_attr.attr,
 	&objects_partial_attr.attr,
 	&partial_attr.attr,
@@ -7191,6 +7507,11 @@ static struct attribute *slab_attrs[] = {
 	&cpu_partial_node_attr.attr,
 	&cpu_partial_drain_attr.attr,
 #endif
+	&slowpath_allocs_attr.attr,
+	&slowpath_frees_attr.attr,
+	&list_lock_acquired_attr.attr,
+	&partial_scanned_attr.attr,
+	&remote_frees_attr.attr,
 #ifdef CONFIG_FAILSLAB
 	&failslab_attr.attr,
 #endif
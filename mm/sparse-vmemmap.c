@@ -43,6 +43,8 @@
  * @reuse_addr:		the virtual address of the @reuse_page page.
  * @vmemmap_pages:	the list head of the vmemmap pages that can be freed
  *			or is mapped from.
+ * @flags:		used to modify behavior in vmemmap page table walking
+ *			operations.
  */
 struct vmemmap_remap_walk {
 	void (*remap_pte)(pte_t *pte, unsigned long addr,
@@ -51,6 +53,7 @@ struct vmemmap_remap_walk {
 	struct page *reuse_page;
 	unsigned long reuse_addr;
 	struct list_head *vmemmap_pages;
+	unsigned long flags;
 };
 
 static int split_vmemmap_huge_pmd(pmd_t *pmd, unsigned long start,
@@ -80,7 +83,8 @@ static int split_vmemmap_huge_pmd(pmd_t *pmd, unsigned long start,
 	smp_wmb();
 	pmd_populate_kernel(&init_mm, pmd, pgtable);
 
-	flush_tlb_kernel_range(start, start + PMD_SIZE);
+	if (!(walk->flags & VMEMMAP_SPLIT_NO_TLB_FLUSH))
+		flush_tlb_kernel_range(start, start + PMD_SIZE);
 
 	return 0;
 }
@@ -121,6 +125,7 @@ static int vmemmap_pmd_range(pud_t *pud, unsigned long addr,
 
 	pmd = pmd_offset(pud, addr);
 	do {
+		next = pmd_addr_end(addr, end);
 		if (pmd_leaf(*pmd)) {
 			int ret;
 
@@ -128,7 +133,11 @@ static int vmemmap_pmd_range(pud_t *pud, unsigned long addr,
 			if (ret)
 				return ret;
 		}
-		next = pmd_addr_end(addr, end);
+
+		/* Splitting only, see vmemmap_remap_split(). */
+		if (!walk->remap_pte)
+			continue;
+
 		vmemmap_pte_range(pmd, addr, next, walk);
 	} while (pmd++, addr = next, addr != end);
 
@@ -200,7 +209,8 @@ static int vmemmap_remap_range(unsigned long start, unsigned long end,
 	 * [@start + PAGE_SIZE, end), so we only need to flush the TLB which
 	 * belongs to the range.
 	 */
-	flush_tlb_kernel_range(start + PAGE_SIZE, end);
+	if (walk->remap_pte && !(walk->flags & VMEMMAP_REMAP_NO_TLB_FLUSH))
+		flush_tlb_kernel_range(start + PAGE_SIZE, end);
 
 	return 0;
 }
@@ -220,7 +230,7 @@ static inline void free_vmemmap_page(struct page *page)
 }
 
 /* Free a list of the vmemmap pages */
-static void free_vmemmap_page_list(struct list_head *list)
+void free_vmemmap_page_list(struct list_head *list)
 {
 	struct page *page, *next;
 
@@ -245,6 +255,26 @@ static void vmemmap_remap_pte(pte_t *pte, unsigned long addr,
 	set_pte_at(&init_mm, addr, pte, entry);
 }
 
+/*
+ * How many struct page structs need to be reset. When we reuse the head
+ * struct page, the special metadata (e.g. page->flags or page->mapping)
+ * cannot copy to the tail struct page structs. The invalid value will be
+ * checked in the free_tail_pages_check(). In order to avoid the message
+ * of "corrupted mapping in tail page". We need to reset at least 3 (one
+ * head struct page struct and two tail struct page structs) struct page
+ * structs.
+ */
+#define NR_RESET_STRUCT_PAGE		3
+
+static inline void reset_struct_pages(struct page *start)
+{
+	int i;
+	struct page *from = start + NR_RESET_STRUCT_PAGE;
+
+	for (i = 0; i < NR_RESET_STRUCT_PAGE; i++)
+		memcpy(start + i, from, sizeof(*from));
+}
+
 static void vmemmap_restore_pte(pte_t *pte, unsigned long addr,
 				struct vmemmap_remap_walk *walk)
 {
@@ -258,10 +288,45 @@ static void vmemmap_restore_pte(pte_t *pte, unsigned long addr,
 	list_del(&page->lru);
 	to = page_to_virt(page);
 	copy_page(to, (void *)walk->reuse_addr);
+	reset_struct_pages(to);
 
 	set_pte_at(&init_mm, addr, pte, mk_pte(page, pgprot));
 }
 
+/**
+ * vmemmap_remap_split - split the vmemmap virtual address range [@start, @end)
+ *			 backing PMDs of the directmap into PTEs
+ * @start:	start address of the vmemmap virtual address range that we want
+ *		to remap.
+ * @end:	end address of the vmemmap virtual address range that we want to
+ *		remap.
+ * @reuse:	reuse address.
+ *
+ * The TLB is not flushed here, the caller has to do it before the range is
+ * remapped. This allows the PMDs of many HugeTLB pages to be split with a
+ * single flush.
+ *
+ * Return: %0 on success, negative error code otherwise.
+ */
+int vmemmap_remap_split(unsigned long start, unsigned long end,
+			unsigned long reuse)
+{
+	int ret;
+	struct vmemmap_remap_walk walk = {
+		.remap_pte	= NULL,
+		.flags		= VMEMMAP_SPLIT_NO_TLB_FLUSH,
+	};
+
+	/* See the comment in the vmemmap_remap_free(). */
+	BUG_ON(start - reuse != PAGE_SIZE);
+
+	mmap_write_lock(&init_mm);
+	ret = vmemmap_remap_range(reuse, end, &walk);
+	mmap_write_unlock(&init_mm);
+
+	return ret;
+}
+
 /**
  * vmemmap_remap_free - remap the vmemmap virtual address range [@start, @end)
  *			to the page which @reuse is mapped to, then free vmemmap
@@ -271,11 +336,19 @@ static void vmemmap_restore_pte(pte_t *pte, unsigned long addr,
  * @end:	end address of the vmemmap virtual address range that we want to
  *		remap.
  * @reuse:	reuse address.
+ * @freed_pages: list to hand the vmemmap pages over to instead of freeing
+ *		them, may be %NULL.
+ * @flags:	modifications to the walk, e.g. VMEMMAP_REMAP_NO_TLB_FLUSH.
+ *
+ * With VMEMMAP_REMAP_NO_TLB_FLUSH the caller is responsible for flushing
+ * the TLB and has to pass @freed_pages, since the pages must not be freed
+ * before stale translations to them are gone.
  *
  * Return: %0 on success, negative error code otherwise.
  */
 int vmemmap_remap_free(unsigned long start, unsigned long end,
-		       unsigned long reuse)
+		       unsigned long reuse, struct list_head *freed_pages,
+		       unsigned long flags)
 {
 	int ret;
 	LIST_HEAD(vmemmap_pages);
@@ -283,6 +356,7 @@ int vmemmap_remap_free(unsigned long start, unsigned long end,
 		.remap_pte	= vmemmap_remap_pte,
 		.reuse_addr	= reuse,
 		.vmemmap_pages	= &vmemmap_pages,
+		.flags		= flags,
 	};
 
 	/*
@@ -316,13 +390,17 @@ int vmemmap_remap_free(unsigned long start, unsigned long end,
 			.remap_pte	= vmemmap_restore_pte,
 			.reuse_addr	= reuse,
 			.vmemmap_pages	= &vmemmap_pages,
+			.flags		= flags,
 		};
 
 		vmemmap_remap_range(reuse, end, &walk);
 	}
 	mmap_read_unlock(&init_mm);
 
-	free_vmemmap_page_list(&vmemmap_pages);
+	if (freed_pages)
+		list_splice_tail(&vmemmap_pages, freed_pages);
+	else
+		free_vmemmap_page_list(&vmemmap_pages);
 
 	return ret;
 }
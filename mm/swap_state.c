@@ -68,8 +68,6 @@ static struct {
 	unsigned long find_total;
 } swap_cache_info;
 
-static atomic_t swapin_readahead_hits = ATOMIC_INIT(4);
-
 void show_swap_cache_info(void)
 {
 	printk("%lu pages in swap cache\n", total_swapcache_pages());
@@ -328,9 +326,15 @@ void free_pages_and_swap_cache(struct page **pages, int nr)
 	release_pages(pagep, nr);
 }
 
-static inline bool swap_use_vma_readahead(void)
+/*
+ * VMA based readahead only pays off when reading scattered offsets is
+ * cheap, so rotational devices keep using cluster readahead even when
+ * they share the system with SSDs.
+ */
+static inline bool swap_use_vma_readahead(struct swap_info_struct *si)
 {
-	return READ_ONCE(enable_vma_readahead) && !atomic_read(&nr_rotate_swap);
+	return READ_ONCE(enable_vma_readahead) &&
+		(si->flags & SWP_SOLIDSTATE);
 }
 
 /*
@@ -353,7 +357,7 @@ struct page *lookup_swap_cache(swp_entry_t entry, struct vm_area_struct *vma,
 
 	INC_CACHE_INFO(find_total);
 	if (page) {
-		bool vma_ra = swap_use_vma_readahead();
+		bool vma_ra = swap_use_vma_readahead(si);
 		bool readahead;
 
 		INC_CACHE_INFO(find_success);
@@ -381,7 +385,7 @@ struct page *lookup_swap_cache(swp_entry_t entry, struct vm_area_struct *vma,
 		if (readahead) {
 			count_vm_event(SWAP_RA_HIT);
 			if (!vma || !vma_ra)
-				atomic_inc(&swapin_readahead_hits);
+				atomic_inc(&si->ra_hits);
 		}
 	}
 
@@ -579,23 +583,22 @@ static unsigned int __swapin_nr_pages(unsigned long prev_offset,
 	return pages;
 }
 
-static unsigned long swapin_nr_pages(unsigned long offset)
+static unsigned long swapin_nr_pages(struct swap_info_struct *si,
+				     unsigned long offset)
 {
-	static unsigned long prev_offset;
 	unsigned int hits, pages, max_pages;
-	static atomic_t last_readahead_pages;
 
 	max_pages = 1 << READ_ONCE(page_cluster);
 	if (max_pages <= 1)
 		return 1;
 
-	hits = atomic_xchg(&swapin_readahead_hits, 0);
-	pages = __swapin_nr_pages(READ_ONCE(prev_offset), offset, hits,
+	hits = atomic_xchg(&si->ra_hits, 0);
+	pages = __swapin_nr_pages(READ_ONCE(si->ra_prev_offset), offset, hits,
 				  max_pages,
-				  atomic_read(&last_readahead_pages));
+				  atomic_read(&si->ra_win));
 	if (!hits)
-		WRITE_ONCE(prev_offset, offset);
-	atomic_set(&last_readahead_pages, pages);
+		WRITE_ONCE(si->ra_prev_offset, offset);
+	atomic_set(&si->ra_win, pages);
 
 	return pages;
 }
@@ -632,7 +635,7 @@ struct page *swap_cluster_readahead(swp_entry_t entry, gfp_t gfp_mask,
 	struct vm_area_struct *vma = vmf->vma;
 	unsigned long addr = vmf->address;
 
-	mask = swapin_nr_pages(offset) - 1;
+	mask = swapin_nr_pages(si, offset) - 1;
 	if (!mask)
 		goto skip;
 
@@ -857,7 +860,19 @@ static struct page *swap_vma_readahead(swp_entry_t fentry, gfp_t gfp_mask,
 struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 				struct vm_fault *vmf)
 {
-	return swap_use_vma_readahead() ?
+	struct swap_info_struct *si = swp_swap_info(entry);
+
+	/*
+	 * Devices like zram complete reads synchronously at memory speed,
+	 * readahead only adds swap cache pages nobody asked for.
+	 */
+	if (data_race(si->flags & SWP_SYNCHRONOUS_IO)) {
+		count_vm_event(SWAP_RA_SKIP);
+		return read_swap_cache_async(entry, gfp_mask, vmf->vma,
+					     vmf->address, true);
+	}
+
+	return swap_use_vma_readahead(si) ?
 			swap_vma_readahead(entry, gfp_mask, vmf) :
 			swap_cluster_readahead(entry, gfp_mask, vmf);
 }
@@ -1042,6 +1042,7 @@ int get_swap_pages(int n_goal, swp_entry_t swp_entries[], int entry_size)
 	struct swap_info_struct *si, *next;
 	long avail_pgs;
 	int n_ret = 0;
+	int cluster_tries = 0;
 	int node;
 
 	/* Only single cluster request supported */
@@ -1089,8 +1090,26 @@ int get_swap_pages(int n_goal, swp_entry_t swp_entries[], int entry_size)
 			n_ret = scan_swap_map_slots(si, SWAP_HAS_CACHE,
 						    n_goal, swp_entries);
 		spin_unlock(&si->lock);
-		if (n_ret || size == SWAPFILE_CLUSTER)
+		if (n_ret)
+			goto check_out;
+		if (size == SWAPFILE_CLUSTER) {
+			/*
+			 * Before the caller falls back to splitting the huge
+			 * page, try the other devices of the same priority:
+			 * swap striped over several disks usually has a free
+			 * cluster on one of them.  Lower priorities are left
+			 * alone, splitting is preferable to ignoring them.
+			 */
+			if (++cluster_tries < nr_swapfiles &&
+			    !list_entry_is_head(next,
+					&swap_avail_heads[node].node_list,
+					avail_lists[node].node_list) &&
+			    next->prio == si->prio) {
+				spin_lock(&swap_avail_lock);
+				goto nextsi;
+			}
 			goto check_out;
+		}
 		pr_debug("scan_swap_map of si %d failed to find offset\n",
 			si->type);
 
@@ -2922,6 +2941,10 @@ static struct swap_info_struct *alloc_swap_info(void)
 	spin_lock_init(&p->lock);
 	spin_lock_init(&p->cont_lock);
 	init_completion(&p->comp);
+	/* Start up cluster readahead with a small window */
+	atomic_set(&p->ra_hits, 4);
+	atomic_set(&p->ra_win, 0);
+	p->ra_prev_offset = 0;
 
 	return p;
 }
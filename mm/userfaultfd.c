@@ -15,6 +15,7 @@
 #include <linux/mmu_notifier.h>
 #include <linux/hugetlb.h>
 #include <linux/shmem_fs.h>
+#include <asm/pgalloc.h>
 #include <asm/tlbflush.h>
 #include "internal.h"
 
@@ -598,6 +599,13 @@ static __always_inline ssize_t __mcopy_atomic(struct mm_struct *dst_mm,
 			err = -EFAULT;
 			break;
 		}
+		/* The entry must not show up in the mms sharing the table */
+		if (unlikely(pte_table_shared(dst_pmd)) &&
+		    unshare_pte_table(dst_vma, dst_pmd, dst_addr,
+				      GFP_PGTABLE_USER)) {
+			err = -ENOMEM;
+			break;
+		}
 
 		BUG_ON(pmd_none(*dst_pmd));
 		BUG_ON(pmd_trans_huge(*dst_pmd));
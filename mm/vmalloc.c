@@ -762,25 +762,50 @@ EXPORT_SYMBOL(vmalloc_to_pfn);
 #define DEBUG_AUGMENT_LOWEST_MATCH_CHECK 0
 
 
-static DEFINE_SPINLOCK(vmap_area_lock);
 static DEFINE_SPINLOCK(free_vmap_area_lock);
-/* Export for kexec only */
+static bool vmap_initialized __read_mostly;
 
+/*
+ * An address sorted rb-tree and list of vmap areas together with
+ * the lock protecting both of them.
+ */
+struct rb_list {
+	struct rb_root root;
+	struct list_head head;
+	spinlock_t lock;
+};
+
+/*
+ * Busy and lazily-freed areas are not kept in one tree behind a global
+ * lock, instead they are spread over several vmap nodes. The KVA space
+ * is split into zones of vmap_zone_size bytes which are bound to nodes
+ * in a round-robin way, see addr_to_node_id(). An area belongs to the
+ * node its va_start address falls into, so concurrent allocations and
+ * frees of neighbouring areas mostly end up on different locks.
+ */
+struct vmap_node {
 /*
  * IAMROOT, 2022.07.02: 
  * 1) vmalloc 자료 구조에서 할당 공간을 관리하는 list와 rb tree
  */
-LIST_HEAD(vmap_area_list);
-static struct rb_root vmap_area_root = RB_ROOT;
-static bool vmap_initialized __read_mostly;
+	struct rb_list busy;
 
 /*
  * IAMROOT, 2022.07.02: 
  * 2) vmalloc 자료 구조에서 lazy free 요청을 관리하는 list와 rb tree
  */
-static struct rb_root purge_vmap_area_root = RB_ROOT;
-static LIST_HEAD(purge_vmap_area_list);
-static DEFINE_SPINLOCK(purge_vmap_area_lock);
+	struct rb_list lazy;
+};
+
+/*
+ * Until vmalloc_init() has set up the node array everything goes to
+ * a single node, which is also the fallback if the array can not be
+ * allocated.
+ */
+static struct vmap_node single;
+static struct vmap_node *vmap_nodes = &single;
+static __read_mostly unsigned int nr_vmap_nodes = 1;
+static __read_mostly unsigned int vmap_zone_size = 1;
 
 /*
  * This kmem_cache is used for vmap_area objects. Instead of
@@ -859,10 +884,23 @@ unsigned long vmalloc_nr_pages(void)
 	return atomic_long_read(&nr_vmalloc_pages);
 }
 
-static struct vmap_area *find_vmap_area_exceed_addr(unsigned long addr)
+static inline unsigned int
+addr_to_node_id(unsigned long addr)
+{
+	return (addr / vmap_zone_size) % nr_vmap_nodes;
+}
+
+static inline struct vmap_node *
+addr_to_node(unsigned long addr)
+{
+	return &vmap_nodes[addr_to_node_id(addr)];
+}
+
+static struct vmap_area *
+find_vmap_area_exceed_addr(unsigned long addr, struct rb_root *root)
 {
 	struct vmap_area *va = NULL;
-	struct rb_node *n = vmap_area_root.rb_node;
+	struct rb_node *n = root->rb_node;
 
 	while (n) {
 		struct vmap_area *tmp;
@@ -886,9 +924,9 @@ static struct vmap_area *find_vmap_area_exceed_addr(unsigned long addr)
  * vmalloc 자료구조에서 @addr에 해당하는 vmap_area를 찾는다.
  * 못 잧은 경우 null을 반환한다.
  */
-static struct vmap_area *__find_vmap_area(unsigned long addr)
+static struct vmap_area *__find_vmap_area(unsigned long addr, struct rb_root *root)
 {
-	struct rb_node *n = vmap_area_root.rb_node;
+	struct rb_node *n = root->rb_node;
 
 	while (n) {
 		struct vmap_area *va;
@@ -905,6 +943,50 @@ static struct vmap_area *__find_vmap_area(unsigned long addr)
 	return NULL;
 }
 
+/*
+ * Returns the lowest addressed busy area which ends above @addr. Areas
+ * are spread over all nodes, so every node has to be looked at. On
+ * success the busy lock of the node owning the area is held and the
+ * node is returned, otherwise NULL.
+ */
+static struct vmap_node *
+find_vmap_area_exceed_addr_lock(unsigned long addr, struct vmap_area **va)
+{
+	unsigned long va_start_lowest;
+	struct vmap_node *vn;
+	int i;
+
+repeat:
+	for (i = 0, va_start_lowest = 0; i < nr_vmap_nodes; i++) {
+		vn = &vmap_nodes[i];
+
+		spin_lock(&vn->busy.lock);
+		*va = find_vmap_area_exceed_addr(addr, &vn->busy.root);
+		if (*va)
+			if (!va_start_lowest || (*va)->va_start < va_start_lowest)
+				va_start_lowest = (*va)->va_start;
+		spin_unlock(&vn->busy.lock);
+	}
+
+	/*
+	 * Re-check, the area may have been released while the lock of its
+	 * node was not held.
+	 */
+	if (va_start_lowest) {
+		vn = addr_to_node(va_start_lowest);
+
+		spin_lock(&vn->busy.lock);
+		*va = __find_vmap_area(va_start_lowest, &vn->busy.root);
+		if (*va)
+			return vn;
+
+		spin_unlock(&vn->busy.lock);
+		goto repeat;
+	}
+
+	return NULL;
+}
+
 /*
  * This function returns back addresses of parent node
  * and its left or right link for further processing.
@@ -1863,12 +1945,14 @@ __alloc_vmap_area(unsigned long size, unsigned long align,
  */
 static void free_vmap_area(struct vmap_area *va)
 {
+	struct vmap_node *vn = addr_to_node(va->va_start);
+
 	/*
 	 * Remove from the busy tree/list.
 	 */
-	spin_lock(&vmap_area_lock);
-	unlink_va(va, &vmap_area_root);
-	spin_unlock(&vmap_area_lock);
+	spin_lock(&vn->busy.lock);
+	unlink_va(va, &vn->busy.root);
+	spin_unlock(&vn->busy.lock);
 
 	/*
 	 * Insert/Merge it back to the free tree/list.
@@ -1915,6 +1999,7 @@ static struct vmap_area *alloc_vmap_area(unsigned long size,
 				unsigned long vstart, unsigned long vend,
 				int node, gfp_t gfp_mask)
 {
+	struct vmap_node *vn;
 	struct vmap_area *va;
 	unsigned long freed;
 	unsigned long addr;
@@ -1973,9 +2058,11 @@ static struct vmap_area *alloc_vmap_area(unsigned long size,
 	va->va_end = addr + size;
 	va->vm = NULL;
 
-	spin_lock(&vmap_area_lock);
-	insert_vmap_area(va, &vmap_area_root, &vmap_area_list);
-	spin_unlock(&vmap_area_lock);
+	vn = addr_to_node(va->va_start);
+
+	spin_lock(&vn->busy.lock);
+	insert_vmap_area(va, &vn->busy.root, &vn->busy.head);
+	spin_unlock(&vn->busy.lock);
 
 	BUG_ON(!IS_ALIGNED(va->va_start, align));
 	BUG_ON(va->va_start < vstart);
@@ -2094,8 +2181,10 @@ void set_iounmap_nonlazy(void)
 static bool __purge_vmap_area_lazy(unsigned long start, unsigned long end)
 {
 	unsigned long resched_threshold;
-	struct list_head local_pure_list;
+	LIST_HEAD(local_pure_list);
 	struct vmap_area *va, *n_va;
+	struct vmap_node *vn;
+	int i;
 
 	lockdep_assert_held(&vmap_purge_lock);
 
@@ -2104,26 +2193,44 @@ static bool __purge_vmap_area_lazy(unsigned long start, unsigned long end)
  * purge용 자료 구조 rb tree에는 RB_ROOT로 초기화하고,
  * list의 내용은 local로 옮긴다.
  */
-	spin_lock(&purge_vmap_area_lock);
-	purge_vmap_area_root = RB_ROOT;
-	list_replace_init(&purge_vmap_area_list, &local_pure_list);
-	spin_unlock(&purge_vmap_area_lock);
+	for (i = 0; i < nr_vmap_nodes; i++) {
+		LIST_HEAD(node_list);
 
-	if (unlikely(list_empty(&local_pure_list)))
-		return false;
+		vn = &vmap_nodes[i];
+		if (RB_EMPTY_ROOT(&vn->lazy.root))
+			continue;
+
+		spin_lock(&vn->lazy.lock);
+		vn->lazy.root = RB_ROOT;
+		list_replace_init(&vn->lazy.head, &node_list);
+		spin_unlock(&vn->lazy.lock);
+
+		if (list_empty(&node_list))
+			continue;
 
 /*
  * IAMROOT, 2022.07.02: 
  * purge 리스트의 첫 엔트리 시작 주소 부터 마지막 엔트리 끝 주소까지
  * tlb flush를 진행한다.
  */
-	start = min(start,
-		list_first_entry(&local_pure_list,
-			struct vmap_area, list)->va_start);
+		start = min(start,
+			list_first_entry(&node_list,
+				struct vmap_area, list)->va_start);
 
-	end = max(end,
-		list_last_entry(&local_pure_list,
-			struct vmap_area, list)->va_end);
+		end = max(end,
+			list_last_entry(&node_list,
+				struct vmap_area, list)->va_end);
+
+		/*
+		 * Each node list is address sorted but the nodes interleave,
+		 * the merge into the free tree below does not care about the
+		 * order though.
+		 */
+		list_splice_tail(&node_list, &local_pure_list);
+	}
+
+	if (unlikely(list_empty(&local_pure_list)))
+		return false;
 
 /*
  * IAMROOT, 2022.07.02: 
@@ -2210,11 +2317,12 @@ static void purge_vmap_area_lazy(void)
  */
 static void free_vmap_area_noflush(struct vmap_area *va)
 {
+	struct vmap_node *vn = addr_to_node(va->va_start);
 	unsigned long nr_lazy;
 
-	spin_lock(&vmap_area_lock);
-	unlink_va(va, &vmap_area_root);
-	spin_unlock(&vmap_area_lock);
+	spin_lock(&vn->busy.lock);
+	unlink_va(va, &vn->busy.root);
+	spin_unlock(&vn->busy.lock);
 
 	nr_lazy = atomic_long_add_return((va->va_end - va->va_start) >>
 				PAGE_SHIFT, &vmap_lazy_nr);
@@ -2222,10 +2330,9 @@ static void free_vmap_area_noflush(struct vmap_area *va)
 	/*
 	 * Merge or place it to the purge tree/list.
 	 */
-	spin_lock(&purge_vmap_area_lock);
-	merge_or_add_vmap_area(va,
-		&purge_vmap_area_root, &purge_vmap_area_list);
-	spin_unlock(&purge_vmap_area_lock);
+	spin_lock(&vn->lazy.lock);
+	merge_or_add_vmap_area(va, &vn->lazy.root, &vn->lazy.head);
+	spin_unlock(&vn->lazy.lock);
 
 	/* After this point, we may free va at any time */
 /*
@@ -2269,13 +2376,43 @@ static void free_unmap_vmap_area(struct vmap_area *va)
  * vmalloc 자료구조에서 @addr에 해당하는 vmap_area를 찾는다.
  * 못 잧은 경우 null을 반환한다.
  */
+static struct vmap_area *
+find_vmap_area_lock(unsigned long addr, struct vmap_node **vnp)
+{
+	struct vmap_node *vn;
+	struct vmap_area *va;
+	int i, j;
+
+	/*
+	 * An area is kept by the node its va_start belongs to, but @addr
+	 * may point into the middle of an area spanning several zones.
+	 * Start with the node @addr maps to, which is the usual hit, and
+	 * fall back to the other ones.
+	 */
+	i = j = addr_to_node_id(addr);
+	do {
+		vn = &vmap_nodes[i];
+
+		spin_lock(&vn->busy.lock);
+		va = __find_vmap_area(addr, &vn->busy.root);
+		if (va) {
+			*vnp = vn;
+			return va;
+		}
+		spin_unlock(&vn->busy.lock);
+	} while ((i = (i + 1) % nr_vmap_nodes) != j);
+
+	return NULL;
+}
+
 static struct vmap_area *find_vmap_area(unsigned long addr)
 {
+	struct vmap_node *vn;
 	struct vmap_area *va;
 
-	spin_lock(&vmap_area_lock);
-	va = __find_vmap_area(addr);
-	spin_unlock(&vmap_area_lock);
+	va = find_vmap_area_lock(addr, &vn);
+	if (va)
+		spin_unlock(&vn->busy.lock);
 
 	return va;
 }
@@ -2881,7 +3018,8 @@ static void vmap_init_free_space(void)
 {
 	unsigned long vmap_start = 1;
 	const unsigned long vmap_end = ULONG_MAX;
-	struct vmap_area *busy, *free;
+	struct vmap_area *free;
+	struct vm_struct *busy;
 
 	/*
 	 *     B     F     B     B     B     F
@@ -2894,17 +3032,17 @@ static void vmap_init_free_space(void)
  * 위의 그림은 4개의 va(busy)가 등록되어 있다.
  * 이후 추가 2개의 va(free)가 free 공간 관리용 RB 트리와 list에 추가될 예정이다.
  */
-	list_for_each_entry(busy, &vmap_area_list, list) {
+	for (busy = vmlist; busy; busy = busy->next) {
 /*
  * IAMROOT, 2022.07.02: 
  * busy 공간 사이의 free 영역용 공간을 할당받아 초기화한 후,
  * free 공간 관리용 RB 트리와 list에 추가한다.
  */
-		if (busy->va_start - vmap_start > 0) {
+		if ((unsigned long) busy->addr - vmap_start > 0) {
 			free = kmem_cache_zalloc(vmap_area_cachep, GFP_NOWAIT);
 			if (!WARN_ON_ONCE(!free)) {
 				free->va_start = vmap_start;
-				free->va_end = busy->va_start;
+				free->va_end = (unsigned long) busy->addr;
 
 				insert_vmap_area_augment(free, NULL,
 					&free_vmap_area_root,
@@ -2912,7 +3050,7 @@ static void vmap_init_free_space(void)
 			}
 		}
 
-		vmap_start = busy->va_end;
+		vmap_start = (unsigned long) busy->addr + busy->size;
 	}
 
 /*
@@ -2932,8 +3070,48 @@ static void vmap_init_free_space(void)
 	}
 }
 
+static void __init vmap_init_nodes(void)
+{
+	struct vmap_node *vn;
+	int i, n;
+
+#if BITS_PER_LONG == 64
+	/*
+	 * The number of nodes follows the number of possible CPUs, which
+	 * bounds the number of concurrent users, but is capped to keep the
+	 * cost of the cross-node lookups done by find_vmap_area() and
+	 * vread() reasonable. A 32-bit KVA space is too small to be worth
+	 * splitting.
+	 */
+	n = clamp_t(unsigned int, num_possible_cpus(), 1, 128);
+	if (n > 1) {
+		vn = kmalloc_array(n, sizeof(*vn), GFP_NOWAIT | __GFP_NOWARN);
+		if (vn) {
+			/* Node partition is 16 pages. */
+			vmap_zone_size = (1 << 4) * PAGE_SIZE;
+			nr_vmap_nodes = n;
+			vmap_nodes = vn;
+		} else {
+			pr_err("Failed to allocate vmap nodes, using a single one\n");
+		}
+	}
+#endif
+
+	for (i = 0; i < nr_vmap_nodes; i++) {
+		vn = &vmap_nodes[i];
+		vn->busy.root = RB_ROOT;
+		INIT_LIST_HEAD(&vn->busy.head);
+		spin_lock_init(&vn->busy.lock);
+
+		vn->lazy.root = RB_ROOT;
+		INIT_LIST_HEAD(&vn->lazy.head);
+		spin_lock_init(&vn->lazy.lock);
+	}
+}
+
 void __init vmalloc_init(void)
 {
+	struct vmap_node *vn;
 	struct vmap_area *va;
 	struct vm_struct *tmp;
 	int i;
@@ -2948,6 +3126,7 @@ void __init vmalloc_init(void)
  *   내부에서 자동 지정한다.
  */
 	vmap_area_cachep = KMEM_CACHE(vmap_area, SLAB_PANIC);
+	vmap_init_nodes();
 
 /*
  * IAMROOT, 2022.07.02: 
@@ -2980,7 +3159,9 @@ void __init vmalloc_init(void)
 		va->va_start = (unsigned long)tmp->addr;
 		va->va_end = va->va_start + tmp->size;
 		va->vm = tmp;
-		insert_vmap_area(va, &vmap_area_root, &vmap_area_list);
+
+		vn = addr_to_node(va->va_start);
+		insert_vmap_area(va, &vn->busy.root, &vn->busy.head);
 	}
 
 	/*
@@ -3016,9 +3197,11 @@ static inline void setup_vmalloc_vm_locked(struct vm_struct *vm,
 static void setup_vmalloc_vm(struct vm_struct *vm, struct vmap_area *va,
 			      unsigned long flags, const void *caller)
 {
-	spin_lock(&vmap_area_lock);
+	struct vmap_node *vn = addr_to_node(va->va_start);
+
+	spin_lock(&vn->busy.lock);
 	setup_vmalloc_vm_locked(vm, va, flags, caller);
-	spin_unlock(&vmap_area_lock);
+	spin_unlock(&vn->busy.lock);
 }
 
 static void clear_vm_uninitialized_flag(struct vm_struct *vm)
@@ -3177,17 +3360,20 @@ struct vm_struct *find_vm_area(const void *addr)
  */
 struct vm_struct *remove_vm_area(const void *addr)
 {
+	struct vmap_node *vn;
 	struct vmap_area *va;
 
 	might_sleep();
 
-	spin_lock(&vmap_area_lock);
-	va = __find_vmap_area((unsigned long)addr);
-	if (va && va->vm) {
+	va = find_vmap_area_lock((unsigned long)addr, &vn);
+	if (!va)
+		return NULL;
+
+	if (va->vm) {
 		struct vm_struct *vm = va->vm;
 
 		va->vm = NULL;
-		spin_unlock(&vmap_area_lock);
+		spin_unlock(&vn->busy.lock);
 
 		kasan_free_shadow(vm);
 		free_unmap_vmap_area(va);
@@ -3195,7 +3381,7 @@ struct vm_struct *remove_vm_area(const void *addr)
 		return vm;
 	}
 
-	spin_unlock(&vmap_area_lock);
+	spin_unlock(&vn->busy.lock);
 	return NULL;
 }
 
@@ -4260,39 +4446,39 @@ static int aligned_vread(char *buf, char *addr, unsigned long count)
  */
 long vread(char *buf, char *addr, unsigned long count)
 {
+	struct vmap_node *vn;
 	struct vmap_area *va;
 	struct vm_struct *vm;
 	char *vaddr, *buf_start = buf;
 	unsigned long buflen = count;
-	unsigned long n;
+	unsigned long n, next;
 
 	/* Don't allow overflow */
 	if ((unsigned long) addr + count < count)
 		count = -(unsigned long) addr;
 
-	spin_lock(&vmap_area_lock);
-	va = find_vmap_area_exceed_addr((unsigned long)addr);
-	if (!va)
+	vn = find_vmap_area_exceed_addr_lock((unsigned long)addr, &va);
+	if (!vn)
 		goto finished;
 
 	/* no intersects with alive vmap_area */
 	if ((unsigned long)addr + count <= va->va_start)
-		goto finished;
+		goto finished_unlock;
 
-	list_for_each_entry_from(va, &vmap_area_list, list) {
+	do {
 		if (!count)
 			break;
 
 		if (!va->vm)
-			continue;
+			goto next_va;
 
 		vm = va->vm;
 		vaddr = (char *) vm->addr;
 		if (addr >= vaddr + get_vm_area_size(vm))
-			continue;
+			goto next_va;
 		while (addr < vaddr) {
 			if (count == 0)
-				goto finished;
+				goto finished_unlock;
 			*buf = '\0';
 			buf++;
 			addr++;
@@ -4308,9 +4494,15 @@ long vread(char *buf, char *addr, unsigned long count)
 		buf += n;
 		addr += n;
 		count -= n;
-	}
+next_va:
+		next = va->va_end;
+		spin_unlock(&vn->busy.lock);
+	} while ((vn = find_vmap_area_exceed_addr_lock(next, &va)));
+
+finished_unlock:
+	if (vn)
+		spin_unlock(&vn->busy.lock);
 finished:
-	spin_unlock(&vmap_area_lock);
 
 	if (buf == buf_start)
 		return 0;
@@ -4657,14 +4849,15 @@ struct vm_struct **pcpu_get_vm_areas(const unsigned long *offsets,
 	}
 
 	/* insert all vm's */
-	spin_lock(&vmap_area_lock);
 	for (area = 0; area < nr_vms; area++) {
-		insert_vmap_area(vas[area], &vmap_area_root, &vmap_area_list);
+		struct vmap_node *vn = addr_to_node(vas[area]->va_start);
 
+		spin_lock(&vn->busy.lock);
+		insert_vmap_area(vas[area], &vn->busy.root, &vn->busy.head);
 		setup_vmalloc_vm_locked(vms[area], vas[area], VM_ALLOC,
 				 pcpu_get_vm_areas);
+		spin_unlock(&vn->busy.lock);
 	}
-	spin_unlock(&vmap_area_lock);
 
 	kfree(vas);
 	return vms;
@@ -4776,33 +4969,11 @@ bool vmalloc_dump_obj(void *object)
 #endif
 
 #ifdef CONFIG_PROC_FS
-static void *s_start(struct seq_file *m, loff_t *pos)
-	__acquires(&vmap_purge_lock)
-	__acquires(&vmap_area_lock)
-{
-	mutex_lock(&vmap_purge_lock);
-	spin_lock(&vmap_area_lock);
-
-	return seq_list_start(&vmap_area_list, *pos);
-}
-
-static void *s_next(struct seq_file *m, void *p, loff_t *pos)
-{
-	return seq_list_next(p, &vmap_area_list, pos);
-}
-
-static void s_stop(struct seq_file *m, void *p)
-	__releases(&vmap_area_lock)
-	__releases(&vmap_purge_lock)
-{
-	spin_unlock(&vmap_area_lock);
-	mutex_unlock(&vmap_purge_lock);
-}
-
-static void show_numa_info(struct seq_file *m, struct vm_struct *v)
+static void show_numa_info(struct seq_file *m, struct vm_struct *v,
+			   unsigned int *counters)
 {
 	if (IS_ENABLED(CONFIG_NUMA)) {
-		unsigned int nr, *counters = m->private;
+		unsigned int nr;
 
 		if (!counters)
 			return;
@@ -4825,26 +4996,30 @@ static void show_numa_info(struct seq_file *m, struct vm_struct *v)
 
 static void show_purge_info(struct seq_file *m)
 {
+	struct vmap_node *vn;
 	struct vmap_area *va;
+	int i;
 
-	spin_lock(&purge_vmap_area_lock);
-	list_for_each_entry(va, &purge_vmap_area_list, list) {
-		seq_printf(m, "0x%pK-0x%pK %7ld unpurged vm_area\n",
-			(void *)va->va_start, (void *)va->va_end,
-			va->va_end - va->va_start);
+	for (i = 0; i < nr_vmap_nodes; i++) {
+		vn = &vmap_nodes[i];
+
+		spin_lock(&vn->lazy.lock);
+		list_for_each_entry(va, &vn->lazy.head, list) {
+			seq_printf(m, "0x%pK-0x%pK %7ld unpurged vm_area\n",
+				(void *)va->va_start, (void *)va->va_end,
+				va->va_end - va->va_start);
+		}
+		spin_unlock(&vn->lazy.lock);
 	}
-	spin_unlock(&purge_vmap_area_lock);
 }
 
-static int s_show(struct seq_file *m, void *p)
+static void show_vmap_area(struct seq_file *m, struct vmap_area *va,
+			   unsigned int *counters)
 {
-	struct vmap_area *va;
 	struct vm_struct *v;
 
-	va = list_entry(p, struct vmap_area, list);
-
 	/*
-	 * s_show can encounter race with remove_vm_area, !vm on behalf
+	 * show_vmap_area can encounter race with remove_vm_area, !vm on behalf
 	 * of vmap area is being tear down or vm_map_ram allocation.
 	 */
 	if (!va->vm) {
@@ -4852,7 +5027,7 @@ static int s_show(struct seq_file *m, void *p)
 			(void *)va->va_start, (void *)va->va_end,
 			va->va_end - va->va_start);
 
-		return 0;
+		return;
 	}
 
 	v = va->vm;
@@ -4887,25 +5062,43 @@ static int s_show(struct seq_file *m, void *p)
 	if (is_vmalloc_addr(v->pages))
 		seq_puts(m, " vpages");
 
-	show_numa_info(m, v);
+	show_numa_info(m, v, counters);
 	seq_putc(m, '\n');
+}
+
+static int vmalloc_info_show(struct seq_file *m, void *p)
+{
+	unsigned long addr = 0;
+	unsigned int *counters = NULL;
+	struct vmap_node *vn;
+	struct vmap_area *va;
+
+	if (IS_ENABLED(CONFIG_NUMA))
+		counters = kmalloc_array(nr_node_ids, sizeof(unsigned int),
+					 GFP_KERNEL);
+
+	mutex_lock(&vmap_purge_lock);
+
+	/*
+	 * Walk the busy areas of all nodes in address order, so the
+	 * output stays sorted as it always has been.
+	 */
+	while ((vn = find_vmap_area_exceed_addr_lock(addr, &va))) {
+		addr = va->va_end;
+		show_vmap_area(m, va, counters);
+		spin_unlock(&vn->busy.lock);
+	}
 
 	/*
 	 * As a final step, dump "unpurged" areas.
 	 */
-	if (list_is_last(&va->list, &vmap_area_list))
-		show_purge_info(m);
+	show_purge_info(m);
+	mutex_unlock(&vmap_purge_lock);
 
+	kfree(counters);
 	return 0;
 }
 
-static const struct seq_operations vmalloc_op = {
-	.start = s_start,
-	.next = s_next,
-	.stop = s_stop,
-	.show = s_show,
-};
-
 /*
  * IAMROOT, 2022.07.02: 
  * 
@@ -4917,12 +5110,7 @@ static const struct seq_operations vmalloc_op = {
  */
 static int __init proc_vmalloc_init(void)
 {
-	if (IS_ENABLED(CONFIG_NUMA))
-		proc_create_seq_private("vmallocinfo", 0400, NULL,
-				&vmalloc_op,
-				nr_node_ids * sizeof(unsigned int), NULL);
-	else
-		proc_create_seq("vmallocinfo", 0400, NULL, &vmalloc_op);
+	proc_create_single("vmallocinfo", 0400, NULL, vmalloc_info_show);
 	return 0;
 }
 module_init(proc_vmalloc_init);
@@ -50,6 +50,9 @@
 #include <linux/printk.h>
 #include <linux/dax.h>
 #include <linux/psi.h>
+#include <linux/pagewalk.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <asm/tlbflush.h>
 #include <asm/div64.h>
@@ -206,6 +209,55 @@ static void set_task_reclaim_state(struct task_struct *task,
 static LIST_HEAD(shrinker_list);
 static DECLARE_RWSEM(shrinker_rwsem);
 
+/*
+ * Time a single do_shrink_slab() call may spend scanning before the rest
+ * of its work is deferred to the next invocation, 0 for no limit.  Keeps
+ * one slow shrinker from stalling direct reclaim for everybody.
+ */
+static unsigned int shrinker_budget_us __read_mostly;
+
+#ifdef CONFIG_DEBUG_FS
+static void shrinker_account(struct shrinker *shrinker, long scanned,
+			     unsigned long freed, u64 ns)
+{
+	atomic_long_add(scanned, &shrinker->stat_scanned);
+	atomic_long_add(freed, &shrinker->stat_freed);
+	atomic64_add(ns, &shrinker->stat_ns);
+}
+
+static int shrinker_stats_show(struct seq_file *m, void *v)
+{
+	struct shrinker *shrinker;
+
+	seq_puts(m, "# shrinker scanned freed ns\n");
+	down_read(&shrinker_rwsem);
+	list_for_each_entry(shrinker, &shrinker_list, list)
+		seq_printf(m, "%ps %lu %lu %llu\n", shrinker->scan_objects,
+			   atomic_long_read(&shrinker->stat_scanned),
+			   atomic_long_read(&shrinker->stat_freed),
+			   (u64)atomic64_read(&shrinker->stat_ns));
+	up_read(&shrinker_rwsem);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(shrinker_stats);
+
+static int __init shrinker_debugfs_init(void)
+{
+	struct dentry *root = debugfs_create_dir("shrinker", NULL);
+
+	debugfs_create_file("stats", 0400, root, NULL, &shrinker_stats_fops);
+	debugfs_create_u32("budget_us", 0644, root, &shrinker_budget_us);
+	return 0;
+}
+late_initcall(shrinker_debugfs_init);
+#else
+static inline void shrinker_account(struct shrinker *shrinker, long scanned,
+				    unsigned long freed, u64 ns)
+{
+}
+#endif
+
 #ifdef CONFIG_MEMCG
 static int shrinker_nr_max;
 
@@ -753,6 +805,8 @@ static unsigned long do_shrink_slab(struct shrink_control *shrinkctl,
 	long batch_size = shrinker->batch ? shrinker->batch
 					  : SHRINK_BATCH;
 	long scanned = 0, next_deferred;
+	u64 budget_ns = (u64)READ_ONCE(shrinker_budget_us) * NSEC_PER_USEC;
+	u64 start = ktime_get_ns(), duration;
 
 	freeable = shrinker->count_objects(shrinker, shrinkctl);
 	if (freeable == 0 || freeable == SHRINK_EMPTY)
@@ -817,6 +871,10 @@ static unsigned long do_shrink_slab(struct shrink_control *shrinkctl,
 		scanned += shrinkctl->nr_scanned;
 
 		cond_resched();
+
+		/* Out of time, leave the rest to the deferred count */
+		if (budget_ns && ktime_get_ns() - start > budget_ns)
+			break;
 	}
 
 	/*
@@ -834,7 +892,10 @@ static unsigned long do_shrink_slab(struct shrink_control *shrinkctl,
 	 */
 	new_nr = add_nr_deferred(next_deferred, shrinker, shrinkctl);
 
-	trace_mm_shrink_slab_end(shrinker, shrinkctl->nid, freed, nr, new_nr, total_scan);
+	duration = ktime_get_ns() - start;
+	shrinker_account(shrinker, scanned, freed, duration);
+	trace_mm_shrink_slab_end(shrinker, shrinkctl->nid, freed, nr, new_nr,
+				 total_scan, scanned, duration);
 	return freed;
 }
 
@@ -1390,8 +1451,74 @@ enum page_references {
  * ---
  *
  */
+/*
+ * References of the mapped anon pages in a shrink_page_list() batch,
+ * collected up front by page_referenced_batch() so that pages sharing an
+ * anon_vma are tested under one rmap lock acquisition.
+ */
+struct reclaim_rmap_batch {
+	int nr;
+	struct page *pages[RMAP_BATCH_MAX];
+	int referenced[RMAP_BATCH_MAX];
+	unsigned long vm_flags[RMAP_BATCH_MAX];
+};
+
+static void reclaim_rmap_batch_prepare(struct list_head *page_list,
+				       struct reclaim_rmap_batch *batch,
+				       struct scan_control *sc)
+{
+	struct page *page;
+
+	batch->nr = 0;
+	if (!sc->may_unmap)
+		return;
+
+	list_for_each_entry(page, page_list, lru) {
+		if (!PageAnon(page) || PageKsm(page) || !page_mapped(page) ||
+		    PageWriteback(page))
+			continue;
+
+		batch->pages[batch->nr++] = page;
+		if (batch->nr == RMAP_BATCH_MAX)
+			break;
+	}
+
+	/* Nothing to share a walk with */
+	if (batch->nr < 2) {
+		batch->nr = 0;
+		return;
+	}
+
+	page_referenced_batch(batch->pages, batch->nr, sc->target_mem_cgroup,
+			      batch->referenced, batch->vm_flags);
+}
+
+/*
+ * Hand out the batched result for @page, at most once, so that a page
+ * looked at again on the demotion retry pass gets a fresh rmap walk.
+ */
+static bool reclaim_rmap_batch_lookup(struct reclaim_rmap_batch *batch,
+				      struct page *page, int *referenced,
+				      unsigned long *vm_flags)
+{
+	int i;
+
+	for (i = 0; i < batch->nr; i++) {
+		if (batch->pages[i] != page)
+			continue;
+
+		batch->pages[i] = NULL;
+		*referenced = batch->referenced[i];
+		*vm_flags = batch->vm_flags[i];
+		return true;
+	}
+
+	return false;
+}
+
 static enum page_references page_check_references(struct page *page,
-						  struct scan_control *sc)
+						  struct scan_control *sc,
+						  struct reclaim_rmap_batch *batch)
 {
 	int referenced_ptes, referenced_page;
 	unsigned long vm_flags;
@@ -1403,8 +1530,11 @@ static enum page_references page_check_references(struct page *page,
  * - referenced_pages
  *   PG_referenced set여부
  */
-	referenced_ptes = page_referenced(page, 1, sc->target_mem_cgroup,
-					  &vm_flags);
+	if (!reclaim_rmap_batch_lookup(batch, page, &referenced_ptes,
+				       &vm_flags))
+		referenced_ptes = page_referenced(page, 1,
+						  sc->target_mem_cgroup,
+						  &vm_flags);
 	referenced_page = TestClearPageReferenced(page);
 
 	/*
@@ -1575,6 +1705,7 @@ static unsigned int shrink_page_list(struct list_head *page_list,
 	unsigned int nr_reclaimed = 0;
 	unsigned int pgactivate = 0;
 	bool do_demote_pass;
+	struct reclaim_rmap_batch rmap_batch;
 
 	memset(stat, 0, sizeof(*stat));
 	cond_resched();
@@ -1585,6 +1716,10 @@ static unsigned int shrink_page_list(struct list_head *page_list,
  */
 	do_demote_pass = can_demote(pgdat->node_id, sc);
 
+	rmap_batch.nr = 0;
+	if (!ignore_references)
+		reclaim_rmap_batch_prepare(page_list, &rmap_batch, sc);
+
 retry:
 	while (!list_empty(page_list)) {
 		struct address_space *mapping;
@@ -1797,7 +1932,8 @@ static unsigned int shrink_page_list(struct list_head *page_list,
  * - 참조 ptes개수와 PG_referenced를 조사해서 page를 어떻게 할지 결정한다.
  */
 		if (!ignore_references)
-			references = page_check_references(page, sc);
+			references = page_check_references(page, sc,
+							   &rmap_batch);
 
 		switch (references) {
 		case PAGEREF_ACTIVATE:
@@ -2946,6 +3082,271 @@ shrink_inactive_list(unsigned long nr_to_scan, struct lruvec *lruvec,
 	return nr_reclaimed;
 }
 
+#ifdef CONFIG_LRU_GEN
+/*
+ * Page table walk based aging of the active anon list.
+ *
+ * Instead of calling page_referenced() for every anon page that
+ * shrink_active_list() isolates, the page tables of the mms charged to the
+ * lruvec are walked in one batch. Active anon pages found young are marked
+ * PG_referenced and the lruvec generation is bumped. As long as the
+ * generation is fresh, shrink_active_list() keeps the marked pages active
+ * and deactivates everything else without an rmap walk.
+ */
+#define LRU_GEN_WALK_INTERVAL	HZ
+#define LRU_GEN_WALK_MMS	64
+
+static DEFINE_STATIC_KEY_MAYBE(CONFIG_LRU_GEN_ENABLED, lru_gen_key);
+
+static inline bool lru_gen_enabled(void)
+{
+	return static_branch_maybe(CONFIG_LRU_GEN_ENABLED, &lru_gen_key);
+}
+
+struct lru_gen_mm_batch {
+	unsigned long skip;
+	int nr;
+	struct mm_struct *mms[LRU_GEN_WALK_MMS];
+};
+
+struct lru_gen_walk {
+	struct lruvec *lruvec;
+	unsigned long nr_young;
+};
+
+static int lru_gen_collect_task(struct task_struct *p, void *arg)
+{
+	struct lru_gen_mm_batch *batch = arg;
+	struct mm_struct *mm;
+
+	if (p->flags & PF_KTHREAD)
+		return 0;
+
+	task_lock(p);
+	mm = p->mm;
+	if (mm && get_mm_counter(mm, MM_ANONPAGES)) {
+		if (batch->skip)
+			batch->skip--;
+		else if (mmget_not_zero(mm))
+			batch->mms[batch->nr++] = mm;
+	}
+	task_unlock(p);
+
+	return batch->nr == LRU_GEN_WALK_MMS;
+}
+
+static void lru_gen_collect_mms(struct lruvec *lruvec,
+				struct lru_gen_mm_batch *batch)
+{
+	struct mem_cgroup *memcg = lruvec_memcg(lruvec);
+	struct task_struct *p;
+
+	if (memcg && !mem_cgroup_is_root(memcg)) {
+		mem_cgroup_scan_tasks(memcg, lru_gen_collect_task, batch);
+		return;
+	}
+
+	rcu_read_lock();
+	for_each_process(p) {
+		if (lru_gen_collect_task(p, batch))
+			break;
+	}
+	rcu_read_unlock();
+}
+
+static inline bool lru_gen_page_eligible(struct page *page,
+					 struct lruvec *lruvec)
+{
+	return PageAnon(page) && PageActive(page) &&
+	       mem_cgroup_page_lruvec(page) == lruvec;
+}
+
+static int lru_gen_walk_pmd_range(pmd_t *pmd, unsigned long addr,
+				  unsigned long end, struct mm_walk *walk)
+{
+	struct lru_gen_walk *args = walk->private;
+	struct vm_area_struct *vma = walk->vma;
+	struct page *page;
+	spinlock_t *ptl;
+	pte_t *start, *pte;
+
+	/* Test the huge pmd in place, the walk must never split a THP */
+	ptl = pmd_trans_huge_lock(pmd, vma);
+	if (ptl) {
+		if (pmd_present(*pmd) && !is_huge_zero_pmd(*pmd)) {
+			page = pmd_page(*pmd);
+			if (lru_gen_page_eligible(page, args->lruvec) &&
+			    pmdp_clear_young_notify(vma, addr, pmd)) {
+				SetPageReferenced(page);
+				args->nr_young += thp_nr_pages(page);
+			}
+		}
+		spin_unlock(ptl);
+		walk->action = ACTION_CONTINUE;
+		return 0;
+	}
+
+	if (pmd_trans_unstable(pmd))
+		return 0;
+
+	start = pte = pte_offset_map_lock(walk->mm, pmd, addr, &ptl);
+	for (; addr != end; pte++, addr += PAGE_SIZE) {
+		if (!pte_present(*pte) || !pte_young(*pte))
+			continue;
+
+		page = vm_normal_page(vma, addr, *pte);
+		if (!page || !lru_gen_page_eligible(compound_head(page),
+						    args->lruvec))
+			continue;
+
+		if (ptep_clear_young_notify(vma, addr, pte)) {
+			SetPageReferenced(compound_head(page));
+			args->nr_young++;
+		}
+	}
+	pte_unmap_unlock(start, ptl);
+	cond_resched();
+
+	return 0;
+}
+
+static int lru_gen_walk_test(unsigned long start, unsigned long end,
+			     struct mm_walk *walk)
+{
+	struct vm_area_struct *vma = walk->vma;
+
+	/* Only vmas that can map anon pages are of interest */
+	if (!vma->anon_vma ||
+	    (vma->vm_flags & (VM_LOCKED | VM_PFNMAP | VM_HUGETLB)))
+		return 1;
+
+	return 0;
+}
+
+static const struct mm_walk_ops lru_gen_walk_ops = {
+	.pmd_entry	= lru_gen_walk_pmd_range,
+	.test_walk	= lru_gen_walk_test,
+};
+
+static bool lru_gen_fresh(struct lruvec *lruvec)
+{
+	return time_before(jiffies, READ_ONCE(lruvec->lrugen.timestamp) +
+				    LRU_GEN_WALK_INTERVAL);
+}
+
+/*
+ * Start a new generation for @lruvec if the current one is stale. Returns
+ * true if shrink_active_list() may rely on PG_referenced instead of
+ * page_referenced() for anon pages.
+ */
+static bool lru_gen_age(struct lruvec *lruvec, struct scan_control *sc)
+{
+	struct lru_gen_struct *lrugen = &lruvec->lrugen;
+	struct lru_gen_walk args = { .lruvec = lruvec };
+	struct lru_gen_mm_batch *batch;
+	int i;
+
+	if (!lru_gen_enabled())
+		return false;
+
+	if (lru_gen_fresh(lruvec))
+		return true;
+
+	/* Someone else is walking, fall back to rmap for this pass */
+	if (test_and_set_bit(LRUVEC_GEN_WALKING, &lruvec->flags))
+		return false;
+
+	batch = kzalloc(sizeof(*batch), GFP_NOWAIT | __GFP_NOWARN);
+	if (!batch)
+		goto out;
+
+	batch->skip = lrugen->mm_cursor;
+	lru_gen_collect_mms(lruvec, batch);
+
+	/* Resume after this batch next time, wrap once the list runs out */
+	if (batch->nr < LRU_GEN_WALK_MMS)
+		lrugen->mm_cursor = 0;
+	else
+		lrugen->mm_cursor += batch->nr;
+
+	for (i = 0; i < batch->nr; i++) {
+		struct mm_struct *mm = batch->mms[i];
+
+		if (mmap_read_trylock(mm)) {
+			walk_page_range(mm, 0, mm->highest_vm_end,
+					&lru_gen_walk_ops, &args);
+			mmap_read_unlock(mm);
+		}
+		mmput_async(mm);
+	}
+	kfree(batch);
+
+	WRITE_ONCE(lrugen->seq, lrugen->seq + 1);
+	WRITE_ONCE(lrugen->timestamp, jiffies);
+
+	count_vm_event(LRU_GEN_WALK);
+	count_vm_events(LRU_GEN_YOUNG, args.nr_young);
+out:
+	clear_bit(LRUVEC_GEN_WALKING, &lruvec->flags);
+	return lru_gen_fresh(lruvec);
+}
+
+#ifdef CONFIG_SYSFS
+static ssize_t lru_gen_enabled_show(struct kobject *kobj,
+				    struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%d\n", lru_gen_enabled());
+}
+
+static ssize_t lru_gen_enabled_store(struct kobject *kobj,
+				     struct kobj_attribute *attr,
+				     const char *buf, size_t count)
+{
+	bool enable;
+
+	if (kstrtobool(buf, &enable))
+		return -EINVAL;
+
+	if (enable)
+		static_branch_enable(&lru_gen_key);
+	else
+		static_branch_disable(&lru_gen_key);
+
+	return count;
+}
+
+static struct kobj_attribute lru_gen_enabled_attr =
+	__ATTR(enabled, 0644, lru_gen_enabled_show, lru_gen_enabled_store);
+
+static struct attribute *lru_gen_attrs[] = {
+	&lru_gen_enabled_attr.attr,
+	NULL,
+};
+
+static const struct attribute_group lru_gen_attr_group = {
+	.name = "lru_gen",
+	.attrs = lru_gen_attrs,
+};
+
+static int __init lru_gen_init_sysfs(void)
+{
+	int err;
+
+	err = sysfs_create_group(mm_kobj, &lru_gen_attr_group);
+	if (err)
+		pr_err("failed to register lru_gen group\n");
+
+	return err;
+}
+subsys_initcall(lru_gen_init_sysfs);
+#endif /* CONFIG_SYSFS */
+#else /* !CONFIG_LRU_GEN */
+static inline bool lru_gen_age(struct lruvec *lruvec, struct scan_control *sc)
+{
+	return false;
+}
+#endif /* CONFIG_LRU_GEN */
+
 /*
  * shrink_active_list() moves pages from the active LRU to the inactive LRU.
  *
@@ -2984,6 +3385,7 @@ static void shrink_active_list(unsigned long nr_to_scan,
 	unsigned nr_rotated = 0;
 	int file = is_file_lru(lru);
 	struct pglist_data *pgdat = lruvec_pgdat(lruvec);
+	bool gen_aged = !file && lru_gen_age(lruvec, sc);
 
 	lru_add_drain();
 
@@ -3037,6 +3439,21 @@ static void shrink_active_list(unsigned long nr_to_scan,
 			}
 		}
 
+		/*
+		 * The page table walk that started the current generation
+		 * already harvested the young bits of anon pages. Keep the
+		 * pages it found young in the youngest generation unless
+		 * reclaim is struggling, and skip the rmap walk either way.
+		 */
+		if (gen_aged && PageAnon(page)) {
+			if (TestClearPageReferenced(page) &&
+			    sc->priority >= DEF_PRIORITY - 2) {
+				list_add(&page->lru, &l_active);
+				continue;
+			}
+			goto deactivate;
+		}
+
 		if (page_referenced(page, 0, sc->target_mem_cgroup,
 				    &vm_flags)) {
 			/*
@@ -3066,6 +3483,7 @@ static void shrink_active_list(unsigned long nr_to_scan,
  * - deactive를 한다. active flag를 지우고 inactive list에 옮긴다.
  *   active -> inactive가 될때 workingset 가 set된다.
  */
+deactivate:
 		ClearPageActive(page);	/* we are de-activating */
 		SetPageWorkingset(page);
 		list_add(&page->lru, &l_inactive);
@@ -3908,7 +4326,7 @@ static void shrink_node(pg_data_t *pgdat, struct scan_control *sc)
 	 * Flush the memory cgroup stats, so that we read accurate per-memcg
 	 * lruvec stats for heuristics.
 	 */
-	mem_cgroup_flush_stats();
+	mem_cgroup_flush_stats(sc->target_mem_cgroup);
 
 	memset(&sc->nr, 0, sizeof(sc->nr));
 
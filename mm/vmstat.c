@@ -852,6 +852,11 @@ static int refresh_cpu_vm_stats(bool do_pagesets)
 #endif
 			}
 		}
+
+		/* Shrink an adaptively grown pcp->high on quiet CPUs */
+		if (do_pagesets &&
+		    decay_pcp_high(zone, this_cpu_ptr(zone->per_cpu_pageset)))
+			changes++;
 #ifdef CONFIG_NUMA
 
 		if (do_pagesets) {
@@ -1306,6 +1311,10 @@ const char * const vmstat_text[] = {
 #ifdef CONFIG_SWAP
 	"nr_swapcached",
 #endif
+#ifdef CONFIG_NUMA_BALANCING
+	"pgpromote_success",
+	"pgpromote_candidate",
+#endif
 
 	/* enum writeback_stat_item counters */
 	"nr_dirty_threshold",
@@ -1360,6 +1369,10 @@ const char * const vmstat_text[] = {
 	"drop_pagecache",
 	"drop_slab",
 	"oom_kill",
+	"ra_stride",
+	"zap_parallel",
+	"zap_parallel_pages",
+	"zap_parallel_msec",
 
 #ifdef CONFIG_NUMA_BALANCING
 	"numa_pte_updates",
@@ -1424,6 +1437,8 @@ const char * const vmstat_text[] = {
 	"thp_zero_page_alloc_failed",
 	"thp_swpout",
 	"thp_swpout_fallback",
+	"mthp_anon_fault_alloc",
+	"mthp_anon_fault_fallback",
 #endif
 #ifdef CONFIG_MEMORY_BALLOON
 	"balloon_inflate",
@@ -1446,6 +1461,23 @@ const char * const vmstat_text[] = {
 #ifdef CONFIG_SWAP
 	"swap_ra",
 	"swap_ra_hit",
+	"swap_ra_skip",
+#endif
+#ifdef CONFIG_LRU_GEN
+	"lru_gen_walk",
+	"lru_gen_young",
+#endif
+#ifdef CONFIG_MEMCG
+	"memcg_async_reclaim",
+	"memcg_async_reclaim_steal",
+	"memcg_stock_hit",
+	"memcg_stock_miss",
+#endif
+#ifdef CONFIG_PER_VMA_LOCK
+	"vma_lock_success",
+	"vma_lock_abort",
+	"vma_lock_retry",
+	"vma_lock_miss",
 #endif
 #ifdef CONFIG_X86
 	"direct_map_level2_splits",
@@ -1775,10 +1807,14 @@ static void zoneinfo_show_print(struct seq_file *m, pg_data_t *pgdat,
 			   "\n    cpu: %i"
 			   "\n              count: %i"
 			   "\n              high:  %i"
+			   "\n              high_min: %i"
+			   "\n              high_max: %i"
 			   "\n              batch: %i",
 			   i,
 			   pcp->count,
 			   pcp->high,
+			   pcp->high_min,
+			   pcp->high_max,
 			   pcp->batch);
 #ifdef CONFIG_SMP
 		pzstats = per_cpu_ptr(zone->per_cpu_zonestats, i);
@@ -1786,6 +1822,17 @@ static void zoneinfo_show_print(struct seq_file *m, pg_data_t *pgdat,
 				pzstats->stat_threshold);
 #endif
 	}
+	if (zone->nr_shards) {
+		seq_printf(m, "\n  shards");
+		for (i = 0; i < zone->nr_shards; i++)
+			seq_printf(m,
+				   "\n    shard: %i"
+				   "\n              count: %i"
+				   "\n              high:  %i",
+				   i,
+				   READ_ONCE(zone->shards[i].count),
+				   READ_ONCE(zone->shards[i].high));
+	}
 	seq_printf(m,
 		   "\n  node_unreclaimable:  %u"
 		   "\n  start_pfn:           %lu",
@@ -564,6 +564,18 @@ static inline unsigned long zs_stat_get(struct size_class *class,
 	return class->stats.objs[type];
 }
 
+/*
+ * Peek at the fullness group counters without class->lock.  They are only
+ * written under the lock, so the answer may be stale: a false positive
+ * costs a trip to the lock, a false negative costs one extra zspage.
+ */
+static inline bool zs_class_has_free_obj(struct size_class *class)
+{
+	return READ_ONCE(class->stats.objs[CLASS_ALMOST_FULL]) ||
+		READ_ONCE(class->stats.objs[CLASS_ALMOST_EMPTY]) ||
+		READ_ONCE(class->stats.objs[CLASS_EMPTY]);
+}
+
 #ifdef CONFIG_ZSMALLOC_STAT
 
 static void __init zs_stat_init(void)
@@ -1424,20 +1436,26 @@ unsigned long zs_malloc(struct zs_pool *pool, size_t size, gfp_t gfp)
 	size += ZS_HANDLE_SIZE;
 	class = pool->size_class[get_size_class_index(size)];
 
-	spin_lock(&class->lock);
-	zspage = find_get_zspage(class);
-	if (likely(zspage)) {
-		obj = obj_malloc(class, zspage, handle);
-		/* Now move the zspage to another fullness group, if required */
-		fix_fullness_group(class, zspage);
-		record_obj(handle, obj);
-		spin_unlock(&class->lock);
+	/*
+	 * If every zspage of the class is full or isolated by compaction,
+	 * don't queue on class->lock just to find that out.
+	 */
+	if (likely(zs_class_has_free_obj(class))) {
+		spin_lock(&class->lock);
+		zspage = find_get_zspage(class);
+		if (likely(zspage)) {
+			obj = obj_malloc(class, zspage, handle);
+			/* Now move the zspage to another fullness group, if required */
+			fix_fullness_group(class, zspage);
+			record_obj(handle, obj);
+			spin_unlock(&class->lock);
+
+			return handle;
+		}
 
-		return handle;
+		spin_unlock(&class->lock);
 	}
 
-	spin_unlock(&class->lock);
-
 	zspage = alloc_zspage(pool, class, gfp);
 	if (!zspage) {
 		cache_free_handle(pool, handle);
@@ -2216,6 +2234,7 @@ static unsigned long __zs_compact(struct zs_pool *pool,
 	struct zspage *src_zspage;
 	struct zspage *dst_zspage = NULL;
 	unsigned long pages_freed = 0;
+	bool yield;
 
 	spin_lock(&class->lock);
 	while ((src_zspage = isolate_zspage(class, true))) {
@@ -2225,6 +2244,7 @@ static unsigned long __zs_compact(struct zs_pool *pool,
 
 		cc.obj_idx = 0;
 		cc.s_page = get_first_page(src_zspage);
+		yield = false;
 
 		while ((dst_zspage = isolate_zspage(class, false))) {
 			cc.d_page = get_first_page(dst_zspage);
@@ -2236,6 +2256,26 @@ static unsigned long __zs_compact(struct zs_pool *pool,
 				break;
 
 			putback_zspage(class, dst_zspage);
+			dst_zspage = NULL;
+
+			/*
+			 * Migrating into the next destination could keep
+			 * zs_malloc and zs_free spinning for a long time.
+			 * Put the partially drained source back and let them
+			 * in first; it is picked up again on the next round.
+			 */
+			if (spin_is_contended(&class->lock) || need_resched()) {
+				yield = true;
+				break;
+			}
+		}
+
+		if (yield) {
+			putback_zspage(class, src_zspage);
+			spin_unlock(&class->lock);
+			cond_resched();
+			spin_lock(&class->lock);
+			continue;
 		}
 
 		/* Stop if we couldn't find slot */
@@ -35,6 +35,7 @@
 #include <linux/writeback.h>
 #include <linux/pagemap.h>
 #include <linux/workqueue.h>
+#include <linux/blkdev.h>
 
 /*********************************
 * statistics
@@ -125,6 +126,10 @@ static bool zswap_same_filled_pages_enabled = true;
 module_param_named(same_filled_pages_enabled, zswap_same_filled_pages_enabled,
 		   bool, 0644);
 
+/* The maximum number of zpool pages written back by one shrink_worker run */
+static unsigned int zswap_writeback_batch = 32;
+module_param_named(writeback_batch, zswap_writeback_batch, uint, 0644);
+
 /*********************************
 * data structures
 **********************************/
@@ -194,8 +199,26 @@ struct zswap_tree {
 	spinlock_t lock;
 };
 
+/*
+ * Each swap type is split into ZSWAP_NR_TREES trees, selected by the swap
+ * offset in SWAP_ADDRESS_SPACE_PAGES sized chunks, the same granularity the
+ * swap cache uses for its address_space split.  This keeps concurrent
+ * stores and loads on one large swap device off a single tree lock.
+ */
+#define ZSWAP_NR_TREES		64
+
 static struct zswap_tree *zswap_trees[MAX_SWAPFILES];
 
+static inline struct zswap_tree *swap_zswap_tree(unsigned type, pgoff_t offset)
+{
+	struct zswap_tree *trees = zswap_trees[type];
+
+	if (!trees)
+		return NULL;
+	return &trees[(offset >> SWAP_ADDRESS_SPACE_SHIFT) &
+		      (ZSWAP_NR_TREES - 1)];
+}
+
 /* RCU-protected iteration */
 static LIST_HEAD(zswap_pools);
 /* protects zswap_pools list modification */
@@ -576,9 +599,25 @@ static void shrink_worker(struct work_struct *w)
 {
 	struct zswap_pool *pool = container_of(w, typeof(*pool),
 						shrink_work);
+	struct blk_plug plug;
+	unsigned int i;
 
-	if (zpool_shrink(pool->zpool, 1, NULL))
-		zswap_reject_reclaim_fail++;
+	/*
+	 * Keep writing back until the pool drops under the accept threshold,
+	 * so stores stop being rejected, instead of one page per full pool
+	 * hit.  The plug lets the swap writes of a batch be merged.
+	 */
+	blk_start_plug(&plug);
+	for (i = 0; i < max(zswap_writeback_batch, 1U); i++) {
+		if (zpool_shrink(pool->zpool, 1, NULL)) {
+			zswap_reject_reclaim_fail++;
+			break;
+		}
+		if (zswap_can_accept())
+			break;
+		cond_resched();
+	}
+	blk_finish_plug(&plug);
 	zswap_pool_put(pool);
 }
 
@@ -951,7 +990,7 @@ static int zswap_writeback_entry(struct zpool *pool, unsigned long handle)
 	/* extract swpentry from data */
 	zhdr = zpool_map_handle(pool, handle, ZPOOL_MM_RO);
 	swpentry = zhdr->swpentry; /* here */
-	tree = zswap_trees[swp_type(swpentry)];
+	tree = swap_zswap_tree(swp_type(swpentry), swp_offset(swpentry));
 	offset = swp_offset(swpentry);
 
 	/* find and ref zswap entry */
@@ -1082,7 +1121,7 @@ static void zswap_fill_page(void *ptr, unsigned long value)
 static int zswap_frontswap_store(unsigned type, pgoff_t offset,
 				struct page *page)
 {
-	struct zswap_tree *tree = zswap_trees[type];
+	struct zswap_tree *tree = swap_zswap_tree(type, offset);
 	struct zswap_entry *entry, *dupentry;
 	struct scatterlist input, output;
 	struct crypto_acomp_ctx *acomp_ctx;
@@ -1247,7 +1286,7 @@ static int zswap_frontswap_store(unsigned type, pgoff_t offset,
 static int zswap_frontswap_load(unsigned type, pgoff_t offset,
 				struct page *page)
 {
-	struct zswap_tree *tree = zswap_trees[type];
+	struct zswap_tree *tree = swap_zswap_tree(type, offset);
 	struct zswap_entry *entry;
 	struct scatterlist input, output;
 	struct crypto_acomp_ctx *acomp_ctx;
@@ -1323,7 +1362,7 @@ static int zswap_frontswap_load(unsigned type, pgoff_t offset,
 /* frees an entry in zswap */
 static void zswap_frontswap_invalidate_page(unsigned type, pgoff_t offset)
 {
-	struct zswap_tree *tree = zswap_trees[type];
+	struct zswap_tree *tree = swap_zswap_tree(type, offset);
 	struct zswap_entry *entry;
 
 	/* find */
@@ -1347,35 +1386,43 @@ static void zswap_frontswap_invalidate_page(unsigned type, pgoff_t offset)
 /* frees all zswap entries for the given swap type */
 static void zswap_frontswap_invalidate_area(unsigned type)
 {
-	struct zswap_tree *tree = zswap_trees[type];
+	struct zswap_tree *trees = zswap_trees[type], *tree;
 	struct zswap_entry *entry, *n;
+	int i;
 
-	if (!tree)
+	if (!trees)
 		return;
 
-	/* walk the tree and free everything */
-	spin_lock(&tree->lock);
-	rbtree_postorder_for_each_entry_safe(entry, n, &tree->rbroot, rbnode)
-		zswap_free_entry(entry);
-	tree->rbroot = RB_ROOT;
-	spin_unlock(&tree->lock);
-	kfree(tree);
+	/* walk the trees and free everything */
+	for (i = 0; i < ZSWAP_NR_TREES; i++) {
+		tree = &trees[i];
+		spin_lock(&tree->lock);
+		rbtree_postorder_for_each_entry_safe(entry, n, &tree->rbroot,
+						     rbnode)
+			zswap_free_entry(entry);
+		tree->rbroot = RB_ROOT;
+		spin_unlock(&tree->lock);
+	}
+	kfree(trees);
 	zswap_trees[type] = NULL;
 }
 
 static void zswap_frontswap_init(unsigned type)
 {
-	struct zswap_tree *tree;
+	struct zswap_tree *trees;
+	int i;
 
-	tree = kzalloc(sizeof(*tree), GFP_KERNEL);
-	if (!tree) {
+	trees = kcalloc(ZSWAP_NR_TREES, sizeof(*trees), GFP_KERNEL);
+	if (!trees) {
 		pr_err("alloc failed, zswap disabled for swap type %d\n", type);
 		return;
 	}
 
-	tree->rbroot = RB_ROOT;
-	spin_lock_init(&tree->lock);
-	zswap_trees[type] = tree;
+	for (i = 0; i < ZSWAP_NR_TREES; i++) {
+		trees[i].rbroot = RB_ROOT;
+		spin_lock_init(&trees[i].lock);
+	}
+	zswap_trees[type] = trees;
 }
 
 static struct frontswap_ops zswap_frontswap_ops = {
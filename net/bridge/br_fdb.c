@@ -56,12 +56,32 @@ void br_fdb_fini(void)
 
 int br_fdb_hash_init(struct net_bridge *br)
 {
-	return rhashtable_init(&br->fdb_hash_tbl, &br_fdb_rht_params);
+	int cpu, err;
+
+	err = rhashtable_init(&br->fdb_hash_tbl, &br_fdb_rht_params);
+	if (err)
+		return err;
+
+	br->fdb_learn_queue = alloc_percpu(struct br_fdb_learn_queue);
+	if (!br->fdb_learn_queue) {
+		rhashtable_destroy(&br->fdb_hash_tbl);
+		return -ENOMEM;
+	}
+
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(br->fdb_learn_queue, cpu)->lock);
+
+	return 0;
 }
 
 void br_fdb_hash_fini(struct net_bridge *br)
 {
+	if (br->fdb_gc_walking) {
+		rhashtable_walk_exit(&br->fdb_gc_iter);
+		br->fdb_gc_walking = false;
+	}
 	rhashtable_destroy(&br->fdb_hash_tbl);
+	free_percpu(br->fdb_learn_queue);
 }
 
 /* if topology_changing then use forward_delay (default 15 sec)
@@ -334,29 +354,59 @@ void br_fdb_change_mac_address(struct net_bridge *br, const u8 *newaddr)
 	spin_unlock_bh(&br->hash_lock);
 }
 
+/* Entries looked at per run of br_fdb_cleanup(), so that a large FDB is
+ * aged a slice at a time rather than in one long walk.
+ */
+#define BR_FDB_GC_BATCH		4096
+
 void br_fdb_cleanup(struct work_struct *work)
 {
 	struct net_bridge *br = container_of(work, struct net_bridge,
 					     gc_work.work);
+	struct rhashtable_iter *iter = &br->fdb_gc_iter;
 	struct net_bridge_fdb_entry *f = NULL;
 	unsigned long delay = hold_time(br);
-	unsigned long work_delay = delay;
 	unsigned long now = jiffies;
+	unsigned int scanned = 0;
+	unsigned long work_delay;
+
+	/* The walk of the table carries on from where the previous run left
+	 * it and the earliest expiry it saw is kept in fdb_gc_delay.
+	 */
+	if (!br->fdb_gc_walking) {
+		rhashtable_walk_enter(&br->fdb_hash_tbl, iter);
+		br->fdb_gc_walking = true;
+		br->fdb_gc_delay = delay;
+	}
 
 	/* this part is tricky, in order to avoid blocking learning and
 	 * consequently forwarding, we rely on rcu to delete objects with
 	 * delayed freeing allowing us to continue traversing
 	 */
-	rcu_read_lock();
-	hlist_for_each_entry_rcu(f, &br->fdb_list, fdb_node) {
-		unsigned long this_timer = f->updated + delay;
+	rhashtable_walk_start(iter);
+	while (scanned < BR_FDB_GC_BATCH) {
+		unsigned long this_timer;
+
+		f = rhashtable_walk_next(iter);
+		if (IS_ERR(f)) {
+			/* table resized, some entries may be seen twice */
+			if (PTR_ERR(f) == -EAGAIN)
+				continue;
+			f = NULL;
+		}
+		if (!f)
+			break;
+
+		scanned++;
+		this_timer = f->updated + delay;
 
 		if (test_bit(BR_FDB_STATIC, &f->flags) ||
 		    test_bit(BR_FDB_ADDED_BY_EXT_LEARN, &f->flags)) {
 			if (test_bit(BR_FDB_NOTIFY, &f->flags)) {
 				if (time_after(this_timer, now))
-					work_delay = min(work_delay,
-							 this_timer - now);
+					br->fdb_gc_delay =
+						min(br->fdb_gc_delay,
+						    this_timer - now);
 				else if (!test_and_set_bit(BR_FDB_NOTIFY_INACTIVE,
 							   &f->flags))
 					fdb_notify(br, f, RTM_NEWNEIGH, false);
@@ -365,18 +415,32 @@ void br_fdb_cleanup(struct work_struct *work)
 		}
 
 		if (time_after(this_timer, now)) {
-			work_delay = min(work_delay, this_timer - now);
+			br->fdb_gc_delay = min(br->fdb_gc_delay,
+					       this_timer - now);
 		} else {
 			spin_lock_bh(&br->hash_lock);
-			if (!hlist_unhashed(&f->fdb_node))
+			if (!hlist_unhashed(&f->fdb_node)) {
 				fdb_delete(br, f, true);
+				br->fdb_aged++;
+			}
 			spin_unlock_bh(&br->hash_lock);
 		}
 	}
-	rcu_read_unlock();
+	rhashtable_walk_stop(iter);
+	br->fdb_gc_scanned += scanned;
+
+	/* Let learning and forwarding in before the next slice */
+	if (f) {
+		mod_delayed_work(system_long_wq, &br->gc_work, 1);
+		return;
+	}
+
+	rhashtable_walk_exit(iter);
+	br->fdb_gc_walking = false;
 
 	/* Cleanup minimum 10 milliseconds apart */
-	work_delay = max_t(unsigned long, work_delay, msecs_to_jiffies(10));
+	work_delay = max_t(unsigned long, br->fdb_gc_delay,
+			   msecs_to_jiffies(10));
 	mod_delayed_work(system_long_wq, &br->gc_work, work_delay);
 }
 
@@ -579,6 +643,105 @@ static bool __fdb_mark_active(struct net_bridge_fdb_entry *fdb)
 		  test_and_clear_bit(BR_FDB_NOTIFY_INACTIVE, &fdb->flags));
 }
 
+/* Queue a new address seen in the data path for br_fdb_learn_work(), so
+ * that a burst of them doesn't serialise every CPU on hash_lock.
+ */
+static void br_fdb_learn_enqueue(struct net_bridge *br,
+				 struct net_bridge_port *source,
+				 const unsigned char *addr, u16 vid)
+{
+	struct br_fdb_learn_queue *q = this_cpu_ptr(br->fdb_learn_queue);
+	struct br_fdb_learn_entry *e;
+	unsigned int i;
+	bool kick;
+
+	spin_lock(&q->lock);
+	for (i = 0; i < q->len; i++) {
+		e = &q->entries[i];
+		if (e->vid == vid && e->port == source &&
+		    ether_addr_equal(e->addr, addr)) {
+			spin_unlock(&q->lock);
+			return;
+		}
+	}
+
+	if (q->len == BR_FDB_LEARN_QLEN) {
+		q->dropped++;
+		spin_unlock(&q->lock);
+		return;
+	}
+
+	e = &q->entries[q->len++];
+	e->port = source;
+	e->port_no = source->port_no;
+	e->vid = vid;
+	ether_addr_copy(e->addr, addr);
+	kick = q->len == 1;
+	spin_unlock(&q->lock);
+
+	if (kick)
+		queue_work(system_highpri_wq, &br->fdb_learn_work);
+}
+
+void br_fdb_learn_work(struct work_struct *work)
+{
+	struct net_bridge *br = container_of(work, struct net_bridge,
+					     fdb_learn_work);
+	struct br_fdb_learn_entry *batch = br->fdb_learn_batch;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct br_fdb_learn_queue *q;
+		unsigned int i, n;
+
+		q = per_cpu_ptr(br->fdb_learn_queue, cpu);
+		if (!READ_ONCE(q->len))
+			continue;
+
+		spin_lock_bh(&q->lock);
+		n = q->len;
+		memcpy(batch, q->entries, n * sizeof(*batch));
+		q->len = 0;
+		spin_unlock_bh(&q->lock);
+
+		rcu_read_lock();
+		spin_lock_bh(&br->hash_lock);
+		for (i = 0; i < n; i++) {
+			struct br_fdb_learn_entry *e = &batch[i];
+			struct net_bridge_fdb_entry *fdb;
+
+			/* The port may have left the bridge since.  Looking
+			 * it up under hash_lock orders this against
+			 * br_fdb_delete_by_port() in del_nbp().
+			 */
+			if (br_get_port(br, e->port_no) != e->port)
+				continue;
+
+			fdb = fdb_create(br, e->port, e->addr, e->vid, 0);
+			if (fdb) {
+				br->fdb_learned++;
+				trace_br_fdb_update(br, e->port, e->addr,
+						    e->vid, 0);
+				fdb_notify(br, fdb, RTM_NEWNEIGH, true);
+			}
+		}
+		spin_unlock_bh(&br->hash_lock);
+		rcu_read_unlock();
+	}
+}
+
+unsigned long br_fdb_learn_dropped(struct net_bridge *br)
+{
+	unsigned long dropped = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		dropped += READ_ONCE(per_cpu_ptr(br->fdb_learn_queue,
+						 cpu)->dropped);
+
+	return dropped;
+}
+
 void br_fdb_update(struct net_bridge *br, struct net_bridge_port *source,
 		   const unsigned char *addr, u16 vid, unsigned long flags)
 {
@@ -624,6 +787,8 @@ void br_fdb_update(struct net_bridge *br, struct net_bridge_port *source,
 				fdb_notify(br, fdb, RTM_NEWNEIGH, true);
 			}
 		}
+	} else if (!flags) {
+		br_fdb_learn_enqueue(br, source, addr, vid);
 	} else {
 		spin_lock(&br->hash_lock);
 		fdb = fdb_create(br, source, addr, vid, flags);
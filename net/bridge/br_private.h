@@ -31,6 +31,9 @@
 
 #define BR_HWDOM_MAX BITS_PER_LONG
 
+/* Addresses a CPU can have waiting to be learned at once */
+#define BR_FDB_LEARN_QLEN	64
+
 #define BR_VERSION	"2.3"
 
 /* Control of forwarding link local multicast */
@@ -444,6 +447,24 @@ enum net_bridge_opts {
 	BROPT_MCAST_VLAN_SNOOPING_ENABLED,
 };
 
+struct br_fdb_learn_entry {
+	struct net_bridge_port		*port;
+	u16				port_no;
+	u16				vid;
+	unsigned char			addr[ETH_ALEN];
+};
+
+/* New source addresses seen by one CPU, inserted into the FDB in one go by
+ * br_fdb_learn_work().  Addresses arriving while it is full are not learned
+ * and counted in 'dropped'.
+ */
+struct br_fdb_learn_queue {
+	spinlock_t			lock;
+	unsigned int			len;
+	unsigned long			dropped;
+	struct br_fdb_learn_entry	entries[BR_FDB_LEARN_QLEN];
+};
+
 struct net_bridge {
 	spinlock_t			lock;
 	spinlock_t			hash_lock;
@@ -515,6 +536,17 @@ struct net_bridge {
 	struct timer_list		topology_change_timer;
 	struct delayed_work		gc_work;
 	struct kobject			*ifobj;
+
+	/* FDB learning and ageing, see br_fdb.c */
+	struct work_struct		fdb_learn_work;
+	struct br_fdb_learn_queue	__percpu *fdb_learn_queue;
+	struct br_fdb_learn_entry	fdb_learn_batch[BR_FDB_LEARN_QLEN];
+	struct rhashtable_iter		fdb_gc_iter;
+	bool				fdb_gc_walking;
+	unsigned long			fdb_gc_delay;
+	unsigned long			fdb_learned;
+	unsigned long			fdb_aged;
+	unsigned long			fdb_gc_scanned;
 	u32				auto_cnt;
 
 #ifdef CONFIG_NET_SWITCHDEV
@@ -759,6 +791,8 @@ void br_fdb_find_delete_local(struct net_bridge *br,
 void br_fdb_changeaddr(struct net_bridge_port *p, const unsigned char *newaddr);
 void br_fdb_change_mac_address(struct net_bridge *br, const u8 *newaddr);
 void br_fdb_cleanup(struct work_struct *work);
+void br_fdb_learn_work(struct work_struct *work);
+unsigned long br_fdb_learn_dropped(struct net_bridge *br);
 void br_fdb_delete_by_port(struct net_bridge *br,
 			   const struct net_bridge_port *p, u16 vid, int do_all);
 struct net_bridge_fdb_entry *br_fdb_find_rcu(struct net_bridge *br,
@@ -296,6 +296,38 @@ static ssize_t gc_timer_show(struct device *d, struct device_attribute *attr,
 }
 static DEVICE_ATTR_RO(gc_timer);
 
+static ssize_t fdb_learned_show(struct device *d,
+				struct device_attribute *attr, char *buf)
+{
+	struct net_bridge *br = to_bridge(d);
+	return sprintf(buf, "%lu\n", READ_ONCE(br->fdb_learned));
+}
+static DEVICE_ATTR_RO(fdb_learned);
+
+static ssize_t fdb_learn_dropped_show(struct device *d,
+				      struct device_attribute *attr, char *buf)
+{
+	struct net_bridge *br = to_bridge(d);
+	return sprintf(buf, "%lu\n", br_fdb_learn_dropped(br));
+}
+static DEVICE_ATTR_RO(fdb_learn_dropped);
+
+static ssize_t fdb_aged_show(struct device *d,
+			     struct device_attribute *attr, char *buf)
+{
+	struct net_bridge *br = to_bridge(d);
+	return sprintf(buf, "%lu\n", READ_ONCE(br->fdb_aged));
+}
+static DEVICE_ATTR_RO(fdb_aged);
+
+static ssize_t fdb_gc_scanned_show(struct device *d,
+				   struct device_attribute *attr, char *buf)
+{
+	struct net_bridge *br = to_bridge(d);
+	return sprintf(buf, "%lu\n", READ_ONCE(br->fdb_gc_scanned));
+}
+static DEVICE_ATTR_RO(fdb_gc_scanned);
+
 static ssize_t group_addr_show(struct device *d,
 			       struct device_attribute *attr, char *buf)
 {
@@ -948,6 +980,10 @@ static struct attribute *bridge_attrs[] = {
 	&dev_attr_tcn_timer.attr,
 	&dev_attr_topology_change_timer.attr,
 	&dev_attr_gc_timer.attr,
+	&dev_attr_fdb_learned.attr,
+	&dev_attr_fdb_learn_dropped.attr,
+	&dev_attr_fdb_aged.attr,
+	&dev_attr_fdb_gc_scanned.attr,
 	&dev_attr_group_addr.attr,
 	&dev_attr_flush.attr,
 	&dev_attr_no_linklocal_learn.attr,
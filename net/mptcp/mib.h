@@ -42,6 +42,9 @@ enum linux_mptcp_mib_field {
 	MPTCP_MIB_RCVPRUNED,		/* Incoming packet dropped due to memory limit */
 	MPTCP_MIB_SUBFLOWSTALE,		/* Subflows entered 'stale' status */
 	MPTCP_MIB_SUBFLOWRECOVER,	/* Subflows returned to active status after being stale */
+	MPTCP_MIB_SCHEDSWITCH,		/* Scheduler moved the next burst to another subflow */
+	MPTCP_MIB_SCHEDBACKUP,		/* Scheduler picked a backup subflow, no other was active */
+	MPTCP_MIB_SCHEDHOLAVOID,	/* Scheduler held data back to avoid head-of-line blocking */
 	__MPTCP_MIB_MAX
 };
 
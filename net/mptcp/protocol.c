@@ -1397,11 +1397,6 @@ static int mptcp_sendmsg_frag(struct sock *sk, struct sock *ssk,
 					 sizeof(struct ipv6hdr) - \
 					 sizeof(struct frag_hdr))
 
-struct subflow_send_info {
-	struct sock *ssk;
-	u64 ratio;
-};
-
 void mptcp_subflow_set_active(struct mptcp_subflow_context *subflow)
 {
 	if (!subflow->stale)
@@ -1424,20 +1419,14 @@ bool mptcp_subflow_active(struct mptcp_subflow_context *subflow)
 	return __mptcp_subflow_active(subflow);
 }
 
-/* implement the mptcp packet scheduler;
+/* run the mptcp packet scheduler;
  * returns the subflow that will transmit the next DSS
  * additionally updates the rtx timeout
  */
 static struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
 {
-	struct subflow_send_info send_info[2];
-	struct mptcp_subflow_context *subflow;
 	struct sock *sk = (struct sock *)msk;
-	int i, nr_active = 0;
 	struct sock *ssk;
-	long tout = 0;
-	u64 ratio;
-	u32 pace;
 
 	sock_owned_by_me(sk);
 
@@ -1455,47 +1444,19 @@ static struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
 		return msk->last_snd;
 	}
 
-	/* pick the subflow with the lower wmem/wspace ratio */
-	for (i = 0; i < 2; ++i) {
-		send_info[i].ssk = NULL;
-		send_info[i].ratio = -1;
-	}
-	mptcp_for_each_subflow(msk, subflow) {
-		trace_mptcp_subflow_get_send(subflow);
-		ssk =  mptcp_subflow_tcp_sock(subflow);
-		if (!mptcp_subflow_active(subflow))
-			continue;
-
-		tout = max(tout, mptcp_timeout_from_subflow(subflow));
-		nr_active += !subflow->backup;
-		if (!sk_stream_memory_free(subflow->tcp_sock) || !tcp_sk(ssk)->snd_wnd)
-			continue;
-
-		pace = READ_ONCE(ssk->sk_pacing_rate);
-		if (!pace)
-			continue;
-
-		ratio = div_u64((u64)READ_ONCE(ssk->sk_wmem_queued) << 32,
-				pace);
-		if (ratio < send_info[subflow->backup].ratio) {
-			send_info[subflow->backup].ssk = ssk;
-			send_info[subflow->backup].ratio = ratio;
-		}
-	}
-	__mptcp_set_timeout(sk, tout);
+	ssk = msk->sched->get_subflow(msk);
+	mptcp_set_timeout(sk);
+	if (!ssk)
+		return NULL;
 
-	/* pick the best backup if no other subflow is active */
-	if (!nr_active)
-		send_info[0].ssk = send_info[1].ssk;
+	if (ssk != msk->last_snd)
+		MPTCP_INC_STATS(sock_net(sk), MPTCP_MIB_SCHEDSWITCH);
 
-	if (send_info[0].ssk) {
-		msk->last_snd = send_info[0].ssk;
-		msk->snd_burst = min_t(int, MPTCP_SEND_BURST_SIZE,
-				       tcp_sk(msk->last_snd)->snd_wnd);
-		return msk->last_snd;
-	}
-
-	return NULL;
+	/* stick to it for the next burst, across pushes */
+	msk->last_snd = ssk;
+	msk->snd_burst = min_t(int, MPTCP_SEND_BURST_SIZE,
+			       tcp_sk(ssk)->snd_wnd);
+	return ssk;
 }
 
 static void mptcp_push_release(struct sock *sk, struct sock *ssk,
@@ -2152,6 +2113,14 @@ static struct sock *mptcp_subflow_get_retrans(struct mptcp_sock *msk)
 	return min_stale_count > 1 ? backup : NULL;
 }
 
+static struct sock *mptcp_sched_get_retrans(struct mptcp_sock *msk)
+{
+	if (msk->sched->get_retrans && !__mptcp_check_fallback(msk))
+		return msk->sched->get_retrans(msk);
+
+	return mptcp_subflow_get_retrans(msk);
+}
+
 static void mptcp_dispose_initial_subflow(struct mptcp_sock *msk)
 {
 	if (msk->subflow) {
@@ -2368,7 +2337,7 @@ static void __mptcp_retrans(struct sock *sk)
 		return;
 	}
 
-	ssk = mptcp_subflow_get_retrans(msk);
+	ssk = mptcp_sched_get_retrans(msk);
 	if (!ssk)
 		goto reset_timer;
 
@@ -2470,6 +2439,7 @@ static int __mptcp_init_sock(struct sock *sk)
 	msk->recovery = false;
 
 	mptcp_pm_data_init(msk);
+	mptcp_sched_assign(msk);
 
 	/* re-use the csk retrans timer for MPTCP-level retrans */
 	timer_setup(&msk->sk.icsk_retransmit_timer, mptcp_retransmit_timer, 0);
@@ -3499,6 +3469,7 @@ void __init mptcp_proto_init(void)
 
 	mptcp_subflow_init();
 	mptcp_pm_init();
+	mptcp_sched_init();
 	mptcp_token_init();
 
 	if (proto_register(&mptcp_prot, 1) != 0)
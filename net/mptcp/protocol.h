@@ -271,6 +271,7 @@ struct mptcp_sock {
 
 	u32 setsockopt_seq;
 	char		ca_name[TCP_CA_NAME_MAX];
+	const struct mptcp_sched_ops *sched;
 };
 
 #define mptcp_lock_sock(___sk, cb) do {					\
@@ -564,6 +565,7 @@ unsigned int mptcp_get_add_addr_timeout(const struct net *net);
 int mptcp_is_checksum_enabled(const struct net *net);
 int mptcp_allow_join_id0(const struct net *net);
 unsigned int mptcp_stale_loss_cnt(const struct net *net);
+const char *mptcp_get_scheduler(const struct net *net);
 void mptcp_subflow_fully_established(struct mptcp_subflow_context *subflow,
 				     struct mptcp_options_received *mp_opt);
 bool __mptcp_retransmit_pending_data(struct sock *sk);
@@ -626,6 +628,23 @@ static inline bool mptcp_has_another_subflow(struct sock *ssk)
 	return false;
 }
 
+#define MPTCP_SCHED_NAME_MAX	16
+
+struct mptcp_sched_ops {
+	/* pick the subflow for the next burst of new data, NULL to wait */
+	struct sock *(*get_subflow)(struct mptcp_sock *msk);
+	/* optional: pick the subflow for MPTCP-level retransmissions */
+	struct sock *(*get_retrans)(struct mptcp_sock *msk);
+
+	char			name[MPTCP_SCHED_NAME_MAX];
+	struct list_head	list;
+};
+
+int mptcp_register_scheduler(struct mptcp_sched_ops *sched);
+struct mptcp_sched_ops *mptcp_sched_find(const char *name);
+void mptcp_sched_assign(struct mptcp_sock *msk);
+void __init mptcp_sched_init(void);
+
 void __init mptcp_proto_init(void);
 #if IS_ENABLED(CONFIG_MPTCP_IPV6)
 int __init mptcp_proto_v6_init(void);
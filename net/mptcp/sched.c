@@ -0,0 +1,272 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Multipath TCP packet schedulers
+ *
+ * A scheduler picks the subflow the next burst of new data goes out on
+ * and, optionally, the subflow used for MPTCP-level retransmissions.
+ * The core keeps using the picked subflow until the burst is spent, so
+ * the scheduler runs once per burst rather than once per fragment.
+ *
+ * The scheduler used by new sockets is chosen with net.mptcp.scheduler.
+ */
+
+#define pr_fmt(fmt) "MPTCP: " fmt
+
+#include <linux/kernel.h>
+#include <linux/list.h>
+#include <linux/rculist.h>
+#include <linux/spinlock.h>
+#include <net/tcp.h>
+#include "protocol.h"
+#include "mib.h"
+
+#include <trace/events/mptcp.h>
+
+static DEFINE_SPINLOCK(mptcp_sched_list_lock);
+static LIST_HEAD(mptcp_sched_list);
+
+/* Must be called with rcu lock held */
+struct mptcp_sched_ops *mptcp_sched_find(const char *name)
+{
+	struct mptcp_sched_ops *sched;
+
+	list_for_each_entry_rcu(sched, &mptcp_sched_list, list) {
+		if (!strcmp(sched->name, name))
+			return sched;
+	}
+
+	return NULL;
+}
+
+int mptcp_register_scheduler(struct mptcp_sched_ops *sched)
+{
+	int ret = 0;
+
+	if (!sched->get_subflow) {
+		pr_err("%s does not implement required ops\n", sched->name);
+		return -EINVAL;
+	}
+
+	spin_lock(&mptcp_sched_list_lock);
+	if (mptcp_sched_find(sched->name)) {
+		pr_notice("%s already registered\n", sched->name);
+		ret = -EEXIST;
+	} else {
+		list_add_tail_rcu(&sched->list, &mptcp_sched_list);
+		pr_debug("%s registered\n", sched->name);
+	}
+	spin_unlock(&mptcp_sched_list_lock);
+
+	return ret;
+}
+
+static bool mptcp_subflow_can_send(struct mptcp_subflow_context *subflow)
+{
+	struct sock *ssk = mptcp_subflow_tcp_sock(subflow);
+
+	return mptcp_subflow_active(subflow) && sk_stream_memory_free(ssk) &&
+	       tcp_sk(ssk)->snd_wnd;
+}
+
+/* Pick the subflow with the lowest wmem/pacing rate ratio, i.e. the one
+ * that will have drained what is already queued on it first.  Backup
+ * subflows are used only if no other subflow is active.
+ */
+static struct sock *mptcp_sched_default_get_subflow(struct mptcp_sock *msk)
+{
+	struct mptcp_subflow_context *subflow;
+	struct sock *pick[2] = { NULL, NULL };
+	u64 best[2] = { U64_MAX, U64_MAX };
+	int nr_active = 0;
+	struct sock *ssk;
+	u64 ratio;
+	u32 pace;
+
+	mptcp_for_each_subflow(msk, subflow) {
+		trace_mptcp_subflow_get_send(subflow);
+		ssk = mptcp_subflow_tcp_sock(subflow);
+		if (!mptcp_subflow_active(subflow))
+			continue;
+
+		nr_active += !subflow->backup;
+		if (!sk_stream_memory_free(ssk) || !tcp_sk(ssk)->snd_wnd)
+			continue;
+
+		pace = READ_ONCE(ssk->sk_pacing_rate);
+		if (!pace)
+			continue;
+
+		ratio = div_u64((u64)READ_ONCE(ssk->sk_wmem_queued) << 32,
+				pace);
+		if (ratio < best[subflow->backup]) {
+			pick[subflow->backup] = ssk;
+			best[subflow->backup] = ratio;
+		}
+	}
+
+	/* pick the best backup if no other subflow is active */
+	if (!nr_active && pick[1]) {
+		MPTCP_INC_STATS(sock_net((struct sock *)msk),
+				MPTCP_MIB_SCHEDBACKUP);
+		return pick[1];
+	}
+
+	return pick[0];
+}
+
+static struct mptcp_sched_ops mptcp_sched_default = {
+	.get_subflow	= mptcp_sched_default_get_subflow,
+	.name		= "default",
+};
+
+/* Take turns over the non-backup subflows that can send, starting after
+ * the one the previous burst went out on.
+ */
+static struct sock *mptcp_sched_rr_get_subflow(struct mptcp_sock *msk)
+{
+	struct mptcp_subflow_context *subflow, *first = NULL;
+	struct sock *backup = NULL;
+	bool after_last = !msk->last_snd;
+
+	mptcp_for_each_subflow(msk, subflow) {
+		struct sock *ssk = mptcp_subflow_tcp_sock(subflow);
+
+		if (ssk == msk->last_snd) {
+			after_last = true;
+			continue;
+		}
+		if (!mptcp_subflow_can_send(subflow))
+			continue;
+
+		if (subflow->backup) {
+			if (!backup)
+				backup = ssk;
+			continue;
+		}
+		if (after_last)
+			return ssk;
+		if (!first)
+			first = subflow;
+	}
+
+	if (first)
+		return mptcp_subflow_tcp_sock(first);
+
+	/* nothing else to turn to: keep going on the last one, if we can */
+	if (msk->last_snd &&
+	    mptcp_subflow_can_send(mptcp_subflow_ctx(msk->last_snd)))
+		return msk->last_snd;
+
+	return backup;
+}
+
+static struct mptcp_sched_ops mptcp_sched_rr = {
+	.get_subflow	= mptcp_sched_rr_get_subflow,
+	.name		= "roundrobin",
+};
+
+/* Find the non-backup (or, failing that, backup) subflow with the lowest
+ * smoothed RTT.  With @can_send only subflows that have room for new data
+ * are considered.
+ */
+static struct sock *mptcp_sched_lowest_rtt(struct mptcp_sock *msk,
+					   bool can_send)
+{
+	struct mptcp_subflow_context *subflow;
+	struct sock *pick[2] = { NULL, NULL };
+	u32 best[2] = { U32_MAX, U32_MAX };
+
+	mptcp_for_each_subflow(msk, subflow) {
+		struct sock *ssk = mptcp_subflow_tcp_sock(subflow);
+		u32 srtt = tcp_sk(ssk)->srtt_us;
+
+		if (can_send ? !mptcp_subflow_can_send(subflow) :
+			       !mptcp_subflow_active(subflow))
+			continue;
+
+		if (srtt < best[subflow->backup]) {
+			pick[subflow->backup] = ssk;
+			best[subflow->backup] = srtt;
+		}
+	}
+
+	return pick[0] ? : pick[1];
+}
+
+static struct sock *mptcp_sched_minrtt_get_subflow(struct mptcp_sock *msk)
+{
+	return mptcp_sched_lowest_rtt(msk, true);
+}
+
+static struct mptcp_sched_ops mptcp_sched_minrtt = {
+	.get_subflow	= mptcp_sched_minrtt_get_subflow,
+	.name		= "minrtt",
+};
+
+/* BLEST: like minrtt, but when the fastest subflow is full only fall back
+ * to a slower one if what it sends won't leave the receiver waiting for
+ * it.  While one RTT of the slow subflow elapses the fast subflow can
+ * send, growing its window by a segment per RTT, about
+ *
+ *	X = mss_f * (cwnd_f + (rtt_s / rtt_f - 1) / 2) * rtt_s / rtt_f
+ *
+ * bytes.  If X plus the data in flight on the slow subflow does not fit
+ * in the MPTCP send window, the slow subflow would stall the connection:
+ * wait for the fast one instead.
+ */
+static struct sock *mptcp_sched_blest_get_subflow(struct mptcp_sock *msk)
+{
+	struct sock *fast, *pick;
+	const struct tcp_sock *tf, *ts;
+	u64 ratio, x, wnd, inflight;
+
+	pick = mptcp_sched_lowest_rtt(msk, true);
+	fast = mptcp_sched_lowest_rtt(msk, false);
+	if (!pick || pick == fast || !fast)
+		return pick;
+
+	tf = tcp_sk(fast);
+	ts = tcp_sk(pick);
+	if (!tf->srtt_us || mptcp_subflow_ctx(pick)->backup)
+		return pick;
+
+	/* ratio in 1/1024 units */
+	ratio = div_u64((u64)ts->srtt_us << 10, tf->srtt_us);
+	x = (u64)tf->mss_cache * (tf->snd_cwnd + (ratio - 1024) / 2048);
+	x = (x * ratio) >> 10;
+
+	inflight = (u64)ts->mss_cache * (tcp_packets_in_flight(ts) + 1);
+	wnd = READ_ONCE(msk->wnd_end) - READ_ONCE(msk->snd_una);
+	if (x + inflight > wnd) {
+		MPTCP_INC_STATS(sock_net((struct sock *)msk),
+				MPTCP_MIB_SCHEDHOLAVOID);
+		return NULL;
+	}
+
+	return pick;
+}
+
+static struct mptcp_sched_ops mptcp_sched_blest = {
+	.get_subflow	= mptcp_sched_blest_get_subflow,
+	.name		= "blest",
+};
+
+/* Called at socket creation and clone time, the list only ever grows */
+void mptcp_sched_assign(struct mptcp_sock *msk)
+{
+	struct sock *sk = (struct sock *)msk;
+	struct mptcp_sched_ops *sched;
+
+	rcu_read_lock();
+	sched = mptcp_sched_find(mptcp_get_scheduler(sock_net(sk)));
+	rcu_read_unlock();
+
+	msk->sched = sched ? : &mptcp_sched_default;
+}
+
+void __init mptcp_sched_init(void)
+{
+	mptcp_register_scheduler(&mptcp_sched_default);
+	mptcp_register_scheduler(&mptcp_sched_rr);
+	mptcp_register_scheduler(&mptcp_sched_minrtt);
+	mptcp_register_scheduler(&mptcp_sched_blest);
+}
@@ -0,0 +1,756 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+/* Kernel module implementing an IP set type: the trie:net type
+ *
+ * The hash:net types probe the hash once for every prefix length present
+ * in the set.  Here the networks are stored in a multibit trie with a
+ * stride of 8 bits instead: every node covers one byte of the address,
+ * and each prefix ending in a node is expanded over the node slots it
+ * covers.  A slot thus tells the longest prefix of its node matching an
+ * address, and a lookup reads at most one slot per address byte (4 for
+ * IPv4, 16 for IPv6) no matter how many prefix lengths the set holds.
+ *
+ * Lookups are lockless under RCU, updates are serialized by the set lock.
+ */
+
+#include <linux/module.h>
+#include <linux/ip.h>
+#include <linux/skbuff.h>
+#include <linux/errno.h>
+#include <linux/bitmap.h>
+#include <linux/slab.h>
+#include <net/ip.h>
+#include <net/ipv6.h>
+#include <net/netlink.h>
+
+#include <linux/netfilter.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/ipset/pfxlen.h>
+#include <linux/netfilter/ipset/ip_set.h>
+
+#define IPSET_TYPE_REV_MIN	0
+#define IPSET_TYPE_REV_MAX	0
+
+MODULE_LICENSE("GPL");
+IP_SET_MODULE_DESC("trie:net", IPSET_TYPE_REV_MIN, IPSET_TYPE_REV_MAX);
+MODULE_ALIAS("ip_set_trie:net");
+
+#define trie_dereference(p, set)	\
+	rcu_dereference_protected(p,	\
+		lockdep_nfnl_is_held(NFNL_SUBSYS_IPSET) || \
+		lockdep_is_held(&(set)->lock))
+/* The set is being flushed under its lock, or destroyed */
+#define __trie_dereference(p)		\
+	rcu_dereference_protected(p, 1)
+
+#define TRIE_STRIDE		8
+#define TRIE_SLOTS		(1 << TRIE_STRIDE)
+#define TRIE_MAX_DEPTH		(128 / TRIE_STRIDE)
+
+/* The prefixes ending in a node are numbered as in a heap: a prefix of
+ * len bits (1..TRIE_STRIDE) and value v within the node is 1 << len | v.
+ */
+#define TRIE_PREFIXES		(2 * TRIE_SLOTS)
+
+/* A slot holds the cidr of the longest prefix of its node covering it,
+ * or zero, and whether that prefix is a nomatch entry.
+ */
+#define TRIE_SLOT_NOMATCH	0x100
+
+struct trie_children {
+	struct rcu_head rcu;
+	struct trie_node __rcu *node[TRIE_SLOTS];
+};
+
+struct trie_node {
+	u16 slot[TRIE_SLOTS];
+	struct trie_children __rcu *children;
+	u32 count;		/* prefixes in the subtree */
+	u16 nchildren;		/* child nodes */
+	DECLARE_BITMAP(prefixes, TRIE_PREFIXES);
+	DECLARE_BITMAP(nomatch, TRIE_PREFIXES);
+	struct rcu_head rcu;
+};
+
+/* The trie:net set */
+struct trie_net {
+	struct trie_node __rcu *root;
+	size_t memsize;		/* memory of nodes and children */
+	u8 bytes;		/* address length */
+};
+
+/* Member elements */
+struct trie_net_elem {
+	union nf_inet_addr ip;
+	u8 cidr;
+};
+
+/* Common functions */
+
+static u16
+trie_net_slot_value(const struct trie_node *n, unsigned int slot, u8 base)
+{
+	unsigned int len, idx;
+
+	for (len = TRIE_STRIDE; len > 0; len--) {
+		idx = 1 << len | slot >> (TRIE_STRIDE - len);
+		if (test_bit(idx, n->prefixes))
+			return (base + len) |
+			       (test_bit(idx, n->nomatch) ? TRIE_SLOT_NOMATCH
+							  : 0);
+	}
+	return 0;
+}
+
+/* Recompute the slots covered by prefix @v of @len bits in the node */
+static void
+trie_net_update_slots(struct trie_node *n, unsigned int len, unsigned int v,
+		      u8 base)
+{
+	unsigned int slot = v << (TRIE_STRIDE - len);
+	unsigned int end = (v + 1) << (TRIE_STRIDE - len);
+
+	for (; slot < end; slot++)
+		WRITE_ONCE(n->slot[slot], trie_net_slot_value(n, slot, base));
+}
+
+/* Longest prefix match: called under rcu_read_lock_bh() */
+static int
+trie_net_match(const struct trie_net *t, const u8 *key)
+{
+	const struct trie_node *n = rcu_dereference_bh(t->root);
+	const struct trie_children *c;
+	unsigned int i;
+	u16 s, best = 0;
+
+	for (i = 0; n && i < t->bytes; i++) {
+		s = READ_ONCE(n->slot[key[i]]);
+		if (s)
+			best = s;
+		c = rcu_dereference_bh(n->children);
+		if (!c)
+			break;
+		n = rcu_dereference_bh(c->node[key[i]]);
+	}
+	if (!best)
+		return 0;
+	return best & TRIE_SLOT_NOMATCH ? -ENOTEMPTY : 1;
+}
+
+static struct trie_node *
+trie_net_node_alloc(struct trie_net *t)
+{
+	struct trie_node *n = kzalloc(sizeof(*n), GFP_ATOMIC);
+
+	if (n)
+		t->memsize += sizeof(*n);
+	return n;
+}
+
+/* Walk down @key to the node at @level, creating the missing nodes if
+ * @create is set.  The nodes passed are stored in @path and their number
+ * in *depth, so that the caller can prune what was left empty.
+ */
+static struct trie_node *
+trie_net_walk(struct ip_set *set, const u8 *key, unsigned int level,
+	      struct trie_node **path, unsigned int *depth, bool create)
+{
+	struct trie_net *t = set->data;
+	struct trie_node __rcu **slot = &t->root;
+	struct trie_children *c;
+	struct trie_node *n;
+	unsigned int i;
+
+	*depth = 0;
+	for (i = 0; ; i++) {
+		n = trie_dereference(*slot, set);
+		if (!n) {
+			if (!create)
+				return NULL;
+			n = trie_net_node_alloc(t);
+			if (!n)
+				return NULL;
+			rcu_assign_pointer(*slot, n);
+			if (i)
+				path[i - 1]->nchildren++;
+		}
+		path[i] = n;
+		*depth = i + 1;
+		if (i == level)
+			return n;
+
+		c = trie_dereference(n->children, set);
+		if (!c) {
+			if (!create)
+				return NULL;
+			c = kzalloc(sizeof(*c), GFP_ATOMIC);
+			if (!c)
+				return NULL;
+			t->memsize += sizeof(*c);
+			rcu_assign_pointer(n->children, c);
+		}
+		slot = &c->node[key[i]];
+	}
+}
+
+/* Free the empty nodes at the bottom of @path */
+static void
+trie_net_prune(struct ip_set *set, const u8 *key, struct trie_node **path,
+	       unsigned int depth)
+{
+	struct trie_net *t = set->data;
+	struct trie_children *c;
+	struct trie_node *n;
+
+	while (depth--) {
+		n = path[depth];
+		c = trie_dereference(n->children, set);
+		if (c && !n->nchildren) {
+			RCU_INIT_POINTER(n->children, NULL);
+			t->memsize -= sizeof(*c);
+			kfree_rcu(c, rcu);
+		}
+		if (n->count)
+			break;
+
+		if (depth) {
+			c = trie_dereference(path[depth - 1]->children, set);
+			RCU_INIT_POINTER(c->node[key[depth - 1]], NULL);
+			path[depth - 1]->nchildren--;
+		} else {
+			RCU_INIT_POINTER(t->root, NULL);
+		}
+		t->memsize -= sizeof(*n);
+		kfree_rcu(n, rcu);
+	}
+}
+
+static void
+trie_net_free(struct ip_set *set, struct trie_node *n)
+{
+	struct trie_net *t = set->data;
+	struct trie_children *c = __trie_dereference(n->children);
+	struct trie_node *child;
+	unsigned int i;
+
+	if (c) {
+		for (i = 0; i < TRIE_SLOTS && n->nchildren; i++) {
+			child = __trie_dereference(c->node[i]);
+			if (child) {
+				trie_net_free(set, child);
+				n->nchildren--;
+			}
+		}
+		t->memsize -= sizeof(*c);
+		kfree_rcu(c, rcu);
+	}
+	t->memsize -= sizeof(*n);
+	kfree_rcu(n, rcu);
+}
+
+static void
+trie_net_flush(struct ip_set *set)
+{
+	struct trie_net *t = set->data;
+	struct trie_node *n = __trie_dereference(t->root);
+
+	if (n) {
+		RCU_INIT_POINTER(t->root, NULL);
+		trie_net_free(set, n);
+	}
+	set->elements = 0;
+}
+
+static void
+trie_net_destroy(struct ip_set *set)
+{
+	trie_net_flush(set);
+	kfree(set->data);
+	set->data = NULL;
+}
+
+static int
+trie_net_test(struct ip_set *set, void *value, const struct ip_set_ext *ext,
+	      struct ip_set_ext *mext, u32 flags)
+{
+	const struct trie_net *t = set->data;
+	const struct trie_net_elem *e = value;
+	const u8 *key = (const u8 *)&e->ip;
+	const struct trie_node *n = rcu_dereference_bh(t->root);
+	const struct trie_children *c;
+	unsigned int level, len, idx, i;
+
+	if (e->cidr == t->bytes * BITS_PER_BYTE)
+		return trie_net_match(t, key);
+
+	/* Exact match of the network */
+	level = (e->cidr - 1) / TRIE_STRIDE;
+	for (i = 0; n && i < level; i++) {
+		c = rcu_dereference_bh(n->children);
+		n = c ? rcu_dereference_bh(c->node[key[i]]) : NULL;
+	}
+	if (!n)
+		return 0;
+
+	len = e->cidr - level * TRIE_STRIDE;
+	idx = 1 << len | key[level] >> (TRIE_STRIDE - len);
+	if (!test_bit(idx, n->prefixes))
+		return 0;
+	return test_bit(idx, n->nomatch) ? -ENOTEMPTY : 1;
+}
+
+static int
+trie_net_add(struct ip_set *set, void *value, const struct ip_set_ext *ext,
+	     struct ip_set_ext *mext, u32 flags)
+{
+	const struct trie_net_elem *e = value;
+	const u8 *key = (const u8 *)&e->ip;
+	struct trie_node *path[TRIE_MAX_DEPTH], *n;
+	unsigned int level, len, v, idx, depth, i;
+
+	level = (e->cidr - 1) / TRIE_STRIDE;
+	len = e->cidr - level * TRIE_STRIDE;
+	v = key[level] >> (TRIE_STRIDE - len);
+	idx = 1 << len | v;
+
+	n = trie_net_walk(set, key, level, path, &depth, true);
+	if (!n) {
+		trie_net_prune(set, key, path, depth);
+		return -ENOMEM;
+	}
+
+	if (test_bit(idx, n->prefixes)) {
+		if (!(flags & IPSET_FLAG_EXIST))
+			return -IPSET_ERR_EXIST;
+	} else {
+		__set_bit(idx, n->prefixes);
+		for (i = 0; i <= level; i++)
+			path[i]->count++;
+		set->elements++;
+	}
+	__assign_bit(idx, n->nomatch, flags & (IPSET_FLAG_NOMATCH << 16));
+	trie_net_update_slots(n, len, v, level * TRIE_STRIDE);
+
+	return 0;
+}
+
+static int
+trie_net_del(struct ip_set *set, void *value, const struct ip_set_ext *ext,
+	     struct ip_set_ext *mext, u32 flags)
+{
+	const struct trie_net_elem *e = value;
+	const u8 *key = (const u8 *)&e->ip;
+	struct trie_node *path[TRIE_MAX_DEPTH], *n;
+	unsigned int level, len, v, idx, depth, i;
+
+	level = (e->cidr - 1) / TRIE_STRIDE;
+	len = e->cidr - level * TRIE_STRIDE;
+	v = key[level] >> (TRIE_STRIDE - len);
+	idx = 1 << len | v;
+
+	n = trie_net_walk(set, key, level, path, &depth, false);
+	if (!n || !test_bit(idx, n->prefixes))
+		return -IPSET_ERR_EXIST;
+
+	__clear_bit(idx, n->prefixes);
+	__clear_bit(idx, n->nomatch);
+	trie_net_update_slots(n, len, v, level * TRIE_STRIDE);
+	for (i = 0; i <= level; i++)
+		path[i]->count--;
+	set->elements--;
+	trie_net_prune(set, key, path, depth);
+
+	return 0;
+}
+
+static int
+trie_net_head(struct ip_set *set, struct sk_buff *skb)
+{
+	const struct trie_net *t = set->data;
+	struct nlattr *nested;
+	size_t memsize = sizeof(*t) + t->memsize;
+
+	nested = nla_nest_start(skb, IPSET_ATTR_DATA);
+	if (!nested)
+		goto nla_put_failure;
+	if (nla_put_net32(skb, IPSET_ATTR_REFERENCES, htonl(set->ref)) ||
+	    nla_put_net32(skb, IPSET_ATTR_MEMSIZE, htonl(memsize)) ||
+	    nla_put_net32(skb, IPSET_ATTR_ELEMENTS, htonl(set->elements)))
+		goto nla_put_failure;
+	if (unlikely(ip_set_put_flags(skb, set)))
+		goto nla_put_failure;
+	nla_nest_end(skb, nested);
+
+	return 0;
+nla_put_failure:
+	return -EMSGSIZE;
+}
+
+static bool
+trie_net_list_elem(const struct ip_set *set, struct sk_buff *skb,
+		   const u8 *key, u8 cidr, bool nomatch)
+{
+	struct nlattr *nested;
+	int ret;
+
+	nested = nla_nest_start(skb, IPSET_ATTR_DATA);
+	if (!nested)
+		return true;
+	if (set->family == NFPROTO_IPV4)
+		ret = nla_put_ipaddr4(skb, IPSET_ATTR_IP,
+				      *(const __be32 *)key);
+	else
+		ret = nla_put_ipaddr6(skb, IPSET_ATTR_IP,
+				      (const struct in6_addr *)key);
+	if (ret ||
+	    nla_put_u8(skb, IPSET_ATTR_CIDR, cidr) ||
+	    (nomatch &&
+	     nla_put_net32(skb, IPSET_ATTR_CADT_FLAGS,
+			   htonl(IPSET_FLAG_NOMATCH)))) {
+		nla_nest_cancel(skb, nested);
+		return true;
+	}
+	nla_nest_end(skb, nested);
+	return false;
+}
+
+/* List the subtree of @n, the first *skip elements of it are skipped */
+static int
+trie_net_list_node(const struct ip_set *set, struct sk_buff *skb,
+		   const struct trie_node *n, u8 *key, unsigned int level,
+		   unsigned long *skip, unsigned long *listed)
+{
+	const struct trie_net *t = set->data;
+	const struct trie_children *c;
+	const struct trie_node *child;
+	unsigned int idx, len, i;
+	int ret;
+
+	if (*skip >= n->count) {
+		*skip -= n->count;
+		return 0;
+	}
+
+	for_each_set_bit(idx, n->prefixes, TRIE_PREFIXES) {
+		if (*skip) {
+			(*skip)--;
+			continue;
+		}
+		len = fls(idx) - 1;
+		key[level] = (idx & ((1 << len) - 1)) << (TRIE_STRIDE - len);
+		memset(key + level + 1, 0, t->bytes - level - 1);
+		if (trie_net_list_elem(set, skb, key,
+				       level * TRIE_STRIDE + len,
+				       test_bit(idx, n->nomatch)))
+			return -EMSGSIZE;
+		(*listed)++;
+	}
+
+	c = rcu_dereference(n->children);
+	if (!c)
+		return 0;
+	for (i = 0; i < TRIE_SLOTS; i++) {
+		child = rcu_dereference(c->node[i]);
+		if (!child)
+			continue;
+		key[level] = i;
+		ret = trie_net_list_node(set, skb, child, key, level + 1,
+					 skip, listed);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+static int
+trie_net_list(const struct ip_set *set,
+	      struct sk_buff *skb, struct netlink_callback *cb)
+{
+	const struct trie_net *t = set->data;
+	unsigned long first, skip, listed = 0;
+	const struct trie_node *n;
+	struct nlattr *adt;
+	u8 key[16];
+	int ret = 0;
+
+	/* cb->args[IPSET_CB_ARG0] is one more than the elements listed */
+	first = cb->args[IPSET_CB_ARG0] ? cb->args[IPSET_CB_ARG0] - 1 : 0;
+	skip = first;
+
+	adt = nla_nest_start(skb, IPSET_ATTR_ADT);
+	if (!adt)
+		return -EMSGSIZE;
+	rcu_read_lock();
+	n = rcu_dereference(t->root);
+	if (n)
+		ret = trie_net_list_node(set, skb, n, key, 0, &skip, &listed);
+	rcu_read_unlock();
+
+	if (ret && !listed) {
+		nla_nest_cancel(skb, adt);
+		cb->args[IPSET_CB_ARG0] = 0;
+		return -EMSGSIZE;
+	}
+	nla_nest_end(skb, adt);
+	/* Zero when the set listing is finished */
+	cb->args[IPSET_CB_ARG0] = ret ? first + listed + 1 : 0;
+
+	return 0;
+}
+
+static bool
+trie_net_same_set(const struct ip_set *a, const struct ip_set *b)
+{
+	return a->extensions == b->extensions;
+}
+
+static void
+trie_net_parse_flags(struct nlattr *tb[], u32 *flags)
+{
+	if (tb[IPSET_ATTR_CADT_FLAGS]) {
+		u32 cadt_flags = ip_set_get_h32(tb[IPSET_ATTR_CADT_FLAGS]);
+
+		if (cadt_flags & IPSET_FLAG_NOMATCH)
+			*flags |= (IPSET_FLAG_NOMATCH << 16);
+	}
+}
+
+/* IPv4 variant */
+
+static int
+trie_net4_kadt(struct ip_set *set, const struct sk_buff *skb,
+	       const struct xt_action_param *par,
+	       enum ipset_adt adt, struct ip_set_adt_opt *opt)
+{
+	ipset_adtfn adtfn = set->variant->adt[adt];
+	struct trie_net_elem e = { .cidr = 32 };
+	struct ip_set_ext ext = IP_SET_INIT_KEXT(skb, opt, set);
+
+	ip4addrptr(skb, opt->flags & IPSET_DIM_ONE_SRC, &e.ip.ip);
+
+	return adtfn(set, &e, &ext, &opt->ext, opt->cmdflags);
+}
+
+static int
+trie_net4_uadt(struct ip_set *set, struct nlattr *tb[],
+	       enum ipset_adt adt, u32 *lineno, u32 flags, bool retried)
+{
+	ipset_adtfn adtfn = set->variant->adt[adt];
+	struct trie_net_elem e = { .cidr = 32 };
+	struct ip_set_ext ext = IP_SET_INIT_UEXT(set);
+	u32 ip = 0, ip_to = 0, ipn, n = 0;
+	int ret;
+
+	if (tb[IPSET_ATTR_LINENO])
+		*lineno = nla_get_u32(tb[IPSET_ATTR_LINENO]);
+
+	if (unlikely(!tb[IPSET_ATTR_IP] ||
+		     !ip_set_optattr_netorder(tb, IPSET_ATTR_CADT_FLAGS)))
+		return -IPSET_ERR_PROTOCOL;
+
+	ret = ip_set_get_hostipaddr4(tb[IPSET_ATTR_IP], &ip);
+	if (ret)
+		return ret;
+
+	ret = ip_set_get_extensions(set, tb, &ext);
+	if (ret)
+		return ret;
+
+	if (tb[IPSET_ATTR_CIDR]) {
+		e.cidr = nla_get_u8(tb[IPSET_ATTR_CIDR]);
+		if (!e.cidr || e.cidr > 32)
+			return -IPSET_ERR_INVALID_CIDR;
+	}
+
+	trie_net_parse_flags(tb, &flags);
+
+	if (adt == IPSET_TEST || !tb[IPSET_ATTR_IP_TO]) {
+		e.ip.ip = htonl(ip & ip_set_hostmask(e.cidr));
+		ret = adtfn(set, &e, &ext, &ext, flags);
+		return ip_set_enomatch(ret, flags, adt, set) ? -ret :
+		       ip_set_eexist(ret, flags) ? 0 : ret;
+	}
+
+	ret = ip_set_get_hostipaddr4(tb[IPSET_ATTR_IP_TO], &ip_to);
+	if (ret)
+		return ret;
+	if (ip_to < ip)
+		swap(ip, ip_to);
+	/* 0.0.0.0/0 is not a valid element */
+	if (ip + UINT_MAX == ip_to)
+		return -IPSET_ERR_INVALID_CIDR;
+
+	ipn = ip;
+	do {
+		ipn = ip_set_range_to_cidr(ipn, ip_to, &e.cidr);
+		n++;
+	} while (ipn++ < ip_to);
+
+	if (n > IPSET_MAX_RANGE)
+		return -ERANGE;
+
+	do {
+		e.ip.ip = htonl(ip);
+		ip = ip_set_range_to_cidr(ip, ip_to, &e.cidr);
+		ret = adtfn(set, &e, &ext, &ext, flags);
+		if (ret && !ip_set_eexist(ret, flags))
+			return ret;
+
+		ret = 0;
+	} while (ip++ < ip_to);
+	return ret;
+}
+
+static const struct ip_set_type_variant trie_net4 = {
+	.kadt	= trie_net4_kadt,
+	.uadt	= trie_net4_uadt,
+	.adt	= {
+		[IPSET_ADD] = trie_net_add,
+		[IPSET_DEL] = trie_net_del,
+		[IPSET_TEST] = trie_net_test,
+	},
+	.destroy = trie_net_destroy,
+	.flush	= trie_net_flush,
+	.head	= trie_net_head,
+	.list	= trie_net_list,
+	.same_set = trie_net_same_set,
+};
+
+/* IPv6 variant */
+
+static int
+trie_net6_kadt(struct ip_set *set, const struct sk_buff *skb,
+	       const struct xt_action_param *par,
+	       enum ipset_adt adt, struct ip_set_adt_opt *opt)
+{
+	ipset_adtfn adtfn = set->variant->adt[adt];
+	struct trie_net_elem e = { .cidr = 128 };
+	struct ip_set_ext ext = IP_SET_INIT_KEXT(skb, opt, set);
+
+	ip6addrptr(skb, opt->flags & IPSET_DIM_ONE_SRC, &e.ip.in6);
+
+	return adtfn(set, &e, &ext, &opt->ext, opt->cmdflags);
+}
+
+static int
+trie_net6_uadt(struct ip_set *set, struct nlattr *tb[],
+	       enum ipset_adt adt, u32 *lineno, u32 flags, bool retried)
+{
+	ipset_adtfn adtfn = set->variant->adt[adt];
+	struct trie_net_elem e = { .cidr = 128 };
+	struct ip_set_ext ext = IP_SET_INIT_UEXT(set);
+	int ret;
+
+	if (tb[IPSET_ATTR_LINENO])
+		*lineno = nla_get_u32(tb[IPSET_ATTR_LINENO]);
+
+	if (unlikely(!tb[IPSET_ATTR_IP] ||
+		     !ip_set_optattr_netorder(tb, IPSET_ATTR_CADT_FLAGS)))
+		return -IPSET_ERR_PROTOCOL;
+	if (unlikely(tb[IPSET_ATTR_IP_TO]))
+		return -IPSET_ERR_PROTOCOL;
+
+	ret = ip_set_get_ipaddr6(tb[IPSET_ATTR_IP], &e.ip);
+	if (ret)
+		return ret;
+
+	ret = ip_set_get_extensions(set, tb, &ext);
+	if (ret)
+		return ret;
+
+	if (tb[IPSET_ATTR_CIDR]) {
+		e.cidr = nla_get_u8(tb[IPSET_ATTR_CIDR]);
+		if (!e.cidr || e.cidr > 128)
+			return -IPSET_ERR_INVALID_CIDR;
+	}
+
+	ip6_netmask(&e.ip, e.cidr);
+
+	trie_net_parse_flags(tb, &flags);
+
+	ret = adtfn(set, &e, &ext, &ext, flags);
+
+	return ip_set_enomatch(ret, flags, adt, set) ? -ret :
+	       ip_set_eexist(ret, flags) ? 0 : ret;
+}
+
+static const struct ip_set_type_variant trie_net6 = {
+	.kadt	= trie_net6_kadt,
+	.uadt	= trie_net6_uadt,
+	.adt	= {
+		[IPSET_ADD] = trie_net_add,
+		[IPSET_DEL] = trie_net_del,
+		[IPSET_TEST] = trie_net_test,
+	},
+	.destroy = trie_net_destroy,
+	.flush	= trie_net_flush,
+	.head	= trie_net_head,
+	.list	= trie_net_list,
+	.same_set = trie_net_same_set,
+};
+
+static int
+trie_net_create(struct net *net, struct ip_set *set, struct nlattr *tb[],
+		u32 flags)
+{
+	struct trie_net *t;
+
+	if (!(set->family == NFPROTO_IPV4 || set->family == NFPROTO_IPV6))
+		return -IPSET_ERR_INVALID_FAMILY;
+
+	t = kzalloc(sizeof(*t), GFP_KERNEL);
+	if (!t)
+		return -ENOMEM;
+
+	t->bytes = set->family == NFPROTO_IPV4 ? 4 : 16;
+	set->data = t;
+	set->variant = set->family == NFPROTO_IPV4 ? &trie_net4 : &trie_net6;
+	set->dsize = 0;
+
+	pr_debug("create %s trie %p\n", set->name, t);
+
+	return 0;
+}
+
+static struct ip_set_type trie_net_type __read_mostly = {
+	.name		= "trie:net",
+	.protocol	= IPSET_PROTOCOL,
+	.features	= IPSET_TYPE_IP | IPSET_TYPE_NOMATCH,
+	.dimension	= IPSET_DIM_ONE,
+	.family		= NFPROTO_UNSPEC,
+	.revision_min	= IPSET_TYPE_REV_MIN,
+	.revision_max	= IPSET_TYPE_REV_MAX,
+	.create		= trie_net_create,
+	.adt_policy	= {
+		[IPSET_ATTR_IP]		= { .type = NLA_NESTED },
+		[IPSET_ATTR_IP_TO]	= { .type = NLA_NESTED },
+		[IPSET_ATTR_CIDR]	= { .type = NLA_U8 },
+		[IPSET_ATTR_TIMEOUT]	= { .type = NLA_U32 },
+		[IPSET_ATTR_LINENO]	= { .type = NLA_U32 },
+		[IPSET_ATTR_CADT_FLAGS]	= { .type = NLA_U32 },
+		[IPSET_ATTR_BYTES]	= { .type = NLA_U64 },
+		[IPSET_ATTR_PACKETS]	= { .type = NLA_U64 },
+		[IPSET_ATTR_COMMENT]	= { .type = NLA_NUL_STRING,
+					    .len  = IPSET_MAX_COMMENT_SIZE },
+		[IPSET_ATTR_SKBMARK]	= { .type = NLA_U64 },
+		[IPSET_ATTR_SKBPRIO]	= { .type = NLA_U32 },
+		[IPSET_ATTR_SKBQUEUE]	= { .type = NLA_U16 },
+	},
+	.me		= THIS_MODULE,
+};
+
+static int __init
+trie_net_init(void)
+{
+	return ip_set_type_register(&trie_net_type);
+}
+
+static void __exit
+trie_net_fini(void)
+{
+	rcu_barrier();
+	ip_set_type_unregister(&trie_net_type);
+}
+
+module_init(trie_net_init);
+module_exit(trie_net_fini);
@@ -32,6 +32,9 @@
 #include <linux/seq_file.h>
 #include <linux/jhash.h>
 #include <linux/random.h>
+#include <linux/percpu_counter.h>
+#include <linux/seqlock.h>
+#include <linux/workqueue.h>
 
 #include <net/net_namespace.h>
 #include <net/ip_vs.h>
@@ -42,20 +45,46 @@
 #endif
 
 /*
- * Connection hash size. Default is what was selected at compile time.
+ * Initial connection hash size. Default is what was selected at compile time.
 */
 static int ip_vs_conn_tab_bits = CONFIG_IP_VS_TAB_BITS;
 module_param_named(conn_tab_bits, ip_vs_conn_tab_bits, int, 0444);
-MODULE_PARM_DESC(conn_tab_bits, "Set connections' hash size");
+MODULE_PARM_DESC(conn_tab_bits, "Set connections' initial hash size");
 
-/* size and mask values */
+/* The table is doubled when it holds more connections per bucket than this */
+#define IP_VS_CONN_TAB_LOAD	2
+#define IP_VS_CONN_TAB_MAX_BITS	25
+/* Buckets moved at a time when the table is resized */
+#define IP_VS_CONN_TAB_MOVE	256
+
+/* current size */
 int ip_vs_conn_tab_size __read_mostly;
-static int ip_vs_conn_tab_mask __read_mostly;
 
 /*
  *  Connection hash table: for input and output packets lookups of IPVS
  */
-static struct hlist_head *ip_vs_conn_tab __read_mostly;
+struct ip_vs_conn_htable {
+	unsigned int		mask;
+	struct hlist_head	buckets[];
+};
+
+static struct ip_vs_conn_htable __rcu *ip_vs_conn_tab __read_mostly;
+
+/*
+ * While the table is resized, connections are moved to the new table a few
+ * buckets at a time, and new ones are added to it.  Lookups then search both
+ * tables.  Connections only move inside write sections of
+ * ip_vs_conn_generation, so a lookup that missed has to be retried if one
+ * ran meanwhile: it may have followed a moved entry into the other table.
+ */
+static struct ip_vs_conn_htable __rcu *ip_vs_conn_new_tab;
+static seqcount_t ip_vs_conn_generation = SEQCNT_ZERO(ip_vs_conn_generation);
+static DEFINE_MUTEX(ip_vs_conn_resize_mutex);
+static void ip_vs_conn_tab_resize(struct work_struct *work);
+static DECLARE_WORK(ip_vs_conn_resize_work, ip_vs_conn_tab_resize);
+
+/* number of hashed connections, in all netns */
+static struct percpu_counter ip_vs_conn_hashed;
 
 /*  SLAB cache for IPVS connections */
 static struct kmem_cache *ip_vs_conn_cachep __read_mostly;
@@ -99,10 +128,79 @@ static inline void ct_write_unlock_bh(unsigned int key)
 	spin_unlock_bh(&__ip_vs_conntbl_lock_array[key&CT_LOCKARRAY_MASK].l);
 }
 
+/* Called with ip_vs_conn_resize_mutex held */
+static void ct_write_lock_all_bh(void)
+{
+	int idx;
+
+	local_bh_disable();
+	for (idx = 0; idx < CT_LOCKARRAY_SIZE; idx++)
+		spin_lock_nest_lock(&__ip_vs_conntbl_lock_array[idx].l,
+				    &ip_vs_conn_resize_mutex);
+}
+
+static void ct_write_unlock_all_bh(void)
+{
+	int idx;
+
+	for (idx = 0; idx < CT_LOCKARRAY_SIZE; idx++)
+		spin_unlock(&__ip_vs_conntbl_lock_array[idx].l);
+	local_bh_enable();
+}
+
+/* Table to walk for a full scan: 0 is the table, 1 the new one if resizing */
+static struct ip_vs_conn_htable *ip_vs_conn_tab_get(int i)
+{
+	switch (i) {
+	case 0:
+		return rcu_dereference(ip_vs_conn_tab);
+	case 1:
+		return rcu_dereference(ip_vs_conn_new_tab);
+	}
+	return NULL;
+}
+
+/* Fill @heads with the chains @hash can be on and return how many there are */
+static int ip_vs_conn_buckets(unsigned int hash, struct hlist_head **heads)
+{
+	struct ip_vs_conn_htable *t;
+	int n = 0;
+
+	t = rcu_dereference(ip_vs_conn_tab);
+	heads[n++] = &t->buckets[hash & t->mask];
+	t = rcu_dereference(ip_vs_conn_new_tab);
+	if (t)
+		heads[n++] = &t->buckets[hash & t->mask];
+	return n;
+}
+
+/* Chain to add to, called with the conn table lock for @hash held */
+static struct hlist_head *ip_vs_conn_bucket_locked(unsigned int hash)
+{
+	struct ip_vs_conn_htable *t;
+
+	t = rcu_dereference_protected(ip_vs_conn_new_tab, 1);
+	if (!t)
+		t = rcu_dereference_protected(ip_vs_conn_tab, 1);
+	return &t->buckets[hash & t->mask];
+}
+
+static void ip_vs_conn_tab_maybe_grow(void)
+{
+	int size = READ_ONCE(ip_vs_conn_tab_size);
+
+	if (size < (1 << IP_VS_CONN_TAB_MAX_BITS) &&
+	    percpu_counter_read_positive(&ip_vs_conn_hashed) >
+			(s64)size * IP_VS_CONN_TAB_LOAD &&
+	    !work_pending(&ip_vs_conn_resize_work))
+		schedule_work(&ip_vs_conn_resize_work);
+}
+
 static void ip_vs_conn_expire(struct timer_list *t);
 
 /*
- *	Returns hash value for IPVS connection entry
+ *	Returns hash value for IPVS connection entry, the bucket is picked
+ *	from its low bits
  */
 static unsigned int ip_vs_conn_hashkey(struct netns_ipvs *ipvs, int af, unsigned int proto,
 				       const union nf_inet_addr *addr,
@@ -110,13 +208,13 @@ static unsigned int ip_vs_conn_hashkey(struct netns_ipvs *ipvs, int af, unsigned
 {
 #ifdef CONFIG_IP_VS_IPV6
 	if (af == AF_INET6)
-		return (jhash_3words(jhash(addr, 16, ip_vs_conn_rnd),
+		return jhash_3words(jhash(addr, 16, ip_vs_conn_rnd),
 				    (__force u32)port, proto, ip_vs_conn_rnd) ^
-			((size_t)ipvs>>8)) & ip_vs_conn_tab_mask;
+			((size_t)ipvs>>8);
 #endif
-	return (jhash_3words((__force u32)addr->ip, (__force u32)port, proto,
+	return jhash_3words((__force u32)addr->ip, (__force u32)port, proto,
 			    ip_vs_conn_rnd) ^
-		((size_t)ipvs>>8)) & ip_vs_conn_tab_mask;
+		((size_t)ipvs>>8);
 }
 
 static unsigned int ip_vs_conn_hashkey_param(const struct ip_vs_conn_param *p,
@@ -126,8 +224,7 @@ static unsigned int ip_vs_conn_hashkey_param(const struct ip_vs_conn_param *p,
 	__be16 port;
 
 	if (p->pe_data && p->pe->hashkey_raw)
-		return p->pe->hashkey_raw(p, ip_vs_conn_rnd, inverse) &
-			ip_vs_conn_tab_mask;
+		return p->pe->hashkey_raw(p, ip_vs_conn_rnd, inverse);
 
 	if (likely(!inverse)) {
 		addr = p->caddr;
@@ -177,7 +274,8 @@ static inline int ip_vs_conn_hash(struct ip_vs_conn *cp)
 	if (!(cp->flags & IP_VS_CONN_F_HASHED)) {
 		cp->flags |= IP_VS_CONN_F_HASHED;
 		refcount_inc(&cp->refcnt);
-		hlist_add_head_rcu(&cp->c_list, &ip_vs_conn_tab[hash]);
+		hlist_add_head_rcu(&cp->c_list, ip_vs_conn_bucket_locked(hash));
+		percpu_counter_inc(&ip_vs_conn_hashed);
 		ret = 1;
 	} else {
 		pr_err("%s(): request for already hashed, called from %pS\n",
@@ -188,6 +286,9 @@ static inline int ip_vs_conn_hash(struct ip_vs_conn *cp)
 	spin_unlock(&cp->lock);
 	ct_write_unlock_bh(hash);
 
+	if (ret)
+		ip_vs_conn_tab_maybe_grow();
+
 	return ret;
 }
 
@@ -209,6 +310,7 @@ static inline int ip_vs_conn_unhash(struct ip_vs_conn *cp)
 
 	if (cp->flags & IP_VS_CONN_F_HASHED) {
 		hlist_del_rcu(&cp->c_list);
+		percpu_counter_dec(&ip_vs_conn_hashed);
 		cp->flags &= ~IP_VS_CONN_F_HASHED;
 		refcount_dec(&cp->refcnt);
 		ret = 1;
@@ -241,6 +343,7 @@ static inline bool ip_vs_conn_unlink(struct ip_vs_conn *cp)
 		/* Decrease refcnt and unlink conn only if we are last user */
 		if (refcount_dec_if_one(&cp->refcnt)) {
 			hlist_del_rcu(&cp->c_list);
+			percpu_counter_dec(&ip_vs_conn_hashed);
 			cp->flags &= ~IP_VS_CONN_F_HASHED;
 			ret = true;
 		}
@@ -252,6 +355,88 @@ static inline bool ip_vs_conn_unlink(struct ip_vs_conn *cp)
 	return ret;
 }
 
+static struct ip_vs_conn_htable *ip_vs_conn_tab_alloc(unsigned int size)
+{
+	struct ip_vs_conn_htable *tab;
+	unsigned int idx;
+
+	tab = kvmalloc(struct_size(tab, buckets, size), GFP_KERNEL);
+	if (!tab)
+		return NULL;
+
+	tab->mask = size - 1;
+	for (idx = 0; idx < size; idx++)
+		INIT_HLIST_HEAD(&tab->buckets[idx]);
+	return tab;
+}
+
+/*
+ *	Double the connection table.  The connections are moved over a few
+ *	buckets at a time with all the conn table locks held, so that packets
+ *	are only held up for short while whatever the table size is.
+ */
+static void ip_vs_conn_tab_resize(struct work_struct *work)
+{
+	struct ip_vs_conn_htable *old, *new;
+	struct hlist_node *n;
+	struct ip_vs_conn *cp;
+	unsigned int idx, end, hash;
+
+	mutex_lock(&ip_vs_conn_resize_mutex);
+	old = rcu_dereference_protected(ip_vs_conn_tab,
+			lockdep_is_held(&ip_vs_conn_resize_mutex));
+	if (old->mask + 1 >= (1U << IP_VS_CONN_TAB_MAX_BITS) ||
+	    percpu_counter_sum_positive(&ip_vs_conn_hashed) <=
+			(s64)(old->mask + 1) * IP_VS_CONN_TAB_LOAD)
+		goto out;
+
+	new = ip_vs_conn_tab_alloc((old->mask + 1) * 2);
+	if (!new)
+		goto out;
+
+	/* From now on new connections go to the new table */
+	ct_write_lock_all_bh();
+	write_seqcount_begin(&ip_vs_conn_generation);
+	rcu_assign_pointer(ip_vs_conn_new_tab, new);
+	write_seqcount_end(&ip_vs_conn_generation);
+	ct_write_unlock_all_bh();
+
+	for (idx = 0; idx <= old->mask; idx = end) {
+		end = min(idx + IP_VS_CONN_TAB_MOVE, old->mask + 1);
+
+		ct_write_lock_all_bh();
+		write_seqcount_begin(&ip_vs_conn_generation);
+		for (; idx < end; idx++) {
+			hlist_for_each_entry_safe(cp, n, &old->buckets[idx],
+						  c_list) {
+				hash = ip_vs_conn_hashkey_conn(cp) & new->mask;
+				hlist_del_rcu(&cp->c_list);
+				hlist_add_head_rcu(&cp->c_list,
+						   &new->buckets[hash]);
+			}
+		}
+		write_seqcount_end(&ip_vs_conn_generation);
+		ct_write_unlock_all_bh();
+		cond_resched();
+	}
+
+	ct_write_lock_all_bh();
+	write_seqcount_begin(&ip_vs_conn_generation);
+	rcu_assign_pointer(ip_vs_conn_tab, new);
+	RCU_INIT_POINTER(ip_vs_conn_new_tab, NULL);
+	WRITE_ONCE(ip_vs_conn_tab_size, new->mask + 1);
+	write_seqcount_end(&ip_vs_conn_generation);
+	ct_write_unlock_all_bh();
+
+	synchronize_net();
+	kvfree(old);
+
+	IP_VS_DBG(1, "Connection hash table resized to %d buckets\n",
+		  ip_vs_conn_tab_size);
+out:
+	mutex_unlock(&ip_vs_conn_resize_mutex);
+}
+
 
 /*
  *  Gets ip_vs_conn associated with supplied parameters in the ip_vs_conn_tab.
@@ -262,28 +447,40 @@ static inline bool ip_vs_conn_unlink(struct ip_vs_conn *cp)
 static inline struct ip_vs_conn *
 __ip_vs_conn_in_get(const struct ip_vs_conn_param *p)
 {
-	unsigned int hash;
+	struct hlist_head *heads[2];
+	unsigned int hash, seq;
 	struct ip_vs_conn *cp;
+	int i, n;
 
 	hash = ip_vs_conn_hashkey_param(p, false);
 
 	rcu_read_lock();
 
-	hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[hash], c_list) {
-		if (p->cport == cp->cport && p->vport == cp->vport &&
-		    cp->af == p->af &&
-		    ip_vs_addr_equal(p->af, p->caddr, &cp->caddr) &&
-		    ip_vs_addr_equal(p->af, p->vaddr, &cp->vaddr) &&
-		    ((!p->cport) ^ (!(cp->flags & IP_VS_CONN_F_NO_CPORT))) &&
-		    p->protocol == cp->protocol &&
-		    cp->ipvs == p->ipvs) {
-			if (!__ip_vs_conn_get(cp))
-				continue;
-			/* HIT */
-			rcu_read_unlock();
-			return cp;
+	do {
+		seq = read_seqcount_begin(&ip_vs_conn_generation);
+		n = ip_vs_conn_buckets(hash, heads);
+		for (i = 0; i < n; i++) {
+			hlist_for_each_entry_rcu(cp, heads[i], c_list) {
+				if (p->cport == cp->cport &&
+				    p->vport == cp->vport &&
+				    cp->af == p->af &&
+				    ip_vs_addr_equal(p->af, p->caddr,
+						     &cp->caddr) &&
+				    ip_vs_addr_equal(p->af, p->vaddr,
+						     &cp->vaddr) &&
+				    ((!p->cport) ^
+				     (!(cp->flags & IP_VS_CONN_F_NO_CPORT))) &&
+				    p->protocol == cp->protocol &&
+				    cp->ipvs == p->ipvs) {
+					if (!__ip_vs_conn_get(cp))
+						continue;
+					/* HIT */
+					rcu_read_unlock();
+					return cp;
+				}
+			}
 		}
-	}
+	} while (read_seqcount_retry(&ip_vs_conn_generation, seq));
 
 	rcu_read_unlock();
 
@@ -345,41 +542,48 @@ ip_vs_conn_in_get_proto(struct netns_ipvs *ipvs, int af,
 }
 EXPORT_SYMBOL_GPL(ip_vs_conn_in_get_proto);
 
+static bool ip_vs_ct_match(const struct ip_vs_conn_param *p,
+			   struct ip_vs_conn *cp)
+{
+	if (unlikely(p->pe_data && p->pe->ct_match))
+		return cp->ipvs == p->ipvs && p->pe == cp->pe &&
+		       p->pe->ct_match(p, cp);
+
+	return cp->af == p->af &&
+	       ip_vs_addr_equal(p->af, p->caddr, &cp->caddr) &&
+	       /* protocol should only be IPPROTO_IP if
+		* p->vaddr is a fwmark */
+	       ip_vs_addr_equal(p->protocol == IPPROTO_IP ? AF_UNSPEC :
+				p->af, p->vaddr, &cp->vaddr) &&
+	       p->vport == cp->vport && p->cport == cp->cport &&
+	       cp->flags & IP_VS_CONN_F_TEMPLATE &&
+	       p->protocol == cp->protocol &&
+	       cp->ipvs == p->ipvs;
+}
+
 /* Get reference to connection template */
 struct ip_vs_conn *ip_vs_ct_in_get(const struct ip_vs_conn_param *p)
 {
-	unsigned int hash;
+	struct hlist_head *heads[2];
+	unsigned int hash, seq;
 	struct ip_vs_conn *cp;
+	int i, n;
 
 	hash = ip_vs_conn_hashkey_param(p, false);
 
 	rcu_read_lock();
 
-	hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[hash], c_list) {
-		if (unlikely(p->pe_data && p->pe->ct_match)) {
-			if (cp->ipvs != p->ipvs)
-				continue;
-			if (p->pe == cp->pe && p->pe->ct_match(p, cp)) {
-				if (__ip_vs_conn_get(cp))
+	do {
+		seq = read_seqcount_begin(&ip_vs_conn_generation);
+		n = ip_vs_conn_buckets(hash, heads);
+		for (i = 0; i < n; i++) {
+			hlist_for_each_entry_rcu(cp, heads[i], c_list) {
+				if (ip_vs_ct_match(p, cp) &&
+				    __ip_vs_conn_get(cp))
 					goto out;
 			}
-			continue;
-		}
-
-		if (cp->af == p->af &&
-		    ip_vs_addr_equal(p->af, p->caddr, &cp->caddr) &&
-		    /* protocol should only be IPPROTO_IP if
-		     * p->vaddr is a fwmark */
-		    ip_vs_addr_equal(p->protocol == IPPROTO_IP ? AF_UNSPEC :
-				     p->af, p->vaddr, &cp->vaddr) &&
-		    p->vport == cp->vport && p->cport == cp->cport &&
-		    cp->flags & IP_VS_CONN_F_TEMPLATE &&
-		    p->protocol == cp->protocol &&
-		    cp->ipvs == p->ipvs) {
-			if (__ip_vs_conn_get(cp))
-				goto out;
 		}
-	}
+	} while (read_seqcount_retry(&ip_vs_conn_generation, seq));
 	cp = NULL;
 
   out:
@@ -394,16 +598,40 @@ struct ip_vs_conn *ip_vs_ct_in_get(const struct ip_vs_conn_param *p)
 	return cp;
 }
 
+static bool ip_vs_conn_out_match(const struct ip_vs_conn_param *p,
+				 struct ip_vs_conn *cp)
+{
+	const union nf_inet_addr *saddr;
+	__be16 sport;
+
+	if (p->vport != cp->cport)
+		return false;
+
+	if (IP_VS_FWD_METHOD(cp) != IP_VS_CONN_F_MASQ) {
+		sport = cp->vport;
+		saddr = &cp->vaddr;
+	} else {
+		sport = cp->dport;
+		saddr = &cp->daddr;
+	}
+
+	return p->cport == sport && cp->af == p->af &&
+	       ip_vs_addr_equal(p->af, p->vaddr, &cp->caddr) &&
+	       ip_vs_addr_equal(p->af, p->caddr, saddr) &&
+	       p->protocol == cp->protocol &&
+	       cp->ipvs == p->ipvs;
+}
+
 /* Gets ip_vs_conn associated with supplied parameters in the ip_vs_conn_tab.
  * Called for pkts coming from inside-to-OUTside.
  *	p->caddr, p->cport: pkt source address (inside host)
  *	p->vaddr, p->vport: pkt dest address (foreign host) */
 struct ip_vs_conn *ip_vs_conn_out_get(const struct ip_vs_conn_param *p)
 {
-	unsigned int hash;
 	struct ip_vs_conn *cp, *ret=NULL;
-	const union nf_inet_addr *saddr;
-	__be16 sport;
+	struct hlist_head *heads[2];
+	unsigned int hash, seq;
+	int i, n;
 
 	/*
 	 *	Check for "full" addressed entries
@@ -412,31 +640,22 @@ struct ip_vs_conn *ip_vs_conn_out_get(const struct ip_vs_conn_param *p)
 
 	rcu_read_lock();
 
-	hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[hash], c_list) {
-		if (p->vport != cp->cport)
-			continue;
-
-		if (IP_VS_FWD_METHOD(cp) != IP_VS_CONN_F_MASQ) {
-			sport = cp->vport;
-			saddr = &cp->vaddr;
-		} else {
-			sport = cp->dport;
-			saddr = &cp->daddr;
-		}
-
-		if (p->cport == sport && cp->af == p->af &&
-		    ip_vs_addr_equal(p->af, p->vaddr, &cp->caddr) &&
-		    ip_vs_addr_equal(p->af, p->caddr, saddr) &&
-		    p->protocol == cp->protocol &&
-		    cp->ipvs == p->ipvs) {
-			if (!__ip_vs_conn_get(cp))
-				continue;
-			/* HIT */
-			ret = cp;
-			break;
+	do {
+		seq = read_seqcount_begin(&ip_vs_conn_generation);
+		n = ip_vs_conn_buckets(hash, heads);
+		for (i = 0; i < n; i++) {
+			hlist_for_each_entry_rcu(cp, heads[i], c_list) {
+				if (ip_vs_conn_out_match(p, cp) &&
+				    __ip_vs_conn_get(cp)) {
+					/* HIT */
+					ret = cp;
+					goto out;
+				}
+			}
 		}
-	}
+	} while (read_seqcount_retry(&ip_vs_conn_generation, seq));
 
+out:
 	rcu_read_unlock();
 
 	IP_VS_DBG_BUF(9, "lookup/out %s %s:%d->%s:%d %s\n",
@@ -1046,27 +1265,44 @@ ip_vs_conn_new(const struct ip_vs_conn_param *p, int dest_af,
 #ifdef CONFIG_PROC_FS
 struct ip_vs_iter_state {
 	struct seq_net_private	p;
-	struct hlist_head	*l;
+	struct ip_vs_conn_htable *tab;
+	int			t;
+	unsigned int		idx;
 };
 
-static void *ip_vs_conn_array(struct seq_file *seq, loff_t pos)
+static void *ip_vs_conn_array(struct seq_file *seq, loff_t start)
 {
-	int idx;
-	struct ip_vs_conn *cp;
 	struct ip_vs_iter_state *iter = seq->private;
-
-	for (idx = 0; idx < ip_vs_conn_tab_size; idx++) {
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[idx], c_list) {
-			/* __ip_vs_conn_get() is not needed by
-			 * ip_vs_conn_seq_show and ip_vs_conn_sync_seq_show
-			 */
-			if (pos-- == 0) {
-				iter->l = &ip_vs_conn_tab[idx];
-				return cp;
+	struct ip_vs_conn_htable *tab;
+	struct ip_vs_conn *cp;
+	unsigned int idx;
+	loff_t pos;
+	int t;
+
+again:
+	pos = start;
+	for (t = 0; (tab = ip_vs_conn_tab_get(t)); t++) {
+		for (idx = 0; idx <= tab->mask; idx++) {
+			hlist_for_each_entry_rcu(cp, &tab->buckets[idx],
+						 c_list) {
+				/* __ip_vs_conn_get() is not needed by
+				 * ip_vs_conn_seq_show and
+				 * ip_vs_conn_sync_seq_show
+				 */
+				if (pos-- == 0) {
+					iter->tab = tab;
+					iter->t = t;
+					iter->idx = idx;
+					return cp;
+				}
 			}
+			cond_resched_rcu();
+			/* resized while we were not looking */
+			if (tab != ip_vs_conn_tab_get(t))
+				goto again;
 		}
-		cond_resched_rcu();
 	}
+	iter->tab = NULL;
 
 	return NULL;
 }
@@ -1076,7 +1312,7 @@ static void *ip_vs_conn_seq_start(struct seq_file *seq, loff_t *pos)
 {
 	struct ip_vs_iter_state *iter = seq->private;
 
-	iter->l = NULL;
+	iter->tab = NULL;
 	rcu_read_lock();
 	return *pos ? ip_vs_conn_array(seq, *pos - 1) :SEQ_START_TOKEN;
 }
@@ -1085,9 +1321,8 @@ static void *ip_vs_conn_seq_next(struct seq_file *seq, void *v, loff_t *pos)
 {
 	struct ip_vs_conn *cp = v;
 	struct ip_vs_iter_state *iter = seq->private;
+	struct ip_vs_conn_htable *tab = iter->tab;
 	struct hlist_node *e;
-	struct hlist_head *l = iter->l;
-	int idx;
 
 	++*pos;
 	if (v == SEQ_START_TOKEN)
@@ -1098,15 +1333,19 @@ static void *ip_vs_conn_seq_next(struct seq_file *seq, void *v, loff_t *pos)
 	if (e)
 		return hlist_entry(e, struct ip_vs_conn, c_list);
 
-	idx = l - ip_vs_conn_tab;
-	while (++idx < ip_vs_conn_tab_size) {
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[idx], c_list) {
-			iter->l = &ip_vs_conn_tab[idx];
-			return cp;
+	while (tab) {
+		while (++iter->idx <= tab->mask) {
+			hlist_for_each_entry_rcu(cp, &tab->buckets[iter->idx],
+						 c_list)
+				return cp;
+			cond_resched_rcu();
+			if (tab != ip_vs_conn_tab_get(iter->t))
+				return ip_vs_conn_array(seq, *pos - 1);
 		}
-		cond_resched_rcu();
+		tab = ip_vs_conn_tab_get(++iter->t);
+		iter->tab = tab;
+		iter->idx = -1;
 	}
-	iter->l = NULL;
 	return NULL;
 }
 
@@ -1300,17 +1539,21 @@ static inline bool ip_vs_conn_ops_mode(struct ip_vs_conn *cp)
 /* Called from keventd and must protect itself from softirqs */
 void ip_vs_random_dropentry(struct netns_ipvs *ipvs)
 {
-	int idx;
+	struct ip_vs_conn_htable *tab;
 	struct ip_vs_conn *cp;
+	unsigned int hash;
+	int idx;
 
 	rcu_read_lock();
 	/*
 	 * Randomly scan 1/32 of the whole table every second
 	 */
-	for (idx = 0; idx < (ip_vs_conn_tab_size>>5); idx++) {
-		unsigned int hash = prandom_u32() & ip_vs_conn_tab_mask;
+	for (idx = 0; idx < (READ_ONCE(ip_vs_conn_tab_size)>>5); idx++) {
+		/* entries being moved by a resize may be missed, no matter */
+		tab = rcu_dereference(ip_vs_conn_tab);
+		hash = prandom_u32() & tab->mask;
 
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[hash], c_list) {
+		hlist_for_each_entry_rcu(cp, &tab->buckets[hash], c_list) {
 			if (cp->ipvs != ipvs)
 				continue;
 			if (atomic_read(&cp->n_control))
@@ -1370,27 +1613,37 @@ void ip_vs_random_dropentry(struct netns_ipvs *ipvs)
  */
 static void ip_vs_conn_flush(struct netns_ipvs *ipvs)
 {
-	int idx;
+	struct ip_vs_conn_htable *tab;
 	struct ip_vs_conn *cp, *cp_c;
+	unsigned int idx;
+	int t;
 
 flush_again:
 	rcu_read_lock();
-	for (idx = 0; idx < ip_vs_conn_tab_size; idx++) {
-
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[idx], c_list) {
-			if (cp->ipvs != ipvs)
-				continue;
-			if (atomic_read(&cp->n_control))
-				continue;
-			cp_c = cp->control;
-			IP_VS_DBG(4, "del connection\n");
-			ip_vs_conn_del(cp);
-			if (cp_c && !atomic_read(&cp_c->n_control)) {
-				IP_VS_DBG(4, "del controlling connection\n");
-				ip_vs_conn_del(cp_c);
+	for (t = 0; (tab = ip_vs_conn_tab_get(t)); t++) {
+		for (idx = 0; idx <= tab->mask; idx++) {
+			hlist_for_each_entry_rcu(cp, &tab->buckets[idx],
+						 c_list) {
+				if (cp->ipvs != ipvs)
+					continue;
+				if (atomic_read(&cp->n_control))
+					continue;
+				cp_c = cp->control;
+				IP_VS_DBG(4, "del connection\n");
+				ip_vs_conn_del(cp);
+				if (cp_c && !atomic_read(&cp_c->n_control)) {
+					IP_VS_DBG(4, "del controlling "
+						  "connection\n");
+					ip_vs_conn_del(cp_c);
+				}
+			}
+			cond_resched_rcu();
+			if (tab != ip_vs_conn_tab_get(t)) {
+				/* resized, start over on the new table */
+				rcu_read_unlock();
+				goto flush_again;
 			}
 		}
-		cond_resched_rcu();
 	}
 	rcu_read_unlock();
 
@@ -1405,37 +1658,49 @@ static void ip_vs_conn_flush(struct netns_ipvs *ipvs)
 #ifdef CONFIG_SYSCTL
 void ip_vs_expire_nodest_conn_flush(struct netns_ipvs *ipvs)
 {
-	int idx;
+	struct ip_vs_conn_htable *tab;
 	struct ip_vs_conn *cp, *cp_c;
 	struct ip_vs_dest *dest;
+	unsigned int idx;
+	int t;
 
 	rcu_read_lock();
-	for (idx = 0; idx < ip_vs_conn_tab_size; idx++) {
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[idx], c_list) {
-			if (cp->ipvs != ipvs)
-				continue;
+again:
+	for (t = 0; (tab = ip_vs_conn_tab_get(t)); t++) {
+		for (idx = 0; idx <= tab->mask; idx++) {
+			hlist_for_each_entry_rcu(cp, &tab->buckets[idx],
+						 c_list) {
+				if (cp->ipvs != ipvs)
+					continue;
 
-			dest = cp->dest;
-			if (!dest || (dest->flags & IP_VS_DEST_F_AVAILABLE))
-				continue;
+				dest = cp->dest;
+				if (!dest ||
+				    (dest->flags & IP_VS_DEST_F_AVAILABLE))
+					continue;
 
-			if (atomic_read(&cp->n_control))
-				continue;
+				if (atomic_read(&cp->n_control))
+					continue;
 
-			cp_c = cp->control;
-			IP_VS_DBG(4, "del connection\n");
-			ip_vs_conn_del(cp);
-			if (cp_c && !atomic_read(&cp_c->n_control)) {
-				IP_VS_DBG(4, "del controlling connection\n");
-				ip_vs_conn_del(cp_c);
+				cp_c = cp->control;
+				IP_VS_DBG(4, "del connection\n");
+				ip_vs_conn_del(cp);
+				if (cp_c && !atomic_read(&cp_c->n_control)) {
+					IP_VS_DBG(4, "del controlling "
+						  "connection\n");
+					ip_vs_conn_del(cp_c);
+				}
 			}
-		}
-		cond_resched_rcu();
+			cond_resched_rcu();
 
-		/* netns clean up started, abort delayed work */
-		if (!ipvs->enable)
-			break;
+			/* netns clean up started, abort delayed work */
+			if (!ipvs->enable)
+				goto out;
+			/* resized, start over on the new table */
+			if (tab != ip_vs_conn_tab_get(t))
+				goto again;
+		}
 	}
+out:
 	rcu_read_unlock();
 }
 #endif
@@ -1465,6 +1730,7 @@ void __net_exit ip_vs_conn_net_cleanup(struct netns_ipvs *ipvs)
 
 int __init ip_vs_conn_init(void)
 {
+	struct ip_vs_conn_htable *tab;
 	int idx;
 
 	/* Compute size and mask */
@@ -1473,24 +1739,24 @@ int __init ip_vs_conn_init(void)
 		ip_vs_conn_tab_bits = CONFIG_IP_VS_TAB_BITS;
 	}
 	ip_vs_conn_tab_size = 1 << ip_vs_conn_tab_bits;
-	ip_vs_conn_tab_mask = ip_vs_conn_tab_size - 1;
 
 	/*
 	 * Allocate the connection hash table and initialize its list heads
 	 */
-	ip_vs_conn_tab = vmalloc(array_size(ip_vs_conn_tab_size,
-					    sizeof(*ip_vs_conn_tab)));
-	if (!ip_vs_conn_tab)
+	tab = ip_vs_conn_tab_alloc(ip_vs_conn_tab_size);
+	if (!tab)
 		return -ENOMEM;
 
+	if (percpu_counter_init(&ip_vs_conn_hashed, 0, GFP_KERNEL))
+		goto out_tab;
+
 	/* Allocate ip_vs_conn slab cache */
 	ip_vs_conn_cachep = kmem_cache_create("ip_vs_conn",
 					      sizeof(struct ip_vs_conn), 0,
 					      SLAB_HWCACHE_ALIGN, NULL);
-	if (!ip_vs_conn_cachep) {
-		vfree(ip_vs_conn_tab);
-		return -ENOMEM;
-	}
+	if (!ip_vs_conn_cachep)
+		goto out_counter;
+	RCU_INIT_POINTER(ip_vs_conn_tab, tab);
 
 	pr_info("Connection hash table configured "
 		"(size=%d, memory=%ldKbytes)\n",
@@ -1499,9 +1765,6 @@ int __init ip_vs_conn_init(void)
 	IP_VS_DBG(0, "Each connection entry needs %zd bytes at least\n",
 		  sizeof(struct ip_vs_conn));
 
-	for (idx = 0; idx < ip_vs_conn_tab_size; idx++)
-		INIT_HLIST_HEAD(&ip_vs_conn_tab[idx]);
-
 	for (idx = 0; idx < CT_LOCKARRAY_SIZE; idx++)  {
 		spin_lock_init(&__ip_vs_conntbl_lock_array[idx].l);
 	}
@@ -1510,13 +1773,21 @@ int __init ip_vs_conn_init(void)
 	get_random_bytes(&ip_vs_conn_rnd, sizeof(ip_vs_conn_rnd));
 
 	return 0;
+
+out_counter:
+	percpu_counter_destroy(&ip_vs_conn_hashed);
+out_tab:
+	kvfree(tab);
+	return -ENOMEM;
 }
 
 void ip_vs_conn_cleanup(void)
 {
+	cancel_work_sync(&ip_vs_conn_resize_work);
 	/* Wait all ip_vs_conn_rcu_free() callbacks to complete */
 	rcu_barrier();
 	/* Release the empty cache */
 	kmem_cache_destroy(ip_vs_conn_cachep);
-	vfree(ip_vs_conn_tab);
+	percpu_counter_destroy(&ip_vs_conn_hashed);
+	kvfree(rcu_dereference_protected(ip_vs_conn_tab, 1));
 }
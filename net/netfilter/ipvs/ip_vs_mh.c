@@ -21,6 +21,7 @@
 #define pr_fmt(fmt) KMSG_COMPONENT ": " fmt
 
 #include <linux/ip.h>
+#include <linux/mm.h>
 #include <linux/slab.h>
 #include <linux/module.h>
 #include <linux/kernel.h>
@@ -48,20 +49,30 @@ struct ip_vs_mh_dest_setup {
 
 /* Available prime numbers for MH table */
 static int primes[] = {251, 509, 1021, 2039, 4093,
-		       8191, 16381, 32749, 65521, 131071};
+		       8191, 16381, 32749, 65521, 131071,
+		       262139, 524287, 1048573};
 
 /* For IPVS MH entry hash table */
 #ifndef CONFIG_IP_VS_MH_TAB_INDEX
 #define CONFIG_IP_VS_MH_TAB_INDEX	12
 #endif
-#define IP_VS_MH_TAB_BITS		(CONFIG_IP_VS_MH_TAB_INDEX / 2)
-#define IP_VS_MH_TAB_INDEX		(CONFIG_IP_VS_MH_TAB_INDEX - 8)
-#define IP_VS_MH_TAB_SIZE               primes[IP_VS_MH_TAB_INDEX]
+#define IP_VS_MH_TAB_INDEX_MIN		8
+#define IP_VS_MH_TAB_INDEX_MAX		(IP_VS_MH_TAB_INDEX_MIN + \
+					 ARRAY_SIZE(primes) - 1)
+
+/* Table size of services created from now on */
+static int ip_vs_mh_tab_index = CONFIG_IP_VS_MH_TAB_INDEX;
+module_param_named(tab_index, ip_vs_mh_tab_index, int, 0644);
+MODULE_PARM_DESC(tab_index, "Set the lookup table size of new services");
 
 struct ip_vs_mh_state {
 	struct rcu_head			rcu_head;
 	struct ip_vs_mh_lookup		*lookup;
+	unsigned int			tab_size;
+	int				tab_bits;	/* weight bits */
+	/* dests the table was last populated for */
 	struct ip_vs_mh_dest_setup	*dest_setup;
+	int				num_setup;
 	hsiphash_key_t			hash1, hash2;
 	int				gcd;
 	int				rshift;
@@ -109,7 +120,7 @@ static void ip_vs_mh_reset(struct ip_vs_mh_state *s)
 	struct ip_vs_dest *dest;
 
 	l = &s->lookup[0];
-	for (i = 0; i < IP_VS_MH_TAB_SIZE; i++) {
+	for (i = 0; i < s->tab_size; i++) {
 		dest = rcu_dereference_protected(l->dest, 1);
 		if (dest) {
 			ip_vs_dest_put(dest);
@@ -120,10 +131,10 @@ static void ip_vs_mh_reset(struct ip_vs_mh_state *s)
 }
 
 static int ip_vs_mh_permutate(struct ip_vs_mh_state *s,
-			      struct ip_vs_service *svc)
+			      struct ip_vs_service *svc,
+			      struct ip_vs_mh_dest_setup *ds)
 {
 	struct list_head *p;
-	struct ip_vs_mh_dest_setup *ds;
 	struct ip_vs_dest *dest;
 	int lw;
 
@@ -136,16 +147,15 @@ static int ip_vs_mh_permutate(struct ip_vs_mh_state *s,
 
 	/* Set dest_setup for the dests permutation */
 	p = &svc->destinations;
-	ds = &s->dest_setup[0];
 	while ((p = p->next) != &svc->destinations) {
 		dest = list_entry(p, struct ip_vs_dest, n_list);
 
 		ds->offset = ip_vs_mh_hashkey(svc->af, &dest->addr,
 					      dest->port, &s->hash1, 0) %
-					      IP_VS_MH_TAB_SIZE;
+					      s->tab_size;
 		ds->skip = ip_vs_mh_hashkey(svc->af, &dest->addr,
 					    dest->port, &s->hash2, 0) %
-					    (IP_VS_MH_TAB_SIZE - 1) + 1;
+					    (s->tab_size - 1) + 1;
 		ds->perm = ds->offset;
 
 		lw = atomic_read(&dest->last_weight);
@@ -156,6 +166,20 @@ static int ip_vs_mh_permutate(struct ip_vs_mh_state *s,
 	return 0;
 }
 
+/* The table only depends on the dests' preferences and turns, in order */
+static bool ip_vs_mh_setup_equal(const struct ip_vs_mh_dest_setup *a,
+				 const struct ip_vs_mh_dest_setup *b, int num)
+{
+	int i;
+
+	for (i = 0; i < num; i++) {
+		if (a[i].offset != b[i].offset || a[i].skip != b[i].skip ||
+		    a[i].turns != b[i].turns)
+			return false;
+	}
+	return true;
+}
+
 static int ip_vs_mh_populate(struct ip_vs_mh_state *s,
 			     struct ip_vs_service *svc)
 {
@@ -174,15 +198,15 @@ static int ip_vs_mh_populate(struct ip_vs_mh_state *s,
 		return 0;
 	}
 
-	table = kcalloc(BITS_TO_LONGS(IP_VS_MH_TAB_SIZE),
-			sizeof(unsigned long), GFP_KERNEL);
+	table = kvcalloc(BITS_TO_LONGS(s->tab_size), sizeof(unsigned long),
+			 GFP_KERNEL);
 	if (!table)
 		return -ENOMEM;
 
 	p = &svc->destinations;
 	n = 0;
 	dt_count = 0;
-	while (n < IP_VS_MH_TAB_SIZE) {
+	while (n < s->tab_size) {
 		if (p == &svc->destinations)
 			p = p->next;
 
@@ -197,15 +221,19 @@ static int ip_vs_mh_populate(struct ip_vs_mh_state *s,
 
 			c = ds->perm;
 			while (test_bit(c, table)) {
-				/* Add skip, mod IP_VS_MH_TAB_SIZE */
+				/* Add skip, mod tab_size */
 				ds->perm += ds->skip;
-				if (ds->perm >= IP_VS_MH_TAB_SIZE)
-					ds->perm -= IP_VS_MH_TAB_SIZE;
+				if (ds->perm >= s->tab_size)
+					ds->perm -= s->tab_size;
 				c = ds->perm;
 			}
 
 			__set_bit(c, table);
 
+			/* Only the slots that change dest are written, so
+			 * racing lookups keep mapping to the same dests for
+			 * the rest of the table.
+			 */
 			dest = rcu_dereference_protected(s->lookup[c].dest, 1);
 			new_dest = list_entry(p, struct ip_vs_dest, n_list);
 			if (dest != new_dest) {
@@ -215,7 +243,7 @@ static int ip_vs_mh_populate(struct ip_vs_mh_state *s,
 				RCU_INIT_POINTER(s->lookup[c].dest, new_dest);
 			}
 
-			if (++n == IP_VS_MH_TAB_SIZE)
+			if (++n == s->tab_size)
 				goto out;
 
 			if (++dt_count >= ds->turns) {
@@ -227,7 +255,7 @@ static int ip_vs_mh_populate(struct ip_vs_mh_state *s,
 	}
 
 out:
-	kfree(table);
+	kvfree(table);
 	return 0;
 }
 
@@ -237,7 +265,7 @@ ip_vs_mh_get(struct ip_vs_service *svc, struct ip_vs_mh_state *s,
 	     const union nf_inet_addr *addr, __be16 port)
 {
 	unsigned int hash = ip_vs_mh_hashkey(svc->af, addr, port, &s->hash1, 0)
-					     % IP_VS_MH_TAB_SIZE;
+					     % s->tab_size;
 	struct ip_vs_dest *dest = rcu_dereference(s->lookup[hash].dest);
 
 	return (!dest || is_unavailable(dest)) ? NULL : dest;
@@ -254,7 +282,7 @@ ip_vs_mh_get_fallback(struct ip_vs_service *svc, struct ip_vs_mh_state *s,
 
 	/* First try the dest it's supposed to go to */
 	ihash = ip_vs_mh_hashkey(svc->af, addr, port,
-				 &s->hash1, 0) % IP_VS_MH_TAB_SIZE;
+				 &s->hash1, 0) % s->tab_size;
 	dest = rcu_dereference(s->lookup[ihash].dest);
 	if (!dest)
 		return NULL;
@@ -267,10 +295,10 @@ ip_vs_mh_get_fallback(struct ip_vs_service *svc, struct ip_vs_mh_state *s,
 	/* If the original dest is unavailable, loop around the table
 	 * starting from ihash to find a new dest
 	 */
-	for (offset = 0; offset < IP_VS_MH_TAB_SIZE; offset++) {
-		roffset = (offset + ihash) % IP_VS_MH_TAB_SIZE;
+	for (offset = 0; offset < s->tab_size; offset++) {
+		roffset = (offset + ihash) % s->tab_size;
 		hash = ip_vs_mh_hashkey(svc->af, addr, port, &s->hash1,
-					roffset) % IP_VS_MH_TAB_SIZE;
+					roffset) % s->tab_size;
 		dest = rcu_dereference(s->lookup[hash].dest);
 		if (!dest)
 			break;
@@ -285,39 +313,52 @@ ip_vs_mh_get_fallback(struct ip_vs_service *svc, struct ip_vs_mh_state *s,
 	return NULL;
 }
 
-/* Assign all the hash buckets of the specified table with the service. */
+/* Assign all the hash buckets of the specified table with the service.
+ * Nothing is done if the dests the table depends on did not change, e.g.
+ * when only the thresholds of a dest or the scale of all weights did.
+ */
 static int ip_vs_mh_reassign(struct ip_vs_mh_state *s,
 			     struct ip_vs_service *svc)
 {
+	struct ip_vs_mh_dest_setup *ds = NULL;
+	int num = svc->num_dests;
 	int ret;
 
-	if (svc->num_dests > IP_VS_MH_TAB_SIZE)
+	if (num > s->tab_size)
 		return -EINVAL;
 
-	if (svc->num_dests >= 1) {
-		s->dest_setup = kcalloc(svc->num_dests,
-					sizeof(struct ip_vs_mh_dest_setup),
-					GFP_KERNEL);
-		if (!s->dest_setup)
+	if (num >= 1) {
+		ds = kvcalloc(num, sizeof(struct ip_vs_mh_dest_setup),
+			      GFP_KERNEL);
+		if (!ds)
 			return -ENOMEM;
 	}
 
-	ip_vs_mh_permutate(s, svc);
+	ip_vs_mh_permutate(s, svc, ds);
+
+	if (s->gcd >= 1 && s->dest_setup && num == s->num_setup &&
+	    ip_vs_mh_setup_equal(ds, s->dest_setup, num)) {
+		kvfree(ds);
+		return 0;
+	}
+
+	kvfree(s->dest_setup);
+	s->dest_setup = ds;
+	s->num_setup = num;
 
 	ret = ip_vs_mh_populate(s, svc);
-	if (ret < 0)
-		goto out;
+	if (ret < 0) {
+		/* don't skip the next attempt */
+		kvfree(s->dest_setup);
+		s->dest_setup = NULL;
+		return ret;
+	}
 
 	IP_VS_DBG_BUF(6, "MH: reassign lookup table of %s:%u\n",
 		      IP_VS_DBG_ADDR(svc->af, &svc->addr),
 		      ntohs(svc->port));
 
-out:
-	if (svc->num_dests >= 1) {
-		kfree(s->dest_setup);
-		s->dest_setup = NULL;
-	}
-	return ret;
+	return 0;
 }
 
 static int ip_vs_mh_gcd_weight(struct ip_vs_service *svc)
@@ -341,7 +382,8 @@ static int ip_vs_mh_gcd_weight(struct ip_vs_service *svc)
 /* To avoid assigning huge weight for the MH table,
  * calculate shift value with gcd.
  */
-static int ip_vs_mh_shift_weight(struct ip_vs_service *svc, int gcd)
+static int ip_vs_mh_shift_weight(struct ip_vs_mh_state *s,
+				 struct ip_vs_service *svc, int gcd)
 {
 	struct ip_vs_dest *dest;
 	int new_weight, weight = 0;
@@ -366,7 +408,7 @@ static int ip_vs_mh_shift_weight(struct ip_vs_service *svc, int gcd)
 	mw = weight / gcd;
 
 	/* shift = occupied bits of weight/gcd - MH highest bits */
-	shift = fls(mw) - IP_VS_MH_TAB_BITS;
+	shift = fls(mw) - s->tab_bits;
 	return (shift >= 0) ? shift : 0;
 }
 
@@ -375,22 +417,28 @@ static void ip_vs_mh_state_free(struct rcu_head *head)
 	struct ip_vs_mh_state *s;
 
 	s = container_of(head, struct ip_vs_mh_state, rcu_head);
-	kfree(s->lookup);
+	kvfree(s->dest_setup);
+	kvfree(s->lookup);
 	kfree(s);
 }
 
 static int ip_vs_mh_init_svc(struct ip_vs_service *svc)
 {
-	int ret;
+	int ret, index = READ_ONCE(ip_vs_mh_tab_index);
 	struct ip_vs_mh_state *s;
 
+	if (index < IP_VS_MH_TAB_INDEX_MIN || index > IP_VS_MH_TAB_INDEX_MAX)
+		index = CONFIG_IP_VS_MH_TAB_INDEX;
+
 	/* Allocate the MH table for this service */
 	s = kzalloc(sizeof(*s), GFP_KERNEL);
 	if (!s)
 		return -ENOMEM;
 
-	s->lookup = kcalloc(IP_VS_MH_TAB_SIZE, sizeof(struct ip_vs_mh_lookup),
-			    GFP_KERNEL);
+	s->tab_size = primes[index - IP_VS_MH_TAB_INDEX_MIN];
+	s->tab_bits = index / 2;
+	s->lookup = kvcalloc(s->tab_size, sizeof(struct ip_vs_mh_lookup),
+			     GFP_KERNEL);
 	if (!s->lookup) {
 		kfree(s);
 		return -ENOMEM;
@@ -398,11 +446,11 @@ static int ip_vs_mh_init_svc(struct ip_vs_service *svc)
 
 	generate_hash_secret(&s->hash1, &s->hash2);
 	s->gcd = ip_vs_mh_gcd_weight(svc);
-	s->rshift = ip_vs_mh_shift_weight(svc, s->gcd);
+	s->rshift = ip_vs_mh_shift_weight(s, svc, s->gcd);
 
 	IP_VS_DBG(6,
 		  "MH lookup table (memory=%zdbytes) allocated for current service\n",
-		  sizeof(struct ip_vs_mh_lookup) * IP_VS_MH_TAB_SIZE);
+		  sizeof(struct ip_vs_mh_lookup) * s->tab_size);
 
 	/* Assign the lookup table with current dests */
 	ret = ip_vs_mh_reassign(s, svc);
@@ -424,9 +472,9 @@ static void ip_vs_mh_done_svc(struct ip_vs_service *svc)
 	/* Got to clean up lookup entry here */
 	ip_vs_mh_reset(s);
 
-	call_rcu(&s->rcu_head, ip_vs_mh_state_free);
 	IP_VS_DBG(6, "MH lookup table (memory=%zdbytes) released\n",
-		  sizeof(struct ip_vs_mh_lookup) * IP_VS_MH_TAB_SIZE);
+		  sizeof(struct ip_vs_mh_lookup) * s->tab_size);
+	call_rcu(&s->rcu_head, ip_vs_mh_state_free);
 }
 
 static int ip_vs_mh_dest_changed(struct ip_vs_service *svc,
@@ -435,7 +483,7 @@ static int ip_vs_mh_dest_changed(struct ip_vs_service *svc,
 	struct ip_vs_mh_state *s = svc->sched_data;
 
 	s->gcd = ip_vs_mh_gcd_weight(svc);
-	s->rshift = ip_vs_mh_shift_weight(svc, s->gcd);
+	s->rshift = ip_vs_mh_shift_weight(s, svc, s->gcd);
 
 	/* Assign the lookup table with the updated service */
 	return ip_vs_mh_reassign(s, svc);
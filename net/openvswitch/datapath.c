@@ -135,6 +135,24 @@ static void ovs_dp_masks_rebalance(struct work_struct *work);
 
 static int ovs_dp_set_upcall_portids(struct datapath *, const struct nlattr *);
 
+/* With OVS_DP_F_UPCALL_BATCH, misses seen in softirq context are appended
+ * to a per-CPU batch for one datapath and handler socket instead of being
+ * sent one skb at a time.  The batch is sent when the next upcall goes
+ * elsewhere or does not fit, and otherwise from a tasklet, which runs once
+ * the softirq work that raised it is done.
+ */
+#define OVS_UPCALL_BATCH_SIZE	SKB_WITH_OVERHEAD(32768)
+
+struct ovs_upcall_batch {
+	struct sk_buff *skb;
+	struct datapath *dp;
+	u32 portid;
+	unsigned int count;
+	struct tasklet_struct tasklet;
+};
+
+static DEFINE_PER_CPU(struct ovs_upcall_batch, ovs_upcall_batch);
+
 /* Must be called with rcu_read_lock or ovs_mutex. */
 const char *ovs_dp_name(const struct datapath *dp)
 {
@@ -359,6 +377,107 @@ static int queue_gso_packets(struct datapath *dp, struct sk_buff *skb,
 	return err;
 }
 
+static void ovs_upcall_batch_flush(struct ovs_upcall_batch *b)
+{
+	struct sk_buff *skb = b->skb;
+	struct datapath *dp = b->dp;
+
+	if (!skb)
+		return;
+
+	b->skb = NULL;
+	if (genlmsg_unicast(ovs_dp_get_net(dp), skb, b->portid)) {
+		struct dp_stats_percpu *stats = this_cpu_ptr(dp->stats_percpu);
+
+		u64_stats_update_begin(&stats->syncp);
+		stats->n_lost += b->count;
+		u64_stats_update_end(&stats->syncp);
+	}
+	WRITE_ONCE(b->dp, NULL);
+}
+
+static void ovs_upcall_batch_tasklet(struct tasklet_struct *t)
+{
+	struct ovs_upcall_batch *b = from_tasklet(b, t, tasklet);
+
+	ovs_upcall_batch_flush(b);
+}
+
+static bool ovs_upcall_batch_wanted(const struct datapath *dp,
+				    const struct dp_upcall_info *upcall_info)
+{
+	return dp->user_features & OVS_DP_F_UPCALL_BATCH &&
+	       upcall_info->cmd == OVS_PACKET_CMD_MISS &&
+	       in_serving_softirq();
+}
+
+/* Returns the batch to append an upcall of 'len' payload bytes to, or NULL
+ * if it has to be sent on its own.
+ */
+static struct ovs_upcall_batch *
+ovs_upcall_batch_get(struct datapath *dp,
+		     const struct dp_upcall_info *upcall_info, size_t len)
+{
+	struct ovs_upcall_batch *b = this_cpu_ptr(&ovs_upcall_batch);
+
+	len = nlmsg_total_size(GENL_HDRLEN + len);
+	if (len > OVS_UPCALL_BATCH_SIZE)
+		return NULL;
+
+	if (b->skb && (b->dp != dp || b->portid != upcall_info->portid ||
+		       skb_tailroom(b->skb) < len))
+		ovs_upcall_batch_flush(b);
+
+	if (!b->skb) {
+		b->skb = alloc_skb(OVS_UPCALL_BATCH_SIZE,
+				   GFP_ATOMIC | __GFP_NOWARN);
+		if (!b->skb)
+			return NULL;
+
+		WRITE_ONCE(b->dp, dp);
+		b->portid = upcall_info->portid;
+		b->count = 0;
+		tasklet_schedule(&b->tasklet);
+	}
+
+	return b;
+}
+
+/* Must be called after 'dp' is unreachable from the packet path. */
+static void ovs_upcall_batch_sync(struct datapath *dp)
+{
+	int cpu;
+
+	if (!dp->upcall_batched)
+		return;
+
+	synchronize_net();
+	for_each_possible_cpu(cpu) {
+		struct ovs_upcall_batch *b = per_cpu_ptr(&ovs_upcall_batch,
+							 cpu);
+
+		while (READ_ONCE(b->dp) == dp)
+			msleep(1);
+	}
+}
+
+static void __init ovs_upcall_batch_init(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		tasklet_setup(&per_cpu_ptr(&ovs_upcall_batch, cpu)->tasklet,
+			      ovs_upcall_batch_tasklet);
+}
+
+static void ovs_upcall_batch_exit(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		tasklet_kill(&per_cpu_ptr(&ovs_upcall_batch, cpu)->tasklet);
+}
+
 static size_t upcall_msg_size(const struct dp_upcall_info *upcall_info,
 			      unsigned int hdrlen, int actions_attrlen)
 {
@@ -405,7 +524,10 @@ static int queue_userspace_packet(struct datapath *dp, struct sk_buff *skb,
 	struct ovs_header *upcall;
 	struct sk_buff *nskb = NULL;
 	struct sk_buff *user_skb = NULL; /* to be queued to userspace */
+	struct ovs_upcall_batch *batch = NULL;
+	struct nlmsghdr *nlh = NULL;
 	struct nlattr *nla;
+	bool batched;
 	size_t len;
 	unsigned int hlen;
 	int err, dp_ifindex;
@@ -440,20 +562,28 @@ static int queue_userspace_packet(struct datapath *dp, struct sk_buff *skb,
 	/* Older versions of OVS user space enforce alignment of the last
 	 * Netlink attribute to NLA_ALIGNTO which would require extensive
 	 * padding logic. Only perform zerocopy if padding is not required.
+	 * Batched upcalls are copied, as the next one goes after this one.
 	 */
-	if (dp->user_features & OVS_DP_F_UNALIGNED)
+	batched = ovs_upcall_batch_wanted(dp, upcall_info);
+	if (dp->user_features & OVS_DP_F_UNALIGNED && !batched)
 		hlen = skb_zerocopy_headlen(skb);
 	else
 		hlen = skb->len;
 
 	len = upcall_msg_size(upcall_info, hlen - cutlen,
 			      OVS_CB(skb)->acts_origlen);
-	user_skb = genlmsg_new(len, GFP_ATOMIC);
+	if (batched)
+		batch = ovs_upcall_batch_get(dp, upcall_info, len);
+	if (batch)
+		user_skb = batch->skb;
+	else
+		user_skb = genlmsg_new(len, GFP_ATOMIC);
 	if (!user_skb) {
 		err = -ENOMEM;
 		goto out;
 	}
 
+	nlh = (struct nlmsghdr *)skb_tail_pointer(user_skb);
 	upcall = genlmsg_put(user_skb, 0, 0, &dp_packet_genl_family,
 			     0, upcall_info->cmd);
 	if (!upcall) {
@@ -541,15 +671,31 @@ static int queue_userspace_packet(struct datapath *dp, struct sk_buff *skb,
 		goto out;
 
 	/* Pad OVS_PACKET_ATTR_PACKET if linear copy was performed */
-	pad_packet(dp, user_skb);
+	if (batch) {
+		skb_put_zero(user_skb, NLMSG_ALIGN(user_skb->len) -
+				       user_skb->len);
+	} else {
+		pad_packet(dp, user_skb);
+	}
+
+	nlh->nlmsg_len = user_skb->len - ((u8 *)nlh - user_skb->data);
 
-	((struct nlmsghdr *) user_skb->data)->nlmsg_len = user_skb->len;
+	if (batch) {
+		batch->count++;
+		user_skb = NULL;
+		goto out;
+	}
 
 	err = genlmsg_unicast(ovs_dp_get_net(dp), user_skb, upcall_info->portid);
 	user_skb = NULL;
 out:
 	if (err)
 		skb_tx_error(skb);
+	if (batch) {
+		if (err)
+			nlmsg_cancel(batch->skb, nlh);
+		user_skb = NULL;
+	}
 	kfree_skb(user_skb);
 	kfree_skb(nskb);
 	return err;
@@ -1666,7 +1812,8 @@ static int ovs_dp_change(struct datapath *dp, struct nlattr *a[])
 		if (user_features & ~(OVS_DP_F_VPORT_PIDS |
 				      OVS_DP_F_UNALIGNED |
 				      OVS_DP_F_TC_RECIRC_SHARING |
-				      OVS_DP_F_DISPATCH_UPCALL_PER_CPU))
+				      OVS_DP_F_DISPATCH_UPCALL_PER_CPU |
+				      OVS_DP_F_UPCALL_BATCH))
 			return -EOPNOTSUPP;
 
 #if !IS_ENABLED(CONFIG_NET_TC_SKB_EXT)
@@ -1686,6 +1833,8 @@ static int ovs_dp_change(struct datapath *dp, struct nlattr *a[])
 	}
 
 	dp->user_features = user_features;
+	if (user_features & OVS_DP_F_UPCALL_BATCH)
+		dp->upcall_batched = true;
 
 	if (dp->user_features & OVS_DP_F_DISPATCH_UPCALL_PER_CPU &&
 	    a[OVS_DP_ATTR_PER_CPU_PIDS]) {
@@ -1862,6 +2011,8 @@ static void __dp_destroy(struct datapath *dp)
 	table_instance_flow_flush(table, ovsl_dereference(table->ti),
 				  ovsl_dereference(table->ufid_ti));
 
+	ovs_upcall_batch_sync(dp);
+
 	/* RCU destroy the ports, meters and flow tables. */
 	call_rcu(&dp->rcu, destroy_dp_rcu);
 }
@@ -2457,9 +2608,17 @@ static void ovs_dp_masks_rebalance(struct work_struct *work)
 
 	ovs_lock();
 
-	list_for_each_entry(dp, &ovs_net->dps, list_node)
+	list_for_each_entry(dp, &ovs_net->dps, list_node) {
+		struct ovs_dp_megaflow_stats mega_stats;
+		struct ovs_dp_stats stats;
+
 		ovs_flow_masks_rebalance(&dp->table);
 
+		get_dp_stats(dp, &stats, &mega_stats);
+		ovs_flow_tbl_masks_cache_adapt(&dp->table, stats.n_hit,
+					       mega_stats.n_cache_hit);
+	}
+
 	ovs_unlock();
 
 	schedule_delayed_work(&ovs_net->masks_rebalance,
@@ -2643,6 +2802,8 @@ static int __init dp_init(void)
 
 	pr_info("Open vSwitch switching datapath\n");
 
+	ovs_upcall_batch_init();
+
 	err = action_fifos_init();
 	if (err)
 		goto error;
@@ -2706,6 +2867,7 @@ static void dp_cleanup(void)
 	ovs_flow_exit();
 	ovs_internal_dev_rtnl_link_unregister();
 	action_fifos_exit();
+	ovs_upcall_batch_exit();
 }
 
 module_init(dp_init);
@@ -105,6 +105,9 @@ struct datapath {
 	struct dp_meter_table meter_tbl;
 
 	struct dp_nlsk_pids __rcu *upcall_portids;
+
+	/* Set once OVS_DP_F_UPCALL_BATCH has been enabled. */
+	bool upcall_batched;
 };
 
 /**
@@ -166,11 +166,25 @@ struct sw_flow_key_range {
 	unsigned short int end;
 };
 
+/* A one-hash bloom filter over the masked hashes of the flows using a
+ * mask, so that lookups can skip masks that cannot match without touching
+ * the hash table.  'cnt' is only used under ovs_mutex; a saturated counter
+ * is never decremented again, which leaves its bit set.
+ */
+#define MASK_FILTER_BITS	1024
+
+struct sw_flow_mask_filter {
+	DECLARE_BITMAP(bits, MASK_FILTER_BITS);
+	u8 cnt[MASK_FILTER_BITS];
+};
+
 struct sw_flow_mask {
 	int ref_count;
 	struct rcu_head rcu;
 	struct sw_flow_key_range range;
 	struct sw_flow_key key;
+	/* Only present on masks owned by a flow table. */
+	struct sw_flow_mask_filter filter[];
 };
 
 struct sw_flow_match {
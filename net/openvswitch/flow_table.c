@@ -39,6 +39,13 @@
 #define REHASH_INTERVAL		(10 * 60 * HZ)
 
 #define MC_DEFAULT_HASH_ENTRIES	256
+#define MC_MAX_HASH_ENTRIES	(PCPU_MIN_UNIT_SIZE / \
+				 sizeof(struct mask_cache_entry))
+/* Grow an automatically sized mask cache while fewer than
+ * MC_ADAPT_HIT_RATIO percent of the hits found their mask through it.
+ */
+#define MC_ADAPT_HIT_RATIO	50
+#define MC_ADAPT_MIN_HITS	10000
 #define MC_HASH_SHIFT		8
 #define MC_HASH_SEGS		((sizeof(uint32_t) * 8) / MC_HASH_SHIFT)
 
@@ -388,7 +395,7 @@ static struct mask_cache *tbl_mask_cache_alloc(u32 size)
 	new->mask_cache = cache;
 	return new;
 }
-int ovs_flow_tbl_masks_cache_resize(struct flow_table *table, u32 size)
+static int tbl_mask_cache_resize(struct flow_table *table, u32 size)
 {
 	struct mask_cache *mc = rcu_dereference_ovsl(table->mask_cache);
 	struct mask_cache *new;
@@ -410,6 +417,45 @@ int ovs_flow_tbl_masks_cache_resize(struct flow_table *table, u32 size)
 	return 0;
 }
 
+/* An explicit size from userspace turns off automatic sizing for good. */
+int ovs_flow_tbl_masks_cache_resize(struct flow_table *table, u32 size)
+{
+	int err;
+
+	err = tbl_mask_cache_resize(table, size);
+	if (!err)
+		table->mc_fixed = true;
+
+	return err;
+}
+
+/* Must be called with OVS mutex held.  'n_hit' and 'n_cache_hit' are the
+ * datapath's running totals; the cache is doubled whenever too few of the
+ * hits since the previous call found their mask through it, which happens
+ * once there are more concurrent flows per CPU than it has entries.
+ */
+void ovs_flow_tbl_masks_cache_adapt(struct flow_table *table, u64 n_hit,
+				    u64 n_cache_hit)
+{
+	struct mask_cache *mc = rcu_dereference_ovsl(table->mask_cache);
+	u64 hits = n_hit - table->mc_last_hit;
+	u64 cache_hits = n_cache_hit - table->mc_last_cache_hit;
+
+	table->mc_last_hit = n_hit;
+	table->mc_last_cache_hit = n_cache_hit;
+
+	if (table->mc_fixed || !mc->cache_size ||
+	    mc->cache_size >= MC_MAX_HASH_ENTRIES ||
+	    READ_ONCE(rcu_dereference_ovsl(table->mask_array)->count) < 2)
+		return;
+
+	if (hits < MC_ADAPT_MIN_HITS ||
+	    cache_hits * 100 >= hits * MC_ADAPT_HIT_RATIO)
+		return;
+
+	tbl_mask_cache_resize(table, mc->cache_size * 2);
+}
+
 int ovs_flow_tbl_init(struct flow_table *table)
 {
 	struct table_instance *ti, *ufid_ti;
@@ -439,6 +485,9 @@ int ovs_flow_tbl_init(struct flow_table *table)
 	table->last_rehash = jiffies;
 	table->count = 0;
 	table->ufid_count = 0;
+	table->mc_fixed = false;
+	table->mc_last_hit = 0;
+	table->mc_last_cache_hit = 0;
 	return 0;
 
 free_ti:
@@ -458,6 +507,27 @@ static void flow_tbl_destroy_rcu_cb(struct rcu_head *rcu)
 	__table_instance_destroy(ti);
 }
 
+static void mask_filter_add(struct sw_flow_mask *mask, u32 hash)
+{
+	struct sw_flow_mask_filter *filter = mask->filter;
+	u32 bit = hash & (MASK_FILTER_BITS - 1);
+
+	if (filter->cnt[bit] != U8_MAX)
+		filter->cnt[bit]++;
+	set_bit(bit, filter->bits);
+}
+
+static void mask_filter_del(struct sw_flow_mask *mask, u32 hash)
+{
+	struct sw_flow_mask_filter *filter = mask->filter;
+	u32 bit = hash & (MASK_FILTER_BITS - 1);
+
+	if (filter->cnt[bit] == U8_MAX)
+		return;
+	if (!--filter->cnt[bit])
+		clear_bit(bit, filter->bits);
+}
+
 static void table_instance_flow_free(struct flow_table *table,
 				     struct table_instance *ti,
 				     struct table_instance *ufid_ti,
@@ -466,6 +536,11 @@ static void table_instance_flow_free(struct flow_table *table,
 	hlist_del_rcu(&flow->flow_table.node[ti->node_ver]);
 	table->count--;
 
+	/* Readers that still see the flow in the bucket may now skip the
+	 * mask, which only makes them miss a flow that is going away.
+	 */
+	mask_filter_del(flow->mask, flow->flow_table.hash);
+
 	if (ovs_identifier_is_ufid(&flow->id)) {
 		hlist_del_rcu(&flow->ufid_table.node[ufid_ti->node_ver]);
 		table->ufid_count--;
@@ -709,8 +784,11 @@ static struct sw_flow *masked_flow_lookup(struct table_instance *ti,
 
 	ovs_flow_mask_key(&masked_key, unmasked, false, mask);
 	hash = flow_hash(&masked_key, &mask->range);
-	head = find_bucket(ti, hash);
 	(*n_mask_hit)++;
+	if (!test_bit(hash & (MASK_FILTER_BITS - 1), mask->filter->bits))
+		return NULL;
+
+	head = find_bucket(ti, hash);
 
 	hlist_for_each_entry_rcu(flow, head, flow_table.node[ti->node_ver],
 				 lockdep_ovsl_is_held()) {
@@ -968,9 +1046,11 @@ static struct sw_flow_mask *mask_alloc(void)
 {
 	struct sw_flow_mask *mask;
 
-	mask = kmalloc(sizeof(*mask), GFP_KERNEL);
-	if (mask)
+	mask = kmalloc(struct_size(mask, filter, 1), GFP_KERNEL);
+	if (mask) {
 		mask->ref_count = 1;
+		memset(mask->filter, 0, sizeof(*mask->filter));
+	}
 
 	return mask;
 }
@@ -1040,6 +1120,8 @@ static void flow_key_insert(struct flow_table *table, struct sw_flow *flow)
 	struct table_instance *ti;
 
 	flow->flow_table.hash = flow_hash(&flow->key, &flow->mask->range);
+	/* The filter bit must be visible before the flow is. */
+	mask_filter_add(flow->mask, flow->flow_table.hash);
 	ti = ovsl_dereference(table->ti);
 	table_instance_insert(ti, flow);
 	table->count++;
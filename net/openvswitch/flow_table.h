@@ -67,6 +67,9 @@ struct flow_table {
 	unsigned long last_rehash;
 	unsigned int count;
 	unsigned int ufid_count;
+	bool mc_fixed;		/* Mask cache sized by userspace. */
+	u64 mc_last_hit;
+	u64 mc_last_cache_hit;
 };
 
 extern struct kmem_cache *flow_stats_cache;
@@ -88,6 +91,8 @@ void ovs_flow_tbl_remove(struct flow_table *table, struct sw_flow *flow);
 int  ovs_flow_tbl_num_masks(const struct flow_table *table);
 u32  ovs_flow_tbl_masks_cache_size(const struct flow_table *table);
 int  ovs_flow_tbl_masks_cache_resize(struct flow_table *table, u32 size);
+void ovs_flow_tbl_masks_cache_adapt(struct flow_table *table, u64 n_hit,
+				    u64 n_cache_hit);
 struct sw_flow *ovs_flow_tbl_dump_next(struct table_instance *table,
 				       u32 *bucket, u32 *idx);
 struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *,
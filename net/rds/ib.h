@@ -14,6 +14,8 @@
 #define RDS_IB_RECV_SGE 		2
 
 #define RDS_IB_DEFAULT_RECV_WR		1024
+#define RDS_IB_RECV_TARGET_MIN		64	/* posted recvs when idle */
+#define RDS_IB_RECV_TARGET_DECAY	(10 * HZ)
 #define RDS_IB_DEFAULT_SEND_WR		256
 #define RDS_IB_DEFAULT_FR_WR		512
 
@@ -178,6 +180,8 @@ struct rds_ib_connection {
 	struct rds_header	**i_recv_hdrs;
 	dma_addr_t		*i_recv_hdrs_dma;
 	struct rds_ib_recv_work *i_recvs;
+	u32			i_recv_target;	/* recvs to keep posted */
+	unsigned long		i_recv_grown;	/* when it was last raised */
 	u64			i_ack_recv;	/* last ACK received */
 	struct rds_ib_refill_cache i_cache_incs;
 	struct rds_ib_refill_cache i_cache_frags;
@@ -419,6 +423,7 @@ void rds_ib_ring_free(struct rds_ib_work_ring *ring, u32 val);
 void rds_ib_ring_unalloc(struct rds_ib_work_ring *ring, u32 val);
 int rds_ib_ring_empty(struct rds_ib_work_ring *ring);
 int rds_ib_ring_low(struct rds_ib_work_ring *ring);
+u32 rds_ib_ring_used(struct rds_ib_work_ring *ring);
 u32 rds_ib_ring_oldest(struct rds_ib_work_ring *ring);
 u32 rds_ib_ring_completed(struct rds_ib_work_ring *ring, u32 wr_id, u32 oldest);
 extern wait_queue_head_t rds_ib_ring_empty_wait;
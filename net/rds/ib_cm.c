@@ -61,6 +61,8 @@ static void rds_ib_set_flow_control(struct rds_connection *conn, u32 credits)
 	if (rds_ib_sysctl_flow_control && credits != 0) {
 		/* We're doing flow control */
 		ic->i_flowctl = 1;
+		ic->i_recv_target = RDS_IB_RECV_TARGET_MIN;
+		ic->i_recv_grown = jiffies;
 		rds_ib_send_add_credits(conn, credits);
 	} else {
 		ic->i_flowctl = 0;
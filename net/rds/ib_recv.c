@@ -378,6 +378,49 @@ static void release_refill(struct rds_connection *conn)
  * they have all the allocations they need to queue received fragments into
  * sockets.
  */
+/*
+ * How many receives to keep posted.  Without flow control the peer may
+ * send as much as the ring holds, so it is kept full.  With flow control
+ * the peer only sends what we gave it credits for, so an idle connection
+ * keeps just RDS_IB_RECV_TARGET_MIN buffers posted.  The target doubles
+ * whenever most of what was posted got consumed before we could refill,
+ * and halves again after RDS_IB_RECV_TARGET_DECAY without growing; the
+ * surplus buffers are then simply not reposted as they complete.
+ *
+ * Must be called with the refill lock held.
+ */
+static u32 rds_ib_recv_target(struct rds_ib_connection *ic)
+{
+	struct rds_ib_work_ring *ring = &ic->i_recv_ring;
+	u32 target;
+
+	if (!ic->i_flowctl)
+		return ring->w_nr;
+
+	target = min(ic->i_recv_target, ring->w_nr);
+	if (rds_ib_ring_used(ring) < target / 4 && target < ring->w_nr) {
+		target = min(target * 2, ring->w_nr);
+		ic->i_recv_grown = jiffies;
+	} else if (target > RDS_IB_RECV_TARGET_MIN &&
+		   time_after(jiffies, ic->i_recv_grown +
+				       RDS_IB_RECV_TARGET_DECAY)) {
+		target = max_t(u32, target / 2, RDS_IB_RECV_TARGET_MIN);
+		ic->i_recv_grown = jiffies;
+	}
+	ic->i_recv_target = target;
+
+	return target;
+}
+
+/* like rds_ib_ring_low(), against what we want posted */
+static bool rds_ib_recv_ring_low(struct rds_ib_connection *ic)
+{
+	u32 target = ic->i_flowctl ? READ_ONCE(ic->i_recv_target) :
+				     ic->i_recv_ring.w_nr;
+
+	return rds_ib_ring_used(&ic->i_recv_ring) <= (target >> 1);
+}
+
 void rds_ib_recv_refill(struct rds_connection *conn, int prefill, gfp_t gfp)
 {
 	struct rds_ib_connection *ic = conn->c_transport_data;
@@ -386,7 +429,7 @@ void rds_ib_recv_refill(struct rds_connection *conn, int prefill, gfp_t gfp)
 	int ret = 0;
 	bool can_wait = !!(gfp & __GFP_DIRECT_RECLAIM);
 	bool must_wake = false;
-	u32 pos;
+	u32 pos, target;
 
 	/* the goal here is to just make sure that someone, somewhere
 	 * is posting buffers.  If we can't get the refill lock,
@@ -395,7 +438,9 @@ void rds_ib_recv_refill(struct rds_connection *conn, int prefill, gfp_t gfp)
 	if (!acquire_refill(conn))
 		return;
 
+	target = rds_ib_recv_target(ic);
 	while ((prefill || rds_conn_up(conn)) &&
+	       rds_ib_ring_used(&ic->i_recv_ring) < target &&
 	       rds_ib_ring_alloc(&ic->i_recv_ring, 1, &pos)) {
 		if (pos >= ic->i_recv_ring.w_nr) {
 			printk(KERN_NOTICE "Argh - ring alloc returned pos=%u\n",
@@ -448,12 +493,12 @@ void rds_ib_recv_refill(struct rds_connection *conn, int prefill, gfp_t gfp)
 	 *
 	 * if we're called from krdsd, we'll be GFP_KERNEL.  In this case
 	 * we might have raced with the softirq code while we had the refill
-	 * lock held.  Use rds_ib_ring_low() instead of ring_empty to decide
-	 * if we should requeue.
+	 * lock held.  Use rds_ib_recv_ring_low() instead of ring_empty to
+	 * decide if we should requeue.
 	 */
 	if (rds_conn_up(conn) &&
 	    (must_wake ||
-	    (can_wait && rds_ib_ring_low(&ic->i_recv_ring)) ||
+	    (can_wait && rds_ib_recv_ring_low(ic)) ||
 	    rds_ib_ring_empty(&ic->i_recv_ring))) {
 		queue_delayed_work(rds_wq, &conn->c_recv_w, 1);
 	}
@@ -1031,7 +1076,7 @@ void rds_ib_recv_cqe_handler(struct rds_ib_connection *ic,
 	if (rds_ib_ring_empty(&ic->i_recv_ring))
 		rds_ib_stats_inc(s_ib_rx_ring_empty);
 
-	if (rds_ib_ring_low(&ic->i_recv_ring)) {
+	if (rds_ib_recv_ring_low(ic)) {
 		rds_ib_recv_refill(conn, 0, GFP_NOWAIT | __GFP_NOWARN);
 		rds_ib_stats_inc(s_ib_rx_refill_from_cq);
 	}
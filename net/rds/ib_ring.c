@@ -140,6 +140,11 @@ int rds_ib_ring_low(struct rds_ib_work_ring *ring)
 	return __rds_ib_ring_used(ring) <= (ring->w_nr >> 1);
 }
 
+u32 rds_ib_ring_used(struct rds_ib_work_ring *ring)
+{
+	return __rds_ib_ring_used(ring);
+}
+
 /*
  * returns the oldest allocated ring entry.  This will be the next one
  * freed.  This can't be called if there are none allocated.
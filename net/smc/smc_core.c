@@ -1147,16 +1147,134 @@ void smcr_link_clear(struct smc_link *lnk, bool log)
 		wake_up(&smcibdev->lnks_deleted);
 }
 
+/* Buffers freed with their link group are kept here for any other link
+ * group to pick up, which saves the high-order allocations on connection
+ * setup.  Only the memory is shared: registration with a link or an ISM
+ * device stays per link group.  SMC-R sndbufs and RMBs are alike and share
+ * a pool; of SMC-D buffers, only sndbufs can be pooled as DMBs are
+ * allocated by the ISM device.
+ *
+ * The number of free buffers of a size kept is bounded by how many
+ * buffers of that size are in use, so the pools follow demand.
+ */
+#define SMC_BUF_POOL_MIN	2
+
+struct smc_buf_pool {
+	spinlock_t		lock;		/* protects lists, counters */
+	struct list_head	free[SMC_RMBE_SIZES];
+	int			free_cnt[SMC_RMBE_SIZES];
+	int			used_cnt[SMC_RMBE_SIZES];
+};
+
+static struct smc_buf_pool smcr_buf_pool;
+static struct smc_buf_pool smcd_sndbuf_pool;
+
+static void smc_buf_pool_init(struct smc_buf_pool *pool)
+{
+	int i;
+
+	spin_lock_init(&pool->lock);
+	for (i = 0; i < SMC_RMBE_SIZES; i++)
+		INIT_LIST_HEAD(&pool->free[i]);
+}
+
+static int smc_buf_pool_idx(int len)
+{
+	return min_t(int, ilog2(len / SMC_BUF_MIN_SIZE), SMC_RMBE_SIZES - 1);
+}
+
+/* take a pooled buffer of the given compressed size, or NULL */
+static struct smc_buf_desc *smc_buf_pool_get(struct smc_buf_pool *pool,
+					     int bufsize_short)
+{
+	struct smc_buf_desc *buf_desc;
+
+	spin_lock(&pool->lock);
+	buf_desc = list_first_entry_or_null(&pool->free[bufsize_short],
+					    struct smc_buf_desc, list);
+	if (buf_desc) {
+		list_del(&buf_desc->list);
+		pool->free_cnt[bufsize_short]--;
+		pool->used_cnt[bufsize_short]++;
+	}
+	spin_unlock(&pool->lock);
+	return buf_desc;
+}
+
+/* account for a newly allocated buffer */
+static void smc_buf_pool_charge(struct smc_buf_pool *pool, int len)
+{
+	spin_lock(&pool->lock);
+	pool->used_cnt[smc_buf_pool_idx(len)]++;
+	spin_unlock(&pool->lock);
+}
+
+/* return a buffer to the pool; false if the pool is full and it has to
+ * be freed
+ */
+static bool smc_buf_pool_put(struct smc_buf_pool *pool,
+			     struct smc_buf_desc *buf_desc)
+{
+	int i = smc_buf_pool_idx(buf_desc->len);
+	bool kept = false;
+
+	spin_lock(&pool->lock);
+	pool->used_cnt[i]--;
+	if (pool->free_cnt[i] < max(SMC_BUF_POOL_MIN, pool->used_cnt[i] / 2)) {
+		list_add(&buf_desc->list, &pool->free[i]);
+		pool->free_cnt[i]++;
+		kept = true;
+	}
+	spin_unlock(&pool->lock);
+	return kept;
+}
+
+static void smc_buf_pool_drain(struct smc_buf_pool *pool, bool is_smcd)
+{
+	struct smc_buf_desc *buf_desc, *bf;
+	int i;
+
+	spin_lock(&pool->lock);
+	for (i = 0; i < SMC_RMBE_SIZES; i++) {
+		list_for_each_entry_safe(buf_desc, bf, &pool->free[i], list) {
+			list_del(&buf_desc->list);
+			if (is_smcd)
+				kfree(buf_desc->cpu_addr);
+			else
+				__free_pages(buf_desc->pages, buf_desc->order);
+			kfree(buf_desc);
+		}
+		pool->free_cnt[i] = 0;
+	}
+	spin_unlock(&pool->lock);
+}
+
 static void smcr_buf_free(struct smc_link_group *lgr, bool is_rmb,
 			  struct smc_buf_desc *buf_desc)
 {
+	struct page *pages = buf_desc->pages;
+	u32 order = buf_desc->order;
+	int len = buf_desc->len;
 	int i;
 
 	for (i = 0; i < SMC_LINKS_PER_LGR_MAX; i++)
 		smcr_buf_unmap_link(buf_desc, is_rmb, &lgr->lnk[i]);
 
-	if (buf_desc->pages)
-		__free_pages(buf_desc->pages, buf_desc->order);
+	if (!pages) {
+		kfree(buf_desc);
+		return;
+	}
+
+	/* drop what tied the buffer to this link group */
+	memset(buf_desc, 0, sizeof(*buf_desc));
+	buf_desc->pages = pages;
+	buf_desc->order = order;
+	buf_desc->cpu_addr = page_address(pages);
+	buf_desc->len = len;
+	if (smc_buf_pool_put(&smcr_buf_pool, buf_desc))
+		return;
+
+	__free_pages(pages, order);
 	kfree(buf_desc);
 }
 
@@ -1168,6 +1286,9 @@ static void smcd_buf_free(struct smc_link_group *lgr, bool is_dmb,
 		buf_desc->len += sizeof(struct smcd_cdc_msg);
 		smc_ism_unregister_dmb(lgr->smcd, buf_desc);
 	} else {
+		buf_desc->used = 0;
+		if (smc_buf_pool_put(&smcd_sndbuf_pool, buf_desc))
+			return;
 		kfree(buf_desc->cpu_addr);
 	}
 	kfree(buf_desc);
@@ -2069,6 +2190,25 @@ static int __smc_buf_create(struct smc_sock *smc, bool is_smcd, bool is_rmb)
 			break; /* found reusable slot */
 		}
 
+		/* then for one another link group left behind */
+		buf_desc = NULL;
+		if (!is_smcd)
+			buf_desc = smc_buf_pool_get(&smcr_buf_pool,
+						    bufsize_short);
+		else if (!is_rmb)
+			buf_desc = smc_buf_pool_get(&smcd_sndbuf_pool,
+						    bufsize_short);
+		if (buf_desc) {
+			SMC_STAT_RMB_SIZE(smc, is_smcd, is_rmb, bufsize);
+			SMC_STAT_BUF_REUSE(smc, is_smcd, is_rmb);
+			memset(buf_desc->cpu_addr, 0, bufsize);
+			buf_desc->used = 1;
+			mutex_lock(lock);
+			list_add(&buf_desc->list, buf_list);
+			mutex_unlock(lock);
+			break; /* found pooled buffer */
+		}
+
 		if (is_smcd)
 			buf_desc = smcd_new_buf_create(lgr, is_rmb, bufsize);
 		else
@@ -2086,6 +2226,10 @@ static int __smc_buf_create(struct smc_sock *smc, bool is_smcd, bool is_rmb)
 
 		SMC_STAT_RMB_ALLOC(smc, is_smcd, is_rmb);
 		SMC_STAT_RMB_SIZE(smc, is_smcd, is_rmb, bufsize);
+		if (!is_smcd)
+			smc_buf_pool_charge(&smcr_buf_pool, bufsize);
+		else if (!is_rmb)
+			smc_buf_pool_charge(&smcd_sndbuf_pool, bufsize);
 		buf_desc->used = 1;
 		mutex_lock(lock);
 		list_add(&buf_desc->list, buf_list);
@@ -2353,6 +2497,8 @@ static struct notifier_block smc_reboot_notifier = {
 
 int __init smc_core_init(void)
 {
+	smc_buf_pool_init(&smcr_buf_pool);
+	smc_buf_pool_init(&smcd_sndbuf_pool);
 	return register_reboot_notifier(&smc_reboot_notifier);
 }
 
@@ -2361,4 +2507,6 @@ void smc_core_exit(void)
 {
 	unregister_reboot_notifier(&smc_reboot_notifier);
 	smc_lgrs_shutdown();
+	smc_buf_pool_drain(&smcr_buf_pool, false);
+	smc_buf_pool_drain(&smcd_sndbuf_pool, true);
 }
@@ -46,6 +46,8 @@ static LIST_HEAD(svc_xprt_class_list);
 /* SMP locking strategy:
  *
  *	svc_pool->sp_lock protects most of the fields of that pool.
+ *	Transports are queued to a pool without it, on sp_new_sockets, and
+ *	moved to sp_sockets under it when a thread looks for work.
  *	svc_serv->sv_lock protects sv_tempsocks, sv_permsocks, sv_tmpcnt.
  *	when both need to be taken (rare), svc_serv->sv_lock is first.
  *	The "service mutex" protects svc_serv->sv_nrthread.
@@ -424,6 +426,28 @@ static bool svc_xprt_ready(struct svc_xprt *xprt)
 	return false;
 }
 
+/*
+ * Wake one idle thread of @pool, if there is one, and return it.
+ */
+static struct svc_rqst *svc_pool_wake_idle_thread(struct svc_pool *pool)
+{
+	struct svc_rqst	*rqstp;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(rqstp, &pool->sp_all_threads, rq_all) {
+		if (test_and_set_bit(RQ_BUSY, &rqstp->rq_flags))
+			continue;
+		atomic_long_inc(&pool->sp_stats.threads_woken);
+		rqstp->rq_qtime = ktime_get();
+		wake_up_process(rqstp->rq_task);
+		rcu_read_unlock();
+		return rqstp;
+	}
+	set_bit(SP_CONGESTED, &pool->sp_flags);
+	rcu_read_unlock();
+	return NULL;
+}
+
 void svc_xprt_do_enqueue(struct svc_xprt *xprt)
 {
 	struct svc_pool *pool;
@@ -445,26 +469,18 @@ void svc_xprt_do_enqueue(struct svc_xprt *xprt)
 	pool = svc_pool_for_cpu(xprt->xpt_server, cpu);
 
 	atomic_long_inc(&pool->sp_stats.packets);
+	atomic_long_inc(&pool->sp_stats.sockets_queued);
 
-	spin_lock_bh(&pool->sp_lock);
-	list_add_tail(&xprt->xpt_ready, &pool->sp_sockets);
-	pool->sp_stats.sockets_queued++;
-	spin_unlock_bh(&pool->sp_lock);
+	/*
+	 * If other transports were already waiting, a thread has been
+	 * woken for them or all threads are busy and will look for work
+	 * before sleeping.  Whichever thread dequeues next wakes another
+	 * one if work is left, so there is no need to wake one here.
+	 */
+	xprt->xpt_qtime = ktime_get();
+	if (llist_add(&xprt->xpt_ready_new, &pool->sp_new_sockets))
+		rqstp = svc_pool_wake_idle_thread(pool);
 
-	/* find a thread for this xprt */
-	rcu_read_lock();
-	list_for_each_entry_rcu(rqstp, &pool->sp_all_threads, rq_all) {
-		if (test_and_set_bit(RQ_BUSY, &rqstp->rq_flags))
-			continue;
-		atomic_long_inc(&pool->sp_stats.threads_woken);
-		rqstp->rq_qtime = ktime_get();
-		wake_up_process(rqstp->rq_task);
-		goto out_unlock;
-	}
-	set_bit(SP_CONGESTED, &pool->sp_flags);
-	rqstp = NULL;
-out_unlock:
-	rcu_read_unlock();
 	put_cpu();
 	trace_svc_xprt_do_enqueue(xprt, rqstp);
 }
@@ -483,24 +499,55 @@ void svc_xprt_enqueue(struct svc_xprt *xprt)
 }
 EXPORT_SYMBOL_GPL(svc_xprt_enqueue);
 
+static bool svc_pool_has_xprts(struct svc_pool *pool)
+{
+	return !list_empty(&pool->sp_sockets) ||
+	       !llist_empty(&pool->sp_new_sockets);
+}
+
 /*
- * Dequeue the first transport, if there is one.
+ * Move the transports queued locklessly to the tail of sp_sockets, in
+ * the order they were queued.  Called with sp_lock held.
+ */
+static void svc_pool_splice_new_xprts(struct svc_pool *pool)
+{
+	struct llist_node *new = llist_del_all(&pool->sp_new_sockets);
+	struct svc_xprt *xprt;
+
+	llist_for_each_entry(xprt, llist_reverse_order(new), xpt_ready_new)
+		list_add_tail(&xprt->xpt_ready, &pool->sp_sockets);
+}
+
+/*
+ * Dequeue the first transport, if there is one, and hand any others that
+ * are left to another thread.
  */
 static struct svc_xprt *svc_xprt_dequeue(struct svc_pool *pool)
 {
 	struct svc_xprt	*xprt = NULL;
+	bool more = false;
 
-	if (list_empty(&pool->sp_sockets))
+	if (!svc_pool_has_xprts(pool))
 		goto out;
 
 	spin_lock_bh(&pool->sp_lock);
+	if (list_empty(&pool->sp_sockets))
+		svc_pool_splice_new_xprts(pool);
 	if (likely(!list_empty(&pool->sp_sockets))) {
 		xprt = list_first_entry(&pool->sp_sockets,
 					struct svc_xprt, xpt_ready);
 		list_del_init(&xprt->xpt_ready);
 		svc_xprt_get(xprt);
+		more = svc_pool_has_xprts(pool);
 	}
 	spin_unlock_bh(&pool->sp_lock);
+
+	if (xprt) {
+		atomic64_add(ktime_us_delta(ktime_get(), xprt->xpt_qtime),
+			     &pool->sp_stats.queue_time);
+		if (more)
+			svc_pool_wake_idle_thread(pool);
+	}
 out:
 	return xprt;
 }
@@ -714,7 +761,7 @@ rqst_should_sleep(struct svc_rqst *rqstp)
 		return false;
 
 	/* was a socket queued? */
-	if (!list_empty(&pool->sp_sockets))
+	if (svc_pool_has_xprts(pool))
 		return false;
 
 	/* are we shutting down? */
@@ -1105,6 +1152,7 @@ static struct svc_xprt *svc_dequeue_net(struct svc_serv *serv, struct net *net)
 		pool = &serv->sv_pools[i];
 
 		spin_lock_bh(&pool->sp_lock);
+		svc_pool_splice_new_xprts(pool);
 		list_for_each_entry_safe(xprt, tmp, &pool->sp_sockets, xpt_ready) {
 			if (xprt->xpt_net != net)
 				continue;
@@ -1421,16 +1469,17 @@ static int svc_pool_stats_show(struct seq_file *m, void *p)
 	struct svc_pool *pool = p;
 
 	if (p == SEQ_START_TOKEN) {
-		seq_puts(m, "# pool packets-arrived sockets-enqueued threads-woken threads-timedout\n");
+		seq_puts(m, "# pool packets-arrived sockets-enqueued threads-woken threads-timedout queue-time-us\n");
 		return 0;
 	}
 
-	seq_printf(m, "%u %lu %lu %lu %lu\n",
+	seq_printf(m, "%u %lu %lu %lu %lu %llu\n",
 		pool->sp_id,
 		(unsigned long)atomic_long_read(&pool->sp_stats.packets),
-		pool->sp_stats.sockets_queued,
+		(unsigned long)atomic_long_read(&pool->sp_stats.sockets_queued),
 		(unsigned long)atomic_long_read(&pool->sp_stats.threads_woken),
-		(unsigned long)atomic_long_read(&pool->sp_stats.threads_timedout));
+		(unsigned long)atomic_long_read(&pool->sp_stats.threads_timedout),
+		(unsigned long long)atomic64_read(&pool->sp_stats.queue_time));
 
 	return 0;
 }
@@ -11,6 +11,7 @@
 #include <linux/types.h>
 #include <linux/kref.h>
 #include <linux/list.h>
+#include <linux/moduleparam.h>
 #include <linux/rcupdate.h>
 #include <linux/rculist.h>
 #include <linux/slab.h>
@@ -26,8 +27,15 @@ typedef struct rpc_xprt *(*xprt_switch_find_xprt_t)(struct rpc_xprt_switch *xps,
 
 static const struct rpc_xprt_iter_ops rpc_xprt_iter_singular;
 static const struct rpc_xprt_iter_ops rpc_xprt_iter_roundrobin;
+static const struct rpc_xprt_iter_ops rpc_xprt_iter_local;
 static const struct rpc_xprt_iter_ops rpc_xprt_iter_listall;
 
+static bool xprt_switch_cpu_local = true;
+module_param_named(nconnect_cpu_local, xprt_switch_cpu_local, bool, 0644);
+MODULE_PARM_DESC(nconnect_cpu_local,
+		 "Spread CPUs over the connections to a server instead of "
+		 "using them round-robin");
+
 static void xprt_switch_add_xprt_locked(struct rpc_xprt_switch *xps,
 		struct rpc_xprt *xprt)
 {
@@ -199,15 +207,20 @@ void xprt_switch_put(struct rpc_xprt_switch *xps)
 }
 
 /**
- * rpc_xprt_switch_set_roundrobin - Set a round-robin policy on rpc_xprt_switch
+ * rpc_xprt_switch_set_roundrobin - Set a multipath policy on rpc_xprt_switch
  * @xps: pointer to struct rpc_xprt_switch
  *
- * Sets a round-robin default policy for iterators acting on xps.
+ * Sets a round-robin default policy for iterators acting on xps, or the
+ * CPU-local one if the nconnect_cpu_local parameter is set.
  */
 void rpc_xprt_switch_set_roundrobin(struct rpc_xprt_switch *xps)
 {
-	if (READ_ONCE(xps->xps_iter_ops) != &rpc_xprt_iter_roundrobin)
-		WRITE_ONCE(xps->xps_iter_ops, &rpc_xprt_iter_roundrobin);
+	const struct rpc_xprt_iter_ops *ops = &rpc_xprt_iter_roundrobin;
+
+	if (READ_ONCE(xprt_switch_cpu_local))
+		ops = &rpc_xprt_iter_local;
+	if (READ_ONCE(xps->xps_iter_ops) != ops)
+		WRITE_ONCE(xps->xps_iter_ops, ops);
 }
 
 static
@@ -393,6 +406,51 @@ struct rpc_xprt *xprt_iter_next_entry_roundrobin(struct rpc_xprt_iter *xpi)
 			xprt_switch_find_next_entry_roundrobin);
 }
 
+/*
+ * Give each active transport its own group of CPUs, so that requests
+ * from a CPU keep going through the same socket, as long as that one
+ * does not have more than its share of the queued requests.  Otherwise
+ * take the transport with the fewest requests queued.
+ */
+static
+struct rpc_xprt *xprt_switch_find_next_entry_local(struct rpc_xprt_switch *xps,
+		const struct rpc_xprt *cur)
+{
+	struct list_head *head = &xps->xps_xprt_list;
+	struct rpc_xprt *pos, *local = NULL, *best = NULL;
+	unsigned long queuelen, best_queuelen = ULONG_MAX;
+	unsigned int nactive = READ_ONCE(xps->xps_nactive);
+	unsigned int i = 0, want;
+
+	if (nactive < 2)
+		return xprt_switch_find_first_entry(head);
+
+	want = raw_smp_processor_id() * nactive / nr_cpu_ids;
+	list_for_each_entry_rcu(pos, head, xprt_switch) {
+		if (!xprt_is_active(pos))
+			continue;
+		queuelen = atomic_long_read(&pos->queuelen);
+		if (i++ == want)
+			local = pos;
+		if (queuelen < best_queuelen) {
+			best = pos;
+			best_queuelen = queuelen;
+		}
+	}
+
+	if (local && atomic_long_read(&local->queuelen) * nactive <=
+			atomic_long_read(&xps->xps_queuelen))
+		return local;
+	return best;
+}
+
+static
+struct rpc_xprt *xprt_iter_next_entry_local(struct rpc_xprt_iter *xpi)
+{
+	return xprt_iter_next_entry_multiple(xpi,
+			xprt_switch_find_next_entry_local);
+}
+
 static
 struct rpc_xprt *xprt_switch_find_next_entry_all(struct rpc_xprt_switch *xps,
 		const struct rpc_xprt *cur)
@@ -567,6 +625,14 @@ const struct rpc_xprt_iter_ops rpc_xprt_iter_roundrobin = {
 	.xpi_next = xprt_iter_next_entry_roundrobin,
 };
 
+/* Policy for CPU-local, else least loaded, entries in the rpc_xprt_switch */
+static
+const struct rpc_xprt_iter_ops rpc_xprt_iter_local = {
+	.xpi_rewind = xprt_iter_default_rewind,
+	.xpi_xprt = xprt_iter_current_entry,
+	.xpi_next = xprt_iter_next_entry_local,
+};
+
 /* Policy for once-through iteration of entries in the rpc_xprt_switch */
 static
 const struct rpc_xprt_iter_ops rpc_xprt_iter_listall = {
@@ -295,6 +295,7 @@ struct rpcrdma_mr_seg *frwr_map(struct rpcrdma_xprt *r_xprt,
 				struct rpcrdma_mr *mr)
 {
 	struct rpcrdma_ep *ep = r_xprt->rx_ep;
+	unsigned int pages = 0;
 	struct ib_reg_wr *reg_wr;
 	int i, n, dma_nents;
 	struct ib_mr *ibmr;
@@ -303,6 +304,12 @@ struct rpcrdma_mr_seg *frwr_map(struct rpcrdma_xprt *r_xprt,
 	if (nsegs > ep->re_max_fr_depth)
 		nsegs = ep->re_max_fr_depth;
 	for (i = 0; i < nsegs;) {
+		/* A segment can cover several contiguous pages */
+		pages += DIV_ROUND_UP(offset_in_page(seg->mr_offset) +
+				      seg->mr_len, PAGE_SIZE);
+		if (i && pages > ep->re_max_fr_depth)
+			break;
+
 		sg_set_page(&mr->mr_sg[i], seg->mr_page,
 			    seg->mr_len, seg->mr_offset);
 
@@ -221,9 +221,10 @@ rpcrdma_convert_kvec(struct kvec *vec, struct rpcrdma_mr_seg *seg,
 	return seg;
 }
 
-/* Convert @xdrbuf into SGEs no larger than a page each. As they
- * are registered, these SGEs are then coalesced into RDMA segments
- * when the selected memreg mode supports it.
+/* Convert @xdrbuf into SGEs. Runs of physically contiguous pages
+ * share one SGE, otherwise SGEs are no larger than a page each. As
+ * they are registered, these SGEs are then coalesced into RDMA
+ * segments when the selected memreg mode supports it.
  *
  * Returns positive number of SGEs consumed, or a negative errno.
  */
@@ -233,9 +234,10 @@ rpcrdma_convert_iovs(struct rpcrdma_xprt *r_xprt, struct xdr_buf *xdrbuf,
 		     unsigned int pos, enum rpcrdma_chunktype type,
 		     struct rpcrdma_mr_seg *seg)
 {
+	struct page **ppages, *last = NULL;
 	unsigned long page_base;
 	unsigned int len, n;
-	struct page **ppages;
+	u32 seg_len;
 
 	n = 0;
 	if (pos == 0)
@@ -245,13 +247,20 @@ rpcrdma_convert_iovs(struct rpcrdma_xprt *r_xprt, struct xdr_buf *xdrbuf,
 	ppages = xdrbuf->pages + (xdrbuf->page_base >> PAGE_SHIFT);
 	page_base = offset_in_page(xdrbuf->page_base);
 	while (len) {
-		seg->mr_page = *ppages;
-		seg->mr_offset = page_base;
-		seg->mr_len = min_t(u32, PAGE_SIZE - page_base, len);
-		len -= seg->mr_len;
+		seg_len = min_t(u32, PAGE_SIZE - page_base, len);
+		if (last && page_to_pfn(*ppages) == page_to_pfn(last) + 1 &&
+		    !offset_in_page((seg - 1)->mr_offset + (seg - 1)->mr_len)) {
+			(seg - 1)->mr_len += seg_len;
+		} else {
+			seg->mr_page = *ppages;
+			seg->mr_offset = page_base;
+			seg->mr_len = seg_len;
+			++seg;
+			++n;
+		}
+		last = *ppages;
+		len -= seg_len;
 		++ppages;
-		++seg;
-		++n;
 		page_base = 0;
 	}
 
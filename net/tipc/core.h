@@ -90,6 +90,9 @@ struct tipc_crypto;
 extern unsigned int tipc_net_id __read_mostly;
 extern int sysctl_tipc_rmem[3] __read_mostly;
 extern int sysctl_tipc_named_timeout __read_mostly;
+extern int sysctl_tipc_rcv_spread __read_mostly;
+
+struct tipc_sk_rcv_cpu;
 
 struct tipc_net {
 	u8  node_id[NODE_ID_LEN];
@@ -122,6 +125,8 @@ struct tipc_net {
 
 	/* Socket hash table */
 	struct rhashtable sk_rht;
+	/* Per-CPU socket delivery queues, see tipc_sk_rcv_spread() */
+	struct tipc_sk_rcv_cpu __percpu *sk_rcv_cpus;
 
 	/* Name table */
 	spinlock_t nametbl_lock;
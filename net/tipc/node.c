@@ -2178,7 +2178,7 @@ void tipc_rcv(struct net *net, struct sk_buff *skb, struct tipc_bearer *b)
 		tipc_node_mcast_rcv(n);
 
 	if (!skb_queue_empty(&le->inputq))
-		tipc_sk_rcv(net, &le->inputq);
+		tipc_sk_rcv_spread(net, &le->inputq);
 
 	if (!skb_queue_empty(&xmitq))
 		tipc_bearer_xmit(net, bearer_id, &xmitq, &le->maddr, n);
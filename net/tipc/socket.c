@@ -37,6 +37,8 @@
 
 #include <linux/rhashtable.h>
 #include <linux/sched/signal.h>
+#include <linux/hash.h>
+#include <linux/interrupt.h>
 
 #include "core.h"
 #include "name_table.h"
@@ -2520,6 +2522,112 @@ void tipc_sk_rcv(struct net *net, struct sk_buff_head *inputq)
 	}
 }
 
+/* All messages arriving on a link are delivered to their sockets by the
+ * CPU that received them, so traffic between a pair of nodes is bound to
+ * one CPU.  With net.tipc.rcv_spread set, delivery is instead handed to a
+ * CPU chosen by destination port.  A port always maps to the same CPU, so
+ * the per-socket ordering the link guarantees is kept.
+ */
+int sysctl_tipc_rcv_spread __read_mostly;
+
+struct tipc_sk_rcv_cpu {
+	struct sk_buff_head	inputq;
+	struct tasklet_struct	tasklet;
+	call_single_data_t	csd;
+	unsigned long		kicked;
+	struct net		*net;
+};
+
+static void tipc_sk_rcv_cpu_tasklet(unsigned long data)
+{
+	struct tipc_sk_rcv_cpu *rc = (struct tipc_sk_rcv_cpu *)data;
+
+	tipc_sk_rcv(rc->net, &rc->inputq);
+}
+
+/* Runs on the target CPU */
+static void tipc_sk_rcv_cpu_kick(void *data)
+{
+	struct tipc_sk_rcv_cpu *rc = data;
+
+	clear_bit(0, &rc->kicked);
+	tasklet_schedule(&rc->tasklet);
+}
+
+void tipc_sk_rcv_spread(struct net *net, struct sk_buff_head *inputq)
+{
+	struct tipc_net *tn = tipc_net(net);
+	int this_cpu = raw_smp_processor_id();
+	struct tipc_sk_rcv_cpu *rc;
+	struct sk_buff_head list, localq;
+	struct sk_buff *skb;
+	int cpu;
+
+	if (!READ_ONCE(sysctl_tipc_rcv_spread) || num_online_cpus() == 1) {
+		tipc_sk_rcv(net, inputq);
+		return;
+	}
+
+	__skb_queue_head_init(&list);
+	spin_lock_bh(&inputq->lock);
+	skb_queue_splice_init(inputq, &list);
+	spin_unlock_bh(&inputq->lock);
+
+	skb_queue_head_init(&localq);
+	while ((skb = __skb_dequeue(&list))) {
+		cpu = reciprocal_scale(hash_32(msg_destport(buf_msg(skb)), 32),
+				       nr_cpu_ids);
+		if (cpu == this_cpu || !cpu_online(cpu)) {
+			__skb_queue_tail(&localq, skb);
+			continue;
+		}
+		rc = per_cpu_ptr(tn->sk_rcv_cpus, cpu);
+		skb_queue_tail(&rc->inputq, skb);
+		if (!test_and_set_bit(0, &rc->kicked))
+			smp_call_function_single_async(cpu, &rc->csd);
+	}
+
+	if (!skb_queue_empty(&localq))
+		tipc_sk_rcv(net, &localq);
+}
+
+static int tipc_sk_rcv_spread_init(struct net *net)
+{
+	struct tipc_net *tn = tipc_net(net);
+	struct tipc_sk_rcv_cpu *rc;
+	int cpu;
+
+	tn->sk_rcv_cpus = alloc_percpu(struct tipc_sk_rcv_cpu);
+	if (!tn->sk_rcv_cpus)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		rc = per_cpu_ptr(tn->sk_rcv_cpus, cpu);
+		skb_queue_head_init(&rc->inputq);
+		tasklet_init(&rc->tasklet, tipc_sk_rcv_cpu_tasklet,
+			     (unsigned long)rc);
+		INIT_CSD(&rc->csd, tipc_sk_rcv_cpu_kick, rc);
+		rc->net = net;
+	}
+	return 0;
+}
+
+static void tipc_sk_rcv_spread_stop(struct net *net)
+{
+	struct tipc_net *tn = tipc_net(net);
+	struct tipc_sk_rcv_cpu *rc;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		rc = per_cpu_ptr(tn->sk_rcv_cpus, cpu);
+		while (test_bit(0, &rc->kicked))
+			cpu_relax();
+		tasklet_kill(&rc->tasklet);
+		skb_queue_purge(&rc->inputq);
+	}
+	free_percpu(tn->sk_rcv_cpus);
+}
+
 static int tipc_wait_for_connect(struct socket *sock, long *timeo_p)
 {
 	DEFINE_WAIT_FUNC(wait, woken_wake_function);
@@ -3047,8 +3155,16 @@ static const struct rhashtable_params tsk_rht_params = {
 int tipc_sk_rht_init(struct net *net)
 {
 	struct tipc_net *tn = net_generic(net, tipc_net_id);
+	int err;
 
-	return rhashtable_init(&tn->sk_rht, &tsk_rht_params);
+	err = rhashtable_init(&tn->sk_rht, &tsk_rht_params);
+	if (err)
+		return err;
+
+	err = tipc_sk_rcv_spread_init(net);
+	if (err)
+		rhashtable_destroy(&tn->sk_rht);
+	return err;
 }
 
 void tipc_sk_rht_destroy(struct net *net)
@@ -3057,6 +3173,7 @@ void tipc_sk_rht_destroy(struct net *net)
 
 	/* Wait for socket readers to complete */
 	synchronize_net();
+	tipc_sk_rcv_spread_stop(net);
 
 	rhashtable_destroy(&tn->sk_rht);
 }
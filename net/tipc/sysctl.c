@@ -84,6 +84,15 @@ static struct ctl_table tipc_table[] = {
 		.extra2         = SYSCTL_ONE,
 	},
 #endif
+	{
+		.procname	= "rcv_spread",
+		.data		= &sysctl_tipc_rcv_spread,
+		.maxlen		= sizeof(sysctl_tipc_rcv_spread),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1         = SYSCTL_ZERO,
+		.extra2         = SYSCTL_ONE,
+	},
 	{
 		.procname	= "bc_retruni",
 		.data		= &sysctl_tipc_bc_retruni,
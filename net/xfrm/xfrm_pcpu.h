@@ -0,0 +1,13 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _XFRM_PCPU_H
+#define _XFRM_PCPU_H
+
+#include <net/xfrm.h>
+
+/* SAs installed with XFRMA_SA_PCPU, one per CPU under the same policy
+ * template, so that each CPU numbers and protects its own packets.
+ */
+int xfrm_state_set_pcpu(struct xfrm_state *x, u32 cpu);
+int xfrm_state_pcpu(const struct xfrm_state *x);
+
+#endif /* _XFRM_PCPU_H */
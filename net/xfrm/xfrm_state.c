@@ -26,10 +26,13 @@
 #include <linux/slab.h>
 #include <linux/interrupt.h>
 #include <linux/kernel.h>
+#include <linux/hash.h>
+#include <linux/rhashtable.h>
 
 #include <crypto/aead.h>
 
 #include "xfrm_hash.h"
+#include "xfrm_pcpu.h"
 
 #define xfrm_state_deref_prot(table, net) \
 	rcu_dereference_protected((table), lockdep_is_held(&(net)->xfrm.xfrm_state_lock))
@@ -125,6 +128,86 @@ static unsigned long xfrm_hash_new_size(unsigned int state_hmask)
 	return ((state_hmask + 1) << 1) * sizeof(struct hlist_head);
 }
 
+/* Outbound SA resolution is repeated for every forwarded packet that
+ * misses the per-CPU bundle reuse in xfrm_policy.c, which on a gateway
+ * with many tunnels is most of them.  Each CPU remembers the state found
+ * for a template and pair of endpoints.  Only unambiguous results are
+ * kept, where a single state was a candidate, so the flow itself only
+ * has to be checked against that state's selector on a hit.  Any change
+ * to the set of states invalidates every entry.
+ */
+#define XFRM_STATE_CACHE_SIZE	128
+
+struct xfrm_state_cache_entry {
+	const struct xfrm_tmpl	*tmpl;
+	struct xfrm_state	*x;
+	xfrm_address_t		daddr;
+	xfrm_address_t		saddr;
+	u32			if_id;
+	unsigned int		genid;
+};
+
+struct xfrm_state_cache {
+	struct xfrm_state_cache_entry entries[XFRM_STATE_CACHE_SIZE];
+};
+
+static void xfrm_state_cache_invalidate(struct net *net)
+{
+	atomic_inc(&net->xfrm.state_cache_genid);
+}
+
+static struct xfrm_state_cache_entry *
+xfrm_state_cache_slot(struct net *net, const struct xfrm_tmpl *tmpl,
+		      unsigned int h)
+{
+	struct xfrm_state_cache *sc = this_cpu_ptr(net->xfrm.state_cache);
+
+	h ^= hash_ptr(tmpl, 32);
+	return &sc->entries[h & (XFRM_STATE_CACHE_SIZE - 1)];
+}
+
+/* Called under rcu_read_lock().  The state is only freed a grace period
+ * after the deletion that bumped the genid, so it is safe to look at.
+ */
+static struct xfrm_state *
+xfrm_state_cache_lookup(struct net *net, const struct xfrm_tmpl *tmpl,
+			unsigned int h, const xfrm_address_t *daddr,
+			const xfrm_address_t *saddr, u32 if_id,
+			unsigned int genid)
+{
+	struct xfrm_state_cache_entry *e;
+	struct xfrm_state *x = NULL;
+
+	local_bh_disable();
+	e = xfrm_state_cache_slot(net, tmpl, h);
+	if (e->tmpl == tmpl && e->genid == genid && e->if_id == if_id &&
+	    xfrm_addr_equal(&e->daddr, daddr, tmpl->encap_family) &&
+	    xfrm_addr_equal(&e->saddr, saddr, tmpl->encap_family))
+		x = e->x;
+	local_bh_enable();
+
+	return x;
+}
+
+static void xfrm_state_cache_store(struct net *net,
+				   const struct xfrm_tmpl *tmpl,
+				   unsigned int h, const xfrm_address_t *daddr,
+				   const xfrm_address_t *saddr, u32 if_id,
+				   unsigned int genid, struct xfrm_state *x)
+{
+	struct xfrm_state_cache_entry *e;
+
+	local_bh_disable();
+	e = xfrm_state_cache_slot(net, tmpl, h);
+	e->tmpl = tmpl;
+	e->x = x;
+	e->daddr = *daddr;
+	e->saddr = *saddr;
+	e->if_id = if_id;
+	e->genid = genid;
+	local_bh_enable();
+}
+
 static void xfrm_hash_resize(struct work_struct *work)
 {
 	struct net *net = container_of(work, struct net, xfrm.state_hash_work);
@@ -158,6 +241,7 @@ static void xfrm_hash_resize(struct work_struct *work)
 
 	spin_lock_bh(&net->xfrm.xfrm_state_lock);
 	write_seqcount_begin(&net->xfrm.xfrm_state_hash_generation);
+	xfrm_state_cache_invalidate(net);
 
 	nhashmask = (nsize / sizeof(struct hlist_head)) - 1U;
 	odst = xfrm_state_deref_prot(net->xfrm.state_bydst, net);
@@ -497,8 +581,105 @@ void xfrm_state_free(struct xfrm_state *x)
 }
 EXPORT_SYMBOL(xfrm_state_free);
 
+/* The CPU an SA belongs to is looked up by state.  Most SAs have none,
+ * which xfrm_state_pcpu() can tell without a lookup while no SA anywhere
+ * has one.
+ */
+struct xfrm_state_pcpu {
+	struct rhash_head	node;
+	const struct xfrm_state	*x;
+	u32			cpu;
+	struct rcu_head		rcu;
+};
+
+static const struct rhashtable_params xfrm_state_pcpu_params = {
+	.key_len		= sizeof(struct xfrm_state *),
+	.key_offset		= offsetof(struct xfrm_state_pcpu, x),
+	.head_offset		= offsetof(struct xfrm_state_pcpu, node),
+	.automatic_shrinking	= true,
+};
+
+static struct rhashtable xfrm_state_pcpu_table;
+static atomic_t xfrm_state_pcpu_count = ATOMIC_INIT(0);
+
+/* Must be called before the state is added. */
+int xfrm_state_set_pcpu(struct xfrm_state *x, u32 cpu)
+{
+	struct xfrm_state_pcpu *p;
+	int err;
+
+	if (cpu >= nr_cpu_ids || !cpu_possible(cpu))
+		return -EINVAL;
+
+	p = kmalloc(sizeof(*p), GFP_KERNEL);
+	if (!p)
+		return -ENOMEM;
+
+	p->x = x;
+	p->cpu = cpu;
+	err = rhashtable_lookup_insert_fast(&xfrm_state_pcpu_table, &p->node,
+					    xfrm_state_pcpu_params);
+	if (err) {
+		kfree(p);
+		return err;
+	}
+	atomic_inc(&xfrm_state_pcpu_count);
+
+	return 0;
+}
+EXPORT_SYMBOL(xfrm_state_set_pcpu);
+
+/* Returns the CPU the state was installed for, or -1. */
+int xfrm_state_pcpu(const struct xfrm_state *x)
+{
+	struct xfrm_state_pcpu *p;
+	int cpu = -1;
+
+	if (!atomic_read(&xfrm_state_pcpu_count))
+		return -1;
+
+	rcu_read_lock();
+	p = rhashtable_lookup(&xfrm_state_pcpu_table, &x,
+			      xfrm_state_pcpu_params);
+	if (p)
+		cpu = p->cpu;
+	rcu_read_unlock();
+
+	return cpu;
+}
+EXPORT_SYMBOL(xfrm_state_pcpu);
+
+static void xfrm_state_pcpu_clear(struct xfrm_state *x)
+{
+	struct xfrm_state_pcpu *p;
+
+	if (!atomic_read(&xfrm_state_pcpu_count))
+		return;
+
+	p = rhashtable_lookup_fast(&xfrm_state_pcpu_table, &x,
+				   xfrm_state_pcpu_params);
+	if (p && !rhashtable_remove_fast(&xfrm_state_pcpu_table, &p->node,
+					 xfrm_state_pcpu_params)) {
+		atomic_dec(&xfrm_state_pcpu_count);
+		kfree_rcu(p, rcu);
+	}
+}
+
+/* Output prefers the SA of the CPU it runs on, then one that isn't bound
+ * to any CPU, and only then another CPU's.
+ */
+static int xfrm_state_pcpu_rank(const struct xfrm_state *x)
+{
+	int cpu = xfrm_state_pcpu(x);
+
+	if (cpu < 0)
+		return 1;
+	return cpu == raw_smp_processor_id() ? 2 : 0;
+}
+
 static void ___xfrm_state_destroy(struct xfrm_state *x)
 {
+	xfrm_state_pcpu_clear(x);
 	hrtimer_cancel(&x->mtimer);
 	del_timer_sync(&x->rtimer);
 	kfree(x->aead);
@@ -682,6 +863,7 @@ int __xfrm_state_delete(struct xfrm_state *x)
 
 	if (x->km.state != XFRM_STATE_DEAD) {
 		x->km.state = XFRM_STATE_DEAD;
+		xfrm_state_cache_invalidate(net);
 		spin_lock(&net->xfrm.xfrm_state_lock);
 		list_del(&x->km.all);
 		hlist_del_rcu(&x->bydst);
@@ -1029,6 +1211,8 @@ static void xfrm_state_look_at(struct xfrm_policy *pol, struct xfrm_state *x,
 			       struct xfrm_state **best, int *acq_in_progress,
 			       int *error)
 {
+	int rank, best_rank;
+
 	/* Resolution logic:
 	 * 1. There is a valid state with matching selector. Done.
 	 * 2. Valid state with inappropriate selector. Skip.
@@ -1048,10 +1232,17 @@ static void xfrm_state_look_at(struct xfrm_policy *pol, struct xfrm_state *x,
 							&fl->u.__fl_common))
 			return;
 
-		if (!*best ||
-		    (*best)->km.dying > x->km.dying ||
-		    ((*best)->km.dying == x->km.dying &&
-		     (*best)->curlft.add_time < x->curlft.add_time))
+		rank = best_rank = 0;
+		if (*best) {
+			rank = xfrm_state_pcpu_rank(x);
+			best_rank = xfrm_state_pcpu_rank(*best);
+		}
+
+		if (!*best || best_rank < rank ||
+		    (best_rank == rank &&
+		     ((*best)->km.dying > x->km.dying ||
+		      ((*best)->km.dying == x->km.dying &&
+		       (*best)->curlft.add_time < x->curlft.add_time))))
 			*best = x;
 	} else if (x->km.state == XFRM_STATE_ACQ) {
 		*acq_in_progress = 1;
@@ -1081,15 +1272,39 @@ xfrm_state_find(const xfrm_address_t *daddr, const xfrm_address_t *saddr,
 	struct xfrm_state *best = NULL;
 	u32 mark = pol->mark.v & pol->mark.m;
 	unsigned short encap_family = tmpl->encap_family;
-	unsigned int sequence;
+	unsigned int sequence, genid;
 	struct km_event c;
+	int candidates = 0;
 
 	to_put = NULL;
 
 	sequence = read_seqcount_begin(&net->xfrm.xfrm_state_hash_generation);
+	genid = atomic_read(&net->xfrm.state_cache_genid);
 
 	rcu_read_lock();
 	h = xfrm_dst_hash(net, daddr, saddr, tmpl->reqid, encap_family);
+
+	x = xfrm_state_cache_lookup(net, tmpl, h, daddr, saddr, if_id, genid);
+	if (x) {
+		/* It was the only candidate, so it is the answer as long as
+		 * it is still valid and its selector takes this flow.  The
+		 * template is checked again in case its policy was freed
+		 * and the memory reused for another one.
+		 */
+		xfrm_state_look_at(pol, x, fl, family,
+				   &best, &acquire_in_progress, &error);
+		if (best && x->props.reqid == tmpl->reqid &&
+		    x->props.family == encap_family &&
+		    x->id.proto == tmpl->id.proto &&
+		    x->props.mode == tmpl->mode &&
+		    (mark & x->mark.m) == x->mark.v && x->if_id == if_id)
+			goto out;
+
+		best = NULL;
+		acquire_in_progress = 0;
+		error = 0;
+	}
+
 	hlist_for_each_entry_rcu(x, net->xfrm.state_bydst + h, bydst) {
 		if (x->props.family == encap_family &&
 		    x->props.reqid == tmpl->reqid &&
@@ -1099,9 +1314,11 @@ xfrm_state_find(const xfrm_address_t *daddr, const xfrm_address_t *saddr,
 		    xfrm_state_addr_check(x, daddr, saddr, encap_family) &&
 		    tmpl->mode == x->props.mode &&
 		    tmpl->id.proto == x->id.proto &&
-		    (tmpl->id.spi == x->id.spi || !tmpl->id.spi))
+		    (tmpl->id.spi == x->id.spi || !tmpl->id.spi)) {
+			candidates++;
 			xfrm_state_look_at(pol, x, fl, family,
 					   &best, &acquire_in_progress, &error);
+		}
 	}
 	if (best || acquire_in_progress)
 		goto found;
@@ -1116,12 +1333,17 @@ xfrm_state_find(const xfrm_address_t *daddr, const xfrm_address_t *saddr,
 		    xfrm_addr_equal(&x->id.daddr, daddr, encap_family) &&
 		    tmpl->mode == x->props.mode &&
 		    tmpl->id.proto == x->id.proto &&
-		    (tmpl->id.spi == x->id.spi || !tmpl->id.spi))
+		    (tmpl->id.spi == x->id.spi || !tmpl->id.spi)) {
+			candidates++;
 			xfrm_state_look_at(pol, x, fl, family,
 					   &best, &acquire_in_progress, &error);
+		}
 	}
 
 found:
+	if (best && candidates == 1)
+		xfrm_state_cache_store(net, tmpl, h, daddr, saddr, if_id,
+				       genid, best);
 	x = best;
 	if (!x && !error && !acquire_in_progress) {
 		if (tmpl->id.spi &&
@@ -1164,6 +1386,7 @@ xfrm_state_find(const xfrm_address_t *daddr, const xfrm_address_t *saddr,
 		if (km_query(x, tmpl, pol) == 0) {
 			spin_lock_bh(&net->xfrm.xfrm_state_lock);
 			x->km.state = XFRM_STATE_ACQ;
+			xfrm_state_cache_invalidate(net);
 			list_add(&x->km.all, &net->xfrm.state_all);
 			hlist_add_head_rcu(&x->bydst, net->xfrm.state_bydst + h);
 			h = xfrm_src_hash(net, daddr, saddr, encap_family);
@@ -1275,6 +1498,7 @@ static void __xfrm_state_insert(struct xfrm_state *x)
 	struct net *net = xs_net(x);
 	unsigned int h;
 
+	xfrm_state_cache_invalidate(net);
 	list_add(&x->km.all, &net->xfrm.state_all);
 
 	h = xfrm_dst_hash(net, &x->id.daddr, &x->props.saddr,
@@ -1739,6 +1963,7 @@ int xfrm_state_update(struct xfrm_state *x)
 			memcpy(&x1->sel, &x->sel, sizeof(x1->sel));
 		memcpy(&x1->lft, &x->lft, sizeof(x1->lft));
 		x1->km.dying = 0;
+		xfrm_state_cache_invalidate(net);
 
 		hrtimer_start(&x1->mtimer, ktime_set(1, 0),
 			      HRTIMER_MODE_REL_SOFT);
@@ -2685,9 +2910,13 @@ int __net_init xfrm_state_init(struct net *net)
 {
 	unsigned int sz;
 
-	if (net_eq(net, &init_net))
+	if (net_eq(net, &init_net)) {
 		xfrm_state_cache = KMEM_CACHE(xfrm_state,
 					      SLAB_HWCACHE_ALIGN | SLAB_PANIC);
+		if (rhashtable_init(&xfrm_state_pcpu_table,
+				    &xfrm_state_pcpu_params))
+			return -ENOMEM;
+	}
 
 	INIT_LIST_HEAD(&net->xfrm.state_all);
 
@@ -2707,6 +2936,11 @@ int __net_init xfrm_state_init(struct net *net)
 		goto out_byseq;
 	net->xfrm.state_hmask = ((sz / sizeof(struct hlist_head)) - 1);
 
+	net->xfrm.state_cache = alloc_percpu(struct xfrm_state_cache);
+	if (!net->xfrm.state_cache)
+		goto out_cache;
+	atomic_set(&net->xfrm.state_cache_genid, 0);
+
 	net->xfrm.state_num = 0;
 	INIT_WORK(&net->xfrm.state_hash_work, xfrm_hash_resize);
 	spin_lock_init(&net->xfrm.xfrm_state_lock);
@@ -2714,6 +2948,8 @@ int __net_init xfrm_state_init(struct net *net)
 			       &net->xfrm.xfrm_state_lock);
 	return 0;
 
+out_cache:
+	xfrm_hash_free(net->xfrm.state_byseq, sz);
 out_byseq:
 	xfrm_hash_free(net->xfrm.state_byspi, sz);
 out_byspi:
@@ -2743,6 +2979,7 @@ void xfrm_state_fini(struct net *net)
 	xfrm_hash_free(net->xfrm.state_bysrc, sz);
 	WARN_ON(!hlist_empty(net->xfrm.state_bydst));
 	xfrm_hash_free(net->xfrm.state_bydst, sz);
+	free_percpu(net->xfrm.state_cache);
 }
 
 #ifdef CONFIG_AUDITSYSCALL
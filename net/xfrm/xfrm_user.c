@@ -34,6 +34,8 @@
 #endif
 #include <asm/unaligned.h>
 
+#include "xfrm_pcpu.h"
+
 static int verify_one_alg(struct nlattr **attrs, enum xfrm_attr_type_t type)
 {
 	struct nlattr *rt = attrs[type];
@@ -686,10 +688,14 @@ static int xfrm_add_sa(struct sk_buff *skb, struct nlmsghdr *nlh,
 		return err;
 
 	xfrm_state_hold(x);
-	if (nlh->nlmsg_type == XFRM_MSG_NEWSA)
-		err = xfrm_state_add(x);
-	else
-		err = xfrm_state_update(x);
+	if (attrs[XFRMA_SA_PCPU])
+		err = xfrm_state_set_pcpu(x, nla_get_u32(attrs[XFRMA_SA_PCPU]));
+	if (!err) {
+		if (nlh->nlmsg_type == XFRM_MSG_NEWSA)
+			err = xfrm_state_add(x);
+		else
+			err = xfrm_state_update(x);
+	}
 
 	xfrm_audit_state_add(x, err ? 0 : 1, true);
 
@@ -947,6 +953,7 @@ static int copy_to_user_state_extra(struct xfrm_state *x,
 				    struct sk_buff *skb)
 {
 	int ret = 0;
+	int cpu;
 
 	copy_to_user_state(x, p);
 
@@ -1024,6 +1031,12 @@ static int copy_to_user_state_extra(struct xfrm_state *x,
 		if (ret)
 			goto out;
 	}
+	cpu = xfrm_state_pcpu(x);
+	if (cpu >= 0) {
+		ret = nla_put_u32(skb, XFRMA_SA_PCPU, cpu);
+		if (ret)
+			goto out;
+	}
 	if (x->security)
 		ret = copy_sec_ctx(x->security, skb);
 out:
@@ -2798,6 +2811,7 @@ const struct nla_policy xfrma_policy[XFRMA_MAX+1] = {
 	[XFRMA_SET_MARK]	= { .type = NLA_U32 },
 	[XFRMA_SET_MARK_MASK]	= { .type = NLA_U32 },
 	[XFRMA_IF_ID]		= { .type = NLA_U32 },
+	[XFRMA_SA_PCPU]		= { .type = NLA_U32 },
 };
 EXPORT_SYMBOL_GPL(xfrma_policy);
 
@@ -3065,6 +3079,8 @@ static inline unsigned int xfrm_sa_len(struct xfrm_state *x)
 	}
 	if (x->if_id)
 		l += nla_total_size(sizeof(x->if_id));
+	if (xfrm_state_pcpu(x) >= 0)
+		l += nla_total_size(sizeof(u32));
 
 	/* Must count x->lastused as it may become non-zero behind our back. */
 	l += nla_total_size_64bit(sizeof(u64));
@@ -18,6 +18,8 @@
 #define DMA_MAP_MAX_THREADS	1024
 #define DMA_MAP_MAX_SECONDS     300
 #define DMA_MAP_MAX_TRANS_DELAY	(10 * NSEC_PER_MSEC)
+#define DMA_MAP_MAX_SG_NENTS	256
+#define DMA_MAP_HIST_BUCKETS	8
 
 #define DMA_MAP_BIDIRECTIONAL	0
 #define DMA_MAP_TO_DEVICE	1
@@ -41,9 +43,26 @@ struct map_benchmark {
 	__u32 dma_dir; /* DMA data direction */
 	__u32 dma_trans_ns; /* time for DMA transmission in ns */
 	__u32 granule; /* how many PAGE_SIZE will do map/unmap once a time */
-	__u8 expansion[76];	/* For future use */
+	__u32 sg_nents; /* 0: dma_map_single, else dma_map_sg of this many */
+	__u32 map_hist[DMA_MAP_HIST_BUCKETS]; /* map latency histogram */
+	__u32 unmap_hist[DMA_MAP_HIST_BUCKETS]; /* as above */
+	__u8 expansion[8];	/* For future use */
 };
 
+static void print_hist(const char *what, __u32 *hist)
+{
+	int i;
+
+	printf("%s latency histogram:\n", what);
+	for (i = 0; i < DMA_MAP_HIST_BUCKETS; i++) {
+		if (i == DMA_MAP_HIST_BUCKETS - 1)
+			printf("  >= %6.1fus", (1 << i) / 10.0);
+		else
+			printf("  <  %6.1fus", (2 << i) / 10.0);
+		printf(" %u\n", hist[i]);
+	}
+}
+
 int main(int argc, char **argv)
 {
 	struct map_benchmark map;
@@ -52,13 +71,14 @@ int main(int argc, char **argv)
 	int threads = 1, seconds = 20, node = -1;
 	/* default dma mask 32bit, bidirectional DMA */
 	int bits = 32, xdelay = 0, dir = DMA_MAP_BIDIRECTIONAL;
-	/* default granule 1 PAGESIZE */
-	int granule = 1;
+	/* default granule 1 PAGESIZE, dma_map_single */
+	int granule = 1, nents = 0;
+	const char *path = "/sys/kernel/debug/dma_map_benchmark";
 
 	int cmd = DMA_MAP_BENCHMARK;
 	char *p;
 
-	while ((opt = getopt(argc, argv, "t:s:n:b:d:x:g:")) != -1) {
+	while ((opt = getopt(argc, argv, "t:s:n:b:d:x:g:e:f:")) != -1) {
 		switch (opt) {
 		case 't':
 			threads = atoi(optarg);
@@ -81,6 +101,12 @@ int main(int argc, char **argv)
 		case 'g':
 			granule = atoi(optarg);
 			break;
+		case 'e':
+			nents = atoi(optarg);
+			break;
+		case 'f':
+			path = optarg;
+			break;
 		default:
 			return -1;
 		}
@@ -121,7 +147,13 @@ int main(int argc, char **argv)
 		exit(1);
 	}
 
-	fd = open("/sys/kernel/debug/dma_map_benchmark", O_RDWR);
+	if (nents < 0 || nents > DMA_MAP_MAX_SG_NENTS) {
+		fprintf(stderr, "invalid number of sg entries, must be in 0-%d\n",
+			DMA_MAP_MAX_SG_NENTS);
+		exit(1);
+	}
+
+	fd = open(path, O_RDWR);
 	if (fd == -1) {
 		perror("open");
 		exit(1);
@@ -135,6 +167,7 @@ int main(int argc, char **argv)
 	map.dma_dir = dir;
 	map.dma_trans_ns = xdelay;
 	map.granule = granule;
+	map.sg_nents = nents;
 
 	if (ioctl(fd, cmd, &map)) {
 		perror("ioctl");
@@ -147,6 +180,10 @@ int main(int argc, char **argv)
 			map.avg_map_100ns/10.0, map.map_stddev/10.0);
 	printf("average unmap latency(us):%.1f standard deviation:%.1f\n",
 			map.avg_unmap_100ns/10.0, map.unmap_stddev/10.0);
+	if (nents)
+		printf("scatterlist entries per map: %d\n", nents);
+	print_hist("map", map.map_hist);
+	print_hist("unmap", map.unmap_hist);
 
 	return 0;
 }
@@ -56,14 +56,25 @@ static void kvm_reset_dirty_gfn(struct kvm *kvm, u32 slot, u64 offset, u64 mask)
 	if (as_id >= KVM_ADDRESS_SPACE_NUM || id >= KVM_USER_MEM_SLOTS)
 		return;
 
+	if (!mask)
+		return;
+
 	memslot = id_to_memslot(__kvm_memslots(kvm, as_id), id);
 
 	if (!memslot || (offset + __fls(mask)) >= memslot->npages)
 		return;
 
-	KVM_MMU_LOCK(kvm);
 	kvm_arch_mmu_enable_log_dirty_pt_masked(kvm, memslot, offset, mask);
-	KVM_MMU_UNLOCK(kvm);
+
+	/*
+	 * mmu_lock is held across the whole ring, let vCPUs faulting on
+	 * it (and the scheduler) in between two batches.
+	 */
+	if (need_resched() || KVM_MMU_NEEDBREAK(kvm)) {
+		KVM_MMU_UNLOCK(kvm);
+		cond_resched();
+		KVM_MMU_LOCK(kvm);
+	}
 }
 
 int kvm_dirty_ring_alloc(struct kvm_dirty_ring *ring, int index, u32 size)
@@ -108,6 +119,12 @@ int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring)
 	/* This is only needed to make compilers happy */
 	cur_slot = cur_offset = mask = 0;
 
+	/*
+	 * Take mmu_lock once for the ring rather than once for every
+	 * coalesced mask, a ring full of scattered GFNs would otherwise
+	 * bounce the lock against the faulting vCPUs thousands of times.
+	 */
+	KVM_MMU_LOCK(kvm);
 	while (true) {
 		entry = &ring->dirty_gfns[ring->reset_index & (ring->size - 1)];
 
@@ -150,6 +167,7 @@ int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring)
 	}
 
 	kvm_reset_dirty_gfn(kvm, cur_slot, cur_offset, mask);
+	KVM_MMU_UNLOCK(kvm);
 
 	trace_kvm_dirty_ring_reset(ring);
 
@@ -93,6 +93,16 @@ unsigned int halt_poll_ns_shrink;
 module_param(halt_poll_ns_shrink, uint, 0644);
 EXPORT_SYMBOL_GPL(halt_poll_ns_shrink);
 
+/*
+ * Cap on the host CPU time all vCPUs of a VM may spend halt polling, in
+ * percent of one host CPU.  0 means no cap.
+ */
+unsigned int halt_poll_vm_pct;
+module_param(halt_poll_vm_pct, uint, 0644);
+EXPORT_SYMBOL_GPL(halt_poll_vm_pct);
+
+#define KVM_HALT_POLL_WINDOW_NS		(10 * NSEC_PER_MSEC)
+
 /*
  * Ordering of locks:
  *
@@ -3198,6 +3208,81 @@ update_halt_poll_stats(struct kvm_vcpu *vcpu, u64 poll_ns, bool waited)
 		vcpu->stat.generic.halt_poll_fail_ns += poll_ns;
 	else
 		vcpu->stat.generic.halt_poll_success_ns += poll_ns;
+
+	if (READ_ONCE(halt_poll_vm_pct))
+		atomic64_add(poll_ns, &vcpu->kvm->halt_poll_window_ns);
+}
+
+/*
+ * Has the VM used up its halt polling budget for the current window?
+ * Racing vCPUs may all restart the window, which only loses a little
+ * accounting.
+ */
+static bool kvm_halt_poll_throttled(struct kvm *kvm, u64 now)
+{
+	unsigned int pct = READ_ONCE(halt_poll_vm_pct);
+
+	if (!pct)
+		return false;
+
+	if (now - READ_ONCE(kvm->halt_poll_window_start) >=
+	    KVM_HALT_POLL_WINDOW_NS) {
+		WRITE_ONCE(kvm->halt_poll_window_start, now);
+		atomic64_set(&kvm->halt_poll_window_ns, 0);
+		return false;
+	}
+
+	return atomic64_read(&kvm->halt_poll_window_ns) >=
+	       KVM_HALT_POLL_WINDOW_NS / 100 * pct;
+}
+
+/*
+ * Guess how long this halt will last from the halts that ended the same
+ * way as the previous one did: guests tend to go through phases of timer
+ * driven or interrupt driven idling.
+ */
+static bool kvm_vcpu_want_halt_poll(struct kvm_vcpu *vcpu, ktime_t now)
+{
+	u64 predicted = vcpu->halt_wakeup_avg_ns[vcpu->halt_last_wakeup];
+
+	if (!vcpu->halt_poll_ns || kvm_arch_no_poll(vcpu))
+		return false;
+
+	if (predicted > vcpu->halt_poll_ns) {
+		++vcpu->stat.generic.halt_poll_skipped;
+		return false;
+	}
+
+	if (kvm_halt_poll_throttled(vcpu->kvm, ktime_to_ns(now))) {
+		++vcpu->stat.generic.halt_poll_throttled;
+		return false;
+	}
+
+	return true;
+}
+
+static void kvm_vcpu_halt_wakeup(struct kvm_vcpu *vcpu, u64 block_ns)
+{
+	enum kvm_halt_wakeup src;
+	u64 *avg;
+
+	if (!vcpu_valid_wakeup(vcpu))
+		return;
+
+	if (kvm_cpu_has_pending_timer(vcpu)) {
+		src = KVM_HALT_WAKEUP_TIMER;
+		KVM_STATS_LOG_HIST_UPDATE(
+			vcpu->stat.generic.halt_wakeup_timer_hist, block_ns);
+	} else {
+		src = KVM_HALT_WAKEUP_IRQ;
+		KVM_STATS_LOG_HIST_UPDATE(
+			vcpu->stat.generic.halt_wakeup_irq_hist, block_ns);
+	}
+
+	/* avg = 7/8 avg + 1/8 block_ns */
+	avg = &vcpu->halt_wakeup_avg_ns[src];
+	*avg = *avg - (*avg >> 3) + (block_ns >> 3);
+	vcpu->halt_last_wakeup = src;
 }
 
 /*
@@ -3212,7 +3297,7 @@ void kvm_vcpu_block(struct kvm_vcpu *vcpu)
 	kvm_arch_vcpu_blocking(vcpu);
 
 	start = cur = poll_end = ktime_get();
-	if (vcpu->halt_poll_ns && !kvm_arch_no_poll(vcpu)) {
+	if (kvm_vcpu_want_halt_poll(vcpu, start)) {
 		ktime_t stop = ktime_add_ns(ktime_get(), vcpu->halt_poll_ns);
 
 		++vcpu->stat.generic.halt_attempted_poll;
@@ -3266,6 +3351,7 @@ void kvm_vcpu_block(struct kvm_vcpu *vcpu)
 
 	update_halt_poll_stats(
 		vcpu, ktime_to_ns(ktime_sub(poll_end, start)), waited);
+	kvm_vcpu_halt_wakeup(vcpu, block_ns);
 
 	if (!kvm_arch_no_poll(vcpu)) {
 		if (!vcpu_valid_wakeup(vcpu)) {
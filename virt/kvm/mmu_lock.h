@@ -14,10 +14,12 @@
 #define KVM_MMU_LOCK_INIT(kvm) rwlock_init(&(kvm)->mmu_lock)
 #define KVM_MMU_LOCK(kvm)      write_lock(&(kvm)->mmu_lock)
 #define KVM_MMU_UNLOCK(kvm)    write_unlock(&(kvm)->mmu_lock)
+#define KVM_MMU_NEEDBREAK(kvm) rwlock_needbreak(&(kvm)->mmu_lock)
 #else
 #define KVM_MMU_LOCK_INIT(kvm) spin_lock_init(&(kvm)->mmu_lock)
 #define KVM_MMU_LOCK(kvm)      spin_lock(&(kvm)->mmu_lock)
 #define KVM_MMU_UNLOCK(kvm)    spin_unlock(&(kvm)->mmu_lock)
+#define KVM_MMU_NEEDBREAK(kvm) spin_needbreak(&(kvm)->mmu_lock)
 #endif /* KVM_HAVE_MMU_RWLOCK */
 
 #endif